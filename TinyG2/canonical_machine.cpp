@@ -45,8 +45,9 @@
  *	It's a bit more complicated than this. The 'gm' struct contains the core Gcode model
  *	context. This originates in the canonical machine and is copied to each planner buffer
  *	(bf buffer) during motion planning. Finally, the gm context is passed to the runtime
- *	(mr) for the RUNTIME context. So at last count the Gcode model exists in as many as
- *	30 copies in the system. (1+28+1)
+ *	(mr) for the RUNTIME context. The planner buffers only carry the parts of gm that
+ *	change on every block - the rest is shared between buffers as a Gcode context
+ *	(see mpGcodeContext_t in planner.h) and put back together when the move starts.
  *
  *	Depending on the need, any one of these contexts may be called for reporting or by
  *	a function. Most typically, all new commends from the gcode parser work form the MODEL
@@ -73,7 +74,10 @@
  *		function, which is the runtime execution routine, and any arguments that are needed
  *		by the runtime. See typedef for *exec in planner.h for details
  *
- *	  - mp_queue_command() stores the callback and the args in a planner buffer.
+ *	  - mp_queue_command() stores the callback and the args in a planner buffer. Commands
+ *		that only need the machine at rest (offsets, M6, spindle on/off) use
+ *		mp_queue_stop_command() instead, which keeps them in a small side queue carried by
+ *		the next block rather than in a buffer of their own.
  *
  *	  - When planner execution reaches the buffer it executes the callback w/ the args.
  *		Take careful note that the callback executes under an interrupt, so beware of
@@ -95,8 +99,11 @@
 
 #include "plan_arc.h"
 #include "planner.h"
+#include "plan_shaper.h"
+#include "plan_retrace.h"
 #include "stepper.h"
 #include "encoder.h"
+#include "kinematics.h"
 #include "spindle.h"
 #include "coolant.h"
 #include "pwm.h"
@@ -117,9 +124,9 @@ cmSingleton_t cm;		// canonical machine controller singleton
  ***********************************************************************************/
 
 // command execution callbacks from planner queue
+static void _queue_offset(void);
 static void _exec_offset(float *value, bool *flag);
 static void _exec_change_tool(float *value, bool *flag);
-static void _exec_select_tool(float *value, bool *flag);
 static void _exec_absolute_origin(float *value, bool *flag);
 static void _exec_program_finalize(float *value, bool *flag);
 
@@ -255,6 +262,13 @@ void cm_set_model_linenum(const uint32_t linenum)
 	nv_add_object((const char *)"n");	// then add the line number to the nv list
 }
 
+#ifdef __VELOCITY_HINTS
+void cm_set_model_exit_hint(const float exit_hint)
+{
+	cm.gm.exit_hint = exit_hint;			// velocities are mm/min in G20 too - the hint is not converted
+}
+#endif
+
 /***********************************************************************************
  * COORDINATE SYSTEMS AND OFFSETS
  * Functions to get, set and report coordinate systems and work offsets
@@ -295,11 +309,27 @@ float cm_get_active_coord_offset(const uint8_t axis)
     if (cm.gm.absolute_override == ABSOLUTE_OVERRIDE_ON) {  // no offset if in absolute override mode
         return (0.0);
     }
-    float offset = cm.offset[cm.gm.coord_system][axis];
-    if (cm.gmx.origin_offset_enable == true) {
-        offset += cm.gmx.origin_offset[axis];               // includes G5x and G92 components
-    }
-    return (offset);
+    return (cm.coord_offset[axis]);
+}
+
+/*
+ * cm_refresh_coord_offset() - recompute the active G5x + G92 offset vector
+ *
+ *	cm_get_active_coord_offset() is called for every axis of every block, so the sum is kept
+ *	in cm.coord_offset[] rather than worked out each time. Anything that changes what goes
+ *	into it must call this: G10 (cm_set_coord_offsets()), G54-G59 (cm_set_coord_system()),
+ *	the G92 family, and the $g54x-$g59c settings (cm_set_cofs()).
+ */
+
+void cm_refresh_coord_offset()
+{
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		float offset = cm.offset[cm.gm.coord_system][axis];
+		if (cm.gmx.origin_offset_enable == true) {
+			offset += cm.gmx.origin_offset[axis];			// includes G5x and G92 components
+		}
+		cm.coord_offset[axis] = offset;
+	}
 }
 
 /*
@@ -350,7 +380,7 @@ float cm_get_absolute_position(const GCodeState_t *gcode_state, const uint8_t ax
 	if (gcode_state == MODEL) {
         return (cm.gmx.position[axis]);
     }
-	return (mp_get_runtime_absolute_position(axis));
+	return (mp_get_runtime_machine_position(axis));
 }
 
 /*
@@ -417,6 +447,9 @@ void cm_update_model_position_from_runtime()
  *
  *	Only runs if there is G10 data to write, there is no movement, and the serial queues are quiescent
  *	This could be made tighter by issuing an XOFF or ~CTS beforehand and releasing it afterwards.
+ *
+ *	Only the offsets flagged in deferred_write_axes are written, using the indexes
+ *	resolved by canonical_machine_init().
  */
 
 stat_t cm_deferred_write_callback()
@@ -428,12 +461,15 @@ stat_t cm_deferred_write_callback()
 		cm.deferred_write_flag = false;
 		nvObj_t nv;
 		for (uint8_t i=1; i<=COORDS; i++) {
+			if (cm.deferred_write_axes[i] == 0) continue;
 			for (uint8_t j=0; j<AXES; j++) {
-				sprintf((char *)nv.token, "g%2d%c", 53+i, ("xyzabc")[j]);
-				nv.index = nv_get_index((const char *)"", nv.token);
+				if (!(cm.deferred_write_axes[i] & (1 << j))) continue;
+				if (cm.offset_index[i][j] == NO_MATCH) continue;
+				nv.index = cm.offset_index[i][j];
 				nv.value = cm.offset[i][j];
 				nv_persist(&nv);				// Note: only writes values that have changed
 			}
+			cm.deferred_write_axes[i] = 0;
 		}
 	}
 	return (STAT_OK);
@@ -506,15 +542,43 @@ void cm_set_model_target(const float target[], const bool flag[])
 	}
 }
 
+/*
+ * cm_refresh_soft_limits() - rebuild the list of axes that soft limits are tested on
+ *
+ *	Soft limits are tested for any homed axis if min and max are different values. You can set
+ *	min and max to the same value (e.g. 0,0) to disable soft limits for an axis. An axis is also
+ *	not tested if its min or max is more than +/- DISABLE_SOFT_LIMIT.
+ *
+ *	None of that changes from move to move, so the tests are resolved here into a short list of
+ *	(axis, min, max) and the per-move tests only run down the list. Call this after anything
+ *	that changes soft_limit_enable, homed[] or travel_min/travel_max.
+ */
+void cm_refresh_soft_limits()
+{
+	cm.soft_limit_count = 0;
+	if (cm.soft_limit_enable != true) {
+		return;
+	}
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		if (cm.homed[axis] != true) continue;								// skip axis if not homed
+		if (fp_EQ(cm.a[axis].travel_min, cm.a[axis].travel_max)) continue;	// skip axis if identical
+		if (fabs(cm.a[axis].travel_min) > DISABLE_SOFT_LIMIT) continue;		// skip axis if min is disabled
+		if (fabs(cm.a[axis].travel_max) > DISABLE_SOFT_LIMIT) continue;		// skip axis if max is disabled
+
+		cmSoftLimit_t *limit = &cm.soft_limit[cm.soft_limit_count++];
+		limit->axis = axis;
+		limit->travel_min = cm.a[axis].travel_min;
+		limit->travel_max = cm.a[axis].travel_max;
+	}
+}
+
 /*
  * cm_test_soft_limits() - return error code if soft limit is exceeded
+ * cm_test_soft_limit_box() - return error code if any part of a box is outside the soft limits
  *
  *	The target[] arg must be in absolute machine coordinates. Best done after cm_set_model_target().
- *
- *	Tests for soft limit for any homed axis if min and max are different values. You can set min
- *	and max to the same value (e.g. 0,0) to disable soft limits for an axis. Also will not test
- *	a min or a max if the value is more than +/- 1000000 (plus or minus 1 million ).
- *	This allows a single end to be tested w/the other disabled, should that requirement ever arise.
+ *	cm_test_soft_limits() throws the alarm. cm_test_soft_limit_box() leaves that to the caller.
+ *	box_min[] and box_max[] are the corners of a box that encloses a move, for example an arc.
  */
 
 static stat_t _finalize_soft_limits(const stat_t status)
@@ -526,19 +590,22 @@ static stat_t _finalize_soft_limits(const stat_t status)
 
 stat_t cm_test_soft_limits(const float target[])
 {
-	if (cm.soft_limit_enable == true) {
-		for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
-			if (cm.homed[axis] != true) continue;								// skip axis if not homed
-			if (fp_EQ(cm.a[axis].travel_min, cm.a[axis].travel_max)) continue;	// skip axis if identical
-			if (fabs(cm.a[axis].travel_min) > DISABLE_SOFT_LIMIT) continue;		// skip min test if disabled
-			if (fabs(cm.a[axis].travel_max) > DISABLE_SOFT_LIMIT) continue;		// skip max test if disabled
+	stat_t status = cm_test_soft_limit_box(target, target);
+	if (status != STAT_OK) {
+		return (_finalize_soft_limits(status));
+	}
+	return (STAT_OK);
+}
 
-			if (target[axis] < cm.a[axis].travel_min) {
-				return (_finalize_soft_limits(STAT_SOFT_LIMIT_EXCEEDED_XMIN + 2*axis));
-			}
-			if (target[axis] > cm.a[axis].travel_max) {
-				return (_finalize_soft_limits(STAT_SOFT_LIMIT_EXCEEDED_XMAX + 2*axis));
-			}
+stat_t cm_test_soft_limit_box(const float box_min[], const float box_max[])
+{
+	for (uint8_t i=0; i < cm.soft_limit_count; i++) {
+		const cmSoftLimit_t *limit = &cm.soft_limit[i];
+		if (box_min[limit->axis] < limit->travel_min) {
+			return (STAT_SOFT_LIMIT_EXCEEDED_XMIN + 2*limit->axis);
+		}
+		if (box_max[limit->axis] > limit->travel_max) {
+			return (STAT_SOFT_LIMIT_EXCEEDED_XMAX + 2*limit->axis);
 		}
 	}
 	return (STAT_OK);
@@ -572,7 +639,19 @@ void canonical_machine_init()
 
 	canonical_machine_init_assertions();		// establish assertions
 	ACTIVE_MODEL = MODEL;						// setup initial Gcode model pointer
+	cm.gmx.feed_rate_override_factor = 1.0;		// overrides are on (like M48) at 100%
+	cm.gmx.traverse_override_factor = 1.0;
+	cm.gmx.feed_rate_override_enable = true;
+	cm.gmx.traverse_override_enable = true;
 	cm_arc_init();                              // Note: spindle and coolant inits are independent
+
+	char token[TOKEN_LEN+1];					// resolve G10 persistence indexes once
+	for (uint8_t i=1; i<=COORDS; i++) {
+		for (uint8_t j=0; j<AXES; j++) {
+			sprintf(token, "g%2d%c", 53+i, ("xyzabc")[j]);
+			cm.offset_index[i][j] = nv_get_index((const char *)"", token);
+		}
+	}
 }
 
 void canonical_machine_reset()
@@ -581,10 +660,11 @@ void canonical_machine_reset()
 	cm_set_units_mode(cm.default_units_mode);
 	cm_set_coord_system(cm.default_coord_system);
 	cm_select_plane(cm.default_select_plane);
-	cm_set_path_control(cm.default_path_control);
+	cm_set_path_control(cm.default_path_control, 0);
 	cm_set_distance_mode(cm.default_distance_mode);
 	cm_set_arc_distance_mode(INCREMENTAL_MODE);  // always the default
 	cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);// always the default
+	cm_set_retract_mode(RETRACT_TO_CLEAR_Z);     // G98
 
     // NOTE: Should unhome axes here
 
@@ -595,6 +675,12 @@ void canonical_machine_reset()
     cm.safety_interlock_disengaged = 0;     // ditto
     cm.safety_interlock_reengaged = 0;      // ditto
     cm.shutdown_requested = 0;              // ditto
+    cm.following_error_requested = 0;       // ditto
+    cm.spindle_sync_lost = false;           // ditto
+#ifdef __ANALOG_INPUTS
+    cm.load_feed_factor = 1.0;
+    cm.load_feed_planned = 1.0;
+#endif
 
 	// set initial state and signal that the machine is ready for action
     cm.cycle_state = CYCLE_OFF;
@@ -631,6 +717,69 @@ stat_t canonical_machine_test_assertions(void)
     return (STAT_OK);
 }
 
+#ifdef __WATCHDOG
+/*
+ * cm_save_warm_restart() - keep the warm restart record - see hw_watchdog_callback()
+ * cm_load_warm_restart() - after a warm reset, come back where the record left off
+ *
+ *	The record is in RAM the startup code doesn't clear (.noinit), and is written on every
+ *	main loop pass. After a watchdog, software or reset pin reset with a good record the
+ *	machine position is restored, as is the last line the runtime ran - {"warm":n}, for
+ *	{"start":n} to resume the job from. The homed flags are only restored if the machine
+ *	was at rest. A reset during a move can lose steps, so then the axes must be rehomed.
+ */
+typedef struct cmWarmRestart {			// kept through a reset
+	uint32_t magic;						// MAGICNUM if it was ever written
+	float position[AXES];				// runtime position, mm and machine coordinates
+	uint32_t linenum;					// last line the runtime ran
+	uint8_t homed[HOMING_AXES];
+	uint8_t homing_state;
+	uint8_t at_rest;					// the machine wasn't moving
+	uint32_t check;						// sum of the words above
+} cmWarmRestart_t;
+
+static cmWarmRestart_t warm __attribute__ ((section (".noinit")));
+
+static uint32_t _warm_check()
+{
+	uint32_t sum = 0;
+	for (const uint32_t *p = (const uint32_t *)&warm; p < &warm.check; p++) {
+		sum += *p;
+	}
+	return (sum);
+}
+
+void cm_save_warm_restart()
+{
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		warm.position[axis] = mp_get_runtime_absolute_position(axis);
+	}
+	warm.linenum = cm_get_linenum(RUNTIME);
+	memcpy(warm.homed, cm.homed, HOMING_AXES);
+	warm.homing_state = cm.homing_state;
+	warm.at_rest = (cm.motion_state == MOTION_STOP);
+	warm.magic = MAGICNUM;
+	warm.check = _warm_check();
+}
+
+void cm_load_warm_restart()
+{
+	if (!hw_reset_was_warm() || (warm.magic != MAGICNUM) || (warm.check != _warm_check())) {
+		return;
+	}
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		cm_set_position(axis, warm.position[axis]);
+	}
+	cm.warm_linenum = warm.linenum;
+	cm.gm.linenum = warm.linenum;
+	if (warm.at_rest) {
+		memcpy(cm.homed, warm.homed, HOMING_AXES);
+		cm.homing_state = (cmHomingState)warm.homing_state;
+		cm_refresh_soft_limits();
+	}
+}
+#endif // __WATCHDOG
+
 /**************************
  * Alarms                 *
  **************************/
@@ -683,7 +832,10 @@ void cm_clear()
         cm.machine_state = MACHINE_PROGRAM_STOP;
     } else if (cm.machine_state == MACHINE_SHUTDOWN) {
         cm.machine_state = MACHINE_READY;
+    } else {
+        return;
     }
+    sr_request_status_report(SR_REQUEST_IMMEDIATE); // report the new state now - don't wait for the interval
 }
 
 void cm_parse_clear(const char *s)
@@ -727,6 +879,9 @@ void cm_halt_all(void)
 
 void cm_halt_motion(void)
 {
+#ifdef __AUX_MOTION
+    st_aux_stop();                      // the aux channel stops too
+#endif
     mp_halt_runtime();                  // stop the runtime. Do this immediately. (Reset is in cm_clear)
     canonical_machine_reset();          // reset Gcode model
 	cm.cycle_state = CYCLE_OFF;         // Note: leaves machine_state alone
@@ -764,6 +919,10 @@ stat_t cm_alarm(const stat_t status, const char *msg)
         return (STAT_OK);                       // don't alarm if already in an alarm state
     }
 	cm.machine_state = MACHINE_ALARM;
+    controller_wake(DEADLINE_LED);              // blink the alarm rate now
+#ifdef __MOTION_TRACE
+    mp_trace_stop(true);                        // keep and dump what led up to it
+#endif
     cm_request_feedhold();                      // stop motion
     cm_request_queue_flush();                   // do a queue flush once runtime is not busy
 
@@ -797,6 +956,9 @@ stat_t cm_shutdown(const stat_t status, const char *msg)
     if ((cm.machine_state == MACHINE_SHUTDOWN) || (cm.machine_state == MACHINE_PANIC)) {
         return (STAT_OK);                       // don't shutdown if shutdown or panic'd
     }
+#ifdef __MOTION_TRACE
+    mp_trace_stop(true);                        // keep and dump what led up to it
+#endif
     cm_halt_motion();                           // halt motors (may have already been done from GPIO)
     spindle_reset();                            // stop spindle immediately and set speed to 0 RPM
     coolant_reset();                            // stop coolant immediately
@@ -806,8 +968,10 @@ stat_t cm_shutdown(const stat_t status, const char *msg)
         cm.homed[i] = false;
     }
     cm.homing_state = HOMING_NOT_HOMED;
+    cm_refresh_soft_limits();
 
 	cm.machine_state = MACHINE_SHUTDOWN;        // do this after all other activity
+    controller_wake(DEADLINE_LED);
 	rpt_exception(status, msg);	                // send exception report
     return (status);
 }
@@ -827,12 +991,16 @@ stat_t cm_panic(const stat_t status, const char *msg)
     if (cm.machine_state == MACHINE_PANIC) {    // only do this once
         return (STAT_OK);
     }
+#ifdef __MOTION_TRACE
+    mp_trace_stop(true);                        // keep and dump what led up to it
+#endif
     cm_halt_motion();                           // halt motors (may have already been done from GPIO)
     spindle_reset();                            // stop spindle immediately and set speed to 0 RPM
     coolant_reset();                            // stop coolant immediately
     cm_queue_flush();                           // flush all queues and reset positions
 
 	cm.machine_state = MACHINE_PANIC;           // don't reset anything. Panics are not recoverable
+    controller_wake(DEADLINE_LED);
 	rpt_exception(status, msg);			        // send panic report
 	return (status);
 }
@@ -848,6 +1016,7 @@ stat_t cm_panic(const stat_t status, const char *msg)
  *  cm_set_units_mode()         - G20, G21
  *  cm_set_distance_mode()      - G90, G91
  *  cm_set_arc_distance_mode()  - G90.1, G91.1
+ *  cm_set_retract_mode()       - G98, G99
  *  cm_set_coord_offsets()      - G10 (delayed persistence)
  *
  *  These functions assume input validation occurred upstream.
@@ -862,6 +1031,7 @@ stat_t cm_select_plane(const uint8_t plane)
 stat_t cm_set_units_mode(const uint8_t mode)
 {
 	cm.gm.units_mode = (cmUnitsMode)mode;		    // 0 = inches, 1 = mm.
+	cm.units_scale = (cm.gm.units_mode == INCHES) ? MM_PER_INCH : 1.0;
 	return(STAT_OK);
 }
 
@@ -877,6 +1047,12 @@ stat_t cm_set_arc_distance_mode(const uint8_t mode)
     return (STAT_OK);
 }
 
+stat_t cm_set_retract_mode(const uint8_t mode)
+{
+	cm.gmx.retract_mode = mode;						// 0 = old Z (G98), 1 = R plane (G99)
+	return (STAT_OK);
+}
+
 /*
  * cm_set_coord_offsets() - G10 L2/L20 Pn (affects MODEL only)
  *
@@ -908,9 +1084,11 @@ stat_t cm_set_coord_offsets(const uint8_t coord_system,
             } else {
     			cm.offset[coord_system][axis] = cm.gmx.position[axis] - _to_millimeters(offset[axis]);
             }
+			cm.deferred_write_axes[coord_system] |= (1 << axis);
 			cm.deferred_write_flag = true;                  // persist offsets once machining cycle is over
 		}
 	}
+	cm_refresh_coord_offset();
 	return (STAT_OK);
 }
 
@@ -919,16 +1097,39 @@ stat_t cm_set_coord_offsets(const uint8_t coord_system,
  */
 /*
  * cm_set_coord_system() - G54-G59
+ * cm_set_model_only_offsets() - hold back the runtime offsets while the model is fast-forwarded
+ * _queue_offset() - queue the model's offsets to the runtime
  * _exec_offset() - callback from planner
+ *
+ *	While a program is fast-forwarded to a start line nothing moves, so G54-G59 and G92
+ *	only change the model. Queueing each of them would stop the planner for nothing.
+ *	Ending it queues the offsets the model was left with.
  */
 stat_t cm_set_coord_system(const uint8_t coord_system)
 {
     cm.gm.coord_system = (cmCoordSystem)coord_system;
+	cm_refresh_coord_offset();
+	_queue_offset();
+	return (STAT_OK);
+}
+
+void cm_set_model_only_offsets(const bool model_only)
+{
+	bool ending = cm.model_only_offsets && !model_only;
+	cm.model_only_offsets = model_only;
+	if (ending) {
+		_queue_offset();
+	}
+}
 
-	float value[] = { (float)coord_system,0,0,0,0,0 };	    // pass coordinate system in value[0] element
+static void _queue_offset()
+{
+	if (cm.model_only_offsets) {
+		return;
+	}
+	float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };	// pass coordinate system in value[0] element
     bool flags[]  = { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_offset, value, flags);			// second vector (flags) is not used, so fake it
-	return (STAT_OK);
+	mp_queue_stop_command(_exec_offset, value, flags);			// second vector (flags) is not used, so fake it
 }
 
 static void _exec_offset(float *value, bool *flag)
@@ -1010,6 +1211,7 @@ static void _exec_absolute_origin(float *value, bool *flag)
 			cm.homed[axis] = true;	// G28.3 is not considered homed until you get here
 		}
 	}
+	cm_refresh_soft_limits();
 	mp_set_steps_to_runtime_position();
 }
 
@@ -1033,10 +1235,8 @@ stat_t cm_set_origin_offsets(const float offset[], const bool flag[])
 	            cm.offset[cm.gm.coord_system][axis] - _to_millimeters(offset[axis]);
 		}
 	}
-	// now pass the offset to the callback - setting the coordinate system also applies the offsets
-	float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 }; // pass coordinate system in value[0] element
-    bool flags[]  = { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_offset, value, flags);				  // second vector is not used
+	cm_refresh_coord_offset();
+	_queue_offset();				// setting the coordinate system also applies the offsets
 	return (STAT_OK);
 }
 
@@ -1046,27 +1246,24 @@ stat_t cm_reset_origin_offsets()
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
 		cm.gmx.origin_offset[axis] = 0;
 	}
-	float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };
-    bool flags[]  = { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_offset, value, flags);
+	cm_refresh_coord_offset();
+	_queue_offset();
 	return (STAT_OK);
 }
 
 stat_t cm_suspend_origin_offsets()
 {
 	cm.gmx.origin_offset_enable = false;
-	float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };
-    bool flags[]  = { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_offset, value, flags);
+	cm_refresh_coord_offset();
+	_queue_offset();
 	return (STAT_OK);
 }
 
 stat_t cm_resume_origin_offsets()
 {
 	cm.gmx.origin_offset_enable = true;
-	float value[] = { (float)cm.gm.coord_system,0,0,0,0,0 };
-    bool flags[]  = { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_offset, value, flags);
+	cm_refresh_coord_offset();
+	_queue_offset();
 	return (STAT_OK);
 }
 
@@ -1091,6 +1288,9 @@ stat_t cm_straight_traverse(const float target[], const bool flags[])
 	ritorno (cm_test_soft_limits(cm.gm.target)); 	// test soft limits; exit if thrown
 	cm_set_work_offsets(&cm.gm);					// capture the fully resolved offsets to the state
 	cm_cycle_start();								// required for homing & other cycles
+#ifdef __HOST__
+	host_record_move(cm.gm.linenum, cm.gm.motion_mode, cm.gm.feed_rate, cm.gm.target, AXES);	// see host.h
+#endif
 	stat_t status = mp_aline(&cm.gm);				// send the move to the planner
 	cm_finalize_move();
 	if (status == STAT_MINIMUM_LENGTH_MOVE && !mp_has_runnable_buffer()) {
@@ -1149,6 +1349,65 @@ stat_t cm_goto_g30_position(const float target[], const bool flags[])
     return (_goto_stored_position(cm.gmx.g30_position, target, flags));
 }
 
+/*
+ * cm_resume_traverse() - approach a resume point from above - clear Z, then traverse over it
+ * cm_resume_plunge()   - feed Z down onto the resume point
+ *
+ *	Used to start a program part way through - see gc_set_start(). The model has been
+ *	fast-forwarded to the resume point without moving, so it is first put back where the
+ *	machine really is. Z goes up to its travel max if it's homed, otherwise it stays at the
+ *	higher of where it is and the resume point. The plunge is a feed at the model's feed rate,
+ *	or a traverse if there isn't a per-minute feed rate to use.
+ *
+ *	Positions are in mm and machine coordinates. Moves carry the model's line number.
+ */
+
+static stat_t _resume_move(const float target[], const uint8_t motion_mode)
+{
+	copy_vector(cm.gm.target, target);
+	cm.gm.motion_mode = motion_mode;
+	ritorno (cm_test_soft_limits(cm.gm.target));
+	cm_set_work_offsets(&cm.gm);
+	cm_cycle_start();
+	stat_t status = mp_aline(&cm.gm);
+	cm_finalize_move();
+	if (status == STAT_MINIMUM_LENGTH_MOVE) {		// already there
+		if (!mp_has_runnable_buffer()) {
+			cm_cycle_end();
+		}
+		return (STAT_OK);
+	}
+	return (status);
+}
+
+stat_t cm_resume_traverse(const float position[])
+{
+	float target[AXES];
+
+	cm_update_model_position_from_runtime();
+	copy_vector(target, cm.gmx.position);
+	target[AXIS_Z] = max(target[AXIS_Z], position[AXIS_Z]);
+	if (cm.homed[AXIS_Z]) {
+		target[AXIS_Z] = max(target[AXIS_Z], cm.a[AXIS_Z].travel_max);
+	}
+	ritorno(_resume_move(target, MOTION_MODE_STRAIGHT_TRAVERSE));	// clear Z
+
+	for (uint8_t axis=AXIS_X; axis<AXES; axis++) {
+		if (axis != AXIS_Z) {
+			target[axis] = position[axis];
+		}
+	}
+	return (_resume_move(target, MOTION_MODE_STRAIGHT_TRAVERSE));	// over the resume point
+}
+
+stat_t cm_resume_plunge(const float position[])
+{
+	if (fp_ZERO(cm.gm.feed_rate) || (cm.gm.feed_rate_mode != UNITS_PER_MINUTE_MODE)) {
+		return (_resume_move(position, MOTION_MODE_STRAIGHT_TRAVERSE));
+	}
+	return (_resume_move(position, MOTION_MODE_STRAIGHT_FEED));
+}
+
 /********************************
  * Machining Attributes (4.3.5) *
  ********************************/
@@ -1187,11 +1446,19 @@ stat_t cm_set_feed_rate_mode(const uint8_t mode)
 
 /*
  * cm_set_path_control() - G61, G61.1, G64 (affects MODEL only)
+ *
+ *	G64 P<tolerance> lets continuous mode round corners off within the tolerance, in
+ *	length units - see _blend_corner() in plan_line.cpp. G64 without P, and the exact
+ *	modes, pass through every vertex.
  */
 
-stat_t cm_set_path_control(const uint8_t mode)
+stat_t cm_set_path_control(const uint8_t mode, const float tolerance)
 {
+	if (tolerance < 0) {
+		return (STAT_P_WORD_IS_INVALID);
+	}
 	cm.gm.path_control = (cmPathControl)mode;
+	cm.gmx.path_tolerance = (mode == PATH_CONTINUOUS) ? _to_millimeters(tolerance) : 0;
 	return (STAT_OK);
 }
 
@@ -1233,6 +1500,9 @@ stat_t cm_straight_feed(const float target[], const bool flags[])
 	ritorno (cm_test_soft_limits(cm.gm.target)); 	// test soft limits; exit if thrown
 	cm_set_work_offsets(&cm.gm);					// capture the fully resolved offsets to the state
 	cm_cycle_start();								// required for homing & other cycles
+#ifdef __HOST__
+	host_record_move(cm.gm.linenum, cm.gm.motion_mode, cm.gm.feed_rate, cm.gm.target, AXES);	// see host.h
+#endif
 	stat_t status = mp_aline(&cm.gm);				// send the move to the planner
 
     cm_finalize_move(); // <-- ONLY safe because we don't care about status...
@@ -1244,124 +1514,978 @@ stat_t cm_straight_feed(const float target[], const bool flags[])
     return (status);
 }
 
-/*****************************
- * Spindle Functions (4.3.7) *
- *****************************/
-// see spindle.cpp/.h
-
-/**************************
- * Tool Functions (4.3.8) *
- **************************/
+#ifdef __BINARY_DATA
 /*
- * cm_select_tool()		- T parameter
- * _exec_select_tool()	- execution callback
- *
- * cm_change_tool()		- M6 (This might become a complete tool change cycle)
- * _exec_change_tool()	- execution callback
- *
- * Note: These functions don't actually do anything for now, and there's a bug
- *		 where T and M in different blocks don;t work correctly
+ * cm_machine_feed() - a precompiled move - target in machine coordinates and mm
+ *
+ *	Runs a move Tools/gcode_precompile.py has already taken through the parser and the
+ *	canonical machine on the host: the target is absolute machine coordinates in mm and
+ *	the feed rate is in mm/min (or inverse time under G93), so there is no parsing and no
+ *	unit or offset conversion left to do. Motion mode is G0-G3 - an arc the canonical
+ *	machine cut into lines comes as those lines, in the arc's mode. The motion mode and feed
+ *	rate are left in the model, as the Gcode they came from would have, for Gcode that follows.
  */
-stat_t cm_select_tool(const uint8_t tool_select)
+stat_t cm_machine_feed(const float target[], const uint8_t motion_mode, const float feed_rate, const uint32_t linenum)
 {
-	float value[] = { (float)tool_select, 0,0,0,0,0 };
-    bool flags[]  = { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_select_tool, value, flags);
-	return (STAT_OK);
+	if (motion_mode > MOTION_MODE_CCW_ARC) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	if ((motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) && fp_ZERO(feed_rate)) {
+		return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
+	}
+	cm.gm.linenum = linenum;
+	cm.gm.motion_mode = motion_mode;
+	cm.gm.feed_rate = feed_rate;
+#ifdef __VELOCITY_HINTS
+	cm.gm.exit_hint = 0;							// hints come in (VEX) comments, not in records
+#endif
+	copy_vector(cm.gm.target, target);
+	ritorno (cm_test_soft_limits(cm.gm.target));
+	cm_set_work_offsets(&cm.gm);
+	cm_cycle_start();
+	stat_t status = mp_aline(&cm.gm);
+	cm_finalize_move();
+
+	if (status == STAT_MINIMUM_LENGTH_MOVE && !mp_has_runnable_buffer()) {
+		cm_cycle_end();
+		return (STAT_OK);
+	}
+	return (status);
 }
+#endif // __BINARY_DATA
+
+/*
+ * Batched straight feeds - {"mv":[...]}
+ *
+ * cm_run_mv()          - check a batch of moves and start queuing it
+ * cm_batch_callback()  - main-loop callback that feeds batched moves to the planner
+ * cm_abort_batch()     - drop any batched moves that have not been queued
+ *
+ *	A host can send several straight feeds in one command, e.g. {"mv":[1200,[10,20],[15,25,-1]]}
+ *	Inner arrays are move targets in X,Y,Z,A,B,C order; axes past the end of a target are
+ *	not moved. Targets are interpreted in the current units, distance mode and coordinate
+ *	system the same as a G1. A number sets the feed rate for the moves that follow it, the
+ *	same as an F word - without one the current feed rate is used. In inverse time mode (G93)
+ *	each move needs its own feed rate.
+ *
+ *	The whole batch is checked before any move is queued, and the response value is the
+ *	number of moves. The moves are fed to the planner as buffers free up, which holds off
+ *	the next command the same way an arc does. A move that fails to queue (e.g. soft limits)
+ *	drops the rest of the batch and sends an exception report.
+ */
 
-static void _exec_select_tool(float *value, bool *flag)
+static cmBatch_t mv;
+
+stat_t cm_run_mv(nvObj_t *nv)
 {
-	cm.gm.tool_select = (uint8_t)value[0];
+	if (nv->valuetype != TYPE_ARRAY) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	char *rd = *nv->stringp;
+	char *end;
+	uint8_t count = 0;
+	float feed_rate = 0;						// feed rate for the next move, 0 if none was given
+
+	while (*rd != NUL) {
+		if (*rd == '[') {						// move target
+			if (count == MV_BATCH_MAX) {
+				return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+			}
+			uint8_t axis = 0;
+			for (rd++; *rd != ']'; ) {
+				if (axis == AXES) {
+					return (STAT_INPUT_VALUE_UNSUPPORTED);
+				}
+				mv.target[count][axis++] = strtof(rd, &end);
+				if (end == rd) {
+					return (STAT_BAD_NUMBER_FORMAT);
+				}
+				if (*end == ',') {
+					end++;
+				} else if (*end != ']') {
+					return (STAT_JSON_SYNTAX_ERROR);
+				}
+				rd = end;
+			}
+			rd++;
+			if (fp_ZERO(feed_rate) && ((cm.gm.feed_rate_mode == INVERSE_TIME_MODE) ||
+				((count == 0) && fp_ZERO(cm.gm.feed_rate)))) {
+				return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
+			}
+			mv.axes[count] = axis;
+			for (; axis < AXES; axis++) {
+				mv.target[count][axis] = 0;
+			}
+			mv.feed_rate[count++] = feed_rate;	// a feed rate is set once - it's modal after that
+			feed_rate = 0;
+		} else {								// feed rate
+			feed_rate = strtof(rd, &end);
+			if (end == rd) {
+				return (STAT_BAD_NUMBER_FORMAT);
+			}
+			rd = end;
+		}
+		if (*rd == ',') {
+			rd++;
+		} else if (*rd != NUL) {
+			return (STAT_JSON_SYNTAX_ERROR);
+		}
+	}
+	mv.count = count;
+	mv.next = 0;
+	nv->value = count;							// respond with the number of moves
+	nv->valuetype = TYPE_INT;
+	cm_set_cycle_callback(cm_batch_callback);
+	cm_batch_callback();						// queue what fits now
+	return (STAT_OK);
 }
 
-stat_t cm_change_tool(const uint8_t tool_change)
+stat_t cm_batch_callback()
 {
-	float value[] = { (float)cm.gm.tool_select,0,0,0,0,0 };
-    bool flags[]  = { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_change_tool, value, flags);
+	if (mv.next >= mv.count) {
+		return (STAT_NOOP);
+	}
+	while (mv.next < mv.count) {
+		if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+			return (STAT_EAGAIN);
+		}
+		uint8_t i = mv.next++;
+		bool flags[AXES];
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			flags[axis] = (axis < mv.axes[i]);
+		}
+		stat_t status = STAT_OK;
+		if (fp_NOT_ZERO(mv.feed_rate[i])) {
+			status = cm_set_feed_rate(mv.feed_rate[i]);
+		}
+		if (status == STAT_OK) {
+			status = cm_straight_feed(mv.target[i], flags);
+		}
+		if (status != STAT_OK) {
+			cm_abort_batch();
+			return (rpt_exception(status, "mv"));
+		}
+	}
 	return (STAT_OK);
 }
 
-static void _exec_change_tool(float *value, bool *flag)
+void cm_abort_batch()
 {
-	cm.gm.tool = (uint8_t)value[0];
+	mv.count = 0;
+	mv.next = 0;
 }
 
-/***********************************
- * Miscellaneous Functions (4.3.9) *
- ***********************************/
-// see coolant.cpp/.h
-
 /*
- * cm_message() - queue a RAM string as a message in the response (unconditionally)
- *
- *	Note: If you need to post a FLASH string use pstr2str to convert it to a RAM string
+ * Canned drilling cycles - G81, G82, G83
+ *
+ * cm_drill_cycle()     - check a drilling block and start drilling
+ * cm_drill_callback()  - main-loop callback that feeds the drilling moves to the planner
+ * cm_abort_drill()     - drop any drilling moves that have not been queued
+ *
+ *	The moves for each hole are generated here rather than by the host, and are fed to the
+ *	planner as buffers free up - the same way batched moves are - which holds off the next
+ *	block until the last move of the cycle is queued. For each hole:
+ *
+ *	  - if Z is below the R plane, rapid up to R
+ *	  - rapid in XY to the hole, then rapid down to R
+ *	  - G81: feed to the bottom
+ *	  - G82: feed to the bottom and dwell P seconds
+ *	  - G83: feed down Q at a time. After each peck rapid out to R, then rapid back in to
+ *		DRILL_PECK_CLEARANCE above the depth reached before feeding the next peck
+ *	  - rapid out to R (G99) or to the higher of R and the Z the series started from (G98)
+ *
+ *	R, Z, P and Q are sticky for a series of canned cycles and must be given in the first
+ *	block of the series. In G90 Z and R are absolute and L repeats the cycle at the same hole.
+ *	In G91 R is relative to the starting Z, Z is relative to R, and X and Y are the step to
+ *	each of the L holes. Only the XY plane (G17) is supported.
  */
 
-void cm_message(const char *message)
-{
-    nv_add_string((const char *)"msg", message);	// add message to the response object
+typedef enum {
+	DRILL_CLEAR = 0,					// rapid up to R if below it
+	DRILL_POSITION,						// rapid in XY to the hole
+	DRILL_APPROACH,						// rapid down to R
+	DRILL_FEED,							// feed to the bottom, or the next peck depth
+	DRILL_DWELL,						// G82 dwell at the bottom
+	DRILL_PECK_OUT,						// G83 rapid out to R
+	DRILL_PECK_IN,						// G83 rapid back in to just above the last peck
+	DRILL_RETRACT						// rapid out to R or the starting Z
+} cmDrillStep;
+
+static cmDrill_t dc;
+
+static bool _is_drill_mode(const uint8_t motion_mode)
+{
+	return ((motion_mode >= MOTION_MODE_CANNED_CYCLE_81) && (motion_mode <= MOTION_MODE_CANNED_CYCLE_83));
+}
+
+stat_t cm_drill_cycle(const float target[], const bool target_f[],
+                      const float R_word, const bool R_word_f,
+                      const float P_word, const bool P_word_f,
+                      const float Q_word, const bool Q_word_f,
+                      const uint8_t L_word, const bool L_word_f,
+                      const uint8_t motion_mode)
+{
+	if (!_is_drill_mode(cm.gm.motion_mode)) {		// start of a series of canned cycles
+		dc.clear_z = cm.gmx.position[AXIS_Z];
+		dc.R_word = 0;
+		dc.Z_word = 0;
+		dc.P_word = 0;
+		dc.Q_word = 0;
+		if (!R_word_f) {
+			return (STAT_R_WORD_IS_MISSING);
+		}
+		if (!target_f[AXIS_Z]) {
+			return (STAT_GCODE_AXIS_IS_MISSING);
+		}
+	}
+	cm.gm.motion_mode = motion_mode;
+
+	// a canned cycle with no axis words does nothing, the same as a G1
+	if (!(target_f[AXIS_X] || target_f[AXIS_Y] || target_f[AXIS_Z] || R_word_f)) {
+		return (STAT_OK);
+	}
+	if (cm.gm.select_plane != CANON_PLANE_XY) {
+		return (STAT_GCODE_ACTIVE_PLANE_IS_INVALID);
+	}
+	if (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+		return (STAT_GCODE_INVERSE_TIME_MODE_CANNOT_BE_USED);
+	}
+	if (fp_ZERO(cm.gm.feed_rate)) {
+		return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
+	}
+	if (L_word_f && (L_word == 0)) {
+		return (STAT_L_WORD_IS_INVALID);
+	}
+	if (R_word_f) { dc.R_word = R_word; }
+	if (target_f[AXIS_Z]) { dc.Z_word = target[AXIS_Z]; }
+	if (P_word_f) { dc.P_word = P_word; }
+	if (Q_word_f) { dc.Q_word = Q_word; }
+
+	if (dc.P_word < 0) {
+		return (STAT_P_WORD_IS_NEGATIVE);
+	}
+	if (motion_mode == MOTION_MODE_CANNED_CYCLE_83) {
+		if (fp_ZERO(dc.Q_word)) {
+			return (STAT_Q_WORD_IS_MISSING);
+		}
+		if (dc.Q_word < 0) {
+			return (STAT_Q_WORD_IS_INVALID);
+		}
+	}
+
+	// resolve the cycle to machine coordinates in mm
+	float z = cm.gmx.position[AXIS_Z];
+	if (cm.gm.distance_mode == ABSOLUTE_MODE) {
+		dc.r_plane = cm_get_active_coord_offset(AXIS_Z) + _to_millimeters(dc.R_word);
+		dc.bottom = cm_get_active_coord_offset(AXIS_Z) + _to_millimeters(dc.Z_word);
+		for (uint8_t axis=AXIS_X; axis<=AXIS_Y; axis++) {
+			dc.hole[axis] = target_f[axis] ? cm_get_active_coord_offset(axis) + _to_millimeters(target[axis])
+			                               : cm.gmx.position[axis];
+			dc.increment[axis] = 0;
+		}
+	} else {
+		dc.r_plane = z + _to_millimeters(dc.R_word);
+		dc.bottom = dc.r_plane + _to_millimeters(dc.Z_word);
+		for (uint8_t axis=AXIS_X; axis<=AXIS_Y; axis++) {
+			dc.increment[axis] = target_f[axis] ? _to_millimeters(target[axis]) : 0;
+			dc.hole[axis] = cm.gmx.position[axis] + dc.increment[axis];
+		}
+	}
+	if (dc.bottom > dc.r_plane) {
+		return (STAT_R_WORD_IS_INVALID);				// R plane must not be below the bottom
+	}
+	dc.peck = _to_millimeters(dc.Q_word);
+	dc.dwell = dc.P_word;
+	dc.depth = dc.r_plane;
+	dc.holes = L_word_f ? L_word : 1;
+	dc.step = DRILL_CLEAR;
+	dc.motion_mode = motion_mode;
+	cm_set_cycle_callback(cm_drill_callback);
+	cm_drill_callback();							// queue what fits now
+	return (STAT_OK);
 }
 
 /*
- * cm_override_enables() - M48, M49
- * cm_feed_rate_override_enable() - M50
- * cm_feed_rate_override_factor() - M50.1
- * cm_traverse_override_enable() - M50.2
- * cm_traverse_override_factor() - M50.3
- * cm_spindle_override_enable() - M51       (see spindle.c)
- * cm_spindle_override_factor() - M51.1     (see spindle.c)
+ * _drill_move() - queue one move of the cycle to a machine position in mm
  *
- *	Override enables are kind of a mess in Gcode. This is an attempt to sort them out.
- *	See http://www.linuxcnc.org/docs/2.4/html/gcode_main.html#sec:M50:-Feed-Override
+ *	The move goes in as a G0 or G1 so it plans and reports as one. The motion mode is put
+ *	back to the canned cycle afterwards.
  */
-/*
-stat_t cm_override_enables(uint8_t flag)			// M48, M49
-{
-	cm.gmx.feed_rate_override_enable = flag;
-	cm.gmx.traverse_override_enable = flag;
-	spindle.override_enable = flag;
-	return (STAT_OK);
-}
 
-stat_t cm_feed_rate_override_enable(uint8_t flag)	// M50
-{
-	if (cm.gf.parameter && fp_ZERO(cm.gn.parameter)) {
-		cm.gmx.feed_rate_override_enable = false;
-	} else {
-		cm.gmx.feed_rate_override_enable = true;
+static stat_t _drill_move(const uint8_t motion_mode, const float x, const float y, const float z)
+{
+	cm.gm.motion_mode = motion_mode;
+	copy_vector(cm.gm.target, cm.gmx.position);
+	cm.gm.target[AXIS_X] = x;
+	cm.gm.target[AXIS_Y] = y;
+	cm.gm.target[AXIS_Z] = z;
+	ritorno (cm_test_soft_limits(cm.gm.target));	// soft limits cancel the motion mode
+	cm_set_work_offsets(&cm.gm);
+	cm_cycle_start();
+	stat_t status = mp_aline(&cm.gm);
+	cm_finalize_move();
+	cm.gm.motion_mode = dc.motion_mode;
+	if (status == STAT_MINIMUM_LENGTH_MOVE) {
+		if (!mp_has_runnable_buffer()) {
+			cm_cycle_end();
+		}
+		return (STAT_OK);
 	}
-	return (STAT_OK);
+	return (status);
 }
 
-stat_t cm_feed_rate_override_factor(uint8_t flag)	// M50.1
+static stat_t _drill_step()
 {
-	cm.gmx.feed_rate_override_enable = flag;
-	cm.gmx.feed_rate_override_factor = cm.gn.parameter;
-//	mp_feed_rate_override(flag, cm.gn.parameter);	// replan the queue for new feed rate
-	return (STAT_OK);
+	float *position = cm.gmx.position;
+
+	switch (dc.step++) {
+		case DRILL_CLEAR: {
+			if (position[AXIS_Z] < dc.r_plane) {
+				return (_drill_move(MOTION_MODE_STRAIGHT_TRAVERSE, position[AXIS_X], position[AXIS_Y], dc.r_plane));
+			}
+			return (STAT_NOOP);
+		}
+		case DRILL_POSITION: {
+			return (_drill_move(MOTION_MODE_STRAIGHT_TRAVERSE, dc.hole[AXIS_X], dc.hole[AXIS_Y], position[AXIS_Z]));
+		}
+		case DRILL_APPROACH: {
+			dc.depth = dc.r_plane;
+			return (_drill_move(MOTION_MODE_STRAIGHT_TRAVERSE, dc.hole[AXIS_X], dc.hole[AXIS_Y], dc.r_plane));
+		}
+		case DRILL_FEED: {
+			if (dc.motion_mode == MOTION_MODE_CANNED_CYCLE_83) {
+				dc.depth = max(dc.depth - dc.peck, dc.bottom);
+				if (dc.depth > dc.bottom) {
+					dc.step = DRILL_PECK_OUT;
+				} else {
+					dc.step = DRILL_RETRACT;
+				}
+			} else {
+				dc.depth = dc.bottom;
+				if (dc.motion_mode != MOTION_MODE_CANNED_CYCLE_82) {
+					dc.step = DRILL_RETRACT;
+				}
+			}
+			return (_drill_move(MOTION_MODE_STRAIGHT_FEED, dc.hole[AXIS_X], dc.hole[AXIS_Y], dc.depth));
+		}
+		case DRILL_DWELL: {
+			dc.step = DRILL_RETRACT;
+			if (fp_ZERO(dc.dwell)) {
+				return (STAT_NOOP);
+			}
+			return (cm_dwell(dc.dwell));
+		}
+		case DRILL_PECK_OUT: {
+			return (_drill_move(MOTION_MODE_STRAIGHT_TRAVERSE, dc.hole[AXIS_X], dc.hole[AXIS_Y], dc.r_plane));
+		}
+		case DRILL_PECK_IN: {
+			dc.step = DRILL_FEED;
+			float z = min(dc.depth + DRILL_PECK_CLEARANCE, dc.r_plane);
+			return (_drill_move(MOTION_MODE_STRAIGHT_TRAVERSE, dc.hole[AXIS_X], dc.hole[AXIS_Y], z));
+		}
+		case DRILL_RETRACT: {
+			float z = dc.r_plane;
+			if (cm.gmx.retract_mode == RETRACT_TO_CLEAR_Z) {
+				z = max(z, dc.clear_z);
+			}
+			stat_t status = _drill_move(MOTION_MODE_STRAIGHT_TRAVERSE, dc.hole[AXIS_X], dc.hole[AXIS_Y], z);
+			if (--dc.holes > 0) {						// on to the next hole
+				dc.hole[AXIS_X] += dc.increment[AXIS_X];
+				dc.hole[AXIS_Y] += dc.increment[AXIS_Y];
+				dc.step = DRILL_POSITION;
+			}
+			return (status);
+		}
+		default: {
+			dc.holes = 0;
+			return (STAT_NOOP);
+		}
+	}
 }
 
-stat_t cm_traverse_override_enable(uint8_t flag)	// M50.2
+stat_t cm_drill_callback()
 {
-	if (cm.gf.parameter && fp_ZERO(cm.gn.parameter)) {
-		cm.gmx.traverse_override_enable = false;
-	} else {
-		cm.gmx.traverse_override_enable = true;
+	if (dc.holes == 0) {
+		return (STAT_NOOP);
+	}
+	while (dc.holes > 0) {
+		if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+			return (STAT_EAGAIN);
+		}
+		stat_t status = _drill_step();
+		if ((status != STAT_OK) && (status != STAT_NOOP)) {
+			cm_abort_drill();
+			return (rpt_exception(status, "drill"));
+		}
 	}
 	return (STAT_OK);
 }
 
-stat_t cm_traverse_override_factor(uint8_t flag)	// M51
+void cm_abort_drill()
 {
-	cm.gmx.traverse_override_enable = flag;
+	dc.holes = 0;
+}
+
+#ifdef __THREADING
+/*
+ * Spindle synchronized motion - G33, G33.1
+ *
+ * cm_spindle_sync_feed() - G33: feed locked to the spindle at K per revolution
+ * cm_rigid_tap()         - G33.1: feed Z to the bottom locked to the spindle, reverse it and come back out
+ *
+ *	The spindle position comes from a once per revolution index on an input set to function
+ *	4 (see spindle_index_pulse()). The move is planned as a feed at K times the programmed S,
+ *	then the exec runs it at the speed the index measures and corrects the position so the
+ *	tool goes K per revolution - see _get_sync_time() in plan_exec.cpp. F and the feed
+ *	override are not used. K is in the current units.
+ *
+ *	The first move of a thread starts from rest and waits for the index, so every pass of a
+ *	thread starts at the same spindle angle. G33 moves that follow on are one continuous
+ *	thread - tapers and multi-segment threads. A stop of any kind between them (a command,
+ *	a dwell, a feedhold) ends the thread; a feedhold in a thread ruins it.
+ *
+ *	G33.1 takes only Z - position in XY first. It feeds to Z, reverses the spindle (a queued
+ *	command, so motion stops), feeds back out to the Z it started from and restores the
+ *	spindle direction. The index can't tell which way the spindle turns, so the retract locks
+ *	on from the spindle angle after the reversal and the overrun while the spindle stops
+ *	isn't followed. Use a tension/compression tap holder.
+ */
+
+static stat_t _check_spindle_sync(const float K_word, const bool K_word_f, float *pitch)
+{
+	if (!spindle_index_is_configured()) {
+		return (STAT_SPINDLE_INDEX_NOT_CONFIGURED);
+	}
+	if ((spindle.enable != SPINDLE_ON) || (spindle.programmed_speed <= 0)) {
+		return (STAT_SPINDLE_MUST_BE_TURNING);
+	}
+	if (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+		return (STAT_GCODE_INVERSE_TIME_MODE_CANNOT_BE_USED);
+	}
+	if (!K_word_f) {
+		return (STAT_K_WORD_IS_MISSING);
+	}
+	if (K_word <= 0) {
+		return (STAT_K_WORD_IS_INVALID);
+	}
+	*pitch = _to_millimeters(K_word);
+	return (STAT_OK);
+}
+
+/*
+ * _spindle_sync_move() - queue a synchronized move to cm.gm.target
+ *
+ *	A negative pitch marks the G33.1 retract for the exec. The feed for planning has to be
+ *	inside the axis limits or the exec could never keep up with the spindle.
+ */
+static stat_t _spindle_sync_move(const float pitch)
+{
+	float feed_rate = fabs(pitch) * spindle.programmed_speed;
+	float length = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		length += square(cm.gm.target[axis] - cm.gmx.position[axis]);
+	}
+	length = sqrt(length);
+	if (fp_ZERO(length)) {
+		return (STAT_OK);
+	}
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (feed_rate * fabs(cm.gm.target[axis] - cm.gmx.position[axis]) / length > cm.a[axis].feedrate_max) {
+			return (STAT_REQUESTED_VELOCITY_EXCEEDS_LIMITS);
+		}
+	}
+	ritorno (cm_test_soft_limits(cm.gm.target));
+
+	float feed_rate_saved = cm.gm.feed_rate;
+	float parameter_saved = cm.gm.parameter;
+	cm.gm.motion_mode = MOTION_MODE_SPINDLE_SYNC;
+	cm.gm.feed_rate = feed_rate;
+	cm.gm.parameter = pitch;							// the exec takes the pitch from P
+	cm_set_work_offsets(&cm.gm);
+	cm_cycle_start();
+	stat_t status = mp_aline(&cm.gm);
+	cm_finalize_move();
+	cm.gm.feed_rate = feed_rate_saved;
+	cm.gm.parameter = parameter_saved;
+
+	if (status == STAT_MINIMUM_LENGTH_MOVE) {
+		if (!mp_has_runnable_buffer()) {
+			cm_cycle_end();
+		}
+		return (STAT_OK);
+	}
+	return (status);
+}
+
+stat_t cm_spindle_sync_feed(const float target[], const bool target_f[], const float K_word, const bool K_word_f)
+{
+	float pitch;
+	ritorno (_check_spindle_sync(K_word, K_word_f, &pitch));
+	cm.gm.motion_mode = MOTION_MODE_SPINDLE_SYNC;
+
+	if (!(target_f[AXIS_X] || target_f[AXIS_Y] || target_f[AXIS_Z] ||
+		  target_f[AXIS_A] || target_f[AXIS_B] || target_f[AXIS_C])) {
+		return (STAT_OK);
+	}
+	cm_set_model_target(target, target_f);
+	return (_spindle_sync_move(pitch));
+}
+
+stat_t cm_rigid_tap(const float target[], const bool target_f[], const float K_word, const bool K_word_f)
+{
+	float pitch;
+	ritorno (_check_spindle_sync(K_word, K_word_f, &pitch));
+	cm.gm.motion_mode = MOTION_MODE_RIGID_TAP;
+
+	if (!target_f[AXIS_Z]) {
+		return (STAT_GCODE_AXIS_IS_MISSING);
+	}
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((axis != AXIS_Z) && target_f[axis]) {
+			return (STAT_GCODE_AXIS_IS_INVALID);
+		}
+	}
+	float start_z = cm.gmx.position[AXIS_Z];
+	cmSpindleDir direction = spindle.direction;
+	cm_set_model_target(target, target_f);
+	if (fp_EQ(cm.gm.target[AXIS_Z], start_z)) {
+		return (STAT_OK);
+	}
+	ritorno (_spindle_sync_move(pitch));				// in
+	cm_spindle_control((direction == SPINDLE_CW) ? SPINDLE_CONTROL_CCW : SPINDLE_CONTROL_CW);
+	copy_vector(cm.gm.target, cm.gmx.position);
+	cm.gm.target[AXIS_Z] = start_z;
+	stat_t status = _spindle_sync_move(-pitch);		// out
+	cm_spindle_control((direction == SPINDLE_CW) ? SPINDLE_CONTROL_CW : SPINDLE_CONTROL_CCW);
+	cm.gm.motion_mode = MOTION_MODE_RIGID_TAP;
+	return (status);
+}
+#endif // __THREADING
+
+/*****************************
+ * Spindle Functions (4.3.7) *
+ *****************************/
+// see spindle.cpp/.h
+
+/**************************
+ * Tool Functions (4.3.8) *
+ **************************/
+/*
+ * cm_select_tool()		- T parameter
+ *
+ * cm_change_tool()		- M6 (This might become a complete tool change cycle)
+ * _exec_change_tool()	- execution callback
+ *
+ *	T only selects the next tool, so it needs no motion sync. It's set in the model and
+ *	rides to the runtime in the Gcode context of the blocks that follow - no planner buffer
+ *	and no stop. M6 is queued as a command and stops, as the tool really changes there.
+ *	It takes the tool selected in the model, so T and M6 work in the same or different blocks.
+ *
+ * Note: These functions don't actually do anything for now
+ */
+stat_t cm_select_tool(const uint8_t tool_select)
+{
+	cm.gm.tool_select = tool_select;
+	return (STAT_OK);
+}
+
+stat_t cm_change_tool(const uint8_t tool_change)
+{
+	float value[] = { (float)cm.gm.tool_select,0,0,0,0,0 };
+    bool flags[]  = { 1,0,0,0,0,0 };
+	mp_queue_stop_command(_exec_change_tool, value, flags);
+	return (STAT_OK);
+}
+
+static void _exec_change_tool(float *value, bool *flag)
+{
+	cm.gm.tool = (uint8_t)value[0];
+}
+
+/***********************************
+ * Miscellaneous Functions (4.3.9) *
+ ***********************************/
+// see coolant.cpp/.h
+
+/*
+ * cm_message() - queue a RAM string as a message in the response (unconditionally)
+ *
+ *	Note: If you need to post a FLASH string use pstr2str to convert it to a RAM string
+ */
+
+void cm_message(const char *message)
+{
+    nv_add_string((const char *)"msg", message);	// add message to the response object
+}
+
+#ifdef __MOTION_OUTPUTS
+/*
+ * cm_output_control() - M62, M63, M64, M65 P<output> [Q<distance>]
+ *
+ *	M62 turns output P on and M63 off as the next move starts, or Q along the path from there
+ *	without stopping at that point. M64 and M65 switch it in queue order, between the moves
+ *	either side of them without stopping. See Synchronized outputs in gpio.cpp.
+ */
+stat_t cm_output_control(const uint8_t mcode, const float P_word, const bool P_word_f,
+                         const float Q_word, const bool Q_word_f)
+{
+	if (!P_word_f) {
+		return (STAT_P_WORD_IS_MISSING);
+	}
+	if (fp_NE(P_word, trunc(P_word))) {
+		return (STAT_P_WORD_IS_NOT_AN_INTEGER);
+	}
+	if ((P_word < 1) || (P_word > DO_CHANNELS) || !gpio_output_is_configured((uint8_t)P_word)) {
+		return (STAT_P_WORD_IS_INVALID);
+	}
+	uint8_t output = (uint8_t)P_word;
+	bool state = ((mcode == 62) || (mcode == 64));
+	if (mcode >= 64) {
+		gpio_queue_output(output, state);
+		return (STAT_OK);
+	}
+	float distance = 0;
+	if (Q_word_f) {
+		if (Q_word < 0) {
+			return (STAT_Q_WORD_IS_INVALID);
+		}
+		distance = _to_millimeters(Q_word);
+	}
+	return (gpio_queue_output_event(output, state, distance));
+}
+#endif
+
+/*
+ * cm_override_enables() - M48, M49
+ * cm_feed_rate_override_enable() - M50
+ * cm_feed_rate_override_factor() - M50.1
+ * cm_traverse_override_enable() - M50.2
+ * cm_traverse_override_factor() - M50.3
+ * cm_spindle_override_enable() - M51       (see spindle.c)
+ * cm_spindle_override_factor() - M51.1     (see spindle.c)
+ *
+ *	Override enables are kind of a mess in Gcode. This is an attempt to sort them out.
+ *	See http://www.linuxcnc.org/docs/2.4/html/gcode_main.html#sec:M50:-Feed-Override
+ */
+/*
+stat_t cm_override_enables(uint8_t flag)			// M48, M49
+{
+	cm.gmx.feed_rate_override_enable = flag;
+	cm.gmx.traverse_override_enable = flag;
+	spindle.override_enable = flag;
+	return (STAT_OK);
+}
+
+stat_t cm_feed_rate_override_enable(uint8_t flag)	// M50
+{
+	if (cm.gf.parameter && fp_ZERO(cm.gn.parameter)) {
+		cm.gmx.feed_rate_override_enable = false;
+	} else {
+		cm.gmx.feed_rate_override_enable = true;
+	}
+	return (STAT_OK);
+}
+
+stat_t cm_feed_rate_override_factor(uint8_t flag)	// M50.1
+{
+	cm.gmx.feed_rate_override_enable = flag;
+	cm.gmx.feed_rate_override_factor = cm.gn.parameter;
+//	mp_feed_rate_override(flag, cm.gn.parameter);	// replan the queue for new feed rate
+	return (STAT_OK);
+}
+
+stat_t cm_traverse_override_enable(uint8_t flag)	// M50.2
+{
+	if (cm.gf.parameter && fp_ZERO(cm.gn.parameter)) {
+		cm.gmx.traverse_override_enable = false;
+	} else {
+		cm.gmx.traverse_override_enable = true;
+	}
+	return (STAT_OK);
+}
+
+stat_t cm_traverse_override_factor(uint8_t flag)	// M51
+{
+	cm.gmx.traverse_override_enable = flag;
 	cm.gmx.traverse_override_factor = cm.gn.parameter;
 //	mp_feed_rate_override(flag, cm.gn.parameter);	// replan the queue for new feed rate
 	return (STAT_OK);
 }
 */
 
+/*
+ * cm_get_override_factor() - override factor for a move of this motion mode
+ * cm_request_override()    - realtime override characters (see xio.h)
+ *
+ *	Overrides are applied in real time. The exec scales the time base of the running move by
+ *	the factor and the queued blocks are replanned for it in the background - see
+ *	mp_replan_overrides(). cm_request_override() is called from the fast lane so it only sets
+ *	the factor and flags the planner.
+ */
+
+float cm_get_override_factor(const uint8_t motion_mode)
+{
+	if (motion_mode == MOTION_MODE_SPINDLE_SYNC) {
+		return (1.0);								// the spindle sets the pace - see cm_spindle_sync_feed()
+	}
+	if (motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+		return (cm.gmx.traverse_override_enable ? cm.gmx.traverse_override_factor : 1.0);
+	}
+	if (!cm.gmx.feed_rate_override_enable) {
+		return (1.0);
+	}
+#ifdef __ANALOG_INPUTS
+	float factor = cm.gmx.feed_rate_override_factor * cm.load_feed_factor;	// see cm_load_feed_callback()
+	return (max(FEED_OVERRIDE_MIN, min(FEED_OVERRIDE_MAX, factor)));
+#else
+	return (cm.gmx.feed_rate_override_factor);
+#endif
+}
+
+static void _set_override(float *factor, const float value, const float max_factor)
+{
+	*factor = max(FEED_OVERRIDE_MIN, min(max_factor, value));
+	mp_request_override_replan();
+}
+
+void cm_request_override(const char c)
+{
+	float *mfo = &cm.gmx.feed_rate_override_factor;
+	float *mto = &cm.gmx.traverse_override_factor;
+
+	switch (c) {
+		case CHAR_FEED_OVR_RESET:		{ _set_override(mfo, 1.0, FEED_OVERRIDE_MAX); break; }
+		case CHAR_FEED_OVR_PLUS:		{ _set_override(mfo, *mfo + 0.10, FEED_OVERRIDE_MAX); break; }
+		case CHAR_FEED_OVR_MINUS:		{ _set_override(mfo, *mfo - 0.10, FEED_OVERRIDE_MAX); break; }
+		case CHAR_FEED_OVR_FINE_PLUS:	{ _set_override(mfo, *mfo + 0.01, FEED_OVERRIDE_MAX); break; }
+		case CHAR_FEED_OVR_FINE_MINUS:	{ _set_override(mfo, *mfo - 0.01, FEED_OVERRIDE_MAX); break; }
+		case CHAR_TRAV_OVR_RESET:		{ _set_override(mto, 1.0, TRAVERSE_OVERRIDE_MAX); break; }
+		case CHAR_TRAV_OVR_HALF:		{ _set_override(mto, 0.50, TRAVERSE_OVERRIDE_MAX); break; }
+		case CHAR_TRAV_OVR_QUARTER:		{ _set_override(mto, 0.25, TRAVERSE_OVERRIDE_MAX); break; }
+		default: return;
+	}
+	sr_request_status_report(SR_REQUEST_TIMED);
+}
+
+/*
+ * cm_stall_detection_callback() - slow the feed while a motor can't keep up
+ *
+ *	Runs every STALL_CHECK_MS on the largest following error the step correction saw since
+ *	the last check (see st_get_following_error_peak()). It works through the feed override,
+ *	the same as M50.1 and the realtime override characters:
+ *
+ *	  - over $few and growing: take $fes off the feed override
+ *	  - over $few and already at FEED_OVERRIDE_MIN (or overrides are off): alarm - slowing
+ *		down hasn't helped, so stop before the part is scrapped
+ *	  - back under half of $few: give the feed back, $fes per check, up to where it was
+ *
+ *	An error that stays over $few without growing holds the feed where it is.
+ */
+
+stat_t cm_stall_detection_callback()
+{
+	float error = st_get_following_error_peak();
+
+	if (fp_ZERO(cm.stall_warning) || (cm_is_alarmed() != STAT_OK)) {
+		cm.stall_error = 0;
+		return (STAT_NOOP);
+	}
+	float *mfo = &cm.gmx.feed_rate_override_factor;
+	float prev_factor = *mfo;
+
+	if (error > cm.stall_warning) {
+		if (error > cm.stall_error) {
+			if (!cm.gmx.feed_rate_override_enable || (*mfo - cm.stall_feed_step < FEED_OVERRIDE_MIN)) {
+				_set_override(mfo, *mfo + cm.stall_reduction, FEED_OVERRIDE_MAX);
+				cm.stall_reduction = 0;
+				cm.stall_error = 0;
+				return (cm_alarm(STAT_FOLLOWING_ERROR_EXCEEDED, "stall"));
+			}
+			_set_override(mfo, *mfo - cm.stall_feed_step, FEED_OVERRIDE_MAX);
+			cm.stall_reduction += prev_factor - *mfo;
+			sr_request_status_report(SR_REQUEST_TIMED);
+		}
+	} else if ((error < cm.stall_warning/2) && (cm.stall_reduction > EPSILON)) {
+		_set_override(mfo, *mfo + min(cm.stall_feed_step, cm.stall_reduction), FEED_OVERRIDE_MAX);
+		cm.stall_reduction = max(0.0f, cm.stall_reduction - (*mfo - prev_factor));
+		sr_request_status_report(SR_REQUEST_TIMED);
+	}
+	cm.stall_error = error;
+	return (STAT_OK);
+}
+
+#ifdef __ANALOG_INPUTS
+/*
+ * cm_load_feed_callback() - adaptive feed: hold the spindle load by scaling the feed
+ *
+ *	Runs every LOAD_FEED_CHECK_MS while $lfi names an analog input. The input reads the
+ *	spindle load - the drive's current sense or a current transformer on its supply, scaled
+ *	with $aiNsc and $aiNof - and the factor is integrated from the relative load error:
+ *
+ *		factor += $lfg * ($lft - load) / $lft * dt,		held between $lfm and $lfx
+ *
+ *	The factor multiplies the feed override (see cm_get_override_factor()), so the exec
+ *	takes it up within a segment or two and the queued blocks are replanned for it once it has
+ *	moved by LOAD_FEED_REPLAN. It doesn't touch traverses, synchronized moves or M49.
+ *
+ *	The factor only integrates while a feed move is running with the spindle on; it holds
+ *	through traverses and holds, and goes back to 1 when the cycle ends. A load still over
+ *	LOAD_FEED_OVERLOAD x $lft with the factor down at $lfm alarms rather than push on into a
+ *	tool that's about to break.
+ */
+
+static void _set_load_feed_factor(const float factor)
+{
+	cm.load_feed_factor = factor;
+	if (fabs(factor - cm.load_feed_planned) > LOAD_FEED_REPLAN) {
+		cm.load_feed_planned = factor;
+		mp_request_override_replan();
+		sr_request_status_report(SR_REQUEST_TIMED);
+	}
+}
+
+stat_t cm_load_feed_callback()
+{
+	if ((cm.load_feed_input == 0) || (cm_is_alarmed() != STAT_OK) || (cm.cycle_state == CYCLE_OFF)) {
+		if (fabs(cm.load_feed_factor - 1.0) > EPSILON) {
+			cm.load_feed_factor = 1.0;
+			cm.load_feed_planned = 1.0;
+			mp_request_override_replan();
+		}
+		return (STAT_NOOP);
+	}
+	if ((cm.motion_state == MOTION_STOP) || (cm.motion_state == MOTION_HOLD) || (spindle.enable == SPINDLE_OFF) ||
+		(cm_get_motion_mode(RUNTIME) == MOTION_MODE_STRAIGHT_TRAVERSE) ||
+		(cm_get_motion_mode(RUNTIME) == MOTION_MODE_SPINDLE_SYNC)) {
+		return (STAT_NOOP);								// not cutting - hold the factor
+	}
+	float load = gpio_read_analog(cm.load_feed_input);
+	if ((load > cm.load_feed_target * LOAD_FEED_OVERLOAD) && (cm.load_feed_factor <= cm.load_feed_min)) {
+		_set_load_feed_factor(1.0);
+		return (cm_alarm(STAT_SPINDLE_OVERLOADED, "adaptive feed"));
+	}
+	float error = (cm.load_feed_target - load) / cm.load_feed_target;
+	float factor = cm.load_feed_factor + cm.load_feed_gain * error * (LOAD_FEED_CHECK_MS / 1000.0);
+	_set_load_feed_factor(max(cm.load_feed_min, min(cm.load_feed_max, factor)));
+	return (STAT_OK);
+}
+
+stat_t cm_set_lfi(nvObj_t *nv)
+{
+	if ((nv->value < 0) || (nv->value > AI_CHANNELS)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	return (set_ui8(nv));
+}
+
+/*
+ * cm_set_lft() - the target load divides the error, so it can't be 0
+ * cm_set_lfm() - the factor is held between $lfm and $lfx, so $lfm can't be over $lfx
+ * cm_set_lfx() - ...or $lfx under $lfm. $lfx is only 0 before it's first set (see _set_defa())
+ */
+stat_t cm_set_lft(nvObj_t *nv)
+{
+	if (nv->value <= 0) {
+		return (STAT_INPUT_VALUE_TOO_SMALL);
+	}
+	return (set_flt(nv));
+}
+
+stat_t cm_set_lfm(nvObj_t *nv)
+{
+	if (nv->value <= 0) {
+		return (STAT_INPUT_VALUE_TOO_SMALL);
+	}
+	if ((cm.load_feed_max > 0) && (nv->value > cm.load_feed_max)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	return (set_flt(nv));
+}
+
+stat_t cm_set_lfx(nvObj_t *nv)
+{
+	if ((nv->value <= 0) || (nv->value < cm.load_feed_min)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	return (set_flt(nv));
+}
+
+stat_t cm_get_lfo(nvObj_t *nv)
+{
+	nv->value = cm.load_feed_factor;
+	nv->precision = (int8_t)GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+#endif // __ANALOG_INPUTS
+
+#ifdef __TANGENTIAL_KNIFE
+/*
+ * cm_set_tna() - set the rotary axis that follows the XY direction - see _tangent_knife()
+ */
+
+stat_t cm_set_tna(nvObj_t *nv)
+{
+	if ((nv->value < 0) || (nv->value > AXIS_C - AXIS_Z)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	return (set_ui8(nv));
+}
+#endif // __TANGENTIAL_KNIFE
+
+#ifdef __TORCH_HEIGHT
+/*
+ * cm_set_thi() - set the arc voltage input of the torch height control - see _thc_segment()
+ * cm_get_tho() - get the Z correction the torch height control is holding now
+ */
+
+stat_t cm_set_thi(nvObj_t *nv)
+{
+	if ((nv->value < 0) || (nv->value > AI_CHANNELS)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	return (set_ui8(nv));
+}
+
+stat_t cm_get_tho(nvObj_t *nv)
+{
+	nv->value = mr.thc_offset;
+	nv->precision = (int8_t)GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+#endif // __TORCH_HEIGHT
+
+#ifdef __PATH_RETRACE
+/*
+ * cm_set_rtr() - back up this many mm along the path run last - see mp_retrace_start()
+ * cm_get_rtr() - get the distance backed up along the path
+ *
+ *	Only taken in a feedhold that has come to rest, and not once a cycle start or queue
+ *	flush has been asked for.
+ */
+
+stat_t cm_set_rtr(nvObj_t *nv)
+{
+	if (nv->value <= 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	if ((cm.hold_state != FEEDHOLD_HOLD) || (cm.queue_flush_state != FLUSH_OFF) ||
+		cm.end_hold_requested || !mp_runtime_is_idle()) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	return (mp_retrace_start(nv->value));
+}
+
+stat_t cm_get_rtr(nvObj_t *nv)
+{
+	nv->value = mp_retrace_get_distance();
+	nv->precision = (int8_t)GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+#endif // __PATH_RETRACE
+
 /************************************************
  * Feedhold and Related Functions (no NIST ref) *
  ************************************************/
@@ -1394,6 +2518,15 @@ stat_t cm_traverse_override_factor(uint8_t flag)	// M51
  *      after the current move segment is finished (< 5 ms later). (Cases handled by
  *      feedhold processing are listed in plan_exec.c).
  *
+ *    - A FEEDHOLD_REQUESTED seen by mp_exec_aline() while a move is running is started
+ *      right there on the segment boundary, so hold latency does not depend on when the
+ *      main loop gets to cm_feedhold_sequencing_callback(). The callback still runs the
+ *      spindle and coolant pause (hold_pause_pending) which can't be done from the exec.
+ *
+ *    - The exec measures the hold: request to start of deceleration (fhl), the planned
+ *      tail length travelled while decelerating (fhd) and the time until the motors have
+ *      stopped (fht). A status report is sent when the hold is reached.
+ *
  *    - FEEDHOLD_SYNC causes the current move in mr to be replanned into a deceleration.
  *      If the distance remaining in the executing move is sufficient for a full deceleration
  *      then motion will stop in the current block. Otherwise the deceleration phase
@@ -1450,6 +2583,7 @@ stat_t cm_traverse_override_factor(uint8_t flag)	// M51
 void cm_request_feedhold(void) {
     // honor request if not already in a feedhold and you are moving
     if ((cm.hold_state == FEEDHOLD_OFF) && (cm.motion_state != MOTION_STOP)) {
+        cm.hold_request_cycles = hw_get_cycles();
         cm.hold_state = FEEDHOLD_REQUESTED;
     }
 }
@@ -1478,11 +2612,22 @@ stat_t cm_feedhold_sequencing_callback()
 	if (cm.hold_state == FEEDHOLD_REQUESTED) {
 		cm_start_hold();                            // feed won't run unless the machine is moving
 	}
+	if (cm.hold_pause_pending) {                    // hold was started by the exec or an interrupt
+		cm.hold_pause_pending = false;
+        cm_spindle_optional_pause(spindle.pause_on_hold);   // pause if this option is selected
+        cm_coolant_optional_pause(coolant.pause_on_hold);   // pause if this option is selected
+	}
 	if (cm.queue_flush_state == FLUSH_REQUESTED) {
         cm_queue_flush();                           // queue flush won't run until runtime is idle
 	}
 	if (cm.end_hold_requested) {
         if (cm.queue_flush_state == FLUSH_OFF) {    // either no flush or wait until it's done flushing
+#ifdef __PATH_RETRACE
+            if (mp_retrace_is_active()) {           // return along the path to where the hold stopped first
+                mp_retrace_forward();
+                return (STAT_OK);
+            }
+#endif
 			cm_end_hold();
 		}
 	}
@@ -1494,6 +2639,12 @@ stat_t cm_feedhold_sequencing_callback()
  * cm_start_hold() - start a feedhhold by signalling the exec
  * cm_end_hold()   - end a feedhold by returning the system to normal operation
  * cm_queue_flush() - Flush planner queue and correct model positions
+ *
+ *	The flush runs as soon as the runtime is idle. The runtime position is where the hold
+ *	left the machine, so it's copied to the model and planner in one pass and the steps are
+ *	set from it once. Flushing the planner only clears the buffers that were queued - see
+ *	mp_flush_planner(). When it's done a status report goes out at once, so the host sees
+ *	the machine is ready without polling for it.
  */
 bool cm_has_hold()
 {
@@ -1503,10 +2654,12 @@ bool cm_has_hold()
 void cm_start_hold()
 {
     if (mp_has_runnable_buffer()) {                         // meaning there's something running
-        cm_spindle_optional_pause(spindle.pause_on_hold);   // pause if this option is selected
-        cm_coolant_optional_pause(coolant.pause_on_hold);   // pause if this option is selected
+        if (cm.hold_state != FEEDHOLD_REQUESTED) {
+            cm.hold_request_cycles = hw_get_cycles();       // direct calls (e.g. from switch interrupts)
+        }
         cm_set_motion_state(MOTION_HOLD);
         cm.hold_state = FEEDHOLD_SYNC;	                    // invokes hold from aline execution
+        cm.hold_pause_pending = true;                       // spindle and coolant pause run from the callback
     }
 }
 
@@ -1538,16 +2691,27 @@ void cm_end_hold()
 void cm_queue_flush()
 {
 	if (mp_runtime_is_idle()) {                     // can't flush planner during movement
+#ifdef __PATH_RETRACE
+        mp_retrace_abandon();                       // the machine stays where a retrace left it
+#endif
         mp_flush_planner();
+#ifdef __TORCH_HEIGHT
+        mp_set_runtime_position(AXIS_Z, mr.position[AXIS_Z] + mr.thc_offset); // keep the torch height correction, now as position
+#endif
 
-        for (uint8_t axis = AXIS_X; axis < AXES; axis++) { // set all positions
-            cm_set_position(axis, mp_get_runtime_absolute_position(axis));
+        for (uint8_t axis = AXIS_X; axis < AXES; axis++) { // set all positions to the runtime's
+            float position = mp_get_runtime_absolute_position(axis);
+            cm.gmx.position[axis] = position;
+            cm.gm.target[axis] = position;
+            mp_set_planner_position(axis, position);
         }
+        mp_set_steps_to_runtime_position();
 	    if(cm.hold_state == FEEDHOLD_HOLD) {        // end feedhold if we're in one
     	    cm_end_hold();
 	    }
         cm.queue_flush_state = FLUSH_OFF;
 	    qr_request_queue_report(0);                 // request a queue report, since we've changed the number of buffers available
+        sr_request_status_report(SR_REQUEST_IMMEDIATE); // ...and tell the host it's ready now
     }
 }
 
@@ -1560,6 +2724,8 @@ void cm_queue_flush()
  * _exec_program_finalize()     - helper
  * cm_cycle_start()
  * cm_cycle_end()
+ * cm_set_cycle_callback()      - make a cycle the one the main loop runs
+ * cm_cycle_callback()          - main loop callback for the active cycle
  * cm_program_stop()            - M0
  * cm_optional_program_stop()   - M1
  * cm_program_end()             - M2, M30
@@ -1626,6 +2792,7 @@ static void _exec_program_finalize(float *value, bool *flag)
 		cm_select_plane(cm.default_select_plane);       // reset to default arc plane
 		cm_set_distance_mode(cm.default_distance_mode);
 		cm_set_arc_distance_mode(INCREMENTAL_MODE);     // always the default
+		cm_set_retract_mode(RETRACT_TO_CLEAR_Z);        // G98
 		cm_spindle_off_immediate();                     // M5
 		cm_coolant_off_immediate();                     // M9
 		cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);	// G94
@@ -1640,6 +2807,7 @@ void cm_cycle_start()
 		cm.machine_state = MACHINE_CYCLE;
 		cm.cycle_state = CYCLE_MACHINING;
 		qr_init_queue_report();							// clear queue reporting buffer counts
+		mp_init_queue_stats();							// and the starvation telemetry
 	}
 }
 
@@ -1652,6 +2820,50 @@ void cm_cycle_end()
 	}
 }
 
+/*
+ * cm_set_cycle_callback() - make a cycle the one the main loop runs
+ * cm_cycle_callback()     - main loop callback - run the active cycle
+ *
+ *	Homing, probing, jogging and the move generators (arcs, batched moves, drilling) each
+ *	run from a main loop callback, and only one of them runs at a time. Instead of the
+ *	controller calling all of them on every pass to have each find it has nothing to do,
+ *	a cycle registers its callback as it starts and only that one is called. With no
+ *	cycle running the task costs one test.
+ *
+ *	A cycle is over when its callback returns STAT_NOOP - whether it finished or was
+ *	ended by a flush or an alarm - and is dropped then. A cycle started by another stacks
+ *	on it: the height map grid runs a G38.2 probe per point, and the grid is called again
+ *	in the same pass the probe ends. Each callback keeps its own wait - planner headroom
+ *	for the generators, the runtime coming to rest for homing and probing - and returns
+ *	STAT_EAGAIN while waiting, which holds off new commands as before.
+ */
+
+void cm_set_cycle_callback(stat_t (*callback)(void))
+{
+	if ((cm.cycle_callbacks > 0) && (cm.cycle_callback[cm.cycle_callbacks-1] == callback)) {
+		return;											// already the active one
+	}
+	if (cm.cycle_callbacks == CYCLE_CALLBACK_DEPTH) {	// drop the oldest - it has ended
+		for (uint8_t i = 1; i < CYCLE_CALLBACK_DEPTH; i++) {
+			cm.cycle_callback[i-1] = cm.cycle_callback[i];
+		}
+		cm.cycle_callbacks--;
+	}
+	cm.cycle_callback[cm.cycle_callbacks++] = callback;
+}
+
+stat_t cm_cycle_callback()
+{
+	while (cm.cycle_callbacks > 0) {
+		stat_t status = cm.cycle_callback[cm.cycle_callbacks-1]();
+		if (status != STAT_NOOP) {
+			return (status);
+		}
+		cm.cycle_callbacks--;							// the cycle is over - run the one it stacked on
+	}
+	return (STAT_NOOP);
+}
+
 void cm_canned_cycle_end()
 {
 	cm.cycle_state = CYCLE_OFF;
@@ -1678,6 +2890,9 @@ void cm_program_end()
 {
 	float value[] = { (float)MACHINE_PROGRAM_END, 0,0,0,0,0 };
     bool flags[]  = { 1,0,0,0,0,0 };
+#ifdef __MOTION_OUTPUTS
+	gpio_end_output_events();							// M62/M63 events the path didn't reach
+#endif
 	mp_queue_command(_exec_program_finalize, value, flags);
 }
 
@@ -1787,7 +3002,24 @@ static const char msg_g01[] PROGMEM = "G1  - linear feed";
 static const char msg_g02[] PROGMEM = "G2  - clockwise arc feed";
 static const char msg_g03[] PROGMEM = "G3  - counter clockwise arc feed";
 static const char msg_g80[] PROGMEM = "G80 - cancel motion mode (none active)";
-static const char *const msg_momo[] PROGMEM = { msg_g00, msg_g01, msg_g02, msg_g03, msg_g80 };
+static const char msg_g38[] PROGMEM = "G38.2 - straight probe";
+static const char msg_g81[] PROGMEM = "G81 - drilling";
+static const char msg_g82[] PROGMEM = "G82 - drilling with dwell";
+static const char msg_g83[] PROGMEM = "G83 - peck drilling";
+static const char msg_g84[] PROGMEM = "G84 - right hand tapping";
+static const char msg_g85[] PROGMEM = "G85 - boring, no dwell, feed out";
+static const char msg_g86[] PROGMEM = "G86 - boring, spindle stop, rapid out";
+static const char msg_g87[] PROGMEM = "G87 - back boring";
+static const char msg_g88[] PROGMEM = "G88 - boring, spindle stop, manual out";
+static const char msg_g89[] PROGMEM = "G89 - boring, dwell, feed out";
+static const char msg_g05[] PROGMEM = "G5  - cubic spline feed";
+static const char msg_g051[] PROGMEM = "G5.1 - quadratic spline feed";
+static const char msg_g33[] PROGMEM = "G33 - spindle synchronized motion";
+static const char msg_g331[] PROGMEM = "G33.1 - rigid tapping";
+static const char *const msg_momo[] PROGMEM = { msg_g00, msg_g01, msg_g02, msg_g03, msg_g80, msg_g38,
+												msg_g81, msg_g82, msg_g83, msg_g84, msg_g85, msg_g86,
+												msg_g87, msg_g88, msg_g89, msg_g05, msg_g051, msg_g33,
+												msg_g331 };
 
 static const char msg_g17[] PROGMEM = "G17 - XY plane";
 static const char msg_g18[] PROGMEM = "G18 - XZ plane";
@@ -1896,9 +3128,11 @@ static int8_t _get_axis_type(const index_t index)
  * cm_get_ofs()  - get current work offset (runtime)
  * cm_get_pos()  - get current work position (runtime)
  * cm_get_mpos() - get current machine position (runtime)
+ * cm_get_mpe()  - get measured machine position (encoders)
  *
  * cm_print_pos()- print work position (with proper units)
  * cm_print_mpos()- print machine position (always mm units)
+ * cm_print_mpe() - print measured machine position (always mm units)
  * cm_print_coor()- print coordinate offsets with linear units
  * cm_print_corr()- print coordinate offsets with rotary units
  */
@@ -1908,6 +3142,9 @@ stat_t _get_msg_helper(nvObj_t *nv, const char *const msg_array[], uint8_t value
 {
 	nv->value = (float)value;
     nv->valuetype = TYPE_INT;
+	if (msg_array == NULL) {			// the strings are only there for text mode
+		return (STAT_OK);
+	}
 	return(nv_copy_string(nv, (const char *)GET_TEXT_ITEM(msg_array, value)));
 }
 
@@ -1927,6 +3164,15 @@ stat_t cm_get_dist(nvObj_t *nv) { return(_get_msg_helper(nv, msg_dist, cm_get_di
 stat_t cm_get_admo(nvObj_t *nv) { return(_get_msg_helper(nv, msg_admo, cm_get_arc_distance_mode(ACTIVE_MODEL)));}
 stat_t cm_get_frmo(nvObj_t *nv) { return(_get_msg_helper(nv, msg_frmo, cm_get_feed_rate_mode(ACTIVE_MODEL)));}
 
+#ifdef __WATCHDOG
+stat_t cm_get_warm(nvObj_t *nv)
+{
+	nv->value = (float)cm.warm_linenum;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+#endif
+
 stat_t cm_get_toolv(nvObj_t *nv)
 {
 	nv->value = (float)cm_get_tool(ACTIVE_MODEL);
@@ -1990,6 +3236,28 @@ stat_t cm_get_mpo(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+/*
+ *	The measured position is where the encoders say the motors are, as of the last segment
+ *	loaded. The counts are integer steps, so they carry no accumulated float error. They
+ *	are only turned into units here, through the cached units_per_step and the forward
+ *	kinematics. The exec doesn't do any of it. Without a quadrature decoder the counts are
+ *	the steps sent, so mpe follows mpo a segment behind.
+ */
+stat_t cm_get_mpe(nvObj_t *nv)
+{
+	float steps[MOTORS];
+	float position[AXES];
+
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		steps[motor] = en_read_encoder(motor);
+	}
+	kn_forward_kinematics(steps, position);
+	nv->value = position[_get_axis(nv->index)];
+	nv->precision = GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
 stat_t cm_get_ofs(nvObj_t *nv)
 {
 	nv->value = cm_get_work_offset(ACTIVE_MODEL, _get_axis(nv->index));
@@ -2004,6 +3272,9 @@ stat_t cm_get_ofs(nvObj_t *nv)
  * cm_get_am() - get axis mode w/enumeration string
  * cm_set_am() - set axis mode w/exception handling for axis type
  * cm_set_hi() - set homing input
+ * cm_set_travel() - set travel min or max and refresh the soft limits
+ * cm_set_hom() - set or clear an axis homed flag and refresh the soft limits
+ * cm_set_sl() - enable or disable soft limits
  */
 
 stat_t cm_get_am(nvObj_t *nv)
@@ -2020,6 +3291,7 @@ stat_t cm_set_am(nvObj_t *nv)		// axis mode
 		if (nv->value > AXIS_MODE_MAX_ROTARY) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
 	}
 	set_ui8(nv);
+	kn_update_motor_map();					// inhibited axes are folded into the motor map
 	return(STAT_OK);
 }
 
@@ -2032,12 +3304,57 @@ stat_t cm_set_hi(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+stat_t cm_set_travel(nvObj_t *nv)
+{
+	if (_get_axis_type(nv->index) == 0) {
+		set_flu(nv);
+	} else {
+		set_flt(nv);
+	}
+	cm_refresh_soft_limits();
+	return (STAT_OK);
+}
+
+stat_t cm_set_hom(nvObj_t *nv)
+{
+	ritorno(set_01(nv));
+	cm_refresh_soft_limits();
+	return (STAT_OK);
+}
+
+stat_t cm_set_sl(nvObj_t *nv)
+{
+	ritorno(set_01(nv));
+	cm_refresh_soft_limits();
+	return (STAT_OK);
+}
+
+/*
+ * cm_set_cofs() - set a G54-G59 offset and refresh the cached active offset
+ */
+stat_t cm_set_cofs(nvObj_t *nv)
+{
+	if (_get_axis_type(nv->index) == 0) {	// linear axes are entered in G20/G21 units
+		set_flu(nv);
+	} else {
+		set_flt(nv);
+	}
+	cm_refresh_coord_offset();
+	return (STAT_OK);
+}
+
 /**** Jerk functions
  * cm_get_axis_jerk() - returns jerk for an axis
  * cm_set_axis_jerk() - sets the jerk for an axis, including recirpcal and cached values
+ * cm_set_junction_jerk() - update the cached cornering terms (Jm * JA and Jm * JD^2) for an axis
  *
  * cm_set_xjm()		  - set jerk max value - called from dispatch table
  * cm_set_xjh()		  - set jerk homing value - called from dispatch table
+ * cm_set_xjd()		  - set junction deviation - called from dispatch table
+ * cm_set_vm()		  - set velocity max or feed rate max - called from dispatch table
+ *
+ *	Changes to the jerk, junction and velocity limits are also applied to the moves already
+ *	queued (see mp_request_reconstrain()), so dynamics can be tuned during a running job.
  *
  *	Jerk values can be rather large, often in the billions. This makes for some pretty big
  *	numbers for people to deal with. Jerk values are stored in the system in truncated format;
@@ -2058,6 +3375,13 @@ void cm_set_axis_jerk(const uint8_t axis, const float jerk)
 {
 	cm.a[axis].jerk_max = jerk;
 	cm.a[axis].recip_jerk = 1/(jerk * JERK_MULTIPLIER);
+	cm_set_junction_jerk(axis);
+}
+
+void cm_set_junction_jerk(const uint8_t axis)
+{
+	cm.a[axis].junction_jerk = cm.a[axis].jerk_max * cm.junction_aggression;
+	cm.a[axis].junction_dev_jerk = cm.a[axis].jerk_max * JERK_MULTIPLIER * square(cm.a[axis].junction_dev);
 }
 
 stat_t cm_set_jm(nvObj_t *nv)
@@ -2065,6 +3389,7 @@ stat_t cm_set_jm(nvObj_t *nv)
 	if (nv->value > JERK_MULTIPLIER) nv->value /= JERK_MULTIPLIER;
 	set_flu(nv);
 	cm_set_axis_jerk(_get_axis(nv->index), nv->value);
+	mp_request_reconstrain();
 	return(STAT_OK);
 }
 
@@ -2075,10 +3400,122 @@ stat_t cm_set_jh(nvObj_t *nv)
 	return(STAT_OK);
 }
 
+stat_t cm_set_jd(nvObj_t *nv)
+{
+	if (nv->value < 0) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	uint8_t axis = _get_axis(nv->index);
+	if (axis < AXIS_A) {
+		set_flu(nv);
+	} else {
+		set_flt(nv);
+	}
+	cm_set_junction_jerk(axis);
+	mp_request_reconstrain();
+	return(STAT_OK);
+}
+
+stat_t cm_set_vm(nvObj_t *nv)
+{
+	if (_get_axis(nv->index) < AXIS_A) {
+		set_flu(nv);
+	} else {
+		set_flt(nv);
+	}
+	mp_request_reconstrain();
+	return(STAT_OK);
+}
+
+#ifdef __INPUT_SHAPING
+/*
+ * cm_set_ist() - set axis input shaper type - 0=none, 1=ZV, 2=ZVD, 3=EI
+ * cm_set_isf() - set axis input shaper frequency (Hz)
+ * cm_set_isd() - set axis input shaper damping ratio
+ *
+ *	The shaper is rebuilt at once, so these are only taken with the machine stopped.
+ */
+
+static stat_t _check_shaper(nvObj_t *nv, float min, float max)
+{
+	if (cm.cycle_state != CYCLE_OFF) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	if (nv->value < min) {
+		return (STAT_INPUT_VALUE_TOO_SMALL);
+	}
+	if (nv->value > max) {
+		return (STAT_INPUT_VALUE_TOO_LARGE);
+	}
+	return (STAT_OK);
+}
+
+stat_t cm_set_ist(nvObj_t *nv)
+{
+	ritorno(_check_shaper(nv, SHAPER_NONE, SHAPER_TYPE_MAX-1));
+	set_ui8(nv);
+	mp_shaper_configure();
+	return (STAT_OK);
+}
+
+stat_t cm_set_isf(nvObj_t *nv)
+{
+	ritorno(_check_shaper(nv, SHAPER_FREQUENCY_MIN, SHAPER_FREQUENCY_MAX));
+	set_flt(nv);
+	mp_shaper_configure();
+	return (STAT_OK);
+}
+
+stat_t cm_set_isd(nvObj_t *nv)
+{
+	ritorno(_check_shaper(nv, 0, SHAPER_DAMPING_MAX));
+	set_flt(nv);
+	mp_shaper_configure();
+	return (STAT_OK);
+}
+#endif // __INPUT_SHAPING
+
+#ifdef __PRESSURE_ADVANCE
+/*
+ * cm_set_pa() - set axis pressure advance (seconds) - 0 turns it off
+ *
+ *	A change moves the extruder target by the change times the extruder velocity, so it is
+ *	only taken with the machine stopped.
+ */
+
+stat_t cm_set_pa(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	if (nv->value < 0) {
+		return (STAT_INPUT_VALUE_TOO_SMALL);
+	}
+	if (nv->value > PRESSURE_ADVANCE_MAX) {
+		return (STAT_INPUT_VALUE_TOO_LARGE);
+	}
+	set_flt(nv);
+	return (STAT_OK);
+}
+#endif // __PRESSURE_ADVANCE
+
 stat_t cm_set_ja(nvObj_t *nv)
 {
     if (nv->value > 1000) nv->value /= 1000000;
     set_flt(nv);
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        cm_set_junction_jerk(axis);                 // cornering terms depend on JA
+    }
+    mp_request_reconstrain();
+    return(STAT_OK);
+}
+
+stat_t cm_set_bst(nvObj_t *nv)
+{
+    if ((nv->value < MIN_SEGMENT_USEC) || (nv->value > MAX_SEGMENT_USEC)) {
+        return (STAT_INPUT_VALUE_UNSUPPORTED);
+    }
+    set_flt(nv);
     return(STAT_OK);
 }
 
@@ -2087,6 +3524,13 @@ stat_t cm_set_ja(nvObj_t *nv)
  *
  * cm_run_qf() - flush planner queue
  * cm_run_home() - run homing sequence
+ * cm_get_dry() - job time of the dry plan so far, in seconds
+ * cm_run_dry() - {"dry":1} starts a dry plan, {"dry":0} ends it and returns the job time
+ *
+ *	A dry plan runs the Gcode that follows through the planner without moving - see
+ *	mp_start_dry_plan(). It can only start from rest with the queue empty. Ending it takes
+ *	the rest of the queue and puts the model back at the runtime position, which the dry
+ *	plan never moved. Offsets and other model state the job changed are kept.
  */
 
 stat_t cm_run_qf(nvObj_t *nv)
@@ -2095,6 +3539,34 @@ stat_t cm_run_qf(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+stat_t cm_get_dry(nvObj_t *nv)
+{
+	nv->value = mb.dry_plan_time * 60;
+	nv->precision = GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
+stat_t cm_run_dry(nvObj_t *nv)
+{
+	if (fp_TRUE(nv->value)) {
+		if (!mp_dry_plan_is_active()) {
+			if ((cm.machine_state == MACHINE_CYCLE) ||
+				(mp_get_planner_buffers_available() < PLANNER_BUFFER_POOL_SIZE) || st_runtime_isbusy()) {
+				return (STAT_COMMAND_NOT_ACCEPTED);
+			}
+			mp_start_dry_plan();
+		}
+		return (cm_get_dry(nv));
+	}
+	if (mp_dry_plan_is_active()) {
+		float job_time = mp_end_dry_plan();
+		cm_queue_flush();						// drop anything held and return to the runtime position
+		mb.dry_plan_time = job_time;			// the flush cleared it - keep it for GET
+	}
+	return (cm_get_dry(nv));
+}
+
 stat_t cm_run_home(nvObj_t *nv)
 {
 	if (fp_TRUE(nv->value)) {
@@ -2170,6 +3642,39 @@ stat_t cm_run_joga(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+#ifdef __HEIGHT_MAP
+stat_t cm_run_mshp(nvObj_t *nv)
+{
+	return (cm_height_map_start());		// the value is ignored - GET returns the points probed
+}
+#endif
+
+stat_t cm_set_mfo(nvObj_t *nv)
+{
+	if ((nv->value < FEED_OVERRIDE_MIN) || (nv->value > FEED_OVERRIDE_MAX)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	_set_override(&cm.gmx.feed_rate_override_factor, nv->value, FEED_OVERRIDE_MAX);
+	return (STAT_OK);
+}
+
+stat_t cm_set_mto(nvObj_t *nv)
+{
+	if ((nv->value < FEED_OVERRIDE_MIN) || (nv->value > TRAVERSE_OVERRIDE_MAX)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	_set_override(&cm.gmx.traverse_override_factor, nv->value, TRAVERSE_OVERRIDE_MAX);
+	return (STAT_OK);
+}
+
+stat_t cm_set_jgv(nvObj_t *nv)
+{
+	int8_t axis = _get_axis(nv->index);
+	if (axis < 0) return (STAT_INPUT_VALUE_RANGE_ERROR);
+	cm.jog_velocity[axis] = nv->value;
+	return (cm_jogging_velocity_start());
+}
+
 /***********************************************************************************
  * TEXT MODE SUPPORT
  * Functions to print variables from the cfgArray table
@@ -2200,6 +3705,7 @@ const char fmt_tool[] PROGMEM = "Tool number          %d\n";
 
 const char fmt_pos[] PROGMEM = "%c position:%15.3f%s\n";
 const char fmt_mpo[] PROGMEM = "%c machine posn:%11.3f%s\n";
+const char fmt_mpe[] PROGMEM = "%c measured posn:%10.3f%s\n";
 const char fmt_ofs[] PROGMEM = "%c work offset:%12.3f%s\n";
 const char fmt_hom[] PROGMEM = "%c axis homing state:%2.0f\n";
 
@@ -2241,9 +3747,42 @@ void cm_print_gdi(nvObj_t *nv) { text_print(nv, fmt_gdi);}  // TYPE_INT
 //const char fmt_ja[] PROGMEM = "[ja]  junction acceleration%8.0f%s\n";
 const char fmt_ja[] PROGMEM = "[ja]  junction aggression%13.2f\n";
 const char fmt_ct[] PROGMEM = "[ct]  chordal tolerance%17.4f%s\n";
+const char fmt_ca[] PROGMEM = "[ca]  coalesce angle%20.2f degrees\n";
+const char fmt_la[] PROGMEM = "[la]  planner lookahead target%10.0f ms\n";
+const char fmt_bst[] PROGMEM = "[bst] body segment time%17.0f uSec\n";
+const char fmt_sw[] PROGMEM = "[sw]  feed smoothing window%9d blocks [0=disable]\n";
+const char fmt_vh[] PROGMEM = "[vh]  velocity hints%15d [0=disable,1=enable]\n";
 const char fmt_sl[] PROGMEM = "[sl]  soft limit enable%12d [0=disable,1=enable]\n";
 const char fmt_lim[] PROGMEM ="[lim] limit switch enable%10d [0=disable,1=enable]\n";
 const char fmt_saf[] PROGMEM ="[saf] safety interlock enable%6d [0=disable,1=enable]\n";
+const char fmt_prbi[] PROGMEM ="[prbi] probe input%17d [1-9=digital input]\n";
+const char fmt_hmc[] PROGMEM ="[hmc] concurrent homing%12d [0=one axis at a time,1=concurrent]\n";
+const char fmt_few[] PROGMEM ="[few] following error warning%10.1f steps [0=disable]\n";
+const char fmt_fes[] PROGMEM ="[fes] stall feed reduction step%8.2f x\n";
+const char fmt_lfi[] PROGMEM ="[lfi] adaptive feed load input%5d [0=off,1-4=analog input]\n";
+const char fmt_lft[] PROGMEM ="[lft] adaptive feed target load%9.3f\n";
+const char fmt_lfg[] PROGMEM ="[lfg] adaptive feed gain%16.3f per second\n";
+const char fmt_lfm[] PROGMEM ="[lfm] adaptive feed minimum%13.2f x\n";
+const char fmt_lfx[] PROGMEM ="[lfx] adaptive feed maximum%13.2f x\n";
+const char fmt_lfo[] PROGMEM ="Adaptive feed factor:%16.2f x\n";
+const char fmt_tna[] PROGMEM ="[tna] tangential axis%19d [0=off,1=A,2=B,3=C]\n";
+const char fmt_tnc[] PROGMEM ="[tnc] tangential corner angle%11.1f degrees\n";
+const char fmt_tnl[] PROGMEM ="[tnl] tangential corner lift%12.3f mm\n";
+const char fmt_thi[] PROGMEM ="[thi] torch height voltage input%4d [0=off,1-4=analog input]\n";
+const char fmt_thv[] PROGMEM ="[thv] torch height arc voltage%10.1f volts\n";
+const char fmt_thg[] PROGMEM ="[thg] torch height gain%18.1f mm/min per volt\n";
+const char fmt_thr[] PROGMEM ="[thr] torch height max rate%14.1f mm/min\n";
+const char fmt_thl[] PROGMEM ="[thl] torch height limit%17.3f mm\n";
+const char fmt_tha[] PROGMEM ="[tha] torch height anti-dive%13.2f [fraction of cruise velocity]\n";
+const char fmt_thd[] PROGMEM ="[thd] torch height delay%17.2f seconds\n";
+const char fmt_tho[] PROGMEM ="Torch height correction:%13.3f mm\n";
+const char fmt_rtv[] PROGMEM ="[rtv] retrace velocity%19.1f mm/min\n";
+const char fmt_rtr[] PROGMEM ="Retraced along the path:%13.3f mm\n";
+const char fmt_fhd[] PROGMEM = "Feedhold stop distance:%14.3f mm\n";
+const char fmt_fht[] PROGMEM = "Feedhold stop time:%18.3f ms\n";
+const char fmt_fhl[] PROGMEM = "Feedhold latency:%20.3f ms\n";
+const char fmt_mfo[] PROGMEM = "[mfo] feed override%18.2f x\n";
+const char fmt_mto[] PROGMEM = "[mto] traverse override%14.2f x\n";
 const char fmt_ml[] PROGMEM = "[ml]  min line segment%17.3f%s\n";
 const char fmt_ma[] PROGMEM = "[ma]  min arc segment%18.3f%s\n";
 const char fmt_ms[] PROGMEM = "[ms]  min segment time%13.0f uSec\n";
@@ -2251,9 +3790,42 @@ const char fmt_ms[] PROGMEM = "[ms]  min segment time%13.0f uSec\n";
 //void cm_print_ja(nvObj_t *nv) { text_print_flt_units(nv, fmt_ja, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ja(nvObj_t *nv) { text_print(nv, fmt_ja);}    // TYPE FLOAT
 void cm_print_ct(nvObj_t *nv) { text_print_flt_units(nv, fmt_ct, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_ca(nvObj_t *nv) { text_print(nv, fmt_ca);}    // TYPE FLOAT
+void cm_print_la(nvObj_t *nv) { text_print(nv, fmt_la);}    // TYPE FLOAT
+void cm_print_bst(nvObj_t *nv) { text_print(nv, fmt_bst);}  // TYPE FLOAT
+void cm_print_sw(nvObj_t *nv) { text_print(nv, fmt_sw);}    // TYPE_INT
+void cm_print_vh(nvObj_t *nv) { text_print(nv, fmt_vh);}    // TYPE_INT
 void cm_print_sl(nvObj_t *nv) { text_print(nv, fmt_sl);}    // TYPE_INT
 void cm_print_lim(nvObj_t *nv){ text_print(nv, fmt_lim);}   // TYPE_INT
 void cm_print_saf(nvObj_t *nv){ text_print(nv, fmt_saf);}   // TYPE_INT
+void cm_print_prbi(nvObj_t *nv){ text_print(nv, fmt_prbi);} // TYPE_INT
+void cm_print_hmc(nvObj_t *nv){ text_print(nv, fmt_hmc);}   // TYPE_INT
+void cm_print_few(nvObj_t *nv){ text_print(nv, fmt_few);}   // TYPE_FLOAT
+void cm_print_fes(nvObj_t *nv){ text_print(nv, fmt_fes);}   // TYPE_FLOAT
+void cm_print_lfi(nvObj_t *nv){ text_print(nv, fmt_lfi);}   // TYPE_INT
+void cm_print_lft(nvObj_t *nv){ text_print(nv, fmt_lft);}   // TYPE_FLOAT
+void cm_print_lfg(nvObj_t *nv){ text_print(nv, fmt_lfg);}   // TYPE_FLOAT
+void cm_print_lfm(nvObj_t *nv){ text_print(nv, fmt_lfm);}   // TYPE_FLOAT
+void cm_print_lfx(nvObj_t *nv){ text_print(nv, fmt_lfx);}   // TYPE_FLOAT
+void cm_print_lfo(nvObj_t *nv){ text_print(nv, fmt_lfo);}   // TYPE_FLOAT
+void cm_print_tna(nvObj_t *nv){ text_print(nv, fmt_tna);}   // TYPE_INT
+void cm_print_tnc(nvObj_t *nv){ text_print(nv, fmt_tnc);}   // TYPE_FLOAT
+void cm_print_tnl(nvObj_t *nv){ text_print(nv, fmt_tnl);}   // TYPE_FLOAT
+void cm_print_thi(nvObj_t *nv){ text_print(nv, fmt_thi);}   // TYPE_INT
+void cm_print_thv(nvObj_t *nv){ text_print(nv, fmt_thv);}   // TYPE_FLOAT
+void cm_print_thg(nvObj_t *nv){ text_print(nv, fmt_thg);}   // TYPE_FLOAT
+void cm_print_thr(nvObj_t *nv){ text_print(nv, fmt_thr);}   // TYPE_FLOAT
+void cm_print_thl(nvObj_t *nv){ text_print(nv, fmt_thl);}   // TYPE_FLOAT
+void cm_print_tha(nvObj_t *nv){ text_print(nv, fmt_tha);}   // TYPE_FLOAT
+void cm_print_thd(nvObj_t *nv){ text_print(nv, fmt_thd);}   // TYPE_FLOAT
+void cm_print_tho(nvObj_t *nv){ text_print(nv, fmt_tho);}   // TYPE_FLOAT
+void cm_print_rtv(nvObj_t *nv){ text_print(nv, fmt_rtv);}   // TYPE_FLOAT
+void cm_print_rtr(nvObj_t *nv){ text_print(nv, fmt_rtr);}   // TYPE_FLOAT
+void cm_print_fhd(nvObj_t *nv){ text_print(nv, fmt_fhd);}   // TYPE_FLOAT
+void cm_print_fht(nvObj_t *nv){ text_print(nv, fmt_fht);}   // TYPE_FLOAT
+void cm_print_fhl(nvObj_t *nv){ text_print(nv, fmt_fhl);}   // TYPE_FLOAT
+void cm_print_mfo(nvObj_t *nv){ text_print(nv, fmt_mfo);}   // TYPE_FLOAT
+void cm_print_mto(nvObj_t *nv){ text_print(nv, fmt_mto);}   // TYPE_FLOAT
 void cm_print_ml(nvObj_t *nv) { text_print_flt_units(nv, fmt_ml, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ma(nvObj_t *nv) { text_print_flt_units(nv, fmt_ma, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ms(nvObj_t *nv) { text_print(nv, fmt_ms);}    // TYPE_FLOAT
@@ -2278,6 +3850,10 @@ void cm_print_ms(nvObj_t *nv) { text_print(nv, fmt_ms);}    // TYPE_FLOAT
  *	cm_print_lv()
  *	cm_print_lb()
  *	cm_print_zb()
+ *	cm_print_ist()
+ *	cm_print_isf()
+ *	cm_print_isd()
+ *	cm_print_pa()
  *
  *	cm_print_pos() - print position with unit displays for MM or Inches
  * 	cm_print_mpo() - print position with fixed unit display - always in Degrees or MM
@@ -2298,12 +3874,16 @@ const char fmt_Xsv[] PROGMEM = "[%s%s] %s search velocity%12.0f%s/min\n";
 const char fmt_Xlv[] PROGMEM = "[%s%s] %s latch velocity%13.2f%s/min\n";
 const char fmt_Xlb[] PROGMEM = "[%s%s] %s latch backoff%18.3f%s\n";
 const char fmt_Xzb[] PROGMEM = "[%s%s] %s zero backoff%19.3f%s\n";
+const char fmt_Xist[] PROGMEM = "[%s%s] %s input shaper%15d [0=none,1=ZV,2=ZVD,3=EI]\n";
+const char fmt_Xisf[] PROGMEM = "[%s%s] %s shaper frequency%15.1f Hz\n";
+const char fmt_Xisd[] PROGMEM = "[%s%s] %s shaper damping%17.3f\n";
+const char fmt_Xpa[] PROGMEM = "[%s%s] %s pressure advance%15.3f sec\n";
 const char fmt_cofs[] PROGMEM = "[%s%s] %s %s offset%20.3f%s\n";
 const char fmt_cpos[] PROGMEM = "[%s%s] %s %s position%18.3f%s\n";
 
 static void _print_axis_ui8(nvObj_t *nv, const char *format)
 {
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, (uint8_t)nv->value);
+	text_printf(format, nv_group(nv), nv_token(nv), nv_group(nv), (uint8_t)nv->value);
 }
 
 static void _print_axis_flt(nvObj_t *nv, const char *format)
@@ -2314,7 +3894,7 @@ static void _print_axis_flt(nvObj_t *nv, const char *format)
 	} else {
 		units = (char *)GET_TEXT_ITEM(msg_units, DEGREE_INDEX);
 	}
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->value, units);
+	text_printf(format, nv_group(nv), nv_token(nv), nv_group(nv), nv->value, units);
 }
 
 static void _print_axis_coord_flt(nvObj_t *nv, const char *format)
@@ -2325,7 +3905,7 @@ static void _print_axis_coord_flt(nvObj_t *nv, const char *format)
 	} else {
 		units = (char *)GET_TEXT_ITEM(msg_units, DEGREE_INDEX);
 	}
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->token, nv->value, units);
+	text_printf(format, nv_group(nv), nv_token(nv), nv_group(nv), nv_token(nv), nv->value, units);
 }
 
 static void _print_pos(nvObj_t *nv, const char *format, uint8_t units)
@@ -2333,19 +3913,19 @@ static void _print_pos(nvObj_t *nv, const char *format, uint8_t units)
 	char axes[] = {"XYZABC"};
 	uint8_t axis = _get_axis(nv->index);
 	if (axis >= AXIS_A) { units = DEGREES;}
-	fprintf_P(stderr, format, axes[axis], nv->value, GET_TEXT_ITEM(msg_units, units));
+	text_printf(format, axes[axis], nv->value, GET_TEXT_ITEM(msg_units, units));
 }
 
 static void _print_hom(nvObj_t *nv, const char *format)
 {
 	char axes[] = {"XYZABC"};
 	uint8_t axis = _get_axis(nv->index);
-	fprintf_P(stderr, format, axes[axis], nv->value);
+	text_printf(format, axes[axis], nv->value);
 }
 
 void cm_print_am(nvObj_t *nv)	// print axis mode with enumeration string
 {
-	fprintf_P(stderr, fmt_Xam, nv->group, nv->token, nv->group, (uint8_t)nv->value,
+	text_printf(fmt_Xam, nv_group(nv), nv_token(nv), nv_group(nv), (uint8_t)nv->value,
 	GET_TEXT_ITEM(msg_am, (uint8_t)nv->value));
 }
 
@@ -2364,12 +3944,17 @@ void cm_print_sv(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xsv);}
 void cm_print_lv(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xlv);}
 void cm_print_lb(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xlb);}
 void cm_print_zb(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xzb);}
+void cm_print_ist(nvObj_t *nv) { _print_axis_ui8(nv, fmt_Xist);}
+void cm_print_isf(nvObj_t *nv) { text_printf(fmt_Xisf, nv_group(nv), nv_token(nv), nv_group(nv), nv->value);}
+void cm_print_isd(nvObj_t *nv) { text_printf(fmt_Xisd, nv_group(nv), nv_token(nv), nv_group(nv), nv->value);}
+void cm_print_pa(nvObj_t *nv) { text_printf(fmt_Xpa, nv_group(nv), nv_token(nv), nv_group(nv), nv->value);}
 
 void cm_print_cofs(nvObj_t *nv) { _print_axis_coord_flt(nv, fmt_cofs);}
 void cm_print_cpos(nvObj_t *nv) { _print_axis_coord_flt(nv, fmt_cpos);}
 
 void cm_print_pos(nvObj_t *nv) { _print_pos(nv, fmt_pos, cm_get_units_mode(MODEL));}
 void cm_print_mpo(nvObj_t *nv) { _print_pos(nv, fmt_mpo, MILLIMETERS);}
+void cm_print_mpe(nvObj_t *nv) { _print_pos(nv, fmt_mpe, MILLIMETERS);}
 void cm_print_ofs(nvObj_t *nv) { _print_pos(nv, fmt_ofs, MILLIMETERS);}
 void cm_print_hom(nvObj_t *nv) { _print_hom(nv, fmt_hom);}
 
@@ -40,10 +40,36 @@
 #define RUNTIME (GCodeState_t *)&mr.gm		// absolute pointer from runtime mm struct
 #define ACTIVE_MODEL cm.am					// active model pointer is maintained by state management
 
-#define _to_millimeters(a) ((cm.gm.units_mode == INCHES) ? (a * MM_PER_INCH) : a)
+#define _to_millimeters(a) ((a) * cm.units_scale)	// units_scale follows G20/G21 - see cm_set_units_mode()
 
 #define JOGGING_START_VELOCITY ((float)10.0)
+#define JOG_VELOCITY_TIMEOUT_MS 100			// velocity jog stops if no velocity command arrives for this long
+#define JOG_VELOCITY_HORIZON_MS 20			// lookahead queued beyond the braking distance (ms of travel)
+#define JOG_VELOCITY_MOVES 3				// max velocity jog moves queued in the planner
+#define CYCLE_CALLBACK_DEPTH 3				// cycles run from the main loop at once (height map + probe + one ending)
 #define DISABLE_SOFT_LIMIT (999999)
+#define MV_BATCH_MAX 16						// moves in one {"mv":[...]} batch
+#define DRILL_PECK_CLEARANCE ((float)0.254)	// G83 rapids back in to this far above the last peck (mm)
+#define FEED_OVERRIDE_MIN ((float)0.05)		// feed and traverse override limits (factor of F or traverse rate)
+#define FEED_OVERRIDE_MAX ((float)2.00)
+#define TRAVERSE_OVERRIDE_MAX ((float)1.00)
+#define STALL_CHECK_MS 100					// ms between stall detection checks - see cm_stall_detection_callback()
+#define LOAD_FEED_CHECK_MS 20				// ms between adaptive feed updates - see cm_load_feed_callback()
+#define LOAD_FEED_REPLAN ((float)0.02)		// adaptive feed change that replans the queued blocks
+#define LOAD_FEED_OVERLOAD ((float)1.5)		// load over target that alarms with the feed already at $lfm
+#define THC_DEADBAND ((float)1.0)			// volts of arc voltage error the torch height control leaves alone
+
+#ifndef PROBE_SCAN_POINTS
+#define PROBE_SCAN_POINTS 64				// scanning probe edges held for the host - see cm_probe_scan_point()
+#endif
+#define PROBE_SCAN_BATCH 10					// points in a full frame - 4 + 10*24 payload bytes
+#ifndef PROBE_SCAN_FLUSH_MS
+#define PROBE_SCAN_FLUSH_MS 100				// a part batch goes out when the oldest point is this old
+#endif
+
+#if defined(__TORCH_HEIGHT) && !defined(__ANALOG_INPUTS)
+#error __TORCH_HEIGHT reads the arc voltage through __ANALOG_INPUTS
+#endif
 
 /*****************************************************************************
  * MACHINE STATE MODEL
@@ -186,7 +212,11 @@ typedef enum {						    // G Modal Group 1
 	MOTION_MODE_CANNED_CYCLE_86,		// G86 - boring, spindle stop, rapid out
 	MOTION_MODE_CANNED_CYCLE_87,		// G87 - back boring
 	MOTION_MODE_CANNED_CYCLE_88,		// G88 - boring, spindle stop, manual out
-	MOTION_MODE_CANNED_CYCLE_89			// G89 - boring, dwell, feed out
+	MOTION_MODE_CANNED_CYCLE_89,		// G89 - boring, dwell, feed out
+	MOTION_MODE_CUBIC_SPLINE,			// G5 - cubic spline feed
+	MOTION_MODE_QUADRATIC_SPLINE,		// G5.1 - quadratic spline feed
+	MOTION_MODE_SPINDLE_SYNC,			// G33 - spindle synchronized motion (threading)
+	MOTION_MODE_RIGID_TAP				// G33.1 - rigid tapping
 } cmMotionMode;
 
 typedef enum {						    // Used for detecting gcode errors. See NIST section 3.4
@@ -250,6 +280,11 @@ typedef enum {
 	INCREMENTAL_MODE				// G91 / G91.1
 } cmDistanceMode;
 
+typedef enum {			            // G Modal Group 9
+	RETRACT_TO_CLEAR_Z = 0,			// G98 - retract to the Z the canned cycles started from (or R if higher)
+	RETRACT_TO_R_PLANE				// G99 - retract to the R plane
+} cmRetractMode;
+
 typedef enum {
 	INVERSE_TIME_MODE = 0,			// G93
 	UNITS_PER_MINUTE_MODE,			// G94
@@ -326,6 +361,9 @@ typedef struct GCodeState {				// Gcode model state - used by model, planning an
     float move_time;					// optimal time for move given axis constraints
     float minimum_time;					// minimum time possible for move given axis constraints
     float feed_rate; 					// F - normalized to millimeters/minute or in inverse time mode
+#ifdef __VELOCITY_HINTS
+    float exit_hint;					// (VEX) exit velocity the rest of the program allows, mm/min - this block only
+#endif
 
     float parameter;					// P - parameter used for dwell time in seconds, G10 coord select...
 
@@ -358,6 +396,8 @@ typedef struct GCodeStateExtended {		// Gcode dynamic state extensions - used by
 
     uint8_t origin_offset_enable;		// G92 offsets enabled/disabled. 0=disabled, 1=enabled
     uint8_t block_delete_switch;		// set true to enable block deletes (true is default)
+    float path_tolerance;				// G64 P corner blending tolerance in mm (0 = pass through the vertex)
+    uint8_t retract_mode;				// G98, G99 canned cycle retract mode - see cmRetractMode
 
 // unimplemented gcode parameters
 //	float cutter_radius;				// D - cutter radius compensation (0 is off)
@@ -390,6 +430,7 @@ typedef struct GCodeInput {				// Gcode model inputs - meaning depends on contex
     uint8_t path_control;	    		// G61... EXACT_PATH, EXACT_STOP, CONTINUOUS
     uint8_t distance_mode;	        	// G91   0=use absolute coords(G90), 1=incremental movement
     uint8_t arc_distance_mode;          // G90.1=use absolute IJK offsets, G91.1=incremental IJK offsets
+    uint8_t retract_mode;				// G98, G99 canned cycle retract mode
     uint8_t origin_offset_mode;     	// G92...TRUE=in origin offset mode
     uint8_t absolute_override;			// G53 TRUE = move using machine coordinates - this block only (G53)
     uint8_t tool;						// Tool after T and M6 (tool_select and tool_change)
@@ -406,6 +447,13 @@ typedef struct GCodeInput {				// Gcode model inputs - meaning depends on contex
     float parameter;					// P - parameter used for dwell time in seconds, G10 coord select...
     float arc_radius;					// R - radius value in arc radius mode
     float arc_offset[3];  				// IJK - used by arc commands
+    float Q_word;						// Q - used by G5 splines and the G83 peck depth
+#ifdef __VELOCITY_HINTS
+    float exit_hint;					// (VEX) comment - exit velocity hint in mm/min
+#endif
+#ifdef __MOTION_OUTPUTS
+    uint8_t output_control;				// M62, M63, M64, M65 - switch output P
+#endif
 
 // unimplemented gcode parameters
 //	float cutter_radius;				// D - cutter radius compensation (0 is off)
@@ -435,6 +483,7 @@ typedef struct GCodeFlags {             // Gcode model input flags
     bool path_control;
     bool distance_mode;
     bool arc_distance_mode;
+    bool retract_mode;
     bool origin_offset_mode;
     bool absolute_override;
     bool tool;
@@ -451,8 +500,39 @@ typedef struct GCodeFlags {             // Gcode model input flags
     bool parameter;
     bool arc_radius;
     bool arc_offset[3];
+    bool Q_word;
+#ifdef __MOTION_OUTPUTS
+    bool output_control;
+#endif
 } GCodeFlags_t;
 
+typedef struct cmBatch {				// batched straight feeds - see cm_run_mv()
+	uint8_t count;						// moves in the batch
+	uint8_t next;						// next move to queue
+	uint8_t axes[MV_BATCH_MAX];			// number of axes in each target, starting from X
+	float feed_rate[MV_BATCH_MAX];		// feed rate set before the move, or 0 to keep the current one
+	float target[MV_BATCH_MAX][AXES];
+} cmBatch_t;
+
+typedef struct cmDrill {				// canned drilling cycle - see cm_drill_cycle()
+	uint8_t motion_mode;				// G81, G82 or G83 while a series of holes is in progress
+	uint8_t step;						// next move in the hole - see cmDrillStep in canonical_machine.cpp
+	uint8_t holes;						// holes left to drill, counting the one in progress
+	float hole[2];						// XY of the hole being drilled (machine coordinates, mm)
+	float increment[2];					// XY step to the next hole for G91 L repeats
+	float clear_z;						// Z the series of canned cycles started from (G98 retract)
+	float r_plane;						// R plane (machine coordinates, mm)
+	float bottom;						// Z of the hole bottom (machine coordinates, mm)
+	float depth;						// G83 - depth reached by the last peck
+	float peck;							// G83 - peck increment (mm)
+	float dwell;						// G82 - dwell at the bottom (seconds)
+
+	float R_word;						// sticky R, Z, P and Q words for the series, in program units
+	float Z_word;
+	float P_word;
+	float Q_word;
+} cmDrill_t;
+
 /*****************************************************************************
  * CANONICAL MACHINE STRUCTURES
  */
@@ -466,7 +546,9 @@ typedef struct cmAxis {
 	float jerk_max;						// max jerk (Jm) in mm/min^3 divided by 1 million
 	float jerk_high;				    // high speed deceleration jerk (Jh) in mm/min^3 divided by 1 million
 	float recip_jerk;					// stored reciprocal of current jerk value - has the million in it
-	float junction_dev;					// aka cornering delta
+	float junction_jerk;				// stored jerk_max * junction_aggression - used for cornering velocity
+	float junction_dev;					// aka cornering delta - corner deviation in mm (deg), 0=off
+	float junction_dev_jerk;			// stored Jm * JD^2 with the million in it - used for cornering velocity
 	float radius;						// radius in mm for rotary axis modes
 
     uint8_t homing_input;               // set 1-N for homing input. 0 will disable homing
@@ -475,8 +557,22 @@ typedef struct cmAxis {
 	float latch_velocity;				// homing latch velocity
 	float latch_backoff;				// backoff sufficient to clear a switch
 	float zero_backoff;					// backoff from switches for machine zero
+#ifdef __INPUT_SHAPING
+	uint8_t shaper_type;				// input shaper - see shShaperType in plan_shaper.h
+	float shaper_frequency;				// resonance the shaper cancels (Hz)
+	float shaper_damping;				// damping ratio of the resonance
+#endif
+#ifdef __PRESSURE_ADVANCE
+	float pressure_advance;				// extruder lead per unit of extruder velocity (seconds)
+#endif
 } cfgAxis_t;
 
+typedef struct cmSoftLimit {			// an axis that soft limits are tested on
+	uint8_t axis;
+	float travel_min;
+	float travel_max;
+} cmSoftLimit_t;
+
 typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	magic_t magic_start;				// magic number to test memory integrity
 
@@ -485,9 +581,44 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	// system group settings
 	float junction_aggression;		    // how aggressively will the machine corner? 1.0 or so is about the upper limit
 	float chordal_tolerance;			// arc chordal accuracy setting in mm
+	float coalesce_angle;				// max direction change in degrees for merging feed moves (0 disables)
+	float planner_lookahead;			// planned time in ms to admit new input up to (0 disables)
+	float body_segment_time;			// segment time in us for constant velocity bodies
+	uint8_t smoothing_window;			// blocks to level the feed over in short segment runs (0 disables)
+#ifdef __VELOCITY_HINTS
+	bool velocity_hints;				// plan the newest block to its (VEX) exit hint, not to a stop
+#endif
 	bool soft_limit_enable;             // true to enable soft limit testing on Gcode inputs
     bool limit_enable;                  // true to enable limit switches (disabled is same as override)
     bool safety_interlock_enable;       // true to enable safety interlock system
+    uint8_t probe_input;                // digital input the probe is wired to, 1-N (G38.2 and the scanning probe)
+    uint8_t homing_concurrent;          // true to home independent axes after Z at the same time
+    float stall_warning;                // following error that starts slowing the feed, in steps (0 disables)
+    float stall_feed_step;              // feed override taken off per stall check
+#ifdef __ANALOG_INPUTS
+    uint8_t load_feed_input;            // analog input read as spindle load, 1-N (0 disables adaptive feed)
+    float load_feed_target;             // spindle load the adaptive feed holds, in the input's units
+    float load_feed_gain;               // factor change per second per unit of relative load error
+    float load_feed_min;                // adaptive feed factor limits
+    float load_feed_max;
+#endif
+#ifdef __TANGENTIAL_KNIFE
+    uint8_t tangent_axis;               // rotary axis turned to follow the XY direction, 1=A, 2=B, 3=C (0 disables)
+    float tangent_corner;               // turns over this many degrees are made in place before the move
+    float tangent_lift;                 // Z lift for a turn made in place (mm), 0 turns without lifting
+#endif
+#ifdef __TORCH_HEIGHT
+    uint8_t thc_input;                  // analog input read as arc voltage, 1-N (0 disables torch height control)
+    float thc_voltage;                  // arc voltage the torch height control holds
+    float thc_gain;                     // Z correction velocity per volt of error (mm/min per volt)
+    float thc_rate;                     // fastest Z correction (mm/min)
+    float thc_limit;                    // largest Z correction either way (mm)
+    float thc_antidive;                 // fraction of the cruise velocity below which the correction holds
+    float thc_delay;                    // seconds of cutting after the torch comes on before the correction starts
+#endif
+#ifdef __PATH_RETRACE
+    float retrace_velocity;             // velocity backing up along the path and returning (mm/min)
+#endif
 
 	// gcode power-on default settings - defaults are not the same as the gm state
 	cmCoordSystem default_coord_system;     // G10 active coordinate system default
@@ -498,6 +629,8 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 
 	// coordinate systems and offsets
 	float offset[COORDS+1][AXES];		// persistent coordinate offsets: absolute (G53) + G54,G55,G56,G57,G58,G59
+	float coord_offset[AXES];			// active G5x + G92 offset - see cm_refresh_coord_offset()
+	float units_scale;					// MM_PER_INCH in G20, 1 in G21
 
 	// settings for axes X,Y,Z,A B,C
 	cfgAxis_t a[AXES];
@@ -509,6 +642,8 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
     cmMachineState machine_state;	    // macs: machine/cycle/motion is the actual machine state
     cmCycleState cycle_state;           // cycs
     cmMotionState motion_state;         // momo
+	stat_t (*cycle_callback[CYCLE_CALLBACK_DEPTH])(void);	// active cycle callbacks, innermost last
+	uint8_t cycle_callbacks;			// number of them - see cm_set_cycle_callback()
 	cmFeedholdState hold_state;         // hold: feedhold state machine
 	cmQueueFlushState queue_flush_state;// master queue flush state machine
 
@@ -520,18 +655,40 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 
 	cmHomingState homing_state;			// home: homing cycle sub-state machine
 	uint8_t homed[AXES];				// individual axis homing flags
+	uint32_t warm_linenum;				// last line run before a warm restart, 0 if none - see cm_load_warm_restart()
+	bool model_only_offsets;			// offset changes set the model but aren't queued - see cm_set_model_only_offsets()
+	cmSoftLimit_t soft_limit[AXES];		// active soft limits - see cm_refresh_soft_limits()
+	uint8_t soft_limit_count;
 
 	cmProbeState probe_state;			// probing state machine (simple)
 	float probe_results[AXES];			// probing results
 
 	float jogging_dest;					// jogging direction as a relative move from current position
+	float jog_velocity[AXES];			// velocity jog vector in mm/min (machine coordinates)
+	uint32_t jog_velocity_time;			// SysTick time of the last velocity jog command
 
 	bool g28_flag;					    // true = complete a G28 move
 	bool g30_flag;					    // true = complete a G30 move
  	bool deferred_write_flag;		    // G10 data has changed (e.g. offsets) - flag to persist them
+	uint8_t deferred_write_axes[COORDS+1];	// per coordinate system: bitmask of axes with changed offsets
+	index_t offset_index[COORDS+1][AXES];	// cfgArray indexes of the offsets, resolved at init
 	bool end_hold_requested;			//
+	bool hold_pause_pending;			// hold started; spindle and coolant pause still to be run from the main loop
+	uint32_t hold_request_cycles;		// cycle count when the hold was requested
+	uint32_t hold_start_cycles;			// cycle count when the exec began the deceleration
+	float hold_latency;					// reported: request to start of deceleration (ms)
+	float hold_stop_distance;			// reported: path length from start of deceleration to stop (mm)
+	float hold_stop_time;				// reported: start of deceleration to motors stopped (ms)
     uint8_t limit_requested;            // set non-zero to request limit switch processing (value is input number)
     uint8_t shutdown_requested;         // set non-zero to request shutdown in support of external estop (value is input number)
+    volatile uint8_t following_error_requested; // set non-zero by the exec to request a following error alarm (value is motor number)
+    volatile bool spindle_sync_lost;    // set by the exec if the spindle index stops during synchronized motion
+    float stall_reduction;              // feed override currently taken off by stall detection
+    float stall_error;                  // peak following error seen by the previous stall check
+#ifdef __ANALOG_INPUTS
+    float load_feed_factor;             // adaptive feed factor applied with the feed override
+    float load_feed_planned;            // factor the queued blocks were last replanned for
+#endif
 
 	/**** Model states ****/
 	GCodeState_t *am;                   // active Gcode model is maintained by state management
@@ -566,6 +723,7 @@ uint8_t cm_get_jogging_state(void);
 void cm_set_motion_state(const cmMotionState motion_state);
 float cm_get_axis_jerk(const uint8_t axis);
 void cm_set_axis_jerk(const uint8_t axis, const float jerk);
+void cm_set_junction_jerk(const uint8_t axis);
 
 uint32_t cm_get_linenum(const GCodeState_t *gcode_state);
 uint8_t cm_get_motion_mode(const GCodeState_t *gcode_state);
@@ -585,9 +743,13 @@ void cm_set_motion_mode(GCodeState_t *gcode_state, const uint8_t motion_mode);
 void cm_set_tool_number(GCodeState_t *gcode_state, const uint8_t tool);
 void cm_set_absolute_override(GCodeState_t *gcode_state, const uint8_t absolute_override);
 void cm_set_model_linenum(const uint32_t linenum);
+#ifdef __VELOCITY_HINTS
+void cm_set_model_exit_hint(const float exit_hint);
+#endif
 
 // Coordinate systems and offsets
 float cm_get_active_coord_offset(const uint8_t axis);
+void cm_refresh_coord_offset(void);
 float cm_get_work_offset(const GCodeState_t *gcode_state, const uint8_t axis);
 void cm_set_work_offsets(GCodeState_t *gcode_state);
 float cm_get_absolute_position(const GCodeState_t *gcode_state, const uint8_t axis);
@@ -598,7 +760,9 @@ void cm_update_model_position_from_runtime(void);
 void cm_finalize_move(void);
 stat_t cm_deferred_write_callback(void);
 void cm_set_model_target(const float target[], const bool flag[]);
+void cm_refresh_soft_limits(void);
 stat_t cm_test_soft_limits(const float target[]);
+stat_t cm_test_soft_limit_box(const float box_min[], const float box_max[]);
 
 /*--- Canonical machining functions (loosely) defined by NIST [organized by NIST Gcode doc] ---*/
 
@@ -607,6 +771,10 @@ void canonical_machine_init(void);
 void canonical_machine_reset(void);
 void canonical_machine_init_assertions(void);
 stat_t canonical_machine_test_assertions(void);
+#ifdef __WATCHDOG
+void cm_save_warm_restart(void);
+void cm_load_warm_restart(void);
+#endif
 
 // Alarms and state management
 stat_t cm_alrm(nvObj_t *nv);                                    // trigger alarm from command input
@@ -627,6 +795,7 @@ stat_t cm_select_plane(const uint8_t plane);                    // G17, G18, G19
 stat_t cm_set_units_mode(const uint8_t mode);                   // G20, G21
 stat_t cm_set_distance_mode(const uint8_t mode);                // G90, G91
 stat_t cm_set_arc_distance_mode(const uint8_t mode);            // G90.1, G91.1
+stat_t cm_set_retract_mode(const uint8_t mode);                 // G98, G99
 stat_t cm_set_coord_offsets(const uint8_t coord_system,         // G10
                             const uint8_t L_word,
                             const float offset[], const bool flag[]);
@@ -636,6 +805,7 @@ stat_t cm_set_absolute_origin(const float origin[], bool flag[]);           // G
 void cm_set_axis_origin(uint8_t axis, const float position);	            // G28.3 planner callback
 
 stat_t cm_set_coord_system(const uint8_t coord_system);                     // G54 - G59
+void cm_set_model_only_offsets(const bool model_only);
 stat_t cm_set_origin_offsets(const float offset[], const bool flag[]);      // G92
 stat_t cm_reset_origin_offsets(void);                                       // G92.1
 stat_t cm_suspend_origin_offsets(void);                                     // G92.2
@@ -647,14 +817,20 @@ stat_t cm_set_g28_position(void);                                           // G
 stat_t cm_goto_g28_position(const float target[], const bool flags[]);      // G28
 stat_t cm_set_g30_position(void);                                           // G30.1
 stat_t cm_goto_g30_position(const float target[], const bool flags[]);      // G30
+stat_t cm_resume_traverse(const float position[]);                          // start at line: clear Z and go over the resume point
+stat_t cm_resume_plunge(const float position[]);                            // start at line: down onto the resume point
 
 // Machining Attributes (4.3.5)
 stat_t cm_set_feed_rate(const float feed_rate);                             // F parameter
 stat_t cm_set_feed_rate_mode(const uint8_t mode);                           // G93, G94, (G95 unimplemented)
-stat_t cm_set_path_control(const uint8_t mode);                             // G61, G61.1, G64
+stat_t cm_set_path_control(const uint8_t mode, const float tolerance);      // G61, G61.1, G64 P
 
 // Machining Functions (4.3.6)
 stat_t cm_straight_feed(const float target[], const bool flags[]);          // G1
+#ifdef __BINARY_DATA
+stat_t cm_machine_feed(const float target[], const uint8_t motion_mode,     // precompiled move
+                       const float feed_rate, const uint32_t linenum);
+#endif
 stat_t cm_dwell(const float seconds);                                       // G4, P parameter
 
 stat_t cm_arc_feed(const float target[], const bool target_f[],             // G2/G3 - target endpoint
@@ -663,6 +839,21 @@ stat_t cm_arc_feed(const float target[], const bool target_f[],             // G
                    const float P_word, const bool P_word_f,                 // parameter
                    const bool modal_g1_f,                                   // modal group flag for motion group
                    const uint8_t motion_mode);                              // defined motion mode
+stat_t cm_spline_feed(const float target[], const bool target_f[],          // G5/G5.1 - target endpoint
+                      const float offset[], const bool offset_f[],          // IJ first control point offset
+                      const float P_word, const bool P_word_f,              // PQ second control point offset
+                      const float Q_word, const bool Q_word_f,
+                      const uint8_t motion_mode);                           // cubic or quadratic
+stat_t cm_drill_cycle(const float target[], const bool target_f[],          // G81/G82/G83 - hole XY and bottom Z
+                      const float R_word, const bool R_word_f,              // R plane
+                      const float P_word, const bool P_word_f,              // G82 dwell
+                      const float Q_word, const bool Q_word_f,              // G83 peck increment
+                      const uint8_t L_word, const bool L_word_f,            // repeats
+                      const uint8_t motion_mode);
+stat_t cm_spindle_sync_feed(const float target[], const bool target_f[],    // G33 - target endpoint
+                            const float K_word, const bool K_word_f);       // pitch - travel per revolution
+stat_t cm_rigid_tap(const float target[], const bool target_f[],            // G33.1 - bottom of the hole
+                    const float K_word, const bool K_word_f);               // thread pitch
 
 // Spindle Functions (4.3.7)
 // see spindle.h for spindle functions - which would go right here
@@ -673,6 +864,11 @@ stat_t cm_change_tool(const uint8_t tool);                                  // M
 
 // Miscellaneous Functions (4.3.9)
 // see coolant.h for coolant functions - which would go right here
+#ifdef __MOTION_OUTPUTS
+stat_t cm_output_control(const uint8_t mcode,                               // M62, M63, M64, M65
+                         const float P_word, const bool P_word_f,           // output
+                         const float Q_word, const bool Q_word_f);          // distance along the path
+#endif
 /*
 stat_t cm_override_enables(uint8_t flag);                       // M48, M49
 stat_t cm_feed_rate_override_enable(uint8_t flag);              // M50
@@ -680,6 +876,28 @@ stat_t cm_feed_rate_override_factor(uint8_t flag);              // M50.1
 stat_t cm_traverse_override_enable(uint8_t flag);               // M50.2
 stat_t cm_traverse_override_factor(uint8_t flag);               // M50.3
 */
+float cm_get_override_factor(const uint8_t motion_mode);        // realtime feed or traverse override
+void cm_request_override(const char c);                         // realtime override characters
+stat_t cm_stall_detection_callback(void);                       // slow the feed on following error
+#ifdef __ANALOG_INPUTS
+stat_t cm_load_feed_callback(void);                             // adaptive feed from spindle load
+stat_t cm_get_lfo(nvObj_t *nv);
+stat_t cm_set_lfi(nvObj_t *nv);
+stat_t cm_set_lft(nvObj_t *nv);
+stat_t cm_set_lfm(nvObj_t *nv);
+stat_t cm_set_lfx(nvObj_t *nv);
+#endif
+#ifdef __TANGENTIAL_KNIFE
+stat_t cm_set_tna(nvObj_t *nv);
+#endif
+#ifdef __TORCH_HEIGHT
+stat_t cm_get_tho(nvObj_t *nv);
+stat_t cm_set_thi(nvObj_t *nv);
+#endif
+#ifdef __PATH_RETRACE
+stat_t cm_get_rtr(nvObj_t *nv);
+stat_t cm_set_rtr(nvObj_t *nv);
+#endif
 void cm_message(const char *message);                           // msg to console (e.g. Gcode comments)
 
 // Program Functions (4.3.10)
@@ -705,6 +923,9 @@ void cm_program_end(void);										// M2
 
 /*--- Cycles ---*/
 
+void cm_set_cycle_callback(stat_t (*callback)(void));			// make a cycle the one the main loop runs
+stat_t cm_cycle_callback(void);									// main loop callback - runs the active cycle
+
 // Homing cycles
 stat_t cm_homing_cycle_start(void);								// G28.2
 stat_t cm_homing_cycle_start_no_set(void);						// G28.4
@@ -713,11 +934,28 @@ stat_t cm_homing_cycle_callback(void);							// G28.2/.4 main loop callback
 // Probe cycles
 stat_t cm_straight_probe(float target[], bool flags[]);         // G38.2
 stat_t cm_probing_cycle_callback(void);							// G38.2 main loop callback
+#ifdef __HEIGHT_MAP
+stat_t cm_height_map_start(void);								// {"mshp":1}
+stat_t cm_height_map_callback(void);							// height map grid main loop callback
+#endif
+#ifdef __PROBE_SCAN
+void cm_probe_scan_point(const bool contact);					// record a scanning probe edge - from the input interrupt
+stat_t cm_probe_scan_callback(void);							// send the recorded points on the data channel
+#endif
 
 // Jogging cycle
 stat_t cm_jogging_cycle_callback(void);							// jogging cycle main loop
 stat_t cm_jogging_cycle_start(uint8_t axis);					// {"jogx":-100.3}
 float cm_get_jogging_dest(void);
+stat_t cm_jogging_velocity_start(void);							// {"jgvx":1200}
+
+// Batched straight feeds
+stat_t cm_batch_callback(void);									// {"mv":[...]} main loop callback
+void cm_abort_batch(void);
+
+// Canned drilling cycles
+stat_t cm_drill_callback(void);									// G81, G82, G83 main loop callback
+void cm_abort_drill(void);
 
 /*--- cfgArray interface functions ---*/
 
@@ -746,10 +984,17 @@ stat_t cm_get_vel(nvObj_t *nv);			// get runtime velocity...
 stat_t cm_get_feed(nvObj_t *nv);		// get feed rate, converted to units
 stat_t cm_get_pos(nvObj_t *nv);			// get runtime work position...
 stat_t cm_get_mpo(nvObj_t *nv);			// get runtime machine position...
+stat_t cm_get_mpe(nvObj_t *nv);			// get measured (encoder) machine position...
 stat_t cm_get_ofs(nvObj_t *nv);			// get runtime work offset...
 
 stat_t cm_run_qf(nvObj_t *nv);			// run queue flush
+stat_t cm_run_mv(nvObj_t *nv);			// queue a batch of straight feeds
 stat_t cm_run_home(nvObj_t *nv);		// start homing cycle
+stat_t cm_get_dry(nvObj_t *nv);			// get dry plan job time so far
+stat_t cm_run_dry(nvObj_t *nv);			// start or end a dry plan
+#ifdef __WATCHDOG
+stat_t cm_get_warm(nvObj_t *nv);		// get the last line run before a warm restart
+#endif
 
 stat_t cm_dam(nvObj_t *nv);				// dump active model (debugging command)
 
@@ -757,14 +1002,40 @@ stat_t cm_run_jogx(nvObj_t *nv);		// start jogging cycle for x
 stat_t cm_run_jogy(nvObj_t *nv);		// start jogging cycle for y
 stat_t cm_run_jogz(nvObj_t *nv);		// start jogging cycle for z
 stat_t cm_run_joga(nvObj_t *nv);		// start jogging cycle for a
+stat_t cm_set_prbi(nvObj_t *nv);		// set the probe input
+#ifdef __HEIGHT_MAP
+stat_t cm_run_mshp(nvObj_t *nv);		// start the height map grid probe
+#endif
+#ifdef __PROBE_SCAN
+stat_t cm_get_scan(nvObj_t *nv);		// get the points recorded by the scanning probe
+stat_t cm_set_scan(nvObj_t *nv);		// start (1) or stop (0) the scanning probe
+#endif
+stat_t cm_set_jgv(nvObj_t *nv);			// set velocity jog component and start/refresh velocity jog
+stat_t cm_set_mfo(nvObj_t *nv);			// set feed override factor
+stat_t cm_set_mto(nvObj_t *nv);			// set traverse override factor
 
 stat_t cm_get_am(nvObj_t *nv);			// get axis mode
 stat_t cm_set_am(nvObj_t *nv);			// set axis mode
 stat_t cm_set_hi(nvObj_t *nv);          // set homing input
+stat_t cm_set_travel(nvObj_t *nv);      // set travel min or max
+stat_t cm_set_hom(nvObj_t *nv);         // set axis homed flag
+stat_t cm_set_sl(nvObj_t *nv);          // set soft limit enable
+stat_t cm_set_cofs(nvObj_t *nv);        // set a G54-G59 coordinate offset
 
 stat_t cm_set_ja(nvObj_t *nv);			// set junction aggression with 1,000,000 correction
+stat_t cm_set_bst(nvObj_t *nv);			// set body segment time within segment time limits
 stat_t cm_set_jm(nvObj_t *nv);			// set jerk max with 1,000,000 correction
 stat_t cm_set_jh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
+stat_t cm_set_jd(nvObj_t *nv);			// set junction deviation
+stat_t cm_set_vm(nvObj_t *nv);			// set velocity max or feed rate max
+#ifdef __INPUT_SHAPING
+stat_t cm_set_ist(nvObj_t *nv);			// set input shaper type
+stat_t cm_set_isf(nvObj_t *nv);			// set input shaper frequency
+stat_t cm_set_isd(nvObj_t *nv);			// set input shaper damping ratio
+#endif
+#ifdef __PRESSURE_ADVANCE
+stat_t cm_set_pa(nvObj_t *nv);			// set extruder pressure advance
+#endif
 
 /*--- text_mode support functions ---*/
 
@@ -801,13 +1072,47 @@ stat_t cm_set_jh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	void cm_print_lin(nvObj_t *nv);		// generic print for linear values
 	void cm_print_pos(nvObj_t *nv);		// print runtime work position in prevailing units
 	void cm_print_mpo(nvObj_t *nv);		// print runtime work position always in MM uints
+	void cm_print_mpe(nvObj_t *nv);		// print measured machine position always in MM uints
 	void cm_print_ofs(nvObj_t *nv);		// print runtime work offset always in MM uints
 
 	void cm_print_ja(nvObj_t *nv);		// global CM settings
 	void cm_print_ct(nvObj_t *nv);
+	void cm_print_ca(nvObj_t *nv);
+	void cm_print_la(nvObj_t *nv);
+	void cm_print_bst(nvObj_t *nv);
+	void cm_print_sw(nvObj_t *nv);
+	void cm_print_vh(nvObj_t *nv);
 	void cm_print_sl(nvObj_t *nv);
 	void cm_print_lim(nvObj_t *nv);
 	void cm_print_saf(nvObj_t *nv);
+	void cm_print_prbi(nvObj_t *nv);
+	void cm_print_hmc(nvObj_t *nv);
+	void cm_print_few(nvObj_t *nv);
+	void cm_print_fes(nvObj_t *nv);
+	void cm_print_lfi(nvObj_t *nv);
+	void cm_print_lft(nvObj_t *nv);
+	void cm_print_lfg(nvObj_t *nv);
+	void cm_print_lfm(nvObj_t *nv);
+	void cm_print_lfx(nvObj_t *nv);
+	void cm_print_lfo(nvObj_t *nv);
+	void cm_print_tna(nvObj_t *nv);
+	void cm_print_tnc(nvObj_t *nv);
+	void cm_print_tnl(nvObj_t *nv);
+	void cm_print_thi(nvObj_t *nv);
+	void cm_print_thv(nvObj_t *nv);
+	void cm_print_thg(nvObj_t *nv);
+	void cm_print_thr(nvObj_t *nv);
+	void cm_print_thl(nvObj_t *nv);
+	void cm_print_tha(nvObj_t *nv);
+	void cm_print_thd(nvObj_t *nv);
+	void cm_print_tho(nvObj_t *nv);
+	void cm_print_rtv(nvObj_t *nv);
+	void cm_print_rtr(nvObj_t *nv);
+	void cm_print_fhd(nvObj_t *nv);
+	void cm_print_fht(nvObj_t *nv);
+	void cm_print_fhl(nvObj_t *nv);
+	void cm_print_mfo(nvObj_t *nv);
+	void cm_print_mto(nvObj_t *nv);
 	void cm_print_ml(nvObj_t *nv);
 	void cm_print_ma(nvObj_t *nv);
 	void cm_print_ms(nvObj_t *nv);
@@ -829,6 +1134,10 @@ stat_t cm_set_jh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	void cm_print_lv(nvObj_t *nv);
 	void cm_print_lb(nvObj_t *nv);
 	void cm_print_zb(nvObj_t *nv);
+	void cm_print_ist(nvObj_t *nv);
+	void cm_print_isf(nvObj_t *nv);
+	void cm_print_isd(nvObj_t *nv);
+	void cm_print_pa(nvObj_t *nv);
 	void cm_print_cofs(nvObj_t *nv);
 	void cm_print_cpos(nvObj_t *nv);
 
@@ -865,13 +1174,47 @@ stat_t cm_set_jh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	#define cm_print_lin tx_print_stub		// generic print for linear values
 	#define cm_print_pos tx_print_stub		// print runtime work position in prevailing units
 	#define cm_print_mpo tx_print_stub		// print runtime work position always in MM uints
+	#define cm_print_mpe tx_print_stub
 	#define cm_print_ofs tx_print_stub		// print runtime work offset always in MM uints
 
 	#define cm_print_ja tx_print_stub		// global CM settings
 	#define cm_print_ct tx_print_stub
+	#define cm_print_ca tx_print_stub
+	#define cm_print_la tx_print_stub
+	#define cm_print_bst tx_print_stub
+	#define cm_print_sw tx_print_stub
+	#define cm_print_vh tx_print_stub
 	#define cm_print_sl tx_print_stub
 	#define cm_print_lim tx_print_stub
 	#define cm_print_saf tx_print_stub
+	#define cm_print_prbi tx_print_stub
+	#define cm_print_hmc tx_print_stub
+	#define cm_print_few tx_print_stub
+	#define cm_print_fes tx_print_stub
+	#define cm_print_lfi tx_print_stub
+	#define cm_print_lft tx_print_stub
+	#define cm_print_lfg tx_print_stub
+	#define cm_print_lfm tx_print_stub
+	#define cm_print_lfx tx_print_stub
+	#define cm_print_lfo tx_print_stub
+	#define cm_print_tna tx_print_stub
+	#define cm_print_tnc tx_print_stub
+	#define cm_print_tnl tx_print_stub
+	#define cm_print_thi tx_print_stub
+	#define cm_print_thv tx_print_stub
+	#define cm_print_thg tx_print_stub
+	#define cm_print_thr tx_print_stub
+	#define cm_print_thl tx_print_stub
+	#define cm_print_tha tx_print_stub
+	#define cm_print_thd tx_print_stub
+	#define cm_print_tho tx_print_stub
+	#define cm_print_rtv tx_print_stub
+	#define cm_print_rtr tx_print_stub
+	#define cm_print_fhd tx_print_stub
+	#define cm_print_fht tx_print_stub
+	#define cm_print_fhl tx_print_stub
+	#define cm_print_mfo tx_print_stub
+	#define cm_print_mto tx_print_stub
 	#define cm_print_ml tx_print_stub
 	#define cm_print_ma tx_print_stub
 	#define cm_print_ms tx_print_stub
@@ -893,6 +1236,10 @@ stat_t cm_set_jh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	#define cm_print_lv tx_print_stub
 	#define cm_print_lb tx_print_stub
 	#define cm_print_zb tx_print_stub
+	#define cm_print_ist tx_print_stub
+	#define cm_print_isf tx_print_stub
+	#define cm_print_isd tx_print_stub
+	#define cm_print_pa tx_print_stub
 	#define cm_print_cofs tx_print_stub
 	#define cm_print_cpos tx_print_stub
 
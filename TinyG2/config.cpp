@@ -109,13 +109,6 @@ void config_init()
 	config_init_assertions();
 	cs.comm_mode = JSON_MODE;					// initial value until persistence is read
 
-#ifdef __ARM
-// ++++ The following code is offered until persistence is implemented.
-// ++++ Then you can use the AVR code (or something like it)
-	_set_defa(nv, false);
-    rpt_print_loading_configs_message();
-#endif
-#ifdef __AVR
 	cm_set_units_mode(MILLIMETERS);				// must do inits in millimeter mode
 	nv->index = 0;								// this will read the first record in NVM
 
@@ -127,14 +120,13 @@ void config_init()
 //		rpt_print_loading_configs_message();
 		for (nv->index=0; nv_index_is_single(nv->index); nv->index++) {
 			if (GET_TABLE_BYTE(flags) & F_INITIALIZE) {
-				strncpy_P(nv->token, cfgArray[nv->index].token, TOKEN_LEN);	// read the token from the array
+				nv_set_index(nv, nv->index, false);	// name it with the token from the array
 				read_persistent_value(nv);
 				nv_set(nv);
 			}
 		}
 		sr_init_status_report();
 	}
-#endif
 }
 
 /*
@@ -148,9 +140,12 @@ static void _set_defa(nvObj_t *nv, bool print)
 	for (nv->index=0; nv_index_is_single(nv->index); nv->index++) {
 		if (GET_TABLE_BYTE(flags) & F_INITIALIZE) {
 			nv->value = GET_TABLE_FLOAT(def_value);
-			strncpy_P(nv->token, cfgArray[nv->index].token, TOKEN_LEN);
+			nv_set_index(nv, nv->index, false);
 			nv_set(nv);
 			nv_persist(nv);
+#ifdef __WATCHDOG
+			hw_watchdog_feed();					// the flash writes can outlast the watchdog
+#endif
 		}
 	}
 	sr_init_status_report();					// reset status reports
@@ -168,13 +163,217 @@ stat_t set_defaults(nvObj_t *nv)
 	// The nvlist was used for the initialize message so the values are all garbage
 	// Mark the nv as $defa so it displays nicely in the response
 	nv_reset_nv_list();
-	strncpy(nv->token, "defa", TOKEN_LEN);
-//	nv->index = nv_get_index("", nv->token);	// correct, but not required
+	nv->name = "defa";
+//	nv->index = nv_get_index("", nv->name);	// correct, but not required
 	nv->valuetype = TYPE_INT;
 	nv->value = 1;
 	return (STAT_OK);
 }
 
+/*
+ * config_get_snapshot() - print all persisted values as one base32 blob
+ * config_set_snapshot() - load a blob produced by config_get_snapshot()
+ *
+ *	The snapshot is a packed binary image of every F_PERSIST value in cfgArray order:
+ *
+ *		uint8_t  version		CFG_SNAPSHOT_VERSION
+ *		uint8_t  reserved		0
+ *		uint16_t count			number of values that follow
+ *		uint32_t hash			FNV-1a hash of the persisted tokens, in table order
+ *		float    values[count]
+ *
+ *	All fields are little-endian. A snapshot only loads into firmware with the same
+ *	table layout - the hash catches tables that have gained, lost or moved settings.
+ *
+ *	{"cfg":null} returns {"cfg":"<base32>"}. A line is limited to USB_LINE_BUFFER_SIZE,
+ *	so the host sends the blob back as a series of {"cfg":"<base32>"} chunks, each a
+ *	multiple of 8 characters. The blob is base32 (RFC 4648) rather than base64 because
+ *	the JSON parser lowercases its input, and base32 decodes the same in either case.
+ *	Chunks are staged in RAM; nothing is applied until the
+ *	complete blob has arrived and the header checks out. Then every value is set and
+ *	persisted in one pass, the same way as $defa. {"cfg":0} discards a partial upload.
+ */
+
+static struct cfgSnapshot {
+	uint16_t len;								// bytes staged so far
+	uint8_t buf[CFG_SNAPSHOT_HEADER_LEN + CFG_SNAPSHOT_MAX_VALUES * 4];
+} snap;
+
+static const char b32_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ234567";
+
+static uint32_t _snapshot_layout(uint16_t *count)
+{
+	char token[TOKEN_LEN+1];
+	uint32_t hash = 2166136261UL;
+
+	*count = 0;
+	for (index_t i=0; nv_index_is_single(i); i++) {
+		if (!(GET_TOKEN_BYTE(flags) & F_PERSIST)) continue;
+		strncpy_P(token, cfgArray[i].token, TOKEN_LEN);
+		token[TOKEN_LEN] = NUL;
+		for (char *c = token; ; c++) {			// include the terminator so "ab","c" != "a","bc"
+			hash = (hash ^ (uint8_t)*c) * 16777619UL;
+			if (*c == NUL) break;
+		}
+		(*count)++;
+	}
+	return (hash);
+}
+
+static void _b32_put(uint8_t *group, uint8_t len)
+{
+	uint64_t bits = 0;
+	for (uint8_t i=0; i<5; i++) { bits = (bits << 8) | group[i]; }
+	uint8_t chars = (len * 8 + 4) / 5;				// 1,2,3,4,5 bytes take 2,4,5,7,8 characters
+	char out[9];
+	for (uint8_t i=0; i<8; i++) {
+		out[i] = (i < chars) ? b32_chars[(bits >> (35 - 5*i)) & 0x1F] : '=';
+	}
+	out[8] = NUL;
+	printf_P(PSTR("%s"), out);
+}
+
+static void _b32_byte(uint8_t *group, uint8_t *len, uint8_t byte)
+{
+	group[(*len)++] = byte;
+	if (*len == 5) {
+		_b32_put(group, 5);
+		*len = 0;
+	}
+}
+
+static int8_t _b32_value(char c)
+{
+	const char *p = strchr(b32_chars, toupper(c));
+	return ((p == NULL || c == NUL) ? -1 : (int8_t)(p - b32_chars));
+}
+
+stat_t config_get_snapshot(nvObj_t *nv)
+{
+	uint16_t count;
+	uint32_t hash = _snapshot_layout(&count);
+	uint8_t header[CFG_SNAPSHOT_HEADER_LEN] = { CFG_SNAPSHOT_VERSION, 0,
+		(uint8_t)count, (uint8_t)(count >> 8),
+		(uint8_t)hash, (uint8_t)(hash >> 8), (uint8_t)(hash >> 16), (uint8_t)(hash >> 24) };
+	uint8_t group[5];
+	uint8_t len = 0;
+	nvObj_t rd;
+
+	printf_P(PSTR("{\"cfg\":\""));
+	for (uint8_t i=0; i<CFG_SNAPSHOT_HEADER_LEN; i++) { _b32_byte(group, &len, header[i]); }
+	for (index_t i=0; nv_index_is_single(i); i++) {
+		if (!(GET_TOKEN_BYTE(flags) & F_PERSIST)) continue;
+		rd.index = i;
+		read_persistent_value(&rd);
+		uint8_t bytes[4];
+		memcpy(bytes, &rd.value, 4);
+		for (uint8_t b=0; b<4; b++) { _b32_byte(group, &len, bytes[b]); }
+	}
+	if (len != 0) {
+		memset(&group[len], 0, 5 - len);
+		_b32_put(group, len);
+	}
+	printf_P(PSTR("\"}\n"));
+	nv->value = count;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+static stat_t _snapshot_apply()
+{
+	nvObj_t scratch;							// a local object, so the caller's nv keeps the response
+	nvObj_t *nv = &scratch;
+	nv->pv = NULL;
+	nv->nx = NULL;
+	nv_reset_nv(nv);
+	uint16_t count;
+	uint32_t hash = _snapshot_layout(&count);
+	uint8_t *p = snap.buf;
+
+	if ((p[0] != CFG_SNAPSHOT_VERSION) ||
+		(((uint16_t)p[2] | ((uint16_t)p[3] << 8)) != count) ||
+		(((uint32_t)p[4] | ((uint32_t)p[5] << 8) | ((uint32_t)p[6] << 16) | ((uint32_t)p[7] << 24)) != hash)) {
+		return (STAT_PERSISTENCE_ERROR);		// snapshot is from a different table layout
+	}
+	uint8_t units = cm_get_units_mode(MODEL);
+	cm_set_units_mode(MILLIMETERS);				// persisted values are in MM
+	p += CFG_SNAPSHOT_HEADER_LEN;
+	for (nv->index=0; nv_index_is_single(nv->index); nv->index++) {
+		if (!(GET_TABLE_BYTE(flags) & F_PERSIST)) continue;
+		memcpy(&nv->value, p, 4);
+		p += 4;
+		nv_set_index(nv, nv->index, false);
+		nv->valuetype = TYPE_FLOAT;
+		nv_set(nv);
+		nv_persist(nv);
+#ifdef __WATCHDOG
+		hw_watchdog_feed();						// the flash writes can outlast the watchdog
+#endif
+	}
+	cm_set_units_mode(units);
+	sr_init_status_report();
+	return (STAT_OK);
+}
+
+stat_t config_set_snapshot(nvObj_t *nv)
+{
+	if (nv->valuetype != TYPE_STRING) {			// any non-string value cancels an upload
+		snap.len = 0;
+		nv->valuetype = TYPE_NULL;
+		return (STAT_OK);
+	}
+	if (cm.cycle_state != CYCLE_OFF) {
+		snap.len = 0;
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	char *src = *nv->stringp;
+	if (strlen(src) % 8 != 0) {
+		snap.len = 0;
+		return (STAT_BAD_NUMBER_FORMAT);
+	}
+	for (; *src != NUL; src += 8) {
+		uint64_t bits = 0;
+		uint8_t chars = 0;								// characters before the padding
+		for (uint8_t i=0; i<8; i++) {
+			int8_t v = 0;
+			if (src[i] != '=') {
+				if ((v = _b32_value(src[i])) < 0) {
+					snap.len = 0;
+					return (STAT_BAD_NUMBER_FORMAT);
+				}
+				chars++;
+			}
+			bits = (bits << 5) | (uint8_t)v;
+		}
+		uint8_t bytes = chars * 5 / 8;
+		for (uint8_t i=0; i<bytes; i++) {
+			if (snap.len >= sizeof(snap.buf)) {
+				snap.len = 0;
+				return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+			}
+			snap.buf[snap.len++] = (uint8_t)(bits >> (32 - 8*i));
+		}
+	}
+
+	// report progress until the whole blob has been staged
+	uint32_t expected = CFG_SNAPSHOT_HEADER_LEN;
+	if (snap.len >= CFG_SNAPSHOT_HEADER_LEN) {
+		expected += 4 * ((uint32_t)snap.buf[2] | ((uint32_t)snap.buf[3] << 8));
+	}
+	nv->valuetype = TYPE_INT;
+	nv->value = snap.len;
+	if (snap.len < expected) return (STAT_OK);
+	if (snap.len > expected) {
+		snap.len = 0;
+		return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+	}
+	snap.len = 0;
+	stat_t status = _snapshot_apply();
+	nv->valuetype = TYPE_INT;
+	nv->value = (status == STAT_OK) ? expected : 0;
+	return (status);
+}
+
 /*
  * config_init_assertions()
  * config_test_assertions() - check memory integrity of config sub-system
@@ -368,17 +567,82 @@ stat_t set_flt(nvObj_t *nv)
  *
  *	The sys group is an exception where the children carry a blank group field, even though
  *	the sys parent is labeled as a TYPE_PARENT.
+ *
+ *	A group with more children than the body holds (NV_MAX_OBJECTS) returns the ones that fit
+ *	with STAT_JSON_TOO_MANY_PAIRS, so a short read is never mistaken for the whole group.
+ */
+
+/*
+ * Group index
+ *
+ *	Expanding a group used to scan every single-valued cfgArray entry and compare its group
+ *	string. Now cfgGroupIndex[] holds the indexes of the single-valued entries, sorted by
+ *	group and then by index. A group's children are a run in it, found by binary search, so
+ *	expansion only touches the entries it returns, in table order. Like the token index it's
+ *	built the first time it's needed (~2 bytes RAM per single-valued entry).
+ *
+ * _group_cmp()		 - strcmp() of a RAM string against the group of cfgArray[i]
+ * _build_group_index() - shell sort the single-valued cfgArray indexes into cfgGroupIndex[]
  */
+static index_t group_index_len = 0;				// 0 until the index is built
+
+static int8_t _group_cmp(const char *str, index_t i)
+{
+	char c;
+	for (uint8_t j=0; j < GROUP_LEN+1; j++) {
+		c = GET_TOKEN_BYTE(group[j]);
+		if (str[j] != c) return ((str[j] < c) ? -1 : 1);
+		if (c == NUL) break;
+	}
+	return (0);
+}
+
+static bool _group_index_lt(index_t a, index_t b)
+{
+	char str[GROUP_LEN+1];
+	strcpy_P(str, cfgArray[a].group);
+	int8_t cmp = _group_cmp(str, b);
+	return ((cmp < 0) || ((cmp == 0) && (a < b)));
+}
+
+static void _build_group_index()
+{
+	index_t len, gap, i, j, k;
+
+	for (len=0; nv_index_is_single(len); len++) { cfgGroupIndex[len] = len; }
+	for (gap = len/2; gap > 0; gap /= 2) {
+		for (i = gap; i < len; i++) {
+			k = cfgGroupIndex[i];
+			for (j = i; (j >= gap) && _group_index_lt(k, cfgGroupIndex[j-gap]); j -= gap) {
+				cfgGroupIndex[j] = cfgGroupIndex[j-gap];
+			}
+			cfgGroupIndex[j] = k;
+		}
+	}
+	group_index_len = len;
+}
 
 stat_t get_grp(nvObj_t *nv)
 {
-	char *parent_group = nv->token;				// token in the parent nv object is the group
-	char group[GROUP_LEN+1];						// group string retrieved from cfgArray child
+	char parent_group[TOKEN_LEN+1];				// token in the parent nv object is the group
+	strcpy(parent_group, nv_token(nv));			// (copied - the getters may name other objects)
 	nv->valuetype = TYPE_PARENT;					// make first object the parent
-	for (index_t i=0; nv_index_is_single(i); i++) {
-		strcpy_P(group, cfgArray[i].group);			// don't need strncpy as it's always terminated
-		if (strcmp(parent_group, group) != 0) continue;
-		(++nv)->index = i;
+
+	if (group_index_len == 0) { _build_group_index(); }
+
+	index_t lo = 0;								// lower bound search for the first child
+	index_t hi = group_index_len;
+	index_t mid;
+
+	while (lo < hi) {
+		mid = lo + (hi-lo)/2;
+		if (_group_cmp(parent_group, cfgGroupIndex[mid]) > 0) { lo = mid+1; } else { hi = mid; }
+	}
+	for (uint8_t n=0; (lo < group_index_len) && (_group_cmp(parent_group, cfgGroupIndex[lo]) == 0); lo++) {
+		if (++n > NV_MAX_OBJECTS) {					// the body is full - see NV_BODY_LEN
+			return (STAT_JSON_TOO_MANY_PAIRS);		// the children that fit are still returned
+		}
+		(++nv)->index = cfgGroupIndex[lo];
 		nv_get_nvObj(nv);
 	}
 	return (STAT_OK);
@@ -420,31 +684,76 @@ stat_t set_grp(nvObj_t *nv)
 
 /* nv_get_index() - get index from mnenonic token + group
  *
- * nv_get_index() is the most expensive routine in the whole config. It does a
- * linear table scan of the PROGMEM strings, which of course could be further
- * optimized with indexes or hashing.
+ * nv_get_index() used to be the most expensive routine in the whole config - a
+ * linear scan of the PROGMEM token strings. It now does a binary search of
+ * cfgTokenIndex[], which holds the cfgArray indexes sorted by token. The index
+ * is built the first time it's needed (~2 bytes RAM per cfgArray entry).
+ *
+ * Tokens match on their first 5 characters, as the original scan did. Equal
+ * tokens (there should be none) sort by index so the lowest index still wins.
+ *
+ * _token_cmp()		 - strncmp() of a RAM string against the token of cfgArray[i]
+ * _build_token_index() - shell sort the cfgArray indexes into cfgTokenIndex[]
  */
-index_t nv_get_index(const char *group, const char *token)
+#define TOKEN_MATCH_LEN 5
+
+static bool token_index_ready = false;
+
+static int8_t _token_cmp(const char *str, index_t i)
 {
 	char c;
+	for (uint8_t j=0; j < TOKEN_MATCH_LEN; j++) {
+		c = GET_TOKEN_BYTE(token[j]);
+		if (str[j] != c) return ((str[j] < c) ? -1 : 1);
+		if (c == NUL) break;
+	}
+	return (0);
+}
+
+static bool _token_index_lt(index_t a, index_t b)
+{
+	char str[TOKEN_LEN+1];
+	GET_TOKEN_STRING(a, str);
+	int8_t cmp = _token_cmp(str, b);
+	return ((cmp < 0) || ((cmp == 0) && (a < b)));
+}
+
+static void _build_token_index()
+{
+	index_t index_max = nv_index_max();
+	index_t gap, i, j, k;
+
+	for (i=0; i < index_max; i++) { cfgTokenIndex[i] = i; }
+	for (gap = index_max/2; gap > 0; gap /= 2) {
+		for (i = gap; i < index_max; i++) {
+			k = cfgTokenIndex[i];
+			for (j = i; (j >= gap) && _token_index_lt(k, cfgTokenIndex[j-gap]); j -= gap) {
+				cfgTokenIndex[j] = cfgTokenIndex[j-gap];
+			}
+			cfgTokenIndex[j] = k;
+		}
+	}
+	token_index_ready = true;
+}
+
+index_t nv_get_index(const char *group, const char *token)
+{
 	char str[TOKEN_LEN + GROUP_LEN+1];	// should actually never be more than TOKEN_LEN+1
 	strncpy(str, group, GROUP_LEN+1);
-	strncat(str, token, TOKEN_LEN+1);
+	strncat(str, token, TOKEN_LEN);		// names from the input line can be any length
 
-	index_t i;
-	index_t index_max = nv_index_max();
+	if (!token_index_ready) { _build_token_index(); }
+
+	index_t lo = 0;						// lower bound search for the first match
+	index_t hi = nv_index_max();
+	index_t mid;
 
-	for (i=0; i < index_max; i++) {
-		if ((c = GET_TOKEN_BYTE(token[0])) != str[0]) {	continue; }					// 1st character mismatch
-		if ((c = GET_TOKEN_BYTE(token[1])) == NUL) { if (str[1] == NUL) return(i);}	// one character match
-		if (c != str[1]) continue;													// 2nd character mismatch
-		if ((c = GET_TOKEN_BYTE(token[2])) == NUL) { if (str[2] == NUL) return(i);}	// two character match
-		if (c != str[2]) continue;													// 3rd character mismatch
-		if ((c = GET_TOKEN_BYTE(token[3])) == NUL) { if (str[3] == NUL) return(i);}	// three character match
-		if (c != str[3]) continue;													// 4th character mismatch
-		if ((c = GET_TOKEN_BYTE(token[4])) == NUL) { if (str[4] == NUL) return(i);}	// four character match
-		if (c != str[4]) continue;													// 5th character mismatch
-		return (i);																	// five character match
+	while (lo < hi) {
+		mid = lo + (hi-lo)/2;
+		if (_token_cmp(str, cfgTokenIndex[mid]) > 0) { lo = mid+1; } else { hi = mid; }
+	}
+	if ((lo < nv_index_max()) && (_token_cmp(str, cfgTokenIndex[lo]) == 0)) {
+		return (cfgTokenIndex[lo]);
 	}
 	return (NO_MATCH);
 }
@@ -455,22 +764,64 @@ index_t nv_get_index(const char *group, const char *token)
 
 uint8_t nv_get_type(nvObj_t *nv)
 {
-	if (nv->token[0] == NUL) return (NV_TYPE_NULL);
-	if (strcmp("gc", nv->token) == 0) return (NV_TYPE_GCODE);
-	if (strcmp("sr", nv->token) == 0) return (NV_TYPE_REPORT);
-	if (strcmp("qr", nv->token) == 0) return (NV_TYPE_REPORT);
-	if (strcmp("msg",nv->token) == 0) return (NV_TYPE_MESSAGE);
-	if (strcmp("err",nv->token) == 0) return (NV_TYPE_MESSAGE); 	// errors are reported as messages
-	if (strcmp("n",  nv->token) == 0) return (NV_TYPE_LINENUM);
+	const char *token = nv_token(nv);
+	if (token[0] == NUL) return (NV_TYPE_NULL);
+	if (strcmp("gc", token) == 0) return (NV_TYPE_GCODE);
+	if (strcmp("sr", token) == 0) return (NV_TYPE_REPORT);
+	if (strcmp("qr", token) == 0) return (NV_TYPE_REPORT);
+	if (strcmp("msg",token) == 0) return (NV_TYPE_MESSAGE);
+	if (strcmp("err",token) == 0) return (NV_TYPE_MESSAGE); 	// errors are reported as messages
+	if (strcmp("n",  token) == 0) return (NV_TYPE_LINENUM);
 	return (NV_TYPE_CONFIG);
 }
 
+/*
+ * nv_token()	  - return the token of an nvObj - less the group prefix if it's stripped
+ * nv_group()	  - return the group prefix of a stripped token, or "" if it's not stripped
+ * nv_set_index() - name an nvObj from its cfgArray index, stripped or as the full token
+ *
+ *	Table names are read from cfgArray into a static buffer (one for tokens, one for
+ *	groups) that is overwritten by the next call. Explicit names are returned as they are.
+ *	Stripping follows the table: system groups (F_NOSTRIP) always carry the full token.
+ */
+
+const char *nv_token(nvObj_t *nv)
+{
+	static char token[TOKEN_LEN+1];
+
+	if (nv->name != NULL) return (nv->name);
+	strcpy_P(token, &cfgArray[nv->index].token[nv->strip]); // token field is always terminated
+	return (token);
+}
+
+const char *nv_group(nvObj_t *nv)
+{
+	static char group[GROUP_LEN+1];
+
+	if ((nv->name != NULL) || (nv->strip == 0)) return ("");
+	strcpy_P(group, cfgArray[nv->index].group);		// group field is always terminated
+	return (group);
+}
+
+void nv_set_index(nvObj_t *nv, index_t index, bool strip)
+{
+	nv->index = index;
+	nv->name = NULL;
+	nv->strip = 0;
+	if ((strip) && !(GET_TABLE_BYTE(flags) & F_NOSTRIP)) {
+		char group[GROUP_LEN+1];
+		strcpy_P(group, cfgArray[index].group);
+		nv->strip = strlen(group);
+	}
+}
+
 /******************************************************************************
  * nvObj low-level object and list operations
  * nv_get_nvObj()		- setup a nv object by providing the index
  * nv_reset_nv()		- quick clear for a new nv object
  * nv_reset_nv_list()	- clear entire header, body and footer for a new use
  * nv_copy_string()		- used to write a string to shared string storage and link it
+ * nv_link_string()		- link a string in place, e.g. a value in the input line (no copy)
  * nv_add_object()		- write contents of parameter to  first free object in the body
  * nv_add_integer()		- add an integer value to end of nv body (Note 1)
  * nv_add_float()		- add a floating point value to end of nv body
@@ -500,19 +851,7 @@ void nv_get_nvObj(nvObj_t *nv)
 
 	index_t tmp = nv->index;
 	nv_reset_nv(nv);
-	nv->index = tmp;
-
-	strcpy_P(nv->token, cfgArray[nv->index].token); // token field is always terminated
-	strcpy_P(nv->group, cfgArray[nv->index].group); // group field is always terminated
-
-	// special processing for system groups and stripping tokens for groups
-	if (nv->group[0] != NUL) {
-		if (GET_TABLE_BYTE(flags) & F_NOSTRIP) {
-			nv->group[0] = NUL;
-		} else {
-			strcpy(nv->token, &nv->token[strlen(nv->group)]); // strip group from the token
-		}
-	}
+	nv_set_index(nv, tmp, true);			// strip the group from the token (except system groups)
 	((fptrCmd)GET_TABLE_WORD(get))(nv);		// populate the value
 }
 
@@ -522,8 +861,8 @@ nvObj_t *nv_reset_nv(nvObj_t *nv)			// clear a single nvObj structure
 	nv->index = 0;
 	nv->value = 0;
 	nv->precision = 0;
-	nv->token[0] = NUL;
-	nv->group[0] = NUL;
+	nv->name = "";
+	nv->strip = 0;
 	nv->stringp = NULL;
 
 	if (nv->pv == NULL) { 					// set depth correctly
@@ -549,20 +888,21 @@ nvObj_t *nv_reset_nv_list()					// clear the header and response body
 		nv->depth = 1;						// header and footer are corrected later
 		nv->precision = 0;
 		nv->valuetype = TYPE_EMPTY;
-		nv->token[0] = NUL;
+		nv->name = "";
+		nv->strip = 0;
 	}
 	(--nv)->nx = NULL;
 	nv = nvl.list;							// setup response header element ('r')
 	nv->pv = NULL;
 	nv->depth = 0;
 	nv->valuetype = TYPE_PARENT;
-	strcpy(nv->token, "r");
+	nv->name = "r";
 	return (nv_body);						// this is a convenience for calling routines
 }
 
 stat_t nv_copy_string(nvObj_t *nv, const char *src)
 {
-	if ((nvStr.wp + strlen(src)) > NV_SHARED_STRING_LEN) { return (STAT_BUFFER_FULL);}
+	if ((nvStr.wp + strlen(src)) >= NV_SHARED_STRING_LEN) { return (STAT_BUFFER_FULL);}
 	char *dst = &nvStr.string[nvStr.wp];
 	strcpy(dst, src);						// copy string to current head position
 											// string has already been tested for overflow, above
@@ -571,6 +911,11 @@ stat_t nv_copy_string(nvObj_t *nv, const char *src)
 	return (STAT_OK);
 }
 
+void nv_link_string(nvObj_t *nv, char *src)
+{
+	nv->stringp = (char (*)[])src;
+}
+
 /* UNUSED
 stat_t nv_copy_string_P(nvObj_t *nv, const char *src_P)
 {
@@ -604,7 +949,7 @@ nvObj_t *nv_add_integer(const char *token, const uint32_t value)// add an intege
 			if ((nv = nv->nx) == NULL) return(NULL); // not supposed to find a NULL; here for safety
 			continue;
 		}
-		strncpy(nv->token, token, TOKEN_LEN);
+		nv->name = token;
 		nv->value = (float) value;
 		nv->valuetype = TYPE_INT;
 		return (nv);
@@ -620,7 +965,7 @@ nvObj_t *nv_add_data(const char *token, const uint32_t value)// add an integer o
 			if ((nv = nv->nx) == NULL) return(NULL); // not supposed to find a NULL; here for safety
 			continue;
 		}
-		strcpy(nv->token, token);
+		nv->name = token;
 		float *v = (float*)&value;
 		nv->value = *v;
 		nv->valuetype = TYPE_DATA;
@@ -637,7 +982,7 @@ nvObj_t *nv_add_float(const char *token, const float value)	// add a float objec
 			if ((nv = nv->nx) == NULL) return(NULL);		// not supposed to find a NULL; here for safety
 			continue;
 		}
-		strncpy(nv->token, token, TOKEN_LEN);
+		nv->name = token;
 		nv->value = value;
 		nv->valuetype = TYPE_FLOAT;
 		return (nv);
@@ -654,9 +999,9 @@ nvObj_t *nv_add_string(const char *token, const char *string) // add a string ob
 			if ((nv = nv->nx) == NULL) return(NULL);		// not supposed to find a NULL; here for safety
 			continue;
 		}
-		strncpy(nv->token, token, TOKEN_LEN);
+		nv->name = token;
 		if (nv_copy_string(nv, string) != STAT_OK) { return (NULL);}
-		nv->index = nv_get_index((const char *)"", nv->token);
+		nv->index = nv_get_index((const char *)"", token);
 		nv->valuetype = TYPE_STRING;
 		return (nv);
 	}
@@ -711,7 +1056,7 @@ void nv_dump_nv(nvObj_t *nv)
 			 nv->valuetype,
 			 nv->precision,
 			 (double)nv->value,
-			 nv->group,
-			 nv->token,
+			 nv_group(nv),
+			 nv_token(nv),
 			 (char *)nv->stringp);
 }
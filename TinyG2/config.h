@@ -128,19 +128,27 @@
  */
 /*	Token and Group Fields
  *
- *	The nvObject struct (nvObj_t) has strict rules on the use of the token and group fields.
- *	The following forms are legal which support the use cases listed:
+ *	An nvObj does not carry its token and group as strings. A table object carries its cfgArray
+ *	index and the number of leading characters (the group prefix) to strip from the table token,
+ *	and the name is read from the table only when it's needed. Anything else (the "r" header,
+ *	the "f" footer, messages, a name that didn't look up) carries an explicit name instead -
+ *	a string constant or a name in the input line, which lives until the response has been sent.
+ *
+ *	Use nv_token() and nv_group() to read the name. The forms are the same as they always were:
  *
  *	Forms
- *	  - group is NUL; token is full token including any group profix
- *	  - group is populated; token is carried without the group prefix
- *	  - group is populated; token is NUL - indicates a group operation
+ *	  - strip is 0; group is NUL; token is full token including any group prefix
+ *	  - strip is set; group is populated; token is carried without the group prefix
+ *	  - name is set; group is NUL; token is the name (e.g. "r", "msg" or an unrecognized name)
  *
  *  Use Cases
  *	  - Lookup full token in cfgArray to get the index. Concatenates grp+token as key
  *	  - Text-mode displays. Concatenates grp+token for display, may also use grp alone
  *	  - JSON-mode display for single - element value e.g. xvm. Concatenate as above
  *	  - JSON-mode display of a parent/child group. Parent is named grp, children nems are tokens
+ *
+ *	nv_token() and nv_group() each return a static buffer that the next call overwrites.
+ *	Copy the string if it has to outlive a getter or another nvObj's name.
  */
 /*	--- nv object string handling ---
  *
@@ -149,6 +157,10 @@
  *	The observation is that the total rendered output in JSON or text mode cannot exceed the size of
  *	the output buffer (typ 256 bytes), So some number less than that is sufficient for shared strings.
  *	This is all mediated through nv_copy_string(), nv_copy_string_P(), and nv_reset_nv_list().
+ *
+ *	Strings parsed from an input line are not copied. nv_link_string() points the nvObj at the
+ *	value in the line buffer instead, which lives until the response has been sent. A set
+ *	function that needs to keep a string past the response must copy it somewhere of its own.
  */
 /*  --- Setting nvObj indexes ---
  *
@@ -161,7 +173,9 @@
 /*	--- Other Notes:---
  *
  *	NV_BODY_LEN needs to allow for one parent JSON object and enough children to complete the
- *	largest possible operation - usually the status report.
+ *	largest possible operation - usually the status report. sys is the largest group, and its
+ *	size depends on the optional features compiled in. With the defaults in tinyg2.h it fits.
+ *	With all of them enabled it does not, and get_grp() returns STAT_JSON_TOO_MANY_PAIRS.
  */
 
 /***********************************************************************************
@@ -178,8 +192,8 @@ typedef uint16_t index_t;				// use this if there are > 255 indexed objects
 
 										// pre-allocated defines (take RAM permanently)
 #define NV_SHARED_STRING_LEN 512		// shared string for string values
-#define NV_BODY_LEN 40					// body elements - allow for 1 parent + N children
-										// (each body element takes about 30 bytes of RAM)
+#define NV_BODY_LEN 50					// body elements - allow for 1 parent + N children (see get_grp())
+										// (each body element takes 32 bytes of RAM)
 
 // Stuff you probably don't want to change
 
@@ -188,6 +202,13 @@ typedef uint16_t index_t;				// use this if there are > 255 indexed objects
 #define NV_FOOTER_LEN 18				// sufficient space to contain a JSON footer array
 #define NV_LIST_LEN (NV_BODY_LEN+2)		// +2 allows for a header and a footer
 #define NV_MAX_OBJECTS (NV_BODY_LEN-1)	// maximum number of objects in a body string
+
+#define CFG_SNAPSHOT_VERSION 1			// binary config snapshot format version
+#define CFG_SNAPSHOT_HEADER_LEN 8		// version, reserved, value count, table layout hash
+#ifndef CFG_SNAPSHOT_MAX_VALUES
+#define CFG_SNAPSHOT_MAX_VALUES 640		// staging buffer size for incoming snapshots (in values)
+#endif
+
 #define NO_MATCH (index_t)0xFFFF
 
 typedef enum {
@@ -220,12 +241,14 @@ typedef enum {						    // value typing for config and JSON
 #define F_PERSIST 		0x02			// persist this item when set is run
 #define F_NOSTRIP		0x04			// do not strip the group prefix from the token
 #define F_CONVERT		0x08			// set if unit conversion is required
+#define F_ARRAY			0x10			// item accepts an input array
 
 #define _f0				0x00
 #define _fi				(F_INITIALIZE)
 #define _fp				(F_PERSIST)
 #define _fn				(F_NOSTRIP)
 #define _fc				(F_CONVERT)
+#define _fa				(F_ARRAY)
 #define _fic			(F_INITIALIZE | F_CONVERT)
 #define _fip			(F_INITIALIZE | F_PERSIST)
 #define _fipc			(F_INITIALIZE | F_PERSIST | F_CONVERT)
@@ -248,14 +271,14 @@ typedef struct nvString {				// shared string object
 typedef struct nvObject {				// depending on use, not all elements may be populated
 	struct nvObject *pv;				// pointer to previous object or NULL if first object
 	struct nvObject *nx;				// pointer to next object or NULL if last object
+	const char *name;					// explicit name, or NULL if the name is the cfgArray token
+	char (*stringp)[];				// pointer to array of characters from shared character array
+	float value;						// numeric value
 	index_t index;						// index of tokenized name, or -1 if no token (optional)
 	int8_t depth;						// depth of object in the tree. 0 is root (-1 is invalid)
-	valueType valuetype;                // see valueType enum
 	int8_t precision;					// decimal precision for reporting (JSON)
-	float value;						// numeric value
-	char group[GROUP_LEN+1];			// group prefix or NUL if not in a group
-	char token[TOKEN_LEN+1];			// full mnemonic token for lookup
-	char (*stringp)[];				// pointer to array of characters from shared character array
+	uint8_t strip;						// group prefix length stripped from the cfgArray token
+	valueType valuetype;                // see valueType enum
 } nvObj_t; 								// OK, so it's not REALLY an object
 
 typedef uint8_t (*fptrCmd)(nvObj_t *nv);// required for cfg table access
@@ -284,6 +307,8 @@ typedef struct cfgItem {
 extern nvStr_t nvStr;
 extern nvList_t nvl;
 extern const cfgItem_t cfgArray[];
+extern index_t cfgTokenIndex[];		// cfgArray indexes sorted by token (see nv_get_index())
+extern index_t cfgGroupIndex[];		// single-valued cfgArray indexes sorted by group (see get_grp())
 
 //#define nv_header nv.list
 #define nv_header (&nvl.list[0])
@@ -293,6 +318,8 @@ extern const cfgItem_t cfgArray[];
 
 void config_init(void);
 stat_t set_defaults(nvObj_t *nv);			// reset config to default values
+stat_t config_get_snapshot(nvObj_t *nv);	// print persisted values as a base32 snapshot
+stat_t config_set_snapshot(nvObj_t *nv);	// load a base32 snapshot (may take several chunks)
 void config_init_assertions(void);
 stat_t config_test_assertions(void);
 
@@ -304,12 +331,15 @@ stat_t nv_persist(nvObj_t *nv);				// main entry point for persistence
 
 // helpers
 uint8_t nv_get_type(nvObj_t *nv);
+const char *nv_token(nvObj_t *nv);			// token, less the group prefix if stripped
+const char *nv_group(nvObj_t *nv);			// group prefix if the token is stripped, otherwise ""
+void nv_set_index(nvObj_t *nv, index_t index, bool strip);	// name the object from its cfgArray index
 index_t nv_get_index(const char *group, const char *token);
 index_t	nv_index_max(void);					// (see config_app.c)
 uint8_t nv_index_is_single(index_t index);	// (see config_app.c)
 uint8_t nv_index_is_group(index_t index);	// (see config_app.c)
 uint8_t nv_index_lt_groups(index_t index);	// (see config_app.c)
-uint8_t nv_group_is_prefixed(char *group);
+uint8_t nv_group_is_prefixed(const char *group);
 
 // generic internal functions and accessors
 stat_t set_nul(nvObj_t *nv);				// set nothing (no operation)
@@ -337,6 +367,7 @@ void nv_get_nvObj(nvObj_t *nv);
 nvObj_t *nv_reset_nv(nvObj_t *nv);
 nvObj_t *nv_reset_nv_list(void);
 stat_t nv_copy_string(nvObj_t *nv, const char *src);
+void nv_link_string(nvObj_t *nv, char *src);
 nvObj_t *nv_add_object(const char *token);
 nvObj_t *nv_add_integer(const char *token, const uint32_t value);
 nvObj_t *nv_add_float(const char *token, const float value);
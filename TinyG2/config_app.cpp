@@ -35,7 +35,9 @@
 #include "settings.h"
 #include "planner.h"
 #include "plan_arc.h"
+#include "plan_stats.h"
 #include "stepper.h"
+#include "kinematics.h"
 #include "gpio.h"
 #include "spindle.h"
 #include "coolant.h"
@@ -114,6 +116,7 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "",   "stat",_f0, 0, cm_print_stat, cm_get_stat, set_nul,(float *)&cs.null, 0 },			// combined machine state
 	{ "",   "n",   _fi, 0, cm_print_line, cm_get_mline,set_int,(float *)&cm.gm.linenum,0 },		// Model line number
 	{ "",   "line",_fi, 0, cm_print_line, cm_get_line, set_int,(float *)&cm.gm.linenum,0 },		// Active line number - model or runtime line number
+	{ "",   "lnck",_f0, 0, tx_print_int,  get_int,     set_int,(float *)&cs.line_check_next,0 },	// Next checked line number expected - SET to restart numbering
 	{ "",   "vel", _f0, 2, cm_print_vel,  cm_get_vel,  set_nul,(float *)&cs.null, 0 },			// current velocity
 	{ "",   "feed",_f0, 2, cm_print_feed, cm_get_feed, set_nul,(float *)&cs.null, 0 },	        // feed rate
 	{ "",   "macs",_f0, 0, cm_print_macs, cm_get_macs, set_nul,(float *)&cs.null, 0 },			// raw machine state
@@ -137,6 +140,13 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "mpo","mpob",_f0, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 },			// B machine position
 	{ "mpo","mpoc",_f0, 3, cm_print_mpo, cm_get_mpo, set_nul,(float *)&cs.null, 0 },			// C machine position
 
+	{ "mpe","mpex",_f0, 3, cm_print_mpe, cm_get_mpe, set_nul,(float *)&cs.null, 0 },			// X measured position
+	{ "mpe","mpey",_f0, 3, cm_print_mpe, cm_get_mpe, set_nul,(float *)&cs.null, 0 },			// Y measured position
+	{ "mpe","mpez",_f0, 3, cm_print_mpe, cm_get_mpe, set_nul,(float *)&cs.null, 0 },			// Z measured position
+	{ "mpe","mpea",_f0, 3, cm_print_mpe, cm_get_mpe, set_nul,(float *)&cs.null, 0 },			// A measured position
+	{ "mpe","mpeb",_f0, 3, cm_print_mpe, cm_get_mpe, set_nul,(float *)&cs.null, 0 },			// B measured position
+	{ "mpe","mpec",_f0, 3, cm_print_mpe, cm_get_mpe, set_nul,(float *)&cs.null, 0 },			// C measured position
+
 	{ "pos","posx",_f0, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 },			// X work position
 	{ "pos","posy",_f0, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 },			// Y work position
 	{ "pos","posz",_f0, 3, cm_print_pos, cm_get_pos, set_nul,(float *)&cs.null, 0 },			// Z work position
@@ -152,12 +162,12 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "ofs","ofsc",_f0, 3, cm_print_ofs, cm_get_ofs, set_nul,(float *)&cs.null, 0 },			// C work offset
 
 	{ "hom","home",_f0, 0, cm_print_home,cm_get_home,set_01,(float *)&cm.homing_state, 0 },	    // homing state, invoke homing cycle
-	{ "hom","homx",_f0, 0, cm_print_hom, get_ui8, set_01, (float *)&cm.homed[AXIS_X], false },	// X homed - Homing status group
-	{ "hom","homy",_f0, 0, cm_print_hom, get_ui8, set_01, (float *)&cm.homed[AXIS_Y], false },	// Y homed
-	{ "hom","homz",_f0, 0, cm_print_hom, get_ui8, set_01, (float *)&cm.homed[AXIS_Z], false },	// Z homed
-	{ "hom","homa",_f0, 0, cm_print_hom, get_ui8, set_01, (float *)&cm.homed[AXIS_A], false },	// A homed
-	{ "hom","homb",_f0, 0, cm_print_hom, get_ui8, set_01, (float *)&cm.homed[AXIS_B], false },	// B homed
-	{ "hom","homc",_f0, 0, cm_print_hom, get_ui8, set_01, (float *)&cm.homed[AXIS_C], false },	// C homed
+	{ "hom","homx",_f0, 0, cm_print_hom, get_ui8, cm_set_hom, (float *)&cm.homed[AXIS_X], false },	// X homed - Homing status group
+	{ "hom","homy",_f0, 0, cm_print_hom, get_ui8, cm_set_hom, (float *)&cm.homed[AXIS_Y], false },	// Y homed
+	{ "hom","homz",_f0, 0, cm_print_hom, get_ui8, cm_set_hom, (float *)&cm.homed[AXIS_Z], false },	// Z homed
+	{ "hom","homa",_f0, 0, cm_print_hom, get_ui8, cm_set_hom, (float *)&cm.homed[AXIS_A], false },	// A homed
+	{ "hom","homb",_f0, 0, cm_print_hom, get_ui8, cm_set_hom, (float *)&cm.homed[AXIS_B], false },	// B homed
+	{ "hom","homc",_f0, 0, cm_print_hom, get_ui8, cm_set_hom, (float *)&cm.homed[AXIS_C], false },	// C homed
 
 	{ "prb","prbe",_f0, 0, tx_print_nul, get_ui8, set_nul,(float *)&cm.probe_state, 0 },		// probing state
 	{ "prb","prbx",_f0, 3, tx_print_nul, get_flt, set_nul,(float *)&cm.probe_results[AXIS_X], 0 },
@@ -167,6 +177,12 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "prb","prbb",_f0, 3, tx_print_nul, get_flt, set_nul,(float *)&cm.probe_results[AXIS_B], 0 },
 	{ "prb","prbc",_f0, 3, tx_print_nul, get_flt, set_nul,(float *)&cm.probe_results[AXIS_C], 0 },
 
+	{ "", "fhd",_f0, 3, cm_print_fhd, get_flt, set_nul,(float *)&cm.hold_stop_distance, 0 },	// last feedhold stop distance
+	{ "", "fht",_f0, 3, cm_print_fht, get_flt, set_nul,(float *)&cm.hold_stop_time, 0 },		// last feedhold stop time
+	{ "", "fhl",_f0, 3, cm_print_fhl, get_flt, set_nul,(float *)&cm.hold_latency, 0 },		// last feedhold latency
+	{ "", "mfo",_f0, 2, cm_print_mfo, get_flt, cm_set_mfo,(float *)&cm.gmx.feed_rate_override_factor, 1.0 },	// feed override
+	{ "", "mto",_f0, 2, cm_print_mto, get_flt, cm_set_mto,(float *)&cm.gmx.traverse_override_factor, 1.0 },	// traverse override
+
 	{ "jog","jogx",_f0, 0, tx_print_nul, get_nul, cm_run_jogx, (float *)&cm.jogging_dest, 0},
 	{ "jog","jogy",_f0, 0, tx_print_nul, get_nul, cm_run_jogy, (float *)&cm.jogging_dest, 0},
 	{ "jog","jogz",_f0, 0, tx_print_nul, get_nul, cm_run_jogz, (float *)&cm.jogging_dest, 0},
@@ -174,134 +190,231 @@ const cfgItem_t cfgArray[] PROGMEM = {
 //	{ "jog","jogb",_f0, 0, tx_print_nul, get_nul, cm_run_jogb, (float *)&cm.jogging_dest, 0},
 //	{ "jog","jogc",_f0, 0, tx_print_nul, get_nul, cm_run_jogc, (float *)&cm.jogging_dest, 0},
 
+	{ "jgv","jgvx",_f0, 0, tx_print_nul, get_flt, cm_set_jgv, (float *)&cm.jog_velocity[AXIS_X], 0},	// velocity jog
+	{ "jgv","jgvy",_f0, 0, tx_print_nul, get_flt, cm_set_jgv, (float *)&cm.jog_velocity[AXIS_Y], 0},
+	{ "jgv","jgvz",_f0, 0, tx_print_nul, get_flt, cm_set_jgv, (float *)&cm.jog_velocity[AXIS_Z], 0},
+	{ "jgv","jgva",_f0, 0, tx_print_nul, get_flt, cm_set_jgv, (float *)&cm.jog_velocity[AXIS_A], 0},
+
 	// Motor parameters
-	{ "1","1ma",_fip, 0, st_print_ma, get_ui8, set_ui8,   (float *)&st_cfg.mot[MOTOR_1].motor_map,	M1_MOTOR_MAP },
+	{ "1","1ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_1].motor_map,	M1_MOTOR_MAP },
 	{ "1","1sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_1].step_angle,	M1_STEP_ANGLE },
 	{ "1","1tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_1].travel_rev,	M1_TRAVEL_PER_REV },
 	{ "1","1mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_1].microsteps,	M1_MICROSTEPS },
 	{ "1","1po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_1].polarity,	M1_POLARITY },
 	{ "1","1pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_1].power_mode,	M1_POWER_MODE },
 	{ "1","1bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_1].backlash,   M1_BACKLASH },
+	{ "1","1cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_1].correction_kp, M1_CORRECTION_KP },
+	{ "1","1ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_1].correction_ki, M1_CORRECTION_KI },
+	{ "1","1fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_1].following_error_max, M1_FOLLOWING_ERROR_MAX },
+	{ "1","1hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_1].homing_input,M1_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "1","1mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_1].morph_microsteps,M1_MORPH_MICROSTEPS },
+#endif
 #ifdef __ARM
 	{ "1","1pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_1].power_level,M1_POWER_LEVEL },
 #endif
 #if (MOTORS >= 2)
-	{ "2","2ma",_fip, 0, st_print_ma, get_ui8, set_ui8,   (float *)&st_cfg.mot[MOTOR_2].motor_map,	M2_MOTOR_MAP },
+	{ "2","2ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_2].motor_map,	M2_MOTOR_MAP },
 	{ "2","2sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_2].step_angle,	M2_STEP_ANGLE },
 	{ "2","2tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_2].travel_rev,	M2_TRAVEL_PER_REV },
 	{ "2","2mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_2].microsteps,	M2_MICROSTEPS },
 	{ "2","2po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_2].polarity,	M2_POLARITY },
 	{ "2","2pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_2].power_mode,	M2_POWER_MODE },
 	{ "2","2bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_2].backlash,   M2_BACKLASH },
+	{ "2","2cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_2].correction_kp, M2_CORRECTION_KP },
+	{ "2","2ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_2].correction_ki, M2_CORRECTION_KI },
+	{ "2","2fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_2].following_error_max, M2_FOLLOWING_ERROR_MAX },
+	{ "2","2hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_2].homing_input,M2_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "2","2mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_2].morph_microsteps,M2_MORPH_MICROSTEPS },
+#endif
 #ifdef __ARM
 	{ "2","2pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_2].power_level,M2_POWER_LEVEL},
 #endif
 #endif
 #if (MOTORS >= 3)
-	{ "3","3ma",_fip, 0, st_print_ma, get_ui8, set_ui8,   (float *)&st_cfg.mot[MOTOR_3].motor_map,	M3_MOTOR_MAP },
+	{ "3","3ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_3].motor_map,	M3_MOTOR_MAP },
 	{ "3","3sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_3].step_angle,	M3_STEP_ANGLE },
 	{ "3","3tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_3].travel_rev,	M3_TRAVEL_PER_REV },
 	{ "3","3mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_3].microsteps,	M3_MICROSTEPS },
 	{ "3","3po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_3].polarity,	M3_POLARITY },
 	{ "3","3pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_3].power_mode,	M3_POWER_MODE },
 	{ "3","3bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_3].backlash,   M3_BACKLASH },
+	{ "3","3cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_3].correction_kp, M3_CORRECTION_KP },
+	{ "3","3ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_3].correction_ki, M3_CORRECTION_KI },
+	{ "3","3fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_3].following_error_max, M3_FOLLOWING_ERROR_MAX },
+	{ "3","3hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_3].homing_input,M3_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "3","3mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_3].morph_microsteps,M3_MORPH_MICROSTEPS },
+#endif
 #ifdef __ARM
 	{ "3","3pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_3].power_level,M3_POWER_LEVEL },
 #endif
 #endif
 #if (MOTORS >= 4)
-	{ "4","4ma",_fip, 0, st_print_ma, get_ui8, set_ui8,   (float *)&st_cfg.mot[MOTOR_4].motor_map,	M4_MOTOR_MAP },
+	{ "4","4ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_4].motor_map,	M4_MOTOR_MAP },
 	{ "4","4sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_4].step_angle,	M4_STEP_ANGLE },
 	{ "4","4tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_4].travel_rev,	M4_TRAVEL_PER_REV },
 	{ "4","4mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_4].microsteps,	M4_MICROSTEPS },
 	{ "4","4po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_4].polarity,	M4_POLARITY },
 	{ "4","4pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_4].power_mode,	M4_POWER_MODE },
 	{ "4","4bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_4].backlash,   M4_BACKLASH },
+	{ "4","4cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_4].correction_kp, M4_CORRECTION_KP },
+	{ "4","4ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_4].correction_ki, M4_CORRECTION_KI },
+	{ "4","4fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_4].following_error_max, M4_FOLLOWING_ERROR_MAX },
+	{ "4","4hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_4].homing_input,M4_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "4","4mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_4].morph_microsteps,M4_MORPH_MICROSTEPS },
+#endif
 #ifdef __ARM
 	{ "4","4pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_4].power_level,M4_POWER_LEVEL },
 #endif
 #endif
 #if (MOTORS >= 5)
-	{ "5","5ma",_fip, 0, st_print_ma, get_ui8, set_ui8,   (float *)&st_cfg.mot[MOTOR_5].motor_map,	M5_MOTOR_MAP },
+	{ "5","5ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_5].motor_map,	M5_MOTOR_MAP },
 	{ "5","5sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_5].step_angle,	M5_STEP_ANGLE },
 	{ "5","5tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_5].travel_rev,	M5_TRAVEL_PER_REV },
 	{ "5","5mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_5].microsteps,	M5_MICROSTEPS },
 	{ "5","5po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_5].polarity,	M5_POLARITY },
 	{ "5","5pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_5].power_mode,	M5_POWER_MODE },
 	{ "5","5bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_5].backlash,   M5_BACKLASH },
+	{ "5","5cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_5].correction_kp, M5_CORRECTION_KP },
+	{ "5","5ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_5].correction_ki, M5_CORRECTION_KI },
+	{ "5","5fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_5].following_error_max, M5_FOLLOWING_ERROR_MAX },
+	{ "5","5hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_5].homing_input,M5_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "5","5mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_5].morph_microsteps,M5_MORPH_MICROSTEPS },
+#endif
 #ifdef __ARM
 	{ "5","5pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_5].power_level,M5_POWER_LEVEL },
 #endif
 #endif
 #if (MOTORS >= 6)
-	{ "6","6ma",_fip, 0, st_print_ma, get_ui8, set_ui8,   (float *)&st_cfg.mot[MOTOR_6].motor_map,	M6_MOTOR_MAP },
+	{ "6","6ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_6].motor_map,	M6_MOTOR_MAP },
 	{ "6","6sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_6].step_angle,	M6_STEP_ANGLE },
 	{ "6","6tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_6].travel_rev,	M6_TRAVEL_PER_REV },
 	{ "6","6mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_6].microsteps,	M6_MICROSTEPS },
 	{ "6","6po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_6].polarity,	M6_POLARITY },
 	{ "6","6pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_6].power_mode,	M6_POWER_MODE },
 	{ "6","6bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_6].backlash,   M6_BACKLASH },
+	{ "6","6cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_6].correction_kp, M6_CORRECTION_KP },
+	{ "6","6ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_6].correction_ki, M6_CORRECTION_KI },
+	{ "6","6fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_6].following_error_max, M6_FOLLOWING_ERROR_MAX },
+	{ "6","6hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_6].homing_input,M6_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "6","6mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_6].morph_microsteps,M6_MORPH_MICROSTEPS },
+#endif
 #ifdef __ARM
 	{ "6","6pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_6].power_level,M6_POWER_LEVEL },
 #endif
+#endif
+#if (MOTORS >= 7)
+	{ "7","7ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_7].motor_map,	M7_MOTOR_MAP },
+	{ "7","7sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_7].step_angle,	M7_STEP_ANGLE },
+	{ "7","7tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_7].travel_rev,	M7_TRAVEL_PER_REV },
+	{ "7","7mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_7].microsteps,	M7_MICROSTEPS },
+	{ "7","7po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_7].polarity,	M7_POLARITY },
+	{ "7","7pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_7].power_mode,	M7_POWER_MODE },
+	{ "7","7bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_7].backlash,   M7_BACKLASH },
+	{ "7","7cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_7].correction_kp, M7_CORRECTION_KP },
+	{ "7","7ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_7].correction_ki, M7_CORRECTION_KI },
+	{ "7","7fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_7].following_error_max, M7_FOLLOWING_ERROR_MAX },
+	{ "7","7hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_7].homing_input,M7_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "7","7mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_7].morph_microsteps,M7_MORPH_MICROSTEPS },
+#endif
+#ifdef __ARM
+	{ "7","7pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_7].power_level,M7_POWER_LEVEL },
+#endif
+#endif
+#if (MOTORS >= 8)
+	{ "8","8ma",_fip, 0, st_print_ma, get_ui8, st_set_ma, (float *)&st_cfg.mot[MOTOR_8].motor_map,	M8_MOTOR_MAP },
+	{ "8","8sa",_fip, 3, st_print_sa, get_flt, st_set_sa, (float *)&st_cfg.mot[MOTOR_8].step_angle,	M8_STEP_ANGLE },
+	{ "8","8tr",_fipc,4, st_print_tr, get_flt, st_set_tr, (float *)&st_cfg.mot[MOTOR_8].travel_rev,	M8_TRAVEL_PER_REV },
+	{ "8","8mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_8].microsteps,	M8_MICROSTEPS },
+	{ "8","8po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_8].polarity,	M8_POLARITY },
+	{ "8","8pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_8].power_mode,	M8_POWER_MODE },
+	{ "8","8bl",_fip, 4, st_print_bl, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_8].backlash,   M8_BACKLASH },
+	{ "8","8cp",_fip, 3, st_print_cp, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_8].correction_kp, M8_CORRECTION_KP },
+	{ "8","8ci",_fip, 3, st_print_ci, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_8].correction_ki, M8_CORRECTION_KI },
+	{ "8","8fe",_fip, 1, st_print_fe, get_flt, set_flt,   (float *)&st_cfg.mot[MOTOR_8].following_error_max, M8_FOLLOWING_ERROR_MAX },
+	{ "8","8hi",_fip, 0, st_print_hi, get_ui8, cm_set_hi, (float *)&st_cfg.mot[MOTOR_8].homing_input,M8_HOMING_INPUT },
+#ifdef __MICROSTEP_MORPH
+	{ "8","8mm",_fip, 0, st_print_mm, get_ui8, st_set_mm, (float *)&st_cfg.mot[MOTOR_8].morph_microsteps,M8_MORPH_MICROSTEPS },
+#endif
+#ifdef __ARM
+	{ "8","8pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_8].power_level,M8_POWER_LEVEL },
+#endif
 #endif
 	// Axis parameters
 	{ "x","xam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_X].axis_mode,		X_AXIS_MODE },
-	{ "x","xvm",_fipc, 0, cm_print_vm, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].velocity_max,	X_VELOCITY_MAX },
-	{ "x","xfr",_fipc, 0, cm_print_fr, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].feedrate_max,	X_FEEDRATE_MAX },
-	{ "x","xtn",_fipc, 3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].travel_min,		X_TRAVEL_MIN },
-	{ "x","xtm",_fipc, 3, cm_print_tm, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].travel_max,		X_TRAVEL_MAX },
+	{ "x","xvm",_fipc, 0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_X].velocity_max,	X_VELOCITY_MAX },
+	{ "x","xfr",_fipc, 0, cm_print_fr, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_X].feedrate_max,	X_FEEDRATE_MAX },
+	{ "x","xtn",_fipc, 3, cm_print_tn, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_X].travel_min,		X_TRAVEL_MIN },
+	{ "x","xtm",_fipc, 3, cm_print_tm, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_X].travel_max,		X_TRAVEL_MAX },
 	{ "x","xjm",_fipc, 0, cm_print_jm, get_flt,   cm_set_jm, (float *)&cm.a[AXIS_X].jerk_max,		X_JERK_MAX },
 	{ "x","xjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_jh, (float *)&cm.a[AXIS_X].jerk_high,	    X_JERK_HIGH_SPEED },
-	{ "x","xjd",_fipc, 4, cm_print_jd, get_nul,   set_nul,   (float *)&cs.null, 0 },                // DEPRECATED
+	{ "x","xjd",_fipc, 4, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_X].junction_dev,	0 },
 	{ "x","xhi",_fip,  0, cm_print_hi, get_ui8,   cm_set_hi, (float *)&cm.a[AXIS_X].homing_input,   X_HOMING_INPUT },
 	{ "x","xhd",_fip,  0, cm_print_hd, get_ui8,   set_01,    (float *)&cm.a[AXIS_X].homing_dir,     X_HOMING_DIR },
 	{ "x","xsv",_fipc, 0, cm_print_sv, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].search_velocity,X_SEARCH_VELOCITY },
 	{ "x","xlv",_fipc, 2, cm_print_lv, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].latch_velocity,	X_LATCH_VELOCITY },
 	{ "x","xlb",_fipc, 3, cm_print_lb, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].latch_backoff,	X_LATCH_BACKOFF },
 	{ "x","xzb",_fipc, 3, cm_print_zb, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].zero_backoff,	X_ZERO_BACKOFF },
+#ifdef __INPUT_SHAPING
+	{ "x","xist",_fip,  0, cm_print_ist,get_ui8,   cm_set_ist,(float *)&cm.a[AXIS_X].shaper_type,		X_SHAPER_TYPE },
+	{ "x","xisf",_fip,  1, cm_print_isf,get_flt,   cm_set_isf,(float *)&cm.a[AXIS_X].shaper_frequency,X_SHAPER_FREQUENCY },
+	{ "x","xisd",_fip,  3, cm_print_isd,get_flt,   cm_set_isd,(float *)&cm.a[AXIS_X].shaper_damping,	X_SHAPER_DAMPING },
+#endif
 
 	{ "y","yam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_Y].axis_mode,		Y_AXIS_MODE },
-	{ "y","yvm",_fipc, 0, cm_print_vm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].velocity_max,	Y_VELOCITY_MAX },
-	{ "y","yfr",_fipc, 0, cm_print_fr, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].feedrate_max,	Y_FEEDRATE_MAX },
-	{ "y","ytn",_fipc, 3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].travel_min,		Y_TRAVEL_MIN },
-	{ "y","ytm",_fipc, 3, cm_print_tm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].travel_max,		Y_TRAVEL_MAX },
+	{ "y","yvm",_fipc, 0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_Y].velocity_max,	Y_VELOCITY_MAX },
+	{ "y","yfr",_fipc, 0, cm_print_fr, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_Y].feedrate_max,	Y_FEEDRATE_MAX },
+	{ "y","ytn",_fipc, 3, cm_print_tn, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_Y].travel_min,		Y_TRAVEL_MIN },
+	{ "y","ytm",_fipc, 3, cm_print_tm, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_Y].travel_max,		Y_TRAVEL_MAX },
 	{ "y","yjm",_fipc, 0, cm_print_jm, get_flt,	  cm_set_jm, (float *)&cm.a[AXIS_Y].jerk_max,		Y_JERK_MAX },
 	{ "y","yjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_jh, (float *)&cm.a[AXIS_Y].jerk_high,	    Y_JERK_HIGH_SPEED },
-//	{ "y","yjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].junction_dev,	Y_JUNCTION_DEVIATION },//++++REMOVE
-	{ "y","yjd",_fipc, 4, cm_print_jd, get_nul,   set_nul,   (float *)&cs.null, 0 },                // DEPRECATED
+	{ "y","yjd",_fipc, 4, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_Y].junction_dev,	0 },
 	{ "y","yhi",_fip,  0, cm_print_hi, get_ui8,   cm_set_hi, (float *)&cm.a[AXIS_Y].homing_input,   Y_HOMING_INPUT },
 	{ "y","yhd",_fip,  0, cm_print_hd, get_ui8,   set_01,    (float *)&cm.a[AXIS_Y].homing_dir,     Y_HOMING_DIR },
 	{ "y","ysv",_fipc, 0, cm_print_sv, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].search_velocity,Y_SEARCH_VELOCITY },
 	{ "y","ylv",_fipc, 2, cm_print_lv, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].latch_velocity,	Y_LATCH_VELOCITY },
 	{ "y","ylb",_fipc, 3, cm_print_lb, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].latch_backoff,	Y_LATCH_BACKOFF },
 	{ "y","yzb",_fipc, 3, cm_print_zb, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].zero_backoff,	Y_ZERO_BACKOFF },
+#ifdef __INPUT_SHAPING
+	{ "y","yist",_fip,  0, cm_print_ist,get_ui8,   cm_set_ist,(float *)&cm.a[AXIS_Y].shaper_type,		Y_SHAPER_TYPE },
+	{ "y","yisf",_fip,  1, cm_print_isf,get_flt,   cm_set_isf,(float *)&cm.a[AXIS_Y].shaper_frequency,Y_SHAPER_FREQUENCY },
+	{ "y","yisd",_fip,  3, cm_print_isd,get_flt,   cm_set_isd,(float *)&cm.a[AXIS_Y].shaper_damping,	Y_SHAPER_DAMPING },
+#endif
 
 	{ "z","zam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_Z].axis_mode,		Z_AXIS_MODE },
-	{ "z","zvm",_fipc, 0, cm_print_vm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].velocity_max,	Z_VELOCITY_MAX },
-	{ "z","zfr",_fipc, 0, cm_print_fr, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].feedrate_max,	Z_FEEDRATE_MAX },
-	{ "z","ztn",_fipc, 3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].travel_min,		Z_TRAVEL_MIN },
-	{ "z","ztm",_fipc, 3, cm_print_tm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].travel_max,		Z_TRAVEL_MAX },
+	{ "z","zvm",_fipc, 0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_Z].velocity_max,	Z_VELOCITY_MAX },
+	{ "z","zfr",_fipc, 0, cm_print_fr, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_Z].feedrate_max,	Z_FEEDRATE_MAX },
+	{ "z","ztn",_fipc, 3, cm_print_tn, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_Z].travel_min,		Z_TRAVEL_MIN },
+	{ "z","ztm",_fipc, 3, cm_print_tm, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_Z].travel_max,		Z_TRAVEL_MAX },
 	{ "z","zjm",_fipc, 0, cm_print_jm, get_flt,	  cm_set_jm, (float *)&cm.a[AXIS_Z].jerk_max,		Z_JERK_MAX },
 	{ "z","zjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_jh, (float *)&cm.a[AXIS_Z].jerk_high, 	    Z_JERK_HIGH_SPEED },
-//	{ "z","zjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].junction_dev,	Z_JUNCTION_DEVIATION },//++++REMOVE
-	{ "z","zjd",_fipc, 4, cm_print_jd, get_nul,   set_nul,   (float *)&cs.null, 0 },                // DEPRECATED
+	{ "z","zjd",_fipc, 4, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_Z].junction_dev,	0 },
 	{ "z","zhi",_fip,  0, cm_print_hi, get_ui8,   cm_set_hi, (float *)&cm.a[AXIS_Z].homing_input,   Z_HOMING_INPUT },
 	{ "z","zhd",_fip,  0, cm_print_hd, get_ui8,   set_01,    (float *)&cm.a[AXIS_Z].homing_dir,     Z_HOMING_DIR },
     { "z","zsv",_fipc, 0, cm_print_sv, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].search_velocity,Z_SEARCH_VELOCITY },
 	{ "z","zlv",_fipc, 2, cm_print_lv, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].latch_velocity,	Z_LATCH_VELOCITY },
 	{ "z","zlb",_fipc, 3, cm_print_lb, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].latch_backoff,	Z_LATCH_BACKOFF },
 	{ "z","zzb",_fipc, 3, cm_print_zb, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].zero_backoff,	Z_ZERO_BACKOFF },
+#ifdef __INPUT_SHAPING
+	{ "z","zist",_fip,  0, cm_print_ist,get_ui8,   cm_set_ist,(float *)&cm.a[AXIS_Z].shaper_type,		Z_SHAPER_TYPE },
+	{ "z","zisf",_fip,  1, cm_print_isf,get_flt,   cm_set_isf,(float *)&cm.a[AXIS_Z].shaper_frequency,Z_SHAPER_FREQUENCY },
+	{ "z","zisd",_fip,  3, cm_print_isd,get_flt,   cm_set_isd,(float *)&cm.a[AXIS_Z].shaper_damping,	Z_SHAPER_DAMPING },
+#endif
 
 	{ "a","aam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_A].axis_mode,		A_AXIS_MODE },
-	{ "a","avm",_fip,  0, cm_print_vm, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].velocity_max,	A_VELOCITY_MAX },
-	{ "a","afr",_fip,  0, cm_print_fr, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].feedrate_max,	A_FEEDRATE_MAX },
-	{ "a","atn",_fip,  3, cm_print_tn, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].travel_min,		A_TRAVEL_MIN },
-	{ "a","atm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].travel_max,		A_TRAVEL_MAX },
+	{ "a","avm",_fip,  0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_A].velocity_max,	A_VELOCITY_MAX },
+	{ "a","afr",_fip,  0, cm_print_fr, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_A].feedrate_max,	A_FEEDRATE_MAX },
+	{ "a","atn",_fip,  3, cm_print_tn, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_A].travel_min,		A_TRAVEL_MIN },
+	{ "a","atm",_fip,  3, cm_print_tm, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_A].travel_max,		A_TRAVEL_MAX },
 	{ "a","ajm",_fip,  0, cm_print_jm, get_flt,	  cm_set_jm, (float *)&cm.a[AXIS_A].jerk_max,		A_JERK_MAX },
 	{ "a","ajh",_fip,  0, cm_print_jh, get_flt,	  cm_set_jh, (float *)&cm.a[AXIS_A].jerk_high,  	A_JERK_HIGH_SPEED },
-//	{ "a","ajd",_fip,  4, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].junction_dev,	A_JUNCTION_DEVIATION },//++++REMOVE
-	{ "a","ajd",_fipc, 4, cm_print_jd, get_nul,   set_nul,   (float *)&cs.null, 0 },                // DEPRECATED
+	{ "a","ajd",_fip,  4, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_A].junction_dev,	0 },
 	{ "a","ara",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].radius,			A_RADIUS},
 	{ "a","ahi",_fip,  0, cm_print_hi, get_ui8,   cm_set_hi, (float *)&cm.a[AXIS_A].homing_input,   A_HOMING_INPUT },
 	{ "a","ahd",_fip,  0, cm_print_hd, get_ui8,   set_01,    (float *)&cm.a[AXIS_A].homing_dir,     A_HOMING_DIR },
@@ -309,16 +422,23 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "a","alv",_fip,  2, cm_print_lv, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].latch_velocity,	A_LATCH_VELOCITY },
 	{ "a","alb",_fip,  3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].latch_backoff,	A_LATCH_BACKOFF },
 	{ "a","azb",_fip,  3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].zero_backoff,	A_ZERO_BACKOFF },
+#ifdef __INPUT_SHAPING
+	{ "a","aist",_fip,  0, cm_print_ist,get_ui8,   cm_set_ist,(float *)&cm.a[AXIS_A].shaper_type,		A_SHAPER_TYPE },
+	{ "a","aisf",_fip,  1, cm_print_isf,get_flt,   cm_set_isf,(float *)&cm.a[AXIS_A].shaper_frequency,A_SHAPER_FREQUENCY },
+	{ "a","aisd",_fip,  3, cm_print_isd,get_flt,   cm_set_isd,(float *)&cm.a[AXIS_A].shaper_damping,	A_SHAPER_DAMPING },
+#endif
+#ifdef __PRESSURE_ADVANCE
+	{ "a","apa",_fip,  3, cm_print_pa, get_flt,   cm_set_pa, (float *)&cm.a[AXIS_A].pressure_advance,A_PRESSURE_ADVANCE },
+#endif
 
 	{ "b","bam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_B].axis_mode,		B_AXIS_MODE },
-	{ "b","bvm",_fip,  0, cm_print_vm, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].velocity_max,	B_VELOCITY_MAX },
-	{ "b","bfr",_fip,  0, cm_print_fr, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].feedrate_max,	B_FEEDRATE_MAX },
-	{ "b","btn",_fip,  3, cm_print_tn, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].travel_min,		B_TRAVEL_MIN },
-	{ "b","btm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].travel_max,		B_TRAVEL_MAX },
+	{ "b","bvm",_fip,  0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_B].velocity_max,	B_VELOCITY_MAX },
+	{ "b","bfr",_fip,  0, cm_print_fr, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_B].feedrate_max,	B_FEEDRATE_MAX },
+	{ "b","btn",_fip,  3, cm_print_tn, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_B].travel_min,		B_TRAVEL_MIN },
+	{ "b","btm",_fip,  3, cm_print_tm, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_B].travel_max,		B_TRAVEL_MAX },
 	{ "b","bjm",_fip,  0, cm_print_jm, get_flt,	  cm_set_jm, (float *)&cm.a[AXIS_B].jerk_max,		B_JERK_MAX },
 	{ "b","bjh",_fip,  0, cm_print_jh, get_flt,	  cm_set_jh, (float *)&cm.a[AXIS_B].jerk_high,	    B_JERK_HIGH_SPEED },
-//	{ "b","bjd",_fip,  0, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].junction_dev,	B_JUNCTION_DEVIATION },//++++REMOVE
-	{ "b","bjd",_fipc, 4, cm_print_jd, get_nul,   set_nul,   (float *)&cs.null, 0 },                // DEPRECATED
+	{ "b","bjd",_fip,  4, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_B].junction_dev,	0 },
 	{ "b","bra",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].radius,			B_RADIUS },
 #ifdef __ARM	// B axis extended parameters
 	{ "b","bhi",_fip,  0, cm_print_hi, get_ui8,   cm_set_hi, (float *)&cm.a[AXIS_B].homing_input,   B_HOMING_INPUT },
@@ -327,17 +447,24 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "b","blv",_fip,  2, cm_print_lv, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].latch_velocity,	B_LATCH_VELOCITY },
 	{ "b","blb",_fip,  3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].latch_backoff,	B_LATCH_BACKOFF },
 	{ "b","bzb",_fip,  3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].zero_backoff,	B_ZERO_BACKOFF },
+#ifdef __INPUT_SHAPING
+	{ "b","bist",_fip,  0, cm_print_ist,get_ui8,   cm_set_ist,(float *)&cm.a[AXIS_B].shaper_type,		B_SHAPER_TYPE },
+	{ "b","bisf",_fip,  1, cm_print_isf,get_flt,   cm_set_isf,(float *)&cm.a[AXIS_B].shaper_frequency,B_SHAPER_FREQUENCY },
+	{ "b","bisd",_fip,  3, cm_print_isd,get_flt,   cm_set_isd,(float *)&cm.a[AXIS_B].shaper_damping,	B_SHAPER_DAMPING },
+#endif
+#ifdef __PRESSURE_ADVANCE
+	{ "b","bpa",_fip,  3, cm_print_pa, get_flt,   cm_set_pa, (float *)&cm.a[AXIS_B].pressure_advance,B_PRESSURE_ADVANCE },
+#endif
 #endif
 
 	{ "c","cam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_C].axis_mode,		C_AXIS_MODE },
-	{ "c","cvm",_fip,  0, cm_print_vm, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].velocity_max,	C_VELOCITY_MAX },
-	{ "c","cfr",_fip,  0, cm_print_fr, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].feedrate_max,	C_FEEDRATE_MAX },
-	{ "c","ctn",_fip,  3, cm_print_tn, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].travel_min,		C_TRAVEL_MIN },
-	{ "c","ctm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].travel_max,		C_TRAVEL_MAX },
+	{ "c","cvm",_fip,  0, cm_print_vm, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_C].velocity_max,	C_VELOCITY_MAX },
+	{ "c","cfr",_fip,  0, cm_print_fr, get_flt,   cm_set_vm, (float *)&cm.a[AXIS_C].feedrate_max,	C_FEEDRATE_MAX },
+	{ "c","ctn",_fip,  3, cm_print_tn, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_C].travel_min,		C_TRAVEL_MIN },
+	{ "c","ctm",_fip,  3, cm_print_tm, get_flt,   cm_set_travel, (float *)&cm.a[AXIS_C].travel_max,		C_TRAVEL_MAX },
 	{ "c","cjm",_fip,  0, cm_print_jm, get_flt,	  cm_set_jm, (float *)&cm.a[AXIS_C].jerk_max,		C_JERK_MAX },
 	{ "c","cjh",_fip,  0, cm_print_jh, get_flt,	  cm_set_jh, (float *)&cm.a[AXIS_C].jerk_high, 	    C_JERK_HIGH_SPEED },
-//	{ "c","cjd",_fip,  0, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].junction_dev,	C_JUNCTION_DEVIATION },//++++REMOVE
-	{ "c","cjd",_fipc, 4, cm_print_jd, get_nul,   set_nul,   (float *)&cs.null, 0 },                // DEPRECATED
+	{ "c","cjd",_fip,  4, cm_print_jd, get_flt,   cm_set_jd, (float *)&cm.a[AXIS_C].junction_dev,	0 },
 	{ "c","cra",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].radius,			C_RADIUS },
 #ifdef __ARM	// C axis extended parameters
 	{ "c","chi",_fip,  0, cm_print_hi, get_ui8,   cm_set_hi, (float *)&cm.a[AXIS_C].homing_input,   C_HOMING_INPUT },
@@ -346,44 +473,79 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "c","clv",_fip,  2, cm_print_lv, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].latch_velocity,	C_LATCH_VELOCITY },
 	{ "c","clb",_fip,  3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].latch_backoff,	C_LATCH_BACKOFF },
 	{ "c","czb",_fip,  3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].zero_backoff,	C_ZERO_BACKOFF },
+#ifdef __INPUT_SHAPING
+	{ "c","cist",_fip,  0, cm_print_ist,get_ui8,   cm_set_ist,(float *)&cm.a[AXIS_C].shaper_type,		C_SHAPER_TYPE },
+	{ "c","cisf",_fip,  1, cm_print_isf,get_flt,   cm_set_isf,(float *)&cm.a[AXIS_C].shaper_frequency,C_SHAPER_FREQUENCY },
+	{ "c","cisd",_fip,  3, cm_print_isd,get_flt,   cm_set_isd,(float *)&cm.a[AXIS_C].shaper_damping,	C_SHAPER_DAMPING },
+#endif
+#ifdef __PRESSURE_ADVANCE
+	{ "c","cpa",_fip,  3, cm_print_pa, get_flt,   cm_set_pa, (float *)&cm.a[AXIS_C].pressure_advance,C_PRESSURE_ADVANCE },
+#endif
 #endif
 
 	// Digital input configs
 	{ "di1","di1mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[0].mode,     DI1_MODE },
 	{ "di1","di1ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[0].action,   DI1_ACTION },
 	{ "di1","di1fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[0].function, DI1_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di1","di1fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[0].filter,   DI1_FILTER },
+#endif
 
 	{ "di2","di2mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[1].mode,     DI2_MODE },
 	{ "di2","di2ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[1].action,   DI2_ACTION },
 	{ "di2","di2fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[1].function, DI2_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di2","di2fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[1].filter,   DI2_FILTER },
+#endif
 
 	{ "di3","di3mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[2].mode,     DI3_MODE },
 	{ "di3","di3ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[2].action,   DI3_ACTION },
 	{ "di3","di3fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[2].function, DI3_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di3","di3fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[2].filter,   DI3_FILTER },
+#endif
 
 	{ "di4","di4mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[3].mode,     DI4_MODE },
 	{ "di4","di4ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[3].action,   DI4_ACTION },
 	{ "di4","di4fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[3].function, DI4_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di4","di4fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[3].filter,   DI4_FILTER },
+#endif
 
 	{ "di5","di5mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[4].mode,     DI5_MODE },
 	{ "di5","di5ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[4].action,   DI5_ACTION },
 	{ "di5","di5fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[4].function, DI5_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di5","di5fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[4].filter,   DI5_FILTER },
+#endif
 
 	{ "di6","di6mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[5].mode,     DI6_MODE },
 	{ "di6","di6ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[5].action,   DI6_ACTION },
 	{ "di6","di6fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[5].function, DI6_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di6","di6fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[5].filter,   DI6_FILTER },
+#endif
 
 	{ "di7","di7mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[6].mode,     DI7_MODE },
 	{ "di7","di7ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[6].action,   DI7_ACTION },
 	{ "di7","di7fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[6].function, DI7_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di7","di7fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[6].filter,   DI7_FILTER },
+#endif
 
 	{ "di8","di8mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[7].mode,     DI8_MODE },
 	{ "di8","di8ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[7].action,   DI8_ACTION },
 	{ "di8","di8fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[7].function, DI8_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di8","di8fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[7].filter,   DI8_FILTER },
+#endif
 
 	{ "di9","di9mo",_fip, 0, io_print_mo, get_int8,io_set_mo, (float *)&io.in[8].mode,     DI9_MODE },
 	{ "di9","di9ac",_fip, 0, io_print_ac, get_ui8, io_set_ac, (float *)&io.in[8].action,   DI9_ACTION },
 	{ "di9","di9fn",_fip, 0, io_print_fn, get_ui8, io_set_fn, (float *)&io.in[8].function, DI9_FUNCTION },
+#ifdef __INPUT_FILTERS
+	{ "di9","di9fl",_fip, 0, io_print_fl, get_ui8, io_set_fl, (float *)&io.in[8].filter,   DI9_FILTER },
+#endif
 
     // Digital input state readers
 	{ "in","in1", _f0, 0, io_print_in, io_get_input, set_nul, (float *)&cs.null, 0 },
@@ -395,6 +557,39 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "in","in7", _f0, 0, io_print_in, io_get_input, set_nul, (float *)&cs.null, 0 },
 	{ "in","in8", _f0, 0, io_print_in, io_get_input, set_nul, (float *)&cs.null, 0 },
 	{ "in","in9", _f0, 0, io_print_in, io_get_input, set_nul, (float *)&cs.null, 0 },
+#ifdef __ANALOG_INPUTS
+	// Analog input configs and readers
+	{ "ai1","ai1en",_fip, 0, io_print_aien, get_ui8, io_set_aien, (float *)&io.analog_in[0].enable,  AI1_ENABLE },
+	{ "ai1","ai1ch",_fip, 0, io_print_aich, get_ui8, io_set_aich, (float *)&io.analog_in[0].channel, AI1_CHANNEL },
+	{ "ai1","ai1sc",_fip, 3, io_print_aisc, get_flt, set_flt,     (float *)&io.analog_in[0].scale,   AI1_SCALE },
+	{ "ai1","ai1of",_fip, 3, io_print_aiof, get_flt, set_flt,     (float *)&io.analog_in[0].offset,  AI1_OFFSET },
+	{ "ai1","ai1vl",_f0,  3, io_print_aivl, io_get_analog, set_nul,(float *)&cs.null, 0 },
+
+	{ "ai2","ai2en",_fip, 0, io_print_aien, get_ui8, io_set_aien, (float *)&io.analog_in[1].enable,  AI2_ENABLE },
+	{ "ai2","ai2ch",_fip, 0, io_print_aich, get_ui8, io_set_aich, (float *)&io.analog_in[1].channel, AI2_CHANNEL },
+	{ "ai2","ai2sc",_fip, 3, io_print_aisc, get_flt, set_flt,     (float *)&io.analog_in[1].scale,   AI2_SCALE },
+	{ "ai2","ai2of",_fip, 3, io_print_aiof, get_flt, set_flt,     (float *)&io.analog_in[1].offset,  AI2_OFFSET },
+	{ "ai2","ai2vl",_f0,  3, io_print_aivl, io_get_analog, set_nul,(float *)&cs.null, 0 },
+
+	{ "ai3","ai3en",_fip, 0, io_print_aien, get_ui8, io_set_aien, (float *)&io.analog_in[2].enable,  AI3_ENABLE },
+	{ "ai3","ai3ch",_fip, 0, io_print_aich, get_ui8, io_set_aich, (float *)&io.analog_in[2].channel, AI3_CHANNEL },
+	{ "ai3","ai3sc",_fip, 3, io_print_aisc, get_flt, set_flt,     (float *)&io.analog_in[2].scale,   AI3_SCALE },
+	{ "ai3","ai3of",_fip, 3, io_print_aiof, get_flt, set_flt,     (float *)&io.analog_in[2].offset,  AI3_OFFSET },
+	{ "ai3","ai3vl",_f0,  3, io_print_aivl, io_get_analog, set_nul,(float *)&cs.null, 0 },
+
+	{ "ai4","ai4en",_fip, 0, io_print_aien, get_ui8, io_set_aien, (float *)&io.analog_in[3].enable,  AI4_ENABLE },
+	{ "ai4","ai4ch",_fip, 0, io_print_aich, get_ui8, io_set_aich, (float *)&io.analog_in[3].channel, AI4_CHANNEL },
+	{ "ai4","ai4sc",_fip, 3, io_print_aisc, get_flt, set_flt,     (float *)&io.analog_in[3].scale,   AI4_SCALE },
+	{ "ai4","ai4of",_fip, 3, io_print_aiof, get_flt, set_flt,     (float *)&io.analog_in[3].offset,  AI4_OFFSET },
+	{ "ai4","ai4vl",_f0,  3, io_print_aivl, io_get_analog, set_nul,(float *)&cs.null, 0 },
+#endif
+#ifdef __MOTION_OUTPUTS
+	// Digital output configs - switched by M62-M65
+	{ "do1","do1mo",_fip, 0, io_print_domo, get_int8, io_set_domo, (float *)&io.out[0].mode, DO1_MODE },
+	{ "do2","do2mo",_fip, 0, io_print_domo, get_int8, io_set_domo, (float *)&io.out[1].mode, DO2_MODE },
+	{ "do3","do3mo",_fip, 0, io_print_domo, get_int8, io_set_domo, (float *)&io.out[2].mode, DO3_MODE },
+	{ "do4","do4mo",_fip, 0, io_print_domo, get_int8, io_set_domo, (float *)&io.out[3].mode, DO4_MODE },
+#endif
 
 	// PWM settings
 	{ "p1","p1frq",_fip, 0, pwm_print_p1frq, get_flt, pwm_set_pwm,(float *)&pwm.c[PWM_1].frequency,    P1_PWM_FREQUENCY },
@@ -407,49 +602,85 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "p1","p1wpl",_fip, 3, pwm_print_p1wpl, get_flt, pwm_set_pwm,(float *)&pwm.c[PWM_1].ccw_phase_lo, P1_CCW_PHASE_LO },
 	{ "p1","p1wph",_fip, 3, pwm_print_p1wph, get_flt, pwm_set_pwm,(float *)&pwm.c[PWM_1].ccw_phase_hi, P1_CCW_PHASE_HI },
 	{ "p1","p1pof",_fip, 3, pwm_print_p1pof, get_flt, pwm_set_pwm,(float *)&pwm.c[PWM_1].phase_off,    P1_PWM_PHASE_OFF },
+	{ "p1","p1vmo",_fip, 0, pwm_print_p1vmo, get_ui8, set_01,     (float *)&pwm.c[PWM_1].velocity_mode, P1_VELOCITY_MODE },
+	{ "p1","p1vex",_fip, 3, pwm_print_p1vex, get_flt, set_flt,    (float *)&pwm.c[PWM_1].velocity_exponent, P1_VELOCITY_EXPONENT },
+	{ "p1","p1vmn",_fip, 3, pwm_print_p1vmn, get_flt, set_flt,    (float *)&pwm.c[PWM_1].velocity_min, P1_VELOCITY_MIN },
+
+	// Kinematics settings
+	{ "kn","knty", _fipn, 0, kn_print_knty,  get_ui8, kn_set_knty, (float *)&kn.type,               KINEMATICS },
+	{ "kn","knrod",_fipnc,3, kn_print_knrod, get_flt, kn_set_delta,(float *)&kn.delta_diagonal_rod, DELTA_DIAGONAL_ROD },
+	{ "kn","knrad",_fipnc,3, kn_print_knrad, get_flt, kn_set_delta,(float *)&kn.delta_radius,       DELTA_RADIUS },
+	{ "kn","kna1", _fipnc,3, kn_print_kna1,  get_flt, kn_set_scara,(float *)&kn.scara_arm_1,        SCARA_ARM_1 },
+	{ "kn","kna2", _fipnc,3, kn_print_kna2,  get_flt, kn_set_scara,(float *)&kn.scara_arm_2,        SCARA_ARM_2 },
+	{ "kn","kntol",_fipn, 4, kn_print_kntol, get_flt, kn_set_kntol,(float *)&kn.joint_tolerance,    KINEMATICS_JOINT_TOLERANCE },
+#ifdef __ROTARY_TCP
+	{ "kn","kntcp",_fipn, 0, kn_print_kntcp, get_ui8, kn_set_tcp,  (float *)&kn.tcp_axes,           TCP_AXES },
+	{ "kn","knpx", _fipnc,3, kn_print_knpx,  get_flt, kn_set_tcpp, (float *)&kn.tcp_pivot[0],       TCP_PIVOT_X },
+	{ "kn","knpy", _fipnc,3, kn_print_knpy,  get_flt, kn_set_tcpp, (float *)&kn.tcp_pivot[1],       TCP_PIVOT_Y },
+	{ "kn","knpz", _fipnc,3, kn_print_knpz,  get_flt, kn_set_tcpp, (float *)&kn.tcp_pivot[2],       TCP_PIVOT_Z },
+#endif
+#ifdef __HEIGHT_MAP
+	{ "msh","mshe", _fipn, 0, kn_print_mshe,  get_ui8, kn_set_mshe, (float *)&kn.map.mode,          HEIGHT_MAP_MODE },
+	{ "msh","mshx", _fipnc,3, kn_print_mshx,  get_flt, kn_set_msho, (float *)&kn.map.x,             HEIGHT_MAP_X },
+	{ "msh","mshy", _fipnc,3, kn_print_mshy,  get_flt, kn_set_msho, (float *)&kn.map.y,             HEIGHT_MAP_Y },
+	{ "msh","mshdx",_fipnc,3, kn_print_mshdx, get_flt, kn_set_mshd, (float *)&kn.map.dx,            HEIGHT_MAP_DX },
+	{ "msh","mshdy",_fipnc,3, kn_print_mshdy, get_flt, kn_set_mshd, (float *)&kn.map.dy,            HEIGHT_MAP_DY },
+	{ "msh","mshnx",_fipn, 0, kn_print_mshnx, get_ui8, kn_set_mshn, (float *)&kn.map.nx,            HEIGHT_MAP_NX },
+	{ "msh","mshny",_fipn, 0, kn_print_mshny, get_ui8, kn_set_mshn, (float *)&kn.map.ny,            HEIGHT_MAP_NY },
+	{ "msh","mshz", _fipnc,3, kn_print_mshz,  get_flt, set_flu,     (float *)&kn.map.probe_z,       HEIGHT_MAP_PROBE_Z },
+	{ "msh","mshcl",_fipnc,3, kn_print_mshcl, get_flt, set_flu,     (float *)&kn.map.clear_z,       HEIGHT_MAP_CLEAR_Z },
+	{ "msh","mshp", _f0,   0, kn_print_mshp,  get_int, cm_run_mshp, (float *)&kn.map.points,        0 },	// probe the grid, GET points in the map
+#endif
+#ifdef __PROBE_SCAN
+	{ "", "scan", _f0, 0, tx_print_int, cm_get_scan, cm_set_scan, (float *)&cs.null, 0 },	// SET 1 to record probe edges, 0 to stop - GET points recorded
+#endif
+
+	// JSON acknowledgement settings
+	{ "ack","ackn",_fipn, 0, js_print_ackn,  get_ui8, set_ui8, (float *)&js.json_ack_lines,         JSON_ACK_LINES },
+	{ "ack","ackt",_fipn, 0, js_print_ackt,  get_flt, set_flt, (float *)&js.json_ack_interval,      JSON_ACK_INTERVAL },
 
 	// Coordinate system offsets (G54-G59 and G92)
-	{ "g54","g54x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_X], G54_X_OFFSET },
-	{ "g54","g54y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_Y], G54_Y_OFFSET },
-	{ "g54","g54z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_Z], G54_Z_OFFSET },
-	{ "g54","g54a",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G54][AXIS_A], G54_A_OFFSET },
-	{ "g54","g54b",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G54][AXIS_B], G54_B_OFFSET },
-	{ "g54","g54c",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G54][AXIS_C], G54_C_OFFSET },
-
-	{ "g55","g55x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_X], G55_X_OFFSET },
-	{ "g55","g55y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_Y], G55_Y_OFFSET },
-	{ "g55","g55z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_Z], G55_Z_OFFSET },
-	{ "g55","g55a",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G55][AXIS_A], G55_A_OFFSET },
-	{ "g55","g55b",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G55][AXIS_B], G55_B_OFFSET },
-	{ "g55","g55c",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G55][AXIS_C], G55_C_OFFSET },
-
-	{ "g56","g56x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_X], G56_X_OFFSET },
-	{ "g56","g56y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_Y], G56_Y_OFFSET },
-	{ "g56","g56z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_Z], G56_Z_OFFSET },
-	{ "g56","g56a",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G56][AXIS_A], G56_A_OFFSET },
-	{ "g56","g56b",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G56][AXIS_B], G56_B_OFFSET },
-	{ "g56","g56c",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G56][AXIS_C], G56_C_OFFSET },
-
-	{ "g57","g57x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_X], G57_X_OFFSET },
-	{ "g57","g57y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_Y], G57_Y_OFFSET },
-	{ "g57","g57z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_Z], G57_Z_OFFSET },
-	{ "g57","g57a",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G57][AXIS_A], G57_A_OFFSET },
-	{ "g57","g57b",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G57][AXIS_B], G57_B_OFFSET },
-	{ "g57","g57c",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G57][AXIS_C], G57_C_OFFSET },
-
-	{ "g58","g58x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_X], G58_X_OFFSET },
-	{ "g58","g58y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_Y], G58_Y_OFFSET },
-	{ "g58","g58z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_Z], G58_Z_OFFSET },
-	{ "g58","g58a",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G58][AXIS_A], G58_A_OFFSET },
-	{ "g58","g58b",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G58][AXIS_B], G58_B_OFFSET },
-	{ "g58","g58c",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G58][AXIS_C], G58_C_OFFSET },
-
-	{ "g59","g59x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_X], G59_X_OFFSET },
-	{ "g59","g59y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_Y], G59_Y_OFFSET },
-	{ "g59","g59z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_Z], G59_Z_OFFSET },
-	{ "g59","g59a",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G59][AXIS_A], G59_A_OFFSET },
-	{ "g59","g59b",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G59][AXIS_B], G59_B_OFFSET },
-	{ "g59","g59c",_fip,  3, cm_print_cofs, get_flt, set_flt,(float *)&cm.offset[G59][AXIS_C], G59_C_OFFSET },
+	{ "g54","g54x",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G54][AXIS_X], G54_X_OFFSET },
+	{ "g54","g54y",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G54][AXIS_Y], G54_Y_OFFSET },
+	{ "g54","g54z",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G54][AXIS_Z], G54_Z_OFFSET },
+	{ "g54","g54a",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G54][AXIS_A], G54_A_OFFSET },
+	{ "g54","g54b",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G54][AXIS_B], G54_B_OFFSET },
+	{ "g54","g54c",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G54][AXIS_C], G54_C_OFFSET },
+
+	{ "g55","g55x",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G55][AXIS_X], G55_X_OFFSET },
+	{ "g55","g55y",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G55][AXIS_Y], G55_Y_OFFSET },
+	{ "g55","g55z",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G55][AXIS_Z], G55_Z_OFFSET },
+	{ "g55","g55a",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G55][AXIS_A], G55_A_OFFSET },
+	{ "g55","g55b",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G55][AXIS_B], G55_B_OFFSET },
+	{ "g55","g55c",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G55][AXIS_C], G55_C_OFFSET },
+
+	{ "g56","g56x",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G56][AXIS_X], G56_X_OFFSET },
+	{ "g56","g56y",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G56][AXIS_Y], G56_Y_OFFSET },
+	{ "g56","g56z",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G56][AXIS_Z], G56_Z_OFFSET },
+	{ "g56","g56a",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G56][AXIS_A], G56_A_OFFSET },
+	{ "g56","g56b",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G56][AXIS_B], G56_B_OFFSET },
+	{ "g56","g56c",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G56][AXIS_C], G56_C_OFFSET },
+
+	{ "g57","g57x",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G57][AXIS_X], G57_X_OFFSET },
+	{ "g57","g57y",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G57][AXIS_Y], G57_Y_OFFSET },
+	{ "g57","g57z",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G57][AXIS_Z], G57_Z_OFFSET },
+	{ "g57","g57a",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G57][AXIS_A], G57_A_OFFSET },
+	{ "g57","g57b",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G57][AXIS_B], G57_B_OFFSET },
+	{ "g57","g57c",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G57][AXIS_C], G57_C_OFFSET },
+
+	{ "g58","g58x",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G58][AXIS_X], G58_X_OFFSET },
+	{ "g58","g58y",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G58][AXIS_Y], G58_Y_OFFSET },
+	{ "g58","g58z",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G58][AXIS_Z], G58_Z_OFFSET },
+	{ "g58","g58a",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G58][AXIS_A], G58_A_OFFSET },
+	{ "g58","g58b",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G58][AXIS_B], G58_B_OFFSET },
+	{ "g58","g58c",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G58][AXIS_C], G58_C_OFFSET },
+
+	{ "g59","g59x",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G59][AXIS_X], G59_X_OFFSET },
+	{ "g59","g59y",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G59][AXIS_Y], G59_Y_OFFSET },
+	{ "g59","g59z",_fipc, 3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G59][AXIS_Z], G59_Z_OFFSET },
+	{ "g59","g59a",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G59][AXIS_A], G59_A_OFFSET },
+	{ "g59","g59b",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G59][AXIS_B], G59_B_OFFSET },
+	{ "g59","g59c",_fip,  3, cm_print_cofs, get_flt, cm_set_cofs,(float *)&cm.offset[G59][AXIS_C], G59_C_OFFSET },
 
 	{ "g92","g92x",_fic, 3, cm_print_cofs, get_flt, set_nul,(float *)&cm.gmx.origin_offset[AXIS_X], 0 },// G92 handled differently
 	{ "g92","g92y",_fic, 3, cm_print_cofs, get_flt, set_nul,(float *)&cm.gmx.origin_offset[AXIS_Y], 0 },
@@ -482,10 +713,66 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	// General system parameters
 	{ "sys","ja", _fipn, 2, cm_print_ja,  get_flt, cm_set_ja,(float *)&cm.junction_aggression,      JUNCTION_AGGRESSION },
 	{ "sys","ct", _fipnc,4, cm_print_ct,  get_flt, set_flu,  (float *)&cm.chordal_tolerance,        CHORDAL_TOLERANCE },
-	{ "sys","sl", _fipn, 0, cm_print_sl,  get_ui8, set_01,   (float *)&cm.soft_limit_enable,        SOFT_LIMIT_ENABLE },
+	{ "sys","ca", _fipn, 2, cm_print_ca,  get_flt, set_flt,  (float *)&cm.coalesce_angle,           COALESCE_ANGLE },
+	{ "sys","la", _fipn, 0, cm_print_la,  get_flt, set_flt,  (float *)&cm.planner_lookahead,        PLANNER_LOOKAHEAD_MS },
+	{ "sys","bst",_fipn, 0, cm_print_bst, get_flt, cm_set_bst,(float *)&cm.body_segment_time,       BODY_SEGMENT_USEC },
+	{ "sys","sw", _fipn, 0, cm_print_sw,  get_ui8, set_ui8,  (float *)&cm.smoothing_window,         FEED_SMOOTHING_WINDOW },
+#ifdef __VELOCITY_HINTS
+	{ "sys","vh", _fipn, 0, cm_print_vh,  get_ui8, set_01,   (float *)&cm.velocity_hints,           VELOCITY_HINTS },
+#endif
+	{ "sys","sl", _fipn, 0, cm_print_sl,  get_ui8, cm_set_sl, (float *)&cm.soft_limit_enable,        SOFT_LIMIT_ENABLE },
 	{ "sys","lim",_fipn, 0, cm_print_lim, get_ui8, set_01,   (float *)&cm.limit_enable,	            HARD_LIMIT_ENABLE },
 	{ "sys","saf",_fipn, 0, cm_print_saf, get_ui8, set_01,   (float *)&cm.safety_interlock_enable,	SAFETY_INTERLOCK_ENABLE },
+	{ "sys","prbi",_fipn,0, cm_print_prbi,get_ui8, cm_set_prbi,(float *)&cm.probe_input,            PROBE_INPUT },
+	{ "sys","few",_fipn, 1, cm_print_few, get_flt, set_flt,  (float *)&cm.stall_warning,            STALL_WARNING_STEPS },
+	{ "sys","fes",_fipn, 2, cm_print_fes, get_flt, set_flt,  (float *)&cm.stall_feed_step,          STALL_FEED_STEP },
+#ifdef __INPUT_FILTERS
+	{ "sys","idb",_fipn, 1, io_print_idb, get_flt, io_set_idb,(float *)&io.debounce_time,          INPUT_DEBOUNCE_TIME },
+#endif
+#ifdef __ANALOG_INPUTS
+	{ "sys","lfi",_fipn, 0, cm_print_lfi, get_ui8, cm_set_lfi,(float *)&cm.load_feed_input,         LOAD_FEED_INPUT },
+	{ "sys","lft",_fipn, 3, cm_print_lft, get_flt, cm_set_lft,(float *)&cm.load_feed_target,        LOAD_FEED_TARGET },
+	{ "sys","lfg",_fipn, 3, cm_print_lfg, get_flt, set_flt,  (float *)&cm.load_feed_gain,           LOAD_FEED_GAIN },
+	{ "sys","lfm",_fipn, 2, cm_print_lfm, get_flt, cm_set_lfm,(float *)&cm.load_feed_min,           LOAD_FEED_MIN },
+	{ "sys","lfx",_fipn, 2, cm_print_lfx, get_flt, cm_set_lfx,(float *)&cm.load_feed_max,           LOAD_FEED_MAX },
+	{ "",   "lfo",_f0,   2, cm_print_lfo, cm_get_lfo, set_nul,(float *)&cs.null, 0 },	// adaptive feed factor now
+#endif
+#ifdef __TANGENTIAL_KNIFE
+	{ "sys","tna",_fipn, 0, cm_print_tna, get_ui8, cm_set_tna,(float *)&cm.tangent_axis,            TANGENT_AXIS },
+	{ "sys","tnc",_fipn, 1, cm_print_tnc, get_flt, set_flt,  (float *)&cm.tangent_corner,           TANGENT_CORNER },
+	{ "sys","tnl",_fipn, 3, cm_print_tnl, get_flt, set_flt,  (float *)&cm.tangent_lift,             TANGENT_LIFT },
+#endif
+#ifdef __TORCH_HEIGHT
+	{ "sys","thi",_fipn, 0, cm_print_thi, get_ui8, cm_set_thi,(float *)&cm.thc_input,               THC_INPUT },
+	{ "sys","thv",_fipn, 1, cm_print_thv, get_flt, set_flt,  (float *)&cm.thc_voltage,              THC_VOLTAGE },
+	{ "sys","thg",_fipn, 1, cm_print_thg, get_flt, set_flt,  (float *)&cm.thc_gain,                 THC_GAIN },
+	{ "sys","thr",_fipn, 1, cm_print_thr, get_flt, set_flt,  (float *)&cm.thc_rate,                 THC_RATE },
+	{ "sys","thl",_fipn, 3, cm_print_thl, get_flt, set_flt,  (float *)&cm.thc_limit,                THC_LIMIT },
+	{ "sys","tha",_fipn, 2, cm_print_tha, get_flt, set_flt,  (float *)&cm.thc_antidive,             THC_ANTIDIVE },
+	{ "sys","thd",_fipn, 2, cm_print_thd, get_flt, set_flt,  (float *)&cm.thc_delay,                THC_DELAY },
+	{ "",   "tho",_f0,   3, cm_print_tho, cm_get_tho, set_nul,(float *)&cs.null, 0 },	// torch height correction now
+#endif
+#ifdef __PATH_RETRACE
+	{ "sys","rtv",_fipn, 1, cm_print_rtv, get_flt, set_flt,  (float *)&cm.retrace_velocity,         RETRACE_VELOCITY },
+	{ "",   "rtr",_f0,   3, cm_print_rtr, cm_get_rtr, cm_set_rtr,(float *)&cs.null, 0 },	// SET mm to back up along the path in a hold, GET mm backed up
+#endif
+	{ "",   "hmc",_fip,  0, cm_print_hmc, get_ui8, set_01,   (float *)&cm.homing_concurrent,        HOMING_CONCURRENT },	// home independent axes together
 	{ "sys","mt", _fipn, 2, st_print_mt,  get_flt, st_set_mt,(float *)&st_cfg.motor_power_timeout,  MOTOR_POWER_TIMEOUT},
+	{ "sys","ipl",_fipn, 2, st_print_ipl, get_flt, st_set_ipl,(float *)&st_cfg.idle_power_factor,   MOTOR_IDLE_POWER_FACTOR },
+	{ "sys","spw",_fipn, 2, st_print_spw, get_flt, st_set_spw,(float *)&st_cfg.step_pulse_width,    STEP_PULSE_WIDTH },
+	{ "sys","dst",_fipn, 2, st_print_dst, get_flt, st_set_dst,(float *)&st_cfg.direction_setup_time,DIRECTION_SETUP_TIME },
+#ifdef __MICROSTEP_MORPH
+	{ "sys","msr",_fipn, 0, st_print_msr, get_flt, st_set_msr,(float *)&st_cfg.morph_rate,          MICROSTEP_MORPH_RATE },
+#endif
+	{ "sys","net",_fipn, 0, st_print_net, get_ui8, st_set_net,(float *)&cs.network_mode,            NETWORK_MODE },
+	{ "sys","ast",_fipn, 0, controller_print_ast, get_ui8, set_ui8,(float *)&cs.assertion_interval, ASSERTION_INTERVAL_MS },
+#ifdef __AUX_MOTION
+	{ "sys","auxm",_fipn,0, st_print_auxm,get_ui8, st_set_auxm,(float *)&st_aux.motor,              AUX_MOTOR },
+	{ "sys","auxv",_fipn,2, st_print_auxv,get_flt, st_set_auxv,(float *)&st_aux.velocity_max,       AUX_VELOCITY },
+	{ "sys","auxa",_fipn,2, st_print_auxa,get_flt, st_set_auxa,(float *)&st_aux.acceleration,       AUX_ACCELERATION },
+	{ "",   "aux", _f0,  3, st_print_aux, st_get_aux, st_set_aux,(float *)&cs.null, 0 },	// queue an aux move, GET the aux position
+	{ "",   "auxq",_f0,  0, st_print_auxq,st_get_auxq,set_nul, (float *)&cs.null, 0 },	// aux moves queued
+#endif
 
     // Spindle functions
     { "sys","spep",_fipn,0, cm_print_spep,get_ui8, set_01,  (float *)&spindle.enable_polarity,      SPINDLE_ENABLE_POLARITY },
@@ -495,6 +782,13 @@ const cfgItem_t cfgArray[] PROGMEM = {
     { "",   "spe", _f0,  0, cm_print_spe, get_ui8, set_nul, (float *)&spindle.enable, 0 },          // get spindle enable
     { "",   "spd", _f0,  0, cm_print_spd, get_ui8, cm_set_dir,(float *)&spindle.direction, 0 },     // get spindle direction
     { "",   "sps", _f0,  0, cm_print_sps, get_flt, set_nul, (float *)&spindle.speed, 0 },           // get spindle speed
+    { "",   "spsy",_fip, 0, cm_print_spsy,get_ui8, set_01,  (float *)&spindle.sync_mode,            SPINDLE_SYNC_MODE },
+    { "",   "spra",_fip, 0, cm_print_spra,get_flt, set_flt, (float *)&spindle.ramp_rate,            SPINDLE_RAMP_RATE },
+#ifdef __THREADING
+    { "",   "spr", _f0,  0, cm_print_spr, spindle_get_spr, set_nul, (float *)&cs.null, 0 },          // get spindle speed measured by the index
+#endif
+    { "",   "rsp", _fip, 3, pwm_print_rsp,get_flt, set_flt, (float *)&raster.spacing,               RASTER_SPACING },
+    { "",   "rsd", _f0,  0, tx_print_nul, get_nul, raster_set_data,(float *)&cs.null,               0 },	// load raster line power values
 
     // Coolant functions
     { "sys","cofp",_fipn,0, cm_print_cofp,get_ui8, set_01,  (float *)&coolant.flood_polarity,       COOLANT_FLOOD_POLARITY },
@@ -510,9 +804,12 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "sys","ej", _fipn, 0, js_print_ej,  get_ui8, set_01,     (float *)&cs.comm_mode,              COMM_MODE },
 	{ "sys","jv", _fipn, 0, js_print_jv,  get_ui8, json_set_jv,(float *)&js.json_verbosity,         JSON_VERBOSITY },
 	{ "sys","js", _fipn, 0, js_print_js,  get_ui8, set_01,     (float *)&js.json_syntax,            JSON_SYNTAX_MODE },
+	{ "sys","jf", _fipn, 0, js_print_jf,  get_ui8, json_set_jf,(float *)&js.json_footer_style,      JSON_FOOTER_STYLE },
 	{ "sys","qv", _fipn, 0, qr_print_qv,  get_ui8, set_0123,   (float *)&qr.queue_report_verbosity, QUEUE_REPORT_VERBOSITY },
 	{ "sys","sv", _fipn, 0, sr_print_sv,  get_ui8, set_012,    (float *)&sr.status_report_verbosity,STATUS_REPORT_VERBOSITY },
 	{ "sys","si", _fipn, 0, sr_print_si,  get_int, sr_set_si,  (float *)&sr.status_report_interval, STATUS_REPORT_INTERVAL_MS },
+	{ "sys","rr", _fipn, 0, rpt_print_rr, get_int, rpt_set_rr, (float *)&rpt.report_rate_limit,     REPORT_RATE_LIMIT },
+	{ "sys","rxm",_fipn, 0, rx_print_rxm, get_ui8, rx_set_rxm, (float *)&rx.rx_report_mode,         RX_REPORT_MODE },
 //	{ "sys","spi", _fipn, 0, xio_print_spi,get_ui8,xio_set_spi,(float *)&xio.spi_state,			0 },
 
 #ifdef __AVR
@@ -533,12 +830,51 @@ const cfgItem_t cfgArray[] PROGMEM = {
 
     // Actions and Reports
     { "", "sr",  _f0, 0, sr_print_sr,  sr_get,    sr_set,    (float *)&cs.null, 0 },	// request and set status reports
+#ifdef __BINARY_DATA
+    { "", "ssi", _fip, 0, sr_print_ssi, get_int,  sr_set_ssi,(float *)&sr.status_stream_interval, STATUS_STREAM_INTERVAL_MS },// status stream on the data channel
+#endif
+#ifdef __REPORT_FANOUT
+    { "", "sub", _f0, 0, tx_print_int, rpt_get_sub, rpt_set_sub,(float *)&cs.null, 0 },	// subscribe the channel to reports: 1=status and watch, 2=stream, 3=both
+#endif
+    { "", "w1",  _f0, 0, tx_print_nul, wl_get,   wl_set,    (float *)&cs.null, 0 },	// get and set watch list 1
+    { "", "w1i", _fip, 0, wl_print_wi, get_int,  wl_set_wi, (float *)&wl[0].watch_interval, WATCH_INTERVAL_MS },// watch list 1 minimum interval
+    { "", "w1d", _fip, 3, wl_print_wd, get_flt,  set_flt,   (float *)&wl[0].watch_deadband, WATCH_DEADBAND },	// watch list 1 deadband
+#if (WATCH_CHANNELS >= 2)
+    { "", "w2",  _f0, 0, tx_print_nul, wl_get,   wl_set,    (float *)&cs.null, 0 },	// get and set watch list 2
+    { "", "w2i", _fip, 0, wl_print_wi, get_int,  wl_set_wi, (float *)&wl[1].watch_interval, WATCH_INTERVAL_MS },// watch list 2 minimum interval
+    { "", "w2d", _fip, 3, wl_print_wd, get_flt,  set_flt,   (float *)&wl[1].watch_deadband, WATCH_DEADBAND },	// watch list 2 deadband
+#endif
+#if (WATCH_CHANNELS >= 3)
+    { "", "w3",  _f0, 0, tx_print_nul, wl_get,   wl_set,    (float *)&cs.null, 0 },	// get and set watch list 3
+    { "", "w3i", _fip, 0, wl_print_wi, get_int,  wl_set_wi, (float *)&wl[2].watch_interval, WATCH_INTERVAL_MS },// watch list 3 minimum interval
+    { "", "w3d", _fip, 3, wl_print_wd, get_flt,  set_flt,   (float *)&wl[2].watch_deadband, WATCH_DEADBAND },	// watch list 3 deadband
+#endif
+#if (WATCH_CHANNELS >= 4)
+    { "", "w4",  _f0, 0, tx_print_nul, wl_get,   wl_set,    (float *)&cs.null, 0 },	// get and set watch list 4
+    { "", "w4i", _fip, 0, wl_print_wi, get_int,  wl_set_wi, (float *)&wl[3].watch_interval, WATCH_INTERVAL_MS },// watch list 4 minimum interval
+    { "", "w4d", _fip, 3, wl_print_wd, get_flt,  set_flt,   (float *)&wl[3].watch_deadband, WATCH_DEADBAND },	// watch list 4 deadband
+#endif
     { "", "qr",  _f0, 0, qr_print_qr,  qr_get,    set_nul,   (float *)&cs.null, 0 },	// get queue value - planner buffers available
     { "", "qi",  _f0, 0, qr_print_qi,  qi_get,    set_nul,   (float *)&cs.null, 0 },	// get queue value - buffers added to queue
     { "", "qo",  _f0, 0, qr_print_qo,  qo_get,    set_nul,   (float *)&cs.null, 0 },	// get queue value - buffers removed from queue
+    { "", "qt",  _f0, 0, qr_print_qt,  qt_get,    set_nul,   (float *)&cs.null, 0 },	// get queue value - planned time in ms
+    { "", "qd",  _f0, 0, tx_print_int, qd_get,    set_nul,   (float *)&cs.null, 0 },	// get queue telemetry - times the runtime ran dry this cycle
+    { "", "qp",  _f0, 0, tx_print_int, qp_get,    set_nul,   (float *)&cs.null, 0 },	// get queue telemetry - plans forced by the planner timeout
+    { "", "qz",  _f0, 0, tx_print_int, qz_get,    set_nul,   (float *)&cs.null, 0 },	// get queue telemetry - moves stopped by the end of the lookahead
+    { "", "qtn", _f0, 0, tx_print_int, qtn_get,   set_nul,   (float *)&cs.null, 0 },	// get queue telemetry - least time in planner in ms
+    { "", "qta", _f0, 0, tx_print_int, qta_get,   set_nul,   (float *)&cs.null, 0 },	// get queue telemetry - average time in planner in ms
+    { "", "qtx", _f0, 0, tx_print_int, qtx_get,   set_nul,   (float *)&cs.null, 0 },	// get queue telemetry - most time in planner in ms
     { "", "er",  _f0, 0, tx_print_nul, rpt_er,    set_nul,   (float *)&cs.null, 0 },	// get bogus exception report for testing
     { "", "qf",  _f0, 0, tx_print_nul, get_nul,   cm_run_qf, (float *)&cs.null, 0 },	// SET to invoke queue flush
+    { "", "mv",  _fa, 0, tx_print_nul, get_nul,   cm_run_mv, (float *)&cs.null, 0 },	// SET an array to queue a batch of straight feeds
+    { "", "dry", _f0, 3, tx_print_flt, cm_get_dry, cm_run_dry,(float *)&cs.null, 0 },	// SET 1/0 to start/end a dry plan, GET job time in seconds
+    { "", "start",_f0,0, tx_print_int, gc_get_start,gc_set_start,(float *)&cs.null, 0 },	// SET the line to start the program that follows at, 0 to cancel
+#ifdef __WATCHDOG
+    { "", "warm", _f0, 0, tx_print_int, cm_get_warm, set_nul,   (float *)&cs.null, 0 },	// get the last line run before a warm restart, 0 if none
+#endif
     { "", "rx",  _f0, 0, tx_print_int, get_rx,    set_nul,   (float *)&cs.null, 0 },	// get RX buffer bytes or packets
+    { "", "rxl", _f0, 0, tx_print_int, rxl_get,   set_nul,   (float *)&cs.null, 0 },	// get line credit - see rx_report_callback()
+    { "", "rxb", _f0, 0, tx_print_int, rxb_get,   set_nul,   (float *)&cs.null, 0 },	// get byte credit
     { "", "msg", _f0, 0, tx_print_str, get_nul,   set_nul,   (float *)&cs.null, 0 },	// string for generic messages
     { "", "alarm",_f0,0, tx_print_nul, cm_alrm,   cm_alrm,   (float *)&cs.null, 0 },	// trigger alarm
     { "", "panic",_f0,0, tx_print_nul, cm_pnic,   cm_pnic,   (float *)&cs.null, 0 },	// trigger panic
@@ -552,7 +888,18 @@ const cfgItem_t cfgArray[] PROGMEM = {
 
     { "", "test",_f0, 0, tx_print_nul, help_test, run_test,  (float *)&cs.null,0 },	    // run tests, print test help screen
     { "", "defa",_f0, 0, tx_print_nul, help_defa, set_defaults,(float *)&cs.null,0 },	// set/print defaults / help screen
+    { "", "cfg", _f0, 0, tx_print_nul, config_get_snapshot, config_set_snapshot,(float *)&cs.null,0 },	// get/load base32 config snapshot
     { "", "flash",_f0,0, tx_print_nul, help_flash,hw_flash,  (float *)&cs.null,0 },
+#ifdef __FILE_CHANNEL
+    { "", "run", _f0, 0, tx_print_nul, xio_get_run, xio_set_run,(float *)&cs.null,0 },	// run a file from the SD card, GET the file running
+#endif
+#ifdef __ETHERNET_CHANNEL
+	{ "eth","ethad",_fip, 0, tx_print_int, get_data, eth_set_net, (float *)&eth.address, 0 },	// IP address as data ("0xC0A80132"), 0=ETHERNET_ADDRESS
+	{ "eth","ethgw",_fip, 0, tx_print_int, get_data, eth_set_net, (float *)&eth.gateway, 0 },	// gateway, 0=ETHERNET_GATEWAY
+	{ "eth","ethmk",_fip, 0, tx_print_int, get_data, eth_set_net, (float *)&eth.netmask, 0 },	// subnet mask, 0=ETHERNET_NETMASK
+	{ "eth","ethpt",_fip, 0, tx_print_int, get_int,  eth_set_port,(float *)&eth.port,    ETHERNET_PORT },
+	{ "eth","ethcn",_f0,  0, tx_print_int, eth_get_ethcn, set_nul,(float *)&cs.null,   0 },	// clients connected
+#endif
 
 #ifdef __HELP_SCREENS
     { "", "help",_f0, 0, tx_print_nul, help_config, set_nul, (float *)&cs.null,0 },     // prints config help screen
@@ -585,6 +932,29 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	// Diagnostic parameters
 #ifdef __DIAGNOSTIC_PARAMETERS
 	{ "",    "clc",_f0, 0, tx_print_nul, st_clc,  st_clc, (float *)&cs.null, 0 },	// clear diagnostic step counters
+	{ "",    "mem",_f0, 0, tx_print_nul, hw_get_mem, set_nul, (float *)&cs.null, 0 },	// GET RAM usage and stack high-water mark
+#ifdef __ISR_PROFILE
+	{ "",    "isr",_f0, 0, tx_print_nul, st_get_isr, set_nul, (float *)&cs.null, 0 },	// GET stepper ISR profile (cleared by clc)
+#endif
+#ifdef __TASK_PROFILE
+	{ "",    "prof",_f0,0, tx_print_nul, controller_get_prof, controller_set_prof, (float *)&cs.null, 0 },	// GET main loop profile, SET to clear it
+#endif
+#ifdef __PLANNER_PROFILE
+	{ "",    "bench",_f0,0, tx_print_nul, get_bench, run_bench, (float *)&cs.null, 0 },	// GET planner profile, SET to run benchmark n (0 to clear)
+	{ "",    "bmot",_f0, 0, tx_print_nul, get_ui8, set_01, (float *)&bench_motors, 1 },	// 0 takes the motor drivers out for benchmark runs
+#endif
+#ifdef __JSON_BENCH
+	{ "",    "jbench",_f0,0, tx_print_nul, get_nul, json_run_bench, (float *)&cs.null, 0 },	// SET to run the JSON parser benchmark and fuzz n times
+#endif
+#ifdef __MOTION_TRACE
+	{ "",    "trace",_f0,0, tx_print_int, tr_get, tr_set, (float *)&cs.null, 0 },	// GET trace records held, SET 1 to record, 0 to stop, 2 to dump
+#endif
+#ifdef __LINE_TIMES
+	{ "",    "ltim",_f0, 0, tx_print_int, lt_get, lt_set, (float *)&cs.null, 0 },	// SET 1 to send per-line executed times, 0 to stop
+#endif
+#ifdef __PLANNER_STATS
+	{ "",    "pstat",_f0,0, tx_print_nul, mp_get_stats, mp_set_stats, (float *)&cs.null, 0 },	// GET achieved vs requested feed statistics, SET to clear them
+#endif
 
 	{ "_te","_tex",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_X], 0 },				// X target endpoint
 	{ "_te","_tey",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_Y], 0 },
@@ -647,8 +1017,26 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "_es","_es6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_6], 0 },
 	{ "_xs","_xs5",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_6].corrected_steps, 0 },
 	{ "_fe","_fe6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_6], 0 },
+#endif
+#if (MOTORS >= 7)
+	{ "_ts","_ts7",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_7], 0 },
+	{ "_ps","_ps7",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_7], 0 },
+	{ "_cs","_cs7",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_7], 0 },
+	{ "_es","_es7",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_7], 0 },
+	{ "_xs","_xs7",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_7].corrected_steps, 0 },
+	{ "_fe","_fe7",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_7], 0 },
+#endif
+#if (MOTORS >= 8)
+	{ "_ts","_ts8",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_8], 0 },
+	{ "_ps","_ps8",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_8], 0 },
+	{ "_cs","_cs8",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_8], 0 },
+	{ "_es","_es8",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_8], 0 },
+	{ "_xs","_xs8",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_8].corrected_steps, 0 },
+	{ "_fe","_fe8",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_8], 0 },
 #endif
 	{ "",   "_dam",_f0, 0, tx_print_nul, cm_dam,  cm_dam, (float *)&cs.null, 0 },	// dump active model
+	{ "",   "_alc",_f0, 0, tx_print_int, get_int, set_int,(float *)&mb.aline_count, 0 },		// alines added to planner
+	{ "",   "_tzc",_f0, 0, tx_print_int, get_int, set_int,(float *)&mb.trapezoid_count, 0 },	// trapezoids generated by replanning
 #endif	//  __DIAGNOSTIC_PARAMETERS
 
 	// Persistence for status report - must be in sequence
@@ -700,6 +1088,8 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	// *** START COUNTING FROM HERE ***
 	{ "","sys",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// system group
 	{ "","p1", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// PWM 1 group
+	{ "","kn", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// kinematics group
+	{ "","ack",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// JSON acknowledgement group
 
 	{ "","1",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// motor groups
 	{ "","2",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
@@ -711,6 +1101,12 @@ const cfgItem_t cfgArray[] PROGMEM = {
 #if (MOTORS >= 6)
 	{ "","6",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
 #endif
+#if (MOTORS >= 7)
+	{ "","7",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+#endif
+#if (MOTORS >= 8)
+	{ "","8",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+#endif
 
 	{ "","x",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// axis groups
 	{ "","y",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
@@ -729,6 +1125,18 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "","di7", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
 	{ "","di8", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
 	{ "","di9", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+#ifdef __ANALOG_INPUTS
+	{ "","ai1", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },   // analog input configs
+	{ "","ai2", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","ai3", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","ai4", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+#endif
+#ifdef __MOTION_OUTPUTS
+	{ "","do1", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },   // digital output configs
+	{ "","do2", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","do3", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","do4", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+#endif
 
 	{ "","g54",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// coord offset groups
 	{ "","g55",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
@@ -741,13 +1149,21 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "","g30",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// g30 home position
 
 	{ "","mpo",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// machine position group
+	{ "","mpe",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// measured (encoder) position group
 	{ "","pos",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// work position group
 	{ "","ofs",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// work offset group
 	{ "","hom",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// axis homing state group
 	{ "","prb",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// probing state group
 	{ "","jog",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// axis jogging state group
+	{ "","jgv",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// velocity jog group
 	{ "","jid",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// job ID group
 
+#ifdef __HEIGHT_MAP
+	{ "","msh", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// height map group
+#endif
+#ifdef __ETHERNET_CHANNEL
+	{ "","eth", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// ethernet channel group
+#endif
 #ifdef __USER_DATA
 	{ "","uda", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// user data group
 	{ "","udb", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// user data group
@@ -777,7 +1193,7 @@ const cfgItem_t cfgArray[] PROGMEM = {
 /***** Make sure these defines line up with any changes in the above table *****/
 
 #define NV_COUNT_UBER_GROUPS 	5 		// count of uber-groups, above
-#define STANDARD_GROUPS 		38		// count of standard groups, excluding diagnostic and user data groups
+#define STANDARD_GROUPS 		42		// count of standard groups, excluding diagnostic and user data groups
 
 #if (MOTORS >= 5)
 #define MOTOR_GROUP_5			1
@@ -791,6 +1207,18 @@ const cfgItem_t cfgArray[] PROGMEM = {
 #define MOTOR_GROUP_6			0
 #endif
 
+#if (MOTORS >= 7)
+#define MOTOR_GROUP_7			1
+#else
+#define MOTOR_GROUP_7			0
+#endif
+
+#if (MOTORS >= 8)
+#define MOTOR_GROUP_8			1
+#else
+#define MOTOR_GROUP_8			0
+#endif
+
 
 #ifdef __USER_DATA
 #define USER_DATA_GROUPS 		4		// count of user data groups only
@@ -798,12 +1226,36 @@ const cfgItem_t cfgArray[] PROGMEM = {
 #define USER_DATA_GROUPS 		0
 #endif
 
+#ifdef __HEIGHT_MAP
+#define HEIGHT_MAP_GROUPS 		1		// height map group
+#else
+#define HEIGHT_MAP_GROUPS 		0
+#endif
+
+#ifdef __ETHERNET_CHANNEL
+#define ETHERNET_GROUPS 		1		// ethernet channel group
+#else
+#define ETHERNET_GROUPS 		0
+#endif
+
+#ifdef __ANALOG_INPUTS
+#define ANALOG_INPUT_GROUPS 	4		// analog input groups
+#else
+#define ANALOG_INPUT_GROUPS 	0
+#endif
+
+#ifdef __MOTION_OUTPUTS
+#define DIGITAL_OUTPUT_GROUPS 	4		// digital output groups
+#else
+#define DIGITAL_OUTPUT_GROUPS 	0
+#endif
+
 #ifdef __DIAGNOSTIC_PARAMETERS
 #define DIAGNOSTIC_GROUPS 		8		// count of diagnostic groups only
 #else
 #define DIAGNOSTIC_GROUPS 		0
 #endif
-#define NV_COUNT_GROUPS 		(STANDARD_GROUPS + MOTOR_GROUP_5 + MOTOR_GROUP_6 + DIAGNOSTIC_GROUPS + USER_DATA_GROUPS)
+#define NV_COUNT_GROUPS 		(STANDARD_GROUPS + MOTOR_GROUP_5 + MOTOR_GROUP_6 + MOTOR_GROUP_7 + MOTOR_GROUP_8 + DIAGNOSTIC_GROUPS + USER_DATA_GROUPS + HEIGHT_MAP_GROUPS + ETHERNET_GROUPS + ANALOG_INPUT_GROUPS + DIGITAL_OUTPUT_GROUPS)
 
 /* <DO NOT MESS WITH THESE DEFINES> */
 #define NV_INDEX_MAX (sizeof(cfgArray) / sizeof(cfgItem_t))
@@ -812,6 +1264,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 #define NV_INDEX_START_UBER_GROUPS (NV_INDEX_MAX - NV_COUNT_UBER_GROUPS)
 /* </DO NOT MESS WITH THESE DEFINES> */
 
+index_t cfgTokenIndex[NV_INDEX_MAX];	// sorted token index - built by nv_get_index()
+index_t cfgGroupIndex[NV_INDEX_END_SINGLES+1];	// single-valued entries sorted by group - built by get_grp()
+
 index_t	nv_index_max() { return ( NV_INDEX_MAX );}
 uint8_t nv_index_is_single(index_t index) { return ((index <= NV_INDEX_END_SINGLES) ? true : false);}
 uint8_t nv_index_is_group(index_t index) { return (((index >= NV_INDEX_START_GROUPS) && (index < NV_INDEX_START_UBER_GROUPS)) ? true : false);}
@@ -861,7 +1316,7 @@ void preprocess_float(nvObj_t *nv)
  *	This little function deals with the exception cases that some groups don't use
  *	the parent token as a prefix to the child elements; SR being a good example.
  */
-uint8_t nv_group_is_prefixed(char *group)
+uint8_t nv_group_is_prefixed(const char *group)
 {
 	if (strcmp("sr", group) == 0) return (false);
 	if (strcmp("sys", group) == 0) return (false);
@@ -889,8 +1344,8 @@ static stat_t _do_group_list(nvObj_t *nv, char list[][TOKEN_LEN+1]) // helper to
 		if (list[i][0] == NUL) { return (STAT_COMPLETE);}
 		nv_reset_nv_list();
 		nv = nv_body;
-		strncpy(nv->token, list[i], TOKEN_LEN);
-		nv->index = nv_get_index((const char *)"", nv->token);
+		nv->name = list[i];
+		nv->index = nv_get_index((const char *)"", list[i]);
 //		nv->valuetype = TYPE_PARENT;
 		nv_get_nvObj(nv);
 		nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
@@ -914,6 +1369,12 @@ static stat_t _do_motors(nvObj_t *nv)	// print parameters for all motor groups
 #endif
 #if MOTORS == 6
 	char list[][TOKEN_LEN+1] = {"1","2","3","4","5","6",""}; // must have a terminating element
+#endif
+#if MOTORS == 7
+	char list[][TOKEN_LEN+1] = {"1","2","3","4","5","6","7",""}; // must have a terminating element
+#endif
+#if MOTORS == 8
+	char list[][TOKEN_LEN+1] = {"1","2","3","4","5","6","7","8",""}; // must have a terminating element
 #endif
 	return (_do_group_list(nv, list));
 }
@@ -932,21 +1393,39 @@ static stat_t _do_offsets(nvObj_t *nv)	// print offset parameters for G54-G59,G9
 
 static stat_t _do_inputs(nvObj_t *nv)	// print parameters for all input groups
 {
+#ifdef __ANALOG_INPUTS
+	char list[][TOKEN_LEN+1] = {"di1","di2","di3","di4","di5","di6","di7","di8","di9","ai1","ai2","ai3","ai4",""};
+#else
 	char list[][TOKEN_LEN+1] = {"di1","di2","di3","di4","di5","di6","di7","di8","di9",""}; // must have a terminating element
+#endif
 	return (_do_group_list(nv, list));
     return (STAT_OK);
 }
 
 static stat_t _do_all(nvObj_t *nv)	// print all parameters
 {
-	strcpy(nv->token,"sys");			// print system group
+	nv->name = "sys";				// print system group
 	get_grp(nv);
 	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
 
 	_do_motors(nv);					// print all motor groups
 	_do_axes(nv);						// print all axis groups
 
-	strcpy(nv->token,"p1");			// print PWM group
+	nv->name = "p1";				// print PWM group
+	get_grp(nv);
+	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
+
+	nv->name = "kn";				// print kinematics group
+	get_grp(nv);
+	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
+
+#ifdef __HEIGHT_MAP
+	nv->name = "msh";				// print height map group
+	get_grp(nv);
+	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
+#endif
+
+	nv->name = "ack";				// print JSON acknowledgement group
 	get_grp(nv);
 	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
 
@@ -44,6 +44,7 @@
 #include "util.h"
 #include "xio.h"
 #include "settings.h"
+#include "test.h"
 
 #ifdef __ARM
 #include "Reset.h"
@@ -64,6 +65,10 @@ static stat_t _led_indicator(void);             // twiddle the LED indicator
 static stat_t _shutdown_handler(void);          // new (replaces _interlock_estop_handler)
 static stat_t _interlock_handler(void);         // new (replaces _interlock_estop_handler)
 static stat_t _limit_switch_handler(void);      // revised for new GPIO code
+static stat_t _following_error_handler(void);
+#ifdef __THREADING
+static stat_t _spindle_sync_handler(void);
+#endif
 
 static void _init_assertions(void);
 static stat_t _test_assertions(void);
@@ -74,6 +79,15 @@ static stat_t _sync_to_tx_buffer(void);
 static stat_t _dispatch_command(void);
 static stat_t _dispatch_control(void);
 static void _dispatch_kernel(void);
+static stat_t _check_line(void);
+static void _reject_line(stat_t status);
+#ifdef __BINARY_DATA
+static void _dispatch_frame(void);
+static stat_t _run_move_frame(const uint8_t *payload, uint8_t len);
+static stat_t _run_machine_frame(const uint8_t *payload, uint8_t len);
+static void _send_frame(uint8_t type, uint8_t seq, uint8_t value);
+static void _flush_frame_acks(void);
+#endif
 static stat_t _controller_state(void);          // manage controller state transitions
 
 /***********************************************************************************
@@ -88,12 +102,14 @@ void controller_init(uint8_t std_in, uint8_t std_out, uint8_t std_err)
     // preserve settable parameters that may have already been set up
     uint8_t comm_mode = cs.comm_mode;
     uint8_t network_mode = cs.network_mode;
+    uint8_t assertion_interval = cs.assertion_interval;
 
 	memset(&cs, 0, sizeof(controller_t));           // clear all values, job_id's, pointers and status
 	_init_assertions();
 
     cs.comm_mode = comm_mode;                       // restore parameters
     cs.network_mode = network_mode;
+    cs.assertion_interval = assertion_interval;
 
 	cs.fw_build = TINYG_FIRMWARE_BUILD;             // set up identification
 	cs.fw_version = TINYG_FIRMWARE_VERSION;
@@ -112,12 +128,15 @@ void controller_init(uint8_t std_in, uint8_t std_out, uint8_t std_err)
 #ifdef __ARM
 	IndicatorLed.setFrequency(100000);
 #endif
+	controller_wake(DEADLINE_LED);					// start blinking
+	controller_wake(DEADLINE_ASSERTIONS);			// start the integrity scan
 }
 
 /*
  * controller_run() - MAIN LOOP - top-level controller
  *
- * The order of the dispatched tasks is very important.
+ * The main loop is a cooperative scheduler over the task table below. Each pass runs
+ * the tasks in table order, which is their priority order.
  * Tasks are ordered by increasing dependency (blocking hierarchy).
  * Tasks that are dependent on completion of lower-level tasks must be
  * later in the list than the task(s) they are dependent upon.
@@ -125,64 +144,289 @@ void controller_init(uint8_t std_in, uint8_t std_out, uint8_t std_err)
  * Tasks must be written as continuations as they will be called repeatedly,
  * and are called even if they are not currently active.
  *
- * The DISPATCH macro calls the function and returns to the controller parent
- * if not finished (STAT_EAGAIN), preventing later routines from running
- * (they remain blocked). Any other condition - OK or ERR - drops through
- * and runs the next routine in the list.
+ * A task that is not finished returns STAT_EAGAIN, which ends the pass - the remaining
+ * tasks stay blocked until it finishes. Any other condition - OK or ERR - drops through
+ * and runs the next task in the list.
  *
  * A routine that had no action (i.e. is OFF or idle) should return STAT_NOOP
+ *
+ * Each task also has:
+ *
+ *	 priority - TASK_CRITICAL, TASK_PLANNER and TASK_COMMAND tasks run on every pass.
+ *				TASK_REPORT tasks are deferred to a later pass if there isn't room for
+ *				their budget in what's left of CONTROLLER_PASS_BUDGET_US, so report
+ *				formatting doesn't squeeze the planner. A report task deferred for
+ *				CONTROLLER_REPORT_MAX_DEFER_MS runs regardless.
+ *
+ *	 interval - run condition by timer. 0 runs the task on every pass, otherwise it runs
+ *				at most once every 'interval' ms and costs nothing in between.
+ *
+ *	 budget	  - microseconds the task is expected to take. Runs that take longer are
+ *				counted in the task's overrun count (task_state[].overruns).
+ *
+ *	 deadline - run condition by event. A task with a DEADLINE_xxx runs only once its
+ *				deadline has been armed and has come due - see controller_set_deadline().
+ *				The deadline is disarmed as the task runs, so a task with more to do
+ *				must arm it again. Omitted (DEADLINE_NONE) the task is not deadline driven.
  */
 
-void controller_run()
-{
-	while (true) {
-		_controller_HSM();
-	}
-}
+#define TASK_CRITICAL	0		// kernel level handlers
+#define TASK_PLANNER	1		// planner hierarchy for gcode and cycles
+#define TASK_REPORT		2		// deferrable reports
+#define TASK_COMMAND	3		// command readers and parsers
 
-#define	DISPATCH(func) if (func == STAT_EAGAIN) return;
-static void _controller_HSM()
-{
+typedef struct ctrlTask {
+	const char *name;			// short name for profiling - see controller_get_prof()
+	stat_t (*run)(void);		// the task - returns STAT_EAGAIN to end the pass
+	uint8_t priority;			// TASK_xxx
+	uint8_t interval;			// ms between runs, 0 = every pass
+	uint16_t budget;			// expected run time in us
+	uint8_t deadline;			// DEADLINE_xxx, or DEADLINE_NONE
+} ctrlTask_t;
+
+typedef struct ctrlTaskState {
+	uint32_t next_run;			// systick the task is next due (interval tasks)
+	uint32_t deferred_since;	// systick the task was first deferred (report tasks)
+	bool deferred;				// the task is being deferred
+	uint16_t overruns;			// runs that went over budget
+#ifdef __TASK_PROFILE
+	uint32_t count;				// runs
+	uint32_t total;				// total run time in us
+	uint32_t max;				// longest run in us
+	uint16_t hist[TASK_PROFILE_BUCKETS];	// run counts by time - see task_profile_limit[]
+#endif
+} ctrlTaskState_t;
+
+static const ctrlTask_t ctrl_tasks[] = {
 //----- Interrupt Service Routines are the highest priority controller functions ----//
 //      See hardware.h for a list of ISRs and their priorities.
 //
 //----- kernel level ISR handlers ----(flags are set in ISRs)------------------------//
-                                                // Order is important:
-	DISPATCH(_led_indicator());				    // blink LEDs at the current rate
-    DISPATCH(_shutdown_handler());              // invoke shutdown
- 	DISPATCH(_interlock_handler());             // invoke / remove safety interlock
-	DISPATCH(_limit_switch_handler());          // invoke limit switch
-    DISPATCH(_controller_state());              // controller state management
-	DISPATCH(_test_system_assertions());        // system integrity assertions
-	DISPATCH(_dispatch_control());              // read any control messages prior to executing cycles
+                                                                    // Order is important:
+#ifdef __WATCHDOG
+	{ "wdt",  hw_watchdog_callback,			TASK_CRITICAL, 0,  10 },		// feed the watchdog - first, so a blocked pass still feeds it
+#endif
+	{ "xio",  xio_callback,					TASK_CRITICAL, 0,  50 },		// keep the USB write queues moving - never blocks
+	{ "led",  _led_indicator,				TASK_CRITICAL, 0,  10, DEADLINE_LED },			// blink LEDs at the current rate
+	{ "shd",  _shutdown_handler,			TASK_CRITICAL, 0,  10 },		// invoke shutdown
+	{ "ilk",  _interlock_handler,			TASK_CRITICAL, 0,  10 },		// invoke / remove safety interlock
+	{ "lim",  _limit_switch_handler,		TASK_CRITICAL, 0,  10 },		// invoke limit switch
+	{ "fer",  _following_error_handler,		TASK_CRITICAL, 0,  10 },		// invoke following error alarm
+#ifdef __THREADING
+	{ "ssl",  _spindle_sync_handler,		TASK_CRITICAL, 0,  10 },		// alarm if the spindle index stopped in a thread
+#endif
+	{ "exc",  rpt_exception_callback,		TASK_CRITICAL, 0,  50, DEADLINE_EXCEPTION },	// report exceptions and panics raised in interrupts
+	{ "cst",  _controller_state,			TASK_CRITICAL, 0,  10 },		// controller state management
+#ifdef __STRICT_ASSERTIONS
+	{ "ast",  _test_system_assertions,		TASK_CRITICAL, 0,  50 },		// system integrity assertions - all of them, every pass
+#else
+	{ "ast",  _test_system_assertions,		TASK_CRITICAL, 0,  10, DEADLINE_ASSERTIONS },	// system integrity assertions - one subsystem per slice
+#endif
+	{ "ctl",  _dispatch_control,			TASK_CRITICAL, 0,  1000 },		// read any control messages prior to executing cycles
 
 //----- planner hierarchy for gcode and cycles ---------------------------------------//
 
-    DISPATCH(st_motor_power_callback());        // stepper motor power sequencing
+	{ "mpw",  st_motor_power_callback,		TASK_PLANNER,  0,  10, DEADLINE_MOTOR_POWER },	// stepper motor power sequencing
 #ifdef __AVR
-    DISPATCH(switch_debounce_callback());       // debounce switches
+	{ "deb",  switch_debounce_callback,		TASK_PLANNER,  0,  10 },		// debounce switches
+#endif
+	{ "stl",  cm_stall_detection_callback,	TASK_PLANNER,  STALL_CHECK_MS, 20 },	// slow the feed on following error
+#ifdef __ANALOG_INPUTS
+	{ "lfd",  cm_load_feed_callback,		TASK_PLANNER,  LOAD_FEED_CHECK_MS, 20 },	// adaptive feed from spindle load
+#endif
+	{ "fhs",  cm_feedhold_sequencing_callback, TASK_PLANNER, 0, 50 },		// feedhold state machine runner
+	{ "pln",  mp_plan_buffer,				TASK_PLANNER,  0,  500 },		// attempt to plan unplanned moves (conditionally)
+
+// reports run after the planner so they never take its time, but before the cycles and
+// aux commands, which return STAT_EAGAIN and would hold them off while a cycle runs
+	{ "sr",   sr_status_report_callback,	TASK_REPORT,   0,  1500, DEADLINE_STATUS_REPORT },	// send status report when due
+	{ "wl",   wl_watch_report_callback,		TASK_REPORT,   0,  1000, DEADLINE_WATCH_REPORT },	// send watch reports when due
+#ifdef __BINARY_DATA
+	{ "ss",   sr_status_stream_callback,	TASK_REPORT,   0,  200 },		// conditionally stream status on the data channel
+#endif
+#ifdef __MOTION_TRACE
+	{ "tr",   tr_trace_dump_callback,		TASK_REPORT,   0,  300 },		// send the motion trace when asked, or after an alarm
 #endif
-    DISPATCH(sr_status_report_callback());      // conditionally send status report
-    DISPATCH(qr_queue_report_callback());       // conditionally send queue report
-    DISPATCH(rx_report_callback());             // conditionally send rx report
-
-    DISPATCH(cm_feedhold_sequencing_callback());// feedhold state machine runner
-    DISPATCH(mp_plan_buffer());		            // attempt to plan unplanned moves (conditionally)
-    DISPATCH(cm_arc_callback());                // arc generation runs as a cycle above lines
-    DISPATCH(cm_homing_cycle_callback());       // homing cycle operation (G28.2)
-    DISPATCH(cm_probing_cycle_callback());      // probing cycle operation (G38.2)
-    DISPATCH(cm_jogging_cycle_callback());      // jog cycle operation
-//    DISPATCH(st_motor_power_callback());        // stepper motor power sequencing
-    DISPATCH(cm_deferred_write_callback());     // persist G10 changes when not in machining cycle
+#ifdef __PROBE_SCAN
+	{ "scn",  cm_probe_scan_callback,		TASK_REPORT,   0,  200 },		// send scanning probe points in batches
+#endif
+#ifdef __LINE_TIMES
+	{ "lt",   lt_line_time_callback,		TASK_REPORT,   0,  200 },		// send finished line times in batches
+#endif
+	{ "qr",   qr_queue_report_callback,		TASK_REPORT,   0,  300 },		// conditionally send queue report
+	{ "rx",   rx_report_callback,			TASK_REPORT,   0,  300 },		// send host flow control credit as it's granted
+	{ "ack",  json_ack_callback,			TASK_REPORT,   0,  300 },		// acknowledge Gcode lines that have waited long enough
+
+	{ "aux",  mp_aux_command_callback,		TASK_PLANNER,  0,  50 },		// run aux commands left waiting when the planner empties
+	{ "cyc",  cm_cycle_callback,			TASK_PLANNER,  0,  500 },		// the active cycle - arcs, batches, drilling, homing, probing, jogging
+	{ "dw",   cm_deferred_write_callback,	TASK_PLANNER,  0,  200 },		// persist G10 changes when not in machining cycle
 
 //----- command readers and parsers --------------------------------------------------//
 
-    DISPATCH(_sync_to_planner());               // ensure there is at least one free buffer in planning queue
-    DISPATCH(_sync_to_tx_buffer());             // sync with TX buffer (pseudo-blocking)
+	{ "syp",  _sync_to_planner,				TASK_COMMAND,  0,  10 },		// ensure there is at least one free buffer in planning queue
+	{ "syt",  _sync_to_tx_buffer,			TASK_COMMAND,  0,  10 },		// sync with TX buffer (pseudo-blocking)
 #ifdef __AVR
-    DISPATCH(set_baud_callback());              // perform baud rate update (must be after TX sync)
+	{ "bau",  set_baud_callback,			TASK_COMMAND,  0,  10 },		// perform baud rate update (must be after TX sync)
 #endif
-    DISPATCH(_dispatch_command());              // MUST BE LAST - read and execute next command
+	{ "cmd",  _dispatch_command,			TASK_COMMAND,  0,  2000 }		// MUST BE LAST - read and execute next command
+};
+
+#define CTRL_TASKS (sizeof(ctrl_tasks)/sizeof(ctrlTask_t))
+static ctrlTaskState_t task_state[CTRL_TASKS];
+
+/*
+ * Main loop task deadlines
+ *
+ * controller_set_deadline() - arm a deadline to come due at 'systick' (or sooner)
+ * controller_wake()		 - arm a deadline to come due now
+ * _deadline_is_due()		 - test a deadline from the main loop
+ *
+ *	Deadline tasks cost the main loop one test per pass instead of polling their own
+ *	timers or flags. Either call is safe from an ISR. A deadline that is already armed
+ *	keeps the earlier of the two times, so an event posted from an ISR is never pushed
+ *	back by a task re-arming a later timeout. The compare is wrap safe.
+ */
+static volatile uint32_t deadline_due[DEADLINE_COUNT];
+static volatile bool deadline_armed[DEADLINE_COUNT];
+
+void controller_set_deadline(uint8_t deadline, uint32_t systick)
+{
+	__disable_irq();
+	if ((!deadline_armed[deadline]) || ((int32_t)(systick - deadline_due[deadline]) < 0)) {
+		deadline_due[deadline] = systick;
+		deadline_armed[deadline] = true;
+	}
+	__enable_irq();
+}
+
+void controller_wake(uint8_t deadline)
+{
+	controller_set_deadline(deadline, SysTickTimer_getValue());
+}
+
+static bool _deadline_is_due(uint8_t deadline, uint32_t now)
+{
+	return (deadline_armed[deadline] && ((int32_t)(now - deadline_due[deadline]) >= 0));
+}
+
+void controller_run()
+{
+#ifdef __HOST__
+	_controller_HSM();				// one pass - the simulator runs the clock between passes, see main()
+#else
+	while (true) {
+		_controller_HSM();
+	}
+#endif
+}
+
+#ifdef __TASK_PROFILE
+/*
+ * Main loop task profile
+ *
+ * _profile_task()		 - account one run of a task
+ * controller_get_prof() - print the profile: {"prof":{"<task>":[count,total_us,max_us,[histogram]],...}}
+ * controller_set_prof() - clear the profile (any value)
+ *
+ *	The histogram counts runs by time taken, in buckets up to 10, 50, 100, 500, 1000, 5000
+ *	and 10000 us and over 10000 us. Bucket counts stop at 65535. The timing is the same as
+ *	for the task budgets, so it costs little more than the budget check.
+ */
+static const uint16_t task_profile_limit[TASK_PROFILE_BUCKETS-1] = { 10, 50, 100, 500, 1000, 5000, 10000 };
+
+static void _profile_task(ctrlTaskState_t *state, uint32_t elapsed)
+{
+	state->count++;
+	state->total += elapsed;
+	state->max = max(state->max, elapsed);
+	uint8_t b = 0;
+	while ((b < TASK_PROFILE_BUCKETS-1) && (elapsed >= task_profile_limit[b])) {
+		b++;
+	}
+	if (state->hist[b] != 0xFFFF) {
+		state->hist[b]++;
+	}
+}
+
+stat_t controller_get_prof(nvObj_t *nv)
+{
+	printf_P(PSTR("{\"prof\":{"));
+	for (uint8_t i=0; i<CTRL_TASKS; i++) {
+		ctrlTaskState_t *state = &task_state[i];
+		printf_P(PSTR("%s\"%s\":[%lu,%lu,%lu,["), (i == 0) ? "" : ",", ctrl_tasks[i].name,
+			(unsigned long)state->count, (unsigned long)state->total, (unsigned long)state->max);
+		for (uint8_t b=0; b<TASK_PROFILE_BUCKETS; b++) {
+			printf_P(PSTR("%s%u"), (b == 0) ? "" : ",", state->hist[b]);
+		}
+		printf_P(PSTR("]]"));
+	}
+	printf_P(PSTR("}}\n"));
+	nv->value = CTRL_TASKS;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t controller_set_prof(nvObj_t *nv)
+{
+	for (uint8_t i=0; i<CTRL_TASKS; i++) {
+		ctrlTaskState_t *state = &task_state[i];
+		state->count = 0;
+		state->total = 0;
+		state->max = 0;
+		memset(state->hist, 0, sizeof(state->hist));
+	}
+	nv->valuetype = TYPE_NULL;
+	return (STAT_OK);
+}
+#endif // __TASK_PROFILE
+
+static void _controller_HSM()
+{
+	uint32_t pass_start = SysTickTimer_getMicros();
+	uint32_t now = SysTickTimer_getValue();
+
+	for (uint8_t i=0; i<CTRL_TASKS; i++) {
+		const ctrlTask_t *task = &ctrl_tasks[i];
+		ctrlTaskState_t *state = &task_state[i];
+
+		if (task->interval != 0) {
+			if ((int32_t)(now - state->next_run) < 0) {		// wrap safe
+				continue;
+			}
+			state->next_run = now + task->interval;
+		}
+		if ((task->deadline != DEADLINE_NONE) && (!_deadline_is_due(task->deadline, now))) {
+			continue;
+		}
+		uint32_t start = SysTickTimer_getMicros();
+		if (task->priority == TASK_REPORT) {
+			uint32_t used = start - pass_start;
+			if ((used + task->budget) > CONTROLLER_PASS_BUDGET_US) {
+				if (!state->deferred) {
+					state->deferred = true;
+					state->deferred_since = now;
+				}
+				if ((now - state->deferred_since) < CONTROLLER_REPORT_MAX_DEFER_MS) {
+					continue;
+				}
+			}
+			state->deferred = false;
+		}
+		if (task->deadline != DEADLINE_NONE) {
+			deadline_armed[task->deadline] = false;		// the task re-arms it if it has more to do
+		}
+		stat_t status = task->run();
+		uint32_t elapsed = SysTickTimer_getMicros() - start;
+		if (elapsed > task->budget) {
+			state->overruns++;
+		}
+#ifdef __TASK_PROFILE
+		_profile_task(state, elapsed);
+#endif
+		if (status == STAT_EAGAIN) {
+			return;
+		}
+	}
 }
 
 /*
@@ -198,6 +442,22 @@ void controller_set_connected(bool is_connected) {
     }
 }
 
+/*
+ * controller_dispatch_realtime() - act on a single character command
+ *
+ *	Called from the line dispatcher and straight from the xio receive path (the fast lane).
+ */
+
+void controller_dispatch_realtime(char c)
+{
+    if      (c == '!') { cm_request_feedhold(); }
+    else if (c == '%') { cm_request_queue_flush(); }
+    else if (c == '~') { cm_request_end_hold(); }
+    else if (c == EOT) { cm_alarm(STAT_KILL_JOB, NULL); }
+    else if (c == CAN) { hw_hard_reset(); }                // reset immediately
+    else               { cm_request_override(c); }          // feed and traverse overrides
+}
+
 /*
  * controller_parse_control() - return true if command is a control (versus data)
  * Note: parsing for control is somewhat naiive. This will need to get better
@@ -235,6 +495,12 @@ void controller_set_secondary_source(uint8_t dev) { xio.secondary_src = dev;}
  *
  *  Note: The dispatchers must only read and process a single line from the
  *        RX queue before returning control to the main loop.
+ *
+ *	Line tags: the N a line starts with is kept as its tag. A JSON command may be numbered
+ *	too (N12 {"xvm":5000}) - the N is dropped before it is parsed. With $jf=2 the JSON
+ *	footer carries the tag instead of the byte count, so a host can keep a window of lines
+ *	outstanding and match every response to its line. The line isn't saved for echo in that
+ *	mode, which saves copying it (GET of gc and syntax error echoes come back empty).
  */
 
 static stat_t _dispatch_control()
@@ -248,15 +514,60 @@ static stat_t _dispatch_control()
     return (STAT_OK);
 }
 
+// _read_command() - next command line, from the canned program while one is running
+static char *_read_command(devflags_t &flags)
+{
+#ifdef __CANNED_PROGRAMS
+    if (canned_is_running()) {
+        cs.linelen = 0;                                     // nothing was received, so nothing to ack
+        return (canned_readline());
+    }
+#endif
+    char *line = xio_readline(flags, cs.linelen);
+#ifdef __FILE_CHANNEL
+    if (flags & DEV_RX_FILE) {
+        cs.linelen = 0;                                     // the host didn't send it, so nothing to ack
+    }
+#endif
+    return (line);
+}
+
 static stat_t _dispatch_command()
 {
     if (cs.controller_state != CONTROLLER_PAUSED) {
         devflags_t flags = DEV_IS_BOTH;
-        if ((mp_get_planner_buffers_available() > PLANNER_BUFFER_HEADROOM) &&
-            (cs.bufp = xio_readline(flags, cs.linelen)) != NULL) {
+        if (!mp_planner_is_full() &&
+            (cs.bufp = _read_command(flags)) != NULL) {
+#ifdef __BINARY_DATA
+            if (flags & DEV_RX_FRAME) {
+                _dispatch_frame();
+                mp_plan_buffer();
+                return (STAT_OK);
+            }
+#endif
+#ifdef __PLANNER_PROFILE
+            uint32_t start = hw_get_cpu_cycles();
+            uint64_t profiled = mp_prof.plan.total + mp_prof.exec.total;    // planning and exec interrupts are profiled on their own
             _dispatch_kernel();
+#ifdef __REPORT_FANOUT
+            xio_reply_to_ctrl();    // the line has been answered - see rpt_set_sub()
+#endif
+            mp_plan_buffer();
+            profiled = mp_prof.plan.total + mp_prof.exec.total - profiled;
+            mp_profile_time(&mp_prof.dispatch, (hw_get_cpu_cycles() - start) - (uint32_t)profiled);
+#else
+            _dispatch_kernel();
+#ifdef __REPORT_FANOUT
+            xio_reply_to_ctrl();    // the line has been answered - see rpt_set_sub()
+#endif
             mp_plan_buffer();   // +++ removed for test. This is called from the main loop
+#endif
         }
+#ifdef __BINARY_DATA
+        else {
+            _flush_frame_acks();    // input is idle or held off - don't leave the host waiting
+        }
+#endif
     }
 	return (STAT_OK);
 }
@@ -266,7 +577,11 @@ static void _dispatch_kernel()
     while ((*cs.bufp == SPC) || (*cs.bufp == TAB)) {        // position past any leading whitespace
         cs.bufp++;
     }
-	strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);		// save input buffer for reporting
+	if ((cs.comm_mode == JSON_MODE) && (js.json_footer_style == FOOTER_LINE_TAG)) {
+		cs.saved_buf[0] = NUL;                              // responses carry the tag, not the line
+	} else {
+		strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);	// save input buffer for reporting
+	}
 
 	if (*cs.bufp == NUL) {									// blank line - just a CR or the 2nd termination in a CRLF
 		if (cs.comm_mode == TEXT_MODE) {
@@ -275,13 +590,28 @@ static void _dispatch_kernel()
 		}
     }
 
-	// trap single character commands
-    if      (*cs.bufp == '!') { cm_request_feedhold(); }
-    else if (*cs.bufp == '%') { cm_request_queue_flush(); }
-	else if (*cs.bufp == '~') { cm_request_end_hold(); }
-    else if (*cs.bufp == EOT) { cm_alarm(STAT_KILL_JOB, NULL); }
-    else if (*cs.bufp == CAN) { hw_hard_reset(); }          // reset immediately
+	cs.line_tag = 0;
+	if ((*cs.bufp == 'N') || (*cs.bufp == 'n')) {          // a numbered line may carry a tag and a check
+		char *tail;
+		cs.line_tag = strtoul(cs.bufp+1, &tail, 10);
+		stat_t status = _check_line();
+		if (status != STAT_OK) {
+			_reject_line(status);
+			return;
+		}
+		while ((*tail == SPC) || (*tail == TAB)) {
+			tail++;
+		}
+		if (*tail == '{') {                                 // a numbered JSON command runs without the N
+			cs.bufp = tail;
+		}
+	}
 
+	// trap single character commands (only seen here from data-only channels - see xio_callback())
+    if ((*cs.bufp == '!') || (*cs.bufp == '%') || (*cs.bufp == '~') || (*cs.bufp == EOT) || (*cs.bufp == CAN) ||
+        ((*cs.bufp >= CHAR_OVR_FIRST) && (*cs.bufp <= CHAR_OVR_LAST))) {
+        controller_dispatch_realtime(*cs.bufp);
+    }
 	else if (*cs.bufp == '{') {                             // process as JSON mode
 		cs.comm_mode = JSON_MODE;                           // switch to JSON mode
 		json_parser(cs.bufp);
@@ -295,13 +625,218 @@ static void _dispatch_kernel()
         text_response(gcode_parser(cs.bufp), cs.saved_buf);
     }
 #endif
-	else {  // anything else is interpreted as Gcode
+	else if (!json_gcode_parser(cs.bufp)) {                 // anything else is interpreted as Gcode...
+        // ...but some lines still have to be wrapped as JSON - see json_gcode_parser()
         strncpy(cs.out_buf, cs.bufp, (USB_LINE_BUFFER_SIZE-11)); // use out_buf as temp; '-11' is buffer for JSON chars
         sprintf((char *)cs.bufp,"{\"gc\":\"%s\"}\n", (char *)cs.out_buf);  // Read and toss if machine is alarmed
         json_parser(cs.bufp);
 	}
 }
 
+/*
+ * _check_line()  - verify and strip the check on a numbered line: N123 ... *crc
+ * _reject_line() - answer a line that failed its check with the line to resend from
+ *
+ *	A line that starts with an N word may end with '*' and the CRC-16/CCITT of everything
+ *	before the '*' (see compute_crc16()) in 1 to 4 hex digits. A '*' in a () or ; comment
+ *	isn't a check, and one outside comments must end the line. Lines without one run as
+ *	before. A line with one must match it, and its N must be the next one expected - lnck -
+ *	unless that is 0, which takes any N. The check is stripped before the line is parsed.
+ *
+ *	A line that fails is not run. It is answered with STAT_LINE_CHECKSUM_ERROR or
+ *	STAT_LINE_NUMBER_OUT_OF_SEQUENCE and {"lnck":n}, the line to resend from (0 for the one
+ *	that failed). Lines the host had already sent behind it fail as out of sequence until
+ *	the resend arrives, so the host goes back to lnck and streams on. Set {"lnck":n} to
+ *	restart the numbering, e.g. 0 or 1 at the start of a job.
+ */
+
+static stat_t _check_line()
+{
+	char *star = NULL;							// the last '*' outside comments
+	bool in_comment = false;
+	for (char *rd = cs.bufp; *rd != NUL; rd++) {
+		if (in_comment) {
+			in_comment = (*rd != ')');
+		} else if (*rd == '(') {
+			in_comment = true;
+		} else if (*rd == ';') {
+			break;								// the rest of the line is a comment
+		} else if (*rd == '*') {
+			star = rd;
+		}
+	}
+	if (star == NULL) {
+		return (STAT_OK);
+	}
+	uint16_t crc = 0;
+	uint8_t digits = 0;
+	char *rd = star+1;
+	for ( ; isxdigit(*rd); rd++, digits++) {
+		crc = (crc << 4) | (isdigit(*rd) ? (*rd - '0') : (tolower(*rd) - 'a' + 10));
+	}
+	while ((*rd == SPC) || (*rd == TAB)) {
+		rd++;
+	}
+	if ((digits == 0) || (digits > 4) || (*rd != NUL) ||
+		(compute_crc16((const uint8_t *)cs.bufp, star - cs.bufp) != crc)) {
+		return (STAT_LINE_CHECKSUM_ERROR);
+	}
+	if ((cs.line_check_next != 0) && (cs.line_tag != cs.line_check_next)) {
+		return (STAT_LINE_NUMBER_OUT_OF_SEQUENCE);
+	}
+	cs.line_check_next = cs.line_tag + 1;
+	*star = NUL;
+	return (STAT_OK);
+}
+
+static void _reject_line(stat_t status)
+{
+	if (cs.comm_mode == TEXT_MODE) {
+		text_response(status, cs.saved_buf);
+		return;
+	}
+	nv_reset_nv_list();
+	nv_add_integer((const char *)"lnck", cs.line_check_next);
+	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+}
+
+#ifdef __BINARY_DATA
+/*
+ * _dispatch_frame()   - run a binary data frame (see xio.h for the framing)
+ * _run_move_frame()   - run the payload of a straight feed record
+ * _run_machine_frame() - run the payload of a precompiled move record
+ * _send_frame()       - send an acknowledgement frame on the data channel
+ * _flush_frame_acks() - acknowledge the frames that ran OK and are still waiting
+ *
+ *	Record types:
+ *	  'G' - Gcode block. The payload is the text of one block, run by gcode_parser()
+ *	  'M' - straight feed. The payload is an axis mask byte - bits 0-5 for X-C and bit 7 for
+ *			a feed rate - then a little-endian float for each bit set, feed rate first. Values
+ *			are in the current units and modes, the same as a G1
+ *	  'P' - precompiled move, from Tools/gcode_precompile.py. The payload is the motion mode
+ *			byte (0-3 for G0-G3), the line number as a little-endian uint32, then little-endian
+ *			floats for the feed rate and the target on every axis, X-C. The target is machine
+ *			coordinates in mm - see cm_machine_feed()
+ *
+ *	Frames that run OK are acknowledged FRAME_ACK_COUNT at a time by an 'a' frame that
+ *	carries the last sequence number and the count, or sooner if input goes idle. A frame
+ *	that fails is answered at once with an 'n' frame carrying its sequence number and the
+ *	status code, after the acknowledgement of any frames before it. Nothing is sent on the
+ *	control channel, so streaming binary records costs it no response bandwidth.
+ *
+ *	The data channel also carries 'S' status stream frames - see sr_status_stream_callback().
+ */
+
+#define FRAME_TYPE_GCODE 'G'
+#define FRAME_TYPE_MOVE 'M'
+#define FRAME_TYPE_MACHINE 'P'
+#define FRAME_TYPE_ACK 'a'
+#define FRAME_TYPE_NAK 'n'
+#define FRAME_MOVE_FEED_RATE 0x80			// axis mask bit for a leading feed rate
+
+static void _send_frame(uint8_t type, uint8_t seq, uint8_t value)
+{
+    uint8_t frame[XIO_FRAME_HEADER_LEN+1+XIO_FRAME_CRC_LEN];
+    frame[XIO_FRAME_STX] = STX;
+    frame[XIO_FRAME_LEN] = 1;
+    frame[XIO_FRAME_SEQ] = seq;
+    frame[XIO_FRAME_TYPE] = type;
+    frame[XIO_FRAME_PAYLOAD] = value;
+    uint16_t crc = compute_crc16(&frame[XIO_FRAME_LEN], XIO_FRAME_HEADER_LEN);
+    frame[XIO_FRAME_PAYLOAD+1] = crc & 0xFF;
+    frame[XIO_FRAME_PAYLOAD+2] = crc >> 8;
+    xio_write_data(frame, sizeof(frame));
+}
+
+static void _flush_frame_acks()
+{
+    if (cs.frame_ack_count != 0) {
+        _send_frame(FRAME_TYPE_ACK, cs.frame_ack_seq, cs.frame_ack_count);
+        cs.frame_ack_count = 0;
+    }
+}
+
+static stat_t _run_move_frame(const uint8_t *payload, uint8_t len)
+{
+    uint8_t mask = payload[0];
+    uint8_t words = 0;
+    for (uint8_t bit=0; bit<8; bit++) {
+        if (mask & (1<<bit)) { words++; }
+    }
+    if ((mask & ~(FRAME_MOVE_FEED_RATE | ((1<<AXES)-1))) || (len != (1 + words * sizeof(float)))) {
+        return (STAT_MALFORMED_COMMAND_INPUT);
+    }
+    ritorno(cm_is_alarmed());                           // return error status if in alarm, shutdown or panic
+
+    float target[AXES] = { 0,0,0,0,0,0 };
+    bool flags[AXES] = { 0,0,0,0,0,0 };
+    const uint8_t *rd = &payload[1];
+    if (mask & FRAME_MOVE_FEED_RATE) {
+        float feed_rate;
+        memcpy(&feed_rate, rd, sizeof(float));          // payload floats are not aligned
+        rd += sizeof(float);
+        ritorno(cm_set_feed_rate(feed_rate));
+    }
+    for (uint8_t axis=0; axis<AXES; axis++) {
+        if (mask & (1<<axis)) {
+            memcpy(&target[axis], rd, sizeof(float));
+            rd += sizeof(float);
+            flags[axis] = true;
+        }
+    }
+    return (cm_straight_feed(target, flags));
+}
+
+static stat_t _run_machine_frame(const uint8_t *payload, uint8_t len)
+{
+    if (len != (1 + sizeof(uint32_t) + (1 + AXES) * sizeof(float))) {
+        return (STAT_MALFORMED_COMMAND_INPUT);
+    }
+    ritorno(cm_is_alarmed());                           // return error status if in alarm, shutdown or panic
+
+    uint32_t linenum;
+    float feed_rate;
+    float target[AXES];
+    memcpy(&linenum, &payload[1], sizeof(uint32_t));
+    memcpy(&feed_rate, &payload[1 + sizeof(uint32_t)], sizeof(float));
+    memcpy(target, &payload[1 + sizeof(uint32_t) + sizeof(float)], sizeof(target));
+    return (cm_machine_feed(target, payload[0], feed_rate, linenum));
+}
+
+static void _dispatch_frame()
+{
+    uint8_t *frame = (uint8_t *)cs.bufp;
+    uint8_t len = frame[XIO_FRAME_LEN];
+    uint8_t seq = frame[XIO_FRAME_SEQ];
+    uint8_t *payload = &frame[XIO_FRAME_PAYLOAD];
+    uint16_t crc = payload[len] | (payload[len+1] << 8);
+    stat_t status;
+
+    if (compute_crc16(&frame[XIO_FRAME_LEN], XIO_FRAME_HEADER_LEN-1 + len) != crc) {
+        status = STAT_FRAME_CRC_ERROR;
+    } else if (frame[XIO_FRAME_TYPE] == FRAME_TYPE_MOVE) {
+        status = _run_move_frame(payload, len);
+    } else if (frame[XIO_FRAME_TYPE] == FRAME_TYPE_MACHINE) {
+        status = _run_machine_frame(payload, len);
+    } else if (frame[XIO_FRAME_TYPE] == FRAME_TYPE_GCODE) {
+        payload[len] = NUL;                             // the CRC has been checked - terminate over it
+        status = gcode_parser((char *)payload);
+    } else {
+        status = STAT_INPUT_VALUE_UNSUPPORTED;
+    }
+
+    if ((status == STAT_OK) || (status == STAT_NOOP) || (status == STAT_COMPLETE)) {
+        cs.frame_ack_seq = seq;
+        if (++cs.frame_ack_count >= FRAME_ACK_COUNT) {
+            _flush_frame_acks();
+        }
+    } else {
+        _flush_frame_acks();
+        _send_frame(FRAME_TYPE_NAK, seq, status);
+    }
+}
+#endif // __BINARY_DATA
+
 /**** Local Functions ********************************************************/
 /*
  * _controller_state() - manage controller connection, startup, and other state changes
@@ -319,6 +854,9 @@ static stat_t _controller_state()
 
 /*
  * _led_indicator() - blink an LED to show it we are normal, alarmed, or shut down
+ *
+ *	Runs on DEADLINE_LED - once per blink, or at once when cm_alarm(), cm_shutdown()
+ *	or cm_panic() change the machine state.
  */
 static stat_t _led_indicator()
 {
@@ -333,14 +871,9 @@ static stat_t _led_indicator()
         blink_rate = LED_NORMAL_BLINK_RATE;
     }
 
-    if (blink_rate != cs.led_blink_rate) {
-        cs.led_blink_rate =  blink_rate;
-        cs.led_timer = 0;
-    }
-	if (SysTickTimer_getValue() > cs.led_timer) {
-		cs.led_timer = SysTickTimer_getValue() + cs.led_blink_rate;
-		IndicatorLed.toggle();
-	}
+    cs.led_blink_rate = blink_rate;
+	IndicatorLed.toggle();
+	controller_set_deadline(DEADLINE_LED, SysTickTimer_getValue() + cs.led_blink_rate);
 	return (STAT_OK);
 }
 
@@ -354,6 +887,10 @@ static stat_t _sync_to_tx_buffer()
 	if ((xio_get_tx_bufcount_usart(ds[XIO_DEV_USB].x) >= XOFF_TX_LO_WATER_MARK)) {
 		return (STAT_EAGAIN);
 	}
+#else
+	if (xio_tx_space() < XIO_TX_HEADROOM) {		// leave room for the response to the next command
+		return (STAT_EAGAIN);
+	}
 #endif
 	return (STAT_OK);
 }
@@ -370,6 +907,8 @@ static stat_t _sync_to_planner()
  *
  * _shutdown_handler() - put system into shutdown state
  * _limit_switch_handler() - shut down system if limit switch fired
+ * _following_error_handler() - alarm if the step correction reported a following error over its limit
+ * _spindle_sync_handler() - alarm if the exec lost the spindle index in a synchronized move
  * _interlock_handler() - feedhold and resume depending on edge
  *
  *	Some handlers return EAGAIN causing the control loop to never advance beyond that point.
@@ -401,6 +940,28 @@ static stat_t _limit_switch_handler(void)
     return (STAT_OK);
 }
 
+static stat_t _following_error_handler(void)
+{
+    if (cm.following_error_requested != 0) {  // request contains the (non-zero) motor number
+	    char msg[10];
+	    sprintf_P(msg, PSTR("motor %d"), (int)cm.following_error_requested);
+        cm.following_error_requested = 0;
+        cm_alarm(STAT_FOLLOWING_ERROR_EXCEEDED, msg);
+    }
+    return (STAT_OK);
+}
+
+#ifdef __THREADING
+static stat_t _spindle_sync_handler(void)
+{
+    if (cm.spindle_sync_lost) {
+        cm.spindle_sync_lost = false;
+        cm_alarm(STAT_SPINDLE_SYNC_LOST, "spindle index");
+    }
+    return (STAT_OK);
+}
+#endif
+
 static stat_t _interlock_handler(void)
 {
     if (cm.safety_interlock_enable) {
@@ -430,6 +991,12 @@ static stat_t _interlock_handler(void)
  * _init_assertions() - initialize controller memory integrity assertions
  * _test_assertions() - check controller memory integrity assertions
  * _test_system_assertions() - check assertions for entire system
+ *
+ *	The assertions are a background scan. Each run tests one subsystem - the next in
+ *	assertion_tests[] - and arms the next run $ast ms later, so a full scan takes
+ *	ASSERTION_TESTS slices and the main loop pays for one magic number check (or one walk
+ *	of the planner buffers) at a time instead of all of them. Any failure panics as before.
+ *	A debug build with __STRICT_ASSERTIONS tests everything on every pass instead.
  */
 
 static void _init_assertions()
@@ -446,14 +1013,34 @@ static stat_t _test_assertions()
 	return (STAT_OK);
 }
 
+static stat_t (*const assertion_tests[])(void) = {
+	_test_assertions,           // these functions will panic if an assertion fails
+	config_test_assertions,
+	canonical_machine_test_assertions,
+	planner_test_assertions,
+	stepper_test_assertions,
+	encoder_test_assertions,
+	xio_test_assertions
+};
+#define ASSERTION_TESTS (sizeof(assertion_tests)/sizeof(assertion_tests[0]))
+
 stat_t _test_system_assertions()
 {
-	_test_assertions();         // these functions will panic if an assertion fails
-    config_test_assertions();
-    canonical_machine_test_assertions();
-    planner_test_assertions();
-    stepper_test_assertions();
-    encoder_test_assertions();
-    xio_test_assertions();
+#ifdef __STRICT_ASSERTIONS
+	for (uint8_t i=0; i<ASSERTION_TESTS; i++) {
+		assertion_tests[i]();
+	}
+#else
+	assertion_tests[cs.assertion_next]();
+	if (++cs.assertion_next >= ASSERTION_TESTS) {
+		cs.assertion_next = 0;
+	}
+	controller_set_deadline(DEADLINE_ASSERTIONS, SysTickTimer_getValue() + cs.assertion_interval);
+#endif
 	return (STAT_OK);
 }
+
+#ifdef __TEXT_MODE
+static const char fmt_ast[] PROGMEM = "[ast] assertion interval%11d ms per subsystem\n";
+void controller_print_ast(nvObj_t *nv) { text_print(nv, fmt_ast);}    // TYPE_INT
+#endif
@@ -32,12 +32,35 @@
 #define SAVED_BUFFER_LEN 80				// saved buffer size (for reporting only)
 #define MAXED_BUFFER_LEN 255			// same as streaming RX buffer size as a worst case
 #define OUTPUT_BUFFER_LEN 512			// text buffer size
+#define FRAME_ACK_COUNT 8				// binary data frames acknowledged in one ack frame
+
+#ifndef CONTROLLER_PASS_BUDGET_US
+#define CONTROLLER_PASS_BUDGET_US 2000		// main loop pass time report tasks must fit in - see controller_run()
+#endif
+#ifndef ASSERTION_INTERVAL_MS
+#define ASSERTION_INTERVAL_MS 5			// ms between integrity assertion slices ($ast) - see _test_system_assertions()
+#endif
+#define TASK_PROFILE_BUCKETS 8			// main loop task profile histogram buckets - see controller_get_prof()
+#ifndef CONTROLLER_REPORT_MAX_DEFER_MS
+#define CONTROLLER_REPORT_MAX_DEFER_MS 50	// longest a report task is deferred before it runs anyway
+#endif
 
 #define LED_NORMAL_BLINK_RATE 3000      // blink rate for normal operation (in ms)
 #define LED_ALARM_BLINK_RATE 750        // blink rate for alarm state (in ms)
 #define LED_SHUTDOWN_BLINK_RATE 300     // blink rate for shutdown state (in ms)
 #define LED_PANIC_BLINK_RATE 100        // blink rate for panic state (in ms)
 
+typedef enum {                          // main loop task deadlines - see controller_set_deadline()
+    DEADLINE_NONE = 0,                  // task is not deadline driven
+    DEADLINE_LED,                       // next indicator LED toggle
+    DEADLINE_MOTOR_POWER,               // motor power event or first power timeout
+    DEADLINE_STATUS_REPORT,             // pending status report comes due
+    DEADLINE_WATCH_REPORT,              // next watch list comes due - see wl_watch_report_callback()
+    DEADLINE_ASSERTIONS,                // next integrity assertion slice - see _test_system_assertions()
+    DEADLINE_EXCEPTION,                 // exceptions posted from an interrupt - see rpt_exception_callback()
+    DEADLINE_COUNT
+} ctrlDeadline;
+
 typedef enum {                          // manages startup lines
     CONTROLLER_INITIALIZING = 0,        // controller is initializing - not ready for use
     CONTROLLER_NOT_CONNECTED,           // has not yet detected connection to USB (or other comm channel)
@@ -47,13 +70,20 @@ typedef enum {                          // manages startup lines
     CONTROLLER_PAUSED                   // is paused - presumably in preparation for queue flush
 } csControllerState;
 
+typedef enum {                          // segment sync between boards - see st_set_net()
+    NETWORK_STANDALONE = 0,             // sync pin unused
+    NETWORK_MASTER,                     // drives the sync pin at each segment start
+    NETWORK_SLAVE                       // starts each segment on the master's sync edge
+} csNetworkMode;
+
 typedef struct controllerSingleton {	// main TG controller struct
 	magic_t magic_start;				// magic number to test memory integrity
 	float null;							// dumping ground for items with no target
 
     // settable parameters (from config)
 	uint8_t comm_mode;					// 0=text mode, 1=JSON mode
-	uint8_t network_mode;				// 0=master, 1=repeater, 2=slave
+	uint8_t network_mode;				// 0=standalone, 1=sync master, 2=sync slave
+	uint8_t assertion_interval;			// ms between integrity assertion slices
 
 	// system identification values
 	float fw_build;                     // tinyg firmware build number
@@ -66,15 +96,21 @@ typedef struct controllerSingleton {	// main TG controller struct
 	csControllerState controller_state;
 	uint8_t state_usb0;
 	uint8_t state_usb1;
-	uint32_t led_timer;                 // used to flash indicator LED
 	uint32_t led_blink_rate;            // used to flash indicator LED
 	bool shared_buf_overrun;            // flag for shared string buffer overrun condition
+	uint8_t assertion_next;             // subsystem the next assertion slice tests
 
 	// controller serial buffers
 	char *bufp;                         // pointer to primary or secondary in buffer
 	uint16_t linelen;                   // length of currently processing line
 	char out_buf[OUTPUT_BUFFER_LEN];    // output buffer
 	char saved_buf[SAVED_BUFFER_LEN];   // save the input buffer
+	uint32_t line_check_next;           // N of the next checked line expected, 0 for any
+	uint32_t line_tag;                  // N the current line starts with, 0 for none
+#ifdef __BINARY_DATA
+	uint8_t frame_ack_seq;              // sequence number of the last frame waiting for an ack
+	uint8_t frame_ack_count;            // frames waiting for an ack
+#endif
 
 	magic_t magic_end;
 } controller_t;
@@ -86,6 +122,19 @@ extern controller_t cs;					// controller state structure
 void controller_init(uint8_t std_in, uint8_t std_out, uint8_t std_err);
 void controller_run(void);
 void controller_set_connected(bool is_connected);
+void controller_dispatch_realtime(char c);
+void controller_set_deadline(uint8_t deadline, uint32_t systick);
+void controller_wake(uint8_t deadline);
+#ifdef __TASK_PROFILE
+stat_t controller_get_prof(nvObj_t *nv);
+stat_t controller_set_prof(nvObj_t *nv);
+#endif
 bool controller_parse_control(char *p);
 
+#ifdef __TEXT_MODE
+	void controller_print_ast(nvObj_t *nv);
+#else
+	#define controller_print_ast tx_print_stub
+#endif
+
 #endif // End of include guard: CONTROLLER_H_ONCE
@@ -123,7 +123,7 @@ stat_t cm_flood_coolant_control(uint8_t flood_enable)
 {
     float value[] = { (float)flood_enable, 0,0,0,0,0 };
     bool flags[] = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_coolant_control, value, flags);
+    mp_queue_aux_command(_exec_coolant_control, value, flags);
     return (STAT_OK);
 }
 
@@ -131,7 +131,7 @@ stat_t cm_mist_coolant_control(uint8_t mist_enable)
 {
     float value[] = { 0, (float)mist_enable, 0,0,0,0 };
     bool flags[] = { 0,1,0,0,0,0 };
-    mp_queue_command(_exec_coolant_control, value, flags);
+    mp_queue_aux_command(_exec_coolant_control, value, flags);
     return (STAT_OK);
 }
 
@@ -151,6 +151,9 @@ stat_t cm_mist_coolant_control(uint8_t mist_enable)
 
 static void _exec_coolant_control(float *value, bool *flags)
 {
+    if (mp_dry_plan_is_active()) {
+        return;                                                             // dry plans don't run outputs
+    }
     if (flags[COOLANT_FLOOD]) {
         coolant.flood_enable = (cmCoolantEnable)value[COOLANT_FLOOD];
         if (!((coolant.flood_enable & 0x01) ^ coolant.flood_polarity)) {    // inverted XOR
@@ -34,6 +34,7 @@
 #include "canonical_machine.h"
 #include "planner.h"
 #include "encoder.h"
+#include "stepper.h"
 #include "kinematics.h"
 #include "gpio.h"
 #include "report.h"
@@ -56,6 +57,19 @@ struct hmHomingSingleton {			// persistent homing runtime variables
     float latch_velocity;           // latch speed as positive number
     float zero_backoff;             // distance to back off switch before setting zero
     float max_clear_backoff;        // maximum distance of switch clearing backoffs before erring out
+    uint8_t slaved_motors;          // motors on this axis with their own homing input (gantry squaring)
+    bool latched;                   // the latch move closed the switch (single motor axes)
+    float latch_position;           // machine position of the axis when the switch closed
+
+	// concurrent homing - one entry per axis, used for the axes in the group mask
+	uint8_t group;					// axes being homed together (bit per axis)
+	uint8_t done;					// axes already homed by a concurrent group in this cycle
+	float group_search[AXES];		// signed search travel
+	float group_latch[AXES];		// signed latch backoff
+	float group_zero[AXES];			// signed zero backoff
+	float group_latch_position[AXES];	// machine position when the axis' switch closed
+	float group_saved_jerk[AXES];
+	uint8_t group_latched;			// axes whose switch closed during the last latch move
 
 	// state saved from gcode model
 	uint8_t saved_units_mode;		// G20,G21 global setting
@@ -77,11 +91,24 @@ static stat_t _homing_axis_clear(int8_t axis);
 static stat_t _homing_axis_latch(int8_t axis);
 static stat_t _homing_axis_zero_backoff(int8_t axis);
 static stat_t _homing_axis_set_zero(int8_t axis);
+static stat_t _homing_axis_square(int8_t axis);
+static void _homing_clear_motor_latches(int8_t axis);
 static stat_t _homing_axis_move(int8_t axis, float target, float velocity);
 static stat_t _homing_error_exit(int8_t axis, stat_t status);
 static stat_t _homing_finalize_exit(int8_t axis);
 static int8_t _get_next_axis(int8_t axis);
 
+static void _homing_axis_travel(int8_t axis, float *search, float *latch, float *zero);
+static void _homing_snapshot_position(float position[]);
+static uint8_t _homing_group_find(int8_t axis);
+static void _homing_group_disarm(void);
+static stat_t _homing_group_clear_init(int8_t axis);
+static stat_t _homing_group_search(int8_t axis);
+static stat_t _homing_group_clear(int8_t axis);
+static stat_t _homing_group_latch(int8_t axis);
+static stat_t _homing_group_zero_backoff(int8_t axis);
+static stat_t _homing_group_set_zero(int8_t axis);
+
 /**** HELPERS ***************************************************************************
  * _set_homing_func() - a convenience for setting the next dispatch vector and exiting
  */
@@ -126,6 +153,13 @@ static stat_t _set_homing_func(stat_t (*func)(int8_t axis))
  *    3. Drive towards homing switch at latch velocity until switch is activated
  *	  4. Back off switch by the zero backoff distance and set zero for that axis
  *
+ *	Gantry squaring: if two or more motors mapped to the axis have their own homing
+ *	input (Nhi) the latch in step 3 runs until every one of those switches has closed.
+ *	Each switch snapshots only its own motor. The motors are then offset from each other
+ *	by the difference of their latch positions (see st_set_step_offset()) and take it up
+ *	during the zero backoff, so each motor ends the same distance from its own switch.
+ *	The first slaved motor is the reference and is never offset.
+ *
  *	Homing works as a state machine that is driven by registering a callback function
  *  at hm.func() for the next state to be run. Once the axis is initialized each
  *  callback basically does two things (1) start the move for the current function,
@@ -170,10 +204,13 @@ stat_t cm_homing_cycle_start(void)
 	hm.set_coordinates = true;
 
 	hm.axis = -1;							// set to retrieve initial axis
+	hm.group = 0;
+	hm.done = 0;
 	hm.func = _homing_axis_start; 			// bind initial processing function
 	cm.machine_state = MACHINE_CYCLE;
 	cm.cycle_state = CYCLE_HOMING;
 	cm.homing_state = HOMING_NOT_HOMED;
+	cm_set_cycle_callback(cm_homing_cycle_callback);
 //  cm.limit_enable = false;                // disable limit switch processing (no longer needed)
 	return (STAT_OK);
 }
@@ -210,8 +247,12 @@ stat_t cm_homing_cycle_callback(void)
 
 static stat_t _homing_axis_start(int8_t axis)
 {
-	// get the first or next axis
-	if ((axis = _get_next_axis(axis)) < 0) { 				// axes are done or error
+	// get the first or next axis, skipping any a concurrent group has already homed
+	axis = _get_next_axis(axis);
+	while ((axis >= 0) && (hm.done & (1 << axis))) {
+		axis = _get_next_axis(axis);
+	}
+	if (axis < 0) {		 									// axes are done or error
 		if (axis == -1) {									// -1 is done
 			cm.homing_state = HOMING_HOMED;
 			return (_set_homing_func(_homing_finalize_exit));
@@ -221,6 +262,7 @@ static stat_t _homing_axis_start(int8_t axis)
 	}
 	// clear the homed flag for axis so we'll be able to move w/o triggering soft limits
 	cm.homed[axis] = false;
+	cm_refresh_soft_limits();
 
 	// trap axis mis-configurations
 	if (fp_ZERO(cm.a[axis].homing_input))   { return (_homing_error_exit(axis, STAT_HOMING_ERROR_HOMING_INPUT_MISCONFIGURED)); }
@@ -233,6 +275,14 @@ static stat_t _homing_axis_start(int8_t axis)
         return (_homing_error_exit(axis, STAT_HOMING_ERROR_TRAVEL_MIN_MAX_IDENTICAL));
     }
 
+	// after Z, home this axis together with the other independent axes if so configured
+	if (cm.homing_concurrent && hm.set_coordinates && (axis != AXIS_Z)) {
+		if ((hm.group = _homing_group_find(axis)) != 0) {
+			hm.axis = axis;
+			return (_set_homing_func(_homing_group_clear_init));
+		}
+	}
+
     // Nothing to do about direction now that direction is explicit
     // However, here's a good place to stash the homing_switch:
     hm.homing_input = cm.a[axis].homing_input;
@@ -240,18 +290,20 @@ static stat_t _homing_axis_start(int8_t axis)
 	hm.axis = axis;											// persist the axis
 	hm.search_velocity = fabs(cm.a[axis].search_velocity);	// search velocity is always positive
 	hm.latch_velocity = fabs(cm.a[axis].latch_velocity);	// latch velocity is always positive
+	_homing_axis_travel(axis, &hm.search_travel, &hm.latch_backoff, &hm.zero_backoff);
 
-    bool homing_to_max = cm.a[axis].homing_dir;
-
-    // setup parameters for positive or negative travel (homing to the max or min switch)
-    if (homing_to_max) {
-		hm.search_travel = travel_distance;                 // search travels in positive direction
-		hm.latch_backoff = fabs(cm.a[axis].latch_backoff);  // latch travels in positive direction
-		hm.zero_backoff  = -fabs(cm.a[axis].zero_backoff);  // zero backoff is negative direction
-	} else {
-		hm.search_travel = -travel_distance;                // search travels in negative direction
-		hm.latch_backoff = -fabs(cm.a[axis].latch_backoff); // latch travels in negative direction
-		hm.zero_backoff  = fabs(cm.a[axis].zero_backoff);   // zero backoff is positive direction
+	// find slaved motors for gantry squaring - each needs a distinct input
+	hm.slaved_motors = 0;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if ((st_cfg.mot[motor].motor_map != axis) || (st_cfg.mot[motor].homing_input == 0)) {
+			continue;
+		}
+		for (uint8_t other=0; other<motor; other++) {
+			if ((st_cfg.mot[other].motor_map == axis) && (st_cfg.mot[other].homing_input == st_cfg.mot[motor].homing_input)) {
+				return (_homing_error_exit(axis, STAT_HOMING_ERROR_HOMING_INPUT_MISCONFIGURED));
+			}
+		}
+		hm.slaved_motors++;
 	}
 
 	// if homing is disabled for the axis then skip to the next axis
@@ -292,6 +344,16 @@ static stat_t _homing_axis_clear(int8_t axis)		        // drive away from switch
 
 static stat_t _homing_axis_latch(int8_t axis)				// drive to switch at low speed
 {
+	if (hm.slaved_motors > 1) {								// latch each slaved motor on its own switch
+		gpio_set_homing_mode(hm.homing_input, false);
+		for (uint8_t motor=0; motor<MOTORS; motor++) {
+			if (st_cfg.mot[motor].motor_map == axis) {
+				gpio_set_motor_latch_mode(st_cfg.mot[motor].homing_input, motor+1);
+			}
+		}
+	} else {
+		gpio_set_homing_mode(hm.homing_input, true);		// re-arm so only the latch edge counts
+	}
 	_homing_axis_move(axis, hm.latch_backoff, hm.latch_velocity);
 	return (_set_homing_func(_homing_axis_zero_backoff));
 }
@@ -299,6 +361,14 @@ static stat_t _homing_axis_latch(int8_t axis)				// drive to switch at low speed
 static stat_t _homing_axis_zero_backoff(int8_t axis)		// backoff to zero position
 {
     mp_flush_planner();                                     // clear out the remaining latch move
+    if (hm.slaved_motors > 1) {
+        ritorno(_homing_axis_square(axis));
+        hm.latched = false;
+    } else if ((hm.latched = gpio_get_latch(hm.homing_input, NULL))) {
+        float contact_position[AXES];                       // position captured by the switch interrupt
+        _homing_snapshot_position(contact_position);
+        hm.latch_position = contact_position[axis];
+    }
 	_homing_axis_move(axis, hm.zero_backoff, hm.search_velocity);
 	return (_set_homing_func(_homing_axis_set_zero));
 }
@@ -306,8 +376,16 @@ static stat_t _homing_axis_zero_backoff(int8_t axis)		// backoff to zero positio
 static stat_t _homing_axis_set_zero(int8_t axis)			// set zero and finish up
 {
 	if (hm.set_coordinates) {
-		cm_set_position(axis, 0.0);
+		if (hm.latched) {
+			// zero is zero_backoff from the switch closure, not from where the latch move
+			// stopped, so overshoot from the feedhold does not shift the origin
+			cm_set_position(axis, cm_get_absolute_position(ACTIVE_MODEL, axis) -
+							(hm.latch_position + hm.zero_backoff));
+		} else {
+			cm_set_position(axis, 0.0);
+		}
 		cm.homed[axis] = true;
+		cm_refresh_soft_limits();
 
 	} else { // handle G28.4 cycle - set position to the point of switch closure
 //		cm_set_position(axis, cm_get_work_position(RUNTIME, axis));
@@ -323,6 +401,317 @@ static stat_t _homing_axis_set_zero(int8_t axis)			// set zero and finish up
 	return (_set_homing_func(_homing_axis_start));
 }
 
+/*
+ * _homing_axis_square() - offset slaved motors by the difference of their latch positions
+ *
+ *	Snapshots are in each motor's own encoder steps, which already include any offset from
+ *	an earlier squaring, so the new offset is set relative to the reference motor's offset.
+ *	A gantry that is already square therefore gets the same offsets back.
+ */
+
+static stat_t _homing_axis_square(int8_t axis)
+{
+	uint8_t pending = gpio_get_motor_latches_pending();
+	_homing_clear_motor_latches(axis);
+	if (pending != 0) {										// latch move ended before every switch closed
+		return (_homing_error_exit(axis, STAT_HOMING_ERROR_SLAVED_MOTOR_NOT_LATCHED));
+	}
+	int8_t reference = -1;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if ((st_cfg.mot[motor].motor_map != axis) || (st_cfg.mot[motor].homing_input == 0)) {
+			continue;
+		}
+		if (reference < 0) {
+			reference = motor;
+			continue;
+		}
+		st_set_step_offset(motor, st_get_step_offset(reference) +
+						   en_get_encoder_snapshot_steps(motor) - en_get_encoder_snapshot_steps(reference));
+	}
+	return (STAT_OK);
+}
+
+static void _homing_clear_motor_latches(int8_t axis)
+{
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if (st_cfg.mot[motor].motor_map == axis) {
+			gpio_set_motor_latch_mode(st_cfg.mot[motor].homing_input, 0);
+		}
+	}
+}
+
+/*
+ * Concurrent homing - homes the independent axes after Z at the same time ($hmc=1)
+ *
+ *	_homing_group_find()         - collect the axes that can be homed together
+ *	_homing_group_clear_init()   - back every axis off a switch that is closed at the start
+ *	_homing_group_search()       - search with all axes until every switch has closed
+ *	_homing_group_clear()        - clear off the switches
+ *	_homing_group_latch()        - latch all axes at latch velocity
+ *	_homing_group_zero_backoff() - record the latch positions and back off to zero
+ *	_homing_group_set_zero()     - set zero for every axis and resume the axis sequence
+ *
+ *	The phases are the same as for a single axis, but each one is a single move of every
+ *	axis in the group, with each axis running at its own search or latch velocity. Each
+ *	axis' switch is set to stop that axis' motors (st_stop_motors()) and snapshot them;
+ *	the move runs on for the other axes and is held once every switch has closed. Since
+ *	stopped motors fall behind the commanded position, the positions of the group are
+ *	resynced from the encoders after each switch move.
+ *
+ *	An axis can join a group if it has its own homing input (shared with no other axis),
+ *	valid homing settings, and is not squared by slaved motors. Z is always homed first
+ *	and on its own; axes that can't join a group are homed one at a time afterwards.
+ *	Only G28.2 uses groups - G28.4 is always sequential.
+ *
+ *	Per-motor stops are abrupt. That is fine at latch velocity and only costs repeatability
+ *	for the search, which is not used for the final position.
+ */
+
+static uint8_t _homing_axis_motors(int8_t axis)
+{
+	uint8_t mask = 0;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if (st_cfg.mot[motor].motor_map == axis) { mask |= (1 << motor); }
+	}
+	return (mask);
+}
+
+static bool _homing_axis_independent(int8_t axis)
+{
+	if ((cm.a[axis].homing_input == 0) ||
+		fp_ZERO(cm.a[axis].search_velocity) ||
+		fp_ZERO(cm.a[axis].latch_velocity) ||
+		fp_ZERO(fabs(cm.a[axis].travel_max - cm.a[axis].travel_min) + cm.a[axis].latch_backoff) ||
+		(_homing_axis_motors(axis) == 0)) {
+		return (false);
+	}
+	uint8_t slaved = 0;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if ((st_cfg.mot[motor].motor_map == axis) && (st_cfg.mot[motor].homing_input != 0)) { slaved++; }
+	}
+	if (slaved > 1) {
+		return (false);									// gantry squaring is homed on its own
+	}
+	for (uint8_t other = AXIS_X; other < AXES; other++) {
+		if ((other != axis) && (cm.a[other].homing_input == cm.a[axis].homing_input)) {
+			return (false);
+		}
+	}
+	return (true);
+}
+
+static uint8_t _homing_group_find(int8_t axis)
+{
+	if (!_homing_axis_independent(axis)) {
+		return (0);
+	}
+	uint8_t group = 0;
+	uint8_t count = 0;
+	for (int8_t a = axis; a >= 0; a = _get_next_axis(a)) {
+		if ((hm.done & (1 << a)) || !_homing_axis_independent(a)) {
+			continue;
+		}
+		group |= (1 << a);
+		count++;
+		_homing_axis_travel(a, &hm.group_search[a], &hm.group_latch[a], &hm.group_zero[a]);
+	}
+	return ((count > 1) ? group : 0);
+}
+
+static void _homing_group_arm()
+{
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (hm.group & (1 << axis)) {
+			gpio_set_axis_latch_mode(cm.a[axis].homing_input, _homing_axis_motors(axis));
+		}
+	}
+}
+
+static void _homing_group_disarm()
+{
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (hm.group & (1 << axis)) {
+			gpio_set_axis_latch_mode(cm.a[axis].homing_input, 0);
+		}
+	}
+}
+
+// set the group's positions to where the motors actually are, then let them step again
+static void _homing_group_resync()
+{
+	float position[AXES];
+	en_take_encoder_snapshot();
+	_homing_snapshot_position(position);
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (hm.group & (1 << axis)) {
+			cm_set_position(axis, position[axis]);
+		}
+	}
+	st_release_motors();
+}
+
+/*
+ * _homing_group_move() - move the group, each axis at its own homing velocity
+ *
+ *	The move takes as long as the slowest axis needs at its velocity. With run_on true
+ *	(switch moves) the shorter travels are stretched to the same time, so every axis
+ *	runs at its own velocity until its switch stops it. Otherwise the travels are exact
+ *	and the other axes run slower.
+ */
+static stat_t _homing_group_move(const float travel[], bool latch_velocity, bool run_on)
+{
+	float vect[] = {0,0,0,0,0,0};
+	bool flags[] = {false, false, false, false, false, false};
+	float velocity[AXES];
+	float time = 0;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (!(hm.group & (1 << axis)) || fp_ZERO(travel[axis])) {
+			continue;
+		}
+		velocity[axis] = fabs(latch_velocity ? cm.a[axis].latch_velocity : cm.a[axis].search_velocity);
+		time = max(time, fabs(travel[axis]) / velocity[axis]);
+	}
+	if (fp_ZERO(time)) {
+		return (STAT_NOOP);
+	}
+	float length = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (!(hm.group & (1 << axis)) || fp_ZERO(travel[axis])) {
+			continue;
+		}
+		vect[axis] = run_on ? copysignf(velocity[axis] * time, travel[axis]) : travel[axis];
+		flags[axis] = true;
+		length += square(vect[axis]);
+	}
+	cm_set_feed_rate(sqrt(length) / time);
+    cm_queue_flush();                                     // flush queue and end hold (if applicable)
+	ritorno(cm_straight_feed(vect, flags));
+	return (STAT_EAGAIN);
+}
+
+static stat_t _homing_group_clear_init(int8_t axis)
+{
+	float travel[] = {0,0,0,0,0,0};
+	for (uint8_t a=0; a<AXES; a++) {
+		if (!(hm.group & (1 << a))) {
+			continue;
+		}
+		cm.homed[a] = false;
+		hm.group_saved_jerk[a] = cm_get_axis_jerk(a);
+		if (gpio_read_input(cm.a[a].homing_input) == INPUT_ACTIVE) {
+			travel[a] = -hm.group_latch[a];					// back off a switch closed at the start
+		}
+	}
+	cm_refresh_soft_limits();
+	_homing_group_move(travel, false, false);
+	return (_set_homing_func(_homing_group_search));
+}
+
+static stat_t _homing_group_search(int8_t axis)
+{
+	for (uint8_t a=0; a<AXES; a++) {
+		if (hm.group & (1 << a)) {
+			cm_set_axis_jerk(a, cm.a[a].jerk_high);
+		}
+	}
+	_homing_group_arm();
+	_homing_group_move(hm.group_search, false, true);
+	return (_set_homing_func(_homing_group_clear));
+}
+
+static stat_t _homing_group_clear(int8_t axis)
+{
+	float travel[AXES];
+	mp_flush_planner();										// clear out the remaining search move
+	_homing_group_disarm();
+	_homing_group_resync();
+	for (uint8_t a=0; a<AXES; a++) {
+		travel[a] = -hm.group_latch[a];
+	}
+	_homing_group_move(travel, false, false);
+	return (_set_homing_func(_homing_group_latch));
+}
+
+static stat_t _homing_group_latch(int8_t axis)
+{
+	_homing_group_arm();
+	_homing_group_move(hm.group_latch, true, true);
+	return (_set_homing_func(_homing_group_zero_backoff));
+}
+
+static stat_t _homing_group_zero_backoff(int8_t axis)
+{
+	float contact_position[AXES];
+	mp_flush_planner();										// clear out the remaining latch move
+	_homing_snapshot_position(contact_position);			// each axis' motors were snapshot by its own switch
+	hm.group_latched = 0;
+	for (uint8_t a=0; a<AXES; a++) {
+		if ((hm.group & (1 << a)) && gpio_get_latch(cm.a[a].homing_input, NULL)) {
+			hm.group_latched |= (1 << a);
+			hm.group_latch_position[a] = contact_position[a];
+		}
+	}
+	_homing_group_disarm();
+	_homing_group_resync();
+	_homing_group_move(hm.group_zero, false, false);
+	return (_set_homing_func(_homing_group_set_zero));
+}
+
+static stat_t _homing_group_set_zero(int8_t axis)
+{
+	for (uint8_t a=0; a<AXES; a++) {
+		if (!(hm.group & (1 << a))) {
+			continue;
+		}
+		if (hm.group_latched & (1 << a)) {
+			cm_set_position(a, cm_get_absolute_position(ACTIVE_MODEL, a) -
+							(hm.group_latch_position[a] + hm.group_zero[a]));
+		} else {
+			cm_set_position(a, 0.0);
+		}
+		cm.homed[a] = true;
+		cm_set_axis_jerk(a, hm.group_saved_jerk[a]);
+	}
+	cm_refresh_soft_limits();
+	hm.done |= hm.group;
+	hm.group = 0;
+	return (_set_homing_func(_homing_axis_start));			// carry on after the group's first axis
+}
+
+/*
+ * _homing_axis_travel() - signed search, latch and zero backoff travel for an axis
+ * _homing_snapshot_position() - machine position of the encoder snapshot
+ *
+ *	The snapshot includes any backlash take-up or step offset the motor has been given,
+ *	which the commanded position does not, so it is taken out before the kinematics.
+ */
+static void _homing_axis_travel(int8_t axis, float *search, float *latch, float *zero)
+{
+	float travel_distance = fabs(cm.a[axis].travel_max - cm.a[axis].travel_min) + cm.a[axis].latch_backoff;
+
+    // setup parameters for positive or negative travel (homing to the max or min switch)
+    if (cm.a[axis].homing_dir) {
+		*search = travel_distance;                      // search travels in positive direction
+		*latch = fabs(cm.a[axis].latch_backoff);        // latch travels in positive direction
+		*zero  = -fabs(cm.a[axis].zero_backoff);        // zero backoff is negative direction
+	} else {
+		*search = -travel_distance;                     // search travels in negative direction
+		*latch = -fabs(cm.a[axis].latch_backoff);       // latch travels in negative direction
+		*zero  = fabs(cm.a[axis].zero_backoff);         // zero backoff is positive direction
+	}
+}
+
+static void _homing_snapshot_position(float position[])
+{
+	float steps[MOTORS];
+	float *snapshot = en_get_encoder_snapshot_vector();
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		steps[motor] = snapshot[motor] - st_pre.mot[motor].backlash_deviation;
+	}
+	kn_forward_kinematics(steps, position);
+}
+
 static stat_t _homing_axis_move(int8_t axis, float target, float velocity)
 {
 	float vect[] = {0,0,0,0,0,0};
@@ -366,6 +755,12 @@ static stat_t _homing_error_exit(int8_t axis, stat_t status)
 static stat_t _homing_finalize_exit(int8_t axis)			// third part of return to home
 {
     cm_queue_flush();                                       // flush queue and end hold (if applicable)
+    if (axis >= 0) {
+        _homing_clear_motor_latches(axis);                  // in case of an error exit during the latch
+    }
+    _homing_group_disarm();
+    st_release_motors();
+    hm.group = 0;
 	cm_set_coord_system(hm.saved_coord_system);				// restore to work coordinate system
 	cm_set_units_mode(hm.saved_units_mode);
 	cm_set_distance_mode(hm.saved_distance_mode);
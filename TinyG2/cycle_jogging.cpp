@@ -42,6 +42,7 @@ struct jmJoggingSingleton {			// persistent jogging runtime variables
 	float velocity_start;			// initial jog feed
 	float velocity_max;
 	uint8_t step;					// what step of the ramp the jogging cycle is currently on
+	bool velocity_mode;				// true when running a streamed velocity jog
 
 	uint8_t (*func)(int8_t axis);	// binding for callback function state machine
 
@@ -62,7 +63,9 @@ static stat_t _set_jogging_func(uint8_t (*func)(int8_t axis));
 static stat_t _jogging_axis_start(int8_t axis);
 static stat_t _jogging_axis_ramp_jog(int8_t axis);
 static stat_t _jogging_axis_move(int8_t axis, float target, float velocity);
+static stat_t _jogging_velocity_run(int8_t axis);
 static stat_t _jogging_finalize_exit(int8_t axis);
+static void _jogging_save_state(void);
 
 /*****************************************************************************
  * cm_jogging_cycle_start()	- jogging cycle using soft limits
@@ -83,19 +86,9 @@ static stat_t _jogging_finalize_exit(int8_t axis);
 
 stat_t cm_jogging_cycle_start(uint8_t axis)
 {
-	// save relevant non-axis parameters from Gcode model
-	jog.saved_units_mode = cm_get_units_mode(ACTIVE_MODEL);			//cm.gm.units_mode;
-	jog.saved_coord_system = cm_get_coord_system(ACTIVE_MODEL);		//cm.gm.coord_system;
-	jog.saved_distance_mode = cm_get_distance_mode(ACTIVE_MODEL);	//cm.gm.distance_mode;
-	jog.saved_feed_rate_mode = cm_get_feed_rate_mode(ACTIVE_MODEL);
-	jog.saved_feed_rate = (ACTIVE_MODEL)->feed_rate;		//cm.gm.feed_rate;
+	_jogging_save_state();
 	jog.saved_jerk = cm.a[axis].jerk_max;
-
-	// set working values
-	cm_set_units_mode(MILLIMETERS);
-	cm_set_distance_mode(ABSOLUTE_MODE);
-	cm_set_coord_system(ABSOLUTE_COORDS);			// jogging is done in machine coordinates
-	cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);
+	jog.velocity_mode = false;
 
 	jog.velocity_start = JOGGING_START_VELOCITY;	// see canonical_machine.h for #define
 	jog.velocity_max = cm.a[axis].velocity_max;
@@ -109,9 +102,67 @@ stat_t cm_jogging_cycle_start(uint8_t axis)
 
 	cm.machine_state = MACHINE_CYCLE;
 	cm.cycle_state = CYCLE_JOG;
+	cm_set_cycle_callback(cm_jogging_cycle_callback);
+	return (STAT_OK);
+}
+
+/*
+ * cm_jogging_velocity_start() - start or refresh a velocity jog
+ *
+ *	Velocity jogging is driven by a host streaming velocity vectors ({"jgv":{"x":1200,"y":-300}})
+ *	at 20 - 50 Hz. Each command refreshes a watchdog; the jog stops if the commands stop arriving
+ *	for JOG_VELOCITY_TIMEOUT_MS or the vector goes to zero.
+ *
+ *	Rather than filling the planner queue, the cycle keeps at most JOG_VELOCITY_MOVES short moves
+ *	queued - just enough to cover the braking distance plus JOG_VELOCITY_HORIZON_MS of travel.
+ *	A new vector therefore takes effect within that horizon instead of after the whole queue has
+ *	drained, and when the commands stop the planner is already decelerating into the end of the
+ *	queue so the machine stops within one jerk-limited tail.
+ */
+
+stat_t cm_jogging_velocity_start()
+{
+	cm.jog_velocity_time = SysTickTimer_getValue();
+
+	if (cm.cycle_state == CYCLE_JOG) {
+		return (jog.velocity_mode ? STAT_OK : STAT_COMMAND_NOT_ACCEPTED);	// positional jog in progress
+	}
+	if ((cm.cycle_state != CYCLE_OFF) || (cm.hold_state != FEEDHOLD_OFF)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	bool moving = false;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		if (fp_NOT_ZERO(cm.jog_velocity[axis])) moving = true;
+	}
+	if (!moving) return (STAT_OK);
+
+	_jogging_save_state();
+	jog.velocity_mode = true;
+	jog.axis = 0;
+	jog.func = _jogging_velocity_run;
+
+	cm.machine_state = MACHINE_CYCLE;
+	cm.cycle_state = CYCLE_JOG;
+	cm_set_cycle_callback(cm_jogging_cycle_callback);
 	return (STAT_OK);
 }
 
+static void _jogging_save_state()
+{
+	// save relevant non-axis parameters from Gcode model
+	jog.saved_units_mode = cm_get_units_mode(ACTIVE_MODEL);			//cm.gm.units_mode;
+	jog.saved_coord_system = cm_get_coord_system(ACTIVE_MODEL);		//cm.gm.coord_system;
+	jog.saved_distance_mode = cm_get_distance_mode(ACTIVE_MODEL);	//cm.gm.distance_mode;
+	jog.saved_feed_rate_mode = cm_get_feed_rate_mode(ACTIVE_MODEL);
+	jog.saved_feed_rate = (ACTIVE_MODEL)->feed_rate;		//cm.gm.feed_rate;
+
+	// set working values
+	cm_set_units_mode(MILLIMETERS);
+	cm_set_distance_mode(ABSOLUTE_MODE);
+	cm_set_coord_system(ABSOLUTE_COORDS);			// jogging is done in machine coordinates
+	cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);
+}
+
 
 /* Jogging axis moves - these execute in sequence for each axis
  * cm_jogging_cycle_callback()	- main loop callback for running the jogging cycle
@@ -119,6 +170,7 @@ stat_t cm_jogging_cycle_start(uint8_t axis)
  *  _jogging_axis_start()       - setup the jog
  *	_jogging_axis_ramp_jog()	- ramp the jog
  *	_jogging_axis_move()		- move the axis
+ *	_jogging_velocity_run()		- queue the next short velocity jog move
  *	_jogging_finalize_exit()	- clean up
  */
 
@@ -132,6 +184,10 @@ stat_t cm_jogging_cycle_callback(void)
     }
 	if (jog.func == _jogging_axis_ramp_jog && mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
 	    return (STAT_EAGAIN);                                       // prevent flooding the queue with jog moves
+    }
+	if (jog.func == _jogging_velocity_run &&
+		(PLANNER_BUFFER_POOL_SIZE - mp_get_planner_buffers_available()) >= JOG_VELOCITY_MOVES) {
+	    return (STAT_EAGAIN);                                       // keep the velocity jog queue short
     }
 	return (jog.func(jog.axis));									// execute the current jogging move
 }
@@ -188,8 +244,76 @@ static stat_t _jogging_axis_move(int8_t axis, float target, float velocity)
 	return (STAT_EAGAIN);
 }
 
+static stat_t _jogging_velocity_run(int8_t axis)
+{
+	float velocity[AXES];
+	float speed = 0;
+	float scale = 1.0;
+
+	// stop queuing if the host went quiet - the planner ends the queue at zero velocity
+	if ((SysTickTimer_getValue() - cm.jog_velocity_time) > JOG_VELOCITY_TIMEOUT_MS) {
+		for (uint8_t i = AXIS_X; i < AXES; i++) cm.jog_velocity[i] = 0;
+	}
+	// clamp each axis to its velocity_max while preserving the direction of the vector
+	for (uint8_t i = AXIS_X; i < AXES; i++) {
+		velocity[i] = cm.jog_velocity[i];
+		if (fabs(velocity[i]) * scale > cm.a[i].velocity_max) {
+			scale = cm.a[i].velocity_max / fabs(velocity[i]);
+		}
+	}
+	for (uint8_t i = AXIS_X; i < AXES; i++) {
+		velocity[i] *= scale;
+		speed += square(velocity[i]);
+	}
+	speed = sqrt(speed);
+	if (speed < EPSILON) {
+		return (_set_jogging_func(_jogging_finalize_exit));
+	}
+
+	// braking distance from speed, using the jerk the planner will pick for this direction
+	mpBuf_t brake;
+	brake.jerk = 8675309;
+	for (uint8_t i = AXIS_X; i < AXES; i++) {
+		float unit = fabs(velocity[i]) / speed;
+		if (unit > EPSILON) {
+			brake.jerk = min(brake.jerk, cm.a[i].jerk_max / unit);
+		}
+	}
+	brake.jerk *= JERK_MULTIPLIER * PROFILE_JERK_FACTOR;
+	brake.recip_jerk = 1/brake.jerk;
+	float length = max(speed * JOG_VELOCITY_HORIZON_MS / MILLISECONDS_PER_MINUTE,
+					   mp_get_target_length(speed, 0, &brake) / (JOG_VELOCITY_MOVES - 1));
+
+	float position[AXES];
+	float target[AXES];
+	bool flags[AXES];
+	for (uint8_t i = AXIS_X; i < AXES; i++) {
+		position[i] = cm_get_absolute_position(MODEL, i);
+		target[i] = position[i] + velocity[i] / speed * length;
+		flags[i] = fp_NOT_ZERO(velocity[i]);
+	}
+	for (uint8_t i = 0; i < cm.soft_limit_count; i++) {	// stop at the soft limits rather than faulting on them
+		const cmSoftLimit_t *limit = &cm.soft_limit[i];
+		target[limit->axis] = max(limit->travel_min, min(limit->travel_max, target[limit->axis]));
+	}
+	float travel = 0;
+	for (uint8_t i = AXIS_X; i < AXES; i++) {
+		travel += square(target[i] - position[i]);
+	}
+	if (sqrt(travel) < EPSILON) {
+		return (_set_jogging_func(_jogging_finalize_exit));
+	}
+	cm_set_feed_rate(speed);
+	ritorno(cm_straight_feed(target, flags));
+	return (STAT_EAGAIN);
+}
+
 static stat_t _jogging_finalize_exit(int8_t axis)	// finish a jog
 {
+	if (jog.velocity_mode) {
+		for (uint8_t i = AXIS_X; i < AXES; i++) cm.jog_velocity[i] = 0;
+		jog.velocity_mode = false;
+	}
 //    cm_end_hold();                                  // ends hold if one is in effect
 
     cm_set_coord_system(jog.saved_coord_system);	// restore to work coordinate system
@@ -37,6 +37,7 @@
 #include "gpio.h"
 #include "planner.h"
 #include "util.h"
+#include "xio.h"
 
 /**** Probe singleton structure ****/
 
@@ -127,6 +128,7 @@ uint8_t cm_straight_probe(float target[], bool flags[])
 
     cm.probe_state = PROBE_WAITING;     // wait until planner queue empties before completing initialization
     pb.func = _probing_init;            // bind probing initialization function
+    cm_set_cycle_callback(cm_probing_cycle_callback);
     return (STAT_OK);
 }
 
@@ -189,7 +191,7 @@ static uint8_t _probing_init()
 	}
 
 	// initialize the probe switch
-    pb.probe_input = 5;     // TODO -- for now we hard code it to zmin
+    pb.probe_input = cm.probe_input;
     gpio_set_probing_mode(pb.probe_input, true);
 
     // turn off spindle and start the move
@@ -221,15 +223,19 @@ static stat_t _probing_start()
  * _probing_backoff() - runs after the probe move, whether it contacted or not
  *
  * Back off to the measured touch position captured by encoder snapshot
+ *
+ *	The switch interrupt starts a feedhold, so the probe move already comes to a
+ *	jerk-limited stop past the contact point rather than halting. The snapshot makes
+ *	the overshoot irrelevant to accuracy, so the return to contact is a traverse:
+ *	it runs along the same line, away from the surface, and need not crawl back at
+ *	the probing feed rate. This is what lets the probe feed rate go up.
  */
 
 static stat_t _probing_backoff()
 {
-    // Test if we've contacted
-    int8_t probe = gpio_read_input(pb.probe_input);
-
-    // INPUT_INACTIVE means switch is OPEN (at least for now)
-    if ( probe == INPUT_INACTIVE ) {
+    // Test if we've contacted. The latch is set by the switch interrupt, so a probe that
+    // bounced open again during the feedhold still counts as a contact.
+    if (!gpio_get_latch(pb.probe_input, NULL)) {
         cm.probe_state = PROBE_FAILED;
 
     } else {
@@ -241,7 +247,9 @@ static stat_t _probing_backoff()
         kn_forward_kinematics(en_get_encoder_snapshot_vector(), contact_position);
 
         cm_queue_flush();                               // flush queue & end feedhold
-        cm_straight_feed(contact_position, pb.flags);   // NB: feed rate is the same as the probe move
+        uint8_t motion_mode = cm.gm.motion_mode;        // don't leave G0 as the modal motion
+        cm_straight_traverse(contact_position, pb.flags);
+        cm.gm.motion_mode = motion_mode;
     }
     return (_set_pb_func(_probing_finish));
 }
@@ -252,8 +260,10 @@ static stat_t _probing_backoff()
 
 static stat_t _probing_finish()
 {
+    // backing off to the latch position can leave the probe right at its switching point,
+    // so a latched probe has succeeded even if the input now reads open
     int8_t probe = gpio_read_input(pb.probe_input);
-	cm.probe_state = (probe==true) ? PROBE_SUCCEEDED : PROBE_FAILED;
+	cm.probe_state = ((probe==true) || gpio_get_latch(pb.probe_input, NULL)) ? PROBE_SUCCEEDED : PROBE_FAILED;
 
     // store the probe results
 	for (uint8_t axis=0; axis<AXES; axis++ ) {
@@ -291,7 +301,7 @@ static void _probe_restore_settings()
 
 	// restore axis jerk
 	for (uint8_t axis=0; axis<AXES; axis++) {
-		cm.a[axis].jerk_max = pb.saved_jerk[axis];
+		cm_set_axis_jerk(axis, pb.saved_jerk[axis]);	// also restores the cached jerk terms
     }
 
 	// restore coordinate system and distance mode
@@ -330,3 +340,384 @@ static stat_t _probing_error_exit(int8_t axis)
 	_probe_restore_settings();
 	return (STAT_PROBE_CYCLE_FAILED);
 }
+
+/*
+ * cm_set_prbi() - set the digital input the probe is wired to, 1-N ($prbi)
+ *
+ *	A probe cycle or scan already running keeps the input it started with.
+ */
+
+stat_t cm_set_prbi(nvObj_t *nv)
+{
+	if ((nv->value < 1) || (nv->value > DI_CHANNELS)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	return (set_ui8(nv));
+}
+
+#ifdef __HEIGHT_MAP
+/***********************************************************************************
+ **** Height Map Grid ***************************************************************
+ ***********************************************************************************/
+
+/****************************************************************************************
+ * cm_height_map_start()	- probe the height map grid ({"mshp":1})
+ * cm_height_map_callback()	- main loop callback for running the grid
+ *
+ *	Runs a G38.2 at each of the $mshnx by $mshny grid points, at the modal feed rate, and
+ *	traverses between them at the clearance Z ($mshcl). All of it is in machine coordinates.
+ *	Rows are probed in alternating directions. The grid only queues the moves between the
+ *	probes. Each probe is run by the G38.2 cycle above, which reports it as usual ({"prb":..}),
+ *	and the grid picks up once that cycle is done. A probe that does not trigger ends the grid
+ *	and leaves the map empty. The map is applied once the probe is back at clearance after
+ *	the last point - see kn_height_map_load() - and the grid ends with {"msh":{"n":..}}.
+ */
+
+struct pbGridSingleton {						// persistent height map grid variables
+	stat_t (*func)();							// binding for callback function state machine, NULL if not running
+	uint16_t index;								// point being probed
+	bool failed;								// a probe did not trigger
+
+	// state saved from gcode model
+	uint8_t saved_units_mode;					// G20,G21 global setting
+	uint8_t saved_coord_system;					// G54 - G59 setting
+	uint8_t saved_distance_mode;				// G90,G91 global setting
+};
+static struct pbGridSingleton grid;
+
+static stat_t _grid_rise();
+static stat_t _grid_move();
+static stat_t _grid_probe();
+static stat_t _grid_record();
+static stat_t _grid_finish();
+
+static stat_t _set_grid_func(stat_t (*func)())
+{
+	grid.func = func;
+	return (STAT_EAGAIN);
+}
+
+static uint16_t _grid_points()
+{
+	return ((uint16_t)kn.map.nx * kn.map.ny);
+}
+
+static void _grid_get_point(uint16_t index, uint8_t *i, uint8_t *j)
+{
+	*j = index / kn.map.nx;
+	*i = index % kn.map.nx;
+	if (*j & 1) {
+		*i = kn.map.nx - 1 - *i;				// serpentine - odd rows run back
+	}
+}
+
+stat_t cm_height_map_start()
+{
+	if ((grid.func != NULL) || (cm.cycle_state != CYCLE_OFF) || (cm.hold_state != FEEDHOLD_OFF)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	if ((cm.gm.feed_rate_mode != UNITS_PER_MINUTE_MODE) || fp_ZERO(cm.gm.feed_rate)) {
+		return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
+	}
+	if (kn.map.clear_z < kn.map.probe_z + MINIMUM_PROBE_TRAVEL) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	kn_height_map_clear();						// the grid is probed without compensation
+
+	grid.saved_units_mode = cm_get_units_mode(ACTIVE_MODEL);
+	grid.saved_coord_system = cm_get_coord_system(ACTIVE_MODEL);
+	grid.saved_distance_mode = cm_get_distance_mode(ACTIVE_MODEL);
+	cm_set_units_mode(MILLIMETERS);
+	cm_set_distance_mode(ABSOLUTE_MODE);
+	cm_set_coord_system(ABSOLUTE_COORDS);		// the grid is in machine coordinates
+
+	grid.index = 0;
+	grid.failed = false;
+	grid.func = _grid_rise;
+	cm_set_cycle_callback(cm_height_map_callback);
+	return (STAT_OK);
+}
+
+stat_t cm_height_map_callback(void)
+{
+	if (grid.func == NULL) {
+		return (STAT_NOOP);						// exit if not running the grid
+	}
+	if ((cm.machine_state == MACHINE_ALARM) || (cm.machine_state == MACHINE_SHUTDOWN) ||
+		(cm.machine_state == MACHINE_PANIC)) {
+		grid.failed = true;						// abandon the grid, no more moves
+		return (_grid_finish());
+	}
+	if ((cm.cycle_state == CYCLE_PROBE) || (cm.probe_state == PROBE_WAITING)) {
+		return (STAT_NOOP);						// the G38.2 cycle is running this point
+	}
+	if (cm_get_runtime_busy()) return (STAT_EAGAIN);	// sync to planner move ends
+	return (grid.func());
+}
+
+/*
+ * _grid_traverse() - traverse in machine coordinates, leaving axes not given where they are
+ * _grid_rise()		- up to the clearance Z
+ * _grid_move()		- over the next point
+ * _grid_probe()	- G38.2 down to the probe Z
+ * _grid_record()	- store the contact Z
+ * _grid_finish()	- apply the map, report it and restore the Gcode model
+ */
+
+static void _grid_traverse(float x, float y, float z, bool xy)
+{
+	float target[AXES];
+	bool flags[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		target[axis] = cm_get_absolute_position(ACTIVE_MODEL, axis);
+		flags[axis] = false;
+	}
+	if (xy) {
+		target[AXIS_X] = x; flags[AXIS_X] = true;
+		target[AXIS_Y] = y; flags[AXIS_Y] = true;
+	} else {
+		target[AXIS_Z] = z; flags[AXIS_Z] = true;
+	}
+	uint8_t motion_mode = cm.gm.motion_mode;	// don't leave G0 as the modal motion
+	cm_straight_traverse(target, flags);
+	cm.gm.motion_mode = motion_mode;
+}
+
+static stat_t _grid_rise()
+{
+	_grid_traverse(0, 0, kn.map.clear_z, false);
+	if (grid.failed || (grid.index >= _grid_points())) {
+		return (_set_grid_func(_grid_finish));
+	}
+	return (_set_grid_func(_grid_move));
+}
+
+static stat_t _grid_move()
+{
+	uint8_t i, j;
+	_grid_get_point(grid.index, &i, &j);
+	_grid_traverse(kn.map.x + i * kn.map.dx, kn.map.y + j * kn.map.dy, 0, true);
+	return (_set_grid_func(_grid_probe));
+}
+
+static stat_t _grid_probe()
+{
+	float target[AXES];
+	bool flags[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		target[axis] = cm_get_absolute_position(ACTIVE_MODEL, axis);
+		flags[axis] = false;
+	}
+	target[AXIS_Z] = kn.map.probe_z;
+	flags[AXIS_Z] = true;
+	if (cm_straight_probe(target, flags) != STAT_OK) {
+		grid.failed = true;
+		return (_set_grid_func(_grid_rise));
+	}
+	return (_set_grid_func(_grid_record));
+}
+
+static stat_t _grid_record()
+{
+	if (cm.probe_state != PROBE_SUCCEEDED) {
+		grid.failed = true;
+	} else {
+		uint8_t i, j;
+		_grid_get_point(grid.index, &i, &j);
+		kn_height_map_set_point(i, j, cm.probe_results[AXIS_Z]);
+		grid.index++;
+	}
+	return (_set_grid_func(_grid_rise));
+}
+
+static stat_t _grid_finish()
+{
+	grid.func = NULL;
+	cm_set_coord_system(grid.saved_coord_system);
+	cm_set_distance_mode(grid.saved_distance_mode);
+	cm_set_units_mode(grid.saved_units_mode);
+
+	if (grid.failed) {
+		nv_reset_nv_list();
+		char msg[NV_MESSAGE_LEN];
+		sprintf_P(msg, PSTR("Height map failed at point %d"), (int)grid.index);
+		nv_add_conditional_message(msg);
+		nv_print_list(STAT_PROBE_CYCLE_FAILED, TEXT_INLINE_VALUES, JSON_RESPONSE_FORMAT);
+		return (STAT_PROBE_CYCLE_FAILED);
+	}
+	kn_height_map_load();
+
+	float z_min = 0, z_max = 0;
+	for (uint8_t j=0; j<kn.map.ny; j++) {
+		for (uint8_t i=0; i<kn.map.nx; i++) {
+			z_min = min(z_min, kn.map.z[j][i]);
+			z_max = max(z_max, kn.map.z[j][i]);
+		}
+	}
+	printf_P(PSTR("{\"msh\":{\"n\":%i,\"min\":%0.3f,\"max\":%0.3f}}\n"), (int)kn.map.points, z_min, z_max);
+	return (STAT_OK);
+}
+#endif // __HEIGHT_MAP
+
+#ifdef __PROBE_SCAN
+/***********************************************************************************
+ **** Scanning Probe ****************************************************************
+ ***********************************************************************************/
+
+/****************************************************************************************
+ * cm_set_scan()			 - SET 1 to clear the points and start recording, 0 to stop ({"scan":n})
+ * cm_get_scan()			 - GET the points recorded since the scan started
+ * cm_probe_scan_point()	 - record an edge of the probe input - called from its interrupt
+ * cm_probe_scan_callback()	 - main loop callback to send the recorded points as binary frames
+ *
+ *	Digitizing with G38.2 costs every point a probe cycle - plan to a stop, back off, report
+ *	and restore - so a surface takes about a second a point. A scan doesn't stop. The program
+ *	runs an ordinary raster of G0/G1 moves over the part, and every edge of the probe input,
+ *	contact and release, takes the motor positions in the input interrupt the way a G38.2
+ *	contact does. The points wait in a RAM ring; the main loop turns them into machine
+ *	positions with the forward kinematics and sends them in 'Z' frames of xio.h, on the
+ *	data-only channel if there is one and on the control channel if not. The input's lockout
+ *	($diNlo) sets the closest two edges can be, so keep it short for a dense scan.
+ *
+ *	The payload is the count of points dropped to a full ring since the start (uint32) and
+ *	up to PROBE_SCAN_BATCH of these, oldest first, little endian:
+ *
+ *	  uint32  time		- SysTick microseconds at the edge
+ *	  uint32  line		- runtime Gcode line number
+ *	  float	  x, y, z	- machine position at the edge, mm
+ *	  uint8	  contact	- 1 for a contact (leading edge), 0 for a release
+ *	  uint8	  spare[3]
+ *
+ *	A frame goes when PROBE_SCAN_BATCH points are waiting or when any have waited
+ *	PROBE_SCAN_FLUSH_MS, and only when the write queue has room. Frames are numbered from 0
+ *	in seq. {"scan":1} takes effect at once - send it before the raster and {"scan":0} when
+ *	the raster has run. A G38.x run while scanning has the input to itself until it ends.
+ *
+ *	The input interrupt is the only writer of the ring head and the main loop the only
+ *	writer of the tail.
+ */
+
+typedef struct pbScanPoint {					// one edge, as the interrupt took it
+	float steps[MOTORS];
+	uint32_t usec;
+	uint32_t linenum;
+	bool contact;
+} pbScanPoint_t;
+
+typedef struct pbScanRecord {					// one edge as sent - see above
+	uint32_t usec;
+	uint32_t linenum;
+	float position[3];
+	uint8_t contact;
+	uint8_t spare[3];
+} pbScanRecord_t;
+
+#define PROBE_SCAN_FRAME_TYPE 'Z'
+
+static struct pbScanSingleton {
+	volatile bool enabled;
+	uint8_t input;								// probe input the scan armed, 1-N
+	volatile uint16_t head;						// next point to write - written by the interrupt only
+	volatile uint16_t tail;						// next point to send - written by the main loop only
+	volatile uint32_t dropped;					// points lost to a full ring
+	volatile uint32_t points;					// points recorded since the start
+	uint8_t seq;								// sequence number of the next frame
+	uint32_t waiting_since;						// systick when points were first seen waiting
+	pbScanPoint_t point[PROBE_SCAN_POINTS];
+} scan;
+
+stat_t cm_set_scan(nvObj_t *nv)
+{
+	if (nv->value > 0) {
+		scan.enabled = false;
+		scan.tail = scan.head;					// drop anything not yet sent
+		scan.dropped = 0;
+		scan.points = 0;
+		scan.seq = 0;
+		scan.waiting_since = 0;
+		gpio_set_scan_mode(scan.input, false);	// a rescan may be on another input
+		scan.input = cm.probe_input;
+		scan.enabled = true;
+		gpio_set_scan_mode(scan.input, true);
+	} else {
+		gpio_set_scan_mode(scan.input, false);
+		scan.enabled = false;					// points already taken still go out
+	}
+	return (cm_get_scan(nv));
+}
+
+stat_t cm_get_scan(nvObj_t *nv)
+{
+	nv->value = scan.points;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+void cm_probe_scan_point(const bool contact)
+{
+	if (!scan.enabled) {
+		return;
+	}
+	uint16_t next = (scan.head + 1) % PROBE_SCAN_POINTS;
+	if (next == scan.tail) {
+		scan.dropped++;							// the host is not keeping up
+		return;
+	}
+	pbScanPoint_t *p = &scan.point[scan.head];
+	en_take_encoder_snapshot();
+	copy_vector(p->steps, en_get_encoder_snapshot_vector());
+	p->usec = SysTickTimer_getMicros();
+	p->linenum = mr.gm.linenum;
+	p->contact = contact;
+	scan.head = next;
+	scan.points++;
+}
+
+stat_t cm_probe_scan_callback()
+{
+	uint8_t frame[XIO_FRAME_HEADER_LEN + sizeof(uint32_t) + PROBE_SCAN_BATCH * sizeof(pbScanRecord_t) + XIO_FRAME_CRC_LEN];
+
+	uint16_t tail = scan.tail;
+	uint16_t waiting = (scan.head + PROBE_SCAN_POINTS - tail) % PROBE_SCAN_POINTS;
+	if (waiting == 0) {
+		scan.waiting_since = 0;
+		return (STAT_NOOP);
+	}
+	uint32_t now = SysTickTimer_getValue();
+	if (scan.waiting_since == 0) {
+		scan.waiting_since = now;
+	}
+	if ((waiting < PROBE_SCAN_BATCH) && ((now - scan.waiting_since) < PROBE_SCAN_FLUSH_MS)) {
+		return (STAT_NOOP);
+	}
+	if (min(xio_tx_space(), xio_tx_space_data()) < sizeof(frame)) {
+		return (STAT_NOOP);						// try again next pass
+	}
+	uint8_t points = min(waiting, (uint16_t)PROBE_SCAN_BATCH);
+	uint8_t *wr = &frame[XIO_FRAME_PAYLOAD];
+	uint32_t dropped = scan.dropped;
+	memcpy(wr, &dropped, sizeof(dropped));
+	wr += sizeof(dropped);
+
+	for (uint8_t i=0; i<points; i++) {
+		pbScanPoint_t *p = &scan.point[tail];
+		float position[AXES];
+		pbScanRecord_t r;
+		kn_forward_kinematics(p->steps, position);
+		r.usec = p->usec;
+		r.linenum = p->linenum;
+		r.position[0] = position[AXIS_X];
+		r.position[1] = position[AXIS_Y];
+		r.position[2] = position[AXIS_Z];
+		r.contact = p->contact;
+		r.spare[0] = r.spare[1] = r.spare[2] = 0;
+		memcpy(wr, &r, sizeof(r));				// frame records are not aligned
+		wr += sizeof(r);
+		tail = (tail + 1) % PROBE_SCAN_POINTS;
+	}
+	scan.tail = tail;							// the interrupt can reuse them now
+	scan.waiting_since = 0;
+	rpt_send_data_frame(frame, PROBE_SCAN_FRAME_TYPE, scan.seq++, wr - &frame[XIO_FRAME_PAYLOAD]);
+	return (STAT_OK);
+}
+#endif // __PROBE_SCAN
@@ -29,11 +29,71 @@
 #include "config.h"
 #include "encoder.h"
 #include "canonical_machine.h"  // needed for cm_panic() in assertions
+#ifdef ENCODER_QUADRATURE
+#include "hardware.h"
+#endif
 
 /**** Allocate Structures ****/
 
 enEncoders_t en;
 
+/*
+ * Quadrature decoders
+ *
+ *	The SAM3X TC blocks decode quadrature on channel 0. TC1 holds the dwell, load and exec
+ *	timers (hardware.h), which leaves TC0 and TC2 - two decoders. The DDA timer is channel 2
+ *	of TC0 and doesn't get in the way. The phase pins are fixed to the block, and on the
+ *	gShield they are motor 1 and 3 step and direction, so real encoders need a board that
+ *	brings those pins out. A decoder whose ENCODER_n_MOTOR is -1 leaves its pins alone.
+ *
+ *	The count is read when the segment is loaded (HI interrupt), in place of adding up the
+ *	steps the DDA put out, so encoder_steps is the measured position at the end of the
+ *	segment that just finished. The following error correction in st_prep_line() then acts
+ *	on lost steps and lag instead of just float error.
+ */
+#ifdef ENCODER_QUADRATURE
+
+using namespace Motate;
+
+#define DECODERS 2
+static const int8_t decoder_motor[DECODERS] = { ENCODER_1_MOTOR, ENCODER_2_MOTOR };
+
+static Timer<0> decoder_1;									// TC0 channel 0
+static Timer<6> decoder_2;									// TC2 channel 0
+static Pin<ENCODER_1_PHASE_A_PIN> decoder_1_a;
+static Pin<ENCODER_1_PHASE_B_PIN> decoder_1_b;
+static Pin<ENCODER_2_PHASE_A_PIN> decoder_2_a;
+static Pin<ENCODER_2_PHASE_B_PIN> decoder_2_b;
+
+static void _init_decoders()
+{
+	for (uint8_t m=0; m<MOTORS; m++) {
+		en.en[m].decoder = -1;
+	}
+	if ((decoder_motor[0] >= 0) && (decoder_motor[0] < MOTORS)) {
+		decoder_1_a.setMode(kPeripheralB);
+		decoder_1_b.setMode(kPeripheralB);
+		decoder_1.setQuadratureDecoder(ENCODER_FILTER);
+		decoder_1.start();
+		en.en[decoder_motor[0]].decoder = 0;
+	}
+	if ((decoder_motor[1] >= 0) && (decoder_motor[1] < MOTORS)) {
+		decoder_2_a.setMode(kPeripheralB);
+		decoder_2_b.setMode(kPeripheralB);
+		decoder_2.setQuadratureDecoder(ENCODER_FILTER);
+		decoder_2.start();
+		en.en[decoder_motor[1]].decoder = 1;
+	}
+}
+
+static float _read_decoder_steps(const enEncoder_t *e)
+{
+	int32_t count = (e->decoder == 0) ? decoder_1.getQuadraturePosition() : decoder_2.getQuadraturePosition();
+	return ((float)count * ENCODER_STEPS_PER_COUNT + e->steps_offset);
+}
+
+#endif // ENCODER_QUADRATURE
+
 /************************************************************************************
  **** CODE **************************************************************************
  ************************************************************************************/
@@ -46,6 +106,9 @@ enEncoders_t en;
 void encoder_init()
 {
 	memset(&en, 0, sizeof(en));		// clear all values, pointers and status
+#ifdef ENCODER_QUADRATURE
+	_init_decoders();
+#endif
 	encoder_init_assertions();
 }
 
@@ -78,13 +141,44 @@ stat_t encoder_test_assertions()
  *	Sets the encoder_position steps. Takes floating point steps as input,
  *	writes integer steps. So it's not an exact representation of machine
  *	position except if the machine is at zero.
+ *
+ *	deviation is the number of steps the motor is intentionally away from the commanded
+ *	steps (backlash take-up and step offsets). It is kept in the encoder so the following
+ *	error stays at that deviation across the reset.
  */
 
-void en_set_encoder_steps(uint8_t motor, float steps)
+void en_set_encoder_steps(uint8_t motor, float steps, float deviation)
 {
-	en.en[motor].encoder_steps = (int32_t)round(steps);
+	en.en[motor].encoder_steps = (int32_t)round(steps + deviation);
+	en.en[motor].commanded_steps = steps;
+	en.en[motor].loaded_steps = steps;
+#ifdef ENCODER_QUADRATURE
+	if (en.en[motor].decoder >= 0) {			// measure from here on
+		en.en[motor].steps_offset = 0;
+		en.en[motor].steps_offset = (steps + deviation) - _read_decoder_steps(&en.en[motor]);
+	}
+#endif
 }
 
+/*
+ * en_accumulate_encoder() - latch the encoder position for the segment just finished
+ *
+ *	Called by the loader through ACCUMULATE_ENCODER() if built with ENCODER_QUADRATURE.
+ *	Decoded motors take the decoder count, the others add up their counted steps.
+ */
+#ifdef ENCODER_QUADRATURE
+void en_accumulate_encoder(const uint8_t motor)
+{
+	enEncoder_t *e = &en.en[motor];
+	if (e->decoder >= 0) {
+		e->encoder_steps = (int32_t)round(_read_decoder_steps(e));
+	} else {
+		e->encoder_steps += e->steps_run;
+	}
+	e->steps_run = 0;
+}
+#endif
+
 /*
  * en_read_encoder()
  *
@@ -100,6 +194,28 @@ float en_read_encoder(uint8_t motor)
 	return((float)en.en[motor].encoder_steps);
 }
 
+/*
+ * en_read_encoder_alignment() - read encoder steps and the commanded steps they align with
+ *
+ *	The commanded steps travel through the stepper prep buffers with their segment, and are
+ *	latched at the same load that accumulates the steps run by that segment. So the pair is
+ *	time aligned however far exec is running ahead of the loader. The loader can preempt
+ *	the caller, so both are read with interrupts off.
+ */
+
+void en_read_encoder_alignment(uint8_t motor, float *encoder_steps, float *commanded_steps)
+{
+#ifdef __ARM
+	__disable_irq();
+#endif
+	int32_t steps = en.en[motor].encoder_steps;
+	*commanded_steps = en.en[motor].commanded_steps;
+#ifdef __ARM
+	__enable_irq();
+#endif
+	*encoder_steps = (float)steps;
+}
+
 /*
  * en_take_encoder_snapshot()
  * en_get_encoder_snapshot_position()
@@ -113,10 +229,20 @@ float en_read_encoder(uint8_t motor)
  *  The results are in STEPS, which may need to be converted back to position using 
  *  forward kinematics, depending on your use. See probe cycle for example.
  */
+static float _get_snapshot_steps(const uint8_t motor)
+{
+#ifdef ENCODER_QUADRATURE
+    if (en.en[motor].decoder >= 0) {
+        return (_read_decoder_steps(&en.en[motor]));    // measured right now
+    }
+#endif
+    return (en.en[motor].encoder_steps + en.en[motor].steps_run);
+}
+
 void en_take_encoder_snapshot()
 {
     for (uint8_t m=0; m<MOTORS; m++) {
-        en.snapshot[m] = en.en[m].encoder_steps + en.en[m].steps_run;
+        en.snapshot[m] = _get_snapshot_steps(m);
     }
 
 /* loop unrolled version for faster execution
@@ -129,6 +255,17 @@ void en_take_encoder_snapshot()
 */
 }
 
+/*
+ * en_take_motor_snapshot() - snapshot a single motor, leaving the others as they were
+ *
+ *	Slaved motors latch on their own switches while squaring a gantry, so each one's
+ *	entry in the snapshot vector is taken by its own switch closure.
+ */
+void en_take_motor_snapshot(uint8_t motor)
+{
+    en.snapshot[motor] = _get_snapshot_steps(motor);
+}
+
 float en_get_encoder_snapshot_steps(uint8_t motor)
 {
     return (en.snapshot[motor]);
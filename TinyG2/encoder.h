@@ -27,10 +27,10 @@
 /*
  * ENCODERS
  *
- *	Calling this file "encoders" is kind of a lie, at least for now. There are no encoders.
- *	Instead the steppers count steps to provide a "truth" reference for position. In the
- *	future when we have real encoders we'll stop counting steps and actually measure the
- *	position. Which should be a lot easier than how this module currently works.
+ *	Most builds have no encoders. Instead the steppers count steps to provide a "truth"
+ *	reference for position. Built with ENCODER_QUADRATURE, up to two motors are measured by
+ *	the SAM3X timer quadrature decoders instead - see encoder.cpp. Either way the reading is
+ *	latched when a segment is loaded, so the rest of this module doesn't care which it is.
  *
  *	*** Measuring position ***
  *
@@ -74,6 +74,10 @@
  *	for most jobs. For jobs that run > 1 hour the errors can accumulate and send
  *	results off by as much as a millimeter if not corrected.
  *
+ *	The exec snaps the runtime position to the move target at the end of each move (the
+ *	waypoint of the last section), so float error from segment integration no longer carries from one
+ *	move to the next. What remains is bounded by float resolution at the machine's extents.
+ *
  *	Note: Going to doubles (from floats) would reduce the errors but not eliminate
  *	them altogether. But this moot on AVRGCC which only does single precision floats.
  *
@@ -90,12 +94,48 @@
 
 /**** Configs and Constants ****/
 
+/* Quadrature encoders - only with ENCODER_QUADRATURE
+ *	ENCODER_n_MOTOR is the motor decoder n reads, or -1 if it's not used. Decoder 1 is TC0,
+ *	decoder 2 is TC2. Their phase A and B inputs are fixed to the TIOA and TIOB pins of the
+ *	block, given here as Motate pin numbers for the board.
+ *	ENCODER_STEPS_PER_COUNT scales encoder counts (4 per line) to motor steps. It's negative
+ *	if the encoder counts up when the motor steps down.
+ *	ENCODER_FILTER drops glitches shorter than this many master clock periods (0..63).
+ */
+#ifdef ENCODER_QUADRATURE
+#ifndef ENCODER_1_MOTOR
+#define ENCODER_1_MOTOR				MOTOR_1
+#endif
+#ifndef ENCODER_1_PHASE_A_PIN
+#define ENCODER_1_PHASE_A_PIN		2			// TIOA0 (PB25) on the Due
+#define ENCODER_1_PHASE_B_PIN		13			// TIOB0 (PB27)
+#endif
+#ifndef ENCODER_2_MOTOR
+#define ENCODER_2_MOTOR				-1
+#endif
+#ifndef ENCODER_2_PHASE_A_PIN
+#define ENCODER_2_PHASE_A_PIN		5			// TIOA6 (PC25) on the Due
+#define ENCODER_2_PHASE_B_PIN		4			// TIOB6 (PC26)
+#endif
+#ifndef ENCODER_STEPS_PER_COUNT
+#define ENCODER_STEPS_PER_COUNT		((float)1.0)
+#endif
+#ifndef ENCODER_FILTER
+#define ENCODER_FILTER				8
+#endif
+#endif // ENCODER_QUADRATURE
+
 /**** Macros ****/
 // used to abstract the encoder code out of the stepper so it can be managed in one place
 
 #define SET_ENCODER_STEP_SIGN(m,s)	en.en[m].step_sign = s;
 #define INCREMENT_ENCODER(m)		en.en[m].steps_run += en.en[m].step_sign;
+#ifdef ENCODER_QUADRATURE
+#define ACCUMULATE_ENCODER(m)		en_accumulate_encoder(m);
+#else
 #define ACCUMULATE_ENCODER(m)		en.en[m].encoder_steps += en.en[m].steps_run; en.en[m].steps_run = 0;
+#endif
+#define ALIGN_ENCODER(m,t)			en.en[m].commanded_steps = en.en[m].loaded_steps; en.en[m].loaded_steps = t;
 
 /**** Structures ****/
 
@@ -103,6 +143,12 @@ typedef struct enEncoder { 			// one real or virtual encoder per controlled moto
 	int8_t  step_sign;				// set to +1 or -1
 	int16_t steps_run;				// + or - steps counted during stepper interrupt
 	int32_t encoder_steps;			// counted encoder position	in steps
+	float commanded_steps;			// commanded position the encoder_steps align with (set at load)
+	float loaded_steps;				// commanded position at the end of the segment now running
+#ifdef ENCODER_QUADRATURE
+	int8_t decoder;					// quadrature decoder measuring the motor, -1 if steps are counted
+	float steps_offset;				// encoder steps at a decoder count of zero
+#endif
 } enEncoder_t;
 
 typedef struct enEncoders {
@@ -122,10 +168,13 @@ void encoder_reset(void);
 void encoder_init_assertions(void);
 stat_t encoder_test_assertions(void);
 
-void en_set_encoder_steps(uint8_t motor, float steps);
+void en_set_encoder_steps(uint8_t motor, float steps, float deviation);
+void en_accumulate_encoder(const uint8_t motor);
 float en_read_encoder(uint8_t motor);
+void en_read_encoder_alignment(uint8_t motor, float *encoder_steps, float *commanded_steps);
 
 void en_take_encoder_snapshot();
+void en_take_motor_snapshot(uint8_t motor);
 float en_get_encoder_snapshot_steps(uint8_t motor);
 float *en_get_encoder_snapshot_vector();
 
@@ -197,10 +197,10 @@ char *get_status_message(stat_t status);
 #define	STAT_JSON_TOO_LONG 110					// JSON output exceeds buffer size
 #define	STAT_CONFIG_NOT_TAKEN 111				// configuration value not taken while in machining cycle
 #define	STAT_COMMAND_NOT_ACCEPTED 112			// command cannot be accepted at this time
+#define	STAT_FRAME_CRC_ERROR 113				// binary data frame failed its CRC check
+#define	STAT_LINE_CHECKSUM_ERROR 114			// checked input line failed its CRC check
+#define	STAT_LINE_NUMBER_OUT_OF_SEQUENCE 115	// checked input line is not the next one expected
 /*
-#define	STAT_ERROR_113 113
-#define	STAT_ERROR_114 114
-#define	STAT_ERROR_115 115
 #define	STAT_ERROR_116 116
 #define	STAT_ERROR_117 117
 #define	STAT_ERROR_118 118
@@ -277,14 +277,15 @@ char *get_status_message(stat_t status);
 
 #define STAT_T_WORD_IS_MISSING 180
 #define STAT_T_WORD_IS_INVALID 181
+#define STAT_K_WORD_IS_MISSING 182						// G33 and G33.1 need a K word (pitch)
+#define STAT_K_WORD_IS_INVALID 183
+#define STAT_SPINDLE_INDEX_NOT_CONFIGURED 184			// synchronized motion needs an input set to spindle index
+#define STAT_SPINDLE_SYNC_LOST 185						// the spindle index stopped during a synchronized move
+#define STAT_SPINDLE_OVERLOADED 186						// spindle load stayed high with the adaptive feed at its minimum
+#define STAT_OUTPUT_EVENTS_FULL 187						// too many M62/M63 events waiting for the path to reach them
 
 /* reserved for Gcode or other program errors
 
-#define	STAT_ERROR_183 183
-#define	STAT_ERROR_184 184
-#define	STAT_ERROR_185 185
-#define	STAT_ERROR_186 186
-#define	STAT_ERROR_187 187
 #define	STAT_ERROR_188 188
 #define	STAT_ERROR_189 189
 
@@ -309,8 +310,8 @@ char *get_status_message(stat_t status);
 #define	STAT_COMMAND_REJECTED_BY_SHUTDOWN 205           // command was not processed because machine is shutdown
 #define	STAT_COMMAND_REJECTED_BY_PANIC 206              // command was not processed because machine is paniced
 #define	STAT_KILL_JOB 207                               // ^d received (job kill)
+#define	STAT_FOLLOWING_ERROR_EXCEEDED 208				// a motor's following error passed its alarm limit
 /*
-#define	STAT_ERROR_208 208
 #define	STAT_ERROR_209 209
 
 #define	STAT_ERROR_210 210
@@ -355,7 +356,7 @@ char *get_status_message(stat_t status);
 #define	STAT_HOMING_ERROR_NEGATIVE_LATCH_BACKOFF 245
 #define	STAT_HOMING_ERROR_HOMING_INPUT_MISCONFIGURED 246
 #define	STAT_HOMING_ERROR_MUST_CLEAR_SWITCHES_BEFORE_HOMING 247
-#define	STAT_ERROR_248 248
+#define	STAT_HOMING_ERROR_SLAVED_MOTOR_NOT_LATCHED 248
 #define	STAT_ERROR_249 249
 
 #define	STAT_PROBE_CYCLE_FAILED 250						// probing cycle did not complete
@@ -494,9 +495,9 @@ static const char stat_109[] PROGMEM = "JSON input has too many pairs";
 static const char stat_110[] PROGMEM = "JSON output too long";
 static const char stat_111[] PROGMEM = "Config not taken during cycle";
 static const char stat_112[] PROGMEM = "Command cannot be taken at this time";
-static const char stat_113[] PROGMEM = "113";
-static const char stat_114[] PROGMEM = "114";
-static const char stat_115[] PROGMEM = "115";
+static const char stat_113[] PROGMEM = "Binary frame CRC error";
+static const char stat_114[] PROGMEM = "Line checksum error";
+static const char stat_115[] PROGMEM = "Line number out of sequence";
 static const char stat_116[] PROGMEM = "116";
 static const char stat_117[] PROGMEM = "117";
 static const char stat_118[] PROGMEM = "118";
@@ -571,12 +572,12 @@ static const char stat_179[] PROGMEM = "S word invalid";
 
 static const char stat_180[] PROGMEM = "T word missing";
 static const char stat_181[] PROGMEM = "T word invalid";
-static const char stat_182[] PROGMEM = "182";
-static const char stat_183[] PROGMEM = "183";
-static const char stat_184[] PROGMEM = "184";
-static const char stat_185[] PROGMEM = "185";
-static const char stat_186[] PROGMEM = "186";
-static const char stat_187[] PROGMEM = "187";
+static const char stat_182[] PROGMEM = "K word missing";
+static const char stat_183[] PROGMEM = "K word invalid";
+static const char stat_184[] PROGMEM = "Spindle index input not configured";
+static const char stat_185[] PROGMEM = "Spindle index lost during synchronized move";
+static const char stat_186[] PROGMEM = "Spindle overloaded at minimum adaptive feed";
+static const char stat_187[] PROGMEM = "Too many synchronized output events pending";
 static const char stat_188[] PROGMEM = "188";
 static const char stat_189[] PROGMEM = "189";
 
@@ -600,7 +601,7 @@ static const char stat_204[] PROGMEM = "Command rejected by ALARM [$clear to res
 static const char stat_205[] PROGMEM = "Command rejected by SHUTDOWN [$clear to reset]";
 static const char stat_206[] PROGMEM = "Command rejected by PANIC [^x to reset]";
 static const char stat_207[] PROGMEM = "Kill job";
-static const char stat_208[] PROGMEM = "208";
+static const char stat_208[] PROGMEM = "Following error exceeded [$clear to reset]";
 static const char stat_209[] PROGMEM = "209";
 
 static const char stat_210[] PROGMEM = "210";
@@ -643,7 +644,7 @@ static const char stat_244[] PROGMEM = "Homing Err - Travel min & max are the sa
 static const char stat_245[] PROGMEM = "245";
 static const char stat_246[] PROGMEM = "Homing Err - Homing input is misconfigured";
 static const char stat_247[] PROGMEM = "Homing Err - Must clear switches before homing";
-static const char stat_248[] PROGMEM = "248";
+static const char stat_248[] PROGMEM = "Homing Err - Slaved motor switch not found";
 static const char stat_249[] PROGMEM = "249";
 
 static const char stat_250[] PROGMEM = "Probe cycle failed";
@@ -0,0 +1,421 @@
+/*
+ * ethernet.cpp - WIZnet W5500 TCP/IP controller for the xio ethernet channel
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ * Copyright (c) 2015 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The W5500 runs the TCP/IP stack itself - this module only moves bytes between its socket
+ * buffers and the caller, and opens, closes and watches the sockets. All of it runs from the
+ * main loop. ETH_SOCKETS sockets listen on the same port, so that many clients can be connected
+ * at once; the chip's 16K of receive and 16K of transmit memory is split between them.
+ *
+ * Every access is one SPI frame with the chip select held: a 16 bit address, a control byte
+ * (block and direction) and the data. The header goes out through the Motate SPI template,
+ * which also sets up the clock and the chip select. The data of a frame is DMA'd by the DMAC
+ * (the SAM3X SPI has no PDC), which keeps the bus streaming - byte by byte the SPI sits idle
+ * between bytes longer than it takes to send one. The last byte goes back through the template
+ * to release the chip select. The DMAC channels are the ones the SPI slave channel uses, which
+ * can't be built with this one.
+ *
+ * The settings ($ethad, $ethgw, $ethmk, $ethpt) are applied by eth_poll() the next time round
+ * the main loop. That drops every connection, including the one the change came in on.
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "hardware.h"
+#include "xio.h"					// MotateSPI.h
+#include "ethernet.h"
+#include "util.h"
+
+#ifdef __ETHERNET_CHANNEL
+
+#if (ETH_SOCKETS != 1) && (ETH_SOCKETS != 2) && (ETH_SOCKETS != 4) && (ETH_SOCKETS != 8)
+#error ETH_SOCKETS must be 1, 2, 4 or 8 - the W5500 socket memory only splits that way
+#endif
+#ifndef ETH_SPI_CS_PIN
+#error ETH_SPI_CS_PIN is not set for this board - give it a spare SPI0 NPCS pin in the Makefile
+#endif
+
+using namespace Motate;
+
+ethSingleton_t eth;
+static SPI<ETH_SPI_CS_PIN> eth_spi(ETH_SPI_BAUD);
+static bool eth_sending[ETH_SOCKETS];		// a SEND is in progress on the socket
+static uint32_t eth_next_poll;
+
+// Blocks (control byte bits 7-3)
+#define W5500_COMMON		0x00
+#define W5500_SREG(s)		((uint8_t)((s)*4 + 1))	// socket registers
+#define W5500_STX(s)		((uint8_t)((s)*4 + 2))	// socket transmit buffer
+#define W5500_SRX(s)		((uint8_t)((s)*4 + 3))	// socket receive buffer
+#define W5500_WRITE			0x04
+#define W5500_SOCKETS		8
+
+// Common registers
+#define W5500_MR			0x0000
+#define W5500_GAR			0x0001				// gateway, 4 bytes
+#define W5500_SUBR			0x0005				// subnet mask, 4 bytes
+#define W5500_SHAR			0x0009				// MAC address, 6 bytes
+#define W5500_SIPR			0x000F				// IP address, 4 bytes
+#define W5500_VERSIONR		0x0039
+#define W5500_MR_RST		0x80
+#define W5500_VERSION		0x04
+
+// Socket registers
+#define Sn_MR				0x0000
+#define Sn_CR				0x0001
+#define Sn_IR				0x0002
+#define Sn_SR				0x0003
+#define Sn_PORT				0x0004
+#define Sn_RXBUF_SIZE		0x001E
+#define Sn_TXBUF_SIZE		0x001F
+#define Sn_TX_FSR			0x0020
+#define Sn_TX_WR			0x0024
+#define Sn_RX_RSR			0x0026
+#define Sn_RX_RD			0x0028
+#define Sn_RX_WR			0x002A
+#define Sn_KPALVTR			0x002F
+
+#define Sn_MR_TCP			0x01
+#define Sn_MR_ND			0x20				// no delayed ACK - responses are small and the host waits on them
+#define Sn_CR_OPEN			0x01
+#define Sn_CR_LISTEN		0x02
+#define Sn_CR_DISCON		0x08
+#define Sn_CR_CLOSE			0x10
+#define Sn_CR_SEND			0x20
+#define Sn_CR_RECV			0x40
+#define Sn_IR_SENDOK		0x10
+#define Sn_IR_TIMEOUT		0x08
+
+#define ETH_RESET_TRIES		1000				// register reads waited for a reset or a command to finish
+
+/*
+ * W5500 primitives
+ *
+ *	_bulk() - DMA len bytes out of data (write) or into it (read) with the chip select held
+ *	_frame() - a whole access: header, data, and the last byte to release the chip select
+ */
+
+static inline uint8_t _xfer(uint8_t out) { return ((uint8_t)eth_spi.transfer(out)); }
+
+#ifndef __HOST__
+#define ETH_DMAC_TX_CH		0
+#define ETH_DMAC_RX_CH		1
+#define ETH_DMAC_TX_PER		1					// DMAC hardware interfaces for SPI0
+#define ETH_DMAC_RX_PER		2
+
+static void _bulk(uint8_t *data, const uint16_t len, const bool write)
+{
+	static uint8_t idle;						// sent on reads, and where written bytes read back go
+
+	while (!(SPI0->SPI_SR & SPI_SR_TXEMPTY));
+	(void)SPI0->SPI_RDR;
+	idle = 0;
+
+	DmacCh_num *tx = &DMAC->DMAC_CH_NUM[ETH_DMAC_TX_CH];
+	tx->DMAC_SADDR = (uint32_t)(write ? data : &idle);
+	tx->DMAC_DADDR = (uint32_t)&SPI0->SPI_TDR;
+	tx->DMAC_DSCR = 0;
+	tx->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(len) | DMAC_CTRLA_SRC_WIDTH_BYTE | DMAC_CTRLA_DST_WIDTH_BYTE;
+	tx->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE | DMAC_CTRLB_DST_DSCR_FETCH_DISABLE | DMAC_CTRLB_FC_MEM2PER_DMA_FC |
+					 (write ? DMAC_CTRLB_SRC_INCR_INCREMENTING : DMAC_CTRLB_SRC_INCR_FIXED) | DMAC_CTRLB_DST_INCR_FIXED;
+	tx->DMAC_CFG = DMAC_CFG_DST_PER(ETH_DMAC_TX_PER) | DMAC_CFG_DST_H2SEL | DMAC_CFG_SOD | DMAC_CFG_FIFOCFG_ALAP_CFG;
+
+	DmacCh_num *rx = &DMAC->DMAC_CH_NUM[ETH_DMAC_RX_CH];
+	rx->DMAC_SADDR = (uint32_t)&SPI0->SPI_RDR;
+	rx->DMAC_DADDR = (uint32_t)(write ? &idle : data);
+	rx->DMAC_DSCR = 0;
+	rx->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(len) | DMAC_CTRLA_SRC_WIDTH_BYTE | DMAC_CTRLA_DST_WIDTH_BYTE;
+	rx->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE | DMAC_CTRLB_DST_DSCR_FETCH_DISABLE | DMAC_CTRLB_FC_PER2MEM_DMA_FC |
+					 DMAC_CTRLB_SRC_INCR_FIXED | (write ? DMAC_CTRLB_DST_INCR_FIXED : DMAC_CTRLB_DST_INCR_INCREMENTING);
+	rx->DMAC_CFG = DMAC_CFG_SRC_PER(ETH_DMAC_RX_PER) | DMAC_CFG_SRC_H2SEL | DMAC_CFG_SOD | DMAC_CFG_FIFOCFG_ALAP_CFG;
+
+	DMAC->DMAC_CHER = (DMAC_CHER_ENA0 << ETH_DMAC_TX_CH) | (DMAC_CHER_ENA0 << ETH_DMAC_RX_CH);
+	while (DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 << ETH_DMAC_RX_CH));	// every byte sent has been clocked back in
+}
+#else
+static void _bulk(uint8_t *data, const uint16_t len, const bool write)
+{
+	for (uint16_t i=0; i<len; i++) {
+		uint8_t in = _xfer(write ? data[i] : 0);
+		if (!write) {
+			data[i] = in;
+		}
+	}
+}
+#endif // __HOST__
+
+static void _frame(const uint16_t addr, const uint8_t block, uint8_t *data, const uint16_t len, const bool write)
+{
+	eth_spi.setChannel();
+	_xfer(addr >> 8);
+	_xfer(addr & 0xFF);
+	_xfer((block << 3) | (write ? W5500_WRITE : 0));
+	if (len > 1) {
+		_bulk(data, len-1, write);
+	}
+	uint8_t last = (uint8_t)eth_spi.transfer(write ? data[len-1] : 0, true);
+	if (!write) {
+		data[len-1] = last;
+	}
+}
+
+static uint8_t _read8(const uint16_t addr, const uint8_t block)
+{
+	uint8_t value;
+	_frame(addr, block, &value, 1, false);
+	return (value);
+}
+
+static void _write8(const uint16_t addr, const uint8_t block, uint8_t value)
+{
+	_frame(addr, block, &value, 1, true);
+}
+
+static uint16_t _read16(const uint16_t addr, const uint8_t block)
+{
+	uint8_t b[2];
+	_frame(addr, block, b, 2, false);
+	return ((b[0] << 8) | b[1]);
+}
+
+static void _write16(const uint16_t addr, const uint8_t block, const uint16_t value)
+{
+	uint8_t b[2] = { (uint8_t)(value >> 8), (uint8_t)(value & 0xFF) };
+	_frame(addr, block, b, 2, true);
+}
+
+// _read16_stable() - a count the chip is changing - read it until it reads the same twice
+static uint16_t _read16_stable(const uint16_t addr, const uint8_t block)
+{
+	uint16_t value = _read16(addr, block);
+	for (uint8_t i=0; i<4; i++) {
+		uint16_t again = _read16(addr, block);
+		if (again == value) {
+			break;
+		}
+		value = again;
+	}
+	return (value);
+}
+
+static void _write32(const uint16_t addr, const uint32_t value)
+{
+	uint8_t b[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+	_frame(addr, W5500_COMMON, b, 4, true);
+}
+
+static void _command(const uint8_t s, const uint8_t cmd)
+{
+	_write8(Sn_CR, W5500_SREG(s), cmd);
+	for (uint16_t i=0; (i < ETH_RESET_TRIES) && (_read8(Sn_CR, W5500_SREG(s)) != 0); i++);
+}
+
+/*
+ * eth_init() - reset the W5500 and share out its socket memory. Returns true if one answered.
+ *
+ *	The network settings aren't known yet (config_init() comes after xio_init()), so they are
+ *	applied by eth_poll() later.
+ */
+
+bool eth_init()
+{
+#ifndef __HOST__
+	PMC->PMC_PCER1 = (1u << (ID_DMAC - 32));
+	DMAC->DMAC_EN = DMAC_EN_ENABLE;
+#endif
+	eth_spi.setOptions(ETH_SPI_BAUD, kSPI8Bit | kSPIMode0);
+	_write8(W5500_MR, W5500_COMMON, W5500_MR_RST);
+	for (uint16_t i=0; (i < ETH_RESET_TRIES) && (_read8(W5500_MR, W5500_COMMON) & W5500_MR_RST); i++);
+
+	eth.present = (_read8(W5500_VERSIONR, W5500_COMMON) == W5500_VERSION);
+	if (!eth.present) {
+		return (false);
+	}
+	for (uint8_t s=0; s<W5500_SOCKETS; s++) {
+		uint8_t kb = (s < ETH_SOCKETS) ? ETH_BUFFER_KB : 0;
+		_write8(Sn_RXBUF_SIZE, W5500_SREG(s), kb);
+		_write8(Sn_TXBUF_SIZE, W5500_SREG(s), kb);
+	}
+	eth.changed = true;
+	return (true);
+}
+
+/*
+ * eth_poll() - apply changed settings, and say if it's time to look at the sockets again
+ *
+ *	The MAC address is made from the IP address (02:47 and the 4 octets, locally administered),
+ *	so it is unique on a network where the addresses are. Every socket is closed, and the
+ *	caller reopens them on the new port when it sees them closed.
+ */
+
+bool eth_poll()
+{
+	if (!eth.present) {
+		return (false);
+	}
+	if (eth.changed) {
+		eth.changed = false;
+		uint32_t address = (eth.address != 0) ? eth.address : ETHERNET_ADDRESS;
+		uint8_t mac[6] = { 0x02, 0x47, (uint8_t)(address >> 24), (uint8_t)(address >> 16), (uint8_t)(address >> 8), (uint8_t)address };
+		_frame(W5500_SHAR, W5500_COMMON, mac, 6, true);
+		_write32(W5500_GAR, (eth.gateway != 0) ? eth.gateway : ETHERNET_GATEWAY);
+		_write32(W5500_SUBR, (eth.netmask != 0) ? eth.netmask : ETHERNET_NETMASK);
+		_write32(W5500_SIPR, address);
+		for (uint8_t s=0; s<ETH_SOCKETS; s++) {
+			_command(s, Sn_CR_CLOSE);
+			eth_sending[s] = false;
+		}
+		eth_next_poll = SysTickTimer_getValue();
+	}
+	uint32_t now = SysTickTimer_getValue();
+	if ((int32_t)(now - eth_next_poll) < 0) {
+		return (false);
+	}
+	eth_next_poll = now + ETH_POLL_MS;
+	return (true);
+}
+
+/*
+ * eth_socket_state()	   - the socket's ethSocketState (or a state in between)
+ * eth_socket_listen()	   - (re)open the socket as a server on the port
+ * eth_socket_disconnect() - close the connection gracefully - the client has closed its end
+ */
+
+uint8_t eth_socket_state(const uint8_t s)
+{
+	return (_read8(Sn_SR, W5500_SREG(s)));
+}
+
+void eth_socket_listen(const uint8_t s)
+{
+	_command(s, Sn_CR_CLOSE);
+	_write8(Sn_MR, W5500_SREG(s), Sn_MR_TCP | Sn_MR_ND);
+	_write16(Sn_PORT, W5500_SREG(s), (uint16_t)eth.port);
+	_write8(Sn_KPALVTR, W5500_SREG(s), ETH_KEEPALIVE);
+	_command(s, Sn_CR_OPEN);
+	if (eth_socket_state(s) == ETH_SOCK_INIT) {
+		_command(s, Sn_CR_LISTEN);
+	}
+	eth_sending[s] = false;
+}
+
+void eth_socket_disconnect(const uint8_t s)
+{
+	_command(s, Sn_CR_DISCON);
+}
+
+/*
+ * eth_rx_available() - bytes received on the socket and not read yet
+ * eth_read()		  - read len of them - no more than eth_rx_available() said there were
+ * eth_flush_read()	  - drop them
+ */
+
+uint16_t eth_rx_available(const uint8_t s)
+{
+	return (_read16_stable(Sn_RX_RSR, W5500_SREG(s)));
+}
+
+uint16_t eth_read(const uint8_t s, uint8_t *buf, const uint16_t len)
+{
+	if (len == 0) {
+		return (0);
+	}
+	uint16_t ptr = _read16(Sn_RX_RD, W5500_SREG(s));
+	_frame(ptr, W5500_SRX(s), buf, len, false);		// the chip wraps the pointer in the buffer
+	_write16(Sn_RX_RD, W5500_SREG(s), ptr + len);
+	_command(s, Sn_CR_RECV);
+	return (len);
+}
+
+void eth_flush_read(const uint8_t s)
+{
+	_write16(Sn_RX_RD, W5500_SREG(s), _read16(Sn_RX_WR, W5500_SREG(s)));
+	_command(s, Sn_CR_RECV);
+}
+
+/*
+ * eth_write() - send up to len bytes, without blocking. Returns the bytes taken.
+ *
+ *	One SEND is in flight on a socket at a time - nothing is taken until the last one is done,
+ *	so what's queued meanwhile goes out in one packet.
+ */
+
+uint16_t eth_write(const uint8_t s, const uint8_t *buf, const uint16_t len)
+{
+	if (eth_sending[s]) {
+		uint8_t ir = _read8(Sn_IR, W5500_SREG(s));
+		if (!(ir & (Sn_IR_SENDOK | Sn_IR_TIMEOUT))) {
+			return (0);
+		}
+		_write8(Sn_IR, W5500_SREG(s), ir & (Sn_IR_SENDOK | Sn_IR_TIMEOUT));
+		eth_sending[s] = false;
+	}
+	uint16_t count = min(len, _read16_stable(Sn_TX_FSR, W5500_SREG(s)));
+	if (count == 0) {
+		return (0);
+	}
+	uint16_t ptr = _read16(Sn_TX_WR, W5500_SREG(s));
+	_frame(ptr, W5500_STX(s), (uint8_t *)buf, count, true);
+	_write16(Sn_TX_WR, W5500_SREG(s), ptr + count);
+	_command(s, Sn_CR_SEND);
+	eth_sending[s] = true;
+	return (count);
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * eth_set_net()	- set an address ($ethad, $ethgw, $ethmk) - as data, e.g. {"ethad":"0xC0A80132"}
+ * eth_set_port()	- set the port the sockets listen on ($ethpt)
+ * eth_get_ethcn()	- get the number of clients connected
+ */
+
+stat_t eth_set_net(nvObj_t *nv)
+{
+	ritorno(set_data(nv));
+	eth.changed = true;
+	return (STAT_OK);
+}
+
+stat_t eth_set_port(nvObj_t *nv)
+{
+	if ((nv->value < 1) || (nv->value > 65535)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	ritorno(set_int(nv));
+	eth.changed = true;
+	return (STAT_OK);
+}
+
+stat_t eth_get_ethcn(nvObj_t *nv)
+{
+	uint8_t clients = 0;
+	for (uint8_t s=0; eth.present && (s < ETH_SOCKETS); s++) {
+		if (eth_socket_state(s) == ETH_SOCK_ESTABLISHED) {
+			clients++;
+		}
+	}
+	nv->value = clients;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+#endif // __ETHERNET_CHANNEL
@@ -0,0 +1,79 @@
+/*
+ * ethernet.h - WIZnet W5500 TCP/IP controller for the xio ethernet channel
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ * Copyright (c) 2015 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * TCP server sockets on a W5500, talked to through the Motate SPI template. Built with
+ * __ETHERNET_CHANNEL - see xioEthernet in xio.cpp, which makes each socket a channel.
+ */
+#ifndef ETHERNET_H_ONCE
+#define ETHERNET_H_ONCE
+
+// ETH_SPI_CS_PIN is the chip select. It must be a pin the board pinout makes an SPI0 NPCS with
+// _MAKE_MOTATE_SPI_CS_PIN, and one nothing else drives, so it is set per board in the Makefile.
+#ifndef ETH_SPI_BAUD
+#define ETH_SPI_BAUD		21000000		// SPI clock - the W5500 takes up to 33 MHz
+#endif
+#ifndef ETH_SOCKETS
+#define ETH_SOCKETS			4				// clients that can be connected at once - 1, 2, 4 or 8
+#endif
+#define ETH_BUFFER_KB		(16 / ETH_SOCKETS)	// each socket's share of the 16K receive and 16K transmit memory
+#ifndef ETH_KEEPALIVE
+#define ETH_KEEPALIVE		2				// keepalive interval in 5 second units - finds clients that went away
+#endif
+#ifndef ETH_POLL_MS
+#define ETH_POLL_MS			5				// socket state is looked at this often
+#endif
+
+// W5500 socket states (Sn_SR)
+enum ethSocketState {
+	ETH_SOCK_CLOSED = 0x00,
+	ETH_SOCK_INIT = 0x13,
+	ETH_SOCK_LISTEN = 0x14,
+	ETH_SOCK_ESTABLISHED = 0x17,
+	ETH_SOCK_CLOSE_WAIT = 0x1C
+};
+
+typedef struct ethSingleton {
+	uint32_t address;						// IP address, first octet in the high byte (0xC0A80132 is 192.168.1.50) - 0 is ETHERNET_ADDRESS
+	uint32_t gateway;						// 0 is ETHERNET_GATEWAY
+	uint32_t netmask;						// 0 is ETHERNET_NETMASK
+	uint32_t port;							// TCP port the sockets listen on
+	bool present;							// a W5500 answered at eth_init()
+	volatile bool changed;					// the settings have changed - see eth_poll()
+} ethSingleton_t;
+
+extern ethSingleton_t eth;
+
+/**** function prototypes ****/
+
+bool eth_init(void);
+bool eth_poll(void);
+uint8_t eth_socket_state(const uint8_t s);
+void eth_socket_listen(const uint8_t s);
+void eth_socket_disconnect(const uint8_t s);
+uint16_t eth_rx_available(const uint8_t s);
+uint16_t eth_read(const uint8_t s, uint8_t *buf, const uint16_t len);
+uint16_t eth_write(const uint8_t s, const uint8_t *buf, const uint16_t len);
+void eth_flush_read(const uint8_t s);
+
+stat_t eth_set_net(nvObj_t *nv);
+stat_t eth_set_port(nvObj_t *nv);
+stat_t eth_get_ethcn(nvObj_t *nv);
+
+#endif // ETHERNET_H_ONCE
@@ -23,16 +23,40 @@
 #include "canonical_machine.h"
 #include "spindle.h"
 #include "coolant.h"
+#include "planner.h"
+#include "stepper.h"
 #include "util.h"
 #include "xio.h"			// for char definitions
 
 // local helper functions and macros
-static void _normalize_gcode_block(char *str, char **com, char **msg, uint8_t *block_delete_flag);
-static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value);
-static stat_t _point(float value);
+static stat_t _parse_gcode_block(char *block, char **msg, uint8_t *block_delete_flag);
+static stat_t _parse_gcode_word(char letter, float value);
+static void _parse_gcode_comment(char *com, char **msg);
+static uint8_t _point(float value);
 static stat_t _validate_gcode_block(void);
-static stat_t _parse_gcode_block(char *line);   // Parse the block into the GN/GF structs
 static stat_t _execute_gcode_block(void);       // Execute the gcode block
+static stat_t _set_modal_state(void);
+static stat_t _skip_gcode_block(void);
+static stat_t _resume_at_line(void);
+
+/*
+ * Start at line state - see gc_set_start()
+ */
+typedef struct gcStartAtLine {
+    uint32_t start_line;                        // line to start at, 0 if not fast-forwarding
+    int32_t line_offset;                        // N word less the line it was on, 0 if none yet
+    float spindle_speed;                        // outputs the skipped blocks asked for...
+    uint8_t spindle_control;
+    uint8_t mist_coolant;
+    uint8_t flood_coolant;
+    uint8_t tool;
+    bool spindle_speed_f;                       // ...and whether they did
+    bool spindle_control_f;
+    bool mist_coolant_f;
+    bool flood_coolant_f;
+    bool tool_change_f;
+} gcStartAtLine_t;
+static gcStartAtLine_t sal;
 
 #define SET_MODAL(m,parm,val) ({cm.gn.parm=val; cm.gf.parm=true; cm.gf.modals[m]=true; break;})
 #define SET_NON_MODAL(parm,val) ({cm.gn.parm=val; cm.gf.parm=true; break;})
@@ -41,30 +65,29 @@ static stat_t _execute_gcode_block(void);       // Execute the gcode block
 /*
  * gcode_parser() - parse a block (line) of gcode
  *
- *	Top level of gcode parser. Normalizes block and looks for special cases
+ *	Top level of gcode parser. Normalizes and parses the block and looks for special cases
  */
 
 stat_t gcode_parser(char *block)
 {
-    char *str = block;                      // gcode command or NUL string
     char none = NUL;
-    char *com = &none;                      // gcode comment or NUL string
     char *msg = &none;                      // gcode message or NUL string
     uint8_t block_delete_flag;
 
-	_normalize_gcode_block(str, &com, &msg, &block_delete_flag);
+	// normalize the block in place and load gn/gf from its words in the same pass
+	stat_t status = _parse_gcode_block(block, &msg, &block_delete_flag);
 
 	// queue a "(MSG" response
 	if (*msg != NUL) {
 		(void)cm_message(msg);				// queue the message
 	}
 
-    if (str[0] == NUL) {                    // normalization returned null string
+    if (block[0] == NUL) {                  // normalization returned null string
         return (STAT_OK);                   // most likely a comment line
     }
 
     // Trap M30 and M2 as $clear conditions. This has no effect it not in ALARM or SHUTDOWN
-    cm_parse_clear(str);                    // parse Gcode and clear alarms if M30 or M2 is found
+    cm_parse_clear(block);                  // parse Gcode and clear alarms if M30 or M2 is found
     ritorno(cm_is_alarmed());               // return error status if in alarm, shutdown or panic
 
 	// Block delete omits the line if a / char is present in the first space
@@ -73,11 +96,29 @@ stat_t gcode_parser(char *block)
 	if (block_delete_flag == true) {
 		return (STAT_NOOP);
 	}
-	return(_parse_gcode_block(block));
+	if ((status != STAT_OK) && (status != STAT_COMPLETE)) return (status);
+	ritorno(_validate_gcode_block());
+	if (sal.start_line != 0) {
+		int32_t line = xio_get_line_number();	// as the dispatcher read it - see xio_mark_lines()
+		if (cm.gf.linenum) {
+			sal.line_offset = (int32_t)cm.gn.linenum - line;	// N words override the count
+		}
+		if (line + sal.line_offset < (int32_t)sal.start_line) {
+			return (_skip_gcode_block());	// fast-forward the model without moving
+		}
+		ritorno(_resume_at_line());
+	}
+	return (_execute_gcode_block());		// if successful execute the block
 }
 
 /*
- * _normalize_gcode_block() - normalize a block (line) of gcode in place
+ * _parse_gcode_block() - normalize and parse one line of NUL terminated Gcode in one pass
+ *
+ *	Each character is read once and classified by gc_char_class[]. The normalized block is
+ *	written back in place while the words are parsed from it, so the line is not walked
+ *	again to find words and numbers. All the parser does is load the state values in gn
+ *	(next model state) and set flags in gf (model state flags). The execute routine applies
+ *	them.
  *
  *	Normalization functions:
  *   - convert all letters to upper case
@@ -89,11 +130,16 @@ stat_t gcode_parser(char *block)
  *
  *	So this: "g1 x100 Y100 f400" becomes this: "G1X100Y100F400"
  *
+ *	The normalized block is the same as it has always been - it is echoed back in JSON
+ *	mode and cm_parse_clear() looks for M2 and M30 in it. A leading zero is held back until
+ *	the next kept character shows whether it is stripped (followed by a digit) or not.
+ *
  *	Comment and message handling:
  *	 - Comments field start with a '(' char or alternately a semicolon ';'
  *	 - Comments and messages are not normalized - they are left alone
  *	 - The 'MSG' specifier in comment can have mixed case but cannot cannot have embedded white spaces
- *	 - Normalization returns true if there was a message to display, false otherwise
+ *	 - A 'VEX' comment carries the block's exit velocity hint in mm/min, e.g. G1X10(VEX1200).
+ *	   Tools/velocity_hints.py writes them - see _get_exit_hint() in plan_line.cpp
  *	 - Comments always terminate the block - i.e. leading or embedded comments are not supported
  *	 	- Valid cases (examples)			Notes:
  *		    G0X10							 - command only - no comment
@@ -108,96 +154,211 @@ stat_t gcode_parser(char *block)
  *		    (comment) G0X10 				 - leading comment. G0X10 will be ignored
  * 			G0X10 # comment					 - invalid separator
  *
+ *	Gcode numbers are an optional sign, digits and an optional decimal point. strtof() also
+ *	handles exponents, hex, inf and nan, and is slow and large in newlib, so the common case
+ *	is done here. Numbers of up to 2^24 without the point, and up to 10 decimal places, are
+ *	an integer and a power of ten that are both exact in float. A single float division of
+ *	the two is correctly rounded, so the result is the same as strtof(). Anything longer
+ *	falls back to strtof(). Exponents are not Gcode, so "X1E5" is X1 followed by an E word.
+ *	G0X... is not interpreted as hexadecimal - the X starts a new word.
+ *
  *	Returns:
- *	 - com points to comment string or to NUL if no comment
+ *	 - STAT_COMPLETE if all words were parsed, or the first word error. Normalization
+ *	   always runs to the end of the block, even after an error.
  *	 - msg points to message string or to NUL if no comment
  *	 - block_delete_flag is set true if block delete encountered, false otherwise
  */
-static void _normalize_gcode_block(char *str, char **com, char **msg, uint8_t *block_delete_flag)
+
+#define GC_SKIP     0       // white space, control and other invalid characters
+#define GC_DIGIT    1       // 0-9
+#define GC_LETTER   2       // A-Z and a-z
+#define GC_POINT    3       // decimal point
+#define GC_MINUS    4       // sign
+#define GC_COMMENT  5       // Gcode comments start with '(', Inkscape with '%', and random comments with ';'
+#define GC_END      6       // NUL
+
+#define _ GC_SKIP
+#define D GC_DIGIT
+#define L GC_LETTER
+#define P GC_POINT
+#define M GC_MINUS
+#define C GC_COMMENT
+#define E GC_END
+static const uint8_t gc_char_class[256] = {
+	E, _, _, _, _, _, _, _, _, _, _, _, _, _, _, _,	// 0x00
+	_, _, _, _, _, _, _, _, _, _, _, _, _, _, _, _,	// 0x10
+	_, _, _, _, _, C, _, _, C, _, _, _, _, M, P, _,	// 0x20
+	D, D, D, D, D, D, D, D, D, D, _, C, _, _, _, _,	// 0x30
+	_, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,	// 0x40
+	L, L, L, L, L, L, L, L, L, L, L, _, _, _, _, _,	// 0x50
+	_, L, L, L, L, L, L, L, L, L, L, L, L, L, L, L,	// 0x60
+	L, L, L, L, L, L, L, L, L, L, L, _, _, _, _, _,	// 0x70
+	};												// 0x80 - 0xFF are all GC_SKIP
+#undef _
+#undef D
+#undef L
+#undef P
+#undef M
+#undef C
+#undef E
+
+#define GCODE_EXACT_MANTISSA    ((uint32_t)1 << 24)     // largest integer exact in float
+#define GCODE_EXACT_PLACES      10                      // 10^10 is the largest exact power
+static const float pow10_exact[GCODE_EXACT_PLACES+1] = {
+    1E0, 1E1, 1E2, 1E3, 1E4, 1E5, 1E6, 1E7, 1E8, 1E9, 1E10 };
+
+static stat_t _parse_gcode_block(char *block, char **msg, uint8_t *block_delete_flag)
 {
-	char *rd = str;				// read pointer
-	char *wr = str;				// write pointer
+	char *rd = block;				// read pointer
+	char *wr = block;				// write pointer - the normalized block overwrites the raw one
+	bool zero_held = false;			// a leading zero waiting to see if it's stripped
+	bool strip_zeros = true;		// don't strip past a decimal point
+	stat_t status = STAT_OK;
 
-	// Preset comments and messages to NUL string
-	// Not required if com and msg already point to NUL on entry
-//	for (rd = str; *rd != NUL; rd++) { if (*rd == NUL) { *com = rd; *msg = rd; rd = str;} }
+	char letter = NUL;				// letter of the word being parsed, or NUL between words
+	char *number = NULL;			// start of the word's number in the normalized block
+	uint32_t mantissa = 0;
+	uint8_t length = 0;				// characters in the number, including sign and point
+	uint8_t digits = 0;
+	uint8_t places = 0;
+	bool negative = false;
+	bool point = false;
+	bool exact = true;
 
 	// mark block deletes
-	if (*rd == '/') {
-        *block_delete_flag = true;
-    } else {
-        *block_delete_flag = false;
+	*block_delete_flag = (*rd == '/');
+
+    // set initial state for new move
+    memset(&cm.gn, 0, sizeof(GCodeInput_t));        // clear all next-state values
+    memset(&cm.gf, 0, sizeof(GCodeFlags_t));        // clear all next-state flags
+    cm.gn.motion_mode = cm_get_motion_mode(MODEL);  // get motion mode from previous block
+
+    // Causes a later exception if
+    //  (1) INVERSE_TIME_MODE is active and a feed rate is not provided or
+    //  (2) INVERSE_TIME_MODE is changed to UNITS_PER_MINUTE and a new feed rate is missing
+    if (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) {// new feed rate req'd when in INV_TIME_MODE
+        cm.gn.feed_rate = 0;
+        cm.gf.feed_rate = true;
     }
 
-	// normalize the command block & find the comment (if any)
-    // Gcode comments start with '(', Inkscape with '%', and random comments with ';'
-	for (; *wr != NUL; rd++) {
-		if (*rd == NUL) { *wr = NUL; }
-		else if ((*rd == '(') || (*rd == ';')  || (*rd == '%')) { *wr = NUL; *com = rd+1; }
-		else if ((isalnum((char)*rd)) || (strchr("-.", *rd))) { // all valid characters
-			*(wr++) = toupper(*(rd));
+	for (;; rd++) {
+		uint8_t cclass = gc_char_class[(uint8_t)*rd];
+		if (cclass == GC_SKIP) {
+			continue;
+		}
+		char c = (cclass == GC_LETTER) ? toupper(*rd) : *rd;
+
+		// extend the number of the current word, or finish the word
+		if (letter != NUL) {
+			if (cclass == GC_DIGIT) {
+				if (mantissa >= GCODE_EXACT_MANTISSA) {	// too long (also keeps the uint32 from overflowing)
+					exact = false;
+				} else {
+					mantissa = mantissa * 10 + (c - '0');
+					if (point) { places++; }
+				}
+				digits++;
+				length++;
+			} else if ((cclass == GC_POINT) && (!point)) {
+				point = true;
+				length++;
+			} else if ((cclass == GC_MINUS) && (length == 0)) {
+				negative = true;
+				length++;
+			} else {
+				if (digits == 0) {
+					status = STAT_BAD_NUMBER_FORMAT;
+				} else {
+					while ((places > 0) && ((mantissa % 10) == 0)) {// trailing zeros don't change the value
+						mantissa /= 10;
+						places--;
+					}
+					float value;
+					if ((!exact) || (mantissa > GCODE_EXACT_MANTISSA) || (places > GCODE_EXACT_PLACES)) {
+						char save = *wr;				// the long form - the number is all written out
+						*wr = NUL;
+						value = strtof(number, NULL);
+						*wr = save;
+					} else {
+						value = (float)mantissa;
+						if (places > 0) { value /= pow10_exact[places]; }
+						if (negative) { value = -value; }
+					}
+					status = _parse_gcode_word(letter, value);
+				}
+				letter = NUL;
+			}
 		}
-	}
 
-	// Perform Octal stripping - remove invalid leading zeros in number strings
-	rd = str;
-	while (*rd != NUL) {
-		if (*rd == '.') break;							// don't strip past a decimal point
-		if ((!isdigit(*rd)) && (*(rd+1) == '0') && (isdigit(*(rd+2)))) {
-			wr = rd+1;
-			while (*wr != NUL) { *wr = *(wr+1); wr++;}	// copy forward w/overwrite
-			continue;
+		// start the next word
+		if ((letter == NUL) && (status == STAT_OK)) {
+			if (cclass == GC_LETTER) {
+				letter = c;
+				mantissa = 0;
+				length = 0;
+				digits = 0;
+				places = 0;
+				negative = false;
+				point = false;
+				exact = true;
+			} else if ((cclass == GC_DIGIT) || (cclass == GC_POINT) || (cclass == GC_MINUS)) {
+				status = STAT_MALFORMED_COMMAND_INPUT;
+			}
 		}
-		rd++;
-	}
 
-	// process comments and messages
-	if (**com != NUL) {
-		rd = *com;
-		while (isspace(*rd)) { rd++; }		// skip any leading spaces before "msg"
-		if ((tolower(*rd) == 'm') && (tolower(*(rd+1)) == 's') && (tolower(*(rd+2)) == 'g')) {
-			*msg = rd+3;
+		// write the normalized character
+		if (zero_held) {
+			zero_held = false;
+			if (cclass != GC_DIGIT) {
+				*(wr++) = '0';						// zero wasn't leading another digit - keep it
+			}
 		}
-		for (; *rd != NUL; rd++) {
-			if (*rd == ')') *rd = NUL;		// NUL terminate on trailing parenthesis, if any
+		if (cclass >= GC_COMMENT) {
+			*wr = NUL;
+			if (cclass == GC_COMMENT) {
+				_parse_gcode_comment(rd+1, msg);
+			}
+			break;
+		}
+		if (cclass == GC_POINT) {
+			strip_zeros = false;
 		}
+		if (strip_zeros && (c == '0') && (wr != block) && (gc_char_class[(uint8_t)*(wr-1)] != GC_DIGIT)) {
+			zero_held = true;
+		} else {
+			*(wr++) = c;
+			if (cclass == GC_LETTER) { number = wr; }
+		}
+	}
+	if (status == STAT_OK) {
+		status = STAT_COMPLETE;						// no more words
 	}
+	return (status);
 }
 
 /*
- * _get_next_gcode_word() - get gcode word consisting of a letter and a value
- *
- *	This function requires the Gcode string to be normalized.
- *	Normalization must remove any leading zeros or they will be converted to Octal
- *	G0X... is not interpreted as hexadecimal. This is trapped.
+ * _parse_gcode_comment() - find the message in a comment and NUL terminate it
  */
 
-static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value)
+static void _parse_gcode_comment(char *com, char **msg)
 {
-	if (**pstr == NUL) { return (STAT_COMPLETE); }	// no more words
-
-	// get letter part
-	if(isupper(**pstr) == false) {
-        return (STAT_MALFORMED_COMMAND_INPUT);
-    }
-	*letter = **pstr;
-	(*pstr)++;
-
-	// X-axis-becomes-a-hexadecimal-number get-value case, e.g. G0X100 --> G255
-	if ((**pstr == '0') && (*(*pstr+1) == 'X')) {
-		*value = 0;
-		(*pstr)++;
-		return (STAT_OK);		// pointer points to X
+	if (*com == NUL) {
+		return;
+	}
+	char *rd = com;
+	while (isspace(*rd)) { rd++; }		// skip any leading spaces before "msg"
+	if ((tolower(*rd) == 'm') && (tolower(*(rd+1)) == 's') && (tolower(*(rd+2)) == 'g')) {
+		*msg = rd+3;
+	}
+#ifdef __VELOCITY_HINTS
+	if ((tolower(*rd) == 'v') && (tolower(*(rd+1)) == 'e') && (tolower(*(rd+2)) == 'x')) {
+		cm.gn.exit_hint = max(0.0f, strtof(rd+3, NULL));
+		return;							// not a message, and nothing to terminate
+	}
+#endif
+	for (; *rd != NUL; rd++) {
+		if (*rd == ')') *rd = NUL;		// NUL terminate on trailing parenthesis, if any
 	}
-
-	// get-value general case
-	char *end;
-	*value = strtof(*pstr, &end);
-	if(end == *pstr) {
-        return(STAT_BAD_NUMBER_FORMAT);
-    }	// more robust test then checking for value=0;
-	*pstr = end;
-	return (STAT_OK);			// pointer points to next character after the word
 }
 
 /*
@@ -235,174 +396,176 @@ static stat_t _validate_gcode_block()
 }
 
 /*
- * _parse_gcode_block() - parses one line of NULL terminated G-Code.
- *
- *	All the parser does is load the state values in gn (next model state) and set flags
- *	in gf (model state flags). The execute routine applies them. The buffer is assumed to
- *	contain only uppercase characters and signed floats (no whitespace).
+ * _parse_gcode_word() - load one word into gn (next model state) and gf (model state flags)
  */
 
-static stat_t _parse_gcode_block(char *buf)
+static stat_t _parse_gcode_word(char letter, float value)
 {
-    char *pstr = (char *)buf;       // persistent pointer into gcode block for parsing words
-    char letter;                    // parsed letter, eg.g. G or X or Y
-    float value = 0;                // value parsed from letter (e.g. 2 for G2)
-    stat_t status = STAT_OK;
-
-    // set initial state for new move
-    memset(&cm.gn, 0, sizeof(GCodeInput_t));        // clear all next-state values
-    memset(&cm.gf, 0, sizeof(GCodeFlags_t));        // clear all next-state flags
-    cm.gn.motion_mode = cm_get_motion_mode(MODEL);  // get motion mode from previous block
-
-    // Causes a later exception if
-    //  (1) INVERSE_TIME_MODE is active and a feed rate is not provided or
-    //  (2) INVERSE_TIME_MODE is changed to UNITS_PER_MINUTE and a new feed rate is missing
-    if (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) {// new feed rate req'd when in INV_TIME_MODE
-        cm.gn.feed_rate = 0;
-        cm.gf.feed_rate = true;
-    }
+	stat_t status = STAT_OK;
 
-	// extract commands and parameters
-	while((status = _get_next_gcode_word(&pstr, &letter, &value)) == STAT_OK) {
-		switch(letter) {
-			case 'G':
-			switch((uint8_t)value) {
-				case 0:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_TRAVERSE);
-				case 1:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_FEED);
-				case 2:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CW_ARC);
-				case 3:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CCW_ARC);
-				case 4:  SET_NON_MODAL (next_action, NEXT_ACTION_DWELL);
-				case 10: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_COORD_DATA);
-				case 17: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XY);
-				case 18: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XZ);
-				case 19: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_YZ);
-				case 20: SET_MODAL (MODAL_GROUP_G6, units_mode, INCHES);
-				case 21: SET_MODAL (MODAL_GROUP_G6, units_mode, MILLIMETERS);
-				case 28: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G28_POSITION);
-						case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G28_POSITION);
-						case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SEARCH_HOME);
-						case 3: SET_NON_MODAL (next_action, NEXT_ACTION_SET_ABSOLUTE_ORIGIN);
-						case 4: SET_NON_MODAL (next_action, NEXT_ACTION_HOMING_NO_SET);
-						default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
-					}
-					break;
+	switch(letter) {
+		case 'G':
+		switch((uint8_t)value) {
+			case 0:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_TRAVERSE);
+			case 1:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_FEED);
+			case 2:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CW_ARC);
+			case 3:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CCW_ARC);
+			case 4:  SET_NON_MODAL (next_action, NEXT_ACTION_DWELL);
+			case 5: {
+				switch (_point(value)) {
+					case 0: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CUBIC_SPLINE);
+					case 1: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_QUADRATIC_SPLINE);
+					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 				}
-				case 30: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G30_POSITION);
-						case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G30_POSITION);
-						default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
-					}
-					break;
+				break;
+			}
+			case 10: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_COORD_DATA);
+			case 17: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XY);
+			case 18: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XZ);
+			case 19: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_YZ);
+			case 20: SET_MODAL (MODAL_GROUP_G6, units_mode, INCHES);
+			case 21: SET_MODAL (MODAL_GROUP_G6, units_mode, MILLIMETERS);
+			case 28: {
+				switch (_point(value)) {
+					case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G28_POSITION);
+					case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G28_POSITION);
+					case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SEARCH_HOME);
+					case 3: SET_NON_MODAL (next_action, NEXT_ACTION_SET_ABSOLUTE_ORIGIN);
+					case 4: SET_NON_MODAL (next_action, NEXT_ACTION_HOMING_NO_SET);
+					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 				}
-				case 38: {
-					switch (_point(value)) {
-						case 2: SET_NON_MODAL (next_action, NEXT_ACTION_STRAIGHT_PROBE);
-						default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
-					}
-					break;
+				break;
+			}
+			case 30: {
+				switch (_point(value)) {
+					case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G30_POSITION);
+					case 1: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G30_POSITION);
+					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 				}
-				case 40: break;	// ignore cancel cutter radius compensation
-				case 49: break;	// ignore cancel tool length offset comp.
-				case 53: SET_NON_MODAL (absolute_override, true);
-				case 54: SET_MODAL (MODAL_GROUP_G12, coord_system, G54);
-				case 55: SET_MODAL (MODAL_GROUP_G12, coord_system, G55);
-				case 56: SET_MODAL (MODAL_GROUP_G12, coord_system, G56);
-				case 57: SET_MODAL (MODAL_GROUP_G12, coord_system, G57);
-				case 58: SET_MODAL (MODAL_GROUP_G12, coord_system, G58);
-				case 59: SET_MODAL (MODAL_GROUP_G12, coord_system, G59);
-				case 61: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_PATH);
-						case 1: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_STOP);
-						default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
-					}
-					break;
+				break;
+			}
+#ifdef __THREADING
+			case 33: {
+				switch (_point(value)) {
+					case 0: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_SPINDLE_SYNC);
+					case 1: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_RIGID_TAP);
+					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 				}
-				case 64: SET_MODAL (MODAL_GROUP_G13,path_control, PATH_CONTINUOUS);
-				case 80: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANCEL_MOTION_MODE);
-				case 90: {
-					switch (_point(value)) {
+				break;
+			}
+#endif
+			case 38: {
+				switch (_point(value)) {
+					case 2: SET_NON_MODAL (next_action, NEXT_ACTION_STRAIGHT_PROBE);
+					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
+				}
+				break;
+			}
+			case 40: break;	// ignore cancel cutter radius compensation
+			case 49: break;	// ignore cancel tool length offset comp.
+			case 53: SET_NON_MODAL (absolute_override, true);
+			case 54: SET_MODAL (MODAL_GROUP_G12, coord_system, G54);
+			case 55: SET_MODAL (MODAL_GROUP_G12, coord_system, G55);
+			case 56: SET_MODAL (MODAL_GROUP_G12, coord_system, G56);
+			case 57: SET_MODAL (MODAL_GROUP_G12, coord_system, G57);
+			case 58: SET_MODAL (MODAL_GROUP_G12, coord_system, G58);
+			case 59: SET_MODAL (MODAL_GROUP_G12, coord_system, G59);
+			case 61: {
+				switch (_point(value)) {
+					case 0: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_PATH);
+					case 1: SET_MODAL (MODAL_GROUP_G13, path_control, PATH_EXACT_STOP);
+					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
+				}
+				break;
+			}
+			case 64: SET_MODAL (MODAL_GROUP_G13,path_control, PATH_CONTINUOUS);
+			case 80: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANCEL_MOTION_MODE);
+			case 81: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_81);
+			case 82: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_82);
+			case 83: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_83);
+			case 90: {
+				switch (_point(value)) {
     					case 0: SET_MODAL (MODAL_GROUP_G3, distance_mode, ABSOLUTE_MODE);
     					case 1: SET_MODAL (MODAL_GROUP_G3, arc_distance_mode, ABSOLUTE_MODE);
     					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
                     }
                     break;
                 }
-				case 91: {
+			case 91: {
     				switch (_point(value)) {
         				case 0: SET_MODAL (MODAL_GROUP_G3, distance_mode, INCREMENTAL_MODE);
         				case 1: SET_MODAL (MODAL_GROUP_G3, arc_distance_mode, INCREMENTAL_MODE);
         				default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
     				}
     				break;
+			}
+			case 92: {
+				switch (_point(value)) {
+					case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_ORIGIN_OFFSETS);
+					case 1: SET_NON_MODAL (next_action, NEXT_ACTION_RESET_ORIGIN_OFFSETS);
+					case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS);
+					case 3: SET_NON_MODAL (next_action, NEXT_ACTION_RESUME_ORIGIN_OFFSETS);
+					default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 				}
-				case 92: {
-					switch (_point(value)) {
-						case 0: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_ORIGIN_OFFSETS);
-						case 1: SET_NON_MODAL (next_action, NEXT_ACTION_RESET_ORIGIN_OFFSETS);
-						case 2: SET_NON_MODAL (next_action, NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS);
-						case 3: SET_NON_MODAL (next_action, NEXT_ACTION_RESUME_ORIGIN_OFFSETS);
-						default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
-					}
-					break;
-				}
-				case 93: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, INVERSE_TIME_MODE);
-				case 94: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_MINUTE_MODE);
-//				case 95: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_REVOLUTION_MODE);
-				default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
+				break;
 			}
-			break;
-
-			case 'M':
-			switch((uint8_t)value) {
-				case 0: case 1: case 60:
-						SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_STOP);
-				case 2: case 30:
-						SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_END);
-				case 3: SET_MODAL (MODAL_GROUP_M7, spindle_control, SPINDLE_CONTROL_CW);
-				case 4: SET_MODAL (MODAL_GROUP_M7, spindle_control, SPINDLE_CONTROL_CCW);
-				case 5: SET_MODAL (MODAL_GROUP_M7, spindle_control, SPINDLE_CONTROL_OFF);
-				case 6: SET_NON_MODAL (tool_change, true);
-				case 7: SET_MODAL (MODAL_GROUP_M8, mist_coolant, true);
-				case 8: SET_MODAL (MODAL_GROUP_M8, flood_coolant, true);
-				case 9: SET_MODAL (MODAL_GROUP_M8, flood_coolant, false);
+			case 93: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, INVERSE_TIME_MODE);
+			case 94: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_MINUTE_MODE);
+//				case 95: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_REVOLUTION_MODE);
+			case 98: SET_MODAL (MODAL_GROUP_G9, retract_mode, RETRACT_TO_CLEAR_Z);
+			case 99: SET_MODAL (MODAL_GROUP_G9, retract_mode, RETRACT_TO_R_PLANE);
+			default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
+		}
+		break;
+
+		case 'M':
+		switch((uint8_t)value) {
+			case 0: case 1: case 60:
+					SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_STOP);
+			case 2: case 30:
+					SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_END);
+			case 3: SET_MODAL (MODAL_GROUP_M7, spindle_control, SPINDLE_CONTROL_CW);
+			case 4: SET_MODAL (MODAL_GROUP_M7, spindle_control, SPINDLE_CONTROL_CCW);
+			case 5: SET_MODAL (MODAL_GROUP_M7, spindle_control, SPINDLE_CONTROL_OFF);
+			case 6: SET_NON_MODAL (tool_change, true);
+			case 7: SET_MODAL (MODAL_GROUP_M8, mist_coolant, true);
+			case 8: SET_MODAL (MODAL_GROUP_M8, flood_coolant, true);
+			case 9: SET_MODAL (MODAL_GROUP_M8, flood_coolant, false);
+#ifdef __MOTION_OUTPUTS
+			case 62: case 63: case 64: case 65:
+					SET_NON_MODAL (output_control, (uint8_t)value);
+#endif
 //				case 48: SET_MODAL (MODAL_GROUP_M9, override_enables, true);
 //				case 49: SET_MODAL (MODAL_GROUP_M9, override_enables, false);
 //				case 50: SET_MODAL (MODAL_GROUP_M9, feed_rate_override_enable, true); // conditionally true
 //				case 51: SET_MODAL (MODAL_GROUP_M9, spindle_override_enable, true);	  // conditionally true
-				default: status = STAT_MCODE_COMMAND_UNSUPPORTED;
-			}
-			break;
-
-			case 'T': SET_NON_MODAL (tool_select, (uint8_t)trunc(value));
-			case 'F': SET_NON_MODAL (feed_rate, value);
-			case 'P': SET_NON_MODAL (parameter, value);				// used for dwell time, G10 coord select
-			case 'S': SET_NON_MODAL (spindle_speed, value);
-			case 'X': SET_NON_MODAL (target[AXIS_X], value);
-			case 'Y': SET_NON_MODAL (target[AXIS_Y], value);
-			case 'Z': SET_NON_MODAL (target[AXIS_Z], value);
-			case 'A': SET_NON_MODAL (target[AXIS_A], value);
-			case 'B': SET_NON_MODAL (target[AXIS_B], value);
-			case 'C': SET_NON_MODAL (target[AXIS_C], value);
-		//	case 'U': SET_NON_MODAL (target[AXIS_U], value);		// reserved
-		//	case 'V': SET_NON_MODAL (target[AXIS_V], value);		// reserved
-		//	case 'W': SET_NON_MODAL (target[AXIS_W], value);		// reserved
-			case 'I': SET_NON_MODAL (arc_offset[0], value);
-			case 'J': SET_NON_MODAL (arc_offset[1], value);
-			case 'K': SET_NON_MODAL (arc_offset[2], value);
-            case 'L': SET_NON_MODAL (L_word, value);
-			case 'R': SET_NON_MODAL (arc_radius, value);
-			case 'N': SET_NON_MODAL (linenum,(uint32_t)value);		// line number
-			default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
+			default: status = STAT_MCODE_COMMAND_UNSUPPORTED;
 		}
-		if(status != STAT_OK) break;
+		break;
+
+		case 'T': SET_NON_MODAL (tool_select, (uint8_t)trunc(value));
+		case 'F': SET_NON_MODAL (feed_rate, value);
+		case 'P': SET_NON_MODAL (parameter, value);				// used for dwell time, G10 coord select
+		case 'S': SET_NON_MODAL (spindle_speed, value);
+		case 'X': SET_NON_MODAL (target[AXIS_X], value);
+		case 'Y': SET_NON_MODAL (target[AXIS_Y], value);
+		case 'Z': SET_NON_MODAL (target[AXIS_Z], value);
+		case 'A': SET_NON_MODAL (target[AXIS_A], value);
+		case 'B': SET_NON_MODAL (target[AXIS_B], value);
+		case 'C': SET_NON_MODAL (target[AXIS_C], value);
+	//	case 'U': SET_NON_MODAL (target[AXIS_U], value);		// reserved
+	//	case 'V': SET_NON_MODAL (target[AXIS_V], value);		// reserved
+	//	case 'W': SET_NON_MODAL (target[AXIS_W], value);		// reserved
+		case 'I': SET_NON_MODAL (arc_offset[0], value);
+		case 'J': SET_NON_MODAL (arc_offset[1], value);
+		case 'K': SET_NON_MODAL (arc_offset[2], value);
+		case 'L': SET_NON_MODAL (L_word, value);
+		case 'R': SET_NON_MODAL (arc_radius, value);			// arc radius, canned cycle R plane
+		case 'Q': SET_NON_MODAL (Q_word, value);				// used by G5 splines and G83
+		case 'N': SET_NON_MODAL (linenum,(uint32_t)value);		// line number
+		default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 	}
-	if ((status != STAT_OK) && (status != STAT_COMPLETE)) return (status);
-	ritorno(_validate_gcode_block());
-	return (_execute_gcode_block());		// if successful execute the block
+	return (status);
 }
 
 /*
@@ -424,6 +587,7 @@ static stat_t _parse_gcode_block(char *buf)
  *		6. change tool (M6)
  *		7. spindle on or off (M3, M4, M5)
  *		8. coolant on or off (M7, M8, M9)
+ *		8a. switch outputs (M62, M63, M64, M65)
  *		9. enable or disable overrides (M48, M49, M50, M51)
  *		10. dwell (G4)
  *		11. set active plane (G17, G18, G19)
@@ -438,7 +602,7 @@ static stat_t _parse_gcode_block(char *buf)
  *		19a. homing functions (G28.2, G28.3, G28.1, G28, G30)
  *		19b. update system data (G10)
  *		19c. set axis offsets (G92, G92.1, G92.2, G92.3)
- *		20. perform motion (G0 to G3, G80-G89) as modified (possibly) by G53
+ *		20. perform motion (G0 to G3, G5, G80-G89) as modified (possibly) by G53
  *		21. stop and end (M0, M1, M2, M30, M60)
  *
  *	Values in gn are in original units and should not be unit converted prior
@@ -450,6 +614,9 @@ static stat_t _execute_gcode_block()
 	stat_t status = STAT_OK;
 
 	cm_set_model_linenum(cm.gn.linenum);
+#ifdef __VELOCITY_HINTS
+	cm_set_model_exit_hint(cm.gn.exit_hint);                // 0 unless the block has one
+#endif
 	EXEC_FUNC(cm_set_feed_rate_mode, feed_rate_mode);       // G93, G94
 	EXEC_FUNC(cm_set_feed_rate, feed_rate);                 // F
 //	EXEC_FUNC(cm_feed_rate_override_factor, feed_rate_override_factor);
@@ -461,6 +628,11 @@ static stat_t _execute_gcode_block()
 	EXEC_FUNC(cm_spindle_control, spindle_control); 		// spindle CW, CCW, OFF
 	EXEC_FUNC(cm_mist_coolant_control, mist_coolant);       // M7, M9
 	EXEC_FUNC(cm_flood_coolant_control, flood_coolant);		// M8, M9 also disables mist coolant if OFF
+#ifdef __MOTION_OUTPUTS
+	if (cm.gf.output_control) {								// M62, M63, M64, M65
+		ritorno(cm_output_control(cm.gn.output_control, cm.gn.parameter, cm.gf.parameter, cm.gn.Q_word, cm.gf.Q_word));
+	}
+#endif
 //	EXEC_FUNC(cm_feed_rate_override_enable, feed_rate_override_enable);
 //	EXEC_FUNC(cm_traverse_override_enable, traverse_override_enable);
 //	EXEC_FUNC(cm_spindle_override_enable, spindle_override_enable);
@@ -469,15 +641,7 @@ static stat_t _execute_gcode_block()
 	if (cm.gn.next_action == NEXT_ACTION_DWELL) { 			// G4 - dwell
 		ritorno(cm_dwell(cm.gn.parameter));					// return if error, otherwise complete the block
 	}
-	EXEC_FUNC(cm_select_plane, select_plane);               // G17, G18, G19
-	EXEC_FUNC(cm_set_units_mode, units_mode);               // G20, G21
-	//--> cutter radius compensation goes here
-	//--> cutter length compensation goes here
-	EXEC_FUNC(cm_set_coord_system, coord_system);           // G54, G55, G56, G57, G58, G59
-	EXEC_FUNC(cm_set_path_control, path_control);           // G61, G61.1, G64
-	EXEC_FUNC(cm_set_distance_mode, distance_mode);         // G90, G91
-	EXEC_FUNC(cm_set_arc_distance_mode, arc_distance_mode); // G90.1, G91.1
-	//--> set retract mode goes here
+	status = _set_modal_state();                            // G17 to G99
 
 	switch (cm.gn.next_action) {
 		case NEXT_ACTION_SET_G28_POSITION:  { status = cm_set_g28_position(); break;}								// G28.1
@@ -512,6 +676,34 @@ static stat_t _execute_gcode_block()
                                                                  cm.gn.motion_mode);
                                                                  break;
                                           }
+        		case MOTION_MODE_CUBIC_SPLINE:                                                                      // G5
+                case MOTION_MODE_QUADRATIC_SPLINE: { status = cm_spline_feed(cm.gn.target, cm.gf.target,            // G5.1
+                                                                 cm.gn.arc_offset, cm.gf.arc_offset,
+                                                                 cm.gn.parameter,  cm.gf.parameter,
+                                                                 cm.gn.Q_word,     cm.gf.Q_word,
+                                                                 cm.gn.motion_mode);
+                                                                 break;
+                                          }
+#ifdef __THREADING
+        		case MOTION_MODE_SPINDLE_SYNC: { status = cm_spindle_sync_feed(cm.gn.target, cm.gf.target,          // G33
+                                                                 cm.gn.arc_offset[2], cm.gf.arc_offset[2]);         // K is the pitch
+                                                                 break;
+                                          }
+        		case MOTION_MODE_RIGID_TAP: { status = cm_rigid_tap(cm.gn.target, cm.gf.target,                     // G33.1
+                                                                 cm.gn.arc_offset[2], cm.gf.arc_offset[2]);
+                                                                 break;
+                                          }
+#endif
+        		case MOTION_MODE_CANNED_CYCLE_81:                                                                   // G81
+        		case MOTION_MODE_CANNED_CYCLE_82:                                                                   // G82
+                case MOTION_MODE_CANNED_CYCLE_83: { status = cm_drill_cycle(cm.gn.target, cm.gf.target,             // G83
+                                                                 cm.gn.arc_radius, cm.gf.arc_radius,
+                                                                 cm.gn.parameter,  cm.gf.parameter,
+                                                                 cm.gn.Q_word,     cm.gf.Q_word,
+                                                                 cm.gn.L_word,     cm.gf.L_word,
+                                                                 cm.gn.motion_mode);
+                                                                 break;
+                                          }
     		}
             cm_set_absolute_override(MODEL, ABSOLUTE_OVERRIDE_OFF);	 // un-set absolute override once the move is planned
 		}
@@ -528,6 +720,151 @@ static stat_t _execute_gcode_block()
 	return (status);
 }
 
+/*
+ * _set_modal_state() - steps 11 to 18 of _execute_gcode_block(), which only change the model
+ */
+
+static stat_t _set_modal_state()
+{
+	stat_t status = STAT_OK;
+
+	EXEC_FUNC(cm_select_plane, select_plane);               // G17, G18, G19
+	EXEC_FUNC(cm_set_units_mode, units_mode);               // G20, G21
+	//--> cutter radius compensation goes here
+	//--> cutter length compensation goes here
+	EXEC_FUNC(cm_set_coord_system, coord_system);           // G54, G55, G56, G57, G58, G59
+	if (cm.gf.path_control) {                               // G61, G61.1, G64 P
+		status = cm_set_path_control(cm.gn.path_control, cm.gf.parameter ? cm.gn.parameter : 0);
+	}
+	EXEC_FUNC(cm_set_distance_mode, distance_mode);         // G90, G91
+	EXEC_FUNC(cm_set_arc_distance_mode, arc_distance_mode); // G90.1, G91.1
+	EXEC_FUNC(cm_set_retract_mode, retract_mode);           // G98, G99
+	return (status);
+}
+
+/*
+ * _skip_gcode_block() - fast-forward a block before the start line - see gc_set_start()
+ * _resume_at_line()   - approach the point the skipped blocks ended at and run from there
+ *
+ *	A skipped block does everything _execute_gcode_block() does to the model - units,
+ *	plane, coordinate system, offsets, feed rate, tool select - but nothing is queued to
+ *	move. G54-G59 and G92 only set the model, and the offsets they leave are queued on
+ *	resume - see cm_set_model_only_offsets(). Motion sets the model target and position as if the move had been planned. The
+ *	end of a canned cycle is taken to be over its last hole, leaving Z where it was.
+ *	Spindle, coolant and M6 are only noted, and the last of each is queued on resume.
+ *	Dwells, stops, homing and probing are skipped. M2 or M30 before the start line ends
+ *	the program and the fast-forward with it.
+ *
+ *	Nothing goes into the planner, so skipping runs as fast as lines can be parsed.
+ */
+
+static stat_t _skip_gcode_block()
+{
+	stat_t status = STAT_OK;
+
+	cm_set_model_linenum(cm.gn.linenum);
+	EXEC_FUNC(cm_set_feed_rate_mode, feed_rate_mode);       // G93, G94
+	EXEC_FUNC(cm_set_feed_rate, feed_rate);                 // F
+	EXEC_FUNC(cm_select_tool, tool_select);                 // T
+	if (cm.gf.spindle_speed) {                              // S
+		sal.spindle_speed = cm.gn.spindle_speed;
+		sal.spindle_speed_f = true;
+	}
+	if (cm.gf.tool_change) {                                // M6
+		sal.tool = cm.gm.tool_select;
+		sal.tool_change_f = true;
+	}
+	if (cm.gf.spindle_control) {                            // M3, M4, M5
+		sal.spindle_control = cm.gn.spindle_control;
+		sal.spindle_control_f = true;
+	}
+	if (cm.gf.mist_coolant) {                               // M7
+		sal.mist_coolant = cm.gn.mist_coolant;
+		sal.mist_coolant_f = true;
+	}
+	if (cm.gf.flood_coolant) {                              // M8, M9
+		sal.flood_coolant = cm.gn.flood_coolant;
+		sal.flood_coolant_f = true;
+	}
+	status = _set_modal_state();                            // G17 to G99
+
+	switch (cm.gn.next_action) {
+		case NEXT_ACTION_SET_G28_POSITION:  { status = cm_set_g28_position(); break;}								// G28.1
+		case NEXT_ACTION_GOTO_G28_POSITION: { copy_vector(cm.gm.target, cm.gmx.g28_position); cm_finalize_move(); break;}	// G28
+		case NEXT_ACTION_SET_G30_POSITION:  { status = cm_set_g30_position(); break;}								// G30.1
+		case NEXT_ACTION_GOTO_G30_POSITION: { copy_vector(cm.gm.target, cm.gmx.g30_position); cm_finalize_move(); break;}	// G30
+
+		case NEXT_ACTION_SET_COORD_DATA:         { status = cm_set_coord_offsets(cm.gn.parameter, cm.gn.L_word, cm.gn.target, cm.gf.target); break;}
+		case NEXT_ACTION_SET_ORIGIN_OFFSETS:     { status = cm_set_origin_offsets(cm.gn.target, cm.gf.target); break;}// G92
+		case NEXT_ACTION_RESET_ORIGIN_OFFSETS:   { status = cm_reset_origin_offsets(); break;}                      // G92.1
+		case NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS: { status = cm_suspend_origin_offsets(); break;}                    // G92.2
+		case NEXT_ACTION_RESUME_ORIGIN_OFFSETS:  { status = cm_resume_origin_offsets(); break;}                     // G92.3
+
+		case NEXT_ACTION_DEFAULT: {
+			if ((cm.gn.motion_mode == MOTION_MODE_CANCEL_MOTION_MODE) ||
+				!(cm.gf.target[AXIS_X] || cm.gf.target[AXIS_Y] || cm.gf.target[AXIS_Z] ||
+				  cm.gf.target[AXIS_A] || cm.gf.target[AXIS_B] || cm.gf.target[AXIS_C])) {
+				cm.gm.motion_mode = cm.gn.motion_mode;
+				break;
+			}
+			if ((cm.gn.motion_mode == MOTION_MODE_STRAIGHT_FEED) && fp_ZERO(cm.gm.feed_rate)) {
+				return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);	// the same error the move would give
+			}
+			if ((cm.gn.motion_mode >= MOTION_MODE_CANNED_CYCLE_81) && (cm.gn.motion_mode <= MOTION_MODE_CANNED_CYCLE_83)) {
+				cm.gf.target[AXIS_Z] = false;
+			}
+			cm.gm.motion_mode = cm.gn.motion_mode;
+			cm_set_absolute_override(MODEL, cm.gn.absolute_override);
+			cm_set_model_target(cm.gn.target, cm.gf.target);
+			status = cm_test_soft_limits(cm.gm.target);
+			cm_finalize_move();
+			cm_set_absolute_override(MODEL, ABSOLUTE_OVERRIDE_OFF);
+			break;
+		}
+		default: {}											// homing, probing and G28.3 are skipped
+	}
+
+	if ((cm.gf.program_flow == true) && (cm.gn.program_flow == PROGRAM_END)) {
+		memset(&sal, 0, sizeof(sal));						// M2, M30: the program ended before the start line
+		cm_set_model_only_offsets(false);
+		cm_program_end();
+	}
+	return (status);
+}
+
+static stat_t _resume_at_line()
+{
+	float position[AXES];
+	copy_vector(position, cm.gmx.position);					// where the skipped blocks left the model
+	uint8_t motion_mode = cm.gm.motion_mode;
+	gcStartAtLine_t resume = sal;
+	memset(&sal, 0, sizeof(sal));							// whatever happens, this block runs for real
+	cm_set_model_only_offsets(false);						// queue the offsets the skipped blocks left
+
+	ritorno(cm_resume_traverse(position));
+	if (resume.tool_change_f) {
+		uint8_t tool_select = cm.gm.tool_select;
+		cm.gm.tool_select = resume.tool;					// the tool the last M6 took
+		cm_change_tool(true);
+		cm.gm.tool_select = tool_select;
+	}
+	if (resume.spindle_speed_f) {
+		cm_set_spindle_speed(resume.spindle_speed);
+	}
+	if (resume.spindle_control_f) {
+		cm_spindle_control(resume.spindle_control);
+	}
+	if (resume.mist_coolant_f) {
+		cm_mist_coolant_control(resume.mist_coolant);
+	}
+	if (resume.flood_coolant_f) {
+		cm_flood_coolant_control(resume.flood_coolant);
+	}
+	stat_t status = cm_resume_plunge(position);
+	cm.gm.motion_mode = motion_mode;						// the program's own motion mode carries on
+	return (status);
+}
+
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
@@ -546,6 +883,46 @@ stat_t gc_run_gc(nvObj_t *nv)
 	return(gcode_parser(*nv->stringp));
 }
 
+/*
+ * gc_get_start() - line the program will start at, 0 if none
+ * gc_set_start() - {"start":N} runs the program that follows from line N, {"start":0} cancels
+ *
+ *	Restarts a job part way through, for example after an alarm or a power loss. Send
+ *	{"start":N}, then the whole program from the top. Blocks before line N are parsed and
+ *	fast-forward the Gcode model without moving - see _skip_gcode_block(). At line N the
+ *	machine clears Z, traverses over the point the skipped blocks ended at, turns on the
+ *	spindle and coolant they left on and comes down, then runs line N and the rest as usual.
+ *
+ *	Lines are counted from 1 for the first line after {"start":N}, blank lines and comments
+ *	included - see xio_get_line_number(). A file run from the card counts from its own first
+ *	line. A block with an N word takes its number from it, and lines after it count on from
+ *	there. It can only be set from rest with the queue empty.
+ */
+
+stat_t gc_get_start(nvObj_t *nv)
+{
+	nv->value = (float)sal.start_line;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t gc_set_start(nvObj_t *nv)
+{
+	if (nv->value < 0) {
+		return (STAT_INPUT_VALUE_TOO_SMALL);
+	}
+	if ((nv->value >= 1) &&
+		((cm.machine_state == MACHINE_CYCLE) ||
+		 (mp_get_planner_buffers_available() < PLANNER_BUFFER_POOL_SIZE) || st_runtime_isbusy())) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	memset(&sal, 0, sizeof(sal));
+	sal.start_line = (uint32_t)nv->value;
+	xio_mark_lines();
+	cm_set_model_only_offsets(sal.start_line != 0);
+	return (gc_get_start(nv));
+}
+
 /***********************************************************************************
  * TEXT MODE SUPPORT
  * Functions to print variables from the cfgArray table
@@ -26,5 +26,7 @@
 stat_t gcode_parser(char *block);
 stat_t gc_get_gc(nvObj_t *nv);
 stat_t gc_run_gc(nvObj_t *nv);
+stat_t gc_get_start(nvObj_t *nv);
+stat_t gc_set_start(nvObj_t *nv);
 
 #endif // End of include guard: GCODE_PARSER_H_ONCE
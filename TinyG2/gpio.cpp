@@ -38,16 +38,25 @@
  *
  * 	The normally closed switch modes (NC) trigger an interrupt on the rising edge
  *	and lockout subsequent interrupts for the defined lockout period. Ditto on the method.
+ *
+ *	With __INPUT_FILTERS an input can use the PIO's own filters instead ($diNfl). The
+ *	debounce filter drops pulses shorter than half the debounce time ($idb) before they
+ *	raise an interrupt, so a noisy line no longer interrupts on every spike and the lockout
+ *	is not needed - a real second edge is seen as soon as it is stable.
  */
 
 #include "tinyg2.h"
 #include "config.h"
 #include "gpio.h"
+#include "text_parser.h"
 #include "stepper.h"
 #include "encoder.h"
 #include "hardware.h"
 #include "canonical_machine.h"
+#include "spindle.h"
+#include "planner.h"
 #include "report.h"
+#include "util.h"
 
 #ifdef __AVR
 #include <avr/interrupt.h>
@@ -94,6 +103,30 @@ bool _read_input_pin(const uint8_t input_num_ext) {
     }
 }
 
+#ifdef __INPUT_FILTERS
+// Sets the PIO filter of an input - also takes EXTERNAL pin numbers. Inputs keep their pull-up.
+// The debounce time is per port, so it is the same for every input that uses it.
+static void _set_input_filter(const uint8_t input_num_ext, const uint8_t filter, const uint32_t debounce_us)
+{
+    uint16_t options = kPullUp;
+    if (filter == INPUT_FILTER_GLITCH) { options |= kDeglitch; }
+    if (filter == INPUT_FILTER_DEBOUNCE) { options |= kDebounce; }
+
+    switch(input_num_ext) {
+        case 1: { input_1_pin.setOptions(options); input_1_pin.setDebounceTime(debounce_us); break; }
+        case 2: { input_2_pin.setOptions(options); input_2_pin.setDebounceTime(debounce_us); break; }
+        case 3: { input_3_pin.setOptions(options); input_3_pin.setDebounceTime(debounce_us); break; }
+        case 4: { input_4_pin.setOptions(options); input_4_pin.setDebounceTime(debounce_us); break; }
+        case 5: { input_5_pin.setOptions(options); input_5_pin.setDebounceTime(debounce_us); break; }
+        case 6: { input_6_pin.setOptions(options); input_6_pin.setDebounceTime(debounce_us); break; }
+        case 7: { input_7_pin.setOptions(options); input_7_pin.setDebounceTime(debounce_us); break; }
+        case 8: { input_8_pin.setOptions(options); input_8_pin.setDebounceTime(debounce_us); break; }
+        case 9: { input_9_pin.setOptions(options); input_9_pin.setDebounceTime(debounce_us); break; }
+        default: { break; }
+    }
+}
+#endif
+
 /*
  * gpio_init() - initialize inputs and outputs
  * gpio_reset() - reset inputs and outputs (no initialization)
@@ -112,19 +145,19 @@ void gpio_init(void)
      *
      */
 
-    input_1_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_2_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_3_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_4_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_5_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_6_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_7_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_8_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
+    input_1_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_2_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_3_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_4_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_5_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_6_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_7_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_8_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
 /*
-    input_9_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_10_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_11_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
-    input_12_pin.setInterrupts(kPinInterruptOnChange|kPinInterruptPriorityMedium);
+    input_9_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_10_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_11_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
+    input_12_pin.setInterrupts(kPinInterruptOnChange|hw_pin_priority(IRQ_PRIORITY_INPUT));
 */
 	return(gpio_reset());
 }
@@ -132,6 +165,9 @@ void gpio_init(void)
 void gpio_reset(void)
 {
 	for (uint8_t i=0; i<DI_CHANNELS; i++) {
+#ifdef __INPUT_FILTERS
+        _set_input_filter(i+1, io.in[i].filter, (uint32_t)(io.debounce_time * 1000));
+#endif
         if (io.in[i].mode == INPUT_MODE_DISABLED) {
             io.in[i].state = INPUT_DISABLED;
             continue;
@@ -139,6 +175,11 @@ void gpio_reset(void)
         int8_t pin_value_corrected = (_read_input_pin(i+1) ^ (io.in[i].mode ^ 1));	// correct for NO or NC mode
 		io.in[i].state = pin_value_corrected;
         io.in[i].lockout_ms = INPUT_LOCKOUT_MS;
+#ifdef __INPUT_FILTERS
+        if (io.in[i].filter == INPUT_FILTER_DEBOUNCE) {
+            io.in[i].lockout_ms = 0;            // the PIO has already debounced the edge
+        }
+#endif
 		io.in[i].lockout_timer = SysTickTimer.getValue();
 	}
 }
@@ -146,6 +187,11 @@ void gpio_reset(void)
 /*
  * gpio_set_homing_mode()   - set/clear input to homing mode
  * gpio_set_probing_mode()  - set/clear input to probing mode
+ * gpio_set_scan_mode()     - set/clear input to scanning probe mode (__PROBE_SCAN)
+ * gpio_set_motor_latch_mode() - set input to latch one motor (1-N) when squaring, 0 to clear
+ * gpio_set_axis_latch_mode() - set input to stop and latch the motors in the mask, 0 to clear
+ * gpio_get_motor_latches_pending() - number of motor latch inputs that have not fired
+ * gpio_get_latch()          - true if the input fired since it was armed; returns the edge time
  * gpio_read_input()        - read conditioned input
  *
  (* Note: input_num_ext means EXTERNAL input number -- 1-based
@@ -155,6 +201,9 @@ void  gpio_set_homing_mode(const uint8_t input_num_ext, const bool is_homing)
     if (input_num_ext == 0) {
         return;
     }
+    if (is_homing) {
+        io.in[input_num_ext-1].latched = false;     // arming discards the previous latch
+    }
     io.in[input_num_ext-1].homing_mode = is_homing;
 }
 
@@ -163,9 +212,73 @@ void  gpio_set_probing_mode(const uint8_t input_num_ext, const bool is_probing)
     if (input_num_ext == 0) {
         return;
     }
+    if (is_probing) {
+        io.in[input_num_ext-1].latched = false;
+    }
     io.in[input_num_ext-1].probing_mode = is_probing;
 }
 
+#ifdef __PROBE_SCAN
+void  gpio_set_scan_mode(const uint8_t input_num_ext, const bool is_scanning)
+{
+    if (input_num_ext == 0) {
+        return;
+    }
+    io.in[input_num_ext-1].scan_mode = is_scanning;
+}
+#endif
+
+void gpio_set_motor_latch_mode(const uint8_t input_num_ext, const uint8_t motor_ext)
+{
+    if (input_num_ext == 0) {
+        return;
+    }
+    io_di_t *in = &io.in[input_num_ext-1];
+    if ((in->latch_motor == 0) && (motor_ext != 0)) {
+        io.latches_pending++;
+    } else if ((in->latch_motor != 0) && (motor_ext == 0)) {
+        io.latches_pending--;
+    }
+    if (motor_ext != 0) {
+        in->latched = false;
+    }
+    in->latch_motor = motor_ext;
+}
+
+void gpio_set_axis_latch_mode(const uint8_t input_num_ext, const uint8_t motor_mask)
+{
+    if (input_num_ext == 0) {
+        return;
+    }
+    io_di_t *in = &io.in[input_num_ext-1];
+    if ((in->stop_motors == 0) && (motor_mask != 0)) {
+        io.latches_pending++;
+    } else if ((in->stop_motors != 0) && (motor_mask == 0)) {
+        io.latches_pending--;
+    }
+    if (motor_mask != 0) {
+        in->latched = false;
+    }
+    in->stop_motors = motor_mask;
+}
+
+uint8_t gpio_get_motor_latches_pending()
+{
+    return (io.latches_pending);
+}
+
+bool gpio_get_latch(const uint8_t input_num_ext, uint32_t *cycles)
+{
+    if (input_num_ext == 0) {
+        return false;
+    }
+    io_di_t *in = &io.in[input_num_ext-1];
+    if (in->latched && (cycles != NULL)) {
+        *cycles = in->latch_cycles;
+    }
+    return (in->latched);
+}
+
 bool gpio_read_input(const uint8_t input_num_ext)
 {
     if (input_num_ext == 0) {
@@ -174,6 +287,230 @@ bool gpio_read_input(const uint8_t input_num_ext)
     return (io.in[input_num_ext-1].state);
 }
 
+#ifdef __ANALOG_INPUTS
+/*
+ * Analog inputs
+ *
+ *	The ADC free-runs over the channels of the enabled inputs and its PDC moves the
+ *	conversions into one of two buffers while the ADC interrupt averages the other, so the
+ *	CPU is only involved once every AI_SAMPLES conversions of each channel. Conversions are
+ *	tagged with their channel (ADC_EMR TAG), so the averaging doesn't depend on the order the
+ *	ADC takes the channels in. Enabling a channel takes its pin from the PIO.
+ *
+ *	gpio_read_analog() scales the latest average - it's cheap enough to call from callbacks.
+ *	The simulator has no ADC, so its inputs read as zero less the offset.
+ */
+
+#ifndef __HOST__
+static uint16_t _ai_buf[2][AI_SAMPLES * AI_CHANNELS];
+static uint16_t _ai_count;                  // conversions per buffer
+#endif
+
+static void _ai_configure(void)
+{
+    uint32_t channels = 0;
+    for (uint8_t i=0; i<AI_CHANNELS; i++) {
+        io.analog_in[i].raw = 0;
+        if (io.analog_in[i].enable) {
+            channels |= (1u << io.analog_in[i].channel);
+        }
+    }
+#ifndef __HOST__
+    NVIC_DisableIRQ(ADC_IRQn);
+    PMC->PMC_PCER1 = (1u << (ID_ADC - 32));
+    ADC->ADC_PTCR = ADC_PTCR_RXTDIS;
+    ADC->ADC_CR = ADC_CR_SWRST;
+    if (channels == 0) {                    // leave the ADC stopped
+        return;
+    }
+    ADC->ADC_MR = ADC_MR_FREERUN_ON | ADC_MR_PRESCAL(SystemCoreClock / (2 * AI_ADC_CLOCK) - 1) |
+                  ADC_MR_STARTUP_SUT64 | ADC_MR_SETTLING_AST3 | ADC_MR_TRACKTIM(3) | ADC_MR_TRANSFER(1);
+    ADC->ADC_EMR = ADC_EMR_TAG;
+    ADC->ADC_CHDR = 0xFFFF;
+    ADC->ADC_CHER = channels;
+
+    _ai_count = AI_SAMPLES * __builtin_popcount(channels);
+    ADC->ADC_RPR = (uint32_t)_ai_buf[0];
+    ADC->ADC_RCR = _ai_count;
+    ADC->ADC_RNPR = (uint32_t)_ai_buf[1];
+    ADC->ADC_RNCR = _ai_count;
+
+    ADC->ADC_IDR = 0xFFFFFFFF;
+    ADC->ADC_IER = ADC_IER_ENDRX;
+    NVIC_SetPriority(ADC_IRQn, IRQ_PRIORITY_ANALOG);
+    NVIC_EnableIRQ(ADC_IRQn);
+    ADC->ADC_PTCR = ADC_PTCR_RXTEN;
+    ADC->ADC_CR = ADC_CR_START;
+#endif
+}
+
+#ifndef __HOST__
+// called when the PDC has filled a buffer and moved on to the other one
+extern "C" void ADC_Handler(void)
+{
+    uint16_t *done = _ai_buf[1];
+    if (ADC->ADC_RCR == 0) {                // overrun - both buffers filled before this ran
+        ADC->ADC_RPR = (uint32_t)_ai_buf[0];
+        ADC->ADC_RCR = _ai_count;
+    } else if (ADC->ADC_RPR >= (uint32_t)_ai_buf[1]) {
+        done = _ai_buf[0];
+    }
+
+    uint32_t sum[AI_ADC_CHANNELS] = {0};
+    uint16_t count[AI_ADC_CHANNELS] = {0};
+    for (uint16_t i=0; i<_ai_count; i++) {
+        uint8_t channel = (done[i] & ADC_LCDR_CHNB_Msk) >> ADC_LCDR_CHNB_Pos;
+        sum[channel] += done[i] & ADC_LCDR_LDATA_Msk;
+        count[channel]++;
+    }
+    for (uint8_t i=0; i<AI_CHANNELS; i++) {
+        uint8_t channel = io.analog_in[i].channel;
+        if (io.analog_in[i].enable && count[channel]) {
+            io.analog_in[i].raw = sum[channel] / count[channel];
+        }
+    }
+    ADC->ADC_RNPR = (uint32_t)done;
+    ADC->ADC_RNCR = _ai_count;              // writing this also clears ENDRX
+}
+#endif
+
+float gpio_read_analog(const uint8_t input_num_ext)
+{
+    if ((input_num_ext == 0) || (input_num_ext > AI_CHANNELS)) {
+        return (0);
+    }
+    io_ai_t *ai = &io.analog_in[input_num_ext-1];
+    return ((float)ai->raw * ai->scale / AI_ADC_FULL_SCALE - ai->offset);
+}
+#endif // __ANALOG_INPUTS
+
+#ifdef __MOTION_OUTPUTS
+/*
+ * Synchronized outputs
+ *
+ *	M62 and M63 switch an output at a distance along the path from where they are programmed
+ *	(P output, Q distance). The event waits here until the move it falls in is planned, and
+ *	gpio_take_output_events() hands it to that move as the distance left to run when it fires.
+ *	The exec attaches it to the segment it falls in and the DDA writes the pin on the tick it
+ *	falls on - see st_prep_output(). An event further on than the next move carries over to the
+ *	moves after it. Events the path never reaches are switched at program end (M2, M30), in
+ *	order. A queue flush drops them.
+ *
+ *	M64 and M65 switch an output in queue order, as a pass-through command at the segment
+ *	boundary where the moves before it end - see gpio_queue_output().
+ */
+
+static OutputPin<kOutput1_PinNumber> output_1_pin;
+static OutputPin<kOutput2_PinNumber> output_2_pin;
+static OutputPin<kOutput3_PinNumber> output_3_pin;
+static OutputPin<kOutput4_PinNumber> output_4_pin;
+
+bool gpio_output_is_configured(const uint8_t output_num_ext)
+{
+    if ((output_num_ext == 0) || (output_num_ext > DO_CHANNELS) ||
+        (io.out[output_num_ext-1].mode == INPUT_MODE_DISABLED)) {
+        return (false);
+    }
+    switch (output_num_ext) {
+        case 1: { return (!output_1_pin.isNull()); }
+        case 2: { return (!output_2_pin.isNull()); }
+        case 3: { return (!output_3_pin.isNull()); }
+        default: { return (!output_4_pin.isNull()); }
+    }
+}
+
+// called from the loader and DDA interrupts as well - keep it short
+void gpio_set_output(const uint8_t output_num_ext, const bool state)
+{
+    if ((output_num_ext == 0) || (output_num_ext > DO_CHANNELS) ||
+        (io.out[output_num_ext-1].mode == INPUT_MODE_DISABLED)) {
+        return;
+    }
+    bool value = (state ^ (io.out[output_num_ext-1].mode == INPUT_ACTIVE_LOW));
+    switch (output_num_ext) {
+        case 1: { output_1_pin = value; break; }
+        case 2: { output_2_pin = value; break; }
+        case 3: { output_3_pin = value; break; }
+        case 4: { output_4_pin = value; break; }
+    }
+}
+
+static void _exec_output(float *value, bool *flag)
+{
+    if (mp_dry_plan_is_active()) {
+        return;                                 // dry plans don't run outputs
+    }
+    gpio_set_output((uint8_t)value[0], fp_TRUE(value[1]));
+}
+
+void gpio_queue_output(const uint8_t output_num_ext, const bool state)
+{
+    float value[] = { (float)output_num_ext, (float)state, 0,0,0,0 };
+    bool flags[] = { 1,1,0,0,0,0 };
+    mp_queue_aux_command(_exec_output, value, flags);
+}
+
+/*
+ * gpio_queue_output_event()   - switch an output a distance (mm) along the path from here
+ * gpio_output_events_pending() - true if an event waits for the next move
+ * gpio_take_output_events()   - hand the events that fall in a move of this length to its block
+ * gpio_end_output_events()    - switch the events the path didn't reach (program end)
+ * gpio_reset_output_events()  - drop them (queue flush)
+ */
+
+stat_t gpio_queue_output_event(const uint8_t output_num_ext, const bool state, const float distance)
+{
+    if (io.events_pending >= DO_EVENTS_MAX) {
+        return (STAT_OUTPUT_EVENTS_FULL);
+    }
+    io_event_t *e = &io.event[io.events_pending++];
+    e->output = output_num_ext;
+    e->state = state;
+    e->distance = distance;
+    return (STAT_OK);
+}
+
+bool gpio_output_events_pending()
+{
+    return (io.events_pending != 0);
+}
+
+uint8_t gpio_take_output_events(io_event_t event[], const float length)
+{
+    uint8_t taken = 0;
+    uint8_t kept = 0;
+    for (uint8_t i=0; i<io.events_pending; i++) {
+        io_event_t *e = &io.event[i];
+        if (e->distance <= length) {                            // in path order, as the exec fires them
+            uint8_t j = taken++;
+            for (; (j > 0) && (event[j-1].distance < length - e->distance); j--) {
+                event[j] = event[j-1];
+            }
+            event[j] = *e;
+            event[j].distance = length - e->distance;           // to run when it fires
+        } else {
+            io.event[kept] = *e;
+            io.event[kept++].distance -= length;                // further along - wait for the next move
+        }
+    }
+    io.events_pending = kept;
+    return (taken);
+}
+
+void gpio_end_output_events()
+{
+    for (uint8_t i=0; i<io.events_pending; i++) {
+        gpio_queue_output(io.event[i].output, io.event[i].state);
+    }
+    io.events_pending = 0;
+}
+
+void gpio_reset_output_events()
+{
+    io.events_pending = 0;
+}
+#endif // __MOTION_OUTPUTS
+
 /*
  * pin change ISRs - ISR entry point for input pin changes
  *
@@ -219,6 +556,18 @@ void static _handle_pin_changed(const uint8_t input_num_ext, const int8_t pin_va
         return;
     }
 
+#ifdef __THREADING
+    // the spindle index is timed rather than debounced - it fires faster than the lockout
+    if (in->function == INPUT_FUNCTION_SPINDLE_INDEX) {
+        int8_t index_value = (pin_value ^ ((int)in->mode ^ 1));
+        if ((index_value == INPUT_ACTIVE) && (in->state != INPUT_ACTIVE)) {
+            spindle_index_pulse(hw_get_cycles());
+        }
+        in->state = index_value;
+        return;
+    }
+#endif
+
     // return if the input is in lockout period (take no action)
     if (SysTickTimer.getValue() < in->lockout_timer) {
         return;
@@ -240,10 +589,44 @@ void static _handle_pin_changed(const uint8_t input_num_ext, const int8_t pin_va
         in->edge = INPUT_EDGE_TRAILING;
     }
 
+    // stop this axis' motors where they are and latch them, then hold once every axis has
+    // latched. Stopping first means the snapshot is the position the motors stay at.
+    if (in->stop_motors != 0) {
+        if (in->edge == INPUT_EDGE_LEADING) {
+            st_stop_motors(in->stop_motors);
+            for (uint8_t motor=0; motor<MOTORS; motor++) {
+                if (in->stop_motors & (1 << motor)) { en_take_motor_snapshot(motor); }
+            }
+            in->latch_cycles = hw_get_cycles();
+            in->latched = true;
+            in->stop_motors = 0;
+            if (--io.latches_pending == 0) {
+                cm_start_hold();
+            }
+        }
+        return;
+    }
+
+    // latch a slaved motor on its own switch, then stop once every slaved motor has latched
+    if (in->latch_motor != 0) {
+        if (in->edge == INPUT_EDGE_LEADING) {   // we only want the leading edge to fire
+            en_take_motor_snapshot(in->latch_motor-1);
+            in->latch_cycles = hw_get_cycles();
+            in->latched = true;
+            in->latch_motor = 0;
+            if (--io.latches_pending == 0) {
+                cm_start_hold();
+            }
+        }
+        return;
+    }
+
     // perform homing operations if in homing mode
     if (in->homing_mode) {
         if (in->edge == INPUT_EDGE_LEADING) {   // we only want the leading edge to fire
             en_take_encoder_snapshot();
+            in->latch_cycles = hw_get_cycles();
+            in->latched = true;
             cm_start_hold();
         }
         return;
@@ -253,11 +636,21 @@ void static _handle_pin_changed(const uint8_t input_num_ext, const int8_t pin_va
     if (in->probing_mode) {
         if (in->edge == INPUT_EDGE_LEADING) {   // we only want the leading edge to fire
             en_take_encoder_snapshot();
+            in->latch_cycles = hw_get_cycles();
+            in->latched = true;
             cm_start_hold();
         }
         return;
     }
 
+#ifdef __PROBE_SCAN
+    // record both edges of a scanning probe and let the move carry on
+    if (in->scan_mode) {
+        cm_probe_scan_point(in->edge == INPUT_EDGE_LEADING);
+        return;
+    }
+#endif
+
 	// *** NOTE: From this point on all conditionals assume we are NOT in homing or probe mode ***
 
     // trigger the action on leading edges
@@ -273,9 +666,7 @@ void static _handle_pin_changed(const uint8_t input_num_ext, const int8_t pin_va
 	        cm_halt_all();					        // hard stop, including spindle and coolant
         }
         if (in->action == INPUT_ACTION_PANIC) {
-	        char msg[10];
-	        sprintf_P(msg, PSTR("input %d"), input_num_ext);
-	        cm_panic(STAT_PANIC, msg);
+	        rpt_post_panic(STAT_PANIC, "input", input_num_ext);   // halts now - the rest of cm_panic() is too much for the pin interrupt
         }
         if (in->action == INPUT_ACTION_RESET) {
             hw_hard_reset();
@@ -340,13 +731,82 @@ stat_t io_set_fn(nvObj_t *nv)			// input function
 	return (_io_set_helper(nv, INPUT_FUNCTION_NONE, INPUT_FUNCTION_MAX));
 }
 
+#ifdef __INPUT_FILTERS
+stat_t io_set_fl(nvObj_t *nv)			// input filter
+{
+	return (_io_set_helper(nv, INPUT_FILTER_NONE, INPUT_FILTER_MAX));
+}
+
+stat_t io_set_idb(nvObj_t *nv)			// input debounce time
+{
+	if ((nv->value < INPUT_DEBOUNCE_MIN) || (nv->value > INPUT_DEBOUNCE_MAX)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	set_flt(nv);
+	gpio_reset();
+	return (STAT_OK);
+}
+#endif // __INPUT_FILTERS
+
+#ifdef __ANALOG_INPUTS
+stat_t io_set_aien(nvObj_t *nv)			// analog input enable
+{
+	if ((nv->value < 0) || (nv->value > 1)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	set_ui8(nv);
+	_ai_configure();
+	return (STAT_OK);
+}
+
+stat_t io_set_aich(nvObj_t *nv)			// analog input ADC channel
+{
+	if ((nv->value < 0) || (nv->value >= AI_ADC_CHANNELS)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	set_ui8(nv);
+	_ai_configure();
+	return (STAT_OK);
+}
+
+/*
+ *  io_get_analog() - return an analog input's scaled reading given an nv object ("ai1vl")
+ */
+stat_t io_get_analog(nvObj_t *nv)
+{
+    char token[TOKEN_LEN+1];
+    GET_TOKEN_STRING(nv->index, token);
+    nv->value = gpio_read_analog(token[2] - '0');
+    nv->precision = (int8_t)GET_TABLE_WORD(precision);
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
+#endif // __ANALOG_INPUTS
+
+#ifdef __MOTION_OUTPUTS
+stat_t io_set_domo(nvObj_t *nv)			// output mode or disabled
+{
+	if ((nv->value < INPUT_MODE_DISABLED) || (nv->value >= INPUT_MODE_MAX)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	set_int8(nv);
+	char token[TOKEN_LEN+1];
+	GET_TOKEN_STRING(nv->index, token);
+	gpio_set_output(token[2] - '0', false);	// off in the new sense
+	return (STAT_OK);
+}
+#endif // __MOTION_OUTPUTS
+
 /*
  *  io_get_input() - return input state given an nv object
  */
 stat_t io_get_input(nvObj_t *nv)
 {
-    // the token has been stripped down to an ASCII digit string - use it as an index
-    nv->value = io.in[strtol(nv->token, NULL, 10)-1].state;
+    // the table token is "in" and an ASCII digit string - use the digits as an index
+    // (read from the table - the nv carries "in1" or "1" depending on how it was asked for)
+    char token[TOKEN_LEN+1];
+    GET_TOKEN_STRING(nv->index, token);
+    nv->value = io.in[strtol(&token[2], NULL, 10)-1].state;
     nv->valuetype = TYPE_INT;
     return (STAT_OK);
 }
@@ -360,17 +820,45 @@ stat_t io_get_input(nvObj_t *nv)
 
 	static const char fmt_gpio_mo[] PROGMEM = "[%smo] input mode%15d [-1=disabled, 0=NO,1=NC]\n";
 	static const char fmt_gpio_ac[] PROGMEM = "[%sac] input action%13d [0=none,1=stop,2=halt,3=stop_steps,4=panic,5=reset]\n";
-	static const char fmt_gpio_fn[] PROGMEM = "[%sfn] input function%11d [0=none,1=limit,2=interlock,3=shutdown]\n";
+	static const char fmt_gpio_fn[] PROGMEM = "[%sfn] input function%11d [0=none,1=limit,2=interlock,3=shutdown,4=spindle index]\n";
 	static const char fmt_gpio_in[] PROGMEM = "Input %s state: %5d\n";
 
     static void _print_di(nvObj_t *nv, const char *format)
     {
-        fprintf_P(stderr, format, nv->group, (int)nv->value);
+        text_printf(format, nv_group(nv), (int)nv->value);
     }
 	void io_print_mo(nvObj_t *nv) {_print_di(nv, fmt_gpio_mo);}
 	void io_print_ac(nvObj_t *nv) {_print_di(nv, fmt_gpio_ac);}
 	void io_print_fn(nvObj_t *nv) {_print_di(nv, fmt_gpio_fn);}
 	void io_print_in(nvObj_t *nv) {
-        fprintf_P(stderr, fmt_gpio_in, nv->token, (int)nv->value);
+        text_printf(fmt_gpio_in, nv_token(nv), (int)nv->value);
     }
+
+#ifdef __ANALOG_INPUTS
+	static const char fmt_ai_en[] PROGMEM = "[%sen] analog input enable%6d [0=off,1=on]\n";
+	static const char fmt_ai_ch[] PROGMEM = "[%sch] analog ADC channel%7d [0-15, Due A8-A11=10-13]\n";
+	static const char fmt_ai_sc[] PROGMEM = "[%ssc] analog scale%13.3f at full scale\n";
+	static const char fmt_ai_of[] PROGMEM = "[%sof] analog offset%12.3f\n";
+	static const char fmt_ai_vl[] PROGMEM = "[%svl] analog value%13.3f\n";
+
+    static void _print_ai(nvObj_t *nv, const char *format)
+    {
+        text_printf(format, nv_group(nv), nv->value);
+    }
+	void io_print_aien(nvObj_t *nv) {_print_di(nv, fmt_ai_en);}
+	void io_print_aich(nvObj_t *nv) {_print_di(nv, fmt_ai_ch);}
+	void io_print_aisc(nvObj_t *nv) {_print_ai(nv, fmt_ai_sc);}
+	void io_print_aiof(nvObj_t *nv) {_print_ai(nv, fmt_ai_of);}
+	void io_print_aivl(nvObj_t *nv) {_print_ai(nv, fmt_ai_vl);}
+#endif
+#ifdef __INPUT_FILTERS
+	static const char fmt_gpio_fl[] PROGMEM = "[%sfl] input filter%13d [0=none,1=glitch,2=debounce]\n";
+	static const char fmt_idb[] PROGMEM = "[idb] input debounce time%14.1f ms\n";
+	void io_print_fl(nvObj_t *nv) {_print_di(nv, fmt_gpio_fl);}
+	void io_print_idb(nvObj_t *nv) {text_printf(fmt_idb, nv->value);}
+#endif
+#ifdef __MOTION_OUTPUTS
+	static const char fmt_do_mo[] PROGMEM = "[%smo] output mode%14d [-1=disabled, 0=active low,1=active high]\n";
+	void io_print_domo(nvObj_t *nv) {_print_di(nv, fmt_do_mo);}
+#endif
 #endif
@@ -35,10 +35,23 @@
 
 #define DI_CHANNELS	        9       // number of digital inputs supported
 #define DO_CHANNELS	        4       // number of digital outputs supported
+#ifdef __ANALOG_INPUTS
+#define AI_CHANNELS	        4       // number of analog inputs supported
+#else
 #define AI_CHANNELS	        0       // number of analog inputs supported
+#endif
 #define AO_CHANNELS	        0       // number of analog outputs supported
 
 #define INPUT_LOCKOUT_MS    50      // milliseconds to go dead after input firing
+#define INPUT_DEBOUNCE_MIN  0.1     // milliseconds - the PIO debounce period is 61us to 1 second
+#define INPUT_DEBOUNCE_MAX  1000.0
+
+#define AI_SAMPLES          16      // conversions per input averaged into each reading
+#define AI_ADC_CHANNELS     16      // SAM3X ADC channels AD0 - AD15
+#define AI_ADC_FULL_SCALE   4095    // 12 bit conversions
+#define AI_ADC_CLOCK        1000000 // Hz - about 50,000 conversions a second, shared by the inputs
+
+#define DO_EVENTS_MAX       4       // M62/M63 output events waiting for the path, and carried by one move
 
 //--- do not change from here down ---//
 
@@ -66,10 +79,18 @@ typedef enum {                      // functions are requested from the ISR, run
     INPUT_FUNCTION_LIMIT,           // limit switch processing
     INPUT_FUNCTION_INTERLOCK,       // interlock processing
     INPUT_FUNCTION_SHUTDOWN,        // shutdown in support of external emergency stop
+    INPUT_FUNCTION_SPINDLE_INDEX,   // once per revolution spindle index for synchronized motion (G33)
 //    INPUT_FUNCTION_SPINDLE_READY,   // signal that spindle is ready (up to speed)
 	INPUT_FUNCTION_MAX              // unused. Just for range checking
 } inputFunc;
 
+typedef enum {                      // PIO input filter ($diNfl)
+    INPUT_FILTER_NONE = 0,          // no hardware filter - edges are debounced by the software lockout
+    INPUT_FILTER_GLITCH,            // glitch filter - rejects pulses under half a master clock, keeps the lockout
+    INPUT_FILTER_DEBOUNCE,          // debounce filter - rejects pulses under half the debounce time ($idb), no lockout
+	INPUT_FILTER_MAX                // unused. Just for range checking
+} inputFilter;
+
 typedef enum {
     INPUT_DISABLED = -1,            // value returned if input is disabled
     INPUT_INACTIVE = 0,             // aka switch open, also read as 'false'
@@ -94,17 +115,38 @@ typedef struct ioDigitalInput {		// one struct per digital input
     inputEdgeFlag edge;                // keeps a transient record of edges for immediate inquiry
     bool homing_mode;               // set true when input is in homing mode.
     bool probing_mode;              // set true when input is in probing mode.
+#ifdef __PROBE_SCAN
+    bool scan_mode;                 // set true to record every edge while motion carries on - see cm_probe_scan_point()
+#endif
+    uint8_t latch_motor;            // motor (1-N) latched by this input when squaring a gantry, 0 = none
+    uint8_t stop_motors;            // motors (bit per motor) stopped and latched by this input in concurrent homing
+    bool latched;                   // an armed input fired and the encoder snapshot holds its position
+    uint32_t latch_cycles;          // hw_get_cycles() at the edge that took the snapshot
+
+#ifdef __INPUT_FILTERS
+    uint8_t filter;                 // inputFilter - PIO glitch or debounce filter
+#endif
 
 	uint16_t lockout_ms;            // number of milliseconds for debounce lockout
 	uint32_t lockout_timer;         // time to expire current debounce lockout, or 0 if no lockout
 } io_di_t;
 
 typedef struct gpioDigitalOutput {  // one struct per digital output
-    inputMode mode;
+    int8_t mode;                    // -1=disabled, 0=active low, 1=active high (inputMode)
 } io_do_t;
 
+typedef struct gpioOutputEvent {    // an output switched at a point on the path (M62, M63)
+    uint8_t output;                 // digital output 1-N
+    bool state;                     // true = on
+    float distance;                 // mm into the move - or left to run, once carried by a block
+} io_event_t;
+
 typedef struct gpioAnalogInput {    // one struct per analog input
-    inputMode mode;
+    uint8_t enable;                 // 1 = sampled, 0 = off
+    uint8_t channel;                // ADC channel (AD0 - AD15) the input reads
+    float scale;                    // value at full scale, e.g. amps at 3.3 volts for a current sensor
+    float offset;                   // subtracted from the scaled reading, e.g. the sensor's zero current output
+    volatile uint16_t raw;          // latest averaged conversion - written by the ADC interrupt
 } io_ai_t;
 
 typedef struct gpioAnalogOutput {   // one struct per analog output
@@ -116,6 +158,14 @@ typedef struct gpioSingleton {      // collected gpio
     io_do_t out[DO_CHANNELS];     // Note: 'do' is a reserved word
     io_ai_t analog_in[AI_CHANNELS];
     io_ao_t analog_out[AO_CHANNELS];
+    volatile uint8_t latches_pending; // motor latch inputs that have not fired yet
+#ifdef __INPUT_FILTERS
+    float debounce_time;            // ms - PIO debounce period, shared by the inputs filtered with it
+#endif
+#ifdef __MOTION_OUTPUTS
+    uint8_t events_pending;         // M62/M63 events waiting for the next move - see gpio_take_output_events()
+    io_event_t event[DO_EVENTS_MAX];
+#endif
 } io_t;
 extern io_t io;
 
@@ -129,23 +179,71 @@ void gpio_reset(void);
 bool gpio_read_input(const uint8_t input_num);
 void gpio_set_homing_mode(const uint8_t input_num, const bool is_homing);
 void gpio_set_probing_mode(const uint8_t input_num, const bool is_probing);
+#ifdef __PROBE_SCAN
+void gpio_set_scan_mode(const uint8_t input_num, const bool is_scanning);
+#endif
+void gpio_set_motor_latch_mode(const uint8_t input_num, const uint8_t motor);
+void gpio_set_axis_latch_mode(const uint8_t input_num, const uint8_t motor_mask);
+uint8_t gpio_get_motor_latches_pending(void);
+bool gpio_get_latch(const uint8_t input_num, uint32_t *cycles);
+#ifdef __ANALOG_INPUTS
+float gpio_read_analog(const uint8_t input_num);        // scaled reading of analog input 1 - N
+#endif
+#ifdef __MOTION_OUTPUTS
+bool gpio_output_is_configured(const uint8_t output_num);
+void gpio_set_output(const uint8_t output_num, const bool state);
+void gpio_queue_output(const uint8_t output_num, const bool state);
+stat_t gpio_queue_output_event(const uint8_t output_num, const bool state, const float distance);
+bool gpio_output_events_pending(void);
+uint8_t gpio_take_output_events(io_event_t event[], const float length);
+void gpio_end_output_events(void);
+void gpio_reset_output_events(void);
+#endif
 
 stat_t io_set_mo(nvObj_t *nv);
 stat_t io_set_ac(nvObj_t *nv);
 stat_t io_set_fn(nvObj_t *nv);
 
 stat_t io_get_input(nvObj_t *nv);
+#ifdef __INPUT_FILTERS
+stat_t io_set_fl(nvObj_t *nv);
+stat_t io_set_idb(nvObj_t *nv);
+#endif
+#ifdef __ANALOG_INPUTS
+stat_t io_set_aien(nvObj_t *nv);
+stat_t io_set_aich(nvObj_t *nv);
+stat_t io_get_analog(nvObj_t *nv);
+#endif
+#ifdef __MOTION_OUTPUTS
+stat_t io_set_domo(nvObj_t *nv);
+#endif
 
 #ifdef __TEXT_MODE
 	void io_print_mo(nvObj_t *nv);
 	void io_print_ac(nvObj_t *nv);
 	void io_print_fn(nvObj_t *nv);
 	void io_print_in(nvObj_t *nv);
+	void io_print_aien(nvObj_t *nv);
+	void io_print_aich(nvObj_t *nv);
+	void io_print_aisc(nvObj_t *nv);
+	void io_print_aiof(nvObj_t *nv);
+	void io_print_aivl(nvObj_t *nv);
+	void io_print_domo(nvObj_t *nv);
+	void io_print_fl(nvObj_t *nv);
+	void io_print_idb(nvObj_t *nv);
 #else
 	#define io_print_mo tx_print_stub
 	#define io_print_ac tx_print_stub
 	#define io_print_fn tx_print_stub
 	#define io_print_in tx_print_stub
+	#define io_print_aien tx_print_stub
+	#define io_print_aich tx_print_stub
+	#define io_print_aisc tx_print_stub
+	#define io_print_aiof tx_print_stub
+	#define io_print_aivl tx_print_stub
+	#define io_print_domo tx_print_stub
+	#define io_print_fl tx_print_stub
+	#define io_print_idb tx_print_stub
 #endif // __TEXT_MODE
 
 #endif // End of include guard: GPIO_H_ONCE
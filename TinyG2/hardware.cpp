@@ -34,10 +34,22 @@
 #include "hardware.h"
 #include "controller.h"
 #include "text_parser.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "stepper.h"
+#include "xio.h"
+#include "report.h"
 #ifdef __ARM
 #include "UniqueId.h"
 #include "Reset.h"
 #endif
+
+#ifndef __HOST__
+extern "C" char *_sbrk(int incr);					// see syscalls_sam3.cpp
+extern char _srelocate, _erelocate, _sbss, _ebss, _end, _estack;	// see gcc_flash.ld
+static uint32_t *hw_stack_painted;					// lowest word painted by _paint_stack()
+static void _paint_stack(void);
+#endif
 #ifdef __AVR
 #include "xmega/xmega_init.h"
 #include "xmega/xmega_rtc.h"
@@ -49,9 +61,161 @@
 
 void hardware_init()
 {
-	return;
+#ifndef __HOST__											// the simulator has no DWT - see hw_get_cycles()
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;	// start the cycle counter - see hw_get_cycles()
+	HW_DWT_CYCCNT = 0;
+	HW_DWT_CTRL |= HW_DWT_CTRL_CYCCNTENA;
+	NVIC_SetPriority(UOTGHS_IRQn, IRQ_PRIORITY_SERIAL);	// Motate's USB driver starts it at 0
+	_paint_stack();
+#endif
+}
+
+/*
+ * hw_check_irq_priorities() - check the interrupt levels against the table in hardware.h
+ *
+ *	Reads back the level each interrupt actually has (from the NVIC, or the simulated one on
+ *	the host) and checks that every group preempts the groups after it: the DDA and dwell
+ *	timers the loader, the loader the exec, the exec the serial channels. The input pins
+ *	aren't in it, as their levels are per port. Call it once all the interrupts are set up.
+ *	A misordering is reported as an exception naming the first pair found.
+ */
+typedef struct hwIrqLevel {
+	const char *name;
+	uint8_t group;						// must preempt every later group
+	uint8_t level;						// as set
+} hwIrqLevel_t;
+
+#ifdef __HOST__
+#define _irq_timer_level(num) (Motate::hostTimer[num].priority)
+#else
+#define _irq_timer_level(num) (NVIC_GetPriority(Motate::Timer<num>::tcIRQ()))
+#endif
+
+stat_t hw_check_irq_priorities()
+{
+	const hwIrqLevel_t irq[] = {
+		{ "dda",   0, (uint8_t)_irq_timer_level(dda_timer_num) },
+		{ "dwell", 0, (uint8_t)_irq_timer_level(dwell_timer_num) },
+		{ "load",  1, (uint8_t)_irq_timer_level(load_timer_num) },
+#ifdef __AUX_MOTION
+		{ "aux",   1, (uint8_t)_irq_timer_level(aux_timer_num) },
+#endif
+		{ "exec",  2, (uint8_t)_irq_timer_level(exec_timer_num) },
+#ifndef __HOST__										// the simulator's USB has no interrupt
+		{ "usb",   3, (uint8_t)NVIC_GetPriority(UOTGHS_IRQn) },
+#ifdef __USART_CHANNEL
+		{ "usart", 3, (uint8_t)NVIC_GetPriority(USART0_IRQn) },
+#endif
+#endif
+	};
+	const uint8_t count = sizeof(irq) / sizeof(irq[0]);
+
+	for (uint8_t i=0; i<count; i++) {
+		for (uint8_t j=0; j<count; j++) {
+			if ((irq[i].group < irq[j].group) && (irq[i].level >= irq[j].level)) {
+				char msg[48];
+				sprintf(msg, "%s irq (%u) does not preempt %s (%u)", irq[i].name, irq[i].level, irq[j].name, irq[j].level);
+				return (rpt_exception(STAT_INIT_FAILURE, msg));
+			}
+		}
+	}
+	return (STAT_OK);
+}
+
+/*
+ * Memory map and stack high-water mark - see hw_get_mem()
+ *
+ * _paint_stack()	- fill the free RAM between the heap and the stack with HW_STACK_PAINT
+ * _get_stack_low()	- lowest address the stack has reached since it was painted
+ *
+ *	RAM runs .data, .bss, the heap (growing up from _end) and the stack (growing down from
+ *	_estack, the top of RAM). Interrupts run on the same (main) stack as thread mode, so
+ *	the high-water mark is the deepest the main loop and any nesting of interrupts on top
+ *	of it have gone together. Painting is done once, at startup, up to a little below the
+ *	stack pointer of the moment. Heap growing into the painted area is seen as heap.
+ */
+#ifndef __HOST__
+#define HW_STACK_PAINT 0xA5A5A5A5
+#define HW_STACK_PAINT_MARGIN 256						// bytes left unpainted below the SP
+
+static void _paint_stack()
+{
+	uint32_t *p = (uint32_t *)(((uintptr_t)_sbrk(0) + 3) & ~(uintptr_t)3);
+	uint32_t *sp = (uint32_t *)(uintptr_t)(__get_MSP() - HW_STACK_PAINT_MARGIN);
+	hw_stack_painted = p;
+	while (p < sp) {
+		*p++ = HW_STACK_PAINT;
+	}
 }
 
+static uintptr_t _get_stack_low()
+{
+	uint32_t *p = (uint32_t *)(((uintptr_t)_sbrk(0) + 3) & ~(uintptr_t)3);
+	uint32_t *sp = (uint32_t *)(uintptr_t)__get_MSP();
+	if (p < hw_stack_painted) {
+		p = hw_stack_painted;
+	}
+	while ((p < sp) && (*p == HW_STACK_PAINT)) {
+		p++;
+	}
+	return ((uintptr_t)p);
+}
+#endif
+
+#ifdef __WATCHDOG
+/*
+ * hw_watchdog_init()     - start the watchdog with WATCHDOG_TIMEOUT_MS
+ * hw_watchdog_feed()     - restart the watchdog count
+ * hw_watchdog_callback() - main loop task: feed the watchdog and keep the warm restart record
+ * hw_reset_was_warm()    - true if RAM came through the last reset - see cm_load_warm_restart()
+ *
+ *	The watchdog mode register can only be written once after a reset, so _system_init()
+ *	leaves it alone and it runs with its reset value (16 seconds) through the inits. It is
+ *	set to WATCHDOG_TIMEOUT_MS once they are done. The count runs off the slow clock / 128
+ *	and stops while the core is halted by a debugger. It is fed by the first task in the
+ *	main loop, so anything that stops the loop for longer - a lockup or an endless loop in
+ *	an assertion - resets the board. Long jobs on the main loop that are meant to take a
+ *	while, like $defa, feed it themselves.
+ *
+ *	Warm resets are the watchdog, software (hw_hard_reset()) and the reset pin. Power up and
+ *	backup resets leave RAM undefined.
+ */
+
+#define WATCHDOG_COUNTS ((WATCHDOG_TIMEOUT_MS * 256UL) / 1000)	// slow clock / 128 is 256 Hz
+
+void hw_watchdog_init()
+{
+#ifndef __HOST__
+	WDT->WDT_MR = WDT_MR_WDV(WATCHDOG_COUNTS) | WDT_MR_WDD(WATCHDOG_COUNTS) |	// no restart window
+				  WDT_MR_WDRSTEN | WDT_MR_WDDBGHLT;
+#endif
+}
+
+void hw_watchdog_feed()
+{
+#ifndef __HOST__
+	WDT->WDT_CR = WDT_CR_KEY(0xA5) | WDT_CR_WDRSTT;
+#endif
+}
+
+stat_t hw_watchdog_callback()
+{
+	hw_watchdog_feed();
+	cm_save_warm_restart();
+	return (STAT_OK);
+}
+
+bool hw_reset_was_warm()
+{
+#ifdef __HOST__
+	return (false);
+#else
+	uint32_t type = (RSTC->RSTC_SR & RSTC_SR_RSTTYP_Msk) >> RSTC_SR_RSTTYP_Pos;
+	return ((type == 2) || (type == 3) || (type == 4));	// watchdog, software, user (reset pin)
+#endif
+}
+#endif // __WATCHDOG
+
 /*
  * hw_hard_reset() - reset system now
  * hw_flash_loader() - enter flash loader to reflash board
@@ -108,6 +272,32 @@ stat_t hw_get_id(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+/*
+ * hw_get_mem() - report the RAM used by the big singletons, the heap and the stack
+ *
+ *	{"mem":{"mb":n,...,"data":n,"bss":n,"heap":n,"stack":n,"free":n}} - all in bytes.
+ *	stack is the high-water mark, free is the RAM neither the heap nor the stack has
+ *	touched yet - the real headroom for growing buffers. The host build only reports
+ *	the singletons.
+ */
+stat_t hw_get_mem(nvObj_t *nv)
+{
+	printf_P(PSTR("{\"mem\":{\"mb\":%u,\"mm\":%u,\"mr\":%u,\"cm\":%u,\"st_pre\":%u,\"st_run\":%u,\"nvl\":%u,\"nvStr\":%u,\"xio\":%u"),
+		(unsigned)sizeof(mb), (unsigned)sizeof(mm), (unsigned)sizeof(mr), (unsigned)sizeof(cm), (unsigned)sizeof(st_pre),
+		(unsigned)st_get_run_size(), (unsigned)sizeof(nvl), (unsigned)sizeof(nvStr), (unsigned)xio_get_ram_size());
+#ifndef __HOST__
+	uintptr_t heap_top = (uintptr_t)_sbrk(0);
+	uintptr_t stack_low = _get_stack_low();
+	printf_P(PSTR(",\"data\":%lu,\"bss\":%lu,\"heap\":%lu,\"stack\":%lu,\"free\":%lu"),
+		(unsigned long)(&_erelocate - &_srelocate), (unsigned long)(&_ebss - &_sbss),
+		(unsigned long)(heap_top - (uintptr_t)&_end), (unsigned long)((uintptr_t)&_estack - stack_low),
+		(unsigned long)((stack_low > heap_top) ? (stack_low - heap_top) : 0));
+#endif
+	printf_P(PSTR("}}\n"));
+	nv->valuetype = TYPE_NULL;
+	return (STAT_OK);
+}
+
 /*
  * hw_flash() - invoke FLASH loader from command input
  */
@@ -68,6 +68,9 @@ enum hwPlatform {
 
 #include "MotatePins.h"
 #include "MotateTimers.h" // for timer_number
+#ifdef __HOST__
+#include "host.h"
+#endif
 
 using namespace Motate;
 
@@ -84,6 +87,23 @@ extern "C"{
 #define MILLISECONDS_PER_TICK 1			// MS for system tick (systick * N)
 #define SYS_ID_DIGITS 12                // actual digits in system ID (up to 16)
 #define SYS_ID_LEN 16					// total length including dashes and NUL
+#define HW_CYCLES_PER_US (F_CPU/1000000UL)	// CPU cycles per microsecond - see hw_get_cycles()
+
+// DWT cycle counter registers (the CMSIS core_cm3.h in this tree predates its DWT definitions)
+#define HW_DWT_CTRL		(*(volatile uint32_t *)0xE0001000UL)
+#define HW_DWT_CYCCNT	(*(volatile uint32_t *)0xE0001004UL)
+#define HW_DWT_CTRL_CYCCNTENA (1UL << 0)
+
+// RAMFUNC places a function in SRAM (.ramfunc is copied up with .relocate at reset), where it
+// runs without flash wait states. It is for the step generation and exec paths only: the DDA,
+// load and exec interrupts, _load_move(), st_prep_line() and the per-segment exec functions
+// (plan_exec.cpp). make RAMFUNC=0 leaves them in flash. The host has one kind of memory, so it
+// is a no-op there.
+#if defined(__RAMFUNC) && !defined(__HOST__)
+#define RAMFUNC __attribute__ ((long_call, section (".ramfunc")))
+#else
+#define RAMFUNC
+#endif
 
 /************************************************************************************
  **** ARM SAM3X8E SPECIFIC HARDWARE *************************************************
@@ -104,19 +124,54 @@ extern "C"{
 
 /* Interrupt usage and priority
  *
- * The following interrupts are defined w/indicated priorities
+ * Every interrupt takes its NVIC level from this table. 0 is the most urgent, 15 the least,
+ * and an interrupt only preempts those with a larger number. Each group must preempt the
+ * groups below it; hw_check_irq_priorities() reads the levels back from the NVIC at startup.
  *
- *	 0	DDA_TIMER (3) for step pulse generation
- *	 1	DWELL_TIMER (4) for dwell timing
- *	 2	LOADER software generated interrupt (STIR / SGI)
- *	 3	Serial read character interrupt
- *	 4	EXEC software generated interrupt (STIR / SGI)
- *	 5	Serial write character interrupt
+ *	 0	DDA timer (step pulses), dwell timer, sync input - nothing may hold these off
+ *	 3	loader software interrupt - _load_move() for a stopped runtime, aux motion timer (__AUX_MOTION)
+ *	 7	input pins - limits, homing and probe
+ *	11	exec software interrupt - segment prep, which can take a good part of a segment
+ *	15	USB and USART serial (buffered), ADC analog inputs, SysTick
+ *
+ * Motate timers and pins set the levels 0, 3, 7, 11 and 15, so use those (see hw_timer_priority()
+ * and hw_pin_priority()). Pin interrupts are per port: the sync input takes the whole of its
+ * port to level 0, along with any inputs that share it. A board that needs other levels can
+ * define any of these ahead of this file.
  */
+#ifndef IRQ_PRIORITY_DDA
+#define IRQ_PRIORITY_DDA		0
+#endif
+#ifndef IRQ_PRIORITY_DWELL
+#define IRQ_PRIORITY_DWELL		0
+#endif
+#ifndef IRQ_PRIORITY_SYNC
+#define IRQ_PRIORITY_SYNC		0
+#endif
+#ifndef IRQ_PRIORITY_LOAD
+#define IRQ_PRIORITY_LOAD		3
+#endif
+#ifndef IRQ_PRIORITY_AUX
+#define IRQ_PRIORITY_AUX		3
+#endif
+#ifndef IRQ_PRIORITY_INPUT
+#define IRQ_PRIORITY_INPUT		7
+#endif
+#ifndef IRQ_PRIORITY_EXEC
+#define IRQ_PRIORITY_EXEC		11
+#endif
+#ifndef IRQ_PRIORITY_SERIAL
+#define IRQ_PRIORITY_SERIAL		15
+#endif
+#ifndef IRQ_PRIORITY_ANALOG
+#define IRQ_PRIORITY_ANALOG		15
+#endif
 
 /**** Stepper DDA and dwell timer settings ****/
 
+#ifndef FREQUENCY_DDA						// can be set from the build (e.g. make DDA_FREQUENCY=400000)
 #define FREQUENCY_DDA		200000.0		// Hz step frequency. Interrupts actually fire at 2x (400 KHz)
+#endif
 #define FREQUENCY_DWELL		1000UL
 #define FREQUENCY_SGI		200000UL		// 200,000 Hz means software interrupts will fire 5 uSec after being called
 
@@ -128,6 +183,7 @@ timer_number dda_timer_num   = 2;	// stepper pulse generation in stepper.cpp
 timer_number dwell_timer_num = 3;	// dwell timing in stepper.cpp
 timer_number load_timer_num  = 4;	// request load timer in stepper.cpp
 timer_number exec_timer_num  = 5;	// request exec timer in stepper.cpp
+timer_number aux_timer_num   = 6;	// aux motion channel in stepper.cpp (__AUX_MOTION) - TC1 runs Vref PWM on some boards
 
 // Pin assignments
 
@@ -172,10 +228,45 @@ static OutputPin<kCoolant_EnablePinNumber> mist_enable_pin;
 
 void hardware_init(void);			// master hardware init
 void hw_hard_reset(void);
+stat_t hw_check_irq_priorities(void);
+
+#ifdef __WATCHDOG
+#ifndef WATCHDOG_TIMEOUT_MS
+#define WATCHDOG_TIMEOUT_MS 1000	// main loop lockup that resets the board - 4 to 15996 ms
+#endif
+void hw_watchdog_init(void);
+void hw_watchdog_feed(void);
+stat_t hw_watchdog_callback(void);
+bool hw_reset_was_warm(void);
+#endif
+
+// Motate's timer and pin priority flags for a level in the interrupt table
+static inline uint32_t hw_timer_priority(const uint8_t level) {
+	return ((level == 0) ? kInterruptPriorityHighest : (level <= 3) ? kInterruptPriorityHigh :
+			(level <= 7) ? kInterruptPriorityMedium : (level <= 11) ? kInterruptPriorityLow : kInterruptPriorityLowest);
+}
+static inline uint32_t hw_pin_priority(const uint8_t level) {
+	return ((level == 0) ? kPinInterruptPriorityHighest : (level <= 3) ? kPinInterruptPriorityHigh :
+			(level <= 7) ? kPinInterruptPriorityMedium : (level <= 11) ? kPinInterruptPriorityLow : kPinInterruptPriorityLowest);
+}
+
+// hw_get_cycles() - free running CPU cycle count (DWT CYCCNT, started by hardware_init()).
+// Wraps every 51 seconds, so only differences are meaningful.
+// hw_get_cpu_cycles() - the same, but counts the processor's own work. It is the cycle count
+// on the target; the host build's simulated clock stands still while code runs, so there it
+// is the thread's CPU time scaled to HW_CYCLES_PER_US. Use it to time code, not motion.
+#ifdef __HOST__
+static inline uint32_t hw_get_cycles(void) { return ((uint32_t)Motate::hostGetTime()); }	// simulated clock
+static inline uint32_t hw_get_cpu_cycles(void) { return (host_get_cpu_cycles()); }
+#else
+static inline uint32_t hw_get_cycles(void) { return (HW_DWT_CYCCNT); }
+static inline uint32_t hw_get_cpu_cycles(void) { return (HW_DWT_CYCCNT); }
+#endif
 stat_t hw_flash(nvObj_t *nv);
 
 stat_t hw_set_hv(nvObj_t *nv);
 stat_t hw_get_id(nvObj_t *nv);
+stat_t hw_get_mem(nvObj_t *nv);
 
 #ifdef __TEXT_MODE
 
@@ -126,6 +126,9 @@ Invoke self test by entering $test=N where N is one of:\n\
   $test=11 small moves test\n\
   $test=12 slow moves test\n\
   $test=13 coordinate system offset test (G92, G54-G59)\n\
+  $test=14 microsteps test\n\
+  $test=50 mudflap drawing\n\
+  $test=51 braid drawing (part)\n\
 \n\
 Tests assume a centered XY origin and at least 80mm clearance in all directions\n\
 Tests assume Z has at least 40mm posiitive clearance\n\
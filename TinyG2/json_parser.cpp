@@ -31,9 +31,12 @@
 #include "json_parser.h"
 #include "text_parser.h"
 #include "canonical_machine.h"
+#include "gcode_parser.h"
 #include "report.h"
 #include "util.h"
 #include "xio.h"					// for char definitions
+#include "hardware.h"
+#include "profile_pins.h"
 
 /**** Allocation ****/
 
@@ -42,8 +45,13 @@ jsSingleton_t js;
 /**** local scope stuff ****/
 
 static stat_t _json_parser_kernal(char *str);
+static stat_t _json_parse(char *str);
+static stat_t _json_gcode_kernal(char *str);
 static stat_t _normalize_json_string(char *str, uint16_t size);
 static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth);
+static stat_t _get_array_value(nvObj_t *nv, char **pstr);
+static bool _json_ack_is_enough(void);
+static void _json_queue_ack(void);
 //static stat_t _get_nv_pair_strict(nvObj_t *nv, char **pstr, int8_t *depth);
 
 /****************************************************************************
@@ -62,8 +70,9 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth);
  *	  {"parent_name":""}
  *	  {"parent_name":{"name":"value"}}
  *	  {"parent_name":{"name1":"value1", "n2":"v2", ... "nN":"vN"}}
+ *	  {"name":[1,[2,3]]}				 - only for items flagged F_ARRAY
  *
- *	  "value" can be a string, number, true, false, or null (2 types)
+ *	  "value" can be a string, number, true, false, null (2 types), or an array
  *
  *	Numbers
  *	  - number values are not quoted and can start with a digit or -.
@@ -86,6 +95,7 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth);
 
 void json_parser(char *str)
 {
+	PROFILE_PIN_SCOPE(JSON);
 	stat_t status = _json_parser_kernal(str);
 	if (status == STAT_COMPLETE) return;	// skip the print if returning from something at already did it.
 	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
@@ -93,6 +103,27 @@ void json_parser(char *str)
 }
 
 static stat_t _json_parser_kernal(char *str)
+{
+	ritorno(_json_parse(str));
+
+	// execute the command
+	nvObj_t *nv = nv_body;
+	if (nv->valuetype == TYPE_NULL){				// means GET the value
+		ritorno(nv_get(nv));						// ritorno returns w/status on any errors
+	} else {
+        cm_parse_clear(*nv->stringp);               // parse Gcode and clear alarms if M30 or M2 is found
+        ritorno(cm_is_alarmed());                   // return error status if in alarm, shutdown or panic
+		ritorno(nv_set(nv));						// set value or call a function (e.g. gcode)
+		nv_persist(nv);
+	}
+	return (STAT_OK);								// only successful commands exit through this point
+}
+
+/*
+ * _json_parse() - parse the JSON command into the nv body and index it, without executing it
+ */
+
+static stat_t _json_parse(char *str)
 {
 	stat_t status;
 	int8_t depth;
@@ -109,32 +140,21 @@ static stat_t _json_parser_kernal(char *str)
 		if ((status = _get_nv_pair(nv, &str, &depth)) > STAT_EAGAIN) { // erred out
 			return (status);
 		}
-		// propagate the group from previous NV pair (if relevant)
-		if (group[0] != NUL) {
-			strncpy(nv->group, group, GROUP_LEN);	// copy the parent's group to this child
-		}
-		// validate the token and get the index
-		if ((nv->index = nv_get_index(nv->group, nv->token)) == NO_MATCH) {
+		// validate the token and get the index - using the group from previous NV pair (if relevant)
+		if ((nv->index = nv_get_index(group, nv->name)) == NO_MATCH) {
 			nv->valuetype = TYPE_NULL;
 			return (STAT_UNRECOGNIZED_NAME);
 		}
-		if ((nv_index_is_group(nv->index)) && (nv_group_is_prefixed(nv->token))) {
-			strncpy(group, nv->token, GROUP_LEN);	// record the group ID
+		nv_set_index(nv, nv->index, (group[0] != NUL));	// name it from the table from here on
+		if ((nv->valuetype == TYPE_ARRAY) && ((GET_TABLE_BYTE(flags) & F_ARRAY) == 0)) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);	// the item doesn't take input arrays
+		}
+		if ((nv_index_is_group(nv->index)) && (nv_group_is_prefixed(nv_token(nv)))) {
+			strncpy(group, nv_token(nv), GROUP_LEN);	// record the group ID
 		}
 		if ((nv = nv->nx) == NULL) return (STAT_JSON_TOO_MANY_PAIRS);// Not supposed to encounter a NULL
 	} while (status != STAT_OK);					// breaks when parsing is complete
-
-	// execute the command
-	nv = nv_body;
-	if (nv->valuetype == TYPE_NULL){				// means GET the value
-		ritorno(nv_get(nv));						// ritorno returns w/status on any errors
-	} else {
-        cm_parse_clear(*nv->stringp);               // parse Gcode and clear alarms if M30 or M2 is found
-        ritorno(cm_is_alarmed());                   // return error status if in alarm, shutdown or panic
-		ritorno(nv_set(nv));						// set value or call a function (e.g. gcode)
-		nv_persist(nv);
-	}
-	return (STAT_OK);								// only successful commands exit through this point
+	return (STAT_OK);
 }
 
 /*
@@ -165,6 +185,139 @@ static stat_t _normalize_json_string(char *str, uint16_t size)
 	return (STAT_OK);
 }
 
+/*
+ * json_gcode_parser()   - run a plain Gcode line received in JSON mode
+ * _json_gcode_kernal()
+ *
+ *	Plain Gcode lines in JSON mode were wrapped by the controller as {"gc":"..."} and run
+ *	through the whole JSON parser. This builds the same nv list directly. The line is
+ *	normalized as _normalize_json_string() would, linked to the nv body as the gc value and
+ *	run with gcode_parser(), so the response is byte for byte the one the wrapper gave.
+ *
+ *	Returns false for the lines the wrapper treats as something other than a plain string -
+ *	a quote in the line, nothing left after normalization (a GET of gc), a leading 0x (data),
+ *	or a line long enough to be truncated by the wrapper. These are left unmodified for the
+ *	caller to wrap as before.
+ */
+
+#define JSON_GCODE_LINE_MAX (USB_LINE_BUFFER_SIZE-12)   // longest line the wrapper copies whole
+
+bool json_gcode_parser(char *str)
+{
+	if ((strlen(str) > JSON_GCODE_LINE_MAX) || (strchr(str, '\"') != NULL)) {
+		return (false);
+	}
+	char *rd = str;
+	while ((*rd != NUL) && ((*rd <= ' ') || (*rd == DEL))) { rd++; }	// first character kept by normalization
+	if (*rd == NUL) {
+		return (false);
+	}
+	if (*rd == '0') {
+		do { rd++; } while ((*rd != NUL) && ((*rd <= ' ') || (*rd == DEL)));
+		if (tolower(*rd) == 'x') {
+			return (false);
+		}
+	}
+	stat_t status = _json_gcode_kernal(str);
+	if ((status == STAT_OK) && _json_ack_is_enough()) {
+		_json_queue_ack();
+		sr_request_status_report(SR_REQUEST_TIMED);
+	} else if (status != STAT_COMPLETE) {	// same response handling as json_parser()
+		nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+		sr_request_status_report(SR_REQUEST_TIMED);
+	}
+	return (true);
+}
+
+/*
+ * Gcode line acknowledgements
+ *
+ * _json_ack_is_enough() - true if a Gcode line that ran OK can be acknowledged in aggregate
+ * _json_queue_ack()     - count the line instead of responding to it
+ * json_flush_acks()     - send {"ack":[first_line,last_line,count,bytes]} for the waiting lines
+ * json_ack_callback()   - main-loop callback that flushes lines that have waited long enough
+ *
+ *	With $ackn set, successful plain Gcode lines don't get a full response. They are
+ *	acknowledged ackn lines at a time, or after ackt ms, with the model line numbers (N words)
+ *	of the first and last of them, how many there were, and the bytes received - the sum of
+ *	the footer byte counts they would have had (line tags with $jf=2). Lines that fail, lines with anything else to
+ *	report (e.g. messages) and all other commands get their usual response at once, after any
+ *	waiting acknowledgement, so the host sees responses in the order it sent the lines.
+ *	Responses are not coalesced in silent or exceptions-only verbosity.
+ */
+
+static bool _json_ack_is_enough()
+{
+	if ((js.json_ack_lines == 0) || (cm.machine_state == MACHINE_INITIALIZING) ||
+		(js.json_verbosity == JV_SILENT) || (js.json_verbosity == JV_EXCEPTIONS)) {
+		return (false);
+	}
+	for (nvObj_t *nv = nv_body->nx; (nv != NULL) && (nv->valuetype != TYPE_EMPTY); nv = nv->nx) {
+		if (strcmp(nv_token(nv), "n") != 0) {	// the line number is in the ack - anything else isn't
+			return (false);
+		}
+	}
+	return (true);
+}
+
+static void _json_queue_ack()
+{
+	uint32_t line = (js.json_footer_style == FOOTER_LINE_TAG) ? cs.line_tag : cm.gm.linenum;
+	if (js.ack_count == 0) {
+		js.ack_first_line = line;
+		js.ack_bytes = 0;
+		js.ack_timer = SysTickTimer_getValue() + (uint32_t)js.json_ack_interval;
+	}
+	js.ack_last_line = line;
+	js.ack_bytes += cs.linelen + 1;			// +1 for the line terminator - see json_print_response()
+	cs.linelen = 0;
+	if (++js.ack_count >= js.json_ack_lines) {
+		json_flush_acks();
+	}
+}
+
+void json_flush_acks()
+{
+	if (js.ack_count == 0) {
+		return;
+	}
+	if (js.json_syntax == JSON_SYNTAX_RELAXED) {
+		printf_P(PSTR("{ack:[%lu,%lu,%d,%d]}\n"), (unsigned long)js.ack_first_line,
+			(unsigned long)js.ack_last_line, js.ack_count, js.ack_bytes);
+	} else {
+		printf_P(PSTR("{\"ack\":[%lu,%lu,%d,%d]}\n"), (unsigned long)js.ack_first_line,
+			(unsigned long)js.ack_last_line, js.ack_count, js.ack_bytes);
+	}
+	js.ack_count = 0;
+}
+
+stat_t json_ack_callback()
+{
+	if (js.ack_count == 0) {
+		return (STAT_NOOP);
+	}
+	if (SysTickTimer_getValue() >= js.ack_timer) {
+		json_flush_acks();
+	}
+	return (STAT_OK);
+}
+
+static stat_t _json_gcode_kernal(char *str)
+{
+	nvObj_t *nv = nv_reset_nv_list();		// get a fresh nvObj list
+
+	ritorno(_normalize_json_string(str, JSON_OUTPUT_STRING_MAX));
+	nv_reset_nv(nv);
+	nv->name = "gc";
+	nv->valuetype = TYPE_STRING;
+	nv_link_string(nv, str);
+	nv->index = nv_get_index((const char *)"", nv->name);
+
+	cm_parse_clear(*nv->stringp);			// parse Gcode and clear alarms if M30 or M2 is found
+	ritorno(cm_is_alarmed());				// return error status if in alarm, shutdown or panic
+	return (gcode_parser(*nv->stringp));	// the gc value is normalized again in place, as before
+}
+
 /*
  * _get_nv_pair() - get the next name-value pair w/strict or relaxed JSON rules
  *
@@ -203,7 +356,7 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth)
 	char leaders[] = {"{,\""};      // open curly, quote and leading comma
 	char separators[] = {":\""};    // colon and quote
 	char terminators[] = {"},\""};  // close curly, comma and quote
-	char value[] = {"{\".-+"};      // open curly, quote, period, minus and plus
+	char value[] = {"{[\".-+"};     // open curly, open bracket, quote, period, minus and plus
 
 	nv_reset_nv(nv);                // wipes the object and sets the depth
 
@@ -222,7 +375,7 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth)
 	for (i=0; true; i++, (*pstr)++) {
 		if (strchr(separators, (int)**pstr) != NULL) {
 			*(*pstr)++ = NUL;
-			strncpy(nv->token, name, TOKEN_LEN+1);			// copy the string to the token
+			nv->name = name;								// the name stays in the input line
 			break;
 		}
 		if (i == MAX_NAME_CHARS) return (STAT_JSON_SYNTAX_ERROR);
@@ -258,9 +411,9 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth)
 	// strings
 	} else if (**pstr == '\"') { 				// value is a string
 		(*pstr)++;
-		nv->valuetype = TYPE_STRING;
 		if ((tmp = strchr(*pstr, '\"')) == NULL) { return (STAT_JSON_SYNTAX_ERROR);} // find the end of the string
 		*tmp = NUL;
+		nv->valuetype = TYPE_STRING;			// not before - an unterminated string has nothing to link
 
 		// if string begins with 0x it might be data, needs to be at least 3 chars long
 		if( strlen(*pstr)>=3 && (*pstr)[0]=='0' && (*pstr)[1]=='x')
@@ -269,7 +422,7 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth)
 			*v = strtoul((const char *)*pstr, 0L, 0);
 			nv->valuetype = TYPE_DATA;
 		} else {
-			ritorno(nv_copy_string(nv, *pstr));
+			nv_link_string(nv, *pstr);			// the value stays in the input line
 		}
 		*pstr = ++tmp;
 
@@ -283,9 +436,7 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth)
 
 	// arrays
 	} else if (**pstr == '[') {
-		nv->valuetype = TYPE_ARRAY;
-		ritorno(nv_copy_string(nv, *pstr));		// copy array into string for error displays
-		return (STAT_INPUT_VALUE_UNSUPPORTED);	// return error as the parser doesn't do input arrays yet
+		ritorno(_get_array_value(nv, pstr));
 
 	// general error condition
 	} else { return (STAT_JSON_SYNTAX_ERROR); }	// ill-formed JSON
@@ -304,6 +455,39 @@ static stat_t _get_nv_pair(nvObj_t *nv, char **pstr, int8_t *depth)
 	return (STAT_OK);							// signal that parsing is complete
 }
 
+/*
+ * _get_array_value() - link an input array to the string field
+ *
+ *	The elements are left in place as CSV ASCII without the outer brackets and the value is the
+ *	element count (see TYPE_ARRAY). Nested arrays are kept whole and count as one element.
+ *	It's up to the item's set function to make sense of them. Leaves the string pointer on
+ *	the character following the closing bracket.
+ */
+
+static stat_t _get_array_value(nvObj_t *nv, char **pstr)
+{
+	char *start = ++(*pstr);
+	uint8_t level = 0;
+	uint8_t count = 0;
+
+	for (; **pstr != NUL; (*pstr)++) {
+		if (**pstr == '[') {
+			level++;
+		} else if (**pstr == ']') {
+			if (level == 0) break;
+			level--;
+		} else if ((**pstr == ',') && (level == 0)) {
+			count++;
+		}
+	}
+	if (**pstr != ']') { return (STAT_JSON_SYNTAX_ERROR);}	// unterminated array
+	*(*pstr)++ = NUL;
+	nv->valuetype = TYPE_ARRAY;
+	nv->value = (*start == NUL) ? 0 : count+1;
+	nv_link_string(nv, start);
+	return (STAT_OK);
+}
+
 /****************************************************************************
  * json_serialize() - make a JSON object string from JSON object array
  *
@@ -356,10 +540,13 @@ uint16_t json_serialize(nvObj_t *nv, char *out_buf, uint16_t size)
 			if (need_a_comma) { *str++ = ',';}
 			need_a_comma = true;
 			if (js.json_syntax == JSON_SYNTAX_RELAXED) {    // write name
-				str += sprintf((char *)str, "%s:", nv->token);
+				str = strcpy_end(str, nv_token(nv));
 			} else {
-				str += sprintf((char *)str, "\"%s\":", nv->token);
+				*str++ = '\"';
+				str = strcpy_end(str, nv_token(nv));
+				*str++ = '\"';
 			}
+			*str++ = ':';
 
 			// check for illegal float values
 			if (nv->valuetype == TYPE_FLOAT) {
@@ -369,19 +556,25 @@ uint16_t json_serialize(nvObj_t *nv, char *out_buf, uint16_t size)
 			// serialize output value (arranged in rough order of likely occurrence)
 			if      (nv->valuetype == TYPE_FLOAT)   { preprocess_float(nv);
 			                                          str += fntoa(str, nv->value, nv->precision);}
-			else if (nv->valuetype == TYPE_INT)     { str += sprintf((char *)str, "%1.0f", (double)nv->value);}
-			else if (nv->valuetype == TYPE_STRING)  { str += sprintf((char *)str, "\"%s\"",(char *)*nv->stringp);}
-			else if (nv->valuetype == TYPE_ARRAY)   { str += sprintf((char *)str, "[%s]",  (char *)*nv->stringp);}
-			else if (nv->valuetype == TYPE_NULL)    { str += sprintf((char *)str, "null");} // Note that that "" is NOT null.
+			else if (nv->valuetype == TYPE_INT)     { str += fntoa(str, nv->value, 0);}
+			else if (nv->valuetype == TYPE_STRING)  { *str++ = '\"';
+			                                          str = strcpy_end(str, *nv->stringp);
+			                                          *str++ = '\"';}
+			else if (nv->valuetype == TYPE_ARRAY)   { *str++ = '[';
+			                                          str = strcpy_end(str, *nv->stringp);
+			                                          *str++ = ']';}
+			else if (nv->valuetype == TYPE_NULL)    { str = strcpy_end(str, "null");} // Note that that "" is NOT null.
             else if (nv->valuetype == TYPE_DATA)    {
 				uint32_t *v = (uint32_t*)&nv->value;
-				str += sprintf(str, "\"0x%lx\"", *v);
+				str = strcpy_end(str, "\"0x");
+				str += hextoa(str, *v);
+				*str++ = '\"';
             }
 			else if (nv->valuetype == TYPE_BOOL) {
 				if (fp_FALSE(nv->value)) {
-                    str += sprintf(str, "false");
+                    str = strcpy_end(str, "false");
                 } else {
-                    str += sprintf(str, "true");
+                    str = strcpy_end(str, "true");
                 }
 			}
 			else if (nv->valuetype == TYPE_PARENT) {
@@ -401,7 +594,7 @@ uint16_t json_serialize(nvObj_t *nv, char *out_buf, uint16_t size)
 
 	// closing curlies and NEWLINE
 	while (prev_depth-- > initial_depth) { *str++ = '}';}
-	str += sprintf((char *)str, "}\n");	// using sprintf for this last one ensures a NUL termination
+	str = strcpy_end(str, "}\n");		// copying this last one ensures a NUL termination
 	if (str > out_buf + size) { return (-1);}
 	return (str - out_buf);
 #endif
@@ -465,6 +658,7 @@ void json_print_response(uint8_t status)
 	if (js.json_verbosity == JV_SILENT) {				    // silent means no responses
         return;
     }
+	json_flush_acks();										// acknowledge earlier lines first
 	if (js.json_verbosity == JV_EXCEPTIONS)	{				// cutout for JV_EXCEPTIONS mode
 		if (status == STAT_OK) {
 			if (cm.machine_state != MACHINE_INITIALIZING) {	// always do full echo during startup
@@ -519,7 +713,11 @@ void json_print_response(uint8_t status)
     // in xio.cpp:xio.readline the CR||LF read from the host is not appended to the string.
     // to ensure that the correct number of bytes are reported back to the host we add a +1 to
     // cs.linelen so that the number of bytes received matches the number of bytes reported
-    sprintf((char *)footer_string, "%d,%d,%d", 1, status, cs.linelen + 1);
+    // with $jf=2 the line's tag takes the place of the byte count - see _dispatch_kernel()
+    char *wr = strcpy_end(footer_string, (js.json_footer_style == FOOTER_LINE_TAG) ? "2," : "1,");
+    wr += inttoa(wr, status);
+    *wr++ = ',';
+    inttoa(wr, (js.json_footer_style == FOOTER_LINE_TAG) ? cs.line_tag : cs.linelen + 1);
     cs.linelen = 0;										    // reset linelen so it's only reported once
 
 //	if (xio.enable_window_mode) {							// 2 footer styles are supported...
@@ -532,7 +730,7 @@ void json_print_response(uint8_t status)
 	nv_copy_string(nv, footer_string);						// link string to nv object
 	nv->depth = 0;											// footer 'f' is a peer to response 'r' (hard wired to 0)
 	nv->valuetype = TYPE_ARRAY;								// declare it as an array
-	strcpy(nv->token, "f");									// set it to Footer
+	nv->name = "f";											// set it to Footer
 	nv->nx = NULL;											// terminate the list
 
 	// serialize the JSON response and print it if there were no errors
@@ -575,6 +773,194 @@ stat_t json_set_jv(nvObj_t *nv)
 	return(STAT_OK);
 }
 
+/*
+ * json_set_jf() - set the footer style - 1 for the byte count, 2 for the line tag
+ */
+
+stat_t json_set_jf(nvObj_t *nv)
+{
+	if ((nv->value < FOOTER_BYTE_COUNT) || (nv->value > FOOTER_LINE_TAG)) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	js.json_footer_style = (uint8_t)nv->value;
+	return(STAT_OK);
+}
+
+#ifdef __JSON_BENCH
+/***********************************************************************************
+ * JSON BENCHMARK AND FUZZ
+ *
+ * json_run_bench() - {"jbench":n} runs the corpus n times, then n * JSON_BENCH_FUZZ_CASES fuzz cases
+ *
+ *	The corpus is the traffic an HMI sends: status and queue report requests, group and
+ *	single value GETs, {"gc":...} lines and status report setup. Each line is parsed into the
+ *	nv list by _json_parse() - what json_parser() does before executing it. GETs are then
+ *	populated by nv_get() and every line is serialized the way its response would be. SETs
+ *	are not executed, so running the bench changes nothing. Times are CPU time
+ *	(hw_get_cpu_cycles()) in ns per line; in and out are bytes per line:
+ *
+ *	  {"jbench":{"lines":n,"in":n,"out":n,"parse":ns,"get":ns,"ser":ns,
+ *				 "fuzz":[cases,rejected,max_parse_ns],"faults":n,"worst":"..."}}
+ *
+ *	Fuzz cases are corpus lines put through a fixed sequence of random edits - bytes changed,
+ *	deleted or inserted from JSON punctuation, and runs repeated to build long names, long
+ *	strings, deep nesting and many pairs - up to JSON_OUTPUT_STRING_MAX. Each is parsed and
+ *	whatever made it into the nv list is serialized into a guarded buffer. A fault is a
+ *	serialization that wrote past its buffer, or a shared string that went past
+ *	NV_SHARED_STRING_LEN or overwrote its guard. worst is the case that took longest to
+ *	parse, cut to JSON_BENCH_WORST_LEN with quotes, backslashes and control characters shown as '.'.
+ *
+ *	The bench uses the nv list, so the command that ran it gets no response body.
+ */
+#define JSON_BENCH_FUZZ_CASES	100			// fuzz cases per corpus pass
+#define JSON_BENCH_GUARD		64			// guard bytes past the serialization buffer
+#define JSON_BENCH_GUARD_BYTE	0xA5
+#define JSON_BENCH_WORST_LEN	64			// characters of the worst case to report
+
+static const char *const jb_corpus[] = {
+	"{\"sr\":null}",
+	"{\"qr\":null}",
+	"{\"sr\":\"\"}",
+	"{\"x\":null}",
+	"{\"1\":null}",
+	"{\"sys\":null}",
+	"{\"posx\":null}",
+	"{\"mpo\":null}",
+	"{\"g54\":null}",
+	"{\"gc\":\"N1234 G1 X10.5 Y-3.25 F1200\"}",
+	"{\"gc\":\"g0 x0 y0 z5\"}",
+	"{\"gc\":\"G2 X20 Y0 I10 J0 (arc)\"}",
+	"{\"sr\":{\"line\":true,\"posx\":true,\"posy\":true,\"posz\":true,\"vel\":true,\"stat\":true}}",
+	"{\"xvm\":16000}",
+	"{\"x\":{\"vm\":16000,\"fr\":16000,\"jm\":5000}}",
+	"{\"1mi\":8}"
+};
+#define JSON_BENCH_CORPUS (sizeof(jb_corpus)/sizeof(char *))
+
+static const char jb_punctuation[] = "{}[]\":,-.0123456789nultrfe ";
+
+static struct jsonBench {
+	char line[JSON_OUTPUT_STRING_MAX+1];	// the line being parsed - the parser writes on it
+	char fuzz[JSON_OUTPUT_STRING_MAX+1];	// the fuzz case
+	char worst[JSON_OUTPUT_STRING_MAX+1];	// the slowest case to parse
+	char out[JSON_OUTPUT_STRING_MAX+JSON_BENCH_GUARD];
+	uint32_t seed;
+} jb;
+
+static uint32_t _jb_random(const uint32_t range)
+{
+	jb.seed ^= jb.seed << 13;				// xorshift32
+	jb.seed ^= jb.seed >> 17;
+	jb.seed ^= jb.seed << 5;
+	return (jb.seed % range);
+}
+
+static uint16_t _jb_mutate(char *str, uint16_t len)
+{
+	for (uint8_t edits = 1 + _jb_random(8); edits > 0; edits--) {
+		uint16_t pos = _jb_random(len+1);
+		switch (_jb_random(4)) {
+			case 0: {								// change a byte
+				if (pos < len) { str[pos] = 1 + _jb_random(255);}
+				break;
+			}
+			case 1: {								// delete one
+				if (pos < len) { memmove(&str[pos], &str[pos+1], len-pos); len--;}
+				break;
+			}
+			case 2: {								// insert punctuation
+				if (len < JSON_OUTPUT_STRING_MAX) {
+					memmove(&str[pos+1], &str[pos], len-pos+1);
+					str[pos] = jb_punctuation[_jb_random(sizeof(jb_punctuation)-1)];
+					len++;
+				}
+				break;
+			}
+			default: {								// repeat a run up to some length
+				uint16_t run = min((uint16_t)(1 + _jb_random(16)), (uint16_t)(len-min(pos,len)));
+				uint16_t target = min((uint16_t)(len + _jb_random(JSON_OUTPUT_STRING_MAX)), (uint16_t)JSON_OUTPUT_STRING_MAX);
+				while ((run > 0) && (len + run <= target)) {
+					memmove(&str[pos+run], &str[pos], len-pos+1);
+					len += run;
+				}
+			}
+		}
+	}
+	str[len] = NUL;
+	return (len);
+}
+
+static bool _jb_serialize_faulted(uint16_t *bytes)
+{
+	memset(&jb.out[JSON_OUTPUT_STRING_MAX], JSON_BENCH_GUARD_BYTE, JSON_BENCH_GUARD);
+	*bytes = json_serialize(nv_body, jb.out, JSON_OUTPUT_STRING_MAX);
+	for (uint8_t i=0; i<JSON_BENCH_GUARD; i++) {
+		if ((uint8_t)jb.out[JSON_OUTPUT_STRING_MAX+i] != JSON_BENCH_GUARD_BYTE) { return (true);}
+	}
+	return ((nvStr.wp > NV_SHARED_STRING_LEN) || BAD_MAGIC(nvStr.magic_end));
+}
+
+stat_t json_run_bench(nvObj_t *nv)
+{
+	uint16_t passes = max((uint16_t)nv->value, (uint16_t)1);
+	uint32_t lines = 0, faults = 0, in_bytes = 0, out_bytes = 0;
+	uint64_t parse = 0, get = 0, ser = 0;
+	uint16_t bytes;
+
+	for (uint16_t pass=0; pass<passes; pass++) {
+		for (uint8_t i=0; i<JSON_BENCH_CORPUS; i++) {
+			strcpy(jb.line, jb_corpus[i]);
+			in_bytes += strlen(jb.line);
+			uint32_t start = hw_get_cpu_cycles();
+			stat_t status = _json_parse(jb.line);
+			uint32_t parsed = hw_get_cpu_cycles();
+			if ((status == STAT_OK) && (nv_body->valuetype == TYPE_NULL)) {
+				nv_get(nv_body);
+			}
+			uint32_t got = hw_get_cpu_cycles();
+			faults += _jb_serialize_faulted(&bytes);
+			parse += parsed - start;
+			get += got - parsed;
+			ser += hw_get_cpu_cycles() - got;
+			out_bytes += bytes;
+			lines++;
+		}
+	}
+
+	uint32_t cases = (uint32_t)passes * JSON_BENCH_FUZZ_CASES;
+	uint32_t rejected = 0, worst = 0;
+	jb.seed = 2463534242UL;							// the same cases every run
+	jb.worst[0] = NUL;
+	for (uint32_t c=0; c<cases; c++) {
+		strcpy(jb.fuzz, jb_corpus[_jb_random(JSON_BENCH_CORPUS)]);
+		_jb_mutate(jb.fuzz, strlen(jb.fuzz));
+		strcpy(jb.line, jb.fuzz);
+		uint32_t start = hw_get_cpu_cycles();
+		rejected += (_json_parse(jb.line) != STAT_OK);
+		uint32_t cycles = hw_get_cpu_cycles() - start;
+		faults += _jb_serialize_faulted(&bytes);
+		if (cycles > worst) {
+			worst = cycles;
+			strcpy(jb.worst, jb.fuzz);
+		}
+	}
+	jb.worst[JSON_BENCH_WORST_LEN] = NUL;
+	for (char *c = jb.worst; *c != NUL; c++) {
+		if ((*c < ' ') || (*c > '~') || (*c == '\"') || (*c == '\\')) { *c = '.';}
+	}
+
+	nv_reset_nv_list();								// leave nothing of the bench to respond with
+	double ns_per_line = 1000.0 / HW_CYCLES_PER_US / lines;
+	printf_P(PSTR("{\"jbench\":{\"lines\":%lu,\"in\":%0.1f,\"out\":%0.1f,\"parse\":%0.0f,\"get\":%0.0f,\"ser\":%0.0f,"),
+		(unsigned long)lines, (double)in_bytes / lines, (double)out_bytes / lines,
+		parse * ns_per_line, get * ns_per_line, ser * ns_per_line);
+	printf_P(PSTR("\"fuzz\":[%lu,%lu,%0.0f],\"faults\":%lu,\"worst\":\"%s\"}}\n"),
+		(unsigned long)cases, (unsigned long)rejected, worst * 1000.0 / HW_CYCLES_PER_US,
+		(unsigned long)faults, jb.worst);
+	return (STAT_COMPLETE);
+}
+#endif // __JSON_BENCH
+
 /***********************************************************************************
  * TEXT MODE SUPPORT
  * Functions to print variables from the cfgArray table
@@ -587,18 +973,26 @@ stat_t json_set_jv(nvObj_t *nv)
  * js_print_jv()
  * js_print_js()
  * js_print_jf()
+ * js_print_ackn()
+ * js_print_ackt()
  */
 
 static const char fmt_ej[] PROGMEM = "[ej]  enable json mode%13d [0=text,1=JSON]\n";
 static const char fmt_jv[] PROGMEM = "[jv]  json verbosity%15d [0=silent,1=footer,2=messages,3=configs,4=linenum,5=verbose]\n";
 static const char fmt_js[] PROGMEM = "[js]  json serialize style%9d [0=relaxed,1=strict]\n";
-static const char fmt_jf[] PROGMEM = "[jf]  json footer style%12d [1=checksum,2=window report]\n";
+static const char fmt_jf[] PROGMEM = "[jf]  json footer style%12d [1=byte count,2=line tag]\n";
 
 void js_print_ej(nvObj_t *nv) { text_print(nv, fmt_ej);}    // TYPE_INT
 void js_print_jv(nvObj_t *nv) { text_print(nv, fmt_jv);}    // TYPE_INT
 void js_print_js(nvObj_t *nv) { text_print(nv, fmt_js);}    // TYPE_INT
 void js_print_jf(nvObj_t *nv) { text_print(nv, fmt_jf);}    // TYPE_INT
 
+static const char fmt_ackn[] PROGMEM = "[ackn] gcode lines per ack%9d [0=respond to every line]\n";
+static const char fmt_ackt[] PROGMEM = "[ackt] ack interval%21.0f ms\n";
+
+void js_print_ackn(nvObj_t *nv) { text_print(nv, fmt_ackn);}    // TYPE_INT
+void js_print_ackt(nvObj_t *nv) { text_print(nv, fmt_ackt);}    // TYPE_FLOAT
+
 #endif // __TEXT_MODE
 
 
@@ -636,7 +1030,7 @@ static stat_t _get_nv_pair_strict(nvObj_t *nv, char **pstr, int8_t *depth)
 	if ((*pstr = strchr(*pstr, '\"')) == NULL) { return (STAT_JSON_SYNTAX_ERROR);}
 	if ((tmp = strchr(++(*pstr), '\"')) == NULL) { return (STAT_JSON_SYNTAX_ERROR);}
 	*tmp = NUL;
-	strncpy(nv->token, *pstr, TOKEN_LEN);		// copy the string to the token
+	nv->name = *pstr;							// the name stays in the input line
 
 	// --- Process value part ---  (organized from most to least frequently encountered)
 	*pstr = ++tmp;
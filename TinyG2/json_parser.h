@@ -37,6 +37,21 @@
 #define FOOTER_REVISION 1
 #define JSON_OUTPUT_STRING_MAX (OUTPUT_BUFFER_LEN)
 
+#ifndef JSON_ACK_LINES
+#define JSON_ACK_LINES      0           // Gcode lines acknowledged by one {"ack":...}. 0 responds to every line
+#endif
+#ifndef JSON_ACK_INTERVAL
+#define JSON_ACK_INTERVAL   100         // ms a Gcode line may wait to be acknowledged
+#endif
+#ifndef JSON_FOOTER_STYLE
+#define JSON_FOOTER_STYLE   FOOTER_BYTE_COUNT   // one of: FOOTER_BYTE_COUNT, FOOTER_LINE_TAG
+#endif
+
+enum jsonFooterStyle {				// first element of the footer array
+	FOOTER_BYTE_COUNT = 1,			// "f":[1,status,bytes received]
+	FOOTER_LINE_TAG					// "f":[2,status,line tag] - the N the host put on the line
+};
+
 enum jsonVerbosity {
 	JV_SILENT = 0,					// no response is provided for any command
 	JV_FOOTER,						// returns footer only (no command echo, gcode blocks or messages)
@@ -64,6 +79,7 @@ typedef struct jsSingleton {
 	/*** config values (PUBLIC) ***/
 	uint8_t json_verbosity;			// see enum in this file for settings
 	uint8_t json_syntax;			// 0=relaxed syntax, 1=strict syntax
+	uint8_t json_footer_style;		// see enum in this file for settings
 
 	uint8_t echo_json_footer;		// flags for JSON responses serialization
 	uint8_t echo_json_messages;
@@ -71,8 +87,17 @@ typedef struct jsSingleton {
 	uint8_t echo_json_linenum;
 	uint8_t echo_json_gcode_block;
 
+	uint8_t json_ack_lines;			// Gcode lines per acknowledgement, 0 to respond to each line
+	float json_ack_interval;		// ms before waiting lines are acknowledged anyway
+
 	/*** runtime values (PRIVATE) ***/
 
+	uint8_t ack_count;				// Gcode lines waiting to be acknowledged
+	uint16_t ack_bytes;				// bytes received in those lines, as the footer counts them
+	uint32_t ack_first_line;		// model line numbers of the first and last lines
+	uint32_t ack_last_line;
+	uint32_t ack_timer;				// SysTick time the waiting lines must be acknowledged by
+
 } jsSingleton_t;
 
 /**** Externs - See report.c for allocation ****/
@@ -82,12 +107,19 @@ extern jsSingleton_t js;
 /**** Function Prototypes ****/
 
 void json_parser(char *str);
+bool json_gcode_parser(char *str);
 uint16_t json_serialize(nvObj_t *nv, char *out_buf, uint16_t size);
 void json_print_object(nvObj_t *nv);
 void json_print_response(uint8_t status);
 void json_print_list(stat_t status, uint8_t flags);
+void json_flush_acks(void);
+stat_t json_ack_callback(void);
 
 stat_t json_set_jv(nvObj_t *nv);
+stat_t json_set_jf(nvObj_t *nv);
+#ifdef __JSON_BENCH
+stat_t json_run_bench(nvObj_t *nv);
+#endif
 
 #ifdef __TEXT_MODE
 
@@ -95,6 +127,8 @@ stat_t json_set_jv(nvObj_t *nv);
 	void js_print_jv(nvObj_t *nv);
 	void js_print_js(nvObj_t *nv);
 	void js_print_jf(nvObj_t *nv);
+	void js_print_ackn(nvObj_t *nv);
+	void js_print_ackt(nvObj_t *nv);
 
 #else
 
@@ -102,6 +136,8 @@ stat_t json_set_jv(nvObj_t *nv);
 	#define js_print_jv tx_print_stub
 	#define js_print_js tx_print_stub
 	#define js_print_jf tx_print_stub
+	#define js_print_ackn tx_print_stub
+	#define js_print_ackt tx_print_stub
 
 #endif // __TEXT_MODE
 
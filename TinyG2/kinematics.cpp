@@ -28,13 +28,47 @@
 #include "tinyg2.h"
 #include "config.h"
 #include "canonical_machine.h"
+#include "planner.h"
+#include "plan_shaper.h"
 #include "stepper.h"
 #include "kinematics.h"
+#include "hardware.h"
+#include "text_parser.h"
+#include "util.h"
 
-static void _inverse_kinematics(const float travel[], float joint[]);
+knSingleton_t kn;
+
+typedef void (*knTransform_t)(const float in[], float out[]);
+
+static void _cartesian_inverse(const float travel[], float joint[]);
+static void _cartesian_forward(const float joint[], float travel[]);
+static void _corexy_inverse(const float travel[], float joint[]);
+static void _corexy_forward(const float joint[], float travel[]);
+static void _delta_inverse(const float travel[], float joint[]);
+static void _delta_forward(const float joint[], float travel[]);
+static void _scara_inverse(const float travel[], float joint[]);
+static void _scara_forward(const float joint[], float travel[]);
+
+static const knTransform_t _inverse[KINEMATICS_MAX_TYPE] = {
+	_cartesian_inverse, _corexy_inverse, _delta_inverse, _scara_inverse };
+static const knTransform_t _forward[KINEMATICS_MAX_TYPE] = {
+	_cartesian_forward, _corexy_forward, _delta_forward, _scara_forward };
+
+static knTransform_t _inverse_kinematics = _cartesian_inverse;	// selected by kn_set_knty()
+static knTransform_t _forward_kinematics = _cartesian_forward;
+
+static void _inverse_joints(const float travel[], float joint[]);
+static float _unwrap_degrees(const float angle, const float reference);
+#ifdef __ROTARY_TCP
+static void _tcp_to_machine(const float travel[], float machine[]);
+static void _tcp_to_work(const float machine[], float travel[]);
+#endif
+#ifdef __HEIGHT_MAP
+static float _get_height_offset(float x, float y);
+#endif
 
 /*
- * ik_kinematics() - wrapper routine for inverse kinematics
+ * kn_inverse_kinematics() - wrapper routine for inverse kinematics
  *
  *	Calls kinematics function(s).
  *	Performs axis mapping & conversion of length units to steps (and deals with inhibited axes)
@@ -49,69 +83,808 @@ void kn_inverse_kinematics(const float travel[], float steps[])
 {
 	float joint[AXES];
 
-	_inverse_kinematics(travel, joint);				// insert inverse kinematics transformations here
+	_inverse_joints(travel, joint);					// model selected by the {knty:n} setting
+	if (kn.type == KINEMATICS_SCARA) {
+		kn.scara_shoulder = joint[AXIS_X];			// runtime solutions come in path order - see _scara_inverse()
+	}
 
 	// Map motors to axes and convert length units to steps
-	// Most of the conversion math has already been done in during config in steps_per_unit()
-	// which takes axis travel, step angle and microsteps into account.
+	// All of the conversion math has already been done during config in kn_update_motor_map()
+	// which takes axis travel, step angle, microsteps and inhibited axes into account.
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		steps[motor] = joint[kn.motor_joint[motor]] * kn.motor_steps_per_unit[motor];
+	}
+}
+
+/*
+ * kn_update_motor_map() - rebuild the motor-to-joint table used by kn_inverse_kinematics()
+ *
+ *	Must be called whenever a motor map, steps per unit or axis mode changes. Motors that
+ *	are unmapped, drive an inhibited axis or are run by the aux channel get a zero scale
+ *	so they never step. The input
+ *	shaper is rebuilt here too, as it also goes by the motor map, and so is the step rate
+ *	limit of each joint (see kn_get_step_time()).
+ */
+
+void kn_update_motor_map()
+{
 	for (uint8_t axis=0; axis<AXES; axis++) {
-		if (cm.a[axis].axis_mode == AXIS_INHIBITED) { joint[axis] = 0;}
-		if (st_cfg.mot[MOTOR_1].motor_map == axis) { steps[MOTOR_1] = joint[axis] * st_cfg.mot[MOTOR_1].steps_per_unit;}
-		if (st_cfg.mot[MOTOR_2].motor_map == axis) { steps[MOTOR_2] = joint[axis] * st_cfg.mot[MOTOR_2].steps_per_unit;}
-		if (st_cfg.mot[MOTOR_3].motor_map == axis) { steps[MOTOR_3] = joint[axis] * st_cfg.mot[MOTOR_3].steps_per_unit;}
-		if (st_cfg.mot[MOTOR_4].motor_map == axis) { steps[MOTOR_4] = joint[axis] * st_cfg.mot[MOTOR_4].steps_per_unit;}
-#if (MOTORS >= 5)
-		if (st_cfg.mot[MOTOR_5].motor_map == axis) { steps[MOTOR_5] = joint[axis] * st_cfg.mot[MOTOR_5].steps_per_unit;}
+		kn.joint_step_time[axis] = 0;
+	}
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		uint8_t axis = st_cfg.mot[motor].motor_map;
+#ifdef __AUX_MOTION
+		if (st_aux_is_motor(motor)) {
+			axis = AXES;										// run by the aux channel, not the planner
+		}
 #endif
-#if (MOTORS >= 6)
-		if (st_cfg.mot[MOTOR_6].motor_map == axis) { steps[MOTOR_6] = joint[axis] * st_cfg.mot[MOTOR_6].steps_per_unit;}
+		if ((axis < AXES_ACTIVE) && (cm.a[axis].axis_mode != AXIS_INHIBITED)) {
+			kn.motor_joint[motor] = axis;
+			kn.motor_steps_per_unit[motor] = st_cfg.mot[motor].steps_per_unit;
+
+			float steps_per_unit = st_cfg.mot[motor].steps_per_unit;
+#ifdef __MICROSTEP_MORPH
+			steps_per_unit /= (1 << st_cfg.mot[motor].morph_shift_max);	// physical steps at speed
 #endif
+			kn.joint_step_time[axis] = max(kn.joint_step_time[axis], steps_per_unit / (STEP_RATE_MAX * 60));
+		} else {
+			kn.motor_joint[motor] = 0;
+			kn.motor_steps_per_unit[motor] = 0;
+		}
 	}
+#ifdef __INPUT_SHAPING
+	mp_shaper_configure();									// motors take the shaper of their axis
+#endif
+}
+
+/*
+ * kn_forward_kinematics() - convert motor steps back to axis positions
+ *
+ *	Undoes the motor map and then applies the forward transform of the selected model.
+ *	Joints that have no motor mapped to them take the current runtime position so that
+ *	callers that feed the result back into a move (probing, G28.4 homing) leave them alone.
+ *	Not time critical - this is only run on switch closures, not once per segment.
+ */
+
+void kn_forward_kinematics(const float steps[], float travel[])
+{
+	float joint[AXES];
 
-/* The above is a loop unrolled version of this:
 	for (uint8_t axis=0; axis<AXES; axis++) {
-		for (uint8_t motor=0; motor<MOTORS; motor++) {
-			if (st_cfg.mot[motor].motor_map == axis) {
-				steps[motor] = joint[axis] * st_cfg.mot[motor].steps_per_unit;
-			}
+		joint[axis] = mp_get_runtime_absolute_position(axis);
+	}
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		uint8_t axis = st_cfg.mot[motor].motor_map;
+		if (axis < AXES) {
+			joint[axis] = steps[motor] * st_cfg.mot[motor].units_per_step;
 		}
 	}
-*/
+	_forward_kinematics(joint, travel);
+#ifdef __HEIGHT_MAP
+	if (kn_height_map_is_active()) {				// the offset only depends on X and Y
+		travel[AXIS_Z] -= _get_height_offset(travel[AXIS_X], travel[AXIS_Y]);
+	}
+#endif
+#ifdef __ROTARY_TCP
+	if (kn.tcp_axes != 0) {
+		float machine[AXES];
+		memcpy(machine, travel, sizeof(float)*AXES);
+		_tcp_to_work(machine, travel);
+	}
+#endif
+}
+
+/*
+ * _inverse_joints() - inverse transform of the selected model, after tool center point
+ *					   control and height map compensation
+ */
+
+static void _inverse_joints(const float travel[], float joint[])
+{
+#if defined(__ROTARY_TCP) || defined(__HEIGHT_MAP)
+	float point[AXES];
+	const float *machine = travel;
+#endif
+#ifdef __ROTARY_TCP
+	if (kn.tcp_axes != 0) {
+		_tcp_to_machine(travel, point);
+		machine = point;
+	}
+#endif
+#ifdef __HEIGHT_MAP
+	if (kn_height_map_is_active()) {
+		if (machine != point) {
+			memcpy(point, travel, sizeof(float)*AXES_ACTIVE);
+		}
+		point[AXIS_Z] += _get_height_offset(point[AXIS_X], point[AXIS_Y]);
+		machine = point;
+	}
+#endif
+#if defined(__ROTARY_TCP) || defined(__HEIGHT_MAP)
+	_inverse_kinematics(machine, joint);
+#else
+	_inverse_kinematics(travel, joint);
+#endif
+}
+
+/*
+ * kn_get_step_time() - minutes the motors need for a travel at their highest step rate
+ *
+ *	Travel is relative, in mm or degrees, and may be a unit vector (giving minutes per unit of
+ *	path). For the linear models the joint travel is the inverse transform of the travel itself.
+ *	Delta and SCARA joint speeds change with position, so they are left to the axis velocity
+ *	limits and return 0. Run at plan time only.
+ */
+
+float kn_get_step_time(const float travel[])
+{
+	if ((kn.type != KINEMATICS_CARTESIAN) && (kn.type != KINEMATICS_COREXY)) {
+		return (0);
+	}
+	float joint[AXES];
+	_inverse_kinematics(travel, joint);
+
+	float time = 0;
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		time = max(time, (float)fabs(joint[axis]) * kn.joint_step_time[axis]);
+	}
+	return (time);
+}
+
+/*
+ * kn_offset_z() - shift motor steps already through the inverse kinematics by a Z offset
+ *
+ *	For every model here moving the tool in Z alone moves the Z joint by the same amount - or
+ *	all three carriages of a delta. So a Z correction made at runtime (torch height control)
+ *	needs no second IK solution.
+ */
+
+void kn_offset_z(const float offset, float steps[])
+{
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		uint8_t joint = kn.motor_joint[motor];
+		if ((joint == AXIS_Z) || ((kn.type == KINEMATICS_DELTA) && (joint < AXIS_Z))) {
+			steps[motor] += offset * kn.motor_steps_per_unit[motor];	// 0 for unmapped motors
+		}
+	}
+}
+
+/*
+ * kn_kinematics_is_linear() - true if joint space is a linear map of Cartesian space
+ *
+ *	For linear models the joint positions of a straight line are themselves a straight
+ *	line, so exec may scale a single IK result instead of solving every segment. A height
+ *	map bends every line in Z, so it makes any model nonlinear - and so does turning the work
+ *	under tool center point control.
+ */
+
+bool kn_kinematics_is_linear()
+{
+#ifdef __ROTARY_TCP
+	if (kn.tcp_axes != 0) {
+		return (false);
+	}
+#endif
+#ifdef __HEIGHT_MAP
+	if (kn_height_map_is_active()) {
+		return (false);
+	}
+#endif
+	return ((kn.type == KINEMATICS_CARTESIAN) || (kn.type == KINEMATICS_COREXY));
 }
 
 /*
- * _inverse_kinematics() - inverse kinematics - example is for a cartesian machine
+ * kn_get_subdivisions() - number of sub-chords needed to interpolate a line in joint space
  *
- *	You can glue in inverse kinematics here, but be aware of time budget constraints.
- *	This function is run during the _exec() portion of the cycle and will therefore
- *	be run once per interpolation segment. The total time for the segment load,
- *	including the inverse kinematics transformation cannot exceed the segment time,
- *	and ideally should be no more than 25-50% of the segment time. Currently segments
- *	run every 1.5 ms, but this might be lowered. To profile this time look at the
- *	time it takes to complete the mp_exec_move() function.
+ *	Run by mp_aline() at plan time. For a nonlinear model a straight Cartesian line is a curve
+ *	in joint space. Exec solves IK only at the ends of each sub-chord and interpolates the
+ *	steps linearly in between, so each sub-chord must stay within the joint tolerance of
+ *	the curve it replaces.
  *
- *	Note: the compiler will  inline trivial functions (like memcpy) so there is no
- *	size or performance penalty for breaking this out
+ *	The deviation is sampled at the midpoint of the line and at the midpoints of its two
+ *	halves (5 IK solutions). Chord deviation scales with the square of the chord length, so
+ *	n sub-chords deviate by about d/n^2, where d is the larger of the whole-line estimate and
+ *	4x the half-line estimate. The second sample catches curvature that is concentrated at
+ *	one end. Returns 1 for linear models or a zero tolerance, meaning IK on every segment.
  */
-static void _inverse_kinematics(const float travel[], float joint[])
+
+static float _joint_deviation(const float a[], const float b[], const float mid[])
 {
-	memcpy(joint, travel, sizeof(float)*AXES);		// just do a memcpy for Cartesian machines
+	float deviation = 0;
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		deviation = max(deviation, (float)fabs(mid[axis] - (a[axis] + b[axis]) * 0.5));
+	}
+	return (deviation);
+}
+
+uint8_t kn_get_subdivisions(const float start[], const float end[])
+{
+	if (kn_kinematics_is_linear() || fp_ZERO(kn.joint_tolerance)) {
+		return (1);
+	}
+	float point[AXES];
+	float j0[AXES], j1[AXES], j2[AXES], j3[AXES], j4[AXES];	// joints at 0, 1/4, 1/2, 3/4, 1
+
+	_inverse_joints(start, j0);
+	_inverse_joints(end, j4);
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) { point[axis] = start[axis] + (end[axis] - start[axis]) * 0.5;}
+	_inverse_joints(point, j2);
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) { point[axis] = start[axis] + (end[axis] - start[axis]) * 0.25;}
+	_inverse_joints(point, j1);
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) { point[axis] = start[axis] + (end[axis] - start[axis]) * 0.75;}
+	_inverse_joints(point, j3);
+	if (kn.type == KINEMATICS_SCARA) {				// the shoulder along the line, not the runtime's
+		j1[AXIS_X] = _unwrap_degrees(j1[AXIS_X], j0[AXIS_X]);
+		j2[AXIS_X] = _unwrap_degrees(j2[AXIS_X], j1[AXIS_X]);
+		j3[AXIS_X] = _unwrap_degrees(j3[AXIS_X], j2[AXIS_X]);
+		j4[AXIS_X] = _unwrap_degrees(j4[AXIS_X], j3[AXIS_X]);
+	}
 
-//	for (uint8_t i=0; i<AXES; i++) {
-//		joint[i] = travel[i];
-//	}
+	float deviation = max(_joint_deviation(j0, j4, j2),
+					  4 * max(_joint_deviation(j0, j2, j1), _joint_deviation(j2, j4, j3)));
+	float subdivisions = ceil(sqrt(deviation / kn.joint_tolerance));
+	return ((uint8_t)max((float)1, min(subdivisions, (float)KINEMATICS_MAX_SUBDIVISIONS)));
 }
 
 /*
- * ik_forward_kinematics() - forward kinematics for a cartesian machine
+ * Kinematic models
+ *
+ *	The inverse transforms are run during the _exec() portion of the cycle and will therefore
+ *	be run once per interpolation segment. The total time for the segment load, including the
+ *	inverse kinematics transformation cannot exceed the segment time, and ideally should be
+ *	no more than 25-50% of the segment time. Currently segments run every 1.5 ms, but this
+ *	might be lowered. To profile this time look at the time it takes to complete the
+ *	mp_exec_move() function.
+ *
+ *	The M3 has no FPU so every float operation is a libgcc soft-float call. The worst-case
+ *	cycle counts below are estimates built from operation counts using roughly 60 cycles per
+ *	add or multiply, 150 per divide, 700 per sqrtf and 2500-4000 per newlib trig call. They
+ *	have not been measured on hardware - confirm them against mp_exec_move() timing before
+ *	lowering the segment time on a non-Cartesian machine. At 84 MHz a 1.5 ms segment is
+ *	126,000 cycles, so the 25% budget is ~31,000 cycles.
+ *
+ *	  Cartesian   memcpy                              ~50 cycles
+ *	  CoreXY      2 adds                             ~150 cycles
+ *	  Delta       3 sqrtf + 15 add/mul             ~3,000 cycles
+ *	  SCARA       acosf + 2 atan2f + ~12 add/mul  ~12,000 cycles
+ *	  TCP         sinf + cosf per table rotary    ~7,000 cycles each, ahead of the model
+ *
+ *	Joints not used by a model (e.g. Z on CoreXY and SCARA, A, B, C on all of them) pass
+ *	straight through.
  */
 
-void kn_forward_kinematics(const float steps[], float travel[])
+static void _cartesian_inverse(const float travel[], float joint[])
 {
-    travel[AXIS_X] = steps[MOTOR_1] * st_cfg.mot[MOTOR_1].units_per_step;
-    travel[AXIS_Y] = steps[MOTOR_2] * st_cfg.mot[MOTOR_2].units_per_step;
-    travel[AXIS_Z] = steps[MOTOR_3] * st_cfg.mot[MOTOR_3].units_per_step;
-    travel[AXIS_A] = steps[MOTOR_4] * st_cfg.mot[MOTOR_4].units_per_step;
-    travel[AXIS_B] = steps[MOTOR_5] * st_cfg.mot[MOTOR_5].units_per_step;
-    travel[AXIS_C] = steps[MOTOR_6] * st_cfg.mot[MOTOR_6].units_per_step;
+	memcpy(joint, travel, sizeof(float)*AXES_ACTIVE);		// just do a memcpy for Cartesian machines
 }
+
+static void _cartesian_forward(const float joint[], float travel[])
+{
+	memcpy(travel, joint, sizeof(float)*AXES);
+}
+
+/*
+ * CoreXY - the two belts are a 45 degree rotation (and scale) of X and Y
+ *
+ *	A = X + Y, B = X - Y. Since this is linear the body fast path in exec remains valid.
+ */
+
+static void _corexy_inverse(const float travel[], float joint[])
+{
+	memcpy(joint, travel, sizeof(float)*AXES_ACTIVE);
+	joint[AXIS_X] = travel[AXIS_X] + travel[AXIS_Y];
+	joint[AXIS_Y] = travel[AXIS_X] - travel[AXIS_Y];
+}
+
+static void _corexy_forward(const float joint[], float travel[])
+{
+	memcpy(travel, joint, sizeof(float)*AXES);
+	travel[AXIS_X] = (joint[AXIS_X] + joint[AXIS_Y]) * 0.5;
+	travel[AXIS_Y] = (joint[AXIS_X] - joint[AXIS_Y]) * 0.5;
+}
+
+/*
+ * Linear delta - three vertical carriages on towers at 210, 330 and 90 degrees
+ *
+ *	Each carriage sits one rod length from its effector joint, so its height is
+ *	Z + sqrt(L^2 - dx^2 - dy^2). Joints are reported relative to the height at X0 Y0 so
+ *	that the effector origin is the step origin. A point outside the reachable circle
+ *	would take the root of a negative number; it is clamped to zero here and soft limits
+ *	are expected to keep moves inside the working envelope.
+ */
+
+static void _delta_inverse(const float travel[], float joint[])
+{
+	memcpy(joint, travel, sizeof(float)*AXES_ACTIVE);
+	for (uint8_t i=0; i<3; i++) {
+		float dx = kn.delta_tower_x[i] - travel[AXIS_X];
+		float dy = kn.delta_tower_y[i] - travel[AXIS_Y];
+		float h2 = kn.delta_rod_2 - dx*dx - dy*dy;
+		joint[AXIS_X+i] = travel[AXIS_Z] + ((h2 > 0) ? sqrt(h2) : 0) - kn.delta_height;
+	}
+}
+
+/*
+ * _delta_forward() - trilateration of the three rod spheres
+ *
+ *	Builds a frame with tower 1 at the origin, ex toward tower 2 and ey toward tower 3,
+ *	solves for the sphere intersection in that frame and takes the solution below the
+ *	carriages.
+ */
+
+static void _delta_forward(const float joint[], float travel[])
+{
+	float z1 = joint[AXIS_X] + kn.delta_height;
+	float z2 = joint[AXIS_Y] + kn.delta_height;
+	float z3 = joint[AXIS_Z] + kn.delta_height;
+
+	float p12[3] = { kn.delta_tower_x[1] - kn.delta_tower_x[0], kn.delta_tower_y[1] - kn.delta_tower_y[0], z2 - z1 };
+	float p13[3] = { kn.delta_tower_x[2] - kn.delta_tower_x[0], kn.delta_tower_y[2] - kn.delta_tower_y[0], z3 - z1 };
+
+	float d = sqrt(p12[0]*p12[0] + p12[1]*p12[1] + p12[2]*p12[2]);
+	float ex[3] = { p12[0]/d, p12[1]/d, p12[2]/d };
+	float i = ex[0]*p13[0] + ex[1]*p13[1] + ex[2]*p13[2];
+	float ey[3] = { p13[0] - i*ex[0], p13[1] - i*ex[1], p13[2] - i*ex[2] };
+	float j = sqrt(ey[0]*ey[0] + ey[1]*ey[1] + ey[2]*ey[2]);
+	ey[0] /= j; ey[1] /= j; ey[2] /= j;
+	float ez[3] = { ex[1]*ey[2] - ex[2]*ey[1], ex[2]*ey[0] - ex[0]*ey[2], ex[0]*ey[1] - ex[1]*ey[0] };
+
+	float xn = d * 0.5;								// all three spheres have the same radius
+	float yn = ((i*i + j*j) * 0.5 - i*xn) / j;
+	float zn2 = kn.delta_rod_2 - xn*xn - yn*yn;
+	float zn = (zn2 > 0) ? sqrt(zn2) : 0;
+
+	memcpy(travel, joint, sizeof(float)*AXES);
+	travel[AXIS_X] = kn.delta_tower_x[0] + ex[0]*xn + ey[0]*yn - ez[0]*zn;
+	travel[AXIS_Y] = kn.delta_tower_y[0] + ex[1]*xn + ey[1]*yn - ez[1]*zn;
+	travel[AXIS_Z] = z1 + ex[2]*xn + ey[2]*yn - ez[2]*zn;
+}
+
+/*
+ * SCARA - two revolute joints in the XY plane, shoulder at X0 Y0
+ *
+ *	X joint is the shoulder angle from the +X axis, Y joint is the elbow angle relative to
+ *	the upper arm, both in degrees (set the axis travel per revolution to 360). The
+ *	right-handed (positive elbow) solution is always chosen. Targets beyond the arm reach
+ *	are clamped to the fully extended or folded arm.
+ *
+ *	atan2() wraps the shoulder at +/-180 degrees, so a line crossing the -X axis would
+ *	command a full turn within one segment. The shoulder is taken a whole number of turns
+ *	from where the last runtime solution left it (kn.scara_shoulder), i.e. the nearest
+ *	equivalent angle. Only kn_inverse_kinematics() moves that reference, as runtime
+ *	solutions come in path order; plan time unwraps its samples against each other.
+ */
+
+static float _unwrap_degrees(const float angle, const float reference)
+{
+	return (angle - 360 * floor((angle - reference) / 360 + 0.5));
+}
+
+static void _scara_inverse(const float travel[], float joint[])
+{
+	float x = travel[AXIS_X];
+	float y = travel[AXIS_Y];
+	float l1 = kn.scara_arm_1;
+	float l2 = kn.scara_arm_2;
+
+	float c2 = (x*x + y*y - l1*l1 - l2*l2) / (2 * l1 * l2);
+	c2 = max((float)-1.0, min(c2, (float)1.0));
+	float theta2 = acos(c2);
+	float theta1 = atan2(y, x) - atan2(l2 * sin(theta2), l1 + l2 * c2);
+
+	memcpy(joint, travel, sizeof(float)*AXES_ACTIVE);
+	joint[AXIS_X] = _unwrap_degrees(theta1 * (180/M_PI), kn.scara_shoulder);
+	joint[AXIS_Y] = theta2 * (180/M_PI);
+}
+
+static void _scara_forward(const float joint[], float travel[])
+{
+	float theta1 = joint[AXIS_X] * (M_PI/180);
+	float theta12 = theta1 + joint[AXIS_Y] * (M_PI/180);
+
+	memcpy(travel, joint, sizeof(float)*AXES);
+	travel[AXIS_X] = kn.scara_arm_1 * cos(theta1) + kn.scara_arm_2 * cos(theta12);
+	travel[AXIS_Y] = kn.scara_arm_1 * sin(theta1) + kn.scara_arm_2 * sin(theta12);
+}
+
+#ifdef __ROTARY_TCP
+/*
+ * Tool center point control - rotary tables ($kntcp)
+ *
+ *	With TCP on, targets are the tool tip on the work, in the frame that turns with the
+ *	table, and the feed rate is taken along that path (see _calculate_move_times()). So a
+ *	4 axis wrapping job or a 5 axis cut can be sent as plain feeds in G94 instead of short
+ *	G93 moves, and the surface speed holds whatever the radius.
+ *
+ *	Each rotary axis set in $kntcp is carried by the table and turns the work about the
+ *	pivot ($knpx, $knpy, $knpz, in absolute machine coordinates - tool length offset
+ *	included, as the planner sees targets). A turns about X, B about Y, C about Z, each
+ *	right handed, and C is carried by B which is carried by A:
+ *
+ *		machine XYZ = Rx(A) * Ry(B) * Rz(C) * (work XYZ - pivot) + pivot
+ *
+ *	The rotary axes themselves pass through. This is run ahead of the kinematic model, so
+ *	it makes any model nonlinear and the planner splits lines to $kntol. The path is a
+ *	straight line on the work, not in the machine: the CAM has to keep a chord from
+ *	cutting through a round part, as it would for any TCP control.
+ *
+ *	The planner's axis limits apply to the work frame. Turning the work swings the linear
+ *	axes too, so a move that turns the table is also held to the longest the linear axes
+ *	could have to travel - see kn_get_tcp_length(). Soft limits are tested against the
+ *	work coordinates, and homing moves are work moves too, so home with $kntcp=0.
+ */
+
+static void _rotate(float v[], const uint8_t i, const uint8_t j, const float degrees)
+{
+	float angle = degrees * (M_PI/180);
+	float c = cos(angle);
+	float s = sin(angle);
+	float vi = v[i];
+	v[i] = vi * c - v[j] * s;
+	v[j] = vi * s + v[j] * c;
+}
+
+static void _tcp_to_machine(const float travel[], float machine[])
+{
+	float v[3];
+	for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) { v[axis] = travel[axis] - kn.tcp_pivot[axis];}
+	if (kn.tcp_axes & TCP_AXIS_C) { _rotate(v, AXIS_X, AXIS_Y, travel[AXIS_C]);}
+	if (kn.tcp_axes & TCP_AXIS_B) { _rotate(v, AXIS_Z, AXIS_X, travel[AXIS_B]);}
+	if (kn.tcp_axes & TCP_AXIS_A) { _rotate(v, AXIS_Y, AXIS_Z, travel[AXIS_A]);}
+
+	memcpy(machine, travel, sizeof(float)*AXES);
+	for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) { machine[axis] = v[axis] + kn.tcp_pivot[axis];}
+}
+
+static void _tcp_to_work(const float machine[], float travel[])
+{
+	float v[3];
+	for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) { v[axis] = machine[axis] - kn.tcp_pivot[axis];}
+	if (kn.tcp_axes & TCP_AXIS_A) { _rotate(v, AXIS_Y, AXIS_Z, -machine[AXIS_A]);}
+	if (kn.tcp_axes & TCP_AXIS_B) { _rotate(v, AXIS_Z, AXIS_X, -machine[AXIS_B]);}
+	if (kn.tcp_axes & TCP_AXIS_C) { _rotate(v, AXIS_X, AXIS_Y, -machine[AXIS_C]);}
+
+	memcpy(travel, machine, sizeof(float)*AXES);
+	for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) { travel[axis] = v[axis] + kn.tcp_pivot[axis];}
+}
+
+/*
+ * kn_get_tcp_length() - longest any linear axis could travel on a move that turns the table
+ *
+ *	The work point is never further from the pivot than the further end of the move, so
+ *	each axis travels at most the work length plus that radius times the turn in radians.
+ *	Returns 0 if the move turns no table axis. Run at plan time only.
+ */
+
+float kn_get_tcp_length(const float start[], const float end[])
+{
+	float turn = 0;
+	for (uint8_t axis=AXIS_A; axis<=AXIS_C; axis++) {
+		if (kn.tcp_axes & (1 << (axis - AXIS_A))) {
+			turn += fabs(end[axis] - start[axis]);
+		}
+	}
+	if (fp_ZERO(turn)) {
+		return (0);
+	}
+	float length = 0;
+	float start_2 = 0;
+	float end_2 = 0;
+	for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) {
+		length += square(end[axis] - start[axis]);
+		start_2 += square(start[axis] - kn.tcp_pivot[axis]);
+		end_2 += square(end[axis] - kn.tcp_pivot[axis]);
+	}
+	return (sqrt(length) + turn * (M_PI/180) * sqrt(max(start_2, end_2)));
+}
+#endif // __ROTARY_TCP
+
+#ifdef __HEIGHT_MAP
+/*
+ * Height map - Z compensation from a probed grid
+ *
+ *	The grid is probed by the height map cycle in cycle_probing.cpp ({mshp:1}), which stores
+ *	each point as its height above the first one. Once all points are in, the offset under
+ *	X,Y is added to Z ahead of the kinematic model, so it reaches every segment the same way
+ *	the model does and the Gcode, the planner and the reported positions stay uncompensated.
+ *	The planner sees a nonlinear model and subdivides lines to the joint tolerance ($kntol)
+ *	so the offset is followed between grid points; $kntol=0 applies it on every segment.
+ *	Outside the grid the offset of the nearest edge is held.
+ *
+ *	Turning compensation on or off, or changing the map, re-syncs the steps to the runtime
+ *	position instead of moving Z, so the machine keeps its Z where it stands. Touch off Z
+ *	after the map is in.
+ *
+ *	Interpolation cost per segment on the M3 is roughly 1,000 cycles bilinear and 6,000
+ *	cycles bicubic - see the kinematic models below for the budget.
+ */
+
+bool kn_height_map_is_active()
+{
+	return ((kn.map.mode != HEIGHT_MAP_OFF) && (kn.map.points != 0) &&
+			(kn.map.points == (uint32_t)kn.map.nx * kn.map.ny));
+}
+
+static void _height_map_changed(bool was_active)
+{
+	if (was_active != kn_height_map_is_active()) {
+		mp_set_steps_to_runtime_position();			// only ever done with the machine at rest
+	}
+}
+
+void kn_height_map_clear()
+{
+	bool was_active = kn_height_map_is_active();
+	kn.map.points = 0;
+	_height_map_changed(was_active);
+}
+
+void kn_height_map_set_point(uint8_t i, uint8_t j, float z)
+{
+	kn.map.z[j][i] = z;
+}
+
+void kn_height_map_load()							// all points set - normalize and apply
+{
+	float z0 = kn.map.z[0][0];
+	for (uint8_t j=0; j<kn.map.ny; j++) {
+		for (uint8_t i=0; i<kn.map.nx; i++) {
+			kn.map.z[j][i] -= z0;
+		}
+	}
+	bool was_active = kn_height_map_is_active();
+	kn.map.points = (uint32_t)kn.map.nx * kn.map.ny;
+	_height_map_changed(was_active);
+}
+
+/*
+ * _get_grid_cell() - cell index and fraction along one grid axis, clamped to the grid
+ * _cubic()         - Catmull-Rom interpolation between p1 and p2
+ * _get_height_offset() - interpolated height at X,Y
+ */
+
+static uint8_t _get_grid_cell(float position, float origin, float spacing, uint8_t points, float *fraction)
+{
+	float f = (position - origin) / spacing;
+	if (f <= 0) {
+		*fraction = 0;
+		return (0);
+	}
+	if (f >= points-1) {
+		*fraction = 1;
+		return (points-2);
+	}
+	uint8_t cell = (uint8_t)f;
+	*fraction = f - cell;
+	return (cell);
+}
+
+static float _cubic(float p0, float p1, float p2, float p3, float t)
+{
+	return (p1 + 0.5 * t * (p2 - p0 + t * (2*p0 - 5*p1 + 4*p2 - p3 + t * (3*(p1 - p2) + p3 - p0))));
+}
+
+static float _get_height_offset(float x, float y)
+{
+	float tx, ty;
+	uint8_t i = _get_grid_cell(x, kn.map.x, kn.map.dx, kn.map.nx, &tx);
+	uint8_t j = _get_grid_cell(y, kn.map.y, kn.map.dy, kn.map.ny, &ty);
+
+	if (kn.map.mode == HEIGHT_MAP_BILINEAR) {
+		float z0 = kn.map.z[j][i] + (kn.map.z[j][i+1] - kn.map.z[j][i]) * tx;
+		float z1 = kn.map.z[j+1][i] + (kn.map.z[j+1][i+1] - kn.map.z[j+1][i]) * tx;
+		return (z0 + (z1 - z0) * ty);
+	}
+	uint8_t col[4], row[4];							// the 4x4 neighbourhood, repeating the edges
+	for (uint8_t k=0; k<4; k++) {
+		col[k] = (uint8_t)max(0, min(i+k-1, kn.map.nx-1));
+		row[k] = (uint8_t)max(0, min(j+k-1, kn.map.ny-1));
+	}
+	float z[4];
+	for (uint8_t k=0; k<4; k++) {
+		const float *r = kn.map.z[row[k]];
+		z[k] = _cubic(r[col[0]], r[col[1]], r[col[2]], r[col[3]], tx);
+	}
+	return (_cubic(z[0], z[1], z[2], z[3], ty));
+}
+#endif // __HEIGHT_MAP
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+static void _set_kinematics_derived()
+{
+	kn.delta_rod_2 = kn.delta_diagonal_rod * kn.delta_diagonal_rod;
+	kn.delta_height = sqrt(max(kn.delta_rod_2 - kn.delta_radius * kn.delta_radius, (float)0.0));
+	for (uint8_t i=0; i<3; i++) {
+		float angle = (210 + 120*i) * (M_PI/180);	// 210, 330, 450 (90) degrees
+		kn.delta_tower_x[i] = kn.delta_radius * cos(angle);
+		kn.delta_tower_y[i] = kn.delta_radius * sin(angle);
+	}
+}
+
+/*
+ * kn_set_knty() - select the kinematic model
+ *
+ *	Changing models reinterprets the current step position, so this should only be done
+ *	with the machine idle and followed by homing (or a G28.3) before any motion.
+ */
+
+stat_t kn_set_knty(nvObj_t *nv)
+{
+	if (nv->value >= KINEMATICS_MAX_TYPE) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_ui8(nv);
+	_inverse_kinematics = _inverse[kn.type];
+	_forward_kinematics = _forward[kn.type];
+	return (STAT_OK);
+}
+
+stat_t kn_set_delta(nvObj_t *nv)
+{
+	if (nv->value <= 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flu(nv);
+	_set_kinematics_derived();
+	return (STAT_OK);
+}
+
+stat_t kn_set_kntol(nvObj_t *nv)
+{
+	if (nv->value < 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flt(nv);
+	return (STAT_OK);
+}
+
+stat_t kn_set_scara(nvObj_t *nv)
+{
+	if (nv->value <= 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	set_flu(nv);
+	return (STAT_OK);
+}
+
+#ifdef __ROTARY_TCP
+/*
+ * kn_set_tcp()  - set the rotary axes under tool center point control
+ * kn_set_tcpp() - set the pivot
+ *
+ *	Both change how the work maps onto the machine, so they are only taken at rest. The
+ *	machine stays where it stands: the position is re-expressed in the new work frame.
+ */
+
+static stat_t _set_tcp(nvObj_t *nv, stat_t (*setter)(nvObj_t *nv))
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	float travel[AXES];
+	float machine[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		travel[axis] = mp_get_runtime_absolute_position(axis);
+	}
+	_tcp_to_machine(travel, machine);
+	setter(nv);
+	float position[AXES];
+	_tcp_to_work(machine, position);
+	for (uint8_t axis=AXIS_X; axis<=AXIS_Z; axis++) {
+		if (fp_NE(position[axis], travel[axis])) {
+			cm_set_position(axis, position[axis]);
+		}
+	}
+	return (STAT_OK);
+}
+
+stat_t kn_set_tcp(nvObj_t *nv)
+{
+	if (nv->value > (TCP_AXIS_A | TCP_AXIS_B | TCP_AXIS_C)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	return (_set_tcp(nv, set_ui8));
+}
+
+stat_t kn_set_tcpp(nvObj_t *nv)
+{
+	return (_set_tcp(nv, set_flu));
+}
+#endif // __ROTARY_TCP
+
+#ifdef __HEIGHT_MAP
+/*
+ * kn_set_mshe() - select height map interpolation, 0 turns compensation off
+ * kn_set_msho() - set the grid origin - clears the map
+ * kn_set_mshd() - set the grid spacing - clears the map
+ * kn_set_mshn() - set the grid points in X or Y - clears the map
+ *
+ *	These change the Z the steps are generated for, so they are only taken at rest.
+ */
+
+stat_t kn_set_mshe(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if (nv->value >= HEIGHT_MAP_MAX_MODE) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	bool was_active = kn_height_map_is_active();
+	set_ui8(nv);
+	_height_map_changed(was_active);
+	return (STAT_OK);
+}
+
+stat_t kn_set_msho(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	kn_height_map_clear();
+	set_flu(nv);
+	return (STAT_OK);
+}
+
+stat_t kn_set_mshd(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if (nv->value <= 0) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	kn_height_map_clear();
+	set_flu(nv);
+	return (STAT_OK);
+}
+
+stat_t kn_set_mshn(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if ((nv->value < 2) || (nv->value > HEIGHT_MAP_POINTS_MAX)) { return (STAT_INPUT_VALUE_UNSUPPORTED);}
+	kn_height_map_clear();
+	set_ui8(nv);
+	return (STAT_OK);
+}
+#endif // __HEIGHT_MAP
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char msg_units0[] PROGMEM = " in";	// used by generic print functions
+static const char msg_units1[] PROGMEM = " mm";
+static const char msg_units2[] PROGMEM = " deg";
+static const char *const msg_units[] PROGMEM = { msg_units0, msg_units1, msg_units2 };
+
+static const char fmt_knty[]  PROGMEM = "[knty] kinematics%22d [0=cartesian,1=corexy,2=delta,3=scara]\n";
+static const char fmt_knrod[] PROGMEM = "[knrod] delta diagonal rod%13.3f%s\n";
+static const char fmt_knrad[] PROGMEM = "[knrad] delta radius%19.3f%s\n";
+static const char fmt_kna1[]  PROGMEM = "[kna1] scara arm 1%21.3f%s\n";
+static const char fmt_kna2[]  PROGMEM = "[kna2] scara arm 2%21.3f%s\n";
+static const char fmt_kntol[] PROGMEM = "[kntol] joint tolerance%16.4f\n";
+static const char fmt_kntcp[] PROGMEM = "[kntcp] tool center point axes%9d [0=off,1=A,2=B,4=C - add for more]\n";
+static const char fmt_knpx[]  PROGMEM = "[knpx] tcp pivot x%21.3f%s\n";
+static const char fmt_knpy[]  PROGMEM = "[knpy] tcp pivot y%21.3f%s\n";
+static const char fmt_knpz[]  PROGMEM = "[knpz] tcp pivot z%21.3f%s\n";
+
+void kn_print_knty(nvObj_t *nv) { text_print(nv, fmt_knty);}
+void kn_print_knrod(nvObj_t *nv) { text_print_flt_units(nv, fmt_knrod, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_knrad(nvObj_t *nv) { text_print_flt_units(nv, fmt_knrad, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kna1(nvObj_t *nv) { text_print_flt_units(nv, fmt_kna1, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kna2(nvObj_t *nv) { text_print_flt_units(nv, fmt_kna2, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_kntol(nvObj_t *nv) { text_print(nv, fmt_kntol);}
+void kn_print_kntcp(nvObj_t *nv) { text_print(nv, fmt_kntcp);}
+void kn_print_knpx(nvObj_t *nv) { text_print_flt_units(nv, fmt_knpx, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_knpy(nvObj_t *nv) { text_print_flt_units(nv, fmt_knpy, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_knpz(nvObj_t *nv) { text_print_flt_units(nv, fmt_knpz, GET_UNITS(ACTIVE_MODEL));}
+
+static const char fmt_mshe[]  PROGMEM = "[mshe] height map%22d [0=off,1=bilinear,2=bicubic]\n";
+static const char fmt_mshx[]  PROGMEM = "[mshx] height map X start%14.3f%s\n";
+static const char fmt_mshy[]  PROGMEM = "[mshy] height map Y start%14.3f%s\n";
+static const char fmt_mshdx[] PROGMEM = "[mshdx] height map X spacing%11.3f%s\n";
+static const char fmt_mshdy[] PROGMEM = "[mshdy] height map Y spacing%11.3f%s\n";
+static const char fmt_mshnx[] PROGMEM = "[mshnx] height map X points%12d\n";
+static const char fmt_mshny[] PROGMEM = "[mshny] height map Y points%12d\n";
+static const char fmt_mshz[]  PROGMEM = "[mshz] height map probe Z%14.3f%s\n";
+static const char fmt_mshcl[] PROGMEM = "[mshcl] height map clearance Z%9.3f%s\n";
+static const char fmt_mshp[]  PROGMEM = "[mshp] height map points probed%8d\n";
+
+void kn_print_mshe(nvObj_t *nv) { text_print(nv, fmt_mshe);}
+void kn_print_mshx(nvObj_t *nv) { text_print_flt_units(nv, fmt_mshx, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_mshy(nvObj_t *nv) { text_print_flt_units(nv, fmt_mshy, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_mshdx(nvObj_t *nv) { text_print_flt_units(nv, fmt_mshdx, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_mshdy(nvObj_t *nv) { text_print_flt_units(nv, fmt_mshdy, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_mshnx(nvObj_t *nv) { text_print(nv, fmt_mshnx);}
+void kn_print_mshny(nvObj_t *nv) { text_print(nv, fmt_mshny);}
+void kn_print_mshz(nvObj_t *nv) { text_print_flt_units(nv, fmt_mshz, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_mshcl(nvObj_t *nv) { text_print_flt_units(nv, fmt_mshcl, GET_UNITS(ACTIVE_MODEL));}
+void kn_print_mshp(nvObj_t *nv) { text_print(nv, fmt_mshp);}
+
+#endif // __TEXT_MODE
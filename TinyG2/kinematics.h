@@ -24,16 +24,226 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-
 #ifndef KINEMATICS_H_ONCE
 #define KINEMATICS_H_ONCE
 
+/**** Kinematics settings ****/
+
+enum knKinematicsType {				// kinematic model used by kn_inverse_kinematics()
+	KINEMATICS_CARTESIAN = 0,		// joints are the axes (default)
+	KINEMATICS_COREXY,				// X and Y joints are the CoreXY A and B belts
+	KINEMATICS_DELTA,				// X, Y and Z joints are the carriage heights of a linear delta
+	KINEMATICS_SCARA,				// X and Y joints are the shoulder and elbow angles in degrees
+	KINEMATICS_MAX_TYPE
+};
+
+#ifndef KINEMATICS							// settings files may override these
+#define KINEMATICS					KINEMATICS_CARTESIAN
+#endif
+#ifndef DELTA_DIAGONAL_ROD					// mm - length of the delta arms, joint to joint
+#define DELTA_DIAGONAL_ROD			250.0
+#endif
+#ifndef DELTA_RADIUS						// mm - horizontal carriage joint to effector joint distance
+#define DELTA_RADIUS				125.0
+#endif
+#ifndef SCARA_ARM_1							// mm - shoulder to elbow
+#define SCARA_ARM_1					150.0
+#endif
+#ifndef SCARA_ARM_2							// mm - elbow to tool
+#define SCARA_ARM_2					150.0
+#endif
+#ifndef KINEMATICS_JOINT_TOLERANCE			// joint units - max deviation of joint interpolation, 0 disables
+#define KINEMATICS_JOINT_TOLERANCE	0.01
+#endif
+
+#define KINEMATICS_MAX_SUBDIVISIONS	128		// cap on sub-chords per line (must fit a uint8_t)
+
+/**** Tool center point settings - built with __ROTARY_TCP ****/
+
+#define TCP_AXIS_A					0x01	// rotary axes carried by the table ($kntcp bits)
+#define TCP_AXIS_B					0x02
+#define TCP_AXIS_C					0x04
+
+#ifndef TCP_AXES							// settings files may override these
+#define TCP_AXES					0		// 0 = tool center point control off
+#endif
+#ifndef TCP_PIVOT_X							// mm - machine coordinates the rotary axes turn about
+#define TCP_PIVOT_X					0.0
+#endif
+#ifndef TCP_PIVOT_Y
+#define TCP_PIVOT_Y					0.0
+#endif
+#ifndef TCP_PIVOT_Z
+#define TCP_PIVOT_Z					0.0
+#endif
+
+/**** Height map settings - built with __HEIGHT_MAP ****/
+
+enum knHeightMapMode {				// interpolation of the probed Z offsets ($mshe)
+	HEIGHT_MAP_OFF = 0,				// no compensation
+	HEIGHT_MAP_BILINEAR,			// 4 nearest points
+	HEIGHT_MAP_BICUBIC,				// 16 nearest points - Catmull-Rom, continuous in slope
+	HEIGHT_MAP_MAX_MODE
+};
+
+#define HEIGHT_MAP_POINTS_MAX		16		// points per side of the grid (16x16 floats = 1Kb RAM)
+
+#ifndef HEIGHT_MAP_MODE						// settings files may override these
+#define HEIGHT_MAP_MODE				HEIGHT_MAP_BILINEAR
+#endif
+#ifndef HEIGHT_MAP_X						// mm - machine coordinates of the first grid point
+#define HEIGHT_MAP_X				0.0
+#endif
+#ifndef HEIGHT_MAP_Y
+#define HEIGHT_MAP_Y				0.0
+#endif
+#ifndef HEIGHT_MAP_DX						// mm - grid spacing
+#define HEIGHT_MAP_DX				10.0
+#endif
+#ifndef HEIGHT_MAP_DY
+#define HEIGHT_MAP_DY				10.0
+#endif
+#ifndef HEIGHT_MAP_NX						// grid points in X and Y, 2 - HEIGHT_MAP_POINTS_MAX
+#define HEIGHT_MAP_NX				5
+#endif
+#ifndef HEIGHT_MAP_NY
+#define HEIGHT_MAP_NY				5
+#endif
+#ifndef HEIGHT_MAP_PROBE_Z					// mm - machine Z each G38.2 probes down to
+#define HEIGHT_MAP_PROBE_Z			-10.0
+#endif
+#ifndef HEIGHT_MAP_CLEAR_Z					// mm - machine Z the probe travels between points at
+#define HEIGHT_MAP_CLEAR_Z			0.0
+#endif
+
+typedef struct knHeightMap {				// probed Z offsets, kept in RAM only
+	uint8_t mode;							// knHeightMapMode
+	float x;								// first grid point, machine coordinates
+	float y;
+	float dx;								// grid spacing
+	float dy;
+	uint8_t nx;								// grid points in X and Y
+	uint8_t ny;
+	float probe_z;							// Z each point is probed down to
+	float clear_z;							// Z the probe travels at
+	uint32_t points;						// points in the map - it applies once all nx*ny are in
+	float z[HEIGHT_MAP_POINTS_MAX][HEIGHT_MAP_POINTS_MAX];	// [y][x] height above the first point
+} knHeightMap_t;
+
+typedef struct knSingleton {				// kinematics configuration and derived values
+	uint8_t type;							// knKinematicsType
+	float delta_diagonal_rod;				// delta settings
+	float delta_radius;
+	float scara_arm_1;						// SCARA settings
+	float scara_arm_2;
+	float joint_tolerance;					// max joint-space deviation of a sub-chord (mm or deg)
+#ifdef __ROTARY_TCP
+	uint8_t tcp_axes;						// rotary axes carried by the table, TCP_AXIS_x bits (0 = off)
+	float tcp_pivot[3];						// machine XYZ the rotary axes turn about
+#endif
+
+	// derived values - recomputed by the setters
+	float delta_rod_2;						// diagonal rod squared
+	float delta_height;						// carriage height above the effector at X0 Y0
+	float delta_tower_x[3];					// tower positions, towers at 210, 330 and 90 degrees
+	float delta_tower_y[3];
+	float scara_shoulder;					// shoulder angle of the last runtime solution, degrees (unwrapped)
+
+	// motor map - joint driven by each motor and its steps per unit, 0 if unmapped or inhibited
+	uint8_t motor_joint[MOTORS];
+	float motor_steps_per_unit[MOTORS];
+	float joint_step_time[AXES];			// minutes per unit of joint travel at STEP_RATE_MAX, slowest motor on the joint
+
+#ifdef __HEIGHT_MAP
+	knHeightMap_t map;						// Z compensation added ahead of the kinematic model
+#endif
+} knSingleton_t;
+
+extern knSingleton_t kn;
+
 /*
  * Global Scope Functions
  */
 
+void kn_update_motor_map(void);
 void kn_inverse_kinematics(const float travel[], float steps[]);
 void kn_forward_kinematics(const float steps[], float travel[]);
+bool kn_kinematics_is_linear(void);
+float kn_get_step_time(const float travel[]);
+void kn_offset_z(const float offset, float steps[]);
+uint8_t kn_get_subdivisions(const float start[], const float end[]);
+#ifdef __ROTARY_TCP
+float kn_get_tcp_length(const float start[], const float end[]);
+#endif
 
-#endif // End of include Guard: KINEMATICS_H_ONCE
+stat_t kn_set_knty(nvObj_t *nv);
+stat_t kn_set_delta(nvObj_t *nv);
+stat_t kn_set_scara(nvObj_t *nv);
+stat_t kn_set_kntol(nvObj_t *nv);
+
+#ifdef __ROTARY_TCP
+stat_t kn_set_tcp(nvObj_t *nv);
+stat_t kn_set_tcpp(nvObj_t *nv);
+#endif
+
+#ifdef __HEIGHT_MAP
+bool kn_height_map_is_active(void);
+void kn_height_map_clear(void);
+void kn_height_map_set_point(uint8_t i, uint8_t j, float z);
+void kn_height_map_load(void);
 
+stat_t kn_set_mshe(nvObj_t *nv);
+stat_t kn_set_msho(nvObj_t *nv);
+stat_t kn_set_mshd(nvObj_t *nv);
+stat_t kn_set_mshn(nvObj_t *nv);
+#endif
+
+#ifdef __TEXT_MODE
+
+	void kn_print_knty(nvObj_t *nv);
+	void kn_print_knrod(nvObj_t *nv);
+	void kn_print_knrad(nvObj_t *nv);
+	void kn_print_kna1(nvObj_t *nv);
+	void kn_print_kna2(nvObj_t *nv);
+	void kn_print_kntol(nvObj_t *nv);
+	void kn_print_kntcp(nvObj_t *nv);
+	void kn_print_knpx(nvObj_t *nv);
+	void kn_print_knpy(nvObj_t *nv);
+	void kn_print_knpz(nvObj_t *nv);
+	void kn_print_mshe(nvObj_t *nv);
+	void kn_print_mshx(nvObj_t *nv);
+	void kn_print_mshy(nvObj_t *nv);
+	void kn_print_mshdx(nvObj_t *nv);
+	void kn_print_mshdy(nvObj_t *nv);
+	void kn_print_mshnx(nvObj_t *nv);
+	void kn_print_mshny(nvObj_t *nv);
+	void kn_print_mshz(nvObj_t *nv);
+	void kn_print_mshcl(nvObj_t *nv);
+	void kn_print_mshp(nvObj_t *nv);
+
+#else
+
+	#define kn_print_knty tx_print_stub
+	#define kn_print_knrod tx_print_stub
+	#define kn_print_knrad tx_print_stub
+	#define kn_print_kna1 tx_print_stub
+	#define kn_print_kna2 tx_print_stub
+	#define kn_print_kntol tx_print_stub
+	#define kn_print_kntcp tx_print_stub
+	#define kn_print_knpx tx_print_stub
+	#define kn_print_knpy tx_print_stub
+	#define kn_print_knpz tx_print_stub
+	#define kn_print_mshe tx_print_stub
+	#define kn_print_mshx tx_print_stub
+	#define kn_print_mshy tx_print_stub
+	#define kn_print_mshdx tx_print_stub
+	#define kn_print_mshdy tx_print_stub
+	#define kn_print_mshnx tx_print_stub
+	#define kn_print_mshny tx_print_stub
+	#define kn_print_mshz tx_print_stub
+	#define kn_print_mshcl tx_print_stub
+	#define kn_print_mshp tx_print_stub
+
+#endif // __TEXT_MODE
+
+#endif // End of include Guard: KINEMATICS_H_ONCE
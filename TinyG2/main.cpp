@@ -47,6 +47,10 @@
 #include "MotateTimers.h"
 using Motate::delay;
 
+#ifdef __HOST__
+#include "host.h"
+#else // the host C runtime does all this itself
+
 /**************************
  *** C++ specific stuff ***
  **************************/
@@ -65,6 +69,7 @@ void __libc_init_array(void);
 
 void* __dso_handle = nullptr;
 
+#endif // __HOST__
 #endif // __ARM
 
 /******************** System Globals *************************/
@@ -85,7 +90,14 @@ const Motate::USBSettings_t Motate::USBSettings = {
 	/*gProductVersion   = */ //0.1,
 
 //Motate::USBDevice< Motate::USBCDC > usb;
-Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
+// Constructed ahead of the other globals: the xio device wrappers (xio.cpp) hook their connection
+// callbacks into it from their own constructors, and link time optimization reorders files
+#ifdef __USB_VENDOR
+Motate::USBDevice< Motate::USBCDC, Motate::USBCDC, Motate::USBVendor > usb __attribute__ ((init_priority (200)));
+decltype(usb._mixin_2_type::Bulk) &BulkUSB = usb._mixin_2_type::Bulk;
+#else
+Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb __attribute__ ((init_priority (200)));
+#endif
 
 decltype(usb._mixin_0_type::Serial) &SerialUSB = usb._mixin_0_type::Serial;
 decltype(usb._mixin_1_type::Serial) &SerialUSB1 = usb._mixin_1_type::Serial;
@@ -105,17 +117,25 @@ MOTATE_SET_USB_SERIAL_NUMBER_STRING_FROM_CHIPID()
  *
  * There are a lot of dependencies in the order of these inits.
  * Don't change the ordering unless you understand this.
+ *
+ * USB is attached last, once the controller can take the connection. Ready is event driven:
+ * the host opening the port calls controller_set_connected() (see xio.cpp), and the next
+ * controller pass prints the system ready message. Nothing waits for enumeration, so the
+ * board takes commands as soon as the host connects. Attaching earlier let a fast connect
+ * land before controller_init(), which cleared it, and the ready message never came.
  */
 
 void _system_init(void)
 {
 #ifdef __ARM
 	SystemInit();
+#ifndef __HOST__
+#ifndef __WATCHDOG
 	WDT->WDT_MR = WDT_MR_WDDIS;     // Disable watchdog
+#endif
 	__libc_init_array();            // Initialize C library
+#endif
     cacheUniqueId();                // Store the flash UUID
-	usb.attach();                   // USB setup
-	delay(1000);
 #endif
 #ifdef __AVR
     cli();
@@ -159,13 +179,57 @@ void application_init_startup(void)
     canonical_machine_reset();
     spindle_init();                 // should be after PWM and canonical machine inits and config_init()
     spindle_reset();
-    // MOVED: report the system is ready is now in xio
+    hw_check_irq_priorities();		// all the interrupts are set up by now
+#ifdef __WATCHDOG
+    cm_load_warm_restart();         // pick up where a warm reset left off
+    hw_watchdog_init();             // init is done - the main loop feeds it from here
+#endif
+#ifdef __ARM
+	usb.attach();                   // USB setup - the system ready message goes out on connect
+#endif
 }
 
 /*
  * main()
+ *
+ *	The host (simulator) build runs the clock forward between controller passes and exits
+ *	once the input is done and the machine has been at rest for HOST_IDLE_EXIT_MS. See host.h
  */
 
+#ifdef __HOST__
+int main(int argc, char *argv[])
+{
+	host_init(argc, argv);
+	_system_init();
+	application_init_services();
+	application_init_machine();
+	application_init_startup();
+	run_canned_startup();
+
+	uint32_t idle_since = 0;
+	for (;;) {
+		controller_run( );
+		Motate::hostRunTimers(HOST_PASS_US);
+
+		if (!(Motate::hostUSBInputDone() &&
+#ifdef __CANNED_PROGRAMS
+			 !canned_is_running() &&
+#endif
+			 (cm_get_machine_state() != MACHINE_CYCLE) &&
+			 (mp_get_planner_buffers_available() == PLANNER_BUFFER_POOL_SIZE) &&
+			 !st_runtime_isbusy())) {
+			idle_since = SysTickTimer.getValue();
+		} else if ((SysTickTimer.getValue() - idle_since) > HOST_IDLE_EXIT_MS) {
+			break;
+		}
+	}
+#ifdef __PLANNER_PROFILE
+	bench_exit_report();			// profile of the job just run - see test.cpp
+#endif
+	hw_hard_reset();				// closes the trace
+	return 0;
+}
+#else
 int main(void)
 {
 	// system initialization
@@ -183,6 +247,7 @@ int main(void)
 	}
 	return 0;
 }
+#endif // __HOST__
 
 /*
  * get_status_message() - support for status messages.
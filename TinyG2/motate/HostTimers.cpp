@@ -0,0 +1,154 @@
+/*
+  HostTimers.cpp - Library for the Motate system
+  http://tinkerin.gs/
+
+  Copyright (c) 2013 Robert Giseburt
+
+    This file is part of the Motate Library.
+
+    This file ("the software") is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License, version 2 as published by the
+    Free Software Foundation. You should have received a copy of the GNU General Public
+    License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+    As a special exception, you may use this file as part of a software library without
+    restriction. Specifically, if other files instantiate templates or use macros or
+    inline functions from this file, or you compile this file and link it with  other
+    files to produce an executable, this file does not by itself cause the resulting
+    executable to be covered by the GNU General Public License. This exception does not
+    however invalidate any other reasons why the executable file might be covered by the
+    GNU General Public License.
+
+    THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+    WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+    SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+    OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#if defined(__HOST__)
+
+#include "utility/HostTimers.h"
+#include "Reset.h"
+
+namespace Motate {
+
+	// Must stay constant-initialized: Timer constructors in other files write into it
+	// during static construction.
+	HostTimer_t hostTimer[kHostTimerCount];
+
+	Timer<SysTickTimerNum> SysTickTimer;
+	volatile uint32_t Timer<SysTickTimerNum>::_motateTickCount = 0;
+
+	static uint64_t _clock = 0;					// simulated master clock ticks
+	static uint64_t _next_systick = 0;
+	static uint16_t _running_priority = 256;	// above any NVIC priority: thread mode
+	static bool _masked = false;				// PRIMASK
+
+	uint64_t hostGetTime() {
+		return _clock;
+	}
+
+	// Work out the next compare or top of a running timer, after the cause just handled
+	static void _schedule(HostTimer_t &t, const uint32_t after) {
+		if ((after != kInterruptOnMatchA) && (t.interrupts & kInterruptOnMatchA) && (t.match_a < t.top)) {
+			t.next_event = t.period_start + t.match_a;
+			t.next_cause = kInterruptOnMatchA;
+		} else {
+			t.next_event = t.period_start + t.top;
+			t.next_cause = kInterruptOnOverflow;
+		}
+	}
+
+	// Run pending handlers that outrank the running priority, most urgent first
+	static void _dispatch() {
+		while (!_masked) {
+			HostTimer_t *best = nullptr;
+			for (uint8_t i=0; i<kHostTimerCount; i++) {
+				HostTimer_t &t = hostTimer[i];
+				if (t.pending && (t.priority < _running_priority) && ((best == nullptr) || (t.priority < best->priority))) {
+					best = &t;
+				}
+			}
+			if (best == nullptr)
+				return;
+
+			best->pending = false;
+			uint16_t saved_priority = _running_priority;
+			_running_priority = best->priority;
+			if (best->isr)
+				best->isr();
+			_running_priority = saved_priority;
+		}
+	}
+
+	void hostStartTimer(const uint8_t timerNum) {
+		HostTimer_t &t = hostTimer[timerNum];
+		if (t.top == 0)
+			t.top = 1;
+		t.running = true;
+		t.period_start = _clock;
+		_schedule(t, kInterruptUnknown);
+	}
+
+	void hostSetInterruptPending(const uint8_t timerNum) {
+		hostTimer[timerNum].pending = true;
+		_dispatch();
+	}
+
+	void hostRunTimers(const uint32_t microseconds) {
+		uint64_t end = _clock + (uint64_t)microseconds * (SystemCoreClock / 1000000);
+
+		for (;;) {
+			HostTimer_t *next = nullptr;
+			for (uint8_t i=0; i<kHostTimerCount; i++) {
+				HostTimer_t &t = hostTimer[i];
+				if (t.running && ((next == nullptr) || (t.next_event < next->next_event))) {
+					next = &t;
+				}
+			}
+
+			if ((next == nullptr) || (_next_systick <= next->next_event)) {
+				if (_next_systick > end)
+					break;
+				_clock = _next_systick;
+				_next_systick += SystemCoreClock / 1000;
+				tickReset();
+				SysTickTimer._increment();
+				if (SysTickTimer.interrupt)
+					SysTickTimer.interrupt();
+				continue;
+			}
+			if (next->next_event > end)
+				break;
+
+			// Advance the timer before the handler runs - it may stop or restart it
+			_clock = next->next_event;
+			uint32_t cause = next->next_cause;
+			if (cause == kInterruptOnOverflow)
+				next->period_start += next->top;
+			_schedule(*next, cause);
+
+			if (next->interrupts & cause) {
+				next->cause = cause;
+				next->pending = true;
+				_dispatch();
+			}
+		}
+		_clock = end;
+	}
+
+} // namespace Motate
+
+void __disable_irq(void) {
+	Motate::_masked = true;
+}
+
+void __enable_irq(void) {
+	Motate::_masked = false;
+	Motate::_dispatch();
+}
+
+#endif // __HOST__
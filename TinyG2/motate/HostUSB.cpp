@@ -0,0 +1,74 @@
+/*
+  HostUSB.cpp - Library for the Motate system
+  http://tinkerin.gs/
+
+  Copyright (c) 2013 Robert Giseburt
+
+    This file is part of the Motate Library.
+
+    This file ("the software") is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License, version 2 as published by the
+    Free Software Foundation. You should have received a copy of the GNU General Public
+    License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+    As a special exception, you may use this file as part of a software library without
+    restriction. Specifically, if other files instantiate templates or use macros or
+    inline functions from this file, or you compile this file and link it with  other
+    files to produce an executable, this file does not by itself cause the resulting
+    executable to be covered by the GNU General Public License. This exception does not
+    however invalidate any other reasons why the executable file might be covered by the
+    GNU General Public License.
+
+    THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+    WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+    SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+    OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#if defined(__HOST__)
+
+#include "MotateUSB.h"
+#include <stdio.h>
+#include <unistd.h>
+
+namespace Motate {
+
+	static int _input_fd = STDIN_FILENO;
+	static bool _input_done = false;
+
+	void hostUSBSetInput(const int fd) {
+		_input_fd = fd;
+		_input_done = false;
+	}
+
+	bool hostUSBInputDone() {
+		return _input_done;
+	}
+
+	// A file never blocks. A terminal on stdin blocks until a line is typed, and simulated
+	// time stands still while it does.
+	int16_t _readFromConsole(uint8_t* data, int16_t len) {
+		if (_input_done || (len < 1))
+			return 0;
+		ssize_t got = ::read(_input_fd, data, len);
+		if (got <= 0) {
+			_input_done = true;
+			return 0;
+		}
+		return got;
+	}
+
+	int16_t _writeToConsole(const uint8_t* data, int16_t length) {
+		return fwrite(data, 1, length, stdout);
+	}
+
+	void _flushConsole() {
+		fflush(stdout);
+	}
+
+} // namespace Motate
+
+#endif // __HOST__
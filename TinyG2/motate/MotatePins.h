@@ -59,4 +59,65 @@ namespace Motate {
 #include <utility/SamPins.h>
 #endif
 
+#if defined(__HOST__)
+#include <utility/HostPins.h>
+#endif
+
+#if defined(__SAM3X8E__) || defined(__SAM3X8C__) || defined(__HOST__)
+
+namespace Motate {
+
+    /* PinGroup - write a set of output pins together
+     *
+     *  PinGroup<pinA, pinB, pinC...> group;
+     *  group.write(bits);      // bit 0 drives pinA, bit 1 drives pinB, ...
+     *
+     *  The pins are sorted into their ports at compile time, and each port that has any of
+     *  them gets one masked write (OWER / ODSR / OWDR on the SAM), so all the pins on a port
+     *  change on the same clock. Null pins (-1) are allowed and take no part. The pins must
+     *  already be set up as outputs - e.g. by the OutputPins that own them.
+     */
+    template<int8_t... pinNums>
+    struct _PinGroupBits;
+
+    template<>
+    struct _PinGroupBits<> {
+        static constexpr uint32_t mask(const uint8_t portLetter) { return 0; };
+        static constexpr uint32_t value(const uint8_t portLetter, const uint32_t bits) { return 0; };
+    };
+
+    template<int8_t pinNum, int8_t... otherPinNums>
+    struct _PinGroupBits<pinNum, otherPinNums...> {
+        static constexpr uint32_t mask(const uint8_t portLetter) {
+            return ((Pin<pinNum>::portLetter == portLetter) ? Pin<pinNum>::mask : 0x00u) |
+                _PinGroupBits<otherPinNums...>::mask(portLetter);
+        };
+        static constexpr uint32_t value(const uint8_t portLetter, const uint32_t bits) {
+            return (((Pin<pinNum>::portLetter == portLetter) && (bits & 0x01u)) ? Pin<pinNum>::mask : 0x00u) |
+                _PinGroupBits<otherPinNums...>::value(portLetter, bits >> 1);
+        };
+    };
+
+    template<int8_t... pinNums>
+    struct PinGroup {
+        template<uint8_t portLetter>
+        static void _writePort(const uint32_t bits) {
+            if (_PinGroupBits<pinNums...>::mask(portLetter) != 0x00u) {
+                Port32<portLetter> port;
+                port.write(_PinGroupBits<pinNums...>::value(portLetter, bits), _PinGroupBits<pinNums...>::mask(portLetter));
+            }
+        };
+
+        void write(const uint32_t bits) {
+            _writePort<'A'>(bits);
+            _writePort<'B'>(bits);
+            _writePort<'C'>(bits);
+            _writePort<'D'>(bits);
+        };
+    };
+
+} // namespace Motate
+
+#endif
+
 #endif /* end of include guard: MOTATEPINS_H_ONCE */
\ No newline at end of file
@@ -49,6 +49,10 @@
 #include <utility/SamUSB.h>
 #endif
 
+#if defined(__HOST__)
+#include <utility/HostUSB.h>
+#endif
+
 namespace Motate {
 
 	/* ############################################ */
@@ -120,7 +124,7 @@ namespace Motate {
 		static bool sendDescriptorOrConfig(Setup_t &setup) {
 			const uint8_t type = setup.valueHigh();
 			if (type == kConfigurationDescriptor) {
-				sendConfig(setup.length(), /*other = */ setup.valueLow() == 2);
+				sendConfig(setup.length(), /*other = */ false);
 				return true;
 			}
 			else
@@ -160,8 +164,11 @@ namespace Motate {
             _this_type::writeToControl(0, buffer, to_send);
 		};
 
+		// The qualifier describes the device as it would be at the other speed, so the host can tell
+		// a high-speed capable device that enumerated at full speed (and vice versa).
 		static void sendQualifierDescriptor(int16_t maxLength) {
-			const _qualifier_type qualifier;
+			const _descriptor_type descriptor(USBSettings.vendorID, USBSettings.productID, USBFloatToBCD(USBSettings.productVersion), _hardware_type::getDeviceSpeed());
+			const _qualifier_type qualifier(descriptor, _hardware_type::getDeviceSpeed());
 			int16_t length = sizeof(_qualifier_type);
             int16_t to_send = maxLength < length ? maxLength : length;
             const uint8_t *buffer = (const uint8_t *)(&qualifier);
@@ -266,8 +273,17 @@ namespace Motate {
 
 	template < typename interface0type, typename interface1type, typename interface2type >
 	struct USBDefaultQualifier : USBDescriptorDeviceQualifier_t {
-		USBDefaultQualifier() :
-		USBDescriptorDeviceQualifier_t() // use the defaults
+		USBDefaultQualifier(const USBDescriptorDevice_t &device, const USBDeviceSpeed_t deviceSpeed) :
+		USBDescriptorDeviceQualifier_t(
+									   /*    USBSpecificationBCD = */ device.USBSpecificationBCD,
+									   /*                  Class = */ device.Class,
+									   /*               SubClass = */ device.SubClass,
+									   /*               Protocol = */ device.Protocol,
+
+									   /*          Endpoint0Size = */ getEndpointSize(0, kEndpointTypeControl, deviceSpeed, /*otherSpeed = */ true),
+
+									   /* NumberOfConfigurations = */ device.NumberOfConfigurations
+		)
 		{};
 	};
 } // namespace Motate
@@ -35,6 +35,13 @@
 #include <functional>
 #include "Reset.h"
 
+// Banks for the CDC bulk OUT (read) endpoints. With two banks the host can send the next
+// packet while the last one is still being read. The IN endpoints keep one bank so two
+// CDC interfaces still fit the endpoint DPRAM at high speed (512 byte packets).
+#ifndef MOTATE_USB_CDC_READ_BANKS
+#define MOTATE_USB_CDC_READ_BANKS kEndpointBufferBlocksUpTo2
+#endif
+
 namespace Motate {
 
     /* ############################################ */
@@ -288,6 +295,11 @@ namespace Motate {
             return usb.readByte(read_endpoint);
         };
 
+        // Non-blocking. Returns what was available, up to length (-1 if not configured).
+        int16_t readAvailable(uint8_t *buffer, const uint16_t length) {
+            return usb.read(read_endpoint, buffer, length);
+        };
+
         // BLOCKING!!
         uint16_t read(uint8_t *buffer, const uint16_t length) {
             int16_t total_read = 0;
@@ -461,7 +473,8 @@ namespace Motate {
         const EndpointBufferSettings_t getEndpointSettings(const uint8_t endpoint, const USBDeviceSpeed_t deviceSpeed, const bool otherSpeed, const bool limitedSize) {
             if (endpoint == control_endpoint)
             {
-                uint16_t ep_size = Motate::getEndpointSize(control_endpoint, kEndpointTypeInterrupt, deviceSpeed, otherSpeed);
+                // Notifications are a few bytes - keep them to 64 at either speed, as in the descriptor
+                uint16_t ep_size = Motate::getEndpointSize(control_endpoint, kEndpointTypeInterrupt, deviceSpeed, otherSpeed, /*limitedSize*/ true);
                 const EndpointBufferSettings_t _buffer_size = getBufferSizeFlags(ep_size);
                 return kEndpointBufferInputToHost | _buffer_size | kEndpointBufferBlocks1 | kEndpointBufferTypeInterrupt;
             }
@@ -469,7 +482,7 @@ namespace Motate {
             {
                 uint16_t ep_size = Motate::getEndpointSize(read_endpoint, kEndpointTypeBulk, deviceSpeed, otherSpeed, limitedSize);
                 const EndpointBufferSettings_t _buffer_size = getBufferSizeFlags(ep_size);
-                return kEndpointBufferOutputFromHost | _buffer_size | kEndpointBufferBlocks1 | kEndpointBufferTypeBulk;
+                return kEndpointBufferOutputFromHost | _buffer_size | MOTATE_USB_CDC_READ_BANKS | kEndpointBufferTypeBulk;
             }
             else if (endpoint == write_endpoint)
             {
@@ -483,7 +496,7 @@ namespace Motate {
         uint16_t getEndpointSize(const uint8_t &endpoint, const USBDeviceSpeed_t deviceSpeed, const bool otherSpeed, const bool limitedSize) {
             if (endpoint == control_endpoint)
             {
-                return Motate::getEndpointSize(control_endpoint, kEndpointTypeInterrupt, deviceSpeed, otherSpeed, limitedSize);
+                return Motate::getEndpointSize(control_endpoint, kEndpointTypeInterrupt, deviceSpeed, otherSpeed, /*limitedSize*/ true);
             }
             else if (endpoint == read_endpoint)
             {
@@ -619,7 +632,7 @@ namespace Motate {
     struct USBDefaultDescriptor < USBCDC, USBNullInterface, USBNullInterface > : USBDescriptorDevice_t {
         USBDefaultDescriptor(const uint16_t vendorID, const uint16_t productID, const uint16_t productVersion, const USBDeviceSpeed_t deviceSpeed) :
         USBDescriptorDevice_t(
-                              /*    USBSpecificationBCD = */ USBFloatToBCD(1.1),
+                              /*    USBSpecificationBCD = */ USBFloatToBCD(2.0),
                               /*                  Class = */ kCDCClass,
                               /*               SubClass = */ kNoSpecificSubclass,
                               /*               Protocol = */ kNoSpecificProtocol,
@@ -646,7 +659,7 @@ namespace Motate {
     struct USBCDCIADDescriptor : USBDescriptorDevice_t {
         USBCDCIADDescriptor(const uint16_t vendorID, const uint16_t productID, const uint16_t productVersion, const USBDeviceSpeed_t deviceSpeed) :
         USBDescriptorDevice_t(
-                              /*    USBSpecificationBCD = */ USBFloatToBCD(1.1),
+                              /*    USBSpecificationBCD = */ USBFloatToBCD(2.0),
                               /*                  Class = */ kIADDeviceClass,
                               /*               SubClass = */ kIADDeviceSubclass,
                               /*               Protocol = */ kIADDeviceProtocol,
@@ -758,7 +771,7 @@ namespace Motate {
                                  /* _EndpointAddress   = */ _first_endpoint_number,
                                  /* _Attributes        = */ (kEndpointTypeInterrupt | kEndpointAttrNoSync | kEndpointUsageData),
                                  /* _PollingIntervalMS = */ 0x10,
-                                 /* _maxSize (optional) =*/ 64
+                                 /* _limited_size      = */ true
                                  ),
 
 
@@ -844,7 +857,7 @@ namespace Motate {
                                  /* _EndpointAddress   = */ _first_endpoint_number,
                                  /* _Attributes        = */ (kEndpointTypeInterrupt | kEndpointAttrNoSync | kEndpointUsageData),
                                  /* _PollingIntervalMS = */ 0x10,
-                                 /* _maxSize (optional) =*/ 64
+                                 /* _limited_size      = */ true
                                  ),
         
         CDC_DCI_Interface(
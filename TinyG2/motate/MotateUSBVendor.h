@@ -0,0 +1,264 @@
+/*
+ utility/MotateUSBVendor.h - Library for the Motate system
+ http://tinkerin.gs/
+
+ Copyright (c) 2013 Robert Giseburt
+
+ This file is part of the Motate Library.
+
+ This file ("the software") is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License, version 2 as published by the
+ Free Software Foundation. You should have received a copy of the GNU General Public
+ License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+ As a special exception, you may use this file as part of a software library without
+ restriction. Specifically, if other files instantiate templates or use macros or
+ inline functions from this file, or you compile this file and link it with  other
+ files to produce an executable, this file does not by itself cause the resulting
+ executable to be covered by the GNU General Public License. This exception does not
+ however invalidate any other reasons why the executable file might be covered by the
+ GNU General Public License.
+
+ THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+ */
+
+#ifndef MOTATEUSBVENDOR_ONCE
+#define MOTATEUSBVENDOR_ONCE
+
+#include "MotateUSB.h"
+#include <functional>
+
+// Banks for the vendor bulk OUT (read) endpoint. Two CDC interfaces plus this one only fit
+// the 4K endpoint DPRAM at high speed if the CDC read endpoints drop to one bank each
+// (see MOTATE_USB_CDC_READ_BANKS).
+#ifndef MOTATE_USB_VENDOR_READ_BANKS
+#define MOTATE_USB_VENDOR_READ_BANKS kEndpointBufferBlocksUpTo2
+#endif
+
+namespace Motate {
+
+    /* ############################################ */
+    /* #                                          # */
+    /* #          USB Vendor Bulk Interface       # */
+    /* #                                          # */
+    /* ############################################ */
+
+    // A single interface of class 0xFF with one bulk OUT and one bulk IN endpoint. There is no
+    // line coding or control line state: the host talks to it with libusb (or WinUSB, once the
+    // interface is bound to it) and gets 512 byte packets at high speed.
+    //
+    // Since there's no DTR, the host opens and closes the channel with a vendor request to the
+    // interface: bmRequestType 0x41, bRequest kVendorSetChannelState, wValue 1 (open) or 0 (closed),
+    // wIndex = interface number, no data stage.
+
+    enum USBVendorRequestID_t {
+        kVendorSetChannelState = 0x01
+    };
+
+#pragma mark USBVendor
+
+    // Placeholder for use in end-code
+    // IOW: USBDevice<USBCDC, USBCDC, USBVendor> usb;
+    // Also, used as the base class for the resulting specialized USBMixin.
+    struct USBVendor {
+        static bool isNull() { return false; };
+        static const uint8_t endpoints_used = 2;
+    };
+
+#pragma mark USBVendor_impl
+
+    //Actual implementation of the vendor bulk interface
+    template <typename usb_parent_type>
+    struct USBVendorBulk {
+        usb_parent_type &usb;
+        const uint8_t read_endpoint;
+        const uint8_t write_endpoint;
+        const uint8_t interface_number;
+        std::function<void(bool)> connection_state_changed_callback;
+
+        volatile bool _open;
+
+        USBVendorBulk(usb_parent_type &usb_parent,
+                      const uint8_t new_endpoint_offset,
+                      const uint8_t new_interface_number
+                      )
+        : usb(usb_parent),
+        read_endpoint(new_endpoint_offset),
+        write_endpoint(new_endpoint_offset+1),
+        interface_number(new_interface_number),
+        _open(false)
+        {};
+
+        int16_t readByte() {
+            return usb.readByte(read_endpoint);
+        };
+
+        // Non-blocking. Returns what was available, up to length (-1 if not configured).
+        int16_t readAvailable(uint8_t *buffer, const uint16_t length) {
+            return usb.read(read_endpoint, buffer, length);
+        };
+
+        // This write will write what it can, return how much it wrote, and will NOT flush.
+        int32_t writeSome(const uint8_t *data, const uint16_t length) {
+            int16_t total_written = 0;
+            int16_t written;
+            const uint8_t *out_buffer = data;
+            int16_t to_write = length;
+
+            do {
+                written = usb.write(write_endpoint, out_buffer, to_write);
+
+                if (written < 1) // -1 = ERROR, and 0 means we would block
+                    break;
+
+                total_written += written;
+                to_write -= written;
+                out_buffer += written;
+            } while (to_write > 0);
+
+            return total_written;
+        }
+
+        void flush() {
+            usb.flush(write_endpoint);
+        }
+
+        void flushRead() {
+            usb.flushRead(read_endpoint);
+        }
+
+        bool isConnected() {
+            return _open;
+        }
+
+        void setConnectionCallback(std::function<void(bool)> &&callback) {
+            connection_state_changed_callback = std::move(callback);
+            if (connection_state_changed_callback && _open)
+                connection_state_changed_callback(true);
+        }
+
+        bool handleNonstandardRequest(Setup_t &setup) {
+            if (setup.index() != interface_number)
+                return false;
+
+            if (setup.isAHostToDeviceVendorInterfaceRequest()) {
+                if (setup.requestIs(kVendorSetChannelState)) {
+                    bool was_open = _open;
+                    _open = setup.valueLow() & 0x01;
+
+                    if (connection_state_changed_callback && (was_open != _open)) {
+                        connection_state_changed_callback(_open);
+                    }
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        const EndpointBufferSettings_t getEndpointSettings(const uint8_t endpoint, const USBDeviceSpeed_t deviceSpeed, const bool otherSpeed) {
+            if (endpoint == read_endpoint)
+            {
+                uint16_t ep_size = Motate::getEndpointSize(read_endpoint, kEndpointTypeBulk, deviceSpeed, otherSpeed);
+                const EndpointBufferSettings_t _buffer_size = getBufferSizeFlags(ep_size);
+                return kEndpointBufferOutputFromHost | _buffer_size | MOTATE_USB_VENDOR_READ_BANKS | kEndpointBufferTypeBulk;
+            }
+            else if (endpoint == write_endpoint)
+            {
+                uint16_t ep_size = Motate::getEndpointSize(write_endpoint, kEndpointTypeBulk, deviceSpeed, otherSpeed);
+                const EndpointBufferSettings_t _buffer_size = getBufferSizeFlags(ep_size);
+                return kEndpointBufferInputToHost | _buffer_size | kEndpointBufferBlocks1 | kEndpointBufferTypeBulk;
+            }
+            return kEndpointBufferNull;
+        };
+
+        uint16_t getEndpointSize(const uint8_t &endpoint, const USBDeviceSpeed_t deviceSpeed, const bool otherSpeed) {
+            if (endpoint == read_endpoint || endpoint == write_endpoint)
+            {
+                return Motate::getEndpointSize(endpoint, kEndpointTypeBulk, deviceSpeed, otherSpeed);
+            }
+            return 0;
+        };
+    };
+
+#pragma mark USBMixin< usbIFA, usbIFB, USBVendor, 2 >
+
+    // The vendor interface only goes in the third slot, after the serial port(s).
+    template <typename usbIFA, typename usbIFB>
+    struct USBMixin< usbIFA, usbIFB, USBVendor, 2 > : USBVendor {
+
+        typedef USBDevice<usbIFA, usbIFB, USBVendor> usb_parent_type;
+        typedef USBMixin< usbIFA, usbIFB, USBVendor, 2 > this_type;
+
+        USBVendorBulk< usb_parent_type > Bulk;
+
+        USBMixin< usbIFA, usbIFB, USBVendor, 2 > (usb_parent_type &usb_parent,
+                                                  const uint8_t new_endpoint_offset,
+                                                  const uint8_t first_interface_number
+                                                  ) : Bulk(usb_parent, new_endpoint_offset, first_interface_number) {};
+
+        static const EndpointBufferSettings_t getEndpointConfigFromMixin(const uint8_t endpoint, const USBDeviceSpeed_t deviceSpeed, const bool other_speed) {
+            return usb_parent_type::_singleton->this_type::Bulk.getEndpointSettings(endpoint, deviceSpeed, other_speed);
+        };
+        static bool handleNonstandardRequestInMixin(Setup_t &setup) {
+            return usb_parent_type::_singleton->this_type::Bulk.handleNonstandardRequest(setup);
+        };
+        static uint16_t getEndpointSizeFromMixin(const uint8_t endpoint, const USBDeviceSpeed_t deviceSpeed, const bool otherSpeed) {
+            return usb_parent_type::_singleton->this_type::Bulk.getEndpointSize(endpoint, deviceSpeed, otherSpeed);
+        };
+        static bool sendSpecialDescriptorOrConfig(Setup_t &setup) { return false; };
+    };
+
+#pragma mark USBConfigMixin< ?, ?, USBVendor >
+
+    template < typename usbIFA, typename usbIFB >
+    struct USBConfigMixin < usbIFA, usbIFB, USBVendor, 2 >
+    {
+        static const uint8_t interfaces = 1;
+
+        const USBDescriptorInterface_t Vendor_Interface;
+        const USBDescriptorEndpoint_t  Vendor_DataOutEndpoint;
+        const USBDescriptorEndpoint_t  Vendor_DataInEndpoint;
+
+        USBConfigMixin (const uint8_t _first_endpoint_number, const uint8_t _first_interface_number, const USBDeviceSpeed_t _deviceSpeed, const bool _other_speed)
+        : Vendor_Interface(
+                           /* _InterfaceNumber   = */ _first_interface_number,
+                           /* _AlternateSetting  = */ 0,
+                           /* _TotalEndpoints    = */ 2,
+
+                           /* _Class             = */ kVendorSpecificClass,
+                           /* _SubClass          = */ kVendorSpecificSubclass,
+                           /* _Protocol          = */ kVendorSpecificProtocol,
+
+                           /* _InterfaceStrIndex = */ 0 // none
+                           ),
+        Vendor_DataOutEndpoint(
+                               /* _deviceSpeed       = */ _deviceSpeed,
+                               /* _otherSpeed        = */ _other_speed,
+                               /* _input             = */ false,
+                               /* _EndpointAddress   = */ _first_endpoint_number,
+                               /* _Attributes        = */ (kEndpointTypeBulk | kEndpointAttrNoSync | kEndpointUsageData),
+                               /* _PollingIntervalMS = */ 0x01
+                               ),
+        Vendor_DataInEndpoint(
+                              /* _deviceSpeed       = */ _deviceSpeed,
+                              /* _otherSpeed        = */ _other_speed,
+                              /* _input             = */ true,
+                              /* _EndpointAddress   = */ _first_endpoint_number+1,
+                              /* _Attributes        = */ (kEndpointTypeBulk | kEndpointAttrNoSync | kEndpointUsageData),
+                              /* _PollingIntervalMS = */ 0x01
+                              )
+        {};
+
+        static bool isNull() { return false; };
+    };
+}
+
+#endif
+// MOTATEUSBVENDOR_ONCE
@@ -37,48 +37,59 @@ using namespace Motate;
 extern _pinChangeInterrupt motate_pin_change_interrupts_start;
 extern _pinChangeInterrupt motate_pin_change_interrupts_end;
 
+/* Pin change dispatch
+ *
+ * All the pins of a PIO port share one interrupt. MOTATE_PIN_INTERRUPT() puts an entry for
+ * each pin in the .motate.pin_change_interrupts section at link time. Before main() runs,
+ * the entries are laid out in a table per port, indexed by the pin's bit, with a mask of the
+ * bits that have a handler. The port handler reads PIO_ISR once (which clears it) and calls
+ * the handlers of the pins that changed - lowest bit first - without walking the entries of
+ * every port.
+ */
 
-extern "C" void PIOA_Handler(void) {
-    uint32_t isr = PIOA->PIO_ISR;
-
-    _pinChangeInterrupt *current = &motate_pin_change_interrupts_start;
-    while (current != &motate_pin_change_interrupts_end) {
-        if (current->portLetter == 'A' && isr & current->mask) {
-            current->interrupt();
+#define _PIN_CHANGE_PORTS 4     // A - D
+
+typedef void (*_pinChangeHandler)();
+static _pinChangeHandler _pin_change_table[_PIN_CHANGE_PORTS][32];
+static uint32_t _pin_change_mask[_PIN_CHANGE_PORTS];
+
+static struct _PinChangeTableInit {
+    _PinChangeTableInit() {
+        _pinChangeInterrupt *current = &motate_pin_change_interrupts_start;
+        while (current != &motate_pin_change_interrupts_end) {
+            uint8_t port = current->portLetter - 'A';
+            if ((port < _PIN_CHANGE_PORTS) && (current->mask != 0)) {
+                _pin_change_table[port][__builtin_ctz(current->mask)] = &current->interrupt;
+                _pin_change_mask[port] |= current->mask;
+            }
+            current++;
         }
-        current++;
     }
+} _pin_change_table_init;
+
+static inline void _dispatch_pin_changes(const uint8_t port, uint32_t isr)
+{
+    isr &= _pin_change_mask[port];
+    while (isr) {
+        uint32_t bit = __builtin_ctz(isr);
+        isr &= isr - 1;                     // clear the lowest set bit
+        _pin_change_table[port][bit]();
+    }
+}
 
+extern "C" void PIOA_Handler(void) {
+    _dispatch_pin_changes(0, PIOA->PIO_ISR);
     NVIC_ClearPendingIRQ(PIOA_IRQn);
 }
 
-
 extern "C" void PIOB_Handler(void) {
-    uint32_t isr = PIOB->PIO_ISR;
-
-    _pinChangeInterrupt *current = &motate_pin_change_interrupts_start;
-    while (current != &motate_pin_change_interrupts_end) {
-        if (current->portLetter == 'B' && isr & current->mask) {
-            current->interrupt();
-        }
-        current++;
-    }
-
+    _dispatch_pin_changes(1, PIOB->PIO_ISR);
     NVIC_ClearPendingIRQ(PIOB_IRQn);
 }
 
 #ifdef PIOC
 extern "C" void PIOC_Handler(void) {
-    uint32_t isr = PIOC->PIO_ISR;
-
-    _pinChangeInterrupt *current = &motate_pin_change_interrupts_start;
-    while (current != &motate_pin_change_interrupts_end) {
-        if (current->portLetter == 'C' && isr & current->mask) {
-            current->interrupt();
-        }
-        current++;
-    }
-
+    _dispatch_pin_changes(2, PIOC->PIO_ISR);
     NVIC_ClearPendingIRQ(PIOC_IRQn);
 }
 
@@ -86,16 +97,7 @@ extern "C" void PIOC_Handler(void) {
 
 #ifdef PIOD
 extern "C" void PIOD_Handler(void) {
-    uint32_t isr = PIOD->PIO_ISR;
-
-    _pinChangeInterrupt *current = &motate_pin_change_interrupts_start;
-    while (current != &motate_pin_change_interrupts_end) {
-        if (current->portLetter == 'D' && isr & current->mask) {
-            current->interrupt();
-        }
-        current++;
-    }
-
+    _dispatch_pin_changes(3, PIOD->PIO_ISR);
     NVIC_ClearPendingIRQ(PIOD_IRQn);
 }
 
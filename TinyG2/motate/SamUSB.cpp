@@ -439,58 +439,35 @@ namespace Motate {
 		return -1;
 	}
 
-//     int16_t _readFromEndpoint(const uint8_t endpoint, uint8_t* data, int16_t length) {
-//             //              _resetEndpointBuffer(endpoint);
-//             uint8_t *ptr_dest = data;
-//             int16_t read = 0;
-//
-//             // Available = -1 means that FIFOCONtrol might not be high.
-//             // It should only be >= 0 once we've proven that it is.
-//             int16_t available = -1;
-//
-//             while (length > 0 && _isFIFOControlAvailable(endpoint)) {
-//                     available = _getEndpointBufferCount(endpoint);
-//
-//                     if (!available) {
-//                             // We cheat and lazily clear the RXOUT interrupt.
-//                             // Once we might actually use that interru;t, we might need to be more proactive.
-//                             _clearReceiveOUT(endpoint);
-//
-//                             // Clearing FIFOCon will also mark this bank as "read".
-//                             _clearFIFOControl(endpoint);
-//                             _resetEndpointBuffer(endpoint);
-//
-//                             // FOFCon will either be low now
-//                             // -OR- will be high again if there's another bank of data available.
-//                             // If it stays low, we ned to make sure we don't reset it again when we test available before returning.
-//                             // BECAUSE we don't have interrupts off, and it could, possibly, go high again before then.
-//                             // In that case, we would be flushing a full buffer.
-//                             available = -1;
-//                             continue;
-//                     }
-//
-//                     int16_t to_read = available < length ? available : length;
-//                     int16_t i = to_read;
-//
-//                     while (i--) {
-//                             *ptr_dest++ = *_endpointBuffer[endpoint]++;
-//                     }
-//                     available -= to_read;
-//                     length -= to_read;
-//                     read += to_read;
-//             }
-//
-//             // If available is negative, we don't want to flush.
-//             if (!available) {
-//                     // Flush. See notes at the top of the function.
-//                     _clearReceiveOUT(endpoint);
-//                     _clearFIFOControl(endpoint);
-//                     _resetEndpointBuffer(endpoint);
-//             }
-//
-//             return read;
-//     }
+	// Read what is available in the endpoint banks, up to length bytes. Doesn't block.
+	// Returns the number of bytes read - 0 if nothing was available.
+	int16_t _readFromEndpoint(const uint8_t endpoint, uint8_t* data, int16_t length) {
+		uint8_t *ptr_dest = data;
+		int16_t read = 0;
+
+		while (length > 0 && _isFIFOControlAvailable(endpoint)) {
+			if (!_isReadWriteAllowed(endpoint)) {
+				// This bank has been read - release it, exactly as _readByteFromEndpoint() does.
+				// FIFOCon will either be low now -OR- high again if there's another bank of data.
+				_clearReceiveOUT(endpoint);
+				_clearFIFOControl(endpoint);
+				_resetEndpointBuffer(endpoint);
+				continue;
+			}
 
+			int16_t to_read = _getEndpointBufferCount(endpoint);
+			if (to_read > length)
+				to_read = length;
+			if (to_read == 0)
+				to_read = 1;					// RWALL says there is at least one byte
+
+			length -= to_read;
+			read += to_read;
+			while (to_read--)
+				*ptr_dest++ = *_endpointBuffer[endpoint]++;
+		}
+		return read;
+	}
 
 	void _flushReadEndpoint(uint8_t endpoint) {
 		while(_isFIFOControlAvailable(endpoint)) {
@@ -742,14 +719,15 @@ namespace Motate {
 					{
 						TRACE_CORE(printf(">>> EP0 Int: kSetConfiguration REQUEST_DEVICE %d\r\n", setup.wValueL);)
 
-						// _configuration should be set to 1 for high-speed, and 2 for full-speed
+						// There's one configuration at either speed. The endpoints are sized for the speed
+						// we negotiated in the reset: 512 byte bulk packets at high speed, 64 at full speed.
 						_configuration = setup.valueLow();
 
 						uint8_t first_endpoint, total_endpoints;
 						total_endpoints = USBProxy.getEndpointCount(first_endpoint);
 						for (uint8_t ep = first_endpoint; ep < total_endpoints; ep++) {
-							_initEndpoint(ep, USBProxy.getEndpointConfig(ep, /* otherSpeed = */ _configuration == 2));
-							endpointSizes[ep] = USBProxy.getEndpointSize(ep, /* otherSpeed = */ _configuration == 2);
+							_initEndpoint(ep, USBProxy.getEndpointConfig(ep, /* otherSpeed = */ false));
+							endpointSizes[ep] = USBProxy.getEndpointSize(ep, /* otherSpeed = */ false);
 						}
 						ok = true;
 
@@ -0,0 +1,427 @@
+/*
+  utility/HostPins.h - Library for the Motate system
+  http://tinkerin.gs/
+
+  Copyright (c) 2013 Robert Giseburt
+
+    This file is part of the Motate Library.
+
+    This file ("the software") is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License, version 2 as published by the
+    Free Software Foundation. You should have received a copy of the GNU General Public
+    License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+    As a special exception, you may use this file as part of a software library without
+    restriction. Specifically, if other files instantiate templates or use macros or
+    inline functions from this file, or you compile this file and link it with  other
+    files to produce an executable, this file does not by itself cause the resulting
+    executable to be covered by the GNU General Public License. This exception does not
+    however invalidate any other reasons why the executable file might be covered by the
+    GNU General Public License.
+
+    THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+    WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+    SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+    OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Host (native) pins for the simulator build.
+ *
+ * Pins are bits in four virtual 32 bit ports that mirror the SAM PIO ports, so the board
+ * pin assignments (and things like kStepPinsShareAPort) come out exactly as they do on
+ * the Due. Outputs latch into hostPort[].output and inputs read hostPort[].input, which
+ * nothing drives unless a test sets it. PWM pins remember their frequency and duty.
+ */
+
+#ifndef HOSTPINS_H_ONCE
+#define HOSTPINS_H_ONCE
+
+#include "host_cmsis.h"
+
+#include <type_traits> // for std::enable_if
+
+namespace Motate {
+    // Numbering is arbitrary:
+    enum PinMode {
+        kUnchanged      = 0,
+        kOutput         = 1,
+        kInput          = 2,
+        // These next two are NOT available on other platforms,
+        // but cannot be masked out since they are required for
+        // special pin functions. These should not be used in
+        // end-user (sketch) code.
+        kPeripheralA    = 3,
+        kPeripheralB    = 4,
+    };
+
+    // Numbering is arbitrary, but bit unique for bitwise operations (unlike other architectures):
+    enum PinOptions {
+        kNormal         = 0,
+        kTotem          = 0, // alias
+        kPullUp         = 1<<1,
+        kWiredAnd       = 1<<2,
+        kDriveLowOnly   = 1<<2, // alias
+        kWiredAndPull   = kWiredAnd|kPullUp,
+        kDriveLowPullUp = kDriveLowOnly|kPullUp, // alias
+        kDeglitch       = 1<<4,
+        kDebounce       = 1<<5,
+
+        // For use on PWM pins only!
+        kPWMPinInverted    = 1<<7,
+    };
+
+    enum PinInterruptOptions {
+        kPinInterruptsOff                = 0,
+
+        kPinInterruptOnChange            = 1,
+
+        kPinInterruptOnRisingEdge        = 1<<1,
+        kPinInterruptOnFallingEdge       = 2<<1,
+
+        kPinInterruptOnLowLevel          = 3<<1,
+        kPinInterruptOnHighLevel         = 4<<1,
+
+        kPinInterruptAdvancedMask        = ((1<<3)-1)<<1,
+
+        /* This turns the IRQ on, but doesn't set the timer to ever trigger it. */
+        kPinInterruptOnSoftwareTrigger   = 1<<4,
+
+        kPinInterruptTypeMask            = (1<<5)-1,
+
+        /* Set priority levels here as well: */
+        kPinInterruptPriorityHighest     = 1<<5,
+        kPinInterruptPriorityHigh        = 1<<6,
+        kPinInterruptPriorityMedium      = 1<<7,
+        kPinInterruptPriorityLow         = 1<<8,
+        kPinInterruptPriorityLowest      = 1<<9,
+
+        kPinInterruptPriorityMask        = ((1<<10) - (1<<5))
+    };
+
+    typedef uint32_t uintPort_t;
+
+    typedef const int8_t pin_number;
+
+    // The virtual port registers, indexed by port letter - 'A'. See HostPins.cpp
+    struct HostPort_t {
+        volatile uintPort_t output;
+        volatile uintPort_t input;
+        volatile uintPort_t modes;         // set bits are outputs
+    };
+    static const uint8_t kHostPortCount = 4;
+    extern HostPort_t hostPort[kHostPortCount];
+
+    template <unsigned char portLetter>
+    struct Port32 {
+        static const uint8_t letter = 0; // NULL stub!
+
+        void setModes(const uintPort_t value, const uintPort_t mask = 0xffffffff) {};
+        void setOptions(const uint16_t options, const uintPort_t mask) {};
+        void setDebounceTime(const uint32_t microseconds) {};
+        void set(const uintPort_t value) {};
+        void clear(const uintPort_t value) {};
+        void write(const uintPort_t value) {};
+        void write(const uintPort_t value, const uintPort_t mask) {};
+        uintPort_t getInputValues(const uintPort_t mask = 0xffffffff) { return 0; };
+        uintPort_t getOutputValues(const uintPort_t mask = 0xffffffff) { return 0; };
+    };
+
+    template<int8_t pinNum>
+    struct Pin {
+        static const int8_t number = -1;
+        static const uint8_t portLetter = 0;
+        static const uint32_t mask = 0;
+
+        Pin() {};
+        Pin(const PinMode type, const PinOptions options = kNormal) {};
+        void operator=(const bool value) {};
+        operator bool() { return 0; };
+
+        void init(const PinMode type, const uint16_t options = kNormal, const bool fromConstructor=false) {};
+        void setMode(const PinMode type, const bool fromConstructor=false) {};
+        PinMode getMode() { return kUnchanged; };
+        void setOptions(const uint16_t options, const bool fromConstructor=false) {};
+        void setDebounceTime(const uint32_t microseconds) {};
+        uint16_t getOptions() { return kNormal; };
+        void set() {};
+        void clear() {};
+        void write(const bool value) {};
+        void toggle() {};
+        void setInterrupts(const uint32_t interrupts) {};
+        uint8_t get() { return 0; };
+        uint8_t getInputValue() { return 0; };
+        uint8_t getOutputValue() { return 0; };
+        static uint32_t maskForPort(const uint8_t otherPortLetter) { return 0; };
+        bool isNull() { return true; };
+    };
+
+    template<uint8_t portChar, uint8_t portPin>
+    struct ReversePinLookup : Pin<-1> {
+        ReversePinLookup() {};
+        ReversePinLookup(const PinMode type, const PinOptions options = kNormal) : Pin<-1>(type, options) {};
+    };
+
+    template<int8_t pinNum>
+    struct InputPin : Pin<pinNum> {
+        InputPin() : Pin<pinNum>(kInput) {};
+        InputPin(const PinOptions options) : Pin<pinNum>(kInput, options) {};
+        void init(const PinOptions options = kNormal  ) {Pin<pinNum>::init(kInput, options);};
+        uint32_t get() {
+            return Pin<pinNum>::getInputValue();
+        };
+        /*Override these to pick up new methods */
+        operator bool() { return (get() != 0); };
+    private: /* Make these private to catch them early. These are intentionally not defined. */
+        void init(const PinMode type, const PinOptions options = kNormal);
+        void operator=(const bool value) { Pin<pinNum>::write(value); };
+        void write(const bool);
+    };
+
+    template<int8_t pinNum>
+    struct OutputPin : Pin<pinNum> {
+        OutputPin() : Pin<pinNum>(kOutput) {};
+        OutputPin(const PinOptions options) : Pin<pinNum>(kOutput, options) {};
+        void init(const PinOptions options = kNormal) {Pin<pinNum>::init(kOutput, options);};
+        uint32_t get() {
+            return Pin<pinNum>::getOutputValue();
+        };
+        void operator=(const bool value) { Pin<pinNum>::write(value); };
+        /*Override these to pick up new methods */
+        operator bool() { return (get() != 0); };
+    private: /* Make these private to catch them early. */
+        void init(const PinMode type, const PinOptions options = kNormal); /* Intentially not defined. */
+    };
+
+    template<int8_t pinNum>
+    struct IRQPin : Pin<pinNum> {
+        IRQPin() : Pin<pinNum>(kInput) {};
+        IRQPin(const PinOptions options) : Pin<pinNum>(kInput, options) {};
+        void init(const PinOptions options = kNormal  ) {Pin<pinNum>::init(kInput, options);};
+
+        static const bool is_real = true;
+        static void interrupt() __attribute__ (( weak ));
+    };
+
+    template<int8_t pinNum>
+    constexpr const bool IsIRQPin() { return IRQPin<pinNum>::is_real; };
+
+    template<pin_number gpioPinNumber>
+    using IsGPIOIRQOrNull = typename std::enable_if<true>::type;
+
+    template<uint8_t portChar, uint8_t portPin>
+    using LookupIRQPin = IRQPin< ReversePinLookup<portChar, portPin>::number >;
+
+    // Nothing changes the virtual inputs on its own, so there is no pin change dispatch
+    // to register with. The handler is still defined so a test can call it directly.
+#define MOTATE_PIN_INTERRUPT(number) \
+    template<> void Motate::IRQPin<number>::interrupt()
+
+    #define _MAKE_MOTATE_PIN(pinNum, registerLetter, registerChar, registerPin)\
+        template<>\
+        struct Pin<pinNum> {\
+        private: /* Lock the copy contructor.*/\
+            Pin(const Pin<pinNum>&){};\
+        public:\
+            static const int8_t number = pinNum;\
+            static const uint8_t portLetter = (uint8_t) registerChar;\
+            static const uint32_t mask = (1u << registerPin);\
+            \
+            Pin() {};\
+            Pin(const PinMode type, const PinOptions options = kNormal) {\
+                init(type, options, /*fromConstructor=*/true);\
+            };\
+            void operator=(const bool value) { write(value); };\
+            operator bool() { return (get() != 0); };\
+            \
+            void init(const PinMode type, const uint16_t options = kNormal, const bool fromConstructor=false) {\
+                setMode(type, fromConstructor);\
+                setOptions(options, fromConstructor);\
+            };\
+            void setMode(const PinMode type, const bool fromConstructor=false) {\
+                if (type == kOutput) {\
+                    hostPort[registerChar - 'A'].modes |= mask;\
+                } else if (type == kInput) {\
+                    hostPort[registerChar - 'A'].modes &= ~mask;\
+                }\
+            };\
+            PinMode getMode() {\
+                return (hostPort[registerChar - 'A'].modes & mask) ? kOutput : kInput;\
+            };\
+            void setOptions(const uint16_t options, const bool fromConstructor=false) {};\
+            void setDebounceTime(const uint32_t microseconds) {};\
+            uint16_t getOptions() { return kNormal; };\
+            void set() {\
+                hostPort[registerChar - 'A'].output |= mask;\
+            };\
+            void clear() {\
+                hostPort[registerChar - 'A'].output &= ~mask;\
+            };\
+            void write(const bool value) {\
+                if (!value)\
+                    clear();\
+                else\
+                    set();\
+            };\
+            void toggle()  {\
+                hostPort[registerChar - 'A'].output ^= mask;\
+            };\
+            uint32_t get() {\
+                return hostPort[registerChar - 'A'].input & mask;\
+            };\
+            uint32_t getInputValue() {\
+                return hostPort[registerChar - 'A'].input & mask;\
+            };\
+            uint32_t getOutputValue() {\
+                return hostPort[registerChar - 'A'].output & mask;\
+            };\
+            void setInterrupts(const uint32_t interrupts) {};\
+            bool isNull() { return false; };\
+            static uint32_t maskForPort(const uint8_t otherPortLetter) {\
+                return portLetter == otherPortLetter ? mask : 0x00u;\
+            };\
+            /* Placeholder for user code. */\
+            static void interrupt() __attribute__ ((weak));\
+        };\
+        typedef Pin<pinNum> Pin ## pinNum;\
+        static Pin ## pinNum pin ## pinNum;\
+        template<>\
+        struct ReversePinLookup<registerChar, registerPin> : Pin<pinNum> {\
+        ReversePinLookup() {};\
+        ReversePinLookup(const PinMode type, const PinOptions options = kNormal) : Pin<pinNum>(type, options) {};\
+        };\
+        template<> void Motate::IRQPin<pinNum>::interrupt();
+
+
+    static const uint32_t kDefaultPWMFrequency = 1000;
+    template<int8_t pinNum>
+    struct PWMOutputPin : Pin<pinNum> {
+        PWMOutputPin() : Pin<pinNum>(kOutput) {};
+        PWMOutputPin(const PinOptions options, const uint32_t freq = kDefaultPWMFrequency) : Pin<pinNum>(kOutput, options) {};
+        PWMOutputPin(const uint32_t freq) : Pin<pinNum>(kOutput, kNormal) {};
+        void setFrequency(const uint32_t freq) {};
+        void operator=(const float value) { write(value); };
+        void write(const float value) { Pin<pinNum>::write(value >= 0.5); };
+        bool canPWM() { return false; };
+
+    private: /* Make these private to catch them early. */
+        /* These are intentially not defined. */
+        void init(const PinMode type, const PinOptions options = kNormal);
+
+        /* WARNING: Covariant return types! */
+        bool get();
+        operator bool();
+    };
+
+    // The timer a PWM pin is wired to on the board is ignored - there is no waveform to make.
+    #define _MAKE_MOTATE_PWM_PIN(pinNum, timerOrPWM, channelAorB, peripheralAorB, invertedByDefault)\
+        template<>\
+        struct PWMOutputPin<pinNum> : Pin<pinNum> {\
+            uint32_t frequency;\
+            float duty;\
+            PWMOutputPin() : Pin<pinNum>(kOutput), frequency(kDefaultPWMFrequency), duty(0) {};\
+            PWMOutputPin(const PinOptions options, const uint32_t freq = kDefaultPWMFrequency) :\
+                Pin<pinNum>(kOutput, options), frequency(freq), duty(0) {};\
+            PWMOutputPin(const uint32_t freq) : Pin<pinNum>(kOutput, kNormal), frequency(freq), duty(0) {};\
+            void setFrequency(const uint32_t freq) { frequency = freq; };\
+            void operator=(const float value) { write(value); };\
+            void write(const float value) {\
+                duty = value;\
+                Pin<pinNum>::write(value > 0);\
+            };\
+            bool canPWM() { return true; };\
+        private: /* Make these private to catch them early. */\
+            /* These are intentially not defined. */\
+            void init(const PinMode type, const PinOptions options = kNormal);\
+            /* WARNING: Covariant return types! */\
+            bool get();\
+            operator bool();\
+        };
+
+    template<int8_t pinNum>
+    struct SPIChipSelectPin {
+    private: /* Make these private to catch them early. */
+        /* These are intentially not defined. */
+        /* WARNING: Covariant return types! */
+        bool get();
+        operator bool();
+    };
+
+    #define _MAKE_MOTATE_SPI_CS_PIN(pinNum, peripheralAorB, csNum)\
+        template<>\
+        struct SPIChipSelectPin<pinNum> : Pin<pinNum> {\
+            SPIChipSelectPin() : Pin<pinNum>(kOutput) {};\
+            static const uint8_t moduleId = 0;\
+            static const uint8_t csOffset = csNum;\
+        private: /* Make these private to catch them early. */\
+            /* These are intentially not defined. */\
+            /* WARNING: Covariant return types! */\
+            bool get();\
+            operator bool();\
+        };
+
+    template<int8_t pinNum>
+    struct SPIOtherPin {
+    private: /* Make these private to catch them early. */
+        /* These are intentially not defined. */
+        /* WARNING: Covariant return types! */
+        bool get();
+        operator bool();
+    };
+
+    #define _MAKE_MOTATE_SPI_OTHER_PIN(pinNum, peripheralAorB)\
+        template<>\
+        struct SPIOtherPin<pinNum> : Pin<pinNum> {\
+            SPIOtherPin() : Pin<pinNum>(kOutput) {};\
+            static const uint16_t moduleId = 0;\
+        private: /* Make these private to catch them early. */\
+            /* These are intentially not defined. */\
+            /* WARNING: Covariant return types! */\
+            bool get();\
+            operator bool();\
+        };
+
+    #define _MAKE_MOTATE_PORT32(registerLetter, registerChar)\
+        template <>\
+        struct Port32<registerChar> {\
+            static const uint8_t letter = (uint8_t) registerChar;\
+            void setModes(const uintPort_t value, const uintPort_t mask) {\
+                hostPort[registerChar - 'A'].modes = (hostPort[registerChar - 'A'].modes & ~mask) | (value & mask);\
+            };\
+            void setOptions(const uint16_t options, const uintPort_t mask) {};\
+            void setDebounceTime(const uint32_t microseconds) {};\
+            void set(const uintPort_t value) {\
+                hostPort[registerChar - 'A'].output |= value;\
+            };\
+            void clear(const uintPort_t value) {\
+                hostPort[registerChar - 'A'].output &= ~value;\
+            };\
+            void write(const uintPort_t value) {\
+                hostPort[registerChar - 'A'].output = value;\
+            };\
+            void write(const uintPort_t value, const uintPort_t mask) {\
+                hostPort[registerChar - 'A'].output = (hostPort[registerChar - 'A'].output & ~mask) | (value & mask);\
+            };\
+            uintPort_t getInputValues(const uintPort_t mask) {\
+                return hostPort[registerChar - 'A'].input & mask;\
+            };\
+            uintPort_t getOutputValues(const uintPort_t mask) {\
+                return hostPort[registerChar - 'A'].output & mask;\
+            };\
+            void setInterrupts(const uint32_t interrupts, const uintPort_t mask) {};\
+        };\
+        typedef Port32<registerChar> Port ## registerLetter;
+
+    typedef Pin<-1> NullPin;
+    static NullPin nullPin;
+
+} // end namespace Motate
+
+// Note: We end the namespace before including in case the included file need to include
+//   another Motate file. If it does include another Motate file, we end up with
+//   Motate::Motate::* definitions and weird compiler errors.
+#include <motate_pin_assignments.h>
+
+#endif /* end of include guard: HOSTPINS_H_ONCE */
@@ -0,0 +1,312 @@
+/*
+  utility/HostTimers.h - Library for the Motate system
+  http://tinkerin.gs/
+
+  Copyright (c) 2013 Robert Giseburt
+
+    This file is part of the Motate Library.
+
+    This file ("the software") is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License, version 2 as published by the
+    Free Software Foundation. You should have received a copy of the GNU General Public
+    License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+    As a special exception, you may use this file as part of a software library without
+    restriction. Specifically, if other files instantiate templates or use macros or
+    inline functions from this file, or you compile this file and link it with  other
+    files to produce an executable, this file does not by itself cause the resulting
+    executable to be covered by the GNU General Public License. This exception does not
+    however invalidate any other reasons why the executable file might be covered by the
+    GNU General Public License.
+
+    THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+    WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+    SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+    OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Host (native) timers for the simulator build.
+ *
+ * There is no hardware, so time is simulated: a 64 bit count of master clock ticks
+ * (SystemCoreClock) that only moves when hostRunTimers() is called. As the clock passes
+ * a running timer's compare A and top the timer interrupt fires with the matching cause,
+ * exactly as the SAM TCs do for the DDA. SysTick fires every millisecond of simulated time.
+ *
+ * Interrupts nest by priority the way the NVIC does it: setInterruptPending() runs the
+ * handler at once if it outranks whatever is running (thread mode, or a lower priority
+ * handler), or as soon as that returns. __disable_irq() holds everything off.
+ */
+
+#ifndef HOSTTIMERS_H_ONCE
+#define HOSTTIMERS_H_ONCE
+
+#include "host_cmsis.h"
+
+namespace Motate {
+	enum TimerMode {
+		kTimerInputCapture         = 0,
+		kTimerInputCaptureToMatch  = 1,
+		kTimerUp                   = 2,
+		kTimerUpToMatch            = 3,
+		kPWMLeftAligned            = kTimerUpToMatch,
+		kTimerUpDown               = 4,
+		kTimerUpDownToMatch        = 5,
+		kPWMCenterAligned          = kTimerUpDownToMatch,
+	};
+
+	enum TimerChannelOutputOptions {
+		kOutputDisconnected = 0,
+
+		kToggleAOnCompareA  = 1<<0,
+		kClearAOnCompareA   = 1<<1,
+		kSetAOnCompareA     = 1<<2,
+
+		kToggleBOnCompareB  = 1<<3,
+		kClearBOnCompareB   = 1<<4,
+		kSetBOnCompareB     = 1<<5,
+
+		kToggleAOnMatch     = 1<<6,
+		kClearAOnMatch      = 1<<7,
+		kSetAOnMatch        = 1<<8,
+
+		kToggleBOnMatch     = 1<<9,
+		kClearBOnMatch      = 1<<10,
+		kSetBOnMatch        = 1<<11,
+
+		/* Aliases for use with PWM */
+		kPWMOnA             = kClearAOnCompareA | kSetAOnMatch,
+		kPWMOnAInverted     = kSetAOnCompareA | kClearAOnMatch,
+
+		kPWMOnB             = kClearBOnCompareB | kSetBOnMatch,
+		kPWMOnBInverted     = kSetBOnCompareB | kClearBOnMatch
+	};
+
+	enum TimerChannelInterruptOptions {
+		kInterruptsOff              = 0,
+		/* Alias for "off" to make more sense
+			when returned from setInterruptPending(). */
+		kInterruptUnknown           = 0,
+
+		kInterruptOnMatchA          = 1<<1,
+		kInterruptOnMatchB          = 1<<2,
+		/* Note: Interrupt on overflow could be a match C as well. */
+		kInterruptOnOverflow        = 1<<3,
+
+		/* This turns the IRQ on, but doesn't set the timer to ever trigger it. */
+		kInterruptOnSoftwareTrigger = 1<<4,
+
+		/* Set priority levels here as well: */
+		kInterruptPriorityHighest   = 1<<5,
+		kInterruptPriorityHigh      = 1<<6,
+		kInterruptPriorityMedium    = 1<<7,
+		kInterruptPriorityLow       = 1<<8,
+		kInterruptPriorityLowest    = 1<<9,
+	};
+
+	enum TimerErrorCodes {
+		kFrequencyUnattainable = -1,
+		kInvalidMode = -2,
+	};
+
+	enum PWMTimerClockOptions {
+		kPWMClockPrescalerOnly = 0,
+		kPWMClockPrescaleAndDivA = 1,
+		kPWMClockPrescaleAndDivB = 2,
+	};
+
+	typedef const uint8_t timer_number;
+
+	// Simulated timer state, one per TC channel. See HostTimers.cpp
+	struct HostTimer_t {
+		uint32_t top;						// period in master clock ticks
+		uint32_t match_a;
+		uint32_t match_b;
+		uint32_t interrupts;				// enabled kInterruptOn... sources
+		uint8_t priority;					// NVIC numbering - 0 is the most urgent
+		bool running;
+		volatile bool pending;
+		volatile uint32_t cause;			// reported (and cleared) by getInterruptCause()
+		uint64_t period_start;				// clock at the start of the current period
+		uint64_t next_event;				// clock of the next compare or top
+		uint32_t next_cause;
+		void (*isr)();
+		volatile int32_t qdec_position;		// quadrature decoder count - set by the simulation
+	};
+	static const uint8_t kHostTimerCount = 9;
+	extern HostTimer_t hostTimer[kHostTimerCount];
+
+	uint64_t hostGetTime();							// simulated master clock ticks since start
+	void hostRunTimers(const uint32_t microseconds);	// advance the clock, firing interrupts as they come due
+	void hostStartTimer(const uint8_t timerNum);
+	void hostSetInterruptPending(const uint8_t timerNum);
+
+	template <uint8_t timerNum>
+	struct Timer {
+
+		Timer() { init(); };
+		Timer(const TimerMode mode, const uint32_t freq) {
+			init();
+			setModeAndFrequency(mode, freq);
+		};
+
+		void init() {
+			hostTimer[timerNum].isr = interrupt;
+			hostTimer[timerNum].priority = 15;
+		};
+
+		// Set the mode and frequency.
+		// Returns: The actual frequency that was used.
+		int32_t setModeAndFrequency(const TimerMode mode, uint32_t freq) {
+			if (freq == 0 || freq > SystemCoreClock)
+				return kFrequencyUnattainable;
+			hostTimer[timerNum].top = SystemCoreClock / freq;
+			return SystemCoreClock / hostTimer[timerNum].top;
+		};
+
+		// Change the frequency without stopping - there's no output to glitch here.
+		int32_t updateFrequency(uint32_t freq) {
+			return setModeAndFrequency(kTimerUpToMatch, freq);
+		};
+
+		// Set the TOP value for modes that use it.
+		void setTop(const uint32_t topValue) {
+			hostTimer[timerNum].top = (topValue > 0) ? topValue : 1;
+		};
+
+		// Here we want to get what the TOP value is.
+		uint32_t getTopValue() {
+			return hostTimer[timerNum].top;
+		};
+
+		// Return the current value of the counter. This is a fleeting thing...
+		uint32_t getValue() {
+			if (!hostTimer[timerNum].running)
+				return 0;
+			return (uint32_t)(hostGetTime() - hostTimer[timerNum].period_start);
+		};
+
+		void start() {
+			hostStartTimer(timerNum);
+		};
+
+		void stop() {
+			hostTimer[timerNum].running = false;
+		};
+
+		void stopOnMatch() {};
+
+		// No decoder hardware - the count is whatever the simulation puts in qdec_position
+		void setQuadratureDecoder(const uint8_t filter) {};
+		int32_t getQuadraturePosition() {
+			return hostTimer[timerNum].qdec_position;
+		};
+
+		// Specify the duty cycle as a value from 0.0 .. 1.0;
+		void setDutyCycleA(const float ratio) {
+			hostTimer[timerNum].match_a = hostTimer[timerNum].top * ratio;
+		};
+
+		void setDutyCycleB(const float ratio) {
+			hostTimer[timerNum].match_b = hostTimer[timerNum].top * ratio;
+		};
+
+		// Specify channel A/B duty cycle as a integer value from 0 .. TOP.
+		void setExactDutyCycleA(const uint32_t absolute) {
+			hostTimer[timerNum].match_a = absolute;
+		};
+
+		void setExactDutyCycleB(const uint32_t absolute) {
+			hostTimer[timerNum].match_b = absolute;
+		};
+
+		void setOutputOptions(const uint32_t options) {};
+		void setOutputAOptions(const uint32_t options) {};
+		void setOutputBOptions(const uint32_t options) {};
+		void stopPWMOutputA() {};
+		void stopPWMOutputB() {};
+		void startPWMOutputA() {};
+		void startPWMOutputB() {};
+
+		void setInterrupts(const uint32_t interrupts) {
+			hostTimer[timerNum].interrupts = interrupts & (kInterruptOnMatchA | kInterruptOnMatchB | kInterruptOnOverflow | kInterruptOnSoftwareTrigger);
+
+			if (interrupts & kInterruptPriorityHighest) {
+				hostTimer[timerNum].priority = 0;
+			} else if (interrupts & kInterruptPriorityHigh) {
+				hostTimer[timerNum].priority = 3;
+			} else if (interrupts & kInterruptPriorityMedium) {
+				hostTimer[timerNum].priority = 7;
+			} else if (interrupts & kInterruptPriorityLow) {
+				hostTimer[timerNum].priority = 11;
+			} else if (interrupts & kInterruptPriorityLowest) {
+				hostTimer[timerNum].priority = 15;
+			}
+		};
+
+		void setInterruptPending() {
+			hostSetInterruptPending(timerNum);
+		};
+
+		// Read and clear the cause of the interrupt being handled
+		TimerChannelInterruptOptions getInterruptCause() {
+			uint32_t cause = hostTimer[timerNum].cause;
+			hostTimer[timerNum].cause = kInterruptUnknown;
+			return (TimerChannelInterruptOptions)cause;
+		};
+
+		// Placeholder for user code.
+		static void interrupt() __attribute__ ((weak));
+	};
+
+	static const timer_number SysTickTimerNum = 0xFF;
+	template <>
+	struct Timer<SysTickTimerNum> {
+		static volatile uint32_t _motateTickCount;
+
+		Timer() { init(); };
+		Timer(const TimerMode mode, const uint32_t freq) {
+			init();
+		};
+
+		void init() {
+			_motateTickCount = 0;
+		};
+
+		// Return the current value of the counter. This is a fleeting thing...
+		uint32_t getValue() {
+			return _motateTickCount;
+		};
+
+		// Microseconds of simulated time since start, wrapping over the full 32 bits as on the SAM
+		uint32_t getMicros() {
+			return ((uint32_t)(hostGetTime() / (SystemCoreClock / 1000000)));
+		};
+
+		void _increment() {
+			_motateTickCount++;
+		};
+
+		// Placeholder for user code.
+		static void interrupt() __attribute__ ((weak));
+	};
+	extern Timer<SysTickTimerNum> SysTickTimer;
+
+	// Provide a Arduino-compatible blocking-delay function
+	// Nothing else can move the clock while this blocks, so it runs the clock itself.
+	inline void delay( uint32_t microseconds )
+	{
+		uint32_t doneTime = SysTickTimer.getValue() + microseconds;
+
+		do {
+			hostRunTimers(1000);
+		} while ( SysTickTimer.getValue() < doneTime );
+	}
+
+} // namespace Motate
+
+#define MOTATE_TIMER_INTERRUPT(number) template<> void Timer<number>::interrupt()
+
+#endif /* end of include guard: HOSTTIMERS_H_ONCE */
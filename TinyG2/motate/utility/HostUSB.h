@@ -0,0 +1,220 @@
+/*
+  utility/HostUSB.h - Library for the Motate system
+  http://tinkerin.gs/
+
+  Copyright (c) 2013 Robert Giseburt
+
+    This file is part of the Motate Library.
+
+    This file ("the software") is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License, version 2 as published by the
+    Free Software Foundation. You should have received a copy of the GNU General Public
+    License, version 2 along with the software. If not, see <http://www.gnu.org/licenses/>.
+
+    As a special exception, you may use this file as part of a software library without
+    restriction. Specifically, if other files instantiate templates or use macros or
+    inline functions from this file, or you compile this file and link it with  other
+    files to produce an executable, this file does not by itself cause the resulting
+    executable to be covered by the GNU General Public License. This exception does not
+    however invalidate any other reasons why the executable file might be covered by the
+    GNU General Public License.
+
+    THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+    WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+    OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+    SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+    OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+/* Host (native) USB for the simulator build.
+ *
+ * There is no bus. The first interface's serial port is wired to the console: its read
+ * endpoint reads from an input file descriptor (the Gcode file, or stdin) and its write
+ * endpoint writes to stdout. Any other endpoints are silent. attach() plays the part of a
+ * terminal opening the port by raising DTR on the first interface, which is what the xio
+ * layer waits for before it uses a device.
+ */
+
+#ifndef HOSTUSB_ONCE
+#define HOSTUSB_ONCE
+
+#include "MotateUSBHelpers.h"
+
+namespace Motate {
+
+	/*** ENDPOINT CONFIGURATION ***/
+
+	typedef uint32_t EndpointBufferSettings_t;
+
+	enum USBEndpointBufferSettingsFlags_t {
+		// null endpoint is all zeros
+		kEndpointBufferNull            = 0,
+
+		// endpoint direction
+		kEndpointBufferOutputFromHost  = 0<<8,
+		kEndpointBufferInputToHost     = 1<<8,
+
+		// buffer sizes
+		kEnpointBufferSizeUpTo8        = 0<<4,
+		kEnpointBufferSizeUpTo16       = 1<<4,
+		kEnpointBufferSizeUpTo32       = 2<<4,
+		kEnpointBufferSizeUpTo64       = 3<<4,
+		kEnpointBufferSizeUpTo128      = 4<<4,
+		kEnpointBufferSizeUpTo256      = 5<<4,
+		kEnpointBufferSizeUpTo512      = 6<<4,
+		kEnpointBufferSizeUpTo1024     = 7<<4,
+
+		// buffer "blocks" -- 2 == "ping pong"
+		kEndpointBufferBlocks1         = 0<<2,
+		kEndpointBufferBlocksUpTo2     = 1<<2,
+		kEndpointBufferBlocksUpTo3     = 2<<2,
+
+		// endpoint types
+		kEndpointBufferTypeControl     = 0<<11,
+		kEndpointBufferTypeIsochronous = 1<<11,
+		kEndpointBufferTypeBulk        = 2<<11,
+		kEndpointBufferTypeInterrupt   = 3<<11
+	};
+
+	// Convert from number to EndpointBufferSettings_t
+	static const EndpointBufferSettings_t getBufferSizeFlags(const uint16_t size) {
+		if (size > 512) {
+			return kEnpointBufferSizeUpTo1024;
+		} else if (size > 128) {
+			return kEnpointBufferSizeUpTo512;
+		} else if (size > 64) {
+			return kEnpointBufferSizeUpTo128;
+		} else if (size > 32) {
+			return kEnpointBufferSizeUpTo64;
+		} else if (size > 16) {
+			return kEnpointBufferSizeUpTo32;
+		} else if (size > 8) {
+			return kEnpointBufferSizeUpTo16;
+		}
+		return kEnpointBufferSizeUpTo8;
+	};
+
+	/*** STRINGS ***/
+
+	const uint16_t *getUSBVendorString(int16_t &length) ATTR_WEAK;
+	const uint16_t *getUSBProductString(int16_t &length) ATTR_WEAK;
+	const uint16_t *getUSBSerialNumberString(int16_t &length) ATTR_WEAK;
+
+	// Nothing ever asks for the strings here, but user code still declares them.
+#define MOTATE_SET_USB_VENDOR_STRING(...)\
+	const uint16_t MOTATE_USBVendorString[] = __VA_ARGS__;\
+	const uint16_t *Motate::getUSBVendorString(int16_t &length) {\
+		length = sizeof(MOTATE_USBVendorString);\
+		return MOTATE_USBVendorString;\
+	}
+
+#define MOTATE_SET_USB_PRODUCT_STRING(...)\
+	const uint16_t MOTATE_USBProductString[] = __VA_ARGS__;\
+	const uint16_t *Motate::getUSBProductString(int16_t &length) {\
+		length = sizeof(MOTATE_USBProductString);\
+		return MOTATE_USBProductString;\
+	}
+
+#define MOTATE_SET_USB_SERIAL_NUMBER_STRING(...)\
+	const uint16_t MOTATE_USBSerialNumberString[] = __VA_ARGS__;\
+	const uint16_t *Motate::getUSBSerialNumberString(int16_t &length) {\
+		length = sizeof(MOTATE_USBSerialNumberString);\
+		return MOTATE_USBSerialNumberString;\
+	}
+
+#define MOTATE_SET_USB_SERIAL_NUMBER_STRING_FROM_CHIPID()\
+	const uint16_t *Motate::getUSBSerialNumberString(int16_t &length) {\
+		const uint16_t *uuid = readUniqueIdString();\
+		length = UNIQUE_ID_STRING_LEN * sizeof(uint16_t);\
+		return uuid;\
+	}
+
+	/*** USBDeviceHardware ***/
+
+	// The console - see HostUSB.cpp
+	void hostUSBSetInput(const int fd);			// defaults to stdin
+	bool hostUSBInputDone();						// true once the input has hit end of file
+	extern int16_t _readFromConsole(uint8_t* data, int16_t len);
+	extern int16_t _writeToConsole(const uint8_t* data, int16_t length);
+	extern void _flushConsole();
+
+	template< typename parent >
+	class USBDeviceHardware
+	{
+		parent* const parent_this;
+
+		static const uint8_t _console_read_endpoint  = parent::_interface_0_first_endpoint + 1;
+		static const uint8_t _console_write_endpoint = parent::_interface_0_first_endpoint + 2;
+
+	public:
+
+		static const uint8_t master_control_endpoint = 0;
+
+		USBDeviceHardware() : parent_this(static_cast< parent* >(this)) {};
+
+		static bool attach() {
+			// SetControlLineState with DTR up, as a terminal opening the port sends it
+			Setup_t setup = {
+				Setup_t::kRequestHostToDevice | Setup_t::kRequestClass | Setup_t::kRequestInterface,
+				/* kSetControlLineState */ 0x22,
+				/* DTR */ 0x01, 0,
+				parent::_config_type::_interface_0_number, 0
+			};
+			parent::handleNonstandardRequest(setup);
+			return true;
+		};
+
+		static bool detach() { return true; };
+
+		static int16_t availableToRead(const uint8_t endpoint) { return 0; };
+
+		static int16_t readByte(const uint8_t endpoint) {
+			uint8_t c;
+			if ((endpoint != _console_read_endpoint) || (_readFromConsole(&c, 1) < 1))
+				return -1;
+			return c;
+		};
+
+		static int16_t read(const uint8_t endpoint, uint8_t *buffer, int16_t length) {
+			if ((endpoint != _console_read_endpoint) || length < 0)
+				return -1;
+			return _readFromConsole(buffer, length);
+		};
+
+		static int16_t write(const uint8_t endpoint, const uint8_t * buffer, int16_t length) {
+			if (length < 0)
+				return -1;
+			if (endpoint != _console_write_endpoint)
+				return length;			// the bit bucket
+			return _writeToConsole(buffer, length);
+		};
+
+		static void flush(const uint8_t endpoint) {
+			if (endpoint == _console_write_endpoint)
+				_flushConsole();
+		};
+
+		static void flushRead(const uint8_t endpoint) {};
+
+		static int16_t readFromControl(const uint8_t endpoint, uint8_t *buffer, int16_t length) { return length; };
+		static int16_t writeToControl(const uint8_t endpoint, const uint8_t *buffer, int16_t length) { return length; };
+		static void sendString(const uint8_t stringNum, int16_t maxLength) {};
+
+		static const USBDeviceSpeed_t getDeviceSpeed() { return kUSBDeviceFullSpeed; };
+
+		static uint16_t getEndpointSizeFromHardware(const uint8_t &endpoint, const bool otherSpeed) {
+			return (endpoint == 0) ? 64 : 0;
+		};
+
+		static const EndpointBufferSettings_t getEndpointConfigFromHardware(const uint8_t endpoint) {
+			if (endpoint == 0)
+				return getBufferSizeFlags(64) | kEndpointBufferBlocks1 | kEndpointBufferTypeControl;
+			return kEndpointBufferNull;
+		};
+	}; //class USBDeviceHardware
+}
+
+#endif
+//HOSTUSB_ONCE
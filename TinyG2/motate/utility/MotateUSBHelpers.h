@@ -92,7 +92,7 @@ namespace Motate {
 		kInterfaceDescriptor            = 0x04, /* interface descriptor. */
 		kEndpointDescriptor             = 0x05, /* endpoint descriptor. */
 		kDeviceQualifierDescriptor      = 0x06, /* device qualifier descriptor. */
-		kOtherDescriptor                = 0x07, /* other type. */
+		kOtherDescriptor                = 0x07, /* other speed configuration descriptor. */
 		kInterfacePowerDescriptor       = 0x08, /* interface power descriptor. */
 		kInterfaceAssociationDescriptor = 0x0B, /* interface association descriptor. */
 		kCSInterfaceDescriptor          = 0x24, /* class specific interface descriptor. */
@@ -383,9 +383,11 @@ namespace Motate {
 
 										 uint8_t  _ConfigAttributes,
 
-										 uint16_t  _MaxPowerConsumption
+										 uint16_t  _MaxPowerConsumption,
+
+										 uint8_t  _DescriptorType = kConfigurationDescriptor /* or kOtherDescriptor */
 										)
-		: Header(sizeof(USBDescriptorConfigurationHeader_t), kConfigurationDescriptor),
+		: Header(sizeof(USBDescriptorConfigurationHeader_t), _DescriptorType),
         TotalConfigurationSize(_TotalConfigurationSize),
         TotalInterfaces(_TotalInterfaces),
 
@@ -460,12 +462,14 @@ namespace Motate {
 											   /* _TotalConfigurationSize = */ sizeof(_this_type),
 											   /*        _TotalInterfaces = */ _total_interfaces_used,
 
-											   /*    _ConfigurationNumber = */ _otherConfig ? 2 : 1,
+											   /*    _ConfigurationNumber = */ 1, /* the other speed configuration is the same one */
 											   /*  _ConfigurationStrIndex = */ 0, /* Fixme? */
 
 											   /*       _ConfigAttributes = */ _ConfigAttributes,
 
-											   /*    _MaxPowerConsumption = */ _MaxPowerConsumption
+											   /*    _MaxPowerConsumption = */ _MaxPowerConsumption,
+
+											   /*         _DescriptorType = */ _otherConfig ? kOtherDescriptor : kConfigurationDescriptor
 											   ),
 			_config_mixin_0_type(_interface_0_first_endpoint, _interface_0_number, _deviceSpeed, _otherConfig),
 			_config_mixin_1_type(_interface_1_first_endpoint, _interface_1_number, _deviceSpeed, _otherConfig),
@@ -597,7 +601,7 @@ namespace Motate {
 	 Bulk Endpoints:
 	 low speed devices : not allowed
 	 full speed devices: 8, 16, 32 or 64 bytes
-	 high speed devices: up to 512 bytes
+	 high speed devices: 512 bytes
 
 	 Useful resources:
 	 http://www.beyondlogic.org/usbnutshell/usb4.shtml
@@ -608,40 +612,40 @@ namespace Motate {
 	extern uint16_t checkEndpointSizeHardwareLimits(const uint16_t tempSize, const uint8_t endpointNumber, const USBEndpointType_t endpointType, const bool otherSpeed);
 
 	// Here we use the above rules for endpoints, and then determine, based on the endpoint number, type, and which if it's the main speed or "other speed."
+	// The "other speed" is the speed a high-speed capable device would run at on the other kind of bus: full speed when
+	// we're running at high speed, and high speed when we're running at full speed (used for the other speed configuration).
+	// limitedSize keeps interrupt and isochronous endpoints at 64 bytes. High-speed bulk endpoints are always 512 bytes.
 	static /*inline*/ uint16_t getEndpointSize(const uint8_t endpointNumber, const USBEndpointType_t endpointType, const USBDeviceSpeed_t USBDeviceSpeed, const bool otherSpeed, bool limitedSize = false) {
 		uint16_t tempSize = 0;
-        uint16_t suggestedSize = 512;
-        if (otherSpeed) {
-            suggestedSize = 64;
-        } else if (limitedSize) {
-            suggestedSize = 256;
-        }
-
-		if (USBDeviceSpeed == kUSBDeviceHighSpeed) {
-			// Note that other_speed only applies to high-speed devices
-			if (endpointType == kEndpointTypeIsochronous) {
-				tempSize = suggestedSize;
+		USBDeviceSpeed_t speed = USBDeviceSpeed;
+		if (otherSpeed) {
+			if (USBDeviceSpeed == kUSBDeviceHighSpeed) {
+				speed = kUSBDeviceFullSpeed;
+			} else if (USBDeviceSpeed == kUSBDeviceFullSpeed) {
+				speed = kUSBDeviceHighSpeed;
 			}
-			if (endpointType == kEndpointTypeInterrupt) {
-				tempSize = suggestedSize;
-			}
-			else if (endpointType == kEndpointTypeBulk) {
-				tempSize = suggestedSize;
+		}
+
+		if (speed == kUSBDeviceHighSpeed) {
+			if (endpointType == kEndpointTypeBulk) {
+				tempSize = 512; // the only legal size for high-speed bulk endpoints
+			} else if (endpointType == kEndpointTypeInterrupt || endpointType == kEndpointTypeIsochronous) {
+				tempSize = limitedSize ? 64 : 512;
 			} else {
-				tempSize = 64; // maximum size for all other full-speed endpoints is 64
+				tempSize = 64; // control endpoints are always 64 bytes at high speed
 			}
 		}
 
-		if (USBDeviceSpeed == kUSBDeviceFullSpeed) {
-			if (endpointType == kEndpointTypeIsochronous) {
-				tempSize = suggestedSize; // WTF?!?
+		if (speed == kUSBDeviceFullSpeed) {
+			if (endpointType == kEndpointTypeIsochronous && !limitedSize) {
+				tempSize = 512;
 			} else {
 				tempSize = 64; // maximum size for all other full-speed endpoints is 64
 			}
 		}
 
 		// low speed devices have more restrictions, let's get that out of the way...
-		if (USBDeviceSpeed == kUSBDeviceLowSpeed) {
+		if (speed == kUSBDeviceLowSpeed) {
 			if (endpointType == kEndpointTypeControl || endpointType == kEndpointTypeInterrupt) {
 				tempSize = 8;
 			}
@@ -880,6 +884,10 @@ namespace Motate {
 			return (_bmRequestType == (kRequestHostToDevice | kRequestClass | kRequestInterface));
 		};
 
+		const bool isAHostToDeviceVendorInterfaceRequest() const {
+			return (_bmRequestType == (kRequestHostToDevice | kRequestVendor | kRequestInterface));
+		};
+
 		const bool requestIs(uint8_t testRequest) const {
 			return _bRequest == testRequest;
 		};
@@ -127,6 +127,9 @@ namespace Motate {
         void getOptions() {
             // stub
         };
+        void setDebounceTime(const uint32_t microseconds) {
+            // stub
+        };
         void set(const uintPort_t value) {
             // stub
         };
@@ -165,10 +168,12 @@ namespace Motate {
         PinMode getMode() { return kUnchanged; };
         void setOptions(const uint16_t options, const bool fromConstructor=false) {};
         uint16_t getOptions() { return kNormal; };
+        void setDebounceTime(const uint32_t microseconds) {};
         void set() {};
         void clear() {};
         void write(const bool value) {};
         void toggle() {};
+        void setInterrupts(const uint32_t interrupts) {};
         uint8_t get() { return 0; };
         uint8_t getInputValue() { return 0; };
         uint8_t getOutputValue() { return 0; };
@@ -358,6 +363,10 @@ MOTATE_PIN_INTERRUPT_NAME_( x, y )
                     | (((*PIO ## registerLetter).PIO_IFSR & mask) ? \
                         (((*PIO ## registerLetter).PIO_IFDGSR & mask) ? kDebounce : kDeglitch) : 0);\
             };\
+            /* The debounce period is shared by all the pins of the port. */\
+            void setDebounceTime(const uint32_t microseconds) {\
+                port ## registerLetter.setDebounceTime(microseconds);\
+            };\
             void set() {\
                 (*PIO ## registerLetter).PIO_SODR = mask;\
             };\
@@ -441,9 +450,9 @@ MOTATE_PIN_INTERRUPT_NAME_( x, y )
                 timerOrPWM::setOutput ## channelAorB ## Options((invertedByDefault ^ ((options & kPWMPinInverted)?true:false)) ? kPWMOn ## channelAorB ## Inverted : kPWMOn ## channelAorB);\
                 timerOrPWM::start();\
             };\
+            /* Takes effect without stopping the output - see updateFrequency() */\
             void setFrequency(const uint32_t freq) {\
-                timerOrPWM::setModeAndFrequency(Motate::kTimerUpToMatch, freq);\
-                timerOrPWM::start();\
+                timerOrPWM::updateFrequency(freq);\
             };\
             void operator=(const float value) { write(value); };\
             void write(const float value) {\
@@ -585,6 +594,14 @@ MOTATE_PIN_INTERRUPT_NAME_( x, y )
                     }\
                 }\
             };\
+            /* Pins filtered with kDebounce ignore pulses shorter than half the period: */\
+            /* 2 * (DIV + 1) slow clock (32.768kHz) cycles, so 61us to 1 second. */\
+            void setDebounceTime(const uint32_t microseconds) {\
+                uint32_t divider = (uint32_t)(((uint64_t)microseconds * 32768) / 2000000);\
+                if (divider > 0) { divider--; }\
+                if (divider > PIO_SCDR_DIV_Msk) { divider = PIO_SCDR_DIV_Msk; }\
+                (*PIO ## registerLetter).PIO_SCDR = PIO_SCDR_DIV(divider);\
+            };\
             void set(const uintPort_t value) {\
                 (*PIO ## registerLetter).PIO_SODR = value;\
             };\
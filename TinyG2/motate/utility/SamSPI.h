@@ -326,6 +326,23 @@ namespace Motate {
             hardware.enable();
         };
         
+        // Exchange one byte with the device (BLOCKING). The chip select stays asserted from one
+        // transfer to the next (CSAAT) until a transfer is made with lastXfer. Call setChannel() first.
+        int16_t transfer(uint8_t data, const bool lastXfer = false) {
+            while (!(spi()->SPI_SR & SPI_SR_TXEMPTY))
+                ;
+            (void)spi()->SPI_RDR;   // drop anything a write() left behind
+
+            spi()->SPI_TDR = data;
+            if (lastXfer) {
+                spi()->SPI_CR = SPI_CR_LASTXFER;
+            }
+
+            while (!(spi()->SPI_SR & SPI_SR_RDRF))
+                ;
+            return spi()->SPI_RDR;
+        };
+
         // WARNING: Currently only writes in bytes. For more-that-byte size data, we'll need another call.
 		int16_t write(const uint8_t *data, const uint16_t length, bool autoFlush = true) {
 			if (!setChannel())
@@ -358,6 +375,9 @@ namespace Motate {
 			return total_written;
 		}
 	};
+
+    template<int8_t spiCSPinNumber, int8_t spiMISOPinNumber, int8_t spiMOSIPinNumber, int8_t spiSCKSPinNumber>
+    _SPIHardware< SPIChipSelectPin<spiCSPinNumber>::moduleId, spiMISOPinNumber, spiMOSIPinNumber, spiSCKSPinNumber > SPI<spiCSPinNumber, spiMISOPinNumber, spiMOSIPinNumber, spiSCKSPinNumber>::hardware;
     
 }
 
@@ -299,6 +299,51 @@ namespace Motate {
 			return tcChan()->TC_CMR & TC_CMR_CPCTRG ? tcChan()->TC_RC : 0xFFFF;
 		};
 
+		// Change the frequency of a running PWM (kTimerUpToMatch or kTimerUpDownToMatch) without
+		// stopping it. The clock divisor is kept and RA and RB are scaled to keep their duty cycles.
+		// A TC has no update registers, so if the counter is already past the new TOP the period
+		// is restarted rather than letting it run on to 0xFFFF. Falls back to setModeAndFrequency()
+		// if the divisor has to change, still scaling RA and RB. Returns the frequency that was set.
+		int32_t updateFrequency(uint32_t freq) {
+			uint32_t cmr = tcChan()->TC_CMR;
+			uint32_t clock = cmr & TC_CMR_TCCLKS_Msk;
+			TimerMode mode = (TimerMode)(cmr & (TC_CMR_WAVE | TC_CMR_WAVSEL_Msk));
+			uint32_t divisor = 2 << (2 * clock);                // MCK/2, /8, /32, /128
+			uint32_t top = tcChan()->TC_RC;
+
+			if (mode == kTimerUpDownToMatch)
+				freq /= 2;
+
+			uint32_t newTop = (freq == 0) ? 0 : SystemCoreClock/(divisor*freq);
+			if ((clock > TC_CMR_TCCLKS_TIMER_CLOCK4) || !(cmr & TC_CMR_CPCTRG) || (top == 0) ||
+				(newTop < 2) || (newTop > 0xFFFF)) {
+				uint32_t oldTop = getTopValue();
+				uint32_t ra = tcChan()->TC_RA;
+				uint32_t rb = tcChan()->TC_RB;
+				int32_t actual = setModeAndFrequency(mode, (mode == kTimerUpDownToMatch) ? freq*2 : freq);
+				if (oldTop != 0) {                              // keep the duty cycles at the new TOP
+					tcChan()->TC_RA = (ra * getTopValue()) / oldTop;    // both 16 bits - no overflow
+					tcChan()->TC_RB = (rb * getTopValue()) / oldTop;
+				}
+				start();
+				return actual;
+			}
+			uint32_t ra = (tcChan()->TC_RA * newTop) / top;
+			uint32_t rb = (tcChan()->TC_RB * newTop) / top;
+			if (newTop < top) {                                 // never let a compare sit above TOP
+				tcChan()->TC_RA = ra;
+				tcChan()->TC_RB = rb;
+				tcChan()->TC_RC = newTop;
+				if (tcChan()->TC_CV >= newTop)
+					tcChan()->TC_CCR = TC_CCR_SWTRG;            // start the next period now
+			} else {
+				tcChan()->TC_RC = newTop;
+				tcChan()->TC_RA = ra;
+				tcChan()->TC_RB = rb;
+			}
+			return SystemCoreClock/(divisor*newTop);
+		};
+
 		// Return the current value of the counter. This is a fleeting thing...
 		uint32_t getValue() {
 			return tcChan()->TC_CV;
@@ -316,6 +361,26 @@ namespace Motate {
 			tcChan()->TC_CMR = TC_CMR_CPCSTOP;
 		};
 
+		// Quadrature decoder. Only channel 0 of a block (timers 0, 3 and 6) decodes position,
+		// counting the edges of phase A and B on the block's TIOA0 and TIOB0 into TC_CV. The
+		// pins must be set to the TC peripheral. Pulses shorter than filter+1 master clock
+		// periods (0..63) are dropped. start() zeroes the count.
+		void setQuadratureDecoder(const uint8_t filter) {
+			tcChan()->TC_CCR = TC_CCR_CLKDIS;
+			tcChan()->TC_IDR = 0xFFFFFFFF;
+			tcChan()->TC_SR;
+
+			common::enablePeripheralClock();
+
+			tcChan()->TC_CMR = TC_CMR_TCCLKS_XC0 | TC_CMR_ETRGEDG_RISING | TC_CMR_ABETRG;
+			tc()->TC_BMR = TC_BMR_QDEN | TC_BMR_POSEN | TC_BMR_EDGPHA | TC_BMR_MAXFILT(filter);
+		};
+
+		// The count is signed - it goes below zero when the encoder turns backward from start()
+		int32_t getQuadraturePosition() {
+			return (int32_t)tcChan()->TC_CV;
+		};
+
 		// Channel-specific functions. These are Motate channels, but they happen to line-up.
 		// Motate channel A = Sam channel A.
 		// Motate channel B = Sam channel B.
@@ -501,6 +566,11 @@ namespace Motate {
 	template <uint8_t timerNum>
 	struct PWMTimer {
 
+		// CPRD and CDTY only change at the end of a period when set through the update
+		// registers, which can't be read back - so the values last set are kept here.
+		uint32_t _top;
+		uint32_t _duty;
+
 		// NOTE: Notice! The *pointers* are const, not the *values*.
 		static Pwm * const pwm();
 		static PwmCh_num * const pwmChan();
@@ -520,6 +590,8 @@ namespace Motate {
 		};
 
 		void init() {
+			_top = 0;
+			_duty = 0;
 			/* Unlock this thing */
 			unlock();
 		}
@@ -667,15 +739,49 @@ namespace Motate {
 		// Set the TOP value for modes that use it.
 		// WARNING: No sanity checking is done to verify that you are, indeed, in a mode that uses it.
 		void setTop(const uint32_t topValue, bool setOnNext = true) {
+			_top = topValue;
 			if (setOnNext)
 				pwmChan()->PWM_CPRDUPD = topValue;
 			else
 				pwmChan()->PWM_CPRD = topValue;
 		};
 
-		// Here we want to get what the TOP value is.
+		// Here we want to get what the TOP value is - or will be from the next period.
 		uint32_t getTopValue() {
-			return pwmChan()->PWM_CPRD;
+			return _top;
+		};
+
+		// Change the frequency at the end of the current period, without stopping the channel.
+		// The new period and the duty cycle scaled to it go through the update registers, so the
+		// output never sees a partial period. The prescaler is kept - if the new period doesn't
+		// fit it, this falls back to setModeAndFrequency(), which restarts the channel with the
+		// duty cycle scaled to the new period.
+		// Returns the frequency that was set.
+		int32_t updateFrequency(uint32_t frequency) {
+			uint32_t cmr = pwmChan()->PWM_CMR;
+			uint32_t prescaler = cmr & PWM_CMR_CPRE_Msk;
+			bool centerAligned = (cmr & PWM_CMR_CALG);
+
+			uint32_t clock = SystemCoreClock >> prescaler;
+			uint32_t f = centerAligned ? frequency/2 : frequency;
+			uint32_t newTop = (f == 0) ? 0 : clock/f;
+			if ((prescaler > 10) || (_top == 0) || (newTop < 2) || (newTop > 0xFFFF)) {
+				uint32_t oldTop = _top;
+				int32_t actual = setModeAndFrequency(centerAligned ? kPWMCenterAligned : kPWMLeftAligned, frequency);
+				uint32_t duty = (oldTop == 0) ? _duty : (_duty * _top) / oldTop;	// the same duty cycle at the new TOP
+				setExactDutyCycleA(duty, /*setOnNext=*/false);
+				start();
+				return actual;
+			}
+			uint32_t duty = (_duty * newTop) / _top;          // both 16 bits - no overflow
+			if (newTop < _top) {                                // duty never goes above TOP,
+				setExactDutyCycleA(duty);                       // should the period end in between
+				setTop(newTop);
+			} else {
+				setTop(newTop);
+				setExactDutyCycleA(duty);
+			}
+			return clock/newTop;
 		};
 
 		// Return the current value of the counter. This is a fleeting thing...
@@ -695,16 +801,13 @@ namespace Motate {
 
 		// Specify the duty cycle as a value from 0.0 .. 1.0;
 		void setDutyCycleA(const float ratio, bool setOnNext = true) {
-			if (setOnNext)
-				pwmChan()->PWM_CDTYUPD = getTopValue() * ratio;
-			else
-				pwmChan()->PWM_CDTY = getTopValue() * ratio;
-
+			setExactDutyCycleA(getTopValue() * ratio, setOnNext);
 		};
 
 		// Specify channel A/B duty cycle as a integer value from 0 .. TOP.
 		// TOP in this case is either RC_RC or 0xFFFF.
 		void setExactDutyCycleA(const uint32_t absolute, bool setOnNext = true) {
+			_duty = absolute;
 			if (setOnNext)
 				pwmChan()->PWM_CDTYUPD = absolute;
 			else
@@ -849,6 +952,23 @@ namespace Motate {
 			return _motateTickCount;
 		};
 
+		// Microseconds since start. Free running over the full 32 bits (71.6 minutes), so
+		// differences are right across the wrap. It is the millisecond count plus how far the
+		// SysTick down-counter is into the current millisecond, so it costs no timer channel
+		// and is safe at any interrupt level - a tick held off by a higher priority handler
+		// is counted from the pending flag.
+		uint32_t getMicros() {
+			uint32_t ms, count;
+			do {
+				ms = _motateTickCount;
+				count = SysTick->VAL;
+			} while (ms != _motateTickCount);		// the tick ran in between - read again
+			if ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) && (count > (SysTick->LOAD >> 1))) {
+				ms++;								// the counter reloaded but the tick is pending
+			}
+			return ((ms * 1000) + ((SysTick->LOAD - count) / (SystemCoreClock / 1000000)));
+		};
+
 		void _increment() {
 			_motateTickCount++;
 		};
@@ -28,7 +28,7 @@
 #include "persistence.h"
 #include "canonical_machine.h"
 #include "report.h"
-//#include "util.h"
+#include "util.h"
 
 #ifdef __AVR
 #include "xmega/xmega_eeprom.h"
@@ -44,6 +44,156 @@ nvmSingleton_t nvm;
  **** GENERIC STATIC FUNCTIONS AND VARIABLES ***************************************
  ***********************************************************************************/
 
+#ifdef __ARM
+
+#define EFC_CMD_WP	0x01				// EEFC write page
+#define EFC_CMD_EWP	0x03				// EEFC erase page and write page
+#define EFC_KEY		0x5A
+
+#define _record_tag(i) ((uint32_t)(i) | ((uint32_t)(uint16_t)~(i) << 16))
+#define _erased(w) ((w) == 0xFFFFFFFF)
+
+static uint32_t _slot_offset(uint8_t area, uint16_t slot)
+{
+	return (((uint32_t)area * NVM_AREA_SLOTS + slot) * NVM_RECORD_LEN);
+}
+
+static volatile uint32_t *_slot_addr(uint8_t area, uint16_t slot)
+{
+	return ((volatile uint32_t *)(NVM_FLASH_BASE + _slot_offset(area, slot)));
+}
+
+static void _flash_wait()
+{
+	while (!(EFC1->EEFC_FSR & EEFC_FSR_FRDY));
+}
+
+// Start a command on the page holding the slot. Does not wait for completion.
+static void _flash_command(uint8_t cmd, uint8_t area, uint16_t slot)
+{
+	uint32_t page = (NVM_FLASH_BASE - IFLASH1_ADDR + _slot_offset(area, slot)) / NVM_FLASH_PAGE_SIZE;
+	EFC1->EEFC_FCR = EEFC_FCR_FKEY(EFC_KEY) | EEFC_FCR_FARG(page) | EEFC_FCR_FCMD(cmd);
+}
+
+// Erase a page and program it from page_buf. Used by formatting and compaction only.
+static void _write_page(uint8_t area, uint16_t slot)
+{
+	volatile uint32_t *dst = _slot_addr(area, slot);
+	_flash_wait();
+	for (uint8_t i=0; i < NVM_FLASH_PAGE_SIZE/4; i++) { dst[i] = nvm.page_buf[i]; }
+	_flash_command(EFC_CMD_EWP, area, slot);
+}
+
+/*
+ * _layout() - signature of the config table the records are keyed by
+ *
+ *	Records carry cfgArray indexes, which shift whenever a build adds or drops settings.
+ *	The signature is the table length and a CRC of its group and token strings, so an
+ *	area written by any other layout is not read back into the wrong settings.
+ */
+static uint32_t _layout()
+{
+	uint8_t buf[2 + GROUP_LEN+1 + TOKEN_LEN+1];
+	uint16_t crc = 0xFFFF;
+	for (index_t i=0; i < nv_index_max(); i++) {
+		buf[0] = crc & 0xFF;
+		buf[1] = crc >> 8;
+		memcpy(&buf[2], cfgArray[i].group, GROUP_LEN+1);
+		memcpy(&buf[2 + GROUP_LEN+1], cfgArray[i].token, TOKEN_LEN+1);
+		crc = compute_crc16(buf, sizeof(buf));
+	}
+	return (((uint32_t)nv_index_max() << 16) | crc);
+}
+
+static uint8_t _header_valid(uint8_t area)
+{
+	volatile uint32_t *header = _slot_addr(area, 0);
+	return ((header[0] == _record_tag(NVM_HEADER_MAGIC)) && (header[2] == nvm.layout));
+}
+
+// Write everything after the header, then the header page last so an interrupted
+// compaction leaves the previous area in charge.
+static void _write_header(uint8_t area, uint32_t sequence)
+{
+	memset(nvm.page_buf, 0xFF, sizeof(nvm.page_buf));
+	nvm.page_buf[0] = _record_tag(NVM_HEADER_MAGIC);
+	nvm.page_buf[1] = sequence;
+	nvm.page_buf[2] = nvm.layout;
+	_write_page(area, 0);
+	_flash_wait();
+}
+
+static void _format(uint8_t area, uint32_t sequence)
+{
+	memset(nvm.page_buf, 0xFF, sizeof(nvm.page_buf));
+	for (uint16_t s = NVM_FIRST_SLOT; s < NVM_AREA_SLOTS; s += NVM_PAGE_SLOTS) {
+		_write_page(area, s);
+	}
+	_write_header(area, sequence);
+	nvm.area = area;
+	nvm.sequence = sequence;
+	nvm.next_slot = NVM_FIRST_SLOT;
+}
+
+/*
+ * _compact() - copy the newest record of every index into the other area
+ *
+ *	Blocks for one erase/write per page of the area - roughly the time the EEPROM
+ *	took to rewrite the whole profile. Only called from write_persistent_value(),
+ *	which already refuses to run while the machine is moving.
+ */
+static void _compact()
+{
+	uint8_t to = nvm.area ^ 1;
+	uint16_t index = 0;
+	uint16_t dest = NVM_FIRST_SLOT;
+
+	while (dest < NVM_AREA_SLOTS) {
+		memset(nvm.page_buf, 0xFF, sizeof(nvm.page_buf));
+		_flash_wait();							// old area must be readable
+		for (uint8_t i=0; (i < NVM_PAGE_SLOTS) && (index < NVM_INDEX_MAX); index++) {
+			if (nvm.slot[index] == NVM_NO_SLOT) continue;
+			nvm.page_buf[i*2] = _record_tag(index);
+			nvm.page_buf[i*2+1] = _slot_addr(nvm.area, nvm.slot[index])[1];
+			nvm.slot[index] = dest + i++;
+		}
+		_write_page(to, dest);					// erases pages past the last record as well
+		dest += NVM_PAGE_SLOTS;
+	}
+	// recompute the first free slot from the RAM index
+	nvm.next_slot = NVM_FIRST_SLOT;
+	for (index = 0; index < NVM_INDEX_MAX; index++) {
+		if ((nvm.slot[index] != NVM_NO_SLOT) && (nvm.slot[index] >= nvm.next_slot)) {
+			nvm.next_slot = nvm.slot[index] + 1;
+		}
+	}
+	_write_header(to, ++nvm.sequence);
+	nvm.area = to;
+	nvm.compactions++;
+}
+
+/*
+ * _scan() - rebuild the RAM index from the active area
+ *
+ *	Stops at the first erased slot. Records that fail the check (e.g. power lost
+ *	during a page write) are skipped but still consume their slot.
+ */
+static void _scan()
+{
+	memset(nvm.slot, 0xFF, sizeof(nvm.slot));
+	for (nvm.next_slot = NVM_FIRST_SLOT; nvm.next_slot < NVM_AREA_SLOTS; nvm.next_slot++) {
+		volatile uint32_t *rec = _slot_addr(nvm.area, nvm.next_slot);
+		uint32_t tag = rec[0];
+		if (_erased(tag) && _erased(rec[1])) break;
+		uint16_t index = tag & 0xFFFF;
+		if ((tag == _record_tag(index)) && (index < NVM_INDEX_MAX)) {
+			nvm.slot[index] = nvm.next_slot;
+		}
+	}
+}
+
+#endif // __ARM
+
 
 /***********************************************************************************
  **** CODE *************************************************************************
@@ -54,6 +204,21 @@ void persistence_init()
 #ifdef __AVR
 	nvm.base_addr = NVM_BASE_ADDR;
 	nvm.profile_base = 0;
+#endif
+#ifdef __ARM
+	nvm.layout = _layout();
+	uint8_t valid0 = _header_valid(0);
+	uint8_t valid1 = _header_valid(1);
+	if (!valid0 && !valid1) {
+		_format(0, 1);							// blank flash or another build's table - start a fresh log
+		memset(nvm.slot, 0xFF, sizeof(nvm.slot));
+		return;
+	}
+	uint32_t seq0 = _slot_addr(0, 0)[1];
+	uint32_t seq1 = _slot_addr(1, 0)[1];
+	nvm.area = (valid1 && (!valid0 || ((int32_t)(seq1 - seq0) > 0))) ? 1 : 0;
+	nvm.sequence = nvm.area ? seq1 : seq0;
+	_scan();
 #endif
 	return;
 }
@@ -78,7 +243,13 @@ stat_t read_persistent_value(nvObj_t *nv)
 #ifdef __ARM
 stat_t read_persistent_value(nvObj_t *nv)
 {
-	nv->value = 0;
+	if ((nv->index >= NVM_INDEX_MAX) || (nvm.slot[nv->index] == NVM_NO_SLOT)) {
+		nv->value = 0;							// never written - caller loads the default
+		return (STAT_OK);
+	}
+	_flash_wait();								// bank 1 can't be read while it is programming
+	uint32_t bits = _slot_addr(nvm.area, nvm.slot[nv->index])[1];
+	memcpy(&nv->value, &bits, NVM_VALUE_LEN);
 	return (STAT_OK);
 }
 #endif // __ARM
@@ -110,6 +281,30 @@ stat_t write_persistent_value(nvObj_t *nv)
 stat_t write_persistent_value(nvObj_t *nv)
 {
 	if (cm.cycle_state != CYCLE_OFF) return(rpt_exception(STAT_FILE_NOT_OPEN, "write_persistent")); // can't write when machine is moving
+	if (nv->index >= NVM_INDEX_MAX) return(rpt_exception(STAT_INTERNAL_RANGE_ERROR, "write_persistent"));
+
+	nvm.tmp_value = nv->value;
+	if (nvm.slot[nv->index] != NVM_NO_SLOT) {	// skip the write if the value has not changed
+		ritorno(read_persistent_value(nv));
+		if (!isnan((double)nv->value) && !isinf((double)nv->value) && fp_EQ(nv->value, nvm.tmp_value)) {
+			nv->value = nvm.tmp_value;
+			return (STAT_OK);
+		}
+	}
+	nv->value = nvm.tmp_value;					// always restore value
+
+	if (nvm.next_slot >= NVM_AREA_SLOTS) {
+		_compact();
+		if (nvm.next_slot >= NVM_AREA_SLOTS) return(rpt_exception(STAT_FILE_SIZE_EXCEEDED, "write_persistent"));
+	}
+	uint32_t bits;
+	memcpy(&bits, &nvm.tmp_value, NVM_VALUE_LEN);
+	volatile uint32_t *rec = _slot_addr(nvm.area, nvm.next_slot);
+	_flash_wait();								// finish the previous append
+	rec[0] = _record_tag(nv->index);			// load the page latch; the rest of it stays 0xFF
+	rec[1] = bits;
+	_flash_command(EFC_CMD_WP, nvm.area, nvm.next_slot);	// returns while the page programs
+	nvm.slot[nv->index] = nvm.next_slot++;
 	return (STAT_OK);
 }
 #endif // __ARM
@@ -33,6 +33,42 @@
 #define NVM_VALUE_LEN 4				// NVM value length (float, fixed length)
 #define NVM_BASE_ADDR 0x0000		// base address of usable NVM
 
+/* ARM flash persistence
+ *
+ *	The SAM3X has no EEPROM, so values are kept in a log at the top of internal flash
+ *	bank 1 (EFC1). The log occupies two areas of NVM_FLASH_AREA_PAGES pages each. Each
+ *	area starts with a header page carrying a sequence number and a signature of the config
+ *	table layout - an area written by a build with other settings is reformatted. The rest
+ *	of the area is filled with 8 byte (index, value) records in the order they were
+ *	written. The newest record for an index wins. When the active area fills up the live
+ *	records are copied into the other area (compaction), which then becomes active with
+ *	the next sequence number. Pages are only erased during compaction, so erase cycles
+ *	are spread over the whole log.
+ *
+ *	Firmware runs from bank 0, so a page write in bank 1 does not stall the CPU. Appends
+ *	start the flash command and return without waiting for it to finish.
+ *
+ *	The linker script (gcc_flash.ld) keeps code out of the top NVM_FLASH_SIZE bytes, and
+ *	fails the link if code or constants reach past bank 0.
+ */
+#ifdef __ARM
+#ifndef NVM_FLASH_AREA_PAGES
+#define NVM_FLASH_AREA_PAGES 32		// pages per log area (8 Kbytes, 1024 slots)
+#endif
+#define NVM_FLASH_PAGE_SIZE IFLASH1_PAGE_SIZE
+#define NVM_FLASH_SIZE (2 * NVM_FLASH_AREA_PAGES * NVM_FLASH_PAGE_SIZE)
+#define NVM_FLASH_BASE (IFLASH1_ADDR + IFLASH1_SIZE - NVM_FLASH_SIZE)
+#define NVM_RECORD_LEN 8			// uint16 index, uint16 check (~index), float value
+#define NVM_PAGE_SLOTS (NVM_FLASH_PAGE_SIZE / NVM_RECORD_LEN)
+#define NVM_AREA_SLOTS (NVM_FLASH_AREA_PAGES * NVM_PAGE_SLOTS)
+#define NVM_FIRST_SLOT NVM_PAGE_SLOTS	// page 0 of each area holds only the header
+#define NVM_HEADER_MAGIC 0x5447		// "TG" - index field of the area header record
+#ifndef NVM_INDEX_MAX
+#define NVM_INDEX_MAX 1024			// size of the RAM index; must exceed the number of config values
+#endif
+#define NVM_NO_SLOT 0xFFFF			// RAM index entry for a value that has never been written
+#endif
+
 //**** persistence singleton ****
 
 typedef struct nvmSingleton {
@@ -41,6 +77,15 @@ typedef struct nvmSingleton {
 	uint16_t address;
 	float tmp_value;
 	int8_t byte_array[NVM_VALUE_LEN];
+#ifdef __ARM
+	uint8_t area;						// active log area (0 or 1)
+	uint32_t sequence;					// sequence number of the active area
+	uint32_t layout;					// config table signature written into the area headers
+	uint16_t next_slot;					// next free record slot in the active area
+	uint16_t compactions;				// compactions since reset (diagnostic)
+	uint16_t slot[NVM_INDEX_MAX];		// RAM index: newest slot for each config index
+	uint32_t page_buf[NVM_FLASH_PAGE_SIZE/4];	// staging buffer for compaction
+#endif
 } nvmSingleton_t;
 
 //**** persistence function prototypes ****
@@ -23,6 +23,9 @@
 #include "plan_arc.h"
 #include "planner.h"
 #include "util.h"
+#ifdef __HOST__
+#include "host.h"
+#endif
 
 #include "controller.h"//+++++
 
@@ -36,12 +39,15 @@ static stat_t _compute_arc(const bool radius_f);
 static void _compute_arc_offsets_from_radius(void);
 static float _estimate_arc_time (float arc_time);
 static stat_t _test_arc_soft_limits(void);
+static stat_t _test_spline_soft_limits(const float point[4][2]);
+static bool _arc_sweeps(const float angle);
 
 /*****************************************************************************
  * Canonical Machining arc functions (arc prep for planning and runtime)
  *
  * cm_arc_init()     - initialize arcs
  * cm_arc_feed()     - canonical machine entry point for arc
+ * cm_spline_feed()  - canonical machine entry point for G5 and G5.1 splines
  * cm_arc_callback() - main-loop callback for arc generation
  * cm_abort_arc()    - stop an arc in process
  */
@@ -72,6 +78,12 @@ void cm_abort_arc()
  *  cm_arc_cycle_callback() is called from the controller main loop. Each time it's called
  *  it queues as many arc segments (lines) as it can before it blocks, then returns.
  *
+ *  Each segment endpoint is found by rotating the radius vector by segment_theta with a 2x2
+ *  multiply using the precomputed segment sin and cos - 4 multiplies rather than a sin and a
+ *  cos per segment, which are expensive in soft float. Rounding error accumulates in the
+ *  rotation, so every ARC_CORRECTION_SEGMENTS segments, and for the last segment, the vector
+ *  is recomputed exactly from the start angle and the segment index.
+ *
  *  Parts of this routine were informed by the grbl project.
  */
 
@@ -83,11 +95,26 @@ stat_t cm_arc_callback()
 	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
         return (STAT_EAGAIN);
     }
-	arc.theta += arc.segment_theta;
-	arc.gm.target[arc.plane_axis_0] = arc.center_0 + sin(arc.theta) * arc.radius;
-	arc.gm.target[arc.plane_axis_1] = arc.center_1 + cos(arc.theta) * arc.radius;
+	int32_t segment = (int32_t)arc.segments - arc.segment_count + 1;   // 1 is the first segment
+	if ((arc.segment_count == 1) || ((segment % ARC_CORRECTION_SEGMENTS) == 0)) {
+		float angle = arc.theta + segment * arc.segment_theta;
+		arc.vector_0 = sin(angle) * arc.radius;
+		arc.vector_1 = cos(angle) * arc.radius;
+	} else {
+		float vector_0 = arc.vector_0 * arc.segment_cos + arc.vector_1 * arc.segment_sin;
+		arc.vector_1 = arc.vector_1 * arc.segment_cos - arc.vector_0 * arc.segment_sin;
+		arc.vector_0 = vector_0;
+	}
+	arc.gm.target[arc.plane_axis_0] = arc.center_0 + arc.vector_0;
+	arc.gm.target[arc.plane_axis_1] = arc.center_1 + arc.vector_1;
 	arc.gm.target[arc.linear_axis] += arc.segment_linear_travel;
+#ifdef __VELOCITY_HINTS
+	arc.gm.exit_hint = (arc.segment_count == 1) ? arc.exit_hint : 0;
+#endif
 
+#ifdef __HOST__
+	host_record_move(arc.gm.linenum, arc.gm.motion_mode, arc.gm.feed_rate, arc.gm.target, AXES);	// see host.h
+#endif
 	mp_aline(&arc.gm);								// run the line
 	copy_vector(arc.position, arc.gm.target);		// update arc current position
 
@@ -101,8 +128,9 @@ stat_t cm_arc_callback()
 /*
  * cm_arc_feed() - canonical machine entry point for arcs
  *
- * Generates an arc by queuing line segments to the move buffer. The arc is
- * approximated by generating a large number of tiny, linear segments.
+ * Generates an arc by queuing it to the planner as a single MOVE_TYPE_ARC block - see mp_arc().
+ * If __PLANNER_ARCS is not defined the arc is instead approximated by queuing a large number
+ * of tiny, linear segments from cm_arc_callback().
  */
 
 stat_t cm_arc_feed(const float target[], const bool target_f[],     // target endpoint
@@ -242,11 +270,155 @@ stat_t cm_arc_feed(const float target[], const bool target_f[],     // target en
 	}
 
 	cm_cycle_start();						        // if not already started
+#ifdef __PLANNER_ARCS
+	mpArc_t geometry;
+	geometry.radius = arc.radius;
+	geometry.theta = arc.theta;
+	geometry.angular_travel = arc.angular_travel;
+	geometry.plane_axis_0 = arc.plane_axis_0;
+	geometry.plane_axis_1 = arc.plane_axis_1;
+	arc.gm.move_time = _estimate_arc_time(0);
+	arc.gm.minimum_time = arc.gm.move_time;
+	mp_arc(&arc.gm, &geometry, arc.length);	        // the planner sets the exit tangent
+#else
+#ifdef __VELOCITY_HINTS
+	arc.exit_hint = arc.gm.exit_hint;
+#endif
 	arc.run_state = MOVE_RUN;				        // enable arc to be run from the callback
+	cm_set_cycle_callback(cm_arc_callback);
+#endif
 	cm_finalize_move();
 	return (STAT_OK);
 }
 
+/*
+ * cm_spline_feed() - canonical machine entry point for G5 and G5.1 splines
+ *
+ *	G5 X Y I J P Q is a cubic spline. I J is the first control point relative to the start
+ *	and P Q the second control point relative to the end. I J may be left out of a G5 that
+ *	follows another G5, in which case the curve carries on smoothly from the last one - the
+ *	first control point is the previous second control point mirrored through the start.
+ *	G5.1 X Y I J is a quadratic spline with I J the control point relative to the start.
+ *	It's raised to the same curve as a cubic.
+ *
+ *	As in LinuxCNC splines are only in the XY plane (G17). Other axes move in proportion to
+ *	the distance along the curve. The spline is queued to the planner as a single
+ *	MOVE_TYPE_SPLINE block, held to the velocity of its tightest curvature - see mp_spline().
+ */
+
+stat_t cm_spline_feed(const float target[], const bool target_f[],  // target endpoint
+                      const float offset[], const bool offset_f[],  // IJ first control point offset
+                      const float P_word, const bool P_word_f,      // PQ second control point offset
+                      const float Q_word, const bool Q_word_f,
+                      const uint8_t motion_mode)                    // cubic or quadratic
+{
+	bool cubic = (motion_mode == MOTION_MODE_CUBIC_SPLINE);
+	bool continued = cubic && (cm.gm.motion_mode == MOTION_MODE_CUBIC_SPLINE) &&
+					 fp_EQ(cm.gmx.position[AXIS_X], arc.spline_end[0]) &&
+					 fp_EQ(cm.gmx.position[AXIS_Y], arc.spline_end[1]);
+
+	// it's legal for a G5 to have no axis words (e.g. F alone) but we don't want to process it
+	if (!(target_f[AXIS_X] || target_f[AXIS_Y] || target_f[AXIS_Z] ||
+		  target_f[AXIS_A] || target_f[AXIS_B] || target_f[AXIS_C])) {
+		cm.gm.motion_mode = motion_mode;
+		return (STAT_OK);
+	}
+
+	// trap missing feed rate, the wrong plane and missing control points
+	if (fp_ZERO(cm.gm.feed_rate)) {
+		return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
+	}
+	if (cm.gm.select_plane != CANON_PLANE_XY) {
+		return (STAT_GCODE_ACTIVE_PLANE_IS_INVALID);
+	}
+	if (offset_f[OFS_I] != offset_f[OFS_J]) {                       // both or neither
+		return (STAT_ARC_OFFSETS_MISSING_FOR_SELECTED_PLANE);
+	}
+	if (!offset_f[OFS_I] && !continued) {
+		return (STAT_ARC_OFFSETS_MISSING_FOR_SELECTED_PLANE);
+	}
+	if (cubic && !P_word_f) {
+		return (STAT_P_WORD_IS_MISSING);
+	}
+	if (cubic && !Q_word_f) {
+		return (STAT_Q_WORD_IS_MISSING);
+	}
+	cm.gm.motion_mode = motion_mode;
+	cm_set_model_target(target, target_f);
+	ritorno(cm_test_soft_limits(cm.gm.target));
+
+	// set up the curve in XY
+	mpSpline_t spline;
+	spline.plane_axis_0 = AXIS_X;
+	spline.plane_axis_1 = AXIS_Y;
+	float (*point)[2] = spline.point;
+	for (uint8_t i=0; i<2; i++) {
+		point[0][i] = cm.gmx.position[AXIS_X + i];
+		point[3][i] = cm.gm.target[AXIS_X + i];
+		if (cubic) {
+			if (offset_f[OFS_I]) {
+				point[1][i] = point[0][i] + _to_millimeters(offset[OFS_I + i]);
+			} else {
+				point[1][i] = 2 * point[0][i] - arc.spline_control[i];
+			}
+			point[2][i] = point[3][i] + _to_millimeters((i == 0) ? P_word : Q_word);
+		} else {
+			float control = point[0][i] + _to_millimeters(offset[OFS_I + i]);
+			point[1][i] = point[0][i] + (control - point[0][i]) * 2 / 3;
+			point[2][i] = point[3][i] + (control - point[3][i]) * 2 / 3;
+		}
+	}
+
+	// test spline soft limits - the curve never leaves the box around its control points
+	stat_t status = _test_spline_soft_limits(point);
+	if (status != STAT_OK) {
+		cm.gm.motion_mode = MOTION_MODE_CANCEL_MOTION_MODE;
+		copy_vector(cm.gm.target, cm.gmx.position);     // reset model position
+		return (cm_alarm(status, "spline soft_limits"));
+	}
+	for (uint8_t i=0; i<2; i++) {
+		arc.spline_control[i] = point[2][i];
+		arc.spline_end[i] = point[3][i];
+	}
+	float min_radius;
+	float planar_travel = mp_set_spline_table(&spline, &min_radius);
+
+	// length and move time, as for arcs - see _estimate_arc_time()
+	float linear_square = 0;
+	for (uint8_t axis=AXIS_Z; axis<AXES_ACTIVE; axis++) {
+		linear_square += square(cm.gm.target[axis] - cm.gmx.position[axis]);
+	}
+	float length = sqrt(square(planar_travel) + linear_square);
+	float move_time;
+	if (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+		move_time = cm.gm.feed_rate;    // inverse feed rate has been normalized to minutes
+	} else {
+		move_time = length / cm.gm.feed_rate;
+	}
+	move_time = max(move_time, planar_travel / cm.a[AXIS_X].feedrate_max);
+	move_time = max(move_time, planar_travel / cm.a[AXIS_Y].feedrate_max);
+	for (uint8_t axis=AXIS_Z; axis<AXES_ACTIVE; axis++) {
+		float travel = fabs(cm.gm.target[axis] - cm.gmx.position[axis]);
+		if (travel > 0) {
+			move_time = max(move_time, travel / cm.a[axis].feedrate_max);
+		}
+	}
+	move_time = max(move_time, length / mp_get_arc_velocity_max(min_radius, AXIS_X, AXIS_Y));
+	cm.gm.move_time = move_time;
+	cm.gm.minimum_time = move_time;
+
+	cm_set_work_offsets(&cm.gm);                    // capture the fully resolved offsets to the state
+	cm_cycle_start();                               // if not already started
+	status = mp_spline(&cm.gm, &spline, length);
+	cm_finalize_move();
+
+	if (status == STAT_MINIMUM_LENGTH_MOVE && !mp_has_runnable_buffer()) {
+		cm_cycle_end();
+		return (STAT_OK);
+	}
+	return (status);
+}
+
 /*
  * _compute_arc() - compute arc from I and J (arc center point)
  *
@@ -331,12 +503,21 @@ static stat_t _compute_arc(const bool radius_f)
     arc.planar_travel = arc.angular_travel * arc.radius;
     arc.length = hypotf(arc.planar_travel, fabs(arc.linear_travel));
 
-    // Find the minimum number of segments that meet accuracy and time constraints...
+#ifndef __PLANNER_ARCS                              // segments are only needed to run the arc as lines
+    // Hold the segment feed to the centripetal limit (the arc block applies it via move time)
+    float velocity_max = mp_get_arc_velocity_max(arc.radius, arc.plane_axis_0, arc.plane_axis_1);
+    if (arc.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+        arc.gm.feed_rate = max(arc.gm.feed_rate, arc.length / velocity_max);
+    } else {
+        arc.gm.feed_rate = min(arc.gm.feed_rate, velocity_max);
+    }
+
+    // Find the number of segments that meets chordal accuracy, subject to the caps...
     // Note: removed segment_length test as segment_time accounts for this (build 083.37)
-    float arc_time;
-    float segments_for_minimum_time = _estimate_arc_time(arc_time) * (MICROSECONDS_PER_MINUTE / MIN_ARC_SEGMENT_USEC);
-    float segments_for_chordal_accuracy = arc.length / sqrt(4*cm.chordal_tolerance * (2 * arc.radius - cm.chordal_tolerance));
-    arc.segments = floor(min(segments_for_chordal_accuracy, segments_for_minimum_time));
+    float segments_for_chordal_accuracy = ceil(fabs(arc.angular_travel) / mp_get_arc_segment_angle(arc.radius));
+    float segments_for_minimum_time = floor(_estimate_arc_time(0) * (MICROSECONDS_PER_MINUTE / MIN_ARC_SEGMENT_USEC));
+    arc.segments = min(segments_for_chordal_accuracy, segments_for_minimum_time);
+    arc.segments = min(arc.segments, ARC_SEGMENTS_MAX);
     arc.segments = max(arc.segments, (float)1.0);		//...but is at least 1 segment
 
     if (arc.gm.feed_rate_mode == INVERSE_TIME_MODE) {
@@ -346,9 +527,14 @@ static stat_t _compute_arc(const bool radius_f)
     arc.segment_count = (int32_t)arc.segments;
     arc.segment_theta = arc.angular_travel / arc.segments;
     arc.segment_linear_travel = arc.linear_travel / arc.segments;
-    arc.center_0 = arc.position[arc.plane_axis_0] - sin(arc.theta) * arc.radius;
-    arc.center_1 = arc.position[arc.plane_axis_1] - cos(arc.theta) * arc.radius;
+    arc.segment_cos = cos(arc.segment_theta);
+    arc.segment_sin = sin(arc.segment_theta);
+    arc.vector_0 = sin(arc.theta) * arc.radius;
+    arc.vector_1 = cos(arc.theta) * arc.radius;
+    arc.center_0 = arc.position[arc.plane_axis_0] - arc.vector_0;
+    arc.center_1 = arc.position[arc.plane_axis_1] - arc.vector_1;
     arc.gm.target[arc.linear_axis] = arc.position[arc.linear_axis];	// initialize the linear target
+#endif
     return (STAT_OK);
 }
 
@@ -477,6 +663,10 @@ static void _compute_arc_offsets_from_radius()
  *	dimension, but the comparison assumes that the arc will have at least one segment
  *	where the unit vector is 1 in that dimension. This is not true for any arbitrary arc,
  *	with the result that the time returned may be less than optimal.
+ *
+ *	The time is also held to the centripetal velocity limit from the radius and the plane
+ *	axes' jerk (see mp_get_arc_velocity_max()), so small radius arcs run at a smooth
+ *	constant speed rather than leaving the junctions to slow them down.
  */
 static float _estimate_arc_time (float arc_time)
 {
@@ -493,93 +683,90 @@ static float _estimate_arc_time (float arc_time)
 	if (fabs(arc.linear_travel) > 0) {
 		arc_time = max(arc_time, (float)fabs(arc.linear_travel/cm.a[arc.linear_axis].feedrate_max));
 	}
+	arc_time = max(arc_time, arc.length / mp_get_arc_velocity_max(arc.radius, arc.plane_axis_0, arc.plane_axis_1));
     return (arc_time);
 }
 
 /*
  * _test_arc_soft_limits() - return error code if soft limit is exceeded
  *
- *	Test if arc extends beyond arc plane boundaries set in soft limits.
- *
- *	The arc starting position (P) and target (T) define 2 points that divide the
- *	arc plane into 9 rectangles. The center of the arc is (C). P and T define the
- *	endpoints of two possible arcs; one that is less than or equal to 180 degrees (acute)
- *	and one that is greater than 180 degrees (obtuse), depending on the location of (C).
+ *	Test if any part of the arc extends beyond the soft limits, not just its endpoint.
  *
- *	-------------------------------  plane boundaries in X and Y
- *  |         |         |         |
- *  |    1    |    2    |    3    |
- *  |                   |         |
- *	--------- P -------------------
- *  |                   |         |
- *  |    4    |    5    |    6    |
- *  |         |                   |
- *	------------------- T ---------
- *  |        C|                   |  C shows one of many possible center locations
- *  |    7    |    8    |    9    |
- *  |         |         |         |
- *	-------------------------------
+ *	The arc is enclosed in a box that's tested once against the soft limits. The box starts
+ *	as the one spanned by the starting position and the target, which covers the linear
+ *	(helix) axis and any others moving with the arc. In the arc plane the box is then
+ *	stretched out to center +/- radius on each plane axis the arc sweeps across the extreme
+ *	of. The point at angle a is (center_0 + radius * sin(a), center_1 + radius * cos(a)),
+ *	with angles measured as they are for arc.theta, so the extremes are at:
  *
- *	C will fall along a diagonal bisecting 7, 5 and 3, but there is some tolerance in the
- *	circle algorithm that allows C to deviate from the centerline slightly. As the centerline
- *	approaches the line connecting S and T the acute arcs will be "above" S and T in sections
- *	5 or 3, and the obtuse arcs will be "below" in sections 5 or 7. But it's simpler, because
- *	we know that the arc is > 180 degrees (obtuse) if the angular travel value is > pi.
- *
- *	The example below only tests the X axis (0 axis), but testing the other axis is similar
- *
- *	  (1) If Cx <= Px and arc is acute; no test is needed
- *
- *	  (2) If Cx <= Px and arc is obtuse; test if the radius is greater than
- *			the distance from Cx to the negative X boundary
- *
- *	  (3) If Px < Cx < Tx and arc is acute; test if the radius is greater than
- *			the distance from Cx to the positive X boundary
- *
- *	  (4) If Px < Cx < Tx and arc is obtuse; test if the radius is greater than
- *			the distance from Cx to the positive X boundary
- *
- *	The arc plane is defined by 0 and 1 depending on G17/G18/G19 plane selected,
- *	corresponding to arc planes XY, XZ, YZ, respectively.
+ *	  plane axis 0:	max at pi/2, min at -pi/2
+ *	  plane axis 1:	max at 0,    min at pi
  *
  *	Must be called with all the following set in the arc struct
  *	  -	arc starting position (arc.position)
- *	  - arc ending position (arc.gm.target)
- *	  - arc center (arc.center_0, arc.center_1)
+ *	  - arc ending position (cm.gm.target - arc.gm.target is reused to run segments)
+ *	  - arc center offsets (arc.offset)
  *	  - arc.radius (arc.radius)
- *	  - arc angular travel in radians (arc.angular_travel)
- *	  - max and min travel in axis 0 and axis 1 (in cm struct)
+ *	  - arc starting angle and angular travel in radians (arc.theta, arc.angular_travel)
  */
-/*
-static stat_t _test_arc_soft_limit_plane_axis(float center, uint8_t plane_axis)
+static bool _arc_sweeps(const float angle)		// true if the arc passes through the angle
 {
-	if (center <= arc.position[plane_axis]) {
-		if (arc.angular_travel < M_PI) {							// case (1)
-			return (STAT_OK);
-		}
-		if ((center - arc.radius) < cm.a[plane_axis].travel_min) {	// case (2)
-			return (STAT_SOFT_LIMIT_EXCEEDED);
-		}
+	if (fabs(arc.angular_travel) >= 2*M_PI) {
+		return (true);
 	}
-	if ((center + arc.radius) > cm.a[plane_axis].travel_max) {		// cases (3) and (4)
-		return (STAT_SOFT_LIMIT_EXCEEDED);
+	float sweep = (arc.angular_travel > 0) ? (angle - arc.theta) : (arc.theta - angle);
+	sweep = fmod(sweep, 2*M_PI);
+	if (sweep < 0) {
+		sweep += 2*M_PI;
 	}
-	return(STAT_OK);
+	return (sweep <= fabs(arc.angular_travel));
 }
-*/
+
 static stat_t _test_arc_soft_limits()
 {
-/*
-    if (cm.soft_limit_enable == true) {
-
-        // Test if target falls outside boundaries. This is a 3 dimensional test
-        // so it also checks the linear axis of the arc (helix axis)
-        ritorno(cm_test_soft_limits(arc.gm.target));
+	if (cm.soft_limit_count == 0) {
+		return (STAT_OK);
+	}
+	float box_min[AXES];
+	float box_max[AXES];
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		box_min[axis] = min(arc.position[axis], cm.gm.target[axis]);
+		box_max[axis] = max(arc.position[axis], cm.gm.target[axis]);
+	}
+	float center_0 = arc.position[arc.plane_axis_0] + arc.offset[arc.plane_axis_0];
+	float center_1 = arc.position[arc.plane_axis_1] + arc.offset[arc.plane_axis_1];
+	if (_arc_sweeps(M_PI/2))  { box_max[arc.plane_axis_0] = center_0 + arc.radius; }
+	if (_arc_sweeps(-M_PI/2)) { box_min[arc.plane_axis_0] = center_0 - arc.radius; }
+	if (_arc_sweeps(0))       { box_max[arc.plane_axis_1] = center_1 + arc.radius; }
+	if (_arc_sweeps(M_PI))    { box_min[arc.plane_axis_1] = center_1 - arc.radius; }
+
+	return (cm_test_soft_limit_box(box_min, box_max));
+}
 
-        // test arc extents
-        ritorno(_test_arc_soft_limit_plane_axis(arc.center_0, arc.plane_axis_0));
-        ritorno(_test_arc_soft_limit_plane_axis(arc.center_1, arc.plane_axis_1));
-    }
-*/
-    return(STAT_OK);
+/*
+ * _test_spline_soft_limits() - return error code if any part of a spline is outside the soft limits
+ *
+ *	A Bezier curve lies inside the convex hull of its control points, so the box around the
+ *	four XY points encloses the whole curve. As for arcs the other axes span the box between
+ *	the starting position and the target. Control points outside the limits can reject a
+ *	curve that stays inside them, but never the other way round.
+ */
+static stat_t _test_spline_soft_limits(const float point[4][2])
+{
+	if (cm.soft_limit_count == 0) {
+		return (STAT_OK);
+	}
+	float box_min[AXES];
+	float box_max[AXES];
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		box_min[axis] = min(cm.gmx.position[axis], cm.gm.target[axis]);
+		box_max[axis] = max(cm.gmx.position[axis], cm.gm.target[axis]);
+	}
+	for (uint8_t p=1; p<3; p++) {
+		for (uint8_t i=0; i<2; i++) {
+			box_min[AXIS_X + i] = min(box_min[AXIS_X + i], point[p][i]);
+			box_max[AXIS_X + i] = max(box_max[AXIS_X + i], point[p][i]);
+		}
+	}
+	return (cm_test_soft_limit_box(box_min, box_max));
 }
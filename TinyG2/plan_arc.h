@@ -22,7 +22,21 @@
 
 #define MIN_ARC_RADIUS          ((float)0.1)        // min radius that can be executed
 #define MIN_ARC_SEGMENT_LENGTH  ((float)0.05)       // Arc segment size (mm).(0.03)
-#define MIN_ARC_SEGMENT_USEC    ((float)10000)      // minimum arc segment time
+
+// Arc segmentation for arcs run as lines (__PLANNER_ARCS not defined). The segment count is
+// set by chordal tolerance ($ct), then capped by the max segments per arc and by a minimum
+// segment time. The minimum time is that which lets a queue full of arc segments still hold
+// MIN_PLANNED_TIME, so arcs can't starve the planner. Arc blocks are held to $ct in the exec.
+#ifndef ARC_SEGMENTS_MAX
+#define ARC_SEGMENTS_MAX        ((float)1000)       // max segments in a single arc (or helix)
+#endif
+#define MIN_ARC_SEGMENT_USEC    (MIN_PLANNED_USEC / (PLANNER_BUFFER_POOL_SIZE - PLANNER_BUFFER_HEADROOM))
+
+// Segments are generated by rotating the radius vector by the segment angle. Every N segments
+// (and on the last segment) the vector is recomputed exactly from sin/cos to bound the drift.
+#ifndef ARC_CORRECTION_SEGMENTS
+#define ARC_CORRECTION_SEGMENTS 16                  // segments between exact re-anchoring
+#endif
 
 // Arc radius tests. See http://linuxcnc.org/docs/html/gcode/gcode.html#sec:G2-G3-Arc
 //#define ARC_RADIUS_ERROR_MAX    ((float)0.5)        // max allowable mm between start and end radius
@@ -54,9 +68,19 @@ typedef struct arArcSingleton {	// persistent planner and runtime variables
     int32_t segment_count;      // count of running segments
     float segment_theta;        // angular motion per segment
     float segment_linear_travel;// linear motion per segment
+    float segment_cos;          // cos of segment_theta - the incremental rotation
+    float segment_sin;          // sin of segment_theta
+#ifdef __VELOCITY_HINTS
+    float exit_hint;            // (VEX) hint of the arc, for its last segment only
+#endif
+    float vector_0;             // radius vector from center at plane axis 0 (r * sin(angle))
+    float vector_1;             // radius vector from center at plane axis 1 (r * cos(angle))
     float center_0;             // center of circle at plane axis 0 (e.g. X for G17)
     float center_1;             // center of circle at plane axis 1 (e.g. Y for G17)
 
+    float spline_control[2];    // XY second control point of the last G5, for a G5 without I and J
+    float spline_end[2];        // XY end of the last G5
+
     GCodeState_t gm;            // Gcode state struct is passed for each arc segment.
 //	Usage:
 //	uint32_t linenum;			// line number of the arc feed move - same for each segment
@@ -30,20 +30,59 @@
 #include "config.h"
 #include "controller.h"
 #include "planner.h"
+#include "plan_arc.h"
+#include "plan_shaper.h"
+#include "plan_stats.h"
+#include "plan_retrace.h"
 #include "kinematics.h"
 #include "stepper.h"
 #include "encoder.h"
 #include "report.h"
 #include "util.h"
 #include "spindle.h"
+#include "pwm.h"
+#include "hardware.h"
 
 // execute routines (NB: These are all called from the LO interrupt)
-static stat_t _exec_aline_head(void);
-static stat_t _exec_aline_body(void);
-static stat_t _exec_aline_tail(void);
-static stat_t _exec_aline_segment(void);
+// The per-segment path runs from SRAM - see RAMFUNC in hardware.h
+static stat_t _exec_aline_head(void) RAMFUNC;
+static stat_t _exec_dry_plan(mpBuf_t *bf);
+static stat_t _exec_aline_body(void) RAMFUNC;
+static stat_t _exec_aline_tail(void) RAMFUNC;
+static stat_t _exec_aline_segment(void) RAMFUNC;
+static stat_t _exec_body_segment(void) RAMFUNC;
+static void _solve_sub_chord_end(void);
+static void _interpolate_joint_steps(void);
+static void _init_arc(const mpBuf_t *bf);
+static void _get_arc_position(const float distance, fxpos_t position[]);
+static float _get_arc_segments(const float segments, const float length);
+static void _init_arc_rotation(void);
+static void _rotate_arc_position(fxpos_t position[]) RAMFUNC;
+static void _update_position(void);
+static float _get_remaining_length(void);
+static float _get_override_time(void);
+static stat_t _prep_segment(float travel_steps[]);
+#ifdef __PRESSURE_ADVANCE
+static bool _advance_segment(float advanced_steps[], float travel_steps[], float segment_time);
+#endif
+#ifdef __TORCH_HEIGHT
+static bool _thc_segment(float thc_steps[], const float target_steps[], float travel_steps[], float segment_time);
+#endif
+#ifdef __THREADING
+static void _start_spindle_sync(void);
+static stat_t _wait_for_index(mpBuf_t *bf);
+static float _get_sync_time(void);
+static void _end_spindle_sync(void);
+#endif
+static void _prep_pwm(void);
+#ifdef __MOTION_OUTPUTS
+static void _prep_outputs(void);
+#endif
 
 static void _init_forward_diffs(float Vi, float Vt);
+static void _load_forward_diffs(float Vi, float Vt);
+static inline float _first_forward_diff(void);
+static inline void _advance_forward_diffs(void);
 
 using namespace Motate;
 //OutputPin<kDebug1_PinNumber> exec_debug_pin1;
@@ -56,28 +95,102 @@ using namespace Motate;
  *
  *	Dequeues the buffer queue and executes the move continuations.
  *	Manages run buffers and other details
+ *
+ *	Note: With __PLANNER_PROFILE defined mp_exec_move() times the calls that prep a
+ *	segment, done in _exec_move().
  */
 
-stat_t mp_exec_move()
+#ifdef __PLANNER_PROFILE
+static stat_t _exec_move();
+
+RAMFUNC stat_t mp_exec_move()
+{
+	uint32_t start = hw_get_cpu_cycles();
+	stat_t status = _exec_move();
+	if (status != STAT_NOOP) {
+		mp_profile_time(&mp_prof.exec, hw_get_cpu_cycles() - start);
+	}
+	return (status);
+}
+
+static stat_t _exec_move()
+#else
+RAMFUNC stat_t mp_exec_move()
+#endif
 {
 	mpBuf_t *bf;
 
-	if ((bf = mp_get_run_buffer()) == NULL) {			// NULL means nothing's running
+	if ((mb.dry_plan == DRY_PLAN_ON) && !mp_planner_is_full()) {
+		return (STAT_NOOP);								// dry plan: leave the lookahead a full queue has
+	}
+#ifdef __PATH_RETRACE
+	if (mp_retrace_is_running()) {
+		return (mp_retrace_exec());						// backing up along the path, or returning, ahead of the held move
+	}
+#endif
+	bf = mp_get_run_buffer();
+#ifdef __INPUT_SHAPING
+	if (mp_shaper_is_settling() && ((bf == NULL) || !mp_move_type_is_planned(bf->move_type) || bf->aux_stop)) {
+		return (mp_shaper_exec_settle());				// shaped motion comes to rest before anything else
+	}
+#endif
+	if (bf == NULL) {									// NULL means nothing's running
+#ifdef __LINE_TIMES
+		mp_line_time_idle();							// the last line run is finished
+#endif
 		st_prep_null();
 		return (STAT_NOOP);
 	}
+#ifdef __THREADING
+	if ((!mp_move_type_is_planned(bf->move_type) && !bf->pass_through) || bf->aux_stop) {
+		mr.sync_state = SYNC_OFF;						// a stop of any kind ends a thread
+	}
+#endif
+	if (mp_dry_plan_is_active()) {
+		return (_exec_dry_plan(bf));
+	}
+	if (bf->aux_stop) {
+		return (mp_prep_stop_command(bf));				// stop commands it carries run at rest first
+	}
 	// Manage cycle and motion state transitions
-	if (bf->move_type == MOVE_TYPE_ALINE) { 			// cycle auto-start for lines only
+	if (mp_move_type_is_planned(bf->move_type)) {		// cycle auto-start for lines and arcs only
         if (cm.motion_state == MOTION_STOP) {
             cm_set_motion_state(MOTION_RUN);
         }
 	}
     if (bf->bf_func == NULL) {
-        return(cm_panic(STAT_INTERNAL_ERROR, "exec_move")); // never supposed to get here
+        return(rpt_post_panic(STAT_INTERNAL_ERROR, "exec_move", 0)); // never supposed to get here
     }
 	return (bf->bf_func(bf)); 							// run the move callback in the planner buffer
 }
 
+/*
+ * _exec_dry_plan() - time a block and drop it - see mp_start_dry_plan()
+ */
+
+static stat_t _exec_dry_plan(mpBuf_t *bf)
+{
+	if (mp_move_type_is_planned(bf->move_type)) {
+		mp_finalize_trapezoid(bf);						// generate the trapezoid if not already done
+		mb.dry_plan_time += bf->real_move_time;
+	} else if (bf->move_type == MOVE_TYPE_DWELL) {
+		mb.dry_plan_time += bf->gm.move_time / 60;		// dwells are in seconds
+	}
+#ifdef __HOST__
+	host_trace_block(bf->gm.linenum, mp_move_type_is_planned(bf->move_type) ? 'm' : (bf->pass_through ? 'p' : 's'),
+					 bf->length, bf->entry_vmax, bf->exit_vmax, bf->delta_vmax);	// see host.h
+#endif
+	st_prep_null();										// keep the loader turning over
+	mp_run_aux_commands(bf);							// offsets and the like still change
+	if (bf->move_type == MOVE_TYPE_COMMAND) {
+		return (mp_runtime_command(bf));				// runs the command and frees the buffer
+	}
+	if (mp_free_run_buffer()) {
+		cm_cycle_end();									// free buffer & end cycle if planner is empty
+	}
+	return (STAT_OK);
+}
+
 /*************************************************************************/
 /**** ALINE EXECUTION ROUTINES *******************************************/
 /*************************************************************************
@@ -169,7 +282,7 @@ stat_t mp_exec_move()
  **
  **** NOTICE ** NOTICE ** NOTICE ****/
 
-stat_t mp_exec_aline(mpBuf_t *bf)
+RAMFUNC stat_t mp_exec_aline(mpBuf_t *bf)
 {
     if (bf->move_state == MOVE_OFF) { return (STAT_NOOP); }
 
@@ -181,7 +294,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         // so is the following code is no longer needed ++++ ash
         // But let's still alert the condition should it ever occur
         if (fp_ZERO(bf->length)) {						// ...looks for an actual zero here
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero length move in exec_aline");
+            rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero length move in exec_aline");
         }
 /*
         if (fp_ZERO(bf->length)) {						// ...looks for an actual zero here
@@ -201,9 +314,20 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         }
 */
         // Start a new move by setting up the runtime singleton (mr)
-        memcpy(&mr.gm, &(bf->gm), sizeof(GCodeState_t)); // copy in the gcode model state
+        mp_finalize_trapezoid(bf);                       // generate the trapezoid if not already done
+        mp_load_runtime_gcode_state(bf);                 // copy in the gcode model state
         bf->replannable = false;                         // signal the planner that this buffer is not replannable
+#ifdef __MOTION_TRACE
+        mp_trace_block(bf, MP_TRACE_RUN);
+#endif
+#ifdef __LINE_TIMES
+        mp_line_time_block(bf);
+#endif
+#ifdef __PLANNER_STATS
+        mp_stats_block(bf);
+#endif
         bf->move_state = MOVE_RUN;                       // note that this buffer is running -- note the planner doesn't look at move_state
+        mp_run_aux_commands(bf);                         // coolant etc. queued ahead of the move
         mr.move_state = MOVE_NEW;
         mr.section = SECTION_HEAD;
         mr.section_state = SECTION_NEW;
@@ -217,16 +341,79 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         mr.cruise_velocity = bf->cruise_velocity;
         mr.exit_velocity = bf->exit_velocity;
 
+        // start at the override the block was planned for, and never ramp past its limits
+        mr.override_max = cbrt(bf->jerk_nominal / bf->jerk);
+        if (fp_NOT_ZERO(bf->cruise_vmax)) {
+            mr.override_max = min(mr.override_max, bf->limit_vmax / bf->cruise_vmax);
+        }
+        mr.override = min(bf->override_factor, mr.override_max);
+        mr.override_rate = 0;
+
         copy_vector(mr.unit, bf->unit);
         copy_vector(mr.target, bf->gm.target);			// save the final target of the move
 
         // generate the waypoints for position correction at section ends
-        for (uint8_t axis=0; axis<AXES; axis++) {
-            mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.head_length;
-            mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length);
-            mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length + mr.tail_length);
+        // The last waypoint is the move target itself, not the start position plus the length.
+        // Targets come straight from the Gcode model, so rounding in the runtime position is
+        // discarded at the end of every move instead of accumulating from move to move.
+        // Waypoints and positions are fixed point, so only the section lengths are float.
+        for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+            mr.target_fx[axis] = fxpos(mr.target[axis]);
+            mr.waypoint[SECTION_HEAD][axis] = mr.position_fx[axis] + fxpos_delta(mr.unit[axis] * mr.head_length);
+            mr.waypoint[SECTION_BODY][axis] = mr.position_fx[axis] + fxpos_delta(mr.unit[axis] * (mr.head_length + mr.body_length));
+            mr.waypoint[SECTION_TAIL][axis] = mr.target_fx[axis];
+            if (fp_ZERO(mr.tail_length)) {                  // moves that end in the body or head
+                mr.waypoint[SECTION_BODY][axis] = mr.target_fx[axis];
+                if (fp_ZERO(mr.body_length)) {
+                    mr.waypoint[SECTION_HEAD][axis] = mr.target_fx[axis];
+                }
+            }
+        }
+        mr.spline_move = (bf->move_type == MOVE_TYPE_SPLINE);
+        mr.arc_move = (bf->move_type == MOVE_TYPE_ARC) || mr.spline_move;
+        if (mr.arc_move) {
+            _init_arc(bf);                              // arc waypoints replace the ones above
+        }
+
+        // set up joint-space interpolation for nonlinear kinematics - see _interpolate_joint_steps()
+        // Interpolation starts from the commanded steps, so a move restarted after a hold is continuous.
+        mr.kn_subdivisions = bf->kinematic_subdivisions;
+        if (mr.kn_subdivisions > 1) {
+            mr.kn_index = 0;
+            mr.kn_length = bf->length / mr.kn_subdivisions;
+            copy_vector(mr.kn_start, mr.position_fx);
+            for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+                mr.kn_start_steps[motor] = mr.target_steps[motor];
+            }
+            _solve_sub_chord_end();
         }
 
+        if (bf->spindle_sync) {
+            spindle_set_sync_target(bf->spindle_speed);     // if the tail before didn't start it
+        }
+#ifdef __THREADING
+        _start_spindle_sync();
+#endif
+
+        // raster line - goes to the loader with the first segment. Other moves end any line
+        // still running. A move restarted after a hold carries on with the line it has.
+        if (bf->raster == RASTER_NONE) {
+            mr.raster = RASTER_STOP;
+        } else if (bf->raster == RASTER_STARTED) {
+            mr.raster = RASTER_NONE;
+        } else {
+            mr.raster = raster_start_line(bf->raster, bf->unit, spindle.speed) ? bf->raster : RASTER_STOP;
+            bf->raster = RASTER_STARTED;
+        }
+#ifdef __MOTION_OUTPUTS
+        mr.output_events = bf->output_events;
+        mr.output_next = 0;
+        mr.output_to_go = bf->length;
+        for (uint8_t i=0; i<bf->output_events; i++) {
+            mr.output_event[i] = bf->output_event[i];
+        }
+#endif
+
         // Update the planner buffer times --
         mb.time_in_run = bf->real_move_time;    // initialize the time_in_run
     }
@@ -245,6 +432,23 @@ stat_t mp_exec_aline(mpBuf_t *bf)
     //  (8) - We are removing the hold state and there is queued motion (handled outside this routine)
     //  (9) - We are removing the hold state and there is no queued motion (also handled outside this routine)
 
+    // Case (0) - a new feedhold request starts on this segment boundary. The main loop only
+    // has to run the spindle and coolant pause (see cm_feedhold_sequencing_callback())
+    if (cm.hold_state == FEEDHOLD_REQUESTED) {
+        cm_set_motion_state(MOTION_HOLD);
+        cm.hold_state = FEEDHOLD_SYNC;
+        cm.hold_pause_pending = true;
+    }
+
+#ifdef __THREADING
+    if (mr.sync_state == SYNC_WAIT) {
+        stat_t status = _wait_for_index(bf);
+        if (status != STAT_NOOP) {
+            return (status);                    // still waiting, or holding
+        }
+    }
+#endif
+
     if (cm.motion_state == MOTION_HOLD) {
 
         // Case (3) is a no-op and is not trapped. It just continues the deceleration.
@@ -256,8 +460,14 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 
         // Case (6) - wait for the steppers to stop
         if (cm.hold_state == FEEDHOLD_PENDING) {
+#ifdef __INPUT_SHAPING
+            if (mp_shaper_is_settling()) {
+                return (mp_shaper_exec_settle());                       // the shaped motion stops later
+            }
+#endif
             if (mp_runtime_is_idle()) {                                 // wait for the steppers to actually clear out
                 cm.hold_state = FEEDHOLD_HOLD;
+                cm.hold_stop_time = (float)(hw_get_cycles() - cm.hold_start_cycles) / (HW_CYCLES_PER_US * 1000);
                 mp_zero_segment_velocity();                             // for reporting purposes
                 sr_request_status_report(SR_REQUEST_IMMEDIATE);         // was SR_REQUEST_TIMED
                 cs.controller_state = CONTROLLER_READY;                 // remove controller readline() PAUSE
@@ -270,7 +480,14 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         if (cm.hold_state == FEEDHOLD_DECEL_END) {
             mr.move_state = MOVE_OFF;	                                // invalidate mr buffer to reset the new move
             bf->move_state = MOVE_NEW;                                  // tell _exec to re-use the bf buffer
-            bf->length = get_axis_vector_length(mr.target, mr.position);// reset length
+            if (mr.spline_move) {                                       // restart the spline from here
+                mp_split_spline(&bf->spline, mr.arc_distance / mr.arc_length);
+            } else if (mr.arc_move) {                                   // restart the arc from here
+                float fraction = mr.arc_distance / mr.arc_length;
+                bf->arc.theta += bf->arc.angular_travel * fraction;
+                bf->arc.angular_travel -= bf->arc.angular_travel * fraction;
+            }
+            bf->length = _get_remaining_length();                       // reset length
             bf->delta_vmax = mp_get_target_velocity(0, bf->length, bf); // reset cruise velocity
             bf->entry_vmax = 0;                                         // set bp+0 as hold point
             mp_reset_replannable_list();                                // make it replan all the blocks
@@ -283,7 +500,13 @@ stat_t mp_exec_aline(mpBuf_t *bf)
         // Build a tail-only move from here. Decelerate as fast as possible in the space we have.
         if ((cm.hold_state == FEEDHOLD_SYNC) ||
             ((cm.hold_state == FEEDHOLD_DECEL_CONTINUE) && (mr.move_state == MOVE_NEW))) {
+            if (cm.hold_state == FEEDHOLD_SYNC) {                       // start measuring the hold
+                cm.hold_start_cycles = hw_get_cycles();
+                cm.hold_latency = (float)(cm.hold_start_cycles - cm.hold_request_cycles) / (HW_CYCLES_PER_US * 1000);
+                cm.hold_stop_distance = 0;
+            }
             if (mr.section == SECTION_TAIL) {   // if already in a tail don't decelerate. You already are
+                cm.hold_stop_distance += _get_remaining_length();
                 if (fp_ZERO(mr.exit_velocity)) {
                     cm.hold_state = FEEDHOLD_DECEL_TO_ZERO;
                 } else {
@@ -292,7 +515,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
             } else {
                 mr.entry_velocity = mr.segment_velocity;
                 if (mr.section == SECTION_HEAD) {
-                    mr.entry_velocity += mr.forward_diff_5; // compute velocity for next segment (this new one)
+                    mr.entry_velocity += _first_forward_diff(); // compute velocity for next segment (this new one)
                 }
                 mr.cruise_velocity = mr.entry_velocity;
 
@@ -302,7 +525,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
                 mr.head_length = 0;
                 mr.body_length = 0;
 
-                float available_length = get_axis_vector_length(mr.target, mr.position);
+                float available_length = _get_remaining_length();
                 mr.tail_length = mp_get_target_length(mr.cruise_velocity, 0, bf);   // braking length
 
 
@@ -318,6 +541,7 @@ stat_t mp_exec_aline(mpBuf_t *bf)
                     cm.hold_state = FEEDHOLD_DECEL_TO_ZERO;
                     mr.exit_velocity = 0;
                 }
+                cm.hold_stop_distance += mr.tail_length;
             }
         }
     }
@@ -330,7 +554,13 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 	if (mr.section == SECTION_HEAD) { status = _exec_aline_head();} else
 	if (mr.section == SECTION_BODY) { status = _exec_aline_body();} else
 	if (mr.section == SECTION_TAIL) { status = _exec_aline_tail();} else
-	{ return(cm_panic(STAT_INTERNAL_ERROR, "exec_aline"));}	// never supposed to get here
+	{ return(rpt_post_panic(STAT_INTERNAL_ERROR, "exec_aline", 0));}	// never supposed to get here
+
+	// synchronized spindle speed - a change on the next move starts ramping in this tail
+	if ((mr.section == SECTION_TAIL) && (bf->nx->buffer_state == MP_BUFFER_QUEUED) && bf->nx->spindle_sync) {
+		spindle_set_sync_target(bf->nx->spindle_speed);
+	}
+	spindle_exec_ramp(mr.segment_time);
 
 	// Feedhold Case (5): Look for the end of the deceleration to go into HOLD state
     if ((cm.hold_state == FEEDHOLD_DECEL_TO_ZERO) && (status == STAT_OK)) {
@@ -352,8 +582,18 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 		mr.move_state = MOVE_OFF;						// invalidate mr buffer (reset)
 		mr.section_state = SECTION_OFF;
         mb.time_in_run = 0.0;                           // it's done, so time goes to zero
+#ifdef __THREADING
+        if (bf->move_state != MOVE_RUN) {
+            _end_spindle_sync();                        // stopped by a hold - the thread is lost
+        } else if (mr.sync_state == SYNC_RUN) {
+            mr.sync_revolutions += bf->length / fabs(mr.gm.parameter);
+        }
+#endif
 
         if (bf->move_state == MOVE_RUN) {
+#ifdef __PLANNER_PROFILE
+			mp_profile_move_end(bf);
+#endif
 			if (mp_free_run_buffer() && cm.hold_state == FEEDHOLD_OFF) {
 				cm_cycle_end();	// free buffer & end cycle if planner is empty
             }
@@ -486,11 +726,45 @@ void mp_exit_hold_state()
  *  Note that with our current control points, D and E are actually 0.
  */
 
+/*  Note: The constants are integers or folded to float so this (EXEC level) code does not
+ *  promote to software double arithmetic.
+ */
+
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS) || defined(FIXED_POINT_EXEC)
+
+// Tables for generating the difference tables - see the septic profile and _init_fx_diffs() below
+
+static const uint8_t binomial[8][8] = {						// C(i,j)
+	{ 1, 0, 0, 0, 0, 0, 0, 0 },
+	{ 1, 1, 0, 0, 0, 0, 0, 0 },
+	{ 1, 2, 1, 0, 0, 0, 0, 0 },
+	{ 1, 3, 3, 1, 0, 0, 0, 0 },
+	{ 1, 4, 6, 4, 1, 0, 0, 0 },
+	{ 1, 5, 10, 10, 5, 1, 0, 0 },
+	{ 1, 6, 15, 20, 15, 6, 1, 0 },
+	{ 1, 7, 21, 35, 35, 21, 7, 1 }
+};
+
+static const uint16_t stirling[8][8] = {					// m! * S(j,m)
+	{ 1, 0,   0,    0,    0,     0,     0,    0 },
+	{ 0, 1,   0,    0,    0,     0,     0,    0 },
+	{ 0, 1,   2,    0,    0,     0,     0,    0 },
+	{ 0, 1,   6,    6,    0,     0,     0,    0 },
+	{ 0, 1,  14,   36,   24,     0,     0,    0 },
+	{ 0, 1,  30,  150,  240,   120,     0,    0 },
+	{ 0, 1,  62,  540, 1560,  1800,   720,    0 },
+	{ 0, 1, 126, 1806, 8400, 16800, 15120, 5040 }
+};
+
+#endif
+
+#if (MOTION_PROFILE != PROFILE_SNAP_CONTINUOUS)
+
 static void _init_forward_diffs(float Vi, float Vt)
 {
-	float A =  -6.0*Vi +  6.0*Vt;
-	float B =  15.0*Vi - 15.0*Vt;
-	float C = -10.0*Vi + 10.0*Vt;
+	float A =  -6*Vi +  6*Vt;
+	float B =  15*Vi - 15*Vt;
+	float C = -10*Vi + 10*Vt;
 	// D = 0
 	// E = 0
 	// F = Vi
@@ -504,20 +778,313 @@ static void _init_forward_diffs(float Vi, float Vt)
 	float Bh_4 = B * h * h * h * h;
 	float Ch_3 = C * h * h * h;
 
-	mr.forward_diff_5 = (121.0/16.0)*Ah_5 + 5.0*Bh_4 + (13.0/4.0)*Ch_3;
-	mr.forward_diff_4 = (165.0/2.0)*Ah_5 + 29.0*Bh_4 + 9.0*Ch_3;
-	mr.forward_diff_3 = 255.0*Ah_5 + 48.0*Bh_4 + 6.0*Ch_3;
-	mr.forward_diff_2 = 300.0*Ah_5 + 24.0*Bh_4;
-	mr.forward_diff_1 = 120.0*Ah_5;
+	mr.forward_diff_5 = (float)(121.0/16.0)*Ah_5 + 5*Bh_4 + (float)(13.0/4.0)*Ch_3;
+	mr.forward_diff_4 = (float)(165.0/2.0)*Ah_5 + 29*Bh_4 + 9*Ch_3;
+	mr.forward_diff_3 = 255*Ah_5 + 48*Bh_4 + 6*Ch_3;
+	mr.forward_diff_2 = 300*Ah_5 + 24*Bh_4;
+	mr.forward_diff_1 = 120*Ah_5;
 
 	// Calculate the initial velocity by calculating V(h/2)
-	float half_h = h/2.0;
+	float half_h = h/2;
 	float half_Ch_3 = C * half_h * half_h * half_h;
 	float half_Bh_4 = B * half_h * half_h * half_h * half_h;
 	float half_Ah_5 = A * half_h * half_h * half_h * half_h * half_h;
 	mr.segment_velocity = half_Ah_5 + half_Bh_4 + half_Ch_3 + Vi;
 }
 
+static inline float _first_float_diff() { return (mr.forward_diff_5); }
+
+static inline void _advance_float_diffs()
+{
+	mr.forward_diff_5 += mr.forward_diff_4;
+	mr.forward_diff_4 += mr.forward_diff_3;
+	mr.forward_diff_3 += mr.forward_diff_2;
+	mr.forward_diff_2 += mr.forward_diff_1;
+}
+
+#else // PROFILE_SNAP_CONTINUOUS
+
+/*
+ * Septic (snap continuous) profile - selected by MOTION_PROFILE=7 at build time
+ *
+ *	The velocity curve is the 7th degree smoothstep:
+ *
+ *		V(s) = Vi + (Vt-Vi) * (35s^4 - 84s^5 + 70s^6 - 20s^7)	for 0 <= s <= 1
+ *
+ *	which has zero acceleration, jerk and snap at both ends, so the head and tail blend into
+ *	the body and into each other without a step in snap. Peak jerk is 7.513 * (Vt-Vi)/T^3
+ *	vs. 5.774 for the quintic, so the planner scales jerk by PROFILE_JERK_FACTOR to keep the
+ *	peak at the configured jerk_max.
+ *
+ *	Writing out the difference tables by hand as done above gets unwieldy at 7th degree, so
+ *	they are generated here. Substituting s = (k + 1/2) * h with h = 1/I puts the curve in
+ *	terms of the segment index k (the midpoint of each segment, as above):
+ *
+ *		V(k) = Vi + (Vt-Vi) * sum_j( c_j * k^j ),   c_j = sum_i>=j( a_i * h^i * C(i,j) * (1/2)^(i-j) )
+ *
+ *	The initial m'th forward difference of k^j is m! * S(j,m), where S is the Stirling number
+ *	of the second kind, so the initial differences are simply:
+ *
+ *		F_(8-m) = (Vt-Vi) * sum_j>=m( c_j * m! * S(j,m) )		for m = 1..7
+ *
+ *	and we iterate as above, extended to F_7:
+ *
+ *		V   += F_7
+ *		F_7 += F_6
+ *		  ...
+ *		F_2 += F_1
+ */
+
+static void _init_forward_diffs(float Vi, float Vt)
+{
+	static const float a[8] = { 0, 0, 0, 0, 35, -84, 70, -20 };	// curve coefficients in s
+
+	float h = 1/(mr.segments);
+	float h_i[8];												// h^i
+	float half_i[8];											// (1/2)^i
+	h_i[0] = 1;
+	half_i[0] = 1;
+	for (uint8_t i=1; i<8; i++) {
+		h_i[i] = h_i[i-1] * h;
+		half_i[i] = half_i[i-1] * (float)0.5;
+	}
+
+	float c[8];													// coefficients in k
+	for (uint8_t j=0; j<8; j++) {
+		c[j] = 0;
+		for (uint8_t i=j; i<8; i++) {
+			c[j] += a[i] * h_i[i] * binomial[i][j] * half_i[i-j];
+		}
+	}
+
+	float F[8];													// F[m] is the m'th difference
+	float delta = Vt - Vi;
+	for (uint8_t m=1; m<8; m++) {
+		F[m] = 0;
+		for (uint8_t j=m; j<8; j++) {
+			F[m] += c[j] * stirling[j][m];
+		}
+		F[m] *= delta;
+	}
+	mr.forward_diff_7 = F[1];
+	mr.forward_diff_6 = F[2];
+	mr.forward_diff_5 = F[3];
+	mr.forward_diff_4 = F[4];
+	mr.forward_diff_3 = F[5];
+	mr.forward_diff_2 = F[6];
+	mr.forward_diff_1 = F[7];
+
+	mr.segment_velocity = Vi + delta * c[0];				// V(h/2)
+}
+
+static inline float _first_float_diff() { return (mr.forward_diff_7); }
+
+static inline void _advance_float_diffs()
+{
+	mr.forward_diff_7 += mr.forward_diff_6;
+	mr.forward_diff_6 += mr.forward_diff_5;
+	mr.forward_diff_5 += mr.forward_diff_4;
+	mr.forward_diff_4 += mr.forward_diff_3;
+	mr.forward_diff_3 += mr.forward_diff_2;
+	mr.forward_diff_2 += mr.forward_diff_1;
+}
+
+#endif // MOTION_PROFILE
+
+/*
+ * _load_forward_diffs() - set up forward differences for a head or tail, using the cache if possible
+ *
+ *	Pocketing and other repetitive toolpaths run long series of blocks with identical heads and
+ *	tails. The differences depend only on Vi, Vt and the segment count (jerk is already folded
+ *	into the section time, and so into the segment count), so the last few sets are kept in a
+ *	small round-robin cache. A hit is an exact match on all three keys, so cached and computed
+ *	values are bit-identical. The cache is only touched from the exec (LO interrupt) level.
+ */
+
+#define FORWARD_DIFF_CACHE_SIZE 4
+
+typedef struct mpForwardDiffCache {
+	float Vi;							// keys
+	float Vt;
+	float segments;
+	float segment_velocity;				// initial V(h/2)
+	float forward_diff_1;
+	float forward_diff_2;
+	float forward_diff_3;
+	float forward_diff_4;
+	float forward_diff_5;
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS)
+	float forward_diff_6;
+	float forward_diff_7;
+#endif
+} mpForwardDiffCache_t;
+
+static mpForwardDiffCache_t fdc[FORWARD_DIFF_CACHE_SIZE];	// segments == 0 marks an unused entry
+static uint8_t fdc_next;										// next entry to replace
+
+#ifdef FIXED_POINT_EXEC
+/*
+ * _init_fx_diffs() - exact integer forward differences for a head or tail (FIXED_POINT_EXEC)
+ * _load_fx_diffs() - set up the section from them, using the cache if possible
+ *
+ *	The velocity curve is V = Vi + (Vt-Vi) * u(s), where u is the profile's smoothstep (see
+ *	above) and s = (k+1/2)/n at the middle of segment k of n. Scaled by (2n)^D, D the degree,
+ *	the curve becomes a polynomial in k with integer coefficients:
+ *
+ *		P(k) = (2n)^D * u((2k+1)/(2n)) = sum_i( a_i * (2n)^(D-i) * (2k+1)^i )
+ *
+ *	so its forward differences are integers too. They run exactly in int64 - D integer adds per
+ *	segment and no rounding to build up over the section - and the first difference is scaled
+ *	to velocity by (Vt-Vi)/(2n)^D. The coefficients in k and the initial differences are found
+ *	as for the septic profile. They depend only on n, so the cache is keyed on n alone.
+ *
+ *	_load_fx_diffs() returns false for a section of more than FX_DIFF_MAX_SEGMENTS segments,
+ *	which then runs the float differences.
+ */
+
+typedef struct mpFixedDiffCache {
+	uint32_t segments;					// key - 0 marks an unused entry
+	float unit;							// 1/(2n)^D
+	float start;						// P(0)/(2n)^D - the curve at the middle of the first segment
+	int64_t diff[MOTION_PROFILE+1];		// initial differences - diff[1] is the first
+} mpFixedDiffCache_t;
+
+static mpFixedDiffCache_t fxc[FORWARD_DIFF_CACHE_SIZE];
+static uint8_t fxc_next;
+
+static void _init_fx_diffs(const uint32_t n, mpFixedDiffCache_t *c)
+{
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS)
+	static const int8_t a[8] = { 0, 0, 0, 0, 35, -84, 70, -20 };	// curve coefficients in s
+#else
+	static const int8_t a[6] = { 0, 0, 0, 10, -15, 6 };
+#endif
+	int64_t scale[MOTION_PROFILE+1];							// (2n)^i
+	scale[0] = 1;
+	for (uint8_t i=1; i<=MOTION_PROFILE; i++) {
+		scale[i] = scale[i-1] * (2*n);
+	}
+
+	int64_t coef[MOTION_PROFILE+1];								// coefficients in k
+	for (uint8_t j=0; j<=MOTION_PROFILE; j++) {					// (2k+1)^i = sum_j( C(i,j) * 2^j * k^j )
+		coef[j] = 0;
+		for (uint8_t i=j; i<=MOTION_PROFILE; i++) {
+			coef[j] += a[i] * scale[MOTION_PROFILE-i] * binomial[i][j] * ((int64_t)1 << j);
+		}
+	}
+	for (uint8_t m=1; m<=MOTION_PROFILE; m++) {
+		c->diff[m] = 0;
+		for (uint8_t j=m; j<=MOTION_PROFILE; j++) {
+			c->diff[m] += coef[j] * stirling[j][m];
+		}
+	}
+	c->unit = 1 / (float)scale[MOTION_PROFILE];
+	c->start = coef[0] * c->unit;
+	c->segments = n;
+}
+
+static bool _load_fx_diffs(float Vi, float Vt)
+{
+	uint32_t n = (uint32_t)mr.segments;
+	mr.fx_diffs = ((n > 0) && (n <= FX_DIFF_MAX_SEGMENTS));
+	if (!mr.fx_diffs) {
+		return (false);
+	}
+	mpFixedDiffCache_t *c = NULL;
+	for (uint8_t i=0; i<FORWARD_DIFF_CACHE_SIZE; i++) {
+		if (fxc[i].segments == n) {
+			c = &fxc[i];
+			break;
+		}
+	}
+	if (c == NULL) {
+		c = &fxc[fxc_next];
+		if (++fxc_next >= FORWARD_DIFF_CACHE_SIZE) fxc_next = 0;
+		_init_fx_diffs(n, c);
+	}
+	for (uint8_t m=1; m<=MOTION_PROFILE; m++) {
+		mr.fx_diff[m] = c->diff[m];
+	}
+	mr.fx_diff_scale = (Vt - Vi) * c->unit;
+	mr.segment_velocity = Vi + (Vt - Vi) * c->start;
+	return (true);
+}
+#endif // FIXED_POINT_EXEC
+
+static void _load_forward_diffs(float Vi, float Vt)
+{
+	mpForwardDiffCache_t *c;
+
+#ifdef FIXED_POINT_EXEC
+	if (_load_fx_diffs(Vi, Vt)) {
+		return;
+	}
+#endif
+
+	for (uint8_t i=0; i<FORWARD_DIFF_CACHE_SIZE; i++) {
+		c = &fdc[i];
+		if ((memcmp(&c->segments, &mr.segments, sizeof(float)) == 0) &&	// bit for bit - see above
+			(memcmp(&c->Vi, &Vi, sizeof(float)) == 0) && (memcmp(&c->Vt, &Vt, sizeof(float)) == 0)) {
+			mr.segment_velocity = c->segment_velocity;
+			mr.forward_diff_1 = c->forward_diff_1;
+			mr.forward_diff_2 = c->forward_diff_2;
+			mr.forward_diff_3 = c->forward_diff_3;
+			mr.forward_diff_4 = c->forward_diff_4;
+			mr.forward_diff_5 = c->forward_diff_5;
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS)
+			mr.forward_diff_6 = c->forward_diff_6;
+			mr.forward_diff_7 = c->forward_diff_7;
+#endif
+			return;
+		}
+	}
+	_init_forward_diffs(Vi, Vt);
+
+	c = &fdc[fdc_next];
+	if (++fdc_next >= FORWARD_DIFF_CACHE_SIZE) fdc_next = 0;
+	c->Vi = Vi;
+	c->Vt = Vt;
+	c->segments = mr.segments;
+	c->segment_velocity = mr.segment_velocity;
+	c->forward_diff_1 = mr.forward_diff_1;
+	c->forward_diff_2 = mr.forward_diff_2;
+	c->forward_diff_3 = mr.forward_diff_3;
+	c->forward_diff_4 = mr.forward_diff_4;
+	c->forward_diff_5 = mr.forward_diff_5;
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS)
+	c->forward_diff_6 = mr.forward_diff_6;
+	c->forward_diff_7 = mr.forward_diff_7;
+#endif
+}
+
+/*
+ * _first_forward_diff()    - velocity change to the next segment
+ * _advance_forward_diffs() - step the differences to the next segment
+ */
+
+static inline float _first_forward_diff()
+{
+#ifdef FIXED_POINT_EXEC
+	if (mr.fx_diffs) {
+		return (mr.fx_diff_scale * (float)mr.fx_diff[1]);
+	}
+#endif
+	return (_first_float_diff());
+}
+
+static inline void _advance_forward_diffs()
+{
+#ifdef FIXED_POINT_EXEC
+	if (mr.fx_diffs) {
+		for (uint8_t m=1; m<MOTION_PROFILE; m++) {
+			mr.fx_diff[m] += mr.fx_diff[m+1];
+		}
+		return;
+	}
+#endif
+	_advance_float_diffs();
+}
+
 /*********************************************************************************************
  * _exec_aline_head()
  */
@@ -531,8 +1098,9 @@ static stat_t _exec_aline_head()
 		}
 		mr.gm.move_time = 2*mr.head_length / (mr.entry_velocity + mr.cruise_velocity);// time for entire accel region
 		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);// # of segments for the section
+		mr.segments = _get_arc_segments(mr.segments, mr.head_length);
 		mr.segment_time = mr.gm.move_time / mr.segments;
-		_init_forward_diffs(mr.entry_velocity, mr.cruise_velocity);
+		_load_forward_diffs(mr.entry_velocity, mr.cruise_velocity);
 		mr.segment_count = (uint32_t)mr.segments;
 		if (mr.segment_time < MIN_SEGMENT_TIME) return(STAT_MINIMUM_TIME_MOVE); // exit without advancing position
 		mr.section = SECTION_HEAD;
@@ -550,16 +1118,13 @@ static stat_t _exec_aline_head()
 		return(STAT_EAGAIN);
 	}
 	if (mr.section_state == SECTION_2nd_HALF) {						// SECOND HALF (convex part of accel curve)
-		mr.segment_velocity += mr.forward_diff_5;
+		mr.segment_velocity += _first_forward_diff();
 		if (_exec_aline_segment() == STAT_OK) { 					// set up for body
 			if ((fp_ZERO(mr.body_length)) && (fp_ZERO(mr.tail_length))) return(STAT_OK); // ends the move
 			mr.section = SECTION_BODY;
 			mr.section_state = SECTION_NEW;
 		} else {
-			mr.forward_diff_5 += mr.forward_diff_4;
-			mr.forward_diff_4 += mr.forward_diff_3;
-			mr.forward_diff_3 += mr.forward_diff_2;
-			mr.forward_diff_2 += mr.forward_diff_1;
+			_advance_forward_diffs();
 		}
 	}
 	return(STAT_EAGAIN);
@@ -570,6 +1135,12 @@ static stat_t _exec_aline_head()
  *
  *	The body is broken into little segments even though it is a straight line so that
  *	feed holds can happen in the middle of a line with a minimum of latency
+ *
+ *	Bodies have constant velocity so they don't need the short segments that heads and tails
+ *	use to follow the S-curve. Body segment time is $bst (cm.body_segment_time), between
+ *	MIN_SEGMENT_USEC and MAX_SEGMENT_USEC. Longer body segments mean fewer EXEC and PREP
+ *	interrupts during long cuts at the cost of up to $bst microseconds of feedhold latency.
+ *	They need a build with __LONG_SEGMENTS; otherwise $bst can only shorten them.
  */
 static stat_t _exec_aline_body()
 {
@@ -579,11 +1150,24 @@ static stat_t _exec_aline_body()
 			return(_exec_aline_tail());						// skip ahead to tail periods
 		}
 		mr.gm.move_time = mr.body_length / mr.cruise_velocity;
-		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);
+		mr.segments = ceil(uSec(mr.gm.move_time) / cm.body_segment_time);
+		mr.segments = _get_arc_segments(mr.segments, mr.body_length);
 		mr.segment_time = mr.gm.move_time / mr.segments;
 		mr.segment_velocity = mr.cruise_velocity;
+		if (mr.arc_move && !mr.spline_move) {
+			_init_arc_rotation();
+		}
 		mr.segment_count = (uint32_t)mr.segments;
 		if (mr.segment_time < MIN_SEGMENT_TIME) return(STAT_MINIMUM_TIME_MOVE); // exit without advancing position
+
+		// Every body segment travels the same vector, so for linear kinematics the steps are
+		// computed once here rather than by inverse kinematics on every segment - see _exec_aline_segment()
+		float segment_length = mr.segment_velocity * mr.segment_time;
+		for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+			mr.segment_travel[axis] = mr.unit[axis] * segment_length;
+			mr.segment_travel_fx[axis] = fxpos_delta(mr.segment_travel[axis]);
+		}
+		kn_inverse_kinematics(mr.segment_travel, mr.segment_steps);
 		mr.section = SECTION_BODY;
 		mr.section_state = SECTION_2nd_HALF;				// uses PERIOD_2 so last segment detection works
 	}
@@ -607,8 +1191,9 @@ static stat_t _exec_aline_tail()
 		if (fp_ZERO(mr.tail_length)) { return(STAT_OK);}			// end the move
 		mr.gm.move_time = 2*mr.tail_length / (mr.cruise_velocity + mr.exit_velocity); // len/avg. velocity
 		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);// # of segments for the section
+		mr.segments = _get_arc_segments(mr.segments, mr.tail_length);
 		mr.segment_time = mr.gm.move_time / mr.segments;			// time to advance for each segment
-		_init_forward_diffs(mr.cruise_velocity, mr.exit_velocity);
+		_load_forward_diffs(mr.cruise_velocity, mr.exit_velocity);
 		mr.segment_count = (uint32_t)mr.segments;
 		if (mr.segment_time < MIN_SEGMENT_TIME) { return(STAT_MINIMUM_TIME_MOVE);} // exit without advancing position
 		mr.section = SECTION_TAIL;
@@ -627,14 +1212,11 @@ static stat_t _exec_aline_tail()
 		return(STAT_EAGAIN);
 	}
 	if (mr.section_state == SECTION_2nd_HALF) {						// SECOND HALF - concave part (period 5)
-		mr.segment_velocity += mr.forward_diff_5;
+		mr.segment_velocity += _first_forward_diff();
 		if (_exec_aline_segment() == STAT_OK) {
 			return(STAT_OK);                                        // STAT_OK completes the move
 		} else {
-			mr.forward_diff_5 += mr.forward_diff_4;
-			mr.forward_diff_4 += mr.forward_diff_3;
-			mr.forward_diff_3 += mr.forward_diff_2;
-			mr.forward_diff_2 += mr.forward_diff_1;
+			_advance_forward_diffs();
 		}
 	}
 	return(STAT_EAGAIN);
@@ -645,8 +1227,10 @@ static stat_t _exec_aline_tail()
  *
  * NOTES ON STEP ERROR CORRECTION:
  *
- *	The commanded_steps are the target_steps delayed by one more segment.
- *	This lines them up in time with the encoder readings so a following error can be generated
+ *	The commanded_steps are the target_steps of the segment the encoder reading was last
+ *	accumulated for. They are passed through the stepper prep buffers with each segment and
+ *	latched by the loader, which lines them up in time with the encoder readings so a
+ *	following error can be generated regardless of how far exec is running ahead.
  *
  *	The following_error term is positive if the encoder reading is greater than (ahead of)
  *	the commanded steps, and negative (behind) if the encoder reading is less than the
@@ -660,6 +1244,563 @@ static stat_t _exec_aline_tail()
  *	     -100	    -90	       -10		encoder is 10 steps behind commanded steps
  */
 
+/*
+ * _get_override_time() - segment time scaled by the feed or traverse override
+ *
+ *	Overrides scale the time base of the move being run rather than its planned velocities,
+ *	so they take effect at once instead of after the queue has drained. The queued blocks are
+ *	replanned for the new factor in the background (mp_replan_overrides).
+ *
+ *	Each move starts at the factor its block was planned with, so a ramp left unfinished by
+ *	the last move doesn't carry into a block planned for a different factor. The factor is
+ *	ramped to the target with its rate limited to OVERRIDE_RAMP_RATE and the change in that
+ *	rate to OVERRIDE_RAMP_JERK, so the velocity change is acceleration and jerk limited. The
+ *	rate eases off as the target nears. It never goes over mr.override_max - the factor the
+ *	block's velocity limit and planned jerk allow - so a raise beyond what the block was
+ *	planned for waits for the blocks replanned at the new factor.
+ */
+static float _get_override_time()
+{
+#ifdef __THREADING
+	if (mr.sync_state == SYNC_RUN) {
+		if (cm.motion_state != MOTION_HOLD) {
+			return (_get_sync_time());
+		}
+		_end_spindle_sync();									// a hold decelerates as planned
+	}
+#endif
+	float target = min(cm_get_override_factor(mr.gm.motion_mode), mr.override_max);
+	float error = target - mr.override;
+	float dt = mr.segment_time * 60;							// segment_time is in minutes
+
+	if (fp_ZERO(error) && fp_ZERO(mr.override_rate)) {
+		return (mr.segment_time / mr.override);
+	}
+	// the fastest rate that can still be eased off to zero by the target
+	float rate = min(OVERRIDE_RAMP_RATE, sqrt(2 * OVERRIDE_RAMP_JERK * fabs(error)));
+	if (error < 0) {
+		rate = -rate;
+	}
+	float rate_step = OVERRIDE_RAMP_JERK * dt;
+	mr.override_rate = min(max(rate, mr.override_rate - rate_step), mr.override_rate + rate_step);
+	mr.override += mr.override_rate * dt;
+	if (((error > 0) && (mr.override > target)) || ((error < 0) && (mr.override < target)) ||
+		(fabs(error) < rate_step * dt)) {
+		mr.override = target;									// arrived - or close enough to land on it
+		mr.override_rate = 0;
+	}
+	mr.override = min(max(mr.override, FEED_OVERRIDE_MIN), mr.override_max);	// a reversal may overshoot
+	return (mr.segment_time / mr.override);
+}
+
+#ifdef __THREADING
+/*
+ * Spindle synchronized motion - G33, G33.1. See cm_spindle_sync_feed()
+ *
+ * _start_spindle_sync() - set up the lock when a move starts
+ * _wait_for_index()     - hold the first move of a thread at its start until the index
+ * _get_sync_time()      - segment time that keeps the move locked to the spindle
+ * _end_spindle_sync()   - drop the lock and go back to the planned time base
+ *
+ *	The pitch (K) rides in the P parameter of the move, negative for the retract of a rigid
+ *	tap. A thread is measured from the index pulse it started on: the tool should have gone
+ *	K times the revolutions since then, less the revolutions taken by the earlier moves of
+ *	the thread. A move that follows another synchronized move carries on the thread.
+ *	Otherwise it starts from rest and waits for the index, so each pass of a thread starts at
+ *	the same spindle angle. The G33.1 retract can't wait for the index - the spindle has just
+ *	reversed - so it locks on from the angle it finds. A move that isn't at rest (it came
+ *	after one that wasn't in the thread) does the same rather than stop dead.
+ *
+ *	The factor on the time base is set every segment from the spindle speed the index
+ *	measures over the planned one, plus the position error taken out over
+ *	SPINDLE_SYNC_CORRECTION_TIME. It isn't ramped - the spindle is the master - but is
+ *	limited to SPINDLE_SYNC_OVERRIDE_MAX, so the head of the first move, which falls behind
+ *	the spindle, catches up at a bounded rate. If the index stops an alarm is requested.
+ *	When the lock is dropped part way through a move the factor goes back to 1, so the rest
+ *	of the move, and a hold's deceleration, run at the time base they were planned in.
+ */
+static void _start_spindle_sync()
+{
+	if (mr.gm.motion_mode != MOTION_MODE_SPINDLE_SYNC) {
+		mr.sync_state = SYNC_OFF;
+		return;
+	}
+	mr.sync_distance = 0;
+	if (mr.sync_state == SYNC_RUN) {
+		return;
+	}
+	mr.sync_index = spindle_get_index_count();
+	if ((mr.gm.parameter < 0) || fp_NOT_ZERO(mr.entry_velocity)) {
+		mr.sync_revolutions = spindle_get_revolutions(mr.sync_index);
+		mr.sync_state = SYNC_RUN;
+		return;
+	}
+	mr.sync_revolutions = 0;
+	mr.sync_wait_time = 0;
+	mr.sync_state = SYNC_WAIT;
+}
+
+static stat_t _wait_for_index(mpBuf_t *bf)
+{
+	if (spindle_get_index_count() != mr.sync_index) {
+		mr.sync_index++;								// the thread starts on this pulse
+		mr.sync_state = SYNC_RUN;
+		return (STAT_NOOP);								// run the first segment
+	}
+	if (cm.hold_state == FEEDHOLD_SYNC) {				// nothing has moved - hold right here
+		cm.hold_start_cycles = hw_get_cycles();
+		cm.hold_stop_distance = 0;
+		mr.sync_state = SYNC_OFF;
+		mr.move_state = MOVE_OFF;
+		bf->move_state = MOVE_NEW;						// start the move over when the hold ends
+		cm.hold_state = FEEDHOLD_PENDING;
+		return (STAT_OK);
+	}
+	mr.sync_wait_time += SPINDLE_SYNC_WAIT_USEC;
+	if (mr.sync_wait_time > (SPINDLE_INDEX_TIMEOUT_MS * 1000)) {
+		cm.spindle_sync_lost = true;					// alarm from the main loop - it holds the move
+	}
+	st_prep_dwell_ticks((uint32_t)(SPINDLE_SYNC_WAIT_USEC * FREQUENCY_DDA / 1000000), mr.target_steps);
+	return (STAT_EAGAIN);
+}
+
+static float _get_sync_time()
+{
+	float pitch = fabs(mr.gm.parameter);
+	float rpm = spindle_get_index_rpm();
+	if (fp_ZERO(rpm)) {
+		cm.spindle_sync_lost = true;
+	}
+	float error = (spindle_get_revolutions(mr.sync_index) - mr.sync_revolutions) * pitch - mr.sync_distance;
+	float velocity = rpm * pitch + error / SPINDLE_SYNC_CORRECTION_TIME;
+	mr.override = min(max(velocity / mr.gm.feed_rate, FEED_OVERRIDE_MIN), SPINDLE_SYNC_OVERRIDE_MAX);
+	mr.sync_distance += mr.segment_velocity * mr.segment_time;
+	return (mr.segment_time / mr.override);
+}
+
+static void _end_spindle_sync()
+{
+	mr.sync_state = SYNC_OFF;
+	mr.override = 1.0;
+	mr.override_rate = 0;
+}
+#endif // __THREADING
+
+/*
+ * _prep_pwm() - attach raster lines and velocity-scaled laser power ($p1vmo) to the segment
+ *
+ *	The velocity ratio is taken after the override, so the power per unit length holds when
+ *	the feed override slows the move down. See spindle_get_velocity_pwm(). The loader
+ *	ignores the velocity duty while a raster line is running.
+ */
+static void _prep_pwm()
+{
+	if (mr.raster != RASTER_NONE) {
+		st_prep_raster(mr.raster);
+		mr.raster = RASTER_NONE;
+	}
+	if (!pwm.c[PWM_1].velocity_mode || fp_ZERO(mr.cruise_velocity)) {
+		return;
+	}
+	float duty = spindle_get_velocity_pwm(mr.segment_velocity * mr.override / mr.cruise_velocity);
+	if (duty >= 0) {
+		st_prep_pwm_duty(duty);
+	}
+}
+
+#ifdef __MOTION_OUTPUTS
+/*
+ * _prep_outputs() - attach the output events (M62, M63) the segment reaches
+ *
+ *	Events are placed by the distance left to run in the move, so a move restarted after a
+ *	hold (its length cut to what's left) still finds them. The ones it had already passed
+ *	are switched again on its first segment, in path order, which leaves them as they were.
+ *	The loader gets the fraction of the segment to the event - see st_prep_output().
+ */
+static void _prep_outputs()
+{
+	if (mr.output_next >= mr.output_events) {
+		return;
+	}
+	float to_go = mr.arc_move ? (mr.arc_length - mr.arc_distance) : get_axis_vector_length(mr.target, mr.gm.target);
+	float travel = mr.output_to_go - to_go;
+	while ((mr.output_next < mr.output_events) && (mr.output_event[mr.output_next].distance >= to_go - EPSILON)) {
+		io_event_t *e = &mr.output_event[mr.output_next++];
+		st_prep_output(e->output, e->state, (travel > EPSILON) ? (mr.output_to_go - e->distance) / travel : 0);
+	}
+	mr.output_to_go = to_go;
+}
+#endif // __MOTION_OUTPUTS
+
+/*
+ * _exec_body_segment() - constant velocity fast path for _exec_aline_segment()
+ *
+ *	All body segments but the last travel the same distance in the same time, so the steps
+ *	computed at the start of the body are reused instead of running inverse kinematics.
+ *	Steps accumulate from the previous segment's target so no step is lost, and the last
+ *	segment goes through the normal path to the body waypoint, which re-syncs the steps to
+ *	the absolute position. mr.segment_steps is the body step vector from inverse kinematics,
+ *	which is only constant for linear kinematics, so the caller only takes this path when
+ *	kn_kinematics_is_linear() is true.
+ */
+static stat_t _exec_body_segment()
+{
+	for (uint8_t i=0; i<AXES_ACTIVE; i++) {
+		mr.segment_target_fx[i] = mr.position_fx[i] + mr.segment_travel_fx[i];
+		mr.gm.target[i] = fxpos_mm(mr.segment_target_fx[i]);
+	}
+	for (uint8_t i=0; i<MOTORS_ACTIVE; i++) {
+		mr.position_steps[i] = mr.target_steps[i];			// same bucket brigade as _exec_aline_segment()
+		en_read_encoder_alignment(i, &mr.encoder_steps[i], &mr.commanded_steps[i]);
+		mr.following_error[i] = mr.encoder_steps[i] - mr.commanded_steps[i];
+		mr.target_steps[i] = mr.position_steps[i] + mr.segment_steps[i];
+	}
+	mb.time_in_run -= mr.segment_time;
+	if (mb.time_in_run < 0) {
+		mb.time_in_run = 0.0;
+	}
+	float travel_steps[MOTORS];							// st_prep_line() may apply correction to it
+	copy_vector(travel_steps, mr.segment_steps);
+	ritorno(_prep_segment(travel_steps));
+#ifdef __MOTION_TRACE
+	mp_trace_segment(travel_steps);
+#endif
+	_prep_pwm();
+#ifdef __MOTION_OUTPUTS
+	_prep_outputs();
+#endif
+	_update_position();
+	return (STAT_EAGAIN);								// the last body segment doesn't come here
+}
+
+/*
+ * _prep_segment() - send the segment to the loader, with pressure advance, torch height and input shaping if set up
+ */
+
+static stat_t _prep_segment(float travel_steps[])
+{
+	float segment_time = _get_override_time();
+	float *target_steps = mr.target_steps;
+#ifdef __LINE_TIMES
+	mp_line_time_segment(segment_time);
+#endif
+#ifdef __PATH_RETRACE
+	mp_path_history_segment(mr.gm.target);
+#endif
+#ifdef __PRESSURE_ADVANCE
+	float advanced_steps[MOTORS];
+	if (_advance_segment(advanced_steps, travel_steps, segment_time)) {
+		target_steps = advanced_steps;
+	}
+#endif
+#ifdef __TORCH_HEIGHT
+	float thc_steps[MOTORS];
+	if (_thc_segment(thc_steps, target_steps, travel_steps, segment_time)) {
+		target_steps = thc_steps;
+	}
+#endif
+#ifdef __INPUT_SHAPING
+	if (mp_shaper_is_configured()) {
+		float shaped_steps[MOTORS];
+		mp_shape_segment(target_steps, shaped_steps, travel_steps, segment_time);
+		return (st_prep_line(travel_steps, shaped_steps, mr.following_error, segment_time));
+	}
+#endif
+	return (st_prep_line(travel_steps, target_steps, mr.following_error, segment_time));
+}
+
+#ifdef __PRESSURE_ADVANCE
+/*
+ * _advance_segment() - run the extruder ahead of its target by pressure advance times its velocity
+ *
+ *	Nozzle pressure lags the extruder, so the flow trails the feed as a move speeds up and
+ *	keeps oozing as it slows down - the under-extruded starts and the corner blobs. A motor on
+ *	an axis with pressure advance ($apa, $bpa, $cpa) is led by K * v steps, v being the extruder
+ *	velocity at the end of the segment. The extra steps in a segment are therefore K times the
+ *	change in velocity from the forward differences, and add up to nothing over a run of moves
+ *	that starts and ends at rest.
+ *
+ *	On the last segment of a section v is the velocity the section ends on, so a stop leaves no
+ *	lead behind. Only extrusion is advanced; retracts run as planned. The velocity is taken at
+ *	the override so the lead follows the speed the motor actually runs at.
+ *
+ *	Where extrusion starts or stops at a junction at speed the lead would change in one
+ *	segment, so the change is spread over as many segments as it takes at the axis velocity
+ *	maximum. mr.target_steps is left alone - the body fast path builds on it. Returns false
+ *	if no motor is advanced.
+ */
+static bool _advance_segment(float advanced_steps[], float travel_steps[], float segment_time)
+{
+	float velocity = mr.segment_velocity;
+	if (mr.segment_count == 0) {
+		velocity = (mr.section == SECTION_TAIL) ? mr.exit_velocity : mr.cruise_velocity;
+	}
+	velocity *= mr.segment_time / segment_time;
+
+	bool advanced = false;
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		float advance = 0;
+		uint8_t axis = st_cfg.mot[motor].motor_map;
+		if ((axis < AXES) && fp_NOT_ZERO(cm.a[axis].pressure_advance)) {
+			float extruder_velocity = velocity * mr.unit[axis];			// per minute
+			if (extruder_velocity > 0) {
+				advance = cm.a[axis].pressure_advance / 60 * extruder_velocity * st_cfg.mot[motor].steps_per_unit;
+			}
+			float step_max = cm.a[axis].velocity_max * segment_time * st_cfg.mot[motor].steps_per_unit;
+			advance = min(advance, mr.advance_steps[motor] + step_max);	// the lead runs no faster than $avm
+			advance = max(advance, mr.advance_steps[motor] - step_max);
+			advanced = true;
+		}
+		travel_steps[motor] += advance - mr.advance_steps[motor];
+		mr.advance_steps[motor] = advance;
+		advanced_steps[motor] = mr.target_steps[motor] + advance;
+	}
+	return (advanced);
+}
+#endif // __PRESSURE_ADVANCE
+
+#ifdef __TORCH_HEIGHT
+/*
+ * _thc_segment() - plasma torch height control: hold the arc voltage by correcting Z
+ *
+ *	Arc voltage goes up with the torch height, so each segment reads it ($thi, scaled to volts
+ *	with $aiNsc and $aiNof) and moves the torch down when it's over $thv and up when it's under:
+ *
+ *		Z velocity = -$thg * (voltage - $thv),		held to $thr, the correction held to $thl
+ *
+ *	Errors inside THC_DEADBAND are left alone. The correction is added to the Z motor steps of
+ *	the segment (see kn_offset_z()), so it is a segment behind the reading, not a status report.
+ *	Neither the planner nor the runtime position see it - {tho:n} does.
+ *
+ *	It only runs on feed moves with the torch on (M3), starting $thd seconds into the cut once
+ *	the arc has settled. Anti-dive: the voltage also rises as the torch slows down in corners,
+ *	so the correction holds below $tha of the move's cruise velocity. With the torch off, or
+ *	on a traverse, the correction runs back out at $thr. mr.target_steps is left alone - the
+ *	body fast path builds on it. Returns false if there is no correction.
+ */
+static bool _thc_segment(float thc_steps[], const float target_steps[], float travel_steps[], float segment_time)
+{
+	float offset = mr.thc_offset;
+	float rate = min(cm.thc_rate, cm.a[AXIS_Z].velocity_max) * segment_time;	// largest change this segment
+
+	if ((cm.thc_input == 0) || (spindle.run_enable != SPINDLE_ON) ||
+		(mr.gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE)) {
+		mr.thc_time = 0;
+		if (fp_ZERO(offset)) {
+			return (false);
+		}
+		offset = (offset > 0) ? max(offset - rate, (float)0) : min(offset + rate, (float)0);
+
+	} else if ((mr.thc_time += segment_time) * 60 >= cm.thc_delay) {
+		float velocity = mr.segment_velocity * mr.segment_time / segment_time;
+		if (velocity >= cm.thc_antidive * mr.cruise_velocity) {
+			float error = gpio_read_analog(cm.thc_input) - cm.thc_voltage;
+			if (fabs(error) > THC_DEADBAND) {
+				float change = -cm.thc_gain * error * segment_time;
+				offset += max(-rate, min(rate, change));
+				offset = max(-cm.thc_limit, min(cm.thc_limit, offset));
+			}
+		}
+	}
+	memcpy(thc_steps, target_steps, sizeof(float)*MOTORS);
+	kn_offset_z(offset, thc_steps);
+	kn_offset_z(offset - mr.thc_offset, travel_steps);
+	mr.thc_offset = offset;
+	return (true);
+}
+#endif // __TORCH_HEIGHT
+
+/*
+ * _interpolate_joint_steps() - segment target steps for nonlinear kinematics
+ * _solve_sub_chord_end()     - IK solution at the end of the current sub-chord
+ *
+ *	mp_aline() splits each line into mr.kn_subdivisions sub-chords that are straight enough in
+ *	joint space to meet the joint tolerance. IK is solved only at sub-chord ends. Each segment
+ *	target is linear in steps between them, indexed by the distance along the move. That is one
+ *	IK per sub-chord instead of one per segment. The final sub-chord ends on the move target,
+ *	so the move still finishes exactly on its IK solution.
+ */
+
+static void _solve_sub_chord_end()
+{
+	float point[AXES];
+
+	if (mr.kn_index == mr.kn_subdivisions-1) {
+		copy_vector(point, mr.target);
+	} else {
+		float distance = (mr.kn_index+1) * mr.kn_length;
+		for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+			point[axis] = fxpos_mm(mr.kn_start[axis] + fxpos_delta(mr.unit[axis] * distance));
+		}
+	}
+	kn_inverse_kinematics(point, mr.kn_end_steps);
+}
+
+static void _interpolate_joint_steps()
+{
+	float distance = 0;										// distance of the segment target along the move
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		distance += fxpos_mm(mr.segment_target_fx[axis] - mr.kn_start[axis]) * mr.unit[axis];
+	}
+	while ((distance > (mr.kn_index+1) * mr.kn_length) && (mr.kn_index < mr.kn_subdivisions-1)) {
+		mr.kn_index++;										// crossed into the next sub-chord
+		for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+			mr.kn_start_steps[motor] = mr.kn_end_steps[motor];
+		}
+		_solve_sub_chord_end();
+	}
+	float fraction = (distance - mr.kn_index * mr.kn_length) / mr.kn_length;
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		mr.target_steps[motor] = mr.kn_start_steps[motor] + (mr.kn_end_steps[motor] - mr.kn_start_steps[motor]) * fraction;
+	}
+}
+
+/*
+ * _init_arc()              - set up the runtime for a MOVE_TYPE_ARC or MOVE_TYPE_SPLINE block
+ * _get_arc_position()      - position at a distance along the running arc or spline
+ * _get_arc_segments()      - raise a section's segment count to hold the chordal tolerance
+ * _init_arc_rotation()     - set up the rotation for the body segments of an arc
+ * _rotate_arc_position()   - position at the next body segment, by incremental rotation
+ * _get_remaining_length()  - distance left to run in the move
+ *
+ *	Arc blocks are planned along their length like lines (see mp_arc()), and each segment
+ *	target is computed from the distance along the arc rather than by stepping along a unit
+ *	vector. The center is found from the start position, so an arc restarted after a hold
+ *	carries on around the same circle. Axes outside the plane move in proportion to the
+ *	distance. A target that is slightly off the circle (within the radius tests) is reached
+ *	by spreading the difference along the arc, so the block still ends exactly on its target.
+ *	The center and the points on the circle are float offsets from the fixed point start.
+ *
+ *	Segments are straight, so a long segment on a small radius cuts inside the arc - more so
+ *	with a long body segment time ($bst). Each section gets at least enough segments that none
+ *	is longer than the chord allowed by the chordal tolerance (see mp_get_arc_segment_angle()),
+ *	as long as they don't fall under the minimum segment time.
+ *
+ *	Body segments of an arc all turn through the same angle, so instead of a sin and cos per
+ *	segment the radius vector is rotated by a 2x2 multiply with the cos and sin of that angle,
+ *	as in cm_arc_callback(). The vector is recomputed exactly every ARC_CORRECTION_SEGMENTS
+ *	segments to bound the drift, and the last body segment lands on the body waypoint.
+ *
+ *	Spline blocks run the same way, with the point in the plane taken from the curve at the
+ *	distance - see mp_get_spline_point(). A spline restarted after a hold has been cut down
+ *	to the part not yet run, so it too starts from the runtime position.
+ */
+
+static void _init_arc(const mpBuf_t *bf)
+{
+	mr.arc_length = bf->length;
+	mr.arc_distance = 0;
+	copy_vector(mr.arc_start, mr.position_fx);
+	if (mr.spline_move) {
+		mr.spline = bf->spline;                             // the curve ends on the target
+		mr.arc_segment_length = 0;							// held by its curvature velocity instead
+	} else {
+		mr.arc = bf->arc;
+		mr.arc_segment_length = 0;
+		if (fp_NOT_ZERO(mr.arc.angular_travel)) {			// longest segment, along the helix
+			mr.arc_segment_length = mr.arc_length * mp_get_arc_segment_angle(mr.arc.radius) / fabs(mr.arc.angular_travel);
+		}
+		uint8_t axis_0 = mr.arc.plane_axis_0;
+		uint8_t axis_1 = mr.arc.plane_axis_1;
+		float exit_theta = mr.arc.theta + mr.arc.angular_travel;
+		mr.arc_center_0 = -sin(mr.arc.theta) * mr.arc.radius;
+		mr.arc_center_1 = -cos(mr.arc.theta) * mr.arc.radius;
+		mr.arc_error_0 = fxpos_mm(mr.target_fx[axis_0] - mr.arc_start[axis_0]) - (mr.arc_center_0 + sin(exit_theta) * mr.arc.radius);
+		mr.arc_error_1 = fxpos_mm(mr.target_fx[axis_1] - mr.arc_start[axis_1]) - (mr.arc_center_1 + cos(exit_theta) * mr.arc.radius);
+	}
+
+	if (!fp_ZERO(mr.tail_length)) {							// same end cases as line waypoints
+		_get_arc_position(mr.head_length + mr.body_length, mr.waypoint[SECTION_BODY]);
+		_get_arc_position(mr.head_length, mr.waypoint[SECTION_HEAD]);
+	} else if (!fp_ZERO(mr.body_length)) {
+		_get_arc_position(mr.head_length, mr.waypoint[SECTION_HEAD]);
+	}
+}
+
+static void _get_arc_position(const float distance, fxpos_t position[])
+{
+	float fraction = distance / mr.arc_length;
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		position[axis] = mr.arc_start[axis] + fxpos_delta(fxpos_mm(mr.target_fx[axis] - mr.arc_start[axis]) * fraction);
+	}
+	if (mr.spline_move) {
+		float point[2];										// the curve is held in absolute float
+		mp_get_spline_point(&mr.spline, fraction, point);
+		position[mr.spline.plane_axis_0] = fxpos(point[0]);
+		position[mr.spline.plane_axis_1] = fxpos(point[1]);
+		return;
+	}
+	float theta = mr.arc.theta + mr.arc.angular_travel * fraction;
+	uint8_t axis_0 = mr.arc.plane_axis_0;
+	uint8_t axis_1 = mr.arc.plane_axis_1;
+	mr.arc_vector_0 = sin(theta) * mr.arc.radius;			// kept for _rotate_arc_position()
+	mr.arc_vector_1 = cos(theta) * mr.arc.radius;
+	position[axis_0] = mr.arc_start[axis_0] + fxpos_delta(mr.arc_center_0 + mr.arc_vector_0 + mr.arc_error_0 * fraction);
+	position[axis_1] = mr.arc_start[axis_1] + fxpos_delta(mr.arc_center_1 + mr.arc_vector_1 + mr.arc_error_1 * fraction);
+}
+
+static void _init_arc_rotation()
+{
+	float segment_theta = mr.arc.angular_travel * mr.segment_velocity * mr.segment_time / mr.arc_length;
+	mr.arc_segment_cos = cos(segment_theta);
+	mr.arc_segment_sin = sin(segment_theta);
+	mr.arc_anchor_count = 0;								// the first body segment is exact
+}
+
+static void _rotate_arc_position(fxpos_t position[])
+{
+	if (mr.arc_anchor_count == 0) {
+		mr.arc_anchor_count = ARC_CORRECTION_SEGMENTS;
+		_get_arc_position(mr.arc_distance, position);
+		return;
+	}
+	mr.arc_anchor_count--;
+	float vector_0 = mr.arc_vector_0 * mr.arc_segment_cos + mr.arc_vector_1 * mr.arc_segment_sin;
+	mr.arc_vector_1 = mr.arc_vector_1 * mr.arc_segment_cos - mr.arc_vector_0 * mr.arc_segment_sin;
+	mr.arc_vector_0 = vector_0;
+
+	float fraction = mr.arc_distance / mr.arc_length;
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		position[axis] = mr.arc_start[axis] + fxpos_delta(fxpos_mm(mr.target_fx[axis] - mr.arc_start[axis]) * fraction);
+	}
+	uint8_t axis_0 = mr.arc.plane_axis_0;
+	uint8_t axis_1 = mr.arc.plane_axis_1;
+	position[axis_0] = mr.arc_start[axis_0] + fxpos_delta(mr.arc_center_0 + mr.arc_vector_0 + mr.arc_error_0 * fraction);
+	position[axis_1] = mr.arc_start[axis_1] + fxpos_delta(mr.arc_center_1 + mr.arc_vector_1 + mr.arc_error_1 * fraction);
+}
+
+static float _get_arc_segments(const float segments, const float length)
+{
+	if (!mr.arc_move || fp_ZERO(mr.arc_segment_length)) {
+		return (segments);
+	}
+	float chordal_segments = ceil(length / mr.arc_segment_length);
+	float most_segments = floor(uSec(mr.gm.move_time) / MIN_SEGMENT_USEC);
+	return (max(segments, min(chordal_segments, most_segments)));
+}
+
+static float _get_remaining_length()
+{
+	if (mr.arc_move) {
+		return (mr.arc_length - mr.arc_distance);
+	}
+	return (get_axis_vector_length(mr.target, mr.position));
+}
+
+/*
+ * _update_position() - the segment target becomes the runtime position
+ *
+ *	mr.position is the float copy of mr.position_fx for kinematics, reporting and the planner.
+ */
+
+static void _update_position()
+{
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		mr.position_fx[axis] = mr.segment_target_fx[axis];
+		mr.position[axis] = mr.gm.target[axis];
+	}
+}
+
 static stat_t _exec_aline_segment()
 {
 	uint8_t i;
@@ -672,13 +1813,30 @@ static stat_t _exec_aline_segment()
 
 	if ((--mr.segment_count == 0) && (mr.section_state == SECTION_2nd_HALF) &&
 		(cm.motion_state != MOTION_HOLD)) {
-		copy_vector(mr.gm.target, mr.waypoint[mr.section]);
+		copy_vector(mr.segment_target_fx, mr.waypoint[mr.section]);
+		if (mr.arc_move) {									// re-sync the distance along the arc
+			mr.arc_distance = mr.head_length;
+			if (mr.section != SECTION_HEAD) { mr.arc_distance += mr.body_length; }
+			if (mr.section == SECTION_TAIL) { mr.arc_distance = mr.arc_length; }
+		}
+	} else if (mr.arc_move) {
+		mr.arc_distance += mr.segment_velocity * mr.segment_time;
+		if ((mr.section == SECTION_BODY) && !mr.spline_move) {
+			_rotate_arc_position(mr.segment_target_fx);
+		} else {
+			_get_arc_position(mr.arc_distance, mr.segment_target_fx);
+		}
+	} else if ((mr.section == SECTION_BODY) && (mr.segment_count != 0) && kn_kinematics_is_linear()) {
+		return (_exec_body_segment());						// constant velocity fast path
 	} else {
 		float segment_length = mr.segment_velocity * mr.segment_time;
-		for (i=0; i<AXES; i++) {
-			mr.gm.target[i] = mr.position[i] + (mr.unit[i] * segment_length);
+		for (i=0; i<AXES_ACTIVE; i++) {
+			mr.segment_target_fx[i] = mr.position_fx[i] + fxpos_delta(mr.unit[i] * segment_length);
 		}
 	}
+	for (i=0; i<AXES_ACTIVE; i++) {
+		mr.gm.target[i] = fxpos_mm(mr.segment_target_fx[i]);
+	}
 
 	// Convert target position to steps
 	// Bucket-brigade the old target down the chain before getting the new target from kinematics
@@ -686,14 +1844,17 @@ static stat_t _exec_aline_segment()
 	// NB: The direct manipulation of steps to compute travel_steps only works for Cartesian kinematics.
 	//	   Other kinematics may require transforming travel distance as opposed to simply subtracting steps.
 
-	for (i=0; i<MOTORS; i++) {
-		mr.commanded_steps[i] = mr.position_steps[i];		// previous segment's position, delayed by 1 segment
+	for (i=0; i<MOTORS_ACTIVE; i++) {
 		mr.position_steps[i] = mr.target_steps[i];			// previous segment's target becomes position
-		mr.encoder_steps[i] = en_read_encoder(i);			// get current encoder position (time aligns to commanded_steps)
+		en_read_encoder_alignment(i, &mr.encoder_steps[i], &mr.commanded_steps[i]); // time aligned pair
 		mr.following_error[i] = mr.encoder_steps[i] - mr.commanded_steps[i];
 	}
-    kn_inverse_kinematics(mr.gm.target, mr.target_steps);   // now determine the target steps...
-    for (i=0; i<MOTORS; i++) {                              // and compute the distances to be traveled
+    if (mr.kn_subdivisions > 1) {                           // now determine the target steps...
+        _interpolate_joint_steps();
+    } else {
+        kn_inverse_kinematics(mr.gm.target, mr.target_steps);
+    }
+    for (i=0; i<MOTORS_ACTIVE; i++) {                       // and compute the distances to be traveled
         travel_steps[i] = mr.target_steps[i] - mr.position_steps[i];
     }
 
@@ -705,8 +1866,15 @@ static stat_t _exec_aline_segment()
 
 	// Call the stepper prep function
 
-	ritorno(st_prep_line(travel_steps, mr.following_error, mr.segment_time));
-	copy_vector(mr.position, mr.gm.target); 				// update position from target
+	ritorno(_prep_segment(travel_steps));
+#ifdef __MOTION_TRACE
+	mp_trace_segment(travel_steps);
+#endif
+	_prep_pwm();
+#ifdef __MOTION_OUTPUTS
+	_prep_outputs();
+#endif
+	_update_position(); 									// update position from target
 	if (mr.segment_count == 0)
         return (STAT_OK);			                        // this section has run all its segments
 	return (STAT_EAGAIN);									// this section still has more segments to run
@@ -31,10 +31,16 @@
 #include "controller.h"
 #include "canonical_machine.h"
 #include "planner.h"
+#include "plan_arc.h"
+#include "plan_retrace.h"
+#include "kinematics.h"
 #include "stepper.h"
 #include "report.h"
 #include "util.h"
 #include "spindle.h"
+#include "pwm.h"
+#include "hardware.h"
+#include "profile_pins.h"
 
 using namespace Motate;
 //OutputPin<kDebug1_PinNumber> plan_debug_pin1;
@@ -48,25 +54,93 @@ using namespace Motate;
 //OutputPin<-1> plan_debug_pin4;
 
 // planner helper functions
+static mpBuf_t *_coalesce_aline(const GCodeState_t *gm_in, float axis_length[], float axis_square[], float *length);
+static void _blend_corner(const GCodeState_t *gm_in, float axis_length[], float axis_square[], float *length);
+#ifdef __TANGENTIAL_KNIFE
+static void _tangent_knife(GCodeState_t *gm_in);
+#endif
 static void _calculate_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[]);
-static void _calculate_jerk(mpBuf_t *bf);
+static void _defer_trapezoid(mpBuf_t *bf);
+static bool _begin_block_plan(mpBuf_t *bf);
+static void _end_block_plan(mpBuf_t *bf);
+static void _calculate_jerk(mpBuf_t *bf, const float unit[]);
 static float _calculate_junction_vmax(const float vmax, const float a_unit[], const float b_unit[]);
+static const float *_get_exit_unit(const mpBuf_t *bf);
+static float _get_axis_vmax(const mpBuf_t *bf);
+static void _apply_override(mpBuf_t *bf, const uint8_t path_control);
+static float _get_exit_hint(const mpBuf_t *bf);
+#ifdef __THREADING
+static bool _starts_thread(const mpBuf_t *bf);
+#endif
+static void _smooth_feed(const mpBuf_t *bf);
+static void _reconstrain_block(mpBuf_t *bf);
+static void _commit_curve(mpBuf_t *bf, GCodeState_t *gm_in, const float share[], const moveType move_type);
+
+// a block carrying output events keeps its length - they are placed from its end
+#ifdef __MOTION_OUTPUTS
+static bool _carries_outputs(const mpBuf_t *bf) { return ((bf->output_events != 0) || gpio_output_events_pending()); }
+#else
+static bool _carries_outputs(const mpBuf_t *bf) { return (false); }
+#endif
 
 /* Runtime-specific setters and getters
  *
  * mp_zero_segment_velocity()         - correct velocity in last segment for reporting purposes
  * mp_get_runtime_velocity()          - returns current velocity (aggregate)
- * mp_get_runtime_machine_position()  - returns current axis position in machine coordinates
+ * mp_get_runtime_absolute_position() - returns current planned axis position in machine coordinates
+ * mp_get_runtime_machine_position()  - returns current axis position in machine coordinates, for reporting
  * mp_set_runtime_work_offset()       - set offsets in the MR struct
  * mp_get_runtime_work_position()     - returns current axis position in work coordinates
- *                                      that were in effect at move planning time
+ *                                      that were in effect at move planning time, for reporting
  */
 
 void mp_zero_segment_velocity() { mr.segment_velocity = 0;}
-float mp_get_runtime_velocity(void) { return (mr.segment_velocity);}
+float mp_get_runtime_velocity(void) { return (mr.segment_velocity * mr.override);}
 float mp_get_runtime_absolute_position(uint8_t axis) { return (mr.position[axis]);}
-void mp_set_runtime_work_offset(float offset[]) { copy_vector(mr.gm.work_offset, offset);}
-float mp_get_runtime_work_position(uint8_t axis) { return (mr.position[axis] - mr.gm.work_offset[axis]);}
+void mp_set_runtime_work_offset(float offset[]) { copy_vector(mr.gm.work_offset, offset); mr.context_serial = 0;}
+float mp_get_runtime_work_position(uint8_t axis) { return (mp_get_runtime_machine_position(axis) - mr.gm.work_offset[axis]);}
+
+/*
+ * mp_get_runtime_machine_position() - reported position, from forward kinematics when nonlinear
+ *
+ *	For linear kinematics the Cartesian runtime position is exactly where the motors are
+ *	going. For nonlinear kinematics the steps are interpolated in joint space, so the
+ *	reported position is computed from the commanded steps with forward kinematics.
+ *	This is only done here, when a status report or query asks for it, and the result is
+ *	cached until the steps move so a report of all axes pays for one transform. Exec still
+ *	keeps mr.position in Cartesian space since it generates the next segment from it.
+ *	While a retrace has the machine off the hold point it reports where the retrace is.
+ */
+
+float mp_get_runtime_machine_position(uint8_t axis)
+{
+	static float fk_steps[MOTORS];
+	static float fk_position[AXES];
+	static uint8_t fk_type = KINEMATICS_MAX_TYPE;		// invalid until the first transform
+
+#ifdef __PATH_RETRACE
+	if (mp_retrace_is_active()) {
+		return (mp_retrace_get_position(axis));			// not where the hold stopped - where the retrace has it
+	}
+#endif
+	if (kn_kinematics_is_linear()) {
+		return (mr.position[axis]);
+	}
+	float steps[MOTORS];
+#ifdef __ARM
+	__disable_irq();									// snapshot steps from a single segment
+#endif
+	copy_vector(steps, mr.target_steps);
+#ifdef __ARM
+	__enable_irq();
+#endif
+	if ((fk_type != kn.type) || (memcmp(steps, fk_steps, sizeof(steps)) != 0)) {
+		copy_vector(fk_steps, steps);
+		fk_type = kn.type;
+		kn_forward_kinematics(fk_steps, fk_position);
+	}
+	return (fk_position[axis]);
+}
 
 /*
  * mp_get_runtime_busy() - return TRUE if motion control busy (i.e. robot is moving)
@@ -105,22 +179,53 @@ uint8_t mp_get_runtime_busy()
  *	Note: Returning a status that is not STAT_OK means the endpoint is NOT advanced. So lines
  *	that are too short to move will accumulate and get executed once the accumulated error
  *	exceeds the minimums.
+ *
+ *	Note: If coalescing is enabled ($ca > 0) a feed move that continues the newest block in
+ *	very nearly the same direction is merged into that block instead of taking a new buffer.
+ *	See _coalesce_aline().
+ *
+ *	Note: Under G64 P<tolerance> the corner with the newest block may be cut by an arc block
+ *	queued ahead of the move. See _blend_corner().
+ *
+ *	Note: With __PLANNER_PROFILE defined mp_aline() times the real work, done in _aline().
  */
 
+#ifdef __PLANNER_PROFILE
+static stat_t _aline(GCodeState_t *gm_in);
+
+stat_t mp_aline(GCodeState_t *gm_in)
+{
+	uint32_t start = hw_get_cpu_cycles();
+	stat_t status = _aline(gm_in);
+	mp_profile_time(&mp_prof.aline, hw_get_cpu_cycles() - start);
+	return (status);
+}
+
+static stat_t _aline(GCodeState_t *gm_in)
+#else
 stat_t mp_aline(GCodeState_t *gm_in)
+#endif
 {
 	mpBuf_t *bf; 						// current move pointer
 
+#ifdef __TANGENTIAL_KNIFE
+	_tangent_knife(gm_in);				// point the knife along the move - may queue a turn first
+#endif
+
 	// compute some reused terms
 	float axis_length[AXES];
 	float axis_square[AXES];
 	float length_square = 0;
 
-	for (uint8_t axis=0; axis<AXES; axis++) {
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
 		axis_length[axis] = gm_in->target[axis] - mm.position[axis];
 		axis_square[axis] = square(axis_length[axis]);
 		length_square += axis_square[axis];
 	}
+	for (uint8_t axis=AXES_ACTIVE; axis<AXES; axis++) {     // axes the machine doesn't have never move
+		axis_length[axis] = 0;
+		axis_square[axis] = 0;
+	}
 	float length = sqrt(length_square);
 
 	// exit if the move has zero movement. At all.
@@ -129,46 +234,326 @@ stat_t mp_aline(GCodeState_t *gm_in)
 		return (STAT_MINIMUM_LENGTH_MOVE);
 	}
 
+    // merge into the newest block if possible, otherwise get a cleared buffer
+    bool carried = spindle.sync_pending || (raster.loading != RASTER_NONE);  // the move takes an S or raster line
+    carried = carried || mp_aux_commands_pending();                 // ...or aux commands
+#ifdef __MOTION_OUTPUTS
+    carried = carried || gpio_output_events_pending();             // ...or output events
+#endif
+    mpBuf_t *held = carried ? NULL : _coalesce_aline(gm_in, axis_length, axis_square, &length);
+    if (held != NULL) {
+        bf = held;
+    } else {
+        _blend_corner(gm_in, axis_length, axis_square, &length);    // round off the corner under G64 P
+        if ((bf = mp_get_write_buffer()) == NULL) {                 // never supposed to fail
+            return(cm_panic(STAT_BUFFER_FULL_FATAL, "no write buffer in aline"));
+        }
+    }
     _calculate_move_times(gm_in, axis_length, axis_square);         // set move time and minimum time in the state
 
-    // get a cleared buffer and setup move variables
-    if ((bf = mp_get_write_buffer()) == NULL) {                     // never supposed to fail
-        return(cm_panic(STAT_BUFFER_FULL_FATAL, "no write buffer in aline"));
-    }
+    // setup move variables
     bf->bf_func = mp_exec_aline;                                    // register the callback to the exec function
     bf->length = length;
-    for (uint8_t axis=0; axis<AXES; axis++) {                       // generate the unit vector
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {                       // generate the unit vector
         bf->unit[axis] = axis_length[axis] / length;
         if (fabs(bf->unit[axis]) > 0) {
-            bf->unit_flags[axis] = true;
+            bf->flag_vector[axis] = true;                           // mark axes participating in the move
         }
     }
-	memcpy(&bf->gm, gm_in, sizeof(GCodeState_t));                   // copy model state into planner buffer
+	mp_set_buffer_gcode_state(bf, gm_in);                           // copy model state into planner buffer
+    if (held == NULL) {
+        bf->spindle_sync = spindle_take_sync_speed(&bf->spindle_speed);
+        bf->raster = raster_take_line(bf->gm.motion_mode);
+#ifdef __MOTION_OUTPUTS
+        bf->output_events = gpio_take_output_events(bf->output_event, length);
+#endif
+    }
 
-    _calculate_jerk(bf);                                            // get initial value for bf->jerk
-	bf->cruise_vmax = bf->length / bf->gm.move_time;                // target velocity requested
-	bf->delta_vmax = mp_get_target_velocity(0, bf->length, bf);
-	bf->braking_velocity = bf->delta_vmax;
+    // choose the joint-space subdivision for nonlinear kinematics (coalesced blocks are redone whole)
+    bf->kinematic_subdivisions = 1;
+    if (!kn_kinematics_is_linear()) {
+        float start[AXES];
+        for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+            start[axis] = bf->gm.target[axis] - bf->unit[axis] * length;
+        }
+        bf->kinematic_subdivisions = kn_get_subdivisions(start, bf->gm.target);
+    }
 
-    if (cm_get_path_control(MODEL) == PATH_EXACT_STOP) {
-        bf->entry_vmax = 0;
-        bf->exit_vmax = 0;
-        bf->replannable = false;                                     // ++++ Possible problem here --- for reference. This is already set to zero by the clear.
-    } else {
-        bf->entry_vmax = _calculate_junction_vmax(bf->cruise_vmax, bf->pv->unit, bf->unit);
-        bf->exit_vmax = min(bf->cruise_vmax, (bf->entry_vmax + bf->delta_vmax));
-        bf->replannable = true;
-	}
+    _calculate_jerk(bf, bf->unit);                                  // get initial value for bf->jerk
+	bf->jerk_nominal = bf->jerk;
+	bf->feed_vmax = bf->length / bf->gm.move_time;                  // target velocity requested
+	bf->limit_vmax = _get_axis_vmax(bf);
+	_apply_override(bf, cm_get_path_control(MODEL));                // cruise, braking and junction vmaxes
+	_smooth_feed(bf);                                               // level the block before it, if it's short
+    bf->replannable = (cm_get_path_control(MODEL) != PATH_EXACT_STOP);  // ++++ Possible problem here --- for reference. This is already set to zero by the clear.
     bf->real_move_time = 0;
 
 	// Note: these next lines must remain in exact order. Position must update before committing the buffer.
 	copy_vector(mm.position, bf->gm.target);	// set the planner position
+	if (held != NULL) {
+		mp_restart_plan_pass();                 // its vmaxes changed under any pass in progress
+		return (STAT_OK);                       // already committed - it's still waiting to be planned
+	}
+	mb.aline_count++;
 	mp_commit_write_buffer(MOVE_TYPE_ALINE); 	// commit current block (must follow the position update)
 	return (STAT_OK);
 }
 
+/****************************************************************************************
+ * mp_arc() - plan an arc or helix as a single block
+ *
+ *	The arc is planned as one trapezoid along its length, so a full circle takes one buffer
+ *	and one junction instead of one of each per segment. The exec generates the segments
+ *	straight from the arc geometry - see _get_arc_position() in plan_exec.cpp.
+ *
+ *	The arc runs from the planner position to gm_in->target. gm_in->move_time must be set
+ *	to the time at the requested feed rate, axis limits and curvature limit - see
+ *	mp_get_arc_velocity_max(). The unit vector is the tangent at the start of the arc and
+ *	arc.exit_unit the tangent at the end, so junctions on both ends are computed as they
+ *	are for lines. Jerk is limited by every axis in the arc.
+ */
+
+stat_t mp_arc(GCodeState_t *gm_in, const mpArc_t *arc_in, const float length)
+{
+	mpBuf_t *bf;
+
+	if (fp_ZERO(length)) {
+		sr_request_status_report(SR_REQUEST_TIMED_FULL);
+		return (STAT_MINIMUM_LENGTH_MOVE);
+	}
+	if ((bf = mp_get_write_buffer()) == NULL) {                     // never supposed to fail
+		return(cm_panic(STAT_BUFFER_FULL_FATAL, "no write buffer in arc"));
+	}
+	bf->bf_func = mp_exec_aline;                                    // arcs run in the aline exec
+	bf->length = length;
+	bf->arc = *arc_in;
+	uint8_t axis_0 = arc_in->plane_axis_0;
+	uint8_t axis_1 = arc_in->plane_axis_1;
+
+	// Tangents at the ends, and the (largest) share of the length traveled by each axis.
+	// Axes outside the plane move in proportion to the distance along the arc.
+	float share[AXES];
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		bf->unit[axis] = (gm_in->target[axis] - mm.position[axis]) / length;
+		bf->arc.exit_unit[axis] = bf->unit[axis];
+		share[axis] = fabs(bf->unit[axis]);
+	}
+	float planar = arc_in->radius * arc_in->angular_travel / length;   // plane travel per unit length
+	float exit_theta = arc_in->theta + arc_in->angular_travel;
+	bf->unit[axis_0] = planar * cos(arc_in->theta);
+	bf->unit[axis_1] = -planar * sin(arc_in->theta);
+	bf->arc.exit_unit[axis_0] = planar * cos(exit_theta);
+	bf->arc.exit_unit[axis_1] = -planar * sin(exit_theta);
+	share[axis_0] = fabs(planar);
+	share[axis_1] = share[axis_0];
+	_commit_curve(bf, gm_in, share, MOVE_TYPE_ARC);
+	return (STAT_OK);
+}
+
+/*
+ * _commit_curve() - finish and commit an arc or spline block
+ *
+ *	share[] is the largest share of the length traveled by each axis, for the jerk.
+ */
+
+static void _commit_curve(mpBuf_t *bf, GCodeState_t *gm_in, const float share[], const moveType move_type)
+{
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		if (share[axis] > 0) {
+			bf->flag_vector[axis] = true;                           // mark axes participating in the move
+		}
+	}
+
+	mp_set_buffer_gcode_state(bf, gm_in);                           // copy model state into planner buffer
+	bf->spindle_sync = spindle_take_sync_speed(&bf->spindle_speed);
+#ifdef __MOTION_OUTPUTS
+	bf->output_events = gpio_take_output_events(bf->output_event, bf->length);
+#endif
+	bf->kinematic_subdivisions = 1;                                 // IK every segment - curves are curved anyway
+
+	_calculate_jerk(bf, share);
+	bf->jerk_nominal = bf->jerk;
+	bf->feed_vmax = bf->length / bf->gm.move_time;
+	bf->limit_vmax = bf->feed_vmax;                                 // already held to the curvature limit
+	_apply_override(bf, cm_get_path_control(MODEL));
+	bf->replannable = (cm_get_path_control(MODEL) != PATH_EXACT_STOP);
+	bf->real_move_time = 0;
+
+	// Note: these next lines must remain in exact order. Position must update before committing the buffer.
+	copy_vector(mm.position, bf->gm.target);	// set the planner position
+	mb.aline_count++;
+	mp_commit_write_buffer(move_type); 			// commit current block (must follow the position update)
+}
+
+/****************************************************************************************
+ * mp_spline() - plan a cubic spline (G5) as a single block
+ *
+ *	Like an arc the spline is planned as one trapezoid along its length and the exec
+ *	generates the segments from the curve itself - see _get_arc_position() in plan_exec.cpp.
+ *	The curve runs from the planner position to gm_in->target through spline_in, which must
+ *	have its table set by mp_set_spline_table(). length is the length of the move, including
+ *	any travel of axes outside the plane, and gm_in->move_time must be set to the time at the
+ *	requested feed rate, axis limits and curvature limit. The unit vector is the tangent at
+ *	the start of the curve and spline.exit_unit the tangent at the end.
+ */
+
+static void _get_spline_tangent(const float a[], const float b[], const float c[], float tangent[])
+{
+	float d0 = b[0] - a[0];                                         // a to b, or a to c if b is on a
+	float d1 = b[1] - a[1];
+	if (fp_ZERO(d0) && fp_ZERO(d1)) {
+		d0 = c[0] - a[0];
+		d1 = c[1] - a[1];
+	}
+	float length = sqrt(square(d0) + square(d1));
+	tangent[0] = (length > 0) ? d0 / length : 0;
+	tangent[1] = (length > 0) ? d1 / length : 0;
+}
+
+stat_t mp_spline(GCodeState_t *gm_in, const mpSpline_t *spline_in, const float length)
+{
+	mpBuf_t *bf;
+
+	if (fp_ZERO(length)) {
+		sr_request_status_report(SR_REQUEST_TIMED_FULL);
+		return (STAT_MINIMUM_LENGTH_MOVE);
+	}
+	if ((bf = mp_get_write_buffer()) == NULL) {                     // never supposed to fail
+		return(cm_panic(STAT_BUFFER_FULL_FATAL, "no write buffer in spline"));
+	}
+	bf->bf_func = mp_exec_aline;                                    // splines run in the aline exec
+	bf->length = length;
+	bf->spline = *spline_in;
+	uint8_t axis_0 = spline_in->plane_axis_0;
+	uint8_t axis_1 = spline_in->plane_axis_1;
+	const float (*point)[2] = spline_in->point;
+
+	float share[AXES];
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		bf->unit[axis] = (gm_in->target[axis] - mm.position[axis]) / length;
+		bf->spline.exit_unit[axis] = bf->unit[axis];
+		share[axis] = fabs(bf->unit[axis]);
+	}
+	float planar = spline_in->table[SPLINE_TABLE_SIZE-1] / length;  // plane travel per unit length
+	float entry[2];
+	float exit[2];
+	_get_spline_tangent(point[0], point[1], point[2], entry);
+	_get_spline_tangent(point[3], point[2], point[1], exit);
+	bf->unit[axis_0] = planar * entry[0];
+	bf->unit[axis_1] = planar * entry[1];
+	bf->spline.exit_unit[axis_0] = -planar * exit[0];               // from the end back, so reversed
+	bf->spline.exit_unit[axis_1] = -planar * exit[1];
+	share[axis_0] = planar;
+	share[axis_1] = planar;
+	_commit_curve(bf, gm_in, share, MOVE_TYPE_SPLINE);
+	return (STAT_OK);
+}
+
 /*
- * mp_plan_block_list() - plans the entire block list
+ * mp_set_spline_table() - set the length table of a spline, return its length in the plane
+ * mp_get_spline_point()  - point in the plane at a fraction of the length along a spline
+ * mp_split_spline()      - cut a spline down to the part after a fraction of its length
+ *
+ *	A cubic Bezier is evaluated by its parameter t, which doesn't run at a steady rate along
+ *	the curve. The table holds the length of the curve (summed over short chords) at evenly
+ *	spaced t, so a distance is turned back into t by interpolating in the table. Points are
+ *	always exactly on the curve - only the spacing of the segments is approximate.
+ *
+ *	The radius of curvature is |B'|^3 / |B' x B''|. The least radius found at the chord ends
+ *	is returned in min_radius for the curvature velocity limit - see mp_get_arc_velocity_max().
+ */
+
+static void _get_bezier_point(const float point[][2], const float t, float position[])
+{
+	float u = 1 - t;
+	float b0 = u * u * u;
+	float b1 = 3 * u * u * t;
+	float b2 = 3 * u * t * t;
+	float b3 = t * t * t;
+	for (uint8_t i=0; i<2; i++) {
+		position[i] = b0 * point[0][i] + b1 * point[1][i] + b2 * point[2][i] + b3 * point[3][i];
+	}
+}
+
+static float _get_bezier_radius(const float point[][2], const float t)
+{
+	float u = 1 - t;
+	float first[2];
+	float second[2];
+	for (uint8_t i=0; i<2; i++) {
+		first[i] = 3 * (u * u * (point[1][i] - point[0][i]) + 2 * u * t * (point[2][i] - point[1][i]) +
+						t * t * (point[3][i] - point[2][i]));
+		second[i] = 6 * (u * (point[2][i] - 2 * point[1][i] + point[0][i]) +
+						 t * (point[3][i] - 2 * point[2][i] + point[1][i]));
+	}
+	float speed = sqrt(square(first[0]) + square(first[1]));
+	float cross = fabs(first[0] * second[1] - first[1] * second[0]);
+	if ((speed < EPSILON) || (cross < EPSILON)) {
+		return (8675309);                                           // straight, or a cusp with no direction
+	}
+	return (speed * speed * speed / cross);
+}
+
+static float _get_spline_t(const mpSpline_t *spline, const float fraction)
+{
+	float distance = fraction * spline->table[SPLINE_TABLE_SIZE-1];
+	float start = 0;
+	uint8_t i = 0;
+	while ((i < SPLINE_TABLE_SIZE-1) && (spline->table[i] < distance)) {
+		start = spline->table[i++];
+	}
+	float span = spline->table[i] - start;
+	float t = (span > 0) ? (i + (distance - start) / span) / SPLINE_TABLE_SIZE : (float)(i+1) / SPLINE_TABLE_SIZE;
+	return (min((float)1, max((float)0, t)));
+}
+
+float mp_set_spline_table(mpSpline_t *spline, float *min_radius)
+{
+	float length = 0;
+	float last[2] = { spline->point[0][0], spline->point[0][1] };
+	*min_radius = _get_bezier_radius(spline->point, 0);
+
+	for (uint8_t i=0; i<SPLINE_TABLE_SIZE; i++) {
+		for (uint8_t j=1; j<=SPLINE_TABLE_CHORDS; j++) {
+			float t = (float)(i * SPLINE_TABLE_CHORDS + j) / (SPLINE_TABLE_SIZE * SPLINE_TABLE_CHORDS);
+			float position[2];
+			_get_bezier_point(spline->point, t, position);
+			length += sqrt(square(position[0] - last[0]) + square(position[1] - last[1]));
+			last[0] = position[0];
+			last[1] = position[1];
+			*min_radius = min(*min_radius, _get_bezier_radius(spline->point, t));
+		}
+		spline->table[i] = length;
+	}
+	return (length);
+}
+
+void mp_get_spline_point(const mpSpline_t *spline, const float fraction, float point[])
+{
+	_get_bezier_point(spline->point, _get_spline_t(spline, fraction), point);
+}
+
+void mp_split_spline(mpSpline_t *spline, const float fraction)
+{
+	float t = _get_spline_t(spline, fraction);
+	float (*p)[2] = spline->point;
+	for (uint8_t i=0; i<2; i++) {                                   // de Casteljau - keep the part after t
+		float p01 = p[0][i] + (p[1][i] - p[0][i]) * t;
+		float p12 = p[1][i] + (p[2][i] - p[1][i]) * t;
+		float p23 = p[2][i] + (p[3][i] - p[2][i]) * t;
+		float p012 = p01 + (p12 - p01) * t;
+		float p123 = p12 + (p23 - p12) * t;
+		p[0][i] = p012 + (p123 - p012) * t;
+		p[1][i] = p123;
+		p[2][i] = p23;
+	}
+	float min_radius;
+	mp_set_spline_table(spline, &min_radius);
+}
+
+/*
+ * mp_plan_block_list()   - plans the entire block list, PLANNER_BLOCKS_PER_CALL blocks at a time
+ * mp_restart_plan_pass() - drop a pass in progress. The block list has changed under it
  *
  *	The block list is the circular buffer of planner buffers (bf's). The block currently
  *	being planned is the "bf" block. The "first block" is the next block to execute;
@@ -182,6 +567,20 @@ stat_t mp_aline(GCodeState_t *gm_in)
  *	_plan_block_list() plans all blocks between and including the (effective) first block
  *	and the bf. It sets entry, exit and cruise v's from vmax's then calls trapezoid generation.
  *
+ *	Replanning is incremental. The backward pass stops at the first previously planned block
+ *	whose braking velocity is unchanged, and the forward pass only updates blocks whose entry
+ *	or exit velocity changed. Trapezoids are not generated here - see mp_finalize_trapezoid().
+ *	mb.trapezoid_count / mb.aline_count (_tzc / _alc) gives the average number of trapezoids
+ *	generated per new block.
+ *
+ *	A full queue can take long enough to plan to hold up feedhold detection and the reports,
+ *	so a call returns STAT_EAGAIN once it has visited PLANNER_BLOCKS_PER_CALL blocks. Where
+ *	it stopped is kept in mb.plan_xxx and the next call picks up from there. The pass starts
+ *	over if the list changed meanwhile - a new block, an override or feedhold replan, or the
+ *	exec running through the block it was to resume at. Blocks the forward pass has queued
+ *	can run before the pass finishes. Those further on keep their last plan, which still
+ *	stops at its old end, so the exec never runs ahead of a safe plan.
+ *
  *	Variables that must be provided in the mpBuffers that will be processed:
  *
  *	  bf (function arg)		- end of block list (last block in time)
@@ -189,6 +588,9 @@ stat_t mp_aline(GCodeState_t *gm_in)
  *	  bf->move_type			- typically MOVE_TYPE_ALINE. Other move_types should be set to
  *							  length=0, entry_vmax=0 and exit_vmax=0 and are treated
  *							  as a momentary stop (plan to zero and from zero).
+ *	  bf->pass_through		- commands with this set are planned through at the velocity
+ *							  of the surrounding moves. They take the next block's entry_vmax
+ *							  as their own, so they plan to zero only while they are last.
  *
  *	  bf->length			- provides block length
  *	  bf->entry_vmax		- used during forward planning to set entry velocity
@@ -208,9 +610,10 @@ stat_t mp_aline(GCodeState_t *gm_in)
  *	  bf->cruise_velocity	- set during forward planning
  *	  bf->exit_velocity		- set during forward planning
  *
- *	  bf->head_length		- set during trapezoid generation
- *	  bf->body_length		- set during trapezoid generation
- *	  bf->tail_length		- set during trapezoid generation
+ *	  bf->head_length		- set during trapezoid generation (deferred)
+ *	  bf->body_length		- set during trapezoid generation (deferred)
+ *	  bf->tail_length		- set during trapezoid generation (deferred)
+ *	  bf->trapezoid_pending	- set if trapezoid generation is still to be done
  *
  *	Variables that are ignored but here's what you would expect them to be:
  *	  bf->move_state		- NEW for all blocks but the earliest
@@ -233,102 +636,172 @@ stat_t mp_aline(GCodeState_t *gm_in)
  *		list can be recomputed regardless of exact stops and previous replanning
  *		optimizations.
  */
-void mp_plan_block_list(mpBuf_t *bf)
+void mp_restart_plan_pass()
+{
+    mb.plan_pass = PLAN_PASS_IDLE;
+}
+
+stat_t mp_plan_block_list(mpBuf_t *bf)
 {
+    PROFILE_PIN_SCOPE(PLAN);
 #ifdef DEBUG
     volatile uint32_t start_time = SysTickTimer.getValue();
 #endif
+    uint8_t budget = PLANNER_BLOCKS_PER_CALL;
 
-    // the the exec not to change the moves out from under us
-    mb.planning = true;
-
-    mpBuf_t *bp = bf;
+    if ((mb.plan_pass != PLAN_PASS_IDLE) &&
+        ((bf != mb.plan_bf) || (mb.plan_bp->buffer_state == MP_BUFFER_EMPTY))) {
+        mb.plan_pass = PLAN_PASS_IDLE;              // the list changed - start over
+    }
+    if (mb.plan_pass == PLAN_PASS_IDLE) {
+        mb.plan_pass = PLAN_PASS_BACKWARD;
+        mb.plan_bf = bf;
+        mb.plan_bp = bf;
+        mb.plan_velocity = min(bf->entry_vmax, bf->braking_velocity);
+    }
+    mpBuf_t *bp = mb.plan_bp;
 
 	// Backward planning pass. Find first block and update the braking velocities.
 	// At the end *bp points to the buffer before the first block.
-	while ((bp = mp_get_prev_buffer(bp)) != bf) {
-		if (bp->replannable == false || bp->locked == true) {
-            break;
-        }
-		bp->braking_velocity = min(bp->nx->entry_vmax, bp->nx->braking_velocity) + bp->delta_vmax;
+	// Planning is incremental - if a previously planned block's braking velocity does not
+	// change then no block behind it can change either. That block must still be replanned
+	// as its exit depends on the next block's braking velocity, so back up one and stop.
+	// Dwells and commands are queued as soon as they are committed, so they say nothing about
+	// the blocks behind them - only a planned move can stop the pass early. A move that
+	// has never been planned is always taken, even if it can't be replanned (exact stop).
+	// The velocity limit from the next block is carried in a local, not re-read through bp->nx.
+	// It resumes from the last block it updated (mb.plan_bp).
+	if (mb.plan_pass == PLAN_PASS_BACKWARD) {
+		float nx_velocity = mb.plan_velocity;
+		while ((bp = mp_get_prev_buffer(bp)) != bf) {
+			if (((bp->replannable == false) && (bp->buffer_state != MP_BUFFER_PLANNING)) || bp->locked == true) {
+	            break;
+	        }
+			if (budget-- == 0) {
+				mb.plan_bp = bp->nx;
+				mb.plan_velocity = nx_velocity;
+				return (STAT_EAGAIN);
+			}
+			if (bp->pass_through) {
+				bp->entry_vmax = bp->nx->entry_vmax;		// the junction limit is the next block's
+			}
+			float braking_velocity = nx_velocity + bp->delta_vmax;
+			if ((bp->buffer_state == MP_BUFFER_QUEUED) && mp_move_type_is_planned(bp->move_type) &&
+				fp_EQ(braking_velocity, bp->braking_velocity)) {
+				bp = mp_get_prev_buffer(bp);
+				break;
+			}
+			bp->braking_velocity = braking_velocity;
+			nx_velocity = min(bp->entry_vmax, braking_velocity);
+		}
+		mb.plan_pass = PLAN_PASS_FORWARD;
+		mb.plan_velocity = bp->exit_velocity;
+		mb.plan_bp = mp_get_next_buffer(bp);
 	}
 
-	// forward planning pass - recomputes trapezoids in the list from the first block to the bf block.
-	while ((bp = mp_get_next_buffer(bp)) != bf) {
+	// forward planning pass - recomputes velocities in the list from the first block to the bf block.
+	// The previous block's exit velocity is carried in a local, not re-read through bp->pv.
+	// It resumes at the next block to plan (mb.plan_bp).
+	// The blocks it has planned can run before it resumes, so it only pauses where the exit
+	// just published meets the entry the next block is already planned with. Otherwise it runs
+	// over budget until it gets to one.
+	float pv_exit_velocity = mb.plan_velocity;
+	for (bp = mb.plan_bp; bp != bf; bp = mp_get_next_buffer(bp)) {
+		if (budget > 0) {
+			budget--;
+		} else if ((bp->buffer_state != MP_BUFFER_QUEUED) || fp_EQ(pv_exit_velocity, bp->entry_velocity)) {
+			mb.plan_bp = bp;
+			mb.plan_velocity = pv_exit_velocity;
+			mb.needs_time_accounting = true;        // the blocks planned so far are queued
+			return (STAT_EAGAIN);
+		}
 
         // plan dwells, commands and other move types
-        if (bp->move_type != MOVE_TYPE_ALINE) {
-            bp->replannable = false;
+        if (!mp_move_type_is_planned(bp->move_type)) {
+            if (bp->pass_through) {
+                // carry the velocity across. It's only final once the block before it is
+                bp->entry_velocity = pv_exit_velocity;
+                bp->exit_velocity = pv_exit_velocity;
+                bp->replannable = bp->pv->replannable;
+            } else {
+                bp->replannable = false;
+            }
             if (bp->buffer_state == MP_BUFFER_PLANNING) {
-                bp->buffer_state = MP_BUFFER_QUEUED;
+                mp_queue_buffer(bp);
             } else if (bp->buffer_state == MP_BUFFER_EMPTY) {
                 rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "buffer empty1 in mp_plan_block_list");
                 _debug_trap();
             }
-            // TODO: Add support for non-plan-to-zero commands by caching the correct pv value
+            pv_exit_velocity = bp->exit_velocity;
             continue;
         }
 
         // plan lines
+		float entry_velocity;
 		if (bp->pv == bf)  {
-			bp->entry_velocity = bp->entry_vmax;		// first block in the list
+			entry_velocity = bp->entry_vmax;			// first block in the list
 		} else {
-			bp->entry_velocity = bp->pv->exit_velocity;	// other blocks in the list
+			entry_velocity = pv_exit_velocity;			// other blocks in the list
 		}
-		bp->cruise_velocity = bp->cruise_vmax;
-		bp->exit_velocity = min4( bp->exit_vmax, bp->nx->entry_vmax, bp->nx->braking_velocity,
-								 (bp->entry_velocity + bp->delta_vmax) );
-
-        mp_calculate_trapezoid(bp);
+		float exit_velocity = min4( bp->exit_vmax, bp->nx->entry_vmax, bp->nx->braking_velocity,
+								   (entry_velocity + bp->delta_vmax) );
 
-        if (fp_ZERO(bp->cruise_velocity)) { // ++++ Diagnostic - can be removed
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero velocity in mp_plan_block_list");
-            _debug_trap();
-        }
+		// only update blocks that are new or that have changed since last planned
+#ifdef __MOTION_TRACE
+		bool trace = false;
+#endif
+		if ((bp->buffer_state != MP_BUFFER_QUEUED) ||
+			fp_NE(entry_velocity, bp->entry_velocity) || fp_NE(exit_velocity, bp->exit_velocity)) {
 
-        // Force a calculation of this here
-        bp->real_move_time = ((bp->head_length*2)/(bp->entry_velocity + bp->cruise_velocity)) +
-                              (bp->body_length/bp->cruise_velocity) +
-                             ((bp->tail_length*2)/(bp->exit_velocity + bp->cruise_velocity));
+			if (!_begin_block_plan(bp)) {				// the exec took it since the backward pass
+				pv_exit_velocity = bp->exit_velocity;
+				continue;
+			}
+			bp->entry_velocity = entry_velocity;
+			bp->cruise_velocity = bp->cruise_vmax;
+			bp->exit_velocity = exit_velocity;
+            _defer_trapezoid(bp);
+			_end_block_plan(bp);
+#ifdef __MOTION_TRACE
+			trace = true;
+#endif
+		}
 
 		// Test for optimally planned trapezoids - only need to check various exit conditions
+		// A pass-through command's entry_vmax can still rise, so it doesn't count as a limit
         if  ( ((fp_EQ(bp->exit_velocity, bp->exit_vmax)) ||
-               (fp_EQ(bp->exit_velocity, bp->nx->entry_vmax)) ) ||
+               (!bp->nx->pass_through && fp_EQ(bp->exit_velocity, bp->nx->entry_vmax)) ) ||
                ((bp->pv->replannable == false) && fp_EQ(bp->exit_velocity, (bp->entry_velocity + bp->delta_vmax))) )
             {
             bp->replannable = false;
         }
+#ifdef __MOTION_TRACE
+        if (trace) {
+            mp_trace_block(bp, MP_TRACE_PLAN);  // with the replannable decision just made
+        }
+#endif
+        pv_exit_velocity = bp->exit_velocity;
         if (bp->buffer_state == MP_BUFFER_PLANNING) {
-            bp->buffer_state = MP_BUFFER_QUEUED;
+            mp_queue_buffer(bp);
         } else if (bp->buffer_state == MP_BUFFER_EMPTY) {
             rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "buffer empty2 in mp_plan_block_list");
             _debug_trap();
-        } else if (bp->buffer_state == MP_BUFFER_RUNNING) {
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "we just replanned a running buffer!");
-            _debug_trap();
         }
 	}
 
-    if (bp->move_type == MOVE_TYPE_ALINE) {
-        // finish up the last block move
+    if (mp_move_type_is_planned(bp->move_type) && _begin_block_plan(bp)) {
+        // finish up the last block move - to a stop, or to its exit hint
         bp->entry_velocity = bp->pv->exit_velocity; // WARNING: bp->pv might not be initied
         bp->cruise_velocity = bp->cruise_vmax;
-        bp->exit_velocity = 0;
-
-        mp_calculate_trapezoid(bp);
-
-        if (fp_ZERO(bp->cruise_velocity)) { // +++ diagnostic +++ remove later
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "min time move in mp_plan_block_list");
-            _debug_trap();
-        }
-
-        // Force a calculation of this here
-        bp->real_move_time = ((bp->head_length*2)/(bp->entry_velocity + bp->cruise_velocity)) +
-                              (bp->body_length/bp->cruise_velocity) +
-                             ((bp->tail_length*2)/(bp->exit_velocity + bp->cruise_velocity));
+        bp->exit_velocity = min3(_get_exit_hint(bp), bp->exit_vmax, (bp->entry_velocity + bp->delta_vmax));
+        _defer_trapezoid(bp);
+        _end_block_plan(bp);
+#ifdef __MOTION_TRACE
+        mp_trace_block(bp, MP_TRACE_PLAN);
+#endif
 
         if (bp->buffer_state == MP_BUFFER_PLANNING) {
-            bp->buffer_state = MP_BUFFER_QUEUED;
+            mp_queue_buffer(bp);
         } else if (bp->buffer_state == MP_BUFFER_EMPTY) {
             rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "buffer empty3 in mp_plan_block_list");
             _debug_trap();
@@ -343,18 +816,390 @@ void mp_plan_block_list(mpBuf_t *bf)
     }
 #endif
 
-    // let the exec know we're done planning, and that the times are likely wrong
-    mb.planning = false;
+    // let the exec know the times are likely wrong
+    mb.plan_pass = PLAN_PASS_IDLE;
     mb.needs_time_accounting = true;
+    return (STAT_OK);
+}
+
+/*
+ * _defer_trapezoid()       - mark a replanned block for trapezoid generation and estimate its time
+ * mp_finalize_trapezoid()  - generate head, body and tail for a block that is about to run
+ *
+ *	Replanning only settles the entry, cruise and exit velocities. Most blocks are replanned
+ *	several times before they run, so the trapezoid is only generated once the block is
+ *	locked by _planner_time_accounting() or becomes the run buffer. Until then the move time
+ *	is an estimate good enough for the planner's time accounting.
+ *
+ *	Trapezoid generation may adjust the exit velocity (short moves), so the entry is re-taken
+ *	from the previous block. Blocks are finalized in queue order so the previous block has
+ *	already been finalized, or has run and been freed - in which case the planned entry stands.
+ *	mp_finalize_trapezoid() is called from the exec (LO interrupt) level.
+ */
+static void _defer_trapezoid(mpBuf_t *bf)
+{
+    bf->trapezoid_pending = true;
+    bf->real_move_time = (4 * bf->length) / (bf->entry_velocity + 2*bf->cruise_velocity + bf->exit_velocity);
+    mp_update_queued_time(bf);
+}
+
+/*
+ * _begin_block_plan() - claim a block to write its plan. Returns false if the exec already has it
+ * _end_block_plan()   - publish the plan written since _begin_block_plan()
+ *
+ *	The exec (LO interrupt) locks and starts blocks while the planner is mid-pass, so a
+ *	block's plan is handed over seqlock style instead of holding the exec off for the whole
+ *	pass. The planner makes plan_seq odd before it checks or writes a block, and even again
+ *	once the block's entry, cruise, exit, trapezoid flag and time estimate are all written.
+ *	The exec only locks or starts a block whose plan_seq is even. It runs to completion
+ *	before the planner resumes, so everything it reads from an even block is one consistent
+ *	plan - the snapshot comes for free on a single core, no copy or retry needed.
+ *
+ *	The writer can't be waited on from the interrupt. An exec that finds the next run
+ *	buffer odd backs off and sets mb.exec_deferred, and _end_block_plan() requests it again.
+ *	The window is a few stores long - well inside the segment the exec has already prepped.
+ *	The barriers keep the compiler from moving the plan's stores outside the window.
+ */
+static bool _begin_block_plan(mpBuf_t *bf)
+{
+    bf->plan_seq++;                                 // odd: the exec leaves the block alone
+    __asm__ __volatile__ ("" ::: "memory");
+    if (bf->locked || (bf->buffer_state == MP_BUFFER_RUNNING)) {
+        bf->plan_seq++;
+        return (false);
+    }
+    return (true);
+}
+
+static void _end_block_plan(mpBuf_t *bf)
+{
+    __asm__ __volatile__ ("" ::: "memory");
+    bf->plan_seq++;
+    if (mb.exec_deferred) {
+        mb.exec_deferred = false;
+        st_request_exec_move();
+    }
+}
+
+void mp_finalize_trapezoid(mpBuf_t *bf)
+{
+    if (!bf->trapezoid_pending) {
+        return;
+    }
+    bf->trapezoid_pending = false;
+
+    if (bf->pv->buffer_state != MP_BUFFER_EMPTY) {
+        bf->entry_velocity = bf->pv->exit_velocity;
+    }
+    bf->cruise_velocity = bf->cruise_vmax;
+    bf->exit_velocity = min(bf->exit_velocity, (bf->entry_velocity + bf->delta_vmax));
+#ifdef __VELOCITY_HINTS
+    if ((bf->exit_velocity > 0) && (bf->nx->buffer_state != MP_BUFFER_QUEUED)) { // hinted, and nothing planned behind it
+        if (bf->entry_velocity > bf->delta_vmax) {
+            rpt_post_alarm(STAT_REQUESTED_VELOCITY_EXCEEDS_LIMITS, "velocity hint starved"); // it can't stop in its length
+        }
+        bf->exit_velocity = 0;
+    }
+#endif
+
+    mp_calculate_trapezoid(bf);
+    mb.trapezoid_count++;
+
+    if (fp_ZERO(bf->cruise_velocity)) { // ++++ Diagnostic - can be removed
+        rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero velocity in mp_finalize_trapezoid");
+        _debug_trap();
+    }
+
+    bf->real_move_time = ((bf->head_length*2)/(bf->entry_velocity + bf->cruise_velocity)) +
+                          (bf->body_length/bf->cruise_velocity) +
+                         ((bf->tail_length*2)/(bf->exit_velocity + bf->cruise_velocity));
+    mp_finalize_queued_time(bf);                    // only if locked ahead of running
 }
 
 /***** ALINE HELPERS *****
  * _calculate_move_times()
  * _calculate_jerk()
  * _calculate_junction_vmax()
+ * _get_exit_unit()
  * mp_reset_replannable_list()
  */
 
+/*
+ * _coalesce_aline() - merge a feed move into the newest block if it's nearly collinear
+ *
+ *	CAM output often contains long runs of nearly collinear micro-segments. Each one costs a
+ *	planner buffer and a planning pass, and shortens the effective lookahead. If the newest
+ *	block can take the new move, the axis vectors and length passed in are replaced by the
+ *	merged move (from the start of the held block to the new target) and the held block is
+ *	returned for mp_aline() to rebuild. Returns NULL if the move needs its own buffer.
+ *
+ *	A move is merged only if all of these hold:
+ *	  - coalescing is enabled ($ca is the max direction change in degrees, 0 disables)
+ *	  - both are straight feeds in units-per-minute mode and path control is not exact stop
+ *	  - the Gcode state of the move is the same as that of the block apart from the target
+ *	  - the newest block is an aline that has not yet been planned (MP_BUFFER_PLANNING).
+ *	    Such a block can't be running, locked or referenced by any planned block
+ *	  - the direction change is less than $ca
+ *	  - the accumulated chord error is within chordal tolerance ($ct). The error bound is the
+ *	    sum of the distances of each merged vertex from the chord that replaced it
+ *	  - no feedhold is in progress, as hold processing rewrites the planner queue
+ */
+static mpBuf_t *_coalesce_aline(const GCodeState_t *gm_in, float axis_length[], float axis_square[], float *length)
+{
+    if ((cm.coalesce_angle <= 0) || (cm.hold_state != FEEDHOLD_OFF) ||
+        (gm_in->motion_mode != MOTION_MODE_STRAIGHT_FEED) ||
+        (gm_in->feed_rate_mode == INVERSE_TIME_MODE) ||
+        (gm_in->path_control == PATH_EXACT_STOP)) {
+        return (NULL);
+    }
+    mpBuf_t *bf = mb.q->pv;                     // newest committed block
+    if ((bf->buffer_state != MP_BUFFER_PLANNING) || (bf->move_type != MOVE_TYPE_ALINE) ||
+        (bf->raster != RASTER_NONE) || _carries_outputs(bf) || (!mp_buffer_gcode_state_matches(bf, gm_in))) {
+        return (NULL);
+    }
+
+    // test the direction change
+    float cos_theta = 0;
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+        cos_theta += bf->unit[axis] * axis_length[axis];
+    }
+    if ((cos_theta / *length) < cos(cm.coalesce_angle / RADIAN)) {
+        return (NULL);
+    }
+
+    // test the chord error - distance of the joining vertex from the merged chord
+    float merged_length[AXES];
+    float merged_square[AXES];
+    float length_square = 0;
+    float projection = 0;                       // held block's vector dotted with the merged vector
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+        float held_length = bf->unit[axis] * bf->length;
+        merged_length[axis] = held_length + axis_length[axis];
+        merged_square[axis] = square(merged_length[axis]);
+        length_square += merged_square[axis];
+        projection += held_length * merged_length[axis];
+    }
+    float merged = sqrt(length_square);
+    float deviation = square(bf->length) - square(projection / merged);
+    float chord_error = bf->coalesce_error + ((deviation > 0) ? sqrt(deviation) : 0);
+    if (chord_error > cm.chordal_tolerance) {
+        return (NULL);
+    }
+
+    bf->coalesce_error = chord_error;
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {   // NB: copy_vector() needs sizeof() of a real array
+        axis_length[axis] = merged_length[axis];
+        axis_square[axis] = merged_square[axis];
+    }
+    *length = merged;
+    return (bf);
+}
+
+/*
+ * _blend_corner() - round off the corner between the newest block and a feed move (G64 P)
+ *
+ *	In continuous mode every vertex is passed through at the junction velocity, which for a
+ *	sharp corner is close to a stop. With a G64 P tolerance the corner is instead cut by an
+ *	arc tangent to both moves that passes no further than P from the vertex. The newest
+ *	block is shortened to end where the arc starts, the arc is queued as a MOVE_TYPE_ARC
+ *	block (see mp_arc()), and the axis vectors and length passed in are replaced by what's
+ *	left of the new move, from the end of the arc to its target. Tangent junctions on both
+ *	ends of the arc don't limit the velocity, so the corner is taken at the arc's jerk
+ *	limited velocity - see mp_get_arc_velocity_max().
+ *
+ *	For a direction change theta the arc for tolerance P has
+ *
+ *	    Radius = P * cos(theta/2) / (1 - cos(theta/2))
+ *	    Tangent distance (vertex to each end of the arc) = Radius * tan(theta/2)
+ *
+ *	The tangent distance is held to under half of the new move and most of what is left of
+ *	the newest block, so consecutive corners never overlap and both lines keep a piece.
+ *	The radius is reduced to match, which only brings the arc closer to the vertex.
+ *
+ *	A corner is blended only if all of these hold:
+ *	  - a G64 P tolerance is set, no feedhold is in progress and a machining cycle is running
+ *	  - the move is a straight feed in units-per-minute mode with the same Gcode state as
+ *	    the newest block, which is an aline. See the same tests in _coalesce_aline()
+ *	  - the newest block is not yet planned, or it's planned (to stop at its end) but its
+ *	    trapezoid is still pending and the exec hasn't locked it. It's taken back out of the
+ *	    queue, and only if it can still stop from its planned entry once shortened
+ *	  - both moves lie in the selected plane (G17, G18, G19). Other corners pass the vertex
+ *	  - the arc would be faster than the vertex's junction velocity, and there's a spare
+ *	    buffer for it
+ */
+static void _blend_corner(const GCodeState_t *gm_in, float axis_length[], float axis_square[], float *length)
+{
+    if ((cm.gmx.path_tolerance <= 0) || (cm.hold_state != FEEDHOLD_OFF) ||
+        (cm.cycle_state != CYCLE_MACHINING) ||
+        (gm_in->motion_mode != MOTION_MODE_STRAIGHT_FEED) ||
+        (gm_in->feed_rate_mode == INVERSE_TIME_MODE) ||
+        (gm_in->path_control != PATH_CONTINUOUS) ||
+        (mp_get_planner_buffers_available() < 2)) {
+        return;
+    }
+    mpBuf_t *bf = mb.q->pv;                     // newest committed block
+    if (((bf->buffer_state != MP_BUFFER_PLANNING) && (bf->buffer_state != MP_BUFFER_QUEUED)) ||
+        (bf->move_type != MOVE_TYPE_ALINE) || (bf->raster != RASTER_NONE) || _carries_outputs(bf) ||
+        (!mp_buffer_gcode_state_matches(bf, gm_in))) {
+        return;
+    }
+
+    // both moves must lie in the arc plane
+    uint8_t axis_0 = (gm_in->select_plane == CANON_PLANE_YZ) ? AXIS_Y : AXIS_X;
+    uint8_t axis_1 = (gm_in->select_plane == CANON_PLANE_XY) ? AXIS_Y : AXIS_Z;
+    float unit[AXES];
+    float dot = 0;
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+        unit[axis] = axis_length[axis] / *length;
+        if ((axis != axis_0) && (axis != axis_1) &&
+            ((fabs(unit[axis]) > EPSILON) || (fabs(bf->unit[axis]) > EPSILON))) {
+            return;
+        }
+        dot += bf->unit[axis] * unit[axis];
+    }
+
+    // size the arc for the tolerance, then hold it to the lengths of the lines
+    float cos_half = sqrt(max((float)0, (1 + dot) / 2));
+    float sin_half = sqrt(max((float)0, (1 - dot) / 2));
+    if ((cos_half < EPSILON) || (sin_half < EPSILON)) {
+        return;                                 // a reversal or a straight line
+    }
+    float tan_half = sin_half / cos_half;
+    float radius = cm.gmx.path_tolerance * cos_half / (1 - cos_half);
+    float tangent = min(radius * tan_half, min(*length * 0.45f, bf->length * 0.9f));
+    radius = tangent / tan_half;
+    if (radius < MIN_ARC_RADIUS) {
+        return;
+    }
+
+    // only worth a buffer if the arc is faster than the vertex
+    float feed = min(gm_in->feed_rate, bf->cruise_vmax);
+    float arc_vmax = min(feed, mp_get_arc_velocity_max(radius, axis_0, axis_1));
+    if (arc_vmax <= _calculate_junction_vmax(feed, bf->unit, unit)) {
+        return;
+    }
+
+    // take a planned block back for replanning - the blocks behind it may not follow
+    if (bf->buffer_state == MP_BUFFER_QUEUED) {
+        if (mp_get_target_velocity(0, bf->length - tangent, bf) < bf->entry_velocity) {
+            return;
+        }
+        bool taken = _begin_block_plan(bf);     // the exec may be locking it
+        if (taken) {
+            taken = bf->trapezoid_pending;
+            if (taken) {
+                mp_unqueue_time(bf);            // it's counted again when it's re-queued
+                bf->buffer_state = MP_BUFFER_PLANNING;
+            }
+            _end_block_plan(bf);
+        }
+        if (!taken) {
+            return;
+        }
+    }
+    bf->replannable = true;
+
+    // shorten the newest block to end at the start of the arc
+    float ratio = (bf->length - tangent) / bf->length;
+    bf->length -= tangent;
+    bf->gm.move_time *= ratio;
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+        bf->gm.target[axis] -= bf->unit[axis] * tangent;
+    }
+    _apply_override(bf, PATH_CONTINUOUS);       // same entry, new lengths and exit
+    copy_vector(mm.position, bf->gm.target);
+
+    // the arc turns clockwise for increasing theta - see _compute_arc() in plan_arc.cpp
+    float turn = 2 * atan2(sin_half, cos_half);
+    float cross = bf->unit[axis_0] * unit[axis_1] - bf->unit[axis_1] * unit[axis_0];
+    float side = (cross > 0) ? 1 : -1;          // +1 turns left (counterclockwise)
+    mpArc_t corner_arc;
+    corner_arc.radius = radius;
+    corner_arc.theta = atan2(side * bf->unit[axis_1], -side * bf->unit[axis_0]);
+    corner_arc.angular_travel = -side * turn;
+    corner_arc.plane_axis_0 = axis_0;
+    corner_arc.plane_axis_1 = axis_1;
+
+    GCodeState_t arc_gm = *gm_in;
+#ifdef __VELOCITY_HINTS
+    arc_gm.exit_hint = 0;                       // the hint is for the end of the line
+#endif
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+        arc_gm.target[axis] = mm.position[axis] + (bf->unit[axis] + unit[axis]) * tangent;
+    }
+    float arc_length = radius * turn;
+    arc_gm.move_time = max(arc_length / gm_in->feed_rate, arc_length / arc_vmax);
+    arc_gm.move_time = max(arc_gm.move_time, arc_length / cm.a[axis_0].feedrate_max);
+    arc_gm.move_time = max(arc_gm.move_time, arc_length / cm.a[axis_1].feedrate_max);
+    arc_gm.minimum_time = arc_gm.move_time;
+    mp_arc(&arc_gm, &corner_arc, arc_length);   // moves the planner position to the end of the arc
+
+    // what's left of the new move starts at the end of the arc
+    float rest = *length - tangent;
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+        axis_length[axis] = unit[axis] * rest;
+        axis_square[axis] = square(axis_length[axis]);
+    }
+    *length = rest;
+}
+
+#ifdef __TANGENTIAL_KNIFE
+/*
+ * _tangent_knife() - turn the tangential axis to follow the XY direction of a feed
+ *
+ *	A tangential knife (or drag axis) is a rotary axis ($tna) held along the direction of
+ *	the cut, in degrees from +X. The host sends plain XY and the angle is worked out here
+ *	from the move, taking the shorter way round from where the axis is now.
+ *
+ *	A turn up to $tnc degrees is folded into the move, so a polyline curve swivels the
+ *	knife as it goes. A sharper turn is made in place first: lift Z by $tnl, turn, and
+ *	plunge back, all as traverses queued ahead of the move. With $tnl at 0 it turns
+ *	without lifting.
+ *
+ *	Only straight feeds in a machining cycle with XY motion are followed. Traverses, arcs,
+ *	probes and homing leave the axis alone, as does a move that turns the axis itself.
+ *	The turn is written into gm_in, so the model position follows it. The three extra
+ *	moves fit in the PLANNER_BUFFER_HEADROOM taken for each line - short of that the turn
+ *	is folded into the move.
+ */
+static void _tangent_knife(GCodeState_t *gm_in)
+{
+	if ((cm.tangent_axis == 0) || (cm.cycle_state != CYCLE_MACHINING) ||
+		(gm_in->motion_mode != MOTION_MODE_STRAIGHT_FEED)) {
+		return;
+	}
+	uint8_t axis = AXIS_Z + cm.tangent_axis;
+	float dx = gm_in->target[AXIS_X] - mm.position[AXIS_X];
+	float dy = gm_in->target[AXIS_Y] - mm.position[AXIS_Y];
+	if ((fp_ZERO(dx) && fp_ZERO(dy)) || fp_NE(gm_in->target[axis], mm.position[axis])) {
+		return;
+	}
+	float turn = atan2(dy, dx) * (180 / M_PI) - mm.position[axis];
+	turn -= 360 * floor((turn + 180) / 360);	// -180 to 180, the shorter way round
+	float angle = mm.position[axis] + turn;
+
+	if ((fabs(turn) > cm.tangent_corner) && (mp_get_planner_buffers_available() >= 4)) {
+		GCodeState_t gm = *gm_in;
+		gm.motion_mode = MOTION_MODE_STRAIGHT_TRAVERSE;
+#ifdef __VELOCITY_HINTS
+		gm.exit_hint = 0;						// the hint is for the end of the line
+#endif
+		copy_vector(gm.target, mm.position);
+		if (cm.tangent_lift > 0) {
+			gm.target[AXIS_Z] += cm.tangent_lift;
+			mp_aline(&gm);
+		}
+		gm.target[axis] = angle;
+		mp_aline(&gm);
+		if (cm.tangent_lift > 0) {
+			gm.target[AXIS_Z] -= cm.tangent_lift;
+			mp_aline(&gm);
+		}
+	}
+	gm_in->target[axis] = angle;
+}
+#endif // __TANGENTIAL_KNIFE
+
 /*
  * _calculate_move_times() - compute optimal and minimum move times into the gcode_state
  *
@@ -373,6 +1218,7 @@ void mp_plan_block_list(mpBuf_t *bf)
  *	  -	G93 inverse time (if G93 is active)
  *	  -	time for coordinated move at requested feed rate
  *	  -	time that the slowest axis would require for the move
+ *	  -	time for X, Y and Z to follow a turn of the table under tool center point control
  *
  *	Sets the following variables in the gcode_state struct
  *	  - move_time is set to optimal time
@@ -436,7 +1282,7 @@ static void _calculate_move_times(GCodeState_t *gms, const float axis_length[],
 			}
 		}
 	}
-	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+	for (uint8_t axis = AXIS_X; axis < AXES_ACTIVE; axis++) {
 		if (gms->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
 			tmp_time = fabs(axis_length[axis]) / cm.a[axis].velocity_max;
 		} else { // MOTION_MODE_STRAIGHT_FEED
@@ -448,6 +1294,18 @@ static void _calculate_move_times(GCodeState_t *gms, const float axis_length[],
 			gms->minimum_time = min(gms->minimum_time, tmp_time);
 		}
 	}
+	max_time = max(max_time, kn_get_step_time(axis_length));	// motors held to STEP_RATE_MAX
+#ifdef __ROTARY_TCP
+	float start[AXES];
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		start[axis] = gms->target[axis] - axis_length[axis];
+	}
+	float tcp_length = kn_get_tcp_length(start, gms->target);		// turning the work swings X, Y and Z
+	for (uint8_t axis = AXIS_X; axis <= AXIS_Z; axis++) {
+		float vmax = (gms->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) ? cm.a[axis].velocity_max : cm.a[axis].feedrate_max;
+		max_time = max(max_time, tcp_length / vmax);
+	}
+#endif
 	gms->move_time = max4(inv_time, max_time, xyz_time, abc_time);
 }
 
@@ -461,28 +1319,28 @@ static void _calculate_move_times(GCodeState_t *gms, const float axis_length[],
 
 */
 
-static void _calculate_jerk(mpBuf_t *bf)
+static void _calculate_jerk(mpBuf_t *bf, const float unit[])
 {
     // compute the jerk as the largest jerk that still meets axis constraints
     bf->jerk = 8675309;                                     // a ridiculously large number
     float jerk=0;
 
-    for (uint8_t axis=0; axis<AXES; axis++) {
-        if (fabs(bf->unit[axis]) > 0) {                     // if this axis is participating in the move
-            jerk = cm.a[axis].jerk_max / fabs(bf->unit[axis]);
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+        if (fabs(unit[axis]) > 0) {                         // if this axis is participating in the move
+            jerk = cm.a[axis].jerk_max / fabs(unit[axis]);
             if (jerk < bf->jerk) {
                 bf->jerk = jerk;
 //              bf->jerk_axis = axis;                     // +++ diagnostic
             }
         }
     }
-    bf->jerk *= JERK_MULTIPLIER;                            // goose it!
+    bf->jerk *= JERK_MULTIPLIER * PROFILE_JERK_FACTOR;      // goose it! (and scale for the motion profile)
 
     // set up and pre-compute the jerk terms needed for this round of planning
     if (fabs(bf->jerk - mm.jerk) > JERK_MATCH_TOLERANCE) {  // specialized comparison for tolerance of delta
         mm.jerk = bf->jerk;
         mm.recip_jerk = 1/bf->jerk;                         // compute cached jerk terms used by planning
-        mm.cbrt_jerk = cbrt(bf->jerk);
+        mm.cbrt_jerk = fast_cbrt(bf->jerk);
     }
     bf->recip_jerk = mm.recip_jerk;
     bf->cbrt_jerk = mm.cbrt_jerk;
@@ -539,25 +1397,401 @@ static void _calculate_jerk(mpBuf_t *bf)
  *  In formula 4 the jerk is multiplied by 1,000,000 and JA is divided by 1,000,000,
  *  so those terms cancel out.
  */
+/* Note 2:
+ *  Jerk * Time is constant per axis, so it's cached as cm.a[axis].junction_jerk and
+ *  refreshed by cm_set_jm() and cm_set_ja(). Division is expensive on this part, so the
+ *  product velocity * delta is tested first and (4) is only evaluated for axes that
+ *  actually lower the velocity.
+ */
+/* Note 3: Corner deviation
+ *  Each axis that changes direction can also hold the corner to its junction deviation
+ *  {xjd:...}, so an axis can be made to corner gentler (or harder) than its jerk and JA
+ *  alone would have it. The corner is taken as an arc tangent to both moves that passes
+ *  JD from the vertex. With phi the angle at the vertex (180 degrees for a straight line):
+ *
+ *      sin(phi/2) = sqrt((1 + a_unit . b_unit) / 2)               (5)
+ *      Radius[i] = JD[i] * sin(phi/2) / (1 - sin(phi/2))          (6)
+ *
+ *  and the arc is run at its jerk limited velocity, as mp_get_arc_velocity_max() does:
+ *
+ *      Velocity[i] = cbrt(Jm[i] * Radius[i]^2)                    (7)
+ *
+ *  As only Jm * JD^2 differs from axis to axis the smallest one is found first (cached
+ *  as cm.a[axis].junction_dev_jerk) and (7) is evaluated once. A JD of zero turns the
+ *  limit off for that axis. Axes that don't change direction don't limit the corner, so
+ *  a weak Z axis only slows the corners it takes part in.
+ */
 
 static float _calculate_junction_vmax(const float vmax, const float a_unit[], const float b_unit[])
 {
     float velocity = vmax;    // start with our maximum cornering velocity
+    float dev_jerk = 0;       // least Jm * JD^2 of the axes that change direction, 0=none
+    float dot = 0;
 
-    for (uint8_t axis=0; axis<AXES; axis++) {
+    for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
         float delta = fabs(b_unit[axis] - a_unit[axis]); // formula (1)
+        dot += a_unit[axis] * b_unit[axis];
 
         // Corner case: If an axis has zero delta, we might have a straight line.
         // Corner case: An axis doesn't change (and it's not a straight line).
         //   In either case, division-by-zero is bad, m'kay?
         if (delta > EPSILON) {
-             // formula (4): (See Note 1, above)
-            velocity = min(velocity, (cm.a[axis].jerk_max * cm.junction_aggression / delta));
+            if ((velocity * delta) > cm.a[axis].junction_jerk) {
+                // formula (4): (See Notes 1 and 2, above)
+                velocity = cm.a[axis].junction_jerk / delta;
+            }
+            float axis_dev_jerk = cm.a[axis].junction_dev_jerk;
+            if ((axis_dev_jerk > 0) && (fp_ZERO(dev_jerk) || (axis_dev_jerk < dev_jerk))) {
+                dev_jerk = axis_dev_jerk;
+            }
+        }
+    }
+    if (dev_jerk > 0) {                                  // formulas (5) - (7): (See Note 3, above)
+        float sin_half = fast_sqrt((1 + dot) / 2);
+        if (sin_half < 1 - EPSILON) {
+            float radius_per_jd = sin_half / (1 - sin_half);
+            float corner_velocity = fast_cbrt(dev_jerk * square(radius_per_jd));
+            velocity = min(velocity, corner_velocity);
         }
     }
     return(velocity);
 }
 
+/*
+ * mp_get_arc_velocity_max() - centripetal velocity limit of an arc
+ *
+ *	There is no acceleration setting, so the limit is derived from jerk. At a constant
+ *	speed v on radius r the centripetal acceleration is a = v^2/r, and it turns with the
+ *	path at v/r - a jerk of v^3/r^2 in the plane axes. Holding that to the lower of the
+ *	plane axes' Jm gives v = sqrt(a * r) with a = cbrt(Jm^2 * r), i.e. v = cbrt(Jm * r^2).
+ *	Arcs held to it run at a steady, jerk limited speed instead of being slowed corner by
+ *	corner. Returns mm/min.
+ *
+ *	The arc turns through every direction in its plane, so it is also held to the step rate of
+ *	the plane's motors along the plane axes and the two diagonals - the worst case for both the
+ *	Cartesian and CoreXY models (see kn_get_step_time()).
+ */
+
+float mp_get_arc_velocity_max(const float radius, const uint8_t axis_0, const uint8_t axis_1)
+{
+    float jerk = min(cm.a[axis_0].jerk_max, cm.a[axis_1].jerk_max) * JERK_MULTIPLIER;
+    float velocity = fast_cbrt(jerk * square(radius));
+
+    float direction[AXES] = {0};
+    float step_time;
+    direction[axis_0] = 1;
+    step_time = kn_get_step_time(direction);
+    direction[axis_0] = 0;
+    direction[axis_1] = 1;
+    step_time = max(step_time, kn_get_step_time(direction));
+    direction[axis_0] = M_SQRT1_2;
+    direction[axis_1] = M_SQRT1_2;
+    step_time = max(step_time, kn_get_step_time(direction));
+    direction[axis_1] = -M_SQRT1_2;
+    step_time = max(step_time, kn_get_step_time(direction));
+    if (step_time > 0) {
+        velocity = min(velocity, 1/step_time);
+    }
+    return (velocity);
+}
+
+/*
+ * mp_get_arc_segment_angle() - largest angle a straight segment of an arc may subtend
+ *
+ *	The chord of a segment subtending angle a deviates r*(1-cos(a/2)) from the arc, so holding
+ *	that to the chordal tolerance ($ct) gives a = 2*acos(1-ct/r). It depends only on the radius,
+ *	so large radius arcs and helices get no more segments than the tolerance requires. Used to
+ *	segment arcs run as lines (plan_arc.cpp) and arc blocks in the exec (plan_exec.cpp).
+ */
+
+float mp_get_arc_segment_angle(const float radius)
+{
+    float cos_half_angle = 1 - cm.chordal_tolerance / radius;
+    return ((cos_half_angle > -1) ? 2 * acos(cos_half_angle) : M_PI);
+}
+
+/*
+ * _get_exit_unit() - direction a block ends in, for the junction with the next block
+ *
+ *	Pass-through commands don't stop motion, so the junction is with the move before them.
+ */
+
+static const float *_get_exit_unit(const mpBuf_t *bf)
+{
+    for (uint8_t i=0; (i < PLANNER_BUFFER_POOL_SIZE) && bf->pass_through; i++) {
+        bf = bf->pv;
+    }
+    if (bf->move_type == MOVE_TYPE_ARC) {
+        return (bf->arc.exit_unit);
+    }
+    return ((bf->move_type == MOVE_TYPE_SPLINE) ? bf->spline.exit_unit : bf->unit);
+}
+
+/*
+ * _get_axis_vmax() - fastest the move may run given the axis velocity limits
+ */
+static float _get_axis_vmax(const mpBuf_t *bf)
+{
+	float vmax = 8675309;                                   // a ridiculously large number
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		if (fabs(bf->unit[axis]) > EPSILON) {
+			float axis_vmax = (bf->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) ?
+							  cm.a[axis].velocity_max : cm.a[axis].feedrate_max;
+			vmax = min(vmax, axis_vmax / fabs(bf->unit[axis]));
+		}
+	}
+	float step_time = kn_get_step_time(bf->unit);            // minutes per mm at STEP_RATE_MAX
+	if (step_time > 0) {
+		vmax = min(vmax, 1/step_time);
+	}
+	return (max(vmax, bf->feed_vmax));                      // never slower than the move time allows
+}
+
+/*
+ * _apply_override() - set the planning velocities and jerk of a block for the current override
+ *
+ *	The exec runs the plan with its time base scaled by the override factor (see
+ *	_get_override_time() in plan_exec.cpp), so a velocity v is run at v * factor, an
+ *	acceleration at a * factor^2 and a jerk at j * factor^3. Below 100% that is all within
+ *	the limits. Above it the block is planned at the requested feed but no faster than the
+ *	axis limits allow once scaled, with the jerk and junction velocity scaled down to match.
+ */
+static void _apply_override(mpBuf_t *bf, const uint8_t path_control)
+{
+	bf->override_factor = cm_get_override_factor(bf->gm.motion_mode);
+	float factor = max(1.0f, bf->override_factor);
+	float jerk = bf->jerk_nominal / (factor * factor * factor);
+
+	if (fp_NE(bf->jerk, jerk)) {                            // new blocks at <= 100% keep the cached terms
+		bf->jerk = jerk;
+		bf->recip_jerk = 1/jerk;
+		bf->cbrt_jerk = fast_cbrt(jerk);
+	}
+
+	bf->cruise_vmax = min(bf->feed_vmax, bf->limit_vmax / factor);
+	bf->delta_vmax = mp_get_target_velocity(0, bf->length, bf);
+	bf->braking_velocity = bf->delta_vmax + _get_exit_hint(bf);
+
+	if (path_control == PATH_EXACT_STOP) {
+		bf->entry_vmax = 0;
+		bf->exit_vmax = 0;
+	} else {
+		bf->entry_vmax = _calculate_junction_vmax(bf->cruise_vmax * factor, _get_exit_unit(bf->pv), bf->unit) / factor;
+		bf->exit_vmax = min(bf->cruise_vmax, (bf->entry_vmax + bf->delta_vmax));
+	}
+	if (bf->aux_stop) {
+		bf->entry_vmax = 0;                                 // it carries a stop command - see mp_queue_stop_command()
+		bf->exit_vmax = min(bf->exit_vmax, bf->delta_vmax);
+	}
+#ifdef __THREADING
+	if (_starts_thread(bf)) {
+		bf->entry_vmax = 0;                                 // the exec waits for the index at the start
+		bf->exit_vmax = min(bf->exit_vmax, bf->delta_vmax);
+	}
+#endif
+}
+
+/*
+ * _get_exit_hint() - the velocity the newest block may be planned to exit at, instead of a stop
+ *
+ *	The lookahead only reaches as far as the queue, so the newest block is planned to stop
+ *	at its end. Where the queue is short in time - dense programs of tiny segments - that
+ *	stop is planned for on every block, and the feed is held to what the queue can stop
+ *	from. A program run through Tools/velocity_hints.py carries the exit velocity a full
+ *	backward pass over the whole program allows for each block, as a (VEX) comment. With
+ *	$vh on, the newest block is planned to that instead. Hints are in planning velocities
+ *	at 100%, so they scale down with an override over 100% like the junctions do.
+ *
+ *	A hint is only as good as the guarantee that the blocks behind it arrive before the
+ *	block runs, and that they are planned with the settings the hints were computed with.
+ *	Use them for jobs run from a file ({"run":...}) or a sender that keeps the queue full.
+ *	A hinted block that is started or locked with nothing planned behind it is planned to
+ *	a stop. If it came in too fast to stop in its length the hint was broken, and the job
+ *	is stopped with an alarm - see mp_finalize_trapezoid(). Only the last block of a line
+ *	carries its hint; segmented arcs, corner arcs and tangent knife turns leave it off.
+ */
+#ifdef __VELOCITY_HINTS
+static float _get_exit_hint(const mpBuf_t *bf)
+{
+	if (!cm.velocity_hints) {
+		return (0);
+	}
+	return (bf->gm.exit_hint / max(1.0f, cm_get_override_factor(bf->gm.motion_mode)));
+}
+#else
+static float _get_exit_hint(const mpBuf_t *bf) { return (0); }
+#endif
+
+#ifdef __THREADING
+/*
+ * _starts_thread() - true if a spindle synchronized move (G33) doesn't follow on from another
+ */
+static bool _starts_thread(const mpBuf_t *bf)
+{
+	if (bf->gm.motion_mode != MOTION_MODE_SPINDLE_SYNC) {
+		return (false);
+	}
+	const mpBuf_t *pv = bf->pv;
+	for (uint8_t i=0; (i < PLANNER_BUFFER_POOL_SIZE) && pv->pass_through; i++) {
+		pv = pv->pv;
+	}
+	return (!mp_move_type_is_planned(pv->move_type) || (pv->gm.motion_mode != MOTION_MODE_SPINDLE_SYNC));
+}
+#endif
+
+/*
+ * _smooth_feed() - level the feed over a run of short blocks
+ *
+ *	Blocks too short to reach their cruise velocity between two junctions accelerate for
+ *	half their length and brake for the other half. A run of them - dense CAM output with
+ *	small direction changes - gives a sawtooth velocity with a head and a tail in every
+ *	block. Once a new block's entry junction is known, both junctions of the block before
+ *	it are. If that block is short its cruise is capped at the fastest junction among the
+ *	last $sw blocks, so the run is taken at a steady velocity instead.
+ *
+ *	The cap is never below either of the block's own junctions, so its entry and exit
+ *	velocities are unchanged and it needs no replanning - its trapezoid is generated with
+ *	the new cruise when it's finalized. Blocks already finalized are left alone. The cap
+ *	comes off again if an override change re-applies the block's limits.
+ */
+static void _smooth_feed(const mpBuf_t *bf)
+{
+	mpBuf_t *bp = bf->pv;
+	if ((cm.smoothing_window < 2) || (bp == bf) || (bp->move_type != MOVE_TYPE_ALINE) ||
+		(bp->buffer_state == MP_BUFFER_EMPTY)) {
+		return;
+	}
+	if ((max(bp->entry_vmax, bf->entry_vmax) + bp->delta_vmax) >= bp->cruise_vmax) {
+		return;                                             // long enough to cruise
+	}
+	float cap = bf->entry_vmax;
+	uint8_t window = min(cm.smoothing_window, (uint8_t)(PLANNER_BUFFER_POOL_SIZE - 2));
+	const mpBuf_t *wp = bp;
+	for (uint8_t i=1; i<window; i++) {                      // bf's entry junction is the first
+		cap = max(cap, wp->entry_vmax);
+		wp = wp->pv;
+		if ((wp == bf) || (wp->move_type != MOVE_TYPE_ALINE) || (wp->buffer_state == MP_BUFFER_EMPTY)) {
+			break;
+		}
+	}
+	if (cap >= bp->cruise_vmax) {
+		return;
+	}
+	if (!_begin_block_plan(bp)) {                           // the exec may be finalizing it
+		return;
+	}
+	if (bp->buffer_state == MP_BUFFER_PLANNING) {           // not planned yet
+		bp->cruise_vmax = cap;
+		bp->exit_vmax = min(bp->exit_vmax, cap);
+	} else if ((bp->buffer_state == MP_BUFFER_QUEUED) && bp->trapezoid_pending) {
+		bp->cruise_vmax = cap;
+		bp->exit_vmax = min(bp->exit_vmax, cap);
+		bp->cruise_velocity = cap;
+		_defer_trapezoid(bp);                               // new time estimate
+	}
+	_end_block_plan(bp);
+}
+
+/*
+ * mp_request_override_replan() - flag the planner to re-apply a changed override
+ * mp_request_reconstrain()     - flag the planner to re-apply changed axis limits as well
+ * mp_replan_overrides()        - re-apply the override to the queued blocks and replan them
+ *
+ *	mp_request_override_replan() may be called from the fast lane. The replan itself is
+ *	run from mp_plan_buffer(). The running block and the blocks the exec has already locked
+ *	keep their plan - the exec's time base ramp carries them to the new factor. Each block is
+ *	claimed with _begin_block_plan() so the exec can't lock or start it while it's taken out.
+ *
+ *	A change to $xjm, $xjd, $xvm, $xfr or $ja would otherwise only reach the blocks queued
+ *	after it. mp_request_reconstrain() has the same pass recompute the jerk and velocity
+ *	limits of the queued blocks first (see _reconstrain_block()), so the new dynamics take
+ *	hold a few blocks into a running job - no flush and no lost position.
+ */
+void mp_request_override_replan()
+{
+	mb.override_replan = true;
+}
+
+void mp_request_reconstrain()
+{
+	mb.reconstrain = true;
+	mb.override_replan = true;
+}
+
+void mp_replan_overrides()
+{
+	bool reconstrain = mb.reconstrain;
+	mb.reconstrain = false;
+
+	mpBuf_t *bf = mb.r;								// from the run buffer on, planned yet or not
+	if (bf->buffer_state == MP_BUFFER_EMPTY) return;
+	mpBuf_t *bp = bf;
+
+	do {
+		if (!mp_move_type_is_planned(bp->move_type)) {
+			continue;
+		}
+		if (!_begin_block_plan(bp)) {
+			continue;                               // running or locked
+		}
+		if (bp->buffer_state == MP_BUFFER_QUEUED) {
+			mp_unqueue_time(bp);                    // it's counted again when it's re-queued
+			bp->buffer_state = MP_BUFFER_PLANNING;
+		}
+		_end_block_plan(bp);
+		if (reconstrain) {
+			_reconstrain_block(bp);
+		}
+		_apply_override(bp, mb.cx[bp->context].path_control);
+		bp->replannable = (mb.cx[bp->context].path_control != PATH_EXACT_STOP);
+	} while (((bp = mp_get_next_buffer(bp)) != bf) && (bp->buffer_state != MP_BUFFER_EMPTY));
+	mp_restart_plan_pass();
+
+	mb.needs_replanned = true;
+	mb.needs_time_accounting = true;
+	mb.force_replan = true;
+}
+
+/*
+ * _reconstrain_block() - recompute the jerk and velocity limits of a queued block from the axis settings
+ *
+ *	Lines get their move time redone from their Gcode state, so a traverse speeds up as well
+ *	as slows down with $xvm. Arcs and splines only take the new jerk - their feed was held to
+ *	a curvature limit worked out from the geometry when they were queued. Their jerk goes by
+ *	the share of the length each axis travels: the full plane travel for both plane axes.
+ */
+static void _reconstrain_block(mpBuf_t *bf)
+{
+	float share[AXES];
+	for (uint8_t axis=0; axis<AXES_ACTIVE; axis++) {
+		share[axis] = fabs(bf->unit[axis]);
+	}
+	if (bf->move_type == MOVE_TYPE_ALINE) {
+		float axis_length[AXES];
+		float axis_square[AXES];
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			axis_length[axis] = (axis < AXES_ACTIVE) ? bf->unit[axis] * bf->length : 0;
+			axis_square[axis] = square(axis_length[axis]);
+		}
+		GCodeState_t gms;									// what _calculate_move_times() reads
+		copy_vector(gms.target, bf->gm.target);
+		gms.feed_rate = bf->gm.feed_rate;
+		gms.motion_mode = bf->gm.motion_mode;
+		gms.feed_rate_mode = (cmFeedRateMode)mb.cx[bf->context].feed_rate_mode;
+		_calculate_move_times(&gms, axis_length, axis_square);
+		bf->gm.move_time = gms.move_time;
+		bf->feed_vmax = bf->length / bf->gm.move_time;
+		bf->limit_vmax = _get_axis_vmax(bf);
+	} else {
+		uint8_t axis_0 = (bf->move_type == MOVE_TYPE_ARC) ? bf->arc.plane_axis_0 : bf->spline.plane_axis_0;
+		uint8_t axis_1 = (bf->move_type == MOVE_TYPE_ARC) ? bf->arc.plane_axis_1 : bf->spline.plane_axis_1;
+		share[axis_0] = sqrt(square(bf->unit[axis_0]) + square(bf->unit[axis_1]));
+		share[axis_1] = share[axis_0];
+	}
+	_calculate_jerk(bf, share);
+	bf->jerk_nominal = bf->jerk;
+}
+
 /*
  *  mp_reset_replannable_list() - resets all blocks in the planning list to be replannable
  */
@@ -569,9 +1803,13 @@ void mp_reset_replannable_list()
     do {
         bp->replannable = true;
         bp->locked = false;
+        if (bp->buffer_state == MP_BUFFER_QUEUED) {
+            mp_unqueue_time(bp);                    // it's counted again when it's re-queued
+        }
         bp->buffer_state = MP_BUFFER_PLANNING;
     } while (((bp = mp_get_next_buffer(bp)) != bf) && (bp->move_state != MOVE_OFF));
 
+    mp_restart_plan_pass();
     mb.needs_replanned = true;
     mb.needs_time_accounting = true;
 }
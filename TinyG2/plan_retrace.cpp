@@ -0,0 +1,309 @@
+/*
+ * plan_retrace.cpp - path history and reverse-along-path recovery from a feedhold
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Reverse-along-path recovery
+ *
+ *	When a plasma arc goes out or a wire EDM shorts the cut has to back up along the path it
+ *	just ran and start over from there. The exec keeps the positions it has run in a ring -
+ *	one each PATH_HISTORY_SPACING of travel, in machine coordinates - so this needs neither
+ *	the host nor the planner.
+ *
+ *	In a feedhold {"rtr":D} backs the machine up D mm along the path at $rtv. The move starts
+ *	and stops at PATH_RETRACE_ACCEL. Another {"rtr":D} backs up further, as far as the history
+ *	goes. A cycle start (~) then runs forward along the same positions to where the hold
+ *	stopped, and the held move carries on from there as it would after any hold. Whatever
+ *	is restarted at the backed-up point (the torch, the generator) is up to the host. A queue
+ *	flush (%) while backed up leaves the machine where it is.
+ *
+ *	The retrace runs its own segments from the exec, ahead of the held move in the planner,
+ *	and leaves the planner, the runtime and the Gcode model as the hold left them. Its
+ *	segments go through the kinematics like any other, so they land on the same steps.
+ *	Positions are dropped whenever the step position is set (homing, G28.3, a queue flush),
+ *	since the path they trace is no longer where the machine is.
+ *
+ * ---> The history and the retrace segments run in the exec interrupt. Starting, going
+ *		forward and abandoning a retrace run from the main loop while the exec is idle.
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "plan_retrace.h"
+#include "kinematics.h"
+#include "stepper.h"
+#include "report.h"
+#include "util.h"
+
+#ifdef __PATH_RETRACE
+
+typedef struct rtSingleton {
+	// path history - written by the exec only
+	float point[PATH_HISTORY_POINTS][AXES];         // positions run, oldest first
+	uint16_t next;                                  // ring index the next position goes to
+	uint16_t count;                                 // positions held, up to PATH_HISTORY_POINTS
+
+	// retrace
+	volatile uint8_t state;                         // mpRetraceState
+	uint16_t points;                                // path positions: 0 is where the hold stopped, then the history newest first
+	float start[AXES];                              // where the hold stopped
+	float distance;                                 // where the machine is along the path, back from the hold
+	float goal;                                     // where this leg of the retrace stops
+	float velocity;                                 // velocity at the end of the last segment (mm/min)
+	float velocity_max;                             // $rtv, held to what the axes on the path allow (mm/min)
+	float accel;                                    // held to what the slowest axis on the path allows (mm/min^2)
+	uint16_t leg;                                   // path leg the machine is on (from position leg to leg+1)
+	float leg_start;                                // distance along the path to the start of the leg
+	float leg_length;
+	float position[AXES];                           // position at the end of the last segment
+	float steps[MOTORS];                            // steps at the end of the last segment
+} rtSingleton_t;
+
+static rtSingleton_t rt;
+static float rt_no_error[MOTORS];                   // following error passed with retrace segments
+
+/*
+ * mp_path_history_reset()	 - drop the path history and any retrace
+ * mp_path_history_segment() - keep the end of a segment if it's far enough along - from the exec
+ */
+
+void mp_path_history_reset()
+{
+	rt.count = 0;
+	rt.state = RETRACE_OFF;
+}
+
+void mp_path_history_segment(const float position[])
+{
+	if (rt.count > 0) {
+		float *last = rt.point[(rt.next - 1) & PATH_HISTORY_MASK];
+		if (get_axis_vector_length(position, last) < PATH_HISTORY_SPACING) {
+			return;
+		}
+	}
+	copy_vector(rt.point[rt.next], position);
+	rt.next = (rt.next + 1) & PATH_HISTORY_MASK;
+	if (rt.count < PATH_HISTORY_POINTS) {
+		rt.count++;
+	}
+}
+
+/*
+ * _path_point()	- path position n: 0 is where the hold stopped, 1 the newest position kept
+ * _leg_length()	- length of path leg n
+ * _path_position() - position a distance back along the path from where the hold stopped
+ */
+
+static float *_path_point(const uint16_t n)
+{
+	if (n == 0) {
+		return (rt.start);
+	}
+	return (rt.point[(rt.next - n) & PATH_HISTORY_MASK]);
+}
+
+static float _leg_length(const uint16_t n)
+{
+	return (get_axis_vector_length(_path_point(n), _path_point(n+1)));
+}
+
+static void _path_position(const float distance, float position[])
+{
+	while ((distance > rt.leg_start + rt.leg_length) && (rt.leg + 2 < rt.points)) {
+		rt.leg_start += rt.leg_length;
+		rt.leg++;
+		rt.leg_length = _leg_length(rt.leg);
+	}
+	while ((distance < rt.leg_start) && (rt.leg > 0)) {
+		rt.leg--;
+		rt.leg_length = _leg_length(rt.leg);
+		rt.leg_start -= rt.leg_length;
+	}
+	float fraction = 1.0;
+	if (rt.leg_length > EPSILON) {
+		fraction = min(max((distance - rt.leg_start) / rt.leg_length, 0.0f), 1.0f);
+	}
+	float *from = _path_point(rt.leg);
+	float *to = _path_point(rt.leg + 1);
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		position[axis] = from[axis] + (to[axis] - from[axis]) * fraction;
+	}
+}
+
+/*
+ * mp_retrace_start()		- back up along the path - in a hold, with the exec idle
+ * mp_retrace_forward()		- return to where the hold stopped - on a cycle start
+ * mp_retrace_abandon()		- leave the runtime where the retrace left the machine - on a queue flush
+ * mp_retrace_is_active()	- true if the machine is not where the hold left it
+ * mp_retrace_is_running()	- true while retrace segments are being run
+ * mp_retrace_get_distance() - distance backed up along the path
+ * mp_retrace_get_position() - where the retrace has the machine, in machine coordinates
+ */
+
+/*
+ * _retrace_limits() - hold the retrace to the limits of the axes on the path held
+ *
+ *	No leg may take an axis over its $xvm, so the velocity is the least any leg allows.
+ *	The ramps are held to the average acceleration of a jerk limited ramp to that
+ *	velocity on the axis with the lowest $xjm that moves, as the planner's would be.
+ */
+
+static void _retrace_limits()
+{
+	float velocity = max(cm.retrace_velocity, PATH_RETRACE_VELOCITY_MIN);
+	float jerk = -1;                                // none yet
+	for (uint16_t n=0; n+1 < rt.points; n++) {
+		float length = _leg_length(n);
+		if (length < EPSILON) {
+			continue;
+		}
+		float *from = _path_point(n);
+		float *to = _path_point(n+1);
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			float share = fabs(to[axis] - from[axis]) / length;
+			if (share < EPSILON) {
+				continue;
+			}
+			velocity = min(velocity, cm.a[axis].velocity_max / share);
+			if ((jerk < 0) || (cm.a[axis].jerk_max < jerk)) {
+				jerk = cm.a[axis].jerk_max;
+			}
+		}
+	}
+	rt.velocity_max = max(velocity, PATH_RETRACE_VELOCITY_MIN);
+	rt.accel = PATH_RETRACE_ACCEL * 3600;           // mm/min^2
+	if (jerk > 0) {
+		rt.accel = min(rt.accel, sqrt(rt.velocity_max * jerk * JERK_MULTIPLIER) / 2);
+	}
+}
+
+static void _retrace_leg(const float goal)
+{
+	rt.goal = goal;
+	rt.velocity = 0;
+	rt.state = (goal > rt.distance) ? RETRACE_REVERSE : RETRACE_FORWARD;
+	st_request_exec_move();
+}
+
+stat_t mp_retrace_start(const float distance)
+{
+	if ((rt.state == RETRACE_REVERSE) || (rt.state == RETRACE_FORWARD)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	if (rt.state == RETRACE_OFF) {                  // first back-up from this hold
+		copy_vector(rt.start, mr.position);
+		copy_vector(rt.position, mr.position);
+		copy_vector(rt.steps, mr.target_steps);
+		rt.points = rt.count + 1;
+		rt.distance = 0;
+		rt.leg = 0;
+		rt.leg_start = 0;
+		rt.leg_length = (rt.points > 1) ? _leg_length(0) : 0;
+		_retrace_limits();
+	}
+	float length = 0;                               // the whole path held
+	for (uint16_t n=0; n+1 < rt.points; n++) {
+		length += _leg_length(n);
+	}
+	float goal = min(rt.distance + distance, length);
+	if (goal - rt.distance < EPSILON) {
+		return (rt.state == RETRACE_OFF) ? STAT_COMMAND_NOT_ACCEPTED : STAT_OK;    // no more history
+	}
+	_retrace_leg(goal);
+	return (STAT_OK);
+}
+
+void mp_retrace_forward()
+{
+	if (rt.state == RETRACE_BACKED) {
+		_retrace_leg(0);
+	}
+}
+
+void mp_retrace_abandon()
+{
+	if (rt.state == RETRACE_BACKED) {
+		for (uint8_t axis=0; axis<AXES; axis++) {  // the flush takes the runtime position as the machine's
+			mp_set_runtime_position(axis, rt.position[axis]);
+		}
+		copy_vector(mr.gm.target, rt.position);
+	}
+	rt.state = RETRACE_OFF;
+}
+
+bool mp_retrace_is_active() { return (rt.state != RETRACE_OFF);}
+
+bool mp_retrace_is_running() { return ((rt.state == RETRACE_REVERSE) || (rt.state == RETRACE_FORWARD));}
+
+float mp_retrace_get_distance() { return ((rt.state == RETRACE_OFF) ? 0 : rt.distance);}
+
+float mp_retrace_get_position(const uint8_t axis) { return (rt.position[axis]);}
+
+/*
+ * mp_retrace_exec() - run the next retrace segment - from mp_exec_move()
+ *
+ *	Velocity ramps up to $rtv and down again to stop on the goal, both held to the axes'
+ *	limits - see _retrace_limits(). The last segment of the forward leg lands on the steps
+ *	the hold stopped on. Status reports go out as it runs, with the retrace position.
+ */
+
+stat_t mp_retrace_exec()
+{
+	float remaining = fabs(rt.goal - rt.distance);
+	float accel = rt.accel;
+	float velocity = rt.velocity_max;
+	float segment_time = NOM_SEGMENT_TIME;
+
+	velocity = min3(velocity, rt.velocity + accel * segment_time, sqrt(2 * accel * remaining));
+	float length = (rt.velocity + velocity) / 2 * segment_time;
+	bool last = (length >= remaining);
+	if (last) {
+		length = remaining;
+		segment_time = max(MIN_SEGMENT_TIME, 2 * remaining / max(rt.velocity + velocity, EPSILON));
+		velocity = 0;
+	}
+	rt.velocity = velocity;
+	rt.distance += (rt.goal > rt.distance) ? length : -length;
+
+	float target_steps[MOTORS];
+	float travel_steps[MOTORS];
+	if (last) {
+		rt.distance = rt.goal;
+	}
+	if (last && (rt.goal < EPSILON)) {
+		copy_vector(rt.position, rt.start);
+		copy_vector(target_steps, mr.target_steps); // back on the steps the hold stopped on
+	} else {
+		_path_position(rt.distance, rt.position);
+		kn_inverse_kinematics(rt.position, target_steps);
+	}
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		travel_steps[motor] = target_steps[motor] - rt.steps[motor];
+	}
+	copy_vector(rt.steps, target_steps);
+	ritorno(st_prep_line(travel_steps, target_steps, rt_no_error, segment_time));
+	if (last) {
+		rt.state = (rt.goal < EPSILON) ? RETRACE_OFF : RETRACE_BACKED;
+		sr_request_status_report(SR_REQUEST_IMMEDIATE);
+	} else {
+		sr_request_status_report(SR_REQUEST_TIMED);
+	}
+	return (STAT_OK);
+}
+
+#endif // __PATH_RETRACE
@@ -0,0 +1,58 @@
+/*
+ * plan_retrace.h - path history and reverse-along-path recovery from a feedhold
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PLAN_RETRACE_H_ONCE
+#define PLAN_RETRACE_H_ONCE
+
+// Built with __PATH_RETRACE - see mp_retrace_start() in plan_retrace.cpp
+
+// The history covers at least PATH_HISTORY_POINTS * PATH_HISTORY_SPACING of the path run last
+#ifndef PATH_HISTORY_POINTS
+#define PATH_HISTORY_POINTS     128                 // positions kept - must be a power of 2
+#endif
+#define PATH_HISTORY_MASK       (PATH_HISTORY_POINTS-1)
+#ifndef PATH_HISTORY_SPACING
+#define PATH_HISTORY_SPACING    ((float)0.5)        // mm the path runs between two positions kept
+#endif
+#ifndef PATH_RETRACE_ACCEL
+#define PATH_RETRACE_ACCEL      ((float)500)        // mm/s^2 the retrace starts and stops with
+#endif
+#define PATH_RETRACE_VELOCITY_MIN ((float)1)        // mm/min
+
+enum mpRetraceState {
+    RETRACE_OFF = 0,                                // not retracing - the machine is where the hold left it
+    RETRACE_REVERSE,                                // backing up along the path
+    RETRACE_BACKED,                                 // stopped back along the path, waiting for a cycle start
+    RETRACE_FORWARD                                 // returning along the path to where the hold left it
+};
+
+/**** function prototypes ****/
+
+void mp_path_history_reset(void);
+void mp_path_history_segment(const float position[]);
+stat_t mp_retrace_start(const float distance);
+void mp_retrace_forward(void);
+void mp_retrace_abandon(void);
+bool mp_retrace_is_active(void);
+bool mp_retrace_is_running(void);
+float mp_retrace_get_distance(void);
+float mp_retrace_get_position(const uint8_t axis);
+stat_t mp_retrace_exec(void);
+
+#endif // End of include guard: PLAN_RETRACE_H_ONCE
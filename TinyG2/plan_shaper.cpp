@@ -0,0 +1,288 @@
+/*
+ * plan_shaper.cpp - input shaping of the segment stream
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Input shaping
+ *
+ *	A shaper convolves the commanded motion with a few impulses spaced over one damped period of
+ *	the resonance it is tuned to, so the vibration each impulse starts is cancelled by the next.
+ *	The motion comes out smoothed and delayed by up to that period, and lands on the same place.
+ *
+ *	It runs on the segment stream, in steps, between the exec and the loader. Every segment's
+ *	commanded step position goes into a short history (the delay line). The position sent to
+ *	st_prep_line() is the sum of the amplitude of each impulse times the commanded position
+ *	that far in the past - interpolated between segment ends, as the loader steps them out. Each
+ *	motor takes the shaper of the axis it is mapped to ($xist, $xisf, $xisd). Unshaped motors
+ *	pass straight through.
+ *
+ *	Once the commanded motion stops, the shaped motion still has up to the longest delay to go.
+ *	The exec runs those settle segments (mp_shaper_exec_settle()) before it runs anything that
+ *	isn't motion - commands, dwells, a finished hold - or when the queue runs dry. The last one
+ *	snaps to the commanded position, so shaping never leaves a position error.
+ *
+ *	Times are in minutes, as segment times are, measured from the last reset and rebased every
+ *	minute to keep their resolution.
+ *
+ * ---> Everything here fires from the exec interrupt, except the configuration functions
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "plan_shaper.h"
+#include "stepper.h"
+#include "encoder.h"
+#include "util.h"
+
+#ifdef __INPUT_SHAPING
+
+typedef struct shImpulses {
+	uint8_t count;                                  // impulses, 0 for a motor that isn't shaped
+	float amplitude[SHAPER_IMPULSES_MAX];           // impulse amplitudes, summing to 1
+	float delay[SHAPER_IMPULSES_MAX];               // impulse delays (minutes) - the first is 0
+} shImpulses_t;
+
+typedef struct shSingleton {
+	shImpulses_t mot[MOTORS];                       // each motor's shaper, from its axis
+	float delay_max;                                // longest delay of any motor (minutes)
+
+	float now;                                      // time at the end of the newest segment
+	float settle_time;                              // time the shaped motion still has to run
+	uint32_t newest;                                // sequence number of the newest segment
+	uint32_t count;                                 // segments in the history (1 - SHAPER_HISTORY)
+	uint32_t cursor[MOTORS][SHAPER_IMPULSES_MAX];   // segment each impulse's delayed time falls in
+
+	float time[SHAPER_HISTORY];                     // end time of each segment in the history...
+	float steps[SHAPER_HISTORY][MOTORS];            // ...and its commanded step positions
+	float shaped[MOTORS];                           // shaped step positions sent to the loader
+} shSingleton_t;
+
+static shSingleton_t sh;
+
+static uint8_t _get_impulses(const cfgAxis_t *a, float amplitude[], float delay[]);
+static float _get_delayed_steps(uint8_t motor, uint8_t impulse);
+static void _reset_cursors(void);
+
+/*
+ * mp_shaper_init()       - clear the shaper - before the config is loaded
+ * mp_shaper_configure()  - build each motor's impulses from its axis settings
+ * mp_shaper_reset()      - restart the history at a step position
+ * mp_shaper_is_configured() - true if any motor is shaped
+ * mp_shaper_is_settling()   - true while the shaped motion trails the commanded motion
+ *
+ *	mp_shaper_configure() is run from kn_update_motor_map() and the $xis* setters, which only
+ *	take a setting with the machine stopped. mp_shaper_reset() is run whenever the step
+ *	position is set - see mp_set_steps_to_runtime_position().
+ */
+
+void mp_shaper_init()
+{
+	memset(&sh, 0, sizeof(sh));
+	sh.count = 1;
+}
+
+void mp_shaper_configure()
+{
+	sh.delay_max = 0;
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		uint8_t axis = st_cfg.mot[motor].motor_map;
+		shImpulses_t *m = &sh.mot[motor];
+		m->count = 0;
+		if ((axis < AXES_ACTIVE) && (cm.a[axis].axis_mode != AXIS_INHIBITED)) {
+			m->count = _get_impulses(&cm.a[axis], m->amplitude, m->delay);
+		}
+		if (m->count != 0) {
+			sh.delay_max = max(sh.delay_max, m->delay[m->count-1]);
+		}
+	}
+	_reset_cursors();
+}
+
+void mp_shaper_reset(const float steps[])
+{
+	sh.now = 0;
+	sh.settle_time = 0;
+	sh.count = 1;
+	sh.time[sh.newest & SHAPER_HISTORY_MASK] = 0;
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		sh.steps[sh.newest & SHAPER_HISTORY_MASK][motor] = steps[motor];
+		sh.shaped[motor] = steps[motor];
+	}
+	_reset_cursors();
+}
+
+bool mp_shaper_is_configured() { return (sh.delay_max > 0); }
+bool mp_shaper_is_settling() { return (sh.settle_time > 0); }
+
+static void _reset_cursors()
+{
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		for (uint8_t i=0; i<SHAPER_IMPULSES_MAX; i++) {
+			sh.cursor[motor][i] = sh.newest - (sh.count-1);     // the oldest segment kept
+		}
+	}
+}
+
+/*
+ * _get_impulses() - impulse amplitudes and delays for an axis's shaper
+ *
+ *	K is the decay of the resonance over half a damped period td. Amplitudes are normalized to
+ *	sum to 1. The EI shaper takes the residual vibration it allows at its frequency for a wider
+ *	notch, so it stays effective when the frequency is not quite right.
+ *	Returns the number of impulses, or 0 if the axis is not shaped.
+ */
+
+static uint8_t _get_impulses(const cfgAxis_t *a, float amplitude[], float delay[])
+{
+	if ((a->shaper_type == SHAPER_NONE) || (a->shaper_frequency < SHAPER_FREQUENCY_MIN)) {
+		return (0);
+	}
+	float df = sqrt(1 - square(a->shaper_damping));
+	float K = exp(-a->shaper_damping * M_PI / df);
+	float td = 1 / (a->shaper_frequency * df) / 60;     // damped period in minutes
+	uint8_t count = 3;
+
+	delay[0] = 0;
+	delay[1] = td / 2;
+	delay[2] = td;
+	switch (a->shaper_type) {
+		case SHAPER_ZV: {
+			amplitude[0] = 1;
+			amplitude[1] = K;
+			count = 2;
+			break;
+		}
+		case SHAPER_ZVD: {
+			amplitude[0] = 1;
+			amplitude[1] = 2 * K;
+			amplitude[2] = K * K;
+			break;
+		}
+		default: {                                      // SHAPER_EI
+			amplitude[0] = 0.25 * (1 + SHAPER_EI_TOLERANCE);
+			amplitude[1] = 0.5 * (1 - SHAPER_EI_TOLERANCE) * K;
+			amplitude[2] = amplitude[0] * K * K;
+		}
+	}
+	float sum = 0;
+	for (uint8_t i=0; i<count; i++) { sum += amplitude[i]; }
+	for (uint8_t i=0; i<count; i++) { amplitude[i] /= sum; }
+	return (count);
+}
+
+/*
+ * mp_shape_segment() - shape a segment on its way to st_prep_line()
+ *
+ *	target_steps[] is the commanded step position at the end of the segment. Returns the shaped
+ *	position in shaped_steps[] and the shaped travel to it in travel_steps[].
+ */
+
+void mp_shape_segment(const float target_steps[], float shaped_steps[], float travel_steps[], float segment_time)
+{
+	const float *last = sh.steps[sh.newest & SHAPER_HISTORY_MASK];
+	bool moved = false;
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		if (fp_NE(target_steps[motor], last[motor])) {
+			moved = true;
+		}
+	}
+	sh.now += segment_time;
+	if (sh.now >= 1) {                                  // rebase the clock once a minute
+		sh.now -= 1;
+		for (uint8_t i=0; i<SHAPER_HISTORY; i++) { sh.time[i] -= 1; }
+	}
+	sh.newest++;
+	if (sh.count < SHAPER_HISTORY) {
+		sh.count++;
+	}
+	uint8_t slot = sh.newest & SHAPER_HISTORY_MASK;
+	sh.time[slot] = sh.now;
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		sh.steps[slot][motor] = target_steps[motor];
+	}
+	if (moved) {
+		sh.settle_time = sh.delay_max;                  // the shaped motion runs this much longer
+	} else {
+		sh.settle_time -= segment_time;
+	}
+
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		const shImpulses_t *m = &sh.mot[motor];
+		float shaped = target_steps[motor];
+		if ((m->count != 0) && (sh.settle_time > 0)) {  // once settled it is exactly the target
+			shaped *= m->amplitude[0];
+			for (uint8_t i=1; i<m->count; i++) {
+				shaped += m->amplitude[i] * _get_delayed_steps(motor, i);
+			}
+		}
+		shaped_steps[motor] = shaped;
+		travel_steps[motor] = shaped - sh.shaped[motor];
+		sh.shaped[motor] = shaped;
+	}
+}
+
+/*
+ * _get_delayed_steps() - commanded position of a motor an impulse's delay ago
+ *
+ *	The delayed time only ever moves forward, so each impulse keeps a cursor on the segment it
+ *	falls in and usually moves it one segment per call. Before the oldest segment kept the
+ *	position is the oldest one - at rest after a reset, or clipped if segments are too short.
+ */
+
+static float _get_delayed_steps(uint8_t motor, uint8_t impulse)
+{
+	float when = sh.now - sh.mot[motor].delay[impulse];
+	uint32_t oldest = sh.newest - (sh.count-1);
+	uint32_t *cursor = &sh.cursor[motor][impulse];
+
+	if ((sh.newest - *cursor) >= sh.count) {            // fell out of the history - wrap safe
+		*cursor = oldest;
+	}
+	while ((*cursor != sh.newest) && (sh.time[*cursor & SHAPER_HISTORY_MASK] < when)) {
+		(*cursor)++;
+	}
+	uint8_t slot = *cursor & SHAPER_HISTORY_MASK;
+	if (*cursor == oldest) {
+		return (sh.steps[slot][motor]);
+	}
+	uint8_t prev = (*cursor - 1) & SHAPER_HISTORY_MASK;
+	float fraction = (when - sh.time[prev]) / (sh.time[slot] - sh.time[prev]);
+	return (sh.steps[prev][motor] + fraction * (sh.steps[slot][motor] - sh.steps[prev][motor]));
+}
+
+/*
+ * mp_shaper_exec_settle() - run a segment of the shaped motion after the commanded motion stops
+ *
+ *	The commanded position holds at the last target while the shaped position catches up to
+ *	it. Called by the exec in place of the next move - see mp_exec_move().
+ */
+
+stat_t mp_shaper_exec_settle()
+{
+	float shaped_steps[MOTORS];
+	float travel_steps[MOTORS];
+
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		en_read_encoder_alignment(motor, &mr.encoder_steps[motor], &mr.commanded_steps[motor]);
+		mr.following_error[motor] = mr.encoder_steps[motor] - mr.commanded_steps[motor];
+	}
+	mp_shape_segment(mr.target_steps, shaped_steps, travel_steps, NOM_SEGMENT_TIME);
+	return (st_prep_line(travel_steps, shaped_steps, mr.following_error, NOM_SEGMENT_TIME));
+}
+
+#endif // __INPUT_SHAPING
@@ -0,0 +1,54 @@
+/*
+ * plan_shaper.h - input shaping of the segment stream
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PLAN_SHAPER_H_ONCE
+#define PLAN_SHAPER_H_ONCE
+
+// Built with __INPUT_SHAPING - see mp_shape_segment() in plan_shaper.cpp
+
+#define SHAPER_IMPULSES_MAX     3                   // ZVD and EI are 3 impulse shapers
+#define SHAPER_EI_TOLERANCE     ((float)0.05)       // residual vibration the EI shaper allows at its frequency
+
+// The history must span the longest shaper - one damped period at the lowest frequency and
+// highest damping - at the shortest segment time: 1/(15Hz * sqrt(1-0.5^2)) = 77ms < 128 * 750us
+#define SHAPER_HISTORY          128                 // commanded positions kept - must be a power of 2
+#define SHAPER_HISTORY_MASK     (SHAPER_HISTORY-1)
+#define SHAPER_FREQUENCY_MIN    ((float)15)         // Hz
+#define SHAPER_FREQUENCY_MAX    ((float)500)        // Hz
+#define SHAPER_DAMPING_MAX      ((float)0.5)        // damping ratio
+
+enum shShaperType {                                 // axis shaper type ($xist)
+    SHAPER_NONE = 0,                                // axis is not shaped
+    SHAPER_ZV,                                      // zero vibration - 2 impulses, shortest delay
+    SHAPER_ZVD,                                     // zero vibration and derivative - 3 impulses
+    SHAPER_EI,                                      // extra insensitive - 3 impulses, widest notch
+    SHAPER_TYPE_MAX
+};
+
+/**** function prototypes ****/
+
+void mp_shaper_init(void);
+void mp_shaper_configure(void);
+void mp_shaper_reset(const float steps[]);
+bool mp_shaper_is_configured(void);
+bool mp_shaper_is_settling(void);
+void mp_shape_segment(const float target_steps[], float shaped_steps[], float travel_steps[], float segment_time);
+stat_t mp_shaper_exec_settle(void);
+
+#endif // End of include guard: PLAN_SHAPER_H_ONCE
@@ -0,0 +1,182 @@
+/*
+ * plan_stats.cpp - achieved vs requested feed statistics
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Planner statistics
+ *
+ *	The planner asks each block for its requested feed (cruise_vmax) and plans the velocity it
+ *	gets (cruise_velocity). These statistics collect the two as the exec starts each block, so a
+ *	job can be looked at for what is holding it back - cornering, short moves, lookahead or the
+ *	machine's limits.
+ *
+ *	For each line, arc and spline block the ratio of achieved to requested feed goes into a
+ *	10 bin histogram (bin 9 is 0.9 up to and including 1.0) and into a mean weighted by length.
+ *	The requested feed is the F word - or the time an inverse time block was given, or the
+ *	axis velocity max for a traverse - before the feed and traverse overrides, and the achieved
+ *	is the planned cruise, so the ratio is what the plan makes of the program as written.
+ *
+ *	A block more than 1% under its requested feed is put down to one cause:
+ *
+ *	  brake		never reached cruise, and left slower than its exit junction allows - it
+ *				was braking for a stop or a slower block further on, or the queue ran dry
+ *				behind it. Lookahead (queue depth).
+ *	  junc		never reached cruise, and got no more than 10% over its faster junction - the
+ *				corners at either end held it. Also arcs and splines held to their curvature.
+ *	  short		never reached cruise, but sped up well past its junctions - too short for the
+ *				jerk to get it there. Also short blocks capped by feed smoothing ($sw).
+ *	  step		requested feed is over STEP_RATE_MAX for the motors it moves
+ *	  axis		requested feed is over the axis velocity or feed rate max ($xvm, $xfr)
+ *
+ *	"nocruise" counts the blocks that never reached their cruise_vmax, whatever held it.
+ *	A block restarted after a feedhold is only counted the first time.
+ *
+ * ---> mp_stats_block() fires from the exec interrupt. The counters are read from the main
+ *		loop without locking, so a report taken while running may be one block out.
+ */
+
+#include "tinyg2.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "plan_stats.h"
+#include "kinematics.h"
+#include "util.h"
+
+#ifdef __PLANNER_STATS
+
+typedef struct psSingleton {
+	const mpBuf_t *last;                            // last block counted - not counted again on a restart
+	uint32_t blocks;                                // blocks counted
+	uint32_t hist[PSTAT_BINS];                      // blocks by achieved / requested feed
+	uint32_t no_cruise;                             // blocks that never reached cruise_vmax
+	uint32_t cause[PSTAT_CAUSES];                   // blocks held below requested feed, by cause
+	float length;                                   // total length counted (mm)
+	float weighted;                                 // sum of length * ratio
+} psSingleton_t;
+
+static psSingleton_t ps;
+
+/*
+ * _requested_feed() - the feed the program asked of a block, mm/min, before overrides
+ */
+static float _requested_feed(const mpBuf_t *bf)
+{
+	if (bf->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+		return (bf->feed_vmax);                     // as fast as the axes go
+	}
+	if (mr.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+		return (bf->length / bf->gm.feed_rate);     // feed_rate is the move time in minutes
+	}
+	return (bf->gm.feed_rate);
+}
+
+/*
+ * _cause() - what held a block below its requested feed
+ */
+static uint8_t _cause(const mpBuf_t *bf)
+{
+	if (bf->cruise_velocity < bf->cruise_vmax * PSTAT_TOLERANCE) {      // never reached cruise
+		float exit_junction = 0;                    // a stop, unless a move follows
+		const mpBuf_t *nx = bf->nx;
+		if ((nx->buffer_state != MP_BUFFER_EMPTY) && mp_move_type_is_planned(nx->move_type)) {
+			exit_junction = min(bf->exit_vmax, nx->entry_vmax);
+		}
+		if (bf->exit_velocity < exit_junction * PSTAT_TOLERANCE) {
+			return (PSTAT_BRAKING);
+		}
+		if (bf->cruise_velocity < max(bf->entry_velocity, bf->exit_velocity) * PSTAT_JUNCTION_MARGIN) {
+			return (PSTAT_JUNCTION);
+		}
+		return (PSTAT_SHORT);
+	}
+	if (bf->cruise_vmax < bf->feed_vmax * PSTAT_TOLERANCE) {            // capped below its own feed
+		float factor = max(1.0f, cm_get_override_factor(bf->gm.motion_mode));
+		if (bf->cruise_vmax >= (bf->limit_vmax / factor) * PSTAT_TOLERANCE) {
+			return (PSTAT_AXIS);                    // an override over 100% held to the axis limits
+		}
+		return (PSTAT_SHORT);                       // feed smoothing
+	}
+	if (bf->move_type != MOVE_TYPE_ALINE) {
+		return (PSTAT_JUNCTION);                    // arc or spline curvature
+	}
+	float step_time = kn_get_step_time(bf->unit);   // minutes per mm at STEP_RATE_MAX
+	if ((step_time > 0) && (1/step_time <= bf->feed_vmax / PSTAT_TOLERANCE)) {
+		return (PSTAT_STEP_RATE);
+	}
+	return (PSTAT_AXIS);
+}
+
+/*
+ * mp_stats_block() - count a block as the exec starts it
+ */
+void mp_stats_block(const mpBuf_t *bf)
+{
+	if ((bf == ps.last) || !mp_move_type_is_planned(bf->move_type)) {
+		return;
+	}
+	ps.last = bf;
+	float requested = _requested_feed(bf);
+	if (requested < EPSILON) {
+		return;
+	}
+	float ratio = min(1.0f, bf->cruise_velocity / requested);
+	uint8_t bin = min((uint8_t)(ratio * PSTAT_BINS), (uint8_t)(PSTAT_BINS-1));
+
+	ps.blocks++;
+	ps.hist[bin]++;
+	ps.length += bf->length;
+	ps.weighted += bf->length * ratio;
+	if (bf->cruise_velocity < bf->cruise_vmax * PSTAT_TOLERANCE) {
+		ps.no_cruise++;
+	}
+	if (ratio < PSTAT_TOLERANCE) {
+		ps.cause[_cause(bf)]++;
+	}
+}
+
+/*
+ * mp_get_stats() - print the statistics:
+ *
+ *	{"pstat":{"blocks":n,"ratio":r,"hist":[...],"nocruise":n,"junc":n,"short":n,"brake":n,"step":n,"axis":n}}
+ *
+ *	ratio is the length-weighted mean of achieved / requested feed.
+ *
+ * mp_set_stats() - clear the statistics (any value)
+ */
+stat_t mp_get_stats(nvObj_t *nv)
+{
+	printf_P(PSTR("{\"pstat\":{\"blocks\":%lu,\"ratio\":%0.3f,\"hist\":["), (unsigned long)ps.blocks,
+		(double)((ps.length > 0) ? ps.weighted / ps.length : 0));
+	for (uint8_t b=0; b<PSTAT_BINS; b++) {
+		printf_P(PSTR("%s%lu"), (b == 0) ? "" : ",", (unsigned long)ps.hist[b]);
+	}
+	printf_P(PSTR("],\"nocruise\":%lu,\"junc\":%lu,\"short\":%lu,\"brake\":%lu,\"step\":%lu,\"axis\":%lu}}\n"),
+		(unsigned long)ps.no_cruise, (unsigned long)ps.cause[PSTAT_JUNCTION], (unsigned long)ps.cause[PSTAT_SHORT],
+		(unsigned long)ps.cause[PSTAT_BRAKING], (unsigned long)ps.cause[PSTAT_STEP_RATE], (unsigned long)ps.cause[PSTAT_AXIS]);
+	nv->value = ps.blocks;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t mp_set_stats(nvObj_t *nv)
+{
+	memset(&ps, 0, sizeof(ps));
+	nv->valuetype = TYPE_NULL;
+	return (STAT_OK);
+}
+
+#endif // __PLANNER_STATS
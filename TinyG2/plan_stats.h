@@ -0,0 +1,42 @@
+/*
+ * plan_stats.h - achieved vs requested feed statistics
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PLAN_STATS_H_ONCE
+#define PLAN_STATS_H_ONCE
+
+// Built with __PLANNER_STATS - see mp_stats_block() in plan_stats.cpp
+
+#define PSTAT_BINS          10                      // ratio histogram bins, 0.1 wide
+#define PSTAT_TOLERANCE     ((float)0.99)           // a velocity within 1% of its limit reached it
+#define PSTAT_JUNCTION_MARGIN ((float)1.10)         // a block no faster than this over its junctions is held by them
+
+enum psCause {                                      // what held a block below its requested feed
+	PSTAT_JUNCTION = 0,                             // entry or exit junction vmax (or the arc's curvature)
+	PSTAT_SHORT,                                    // too short to reach cruise between its junctions
+	PSTAT_BRAKING,                                  // exit held down to stop within the planned queue
+	PSTAT_STEP_RATE,                                // motors held to STEP_RATE_MAX
+	PSTAT_AXIS,                                     // axis velocity or feed rate max
+	PSTAT_CAUSES
+};
+
+void mp_stats_block(const mpBuf_t *bf);
+stat_t mp_get_stats(nvObj_t *nv);
+stat_t mp_set_stats(nvObj_t *nv);
+
+#endif // End of include guard: PLAN_STATS_H_ONCE
@@ -151,7 +151,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
     if (fp_ZERO(bf->length)) {
-        rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero length line in calculate trapezoid");    // +++++++
+        rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero length line in calculate trapezoid");    // +++++++
         _debug_trap();
     }
 #endif
@@ -190,7 +190,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
         if (fp_ZERO(bf->cruise_velocity)) {
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity1 in calculate trapezoid");    // +++++++
+            rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity1 in calculate trapezoid");    // +++++++
             _debug_trap();
         }
 #endif
@@ -228,7 +228,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
         if (fp_ZERO(bf->cruise_velocity)) {
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity2 in calculate trapezoid");    // +++++++
+            rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity2 in calculate trapezoid");    // +++++++
             _debug_trap();
         }
 #endif
@@ -307,7 +307,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
             if (fp_ZERO(bf->cruise_velocity)) {
-                rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity3 in calculate trapezoid");    // +++++++
+                rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity3 in calculate trapezoid");    // +++++++
                 _debug_trap();
             }
 #endif
@@ -338,7 +338,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
         if (fp_ZERO(bf->cruise_velocity)) {
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity4 in calculate trapezoid");    // +++++++
+            rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity4 in calculate trapezoid");    // +++++++
             _debug_trap();
         }
 #endif
@@ -388,7 +388,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
         if (fp_ZERO(bf->cruise_velocity)) {
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity5 in calculate trapezoid");    // +++++++
+            rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity5 in calculate trapezoid");    // +++++++
             _debug_trap();
         }
 #endif
@@ -403,7 +403,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
         if (fp_ZERO(bf->cruise_velocity)) {
-            rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity6 in calculate trapezoid");    // +++++++
+            rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity6 in calculate trapezoid");    // +++++++
             _debug_trap();
         }
 #endif
@@ -412,7 +412,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 #ifdef __DIAGNOSTICS    // +++++
     if (fp_ZERO(bf->cruise_velocity)) {
-        rpt_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity7 in calculate trapezoid");    // +++++++
+        rpt_post_exception(STAT_PLANNER_ASSERTION_FAILURE, "zero cruise velocity7 in calculate trapezoid");    // +++++++
         _debug_trap();
     }
 #endif
@@ -474,6 +474,57 @@ float mp_get_target_length(const float v_0, const float v_1, const mpBuf_t *bf)
 // sqrt(5) / (2 sqrt(2) nroot(3,4)) = 0.60070285354
 const float mv_constant = 0.60070285354;
 
+/*
+ * mp_get_meet_velocity() - velocity at which a head from v_0 and a tail to v_2 exactly fill L
+ *
+ *	BOUNDED_MEET_VELOCITY selects a solver with a known worst case cost: a fixed number of
+ *	Newton-Raphson steps with no early exit, starting from the symmetric closed form solution
+ *	(which is exact when v_0 == v_2).
+ *
+ *	Newton on v_1 converges badly near the higher of v_0 and v_2 as dL/dv_1 goes to infinity
+ *	there. So we solve for x = sqrt(v_1 - v_hi) instead, which makes the length function smooth
+ *	everywhere. 3 iterations gets well below 1e-4 mm of length error over the useful range.
+ *	Build with BOUNDED_MEET_VELOCITY=0 to compare against the original early-exit iteration.
+ *
+ *	Cost: 1 mp_get_target_velocity() + MEET_VELOCITY_ITERATIONS * (2 fast_sqrt, 2 /)
+ *	The result is a velocity, so the roots are fast_sqrt(). mp_get_target_length() keeps sqrt()
+ *	as the head and tail lengths are refit from it.
+ */
+#ifndef BOUNDED_MEET_VELOCITY
+#define BOUNDED_MEET_VELOCITY 1
+#endif
+#ifndef MEET_VELOCITY_ITERATIONS
+#define MEET_VELOCITY_ITERATIONS 3
+#endif
+
+#if BOUNDED_MEET_VELOCITY
+
+float mp_get_meet_velocity(const float v_0, const float v_2, const float L, const mpBuf_t *bf)
+{
+    const float j = bf->jerk;
+    const float recip_j = bf->recip_jerk;
+    const float sqrt_j = fast_sqrt(j);
+    const float v_hi = max(v_0, v_2);
+    const float v_lo = min(v_0, v_2);
+    const float delta_v = v_hi - v_lo;
+
+    float x = fast_sqrt(mp_get_target_velocity(v_hi, L/2, bf) - v_hi);
+
+    for (uint8_t i=0; i<MEET_VELOCITY_ITERATIONS; i++) {
+        const float v_1 = v_hi + x*x;
+        const float sqrt_j_delta_v_lo = fast_sqrt(j * (delta_v + x*x)) + EPSILON;  // never zero
+
+        // l_c is the length error at v_1, l_d is its derivative with respect to x
+        const float l_c = tl_constant * recip_j * (sqrt_j * x * (v_hi+v_1) + sqrt_j_delta_v_lo * (v_lo+v_1)) - L;
+        const float l_d = 2 * mv_constant * ( ((3*v_1 - v_hi) / sqrt_j) + ((3*v_1 - v_lo) * x / sqrt_j_delta_v_lo) );
+
+        x = max((x - (l_c / l_d)), (float)0);
+    }
+    return (v_hi + x*x);
+}
+
+#else
+
 float mp_get_meet_velocity(const float v_0, const float v_2, const float L, const mpBuf_t *bf) {
     //L_d(v_0, v_1, j) = (sqrt(5) abs(v_0 - v_1) (v_0 - 3v_1)) / (2sqrt(2) 3^(1 / 4) sqrt(j abs(v_0 - v_1)) (v_0 - v_1))
     //                    sqrt(5) / (2 sqrt(2) nroot(3,4)) ( v_0 - 3 v_1) / ( sqrt(j abs(v_0 - v_1)))
@@ -526,6 +577,8 @@ float mp_get_meet_velocity(const float v_0, const float v_2, const float L, cons
     return v_1;
 }
 
+#endif // BOUNDED_MEET_VELOCITY
+
 //static const float SQRT_FIVE_SIXTHS = /* sqrt(5/6) = */ 0.9128709291753;
 
 // Here we define some static constants. Not trusting the compiler to precompile them, we precompute.
@@ -588,8 +641,8 @@ float mp_get_target_velocity(const float v_0, const float L, const mpBuf_t *bf)
     //         = pow( (27 * L_sq_x_j_x_sqrt_3 + 40 * v_0_cu + f3_sqrt_3 * sqrt(2 * 40 * v_0_cu * L_sq_x_j_x_sqrt_3 + 81 * L_fourth * j_sq) ), third)
     //         = pow( (27 * L_sq_x_j_x_sqrt_3 + v_0_cu_x_40 + f3_sqrt_3 * sqrt(2 * v_0_cu_x_40 * L_sq_x_j_x_sqrt_3 + 81 * L_fourth * j_sq) ), third)
 
-    const float chunk_1_cubed = (27 * L_sq_x_j_x_sqrt_3 + v_0_cu_x_40 + f3_sqrt_3 * sqrt(2 * v_0_cu_x_40 * L_sq_x_j_x_sqrt_3 + 81 * L_fourth * j_sq) );
-    const float chunk_1 = cbrtf(chunk_1_cubed);
+    const float chunk_1_cubed = (27 * L_sq_x_j_x_sqrt_3 + v_0_cu_x_40 + f3_sqrt_3 * fast_sqrt(2 * v_0_cu_x_40 * L_sq_x_j_x_sqrt_3 + 81 * L_fourth * j_sq) );
+    const float chunk_1 = fast_cbrt(chunk_1_cubed);
 
     // v_1 = 4/3*5^(1/3)        * v_0^2  / chunk_1  +   1/15*5^(2/3)       * chunk_1  -  1/3  *v_0
     // v_1 = f4_thirds_x_cbrt_5 * v_0_sq / chunk_1  +   f1_15th_x_2_3_rt_5 * chunk_1  -  third*v_0
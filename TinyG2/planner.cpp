@@ -56,11 +56,17 @@
 #include "canonical_machine.h"
 #include "plan_arc.h"
 #include "planner.h"
+#include "plan_shaper.h"
+#include "plan_retrace.h"
 #include "kinematics.h"
 #include "stepper.h"
 #include "encoder.h"
 #include "report.h"
 #include "util.h"
+#include "spindle.h"
+#include "pwm.h"
+#include "hardware.h"
+#include "xio.h"
 
 using namespace Motate;
 //extern OutputPin<kDebug1_PinNumber> plan_debug_pin1;
@@ -79,21 +85,42 @@ using namespace Motate;
 mpBufferPool_t mb;				// move buffer queue
 mpMoveMasterSingleton_t mm;		// context for line planning
 mpMoveRuntimeSingleton_t mr;	// context for line runtime
+#ifdef __PLANNER_PROFILE
+mpProfile_t mp_prof;			// planner profile
+#endif
+#ifdef __MOTION_TRACE
+mpTrace_t mp_trace;				// motion trace ring
+#endif
+#ifdef __LINE_TIMES
+mpLineTimes_t mp_line_times;	// per-line time accounting
+#endif
 
 /*
  * Local Scope Data and Functions
  */
 #define _bump(a) ((a<PLANNER_BUFFER_POOL_SIZE-1)?(a+1):0) // buffer incr & wrap
+#define _bump_cx(a) ((a<PLANNER_CONTEXT_POOL_SIZE-1)?(a+1):0) // context incr & wrap
 #define spindle_speed move_time	// local alias for spindle_speed to the time variable
 #define value_vector gm.target	// alias for vector of values
 //#define flag_vector unit		// alias for vector of flags
 
 static void _planner_time_accounting();
+static uint32_t cx_serial_last;		// serial of the last Gcode context written - never reset
+static bool _in_machining_cycle();
+static void _sample_time_in_planner();
+static float _get_time_in_planner();
+static inline uint32_t _usec(const float minutes);
 static void _audit_buffers();
+static uint8_t _get_contexts_available();
+static void _flush_buffers();
+static void _update_block_interval(const uint32_t now);
+static void _set_planner_timer(const uint32_t now);
 
 // execution routines (NB: These are called from the LO interrupt)
 static stat_t _exec_dwell(mpBuf_t *bf);
 static stat_t _exec_command(mpBuf_t *bf);
+static void _queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag, bool pass_through);
+static void _reset_aux_commands();
 
 /*
  * planner_init()
@@ -104,6 +131,13 @@ void planner_init()
 // If you know all memory has been zeroed by a hard reset you don't need these next 2 lines
 	memset(&mr, 0, sizeof(mr));	// clear all values, pointers and status
 	memset(&mm, 0, sizeof(mm));	// clear all values, pointers and status
+	mr.override = 1.0;
+#ifdef __PATH_RETRACE
+	mp_path_history_reset();
+#endif
+#ifdef __INPUT_SHAPING
+	mp_shaper_init();
+#endif
 	planner_init_assertions();
 	mp_init_buffers();
 }
@@ -151,11 +185,19 @@ void mp_halt_runtime()
  *	Does not affect mm or gm model positions
  *	This function is designed to be called during a hold to reset the planner
  *	This function should not generally be called; call cm_queue_flush() instead
+ *	Only the buffers in the queue are cleared - see _flush_buffers()
  */
 void mp_flush_planner()
 {
 	cm_abort_arc();
-	mp_init_buffers();
+	cm_abort_batch();
+	cm_abort_drill();
+	raster_reset();
+#ifdef __MOTION_OUTPUTS
+	gpio_reset_output_events();
+#endif
+	_reset_aux_commands();
+	_flush_buffers();
     mr.move_state = MOVE_OFF;   // invalidate mr buffer to prevent subsequent motion
 }
 
@@ -173,7 +215,7 @@ void mp_flush_planner()
  *	frames. The scheme to keep this straight is:
  *
  *	 - mm.position	- start and end position for planning
- *	 - mr.position	- current position of runtime segment
+ *	 - mr.position	- current position of runtime segment (float copy of mr.position_fx)
  *	 - mr.target	- target position of runtime segment
  *
  *	The runtime keeps a lot more data, such as waypoints, step vectors, etc.
@@ -185,27 +227,48 @@ void mp_flush_planner()
  */
 
 void mp_set_planner_position(uint8_t axis, const float position) { mm.position[axis] = position; }
-void mp_set_runtime_position(uint8_t axis, const float position) { mr.position[axis] = position; }
+void mp_set_runtime_position(uint8_t axis, const float position)
+{
+	mr.position[axis] = position;
+	mr.position_fx[axis] = fxpos(position);
+}
 
 void mp_set_steps_to_runtime_position()
 {
     float step_position[MOTORS];
+#ifdef __PATH_RETRACE
+    mp_path_history_reset();                                // the path run so far is not where the steps are now
+#endif
     kn_inverse_kinematics(mr.position, step_position);      // convert lengths to steps in floating point
-    for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+    for (uint8_t motor = MOTOR_1; motor < MOTORS_ACTIVE; motor++) {
         mr.target_steps[motor] = step_position[motor];
         mr.position_steps[motor] = step_position[motor];
         mr.commanded_steps[motor] = step_position[motor];
-        en_set_encoder_steps(motor, step_position[motor]);  // write steps to encoder register
+        // write steps to encoder register, keeping any backlash take-up or step offset already
+        // applied so the following error correction doesn't apply it a second time
+        en_set_encoder_steps(motor, step_position[motor], st_pre.mot[motor].backlash_deviation);
         mr.encoder_steps[motor] = en_read_encoder(motor);
+        mr.following_error[motor] = st_pre.mot[motor].backlash_deviation;
 
-        // These must be zero:
-        mr.following_error[motor] = 0;
+        // This must be zero:
         st_pre.mot[motor].corrected_steps = 0;
+        st_pre.mot[motor].correction_integral = 0;          // the error it was built from is gone
+#ifdef __PRESSURE_ADVANCE
+        mr.advance_steps[motor] = 0;                        // the extruder is back on its target
+#endif
     }
+#ifdef __TORCH_HEIGHT
+    mr.thc_offset = 0;                                      // Z is where the runtime says - see cm_queue_flush()
+    mr.thc_time = 0;
+#endif
+#ifdef __INPUT_SHAPING
+    mp_shaper_reset(step_position);                         // shaping restarts at rest from here
+#endif
 }
 
 /************************************************************************************
  * mp_queue_command() - queue a synchronous Mcode, program control, or other command
+ * mp_queue_pass_through_command() - queue a synchronous command that doesn't stop motion
  * _exec_command()    - callback to execute command
  *
  *  How this works:
@@ -223,9 +286,31 @@ void mp_set_steps_to_runtime_position()
  *  Doing it this way instead of synchronizing on an empty queue simplifies the
  *  handling of feedholds, feed overrides, buffer flushes, and thread blocking,
  *  and makes keeping the queue full much easier - therefore avoiding Q starvation
+ *
+ *  Normal commands plan motion to zero on either side. Pass-through commands (spindle
+ *  speed...) are planned at the velocity of the moves around them. When the exec reaches one
+ *  it copies the callback into the prep buffer and frees the planner buffer right away, so
+ *  segment prep carries on into the next move. The loader fires the callback at the exact
+ *  segment boundary. A pass-through command that is the last thing queued runs as a normal
+ *  command - the planner has already planned it to zero.
+ *
+ *  State that only matters from the next move on isn't queued at all. Tool select (T) and
+ *  line numbers (N) are set in the Gcode model and carried by the blocks that follow, in
+ *  their Gcode context or per-block state. mp_load_runtime_gcode_state() hands them to the
+ *  runtime when the block starts - it takes no buffer and doesn't touch the plan.
  */
 
 void mp_queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
+{
+	_queue_command(cm_exec, value, flag, false);
+}
+
+void mp_queue_pass_through_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
+{
+	_queue_command(cm_exec, value, flag, true);
+}
+
+static void _queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag, bool pass_through)
 {
 	mpBuf_t *bf;
 
@@ -239,6 +324,7 @@ void mp_queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
 	bf->bf_func = _exec_command;      // callback to planner queue exec function
 	bf->cm_func = cm_exec;            // callback to canonical machine exec function
     bf->replannable = true;           // allow the normal planning to go backward past this zero-speed and zero-length "move"
+	bf->pass_through = pass_through;
 
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
 		bf->value_vector[axis] = value[axis];
@@ -249,6 +335,12 @@ void mp_queue_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
 
 static stat_t _exec_command(mpBuf_t *bf)
 {
+	mp_run_aux_commands(bf);
+	if (bf->pass_through && (bf->nx->buffer_state == MP_BUFFER_QUEUED)) {
+		st_prep_pass_through_command(bf->cm_func, bf->value_vector, bf->flag_vector);
+		mp_free_run_buffer();							// can't empty the queue - the next buffer is queued
+		return (STAT_OK);
+	}
 	st_prep_command(bf);
 	return (STAT_OK);
 }
@@ -262,6 +354,133 @@ stat_t mp_runtime_command(mpBuf_t *bf)
 	return (STAT_OK);
 }
 
+/************************************************************************************
+ * mp_queue_aux_command()    - queue a command that only has to keep its place in the queue
+ * mp_queue_stop_command()   - queue a command that runs at rest but needs no buffer of its own
+ * mp_aux_commands_pending() - true if aux commands are waiting for the next block
+ * mp_run_aux_commands()     - run the aux commands a block carries - called by its exec
+ * mp_prep_stop_command()    - stage the next command a stopping block carries - see mp_exec_move()
+ * mp_aux_command_callback() - run aux commands left waiting when the planner empties
+ *
+ *  Aux commands (coolant, M64/M65 outputs) don't have to happen at an exact position, so
+ *  they don't take a planner buffer of their own. They wait here until the next block is
+ *  committed - a move, dwell or command - and that block carries them. Its exec runs them
+ *  as it starts the block, which is the segment boundary before it. Nothing is added to
+ *  the plan, so the moves on either side blend as if the command wasn't there.
+ *
+ *  The commands are kept in a ring in queue order: [run..taken) are carried by blocks,
+ *  [taken..write) wait for the next one. The exec only moves the run index. With nothing
+ *  queued, or no room in the ring, the command goes to the planner as a pass-through
+ *  command instead - after any still waiting, so the order is kept.
+ *
+ *  Stop commands (work offsets, M6, M3/M4/M5) must run with the machine at rest, but all
+ *  they need to keep is a callback and its vectors - a whole planner buffer for each one
+ *  takes lookahead from the moves. They wait in the same ring, marked as stops. A block
+ *  that carries one is planned to start from zero (aux_stop, see _apply_override()), so the
+ *  moves before it come to rest. Before its exec starts the block, mp_exec_move() stages
+ *  the commands it carries in the prep buffer one per call, and the loader runs them at the
+ *  boundary where motion stopped - where a command buffer of their own would have run
+ *  them. With no room or nothing queued they go to the planner as normal commands.
+ */
+
+typedef struct mpAuxCommand {
+	cm_exec_t cm_func;
+	float value[AXES];
+	bool flag[AXES];
+	bool stop;						// TRUE for a stop command - see mp_queue_stop_command()
+} mpAuxCommand_t;
+
+static struct mpAuxCommands {
+	volatile uint8_t run;			// next carried command to run - exec side
+	uint8_t taken;					// first command not carried by a block yet
+	uint8_t write;					// next free slot
+	mpAuxCommand_t command[MP_AUX_COMMANDS_MAX];
+} aux;
+
+#define _aux_index(a) ((a) & (MP_AUX_COMMANDS_MAX-1))
+
+static void _reset_aux_commands()
+{
+	aux.run = 0;
+	aux.taken = 0;
+	aux.write = 0;
+}
+
+static void _end_aux_commands()	// queue the waiting commands as commands of their own
+{
+	uint8_t end = aux.write;
+	aux.write = aux.taken;			// they leave the ring - so the commits below carry none
+	for (uint8_t i = aux.taken; i != end; i++) {
+		mpAuxCommand_t *c = &aux.command[_aux_index(i)];
+		_queue_command(c->cm_func, c->value, c->flag, !c->stop);
+	}
+}
+
+static void _queue_aux_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag, bool stop)
+{
+	if (!mp_has_runnable_buffer()) {
+		_end_aux_commands();
+		_queue_command(cm_exec, value, flag, !stop);
+		return;
+	}
+	if ((uint8_t)(aux.write - aux.run) >= MP_AUX_COMMANDS_MAX) {
+		_queue_command(cm_exec, value, flag, !stop);	// its block carries the ones waiting
+		return;
+	}
+	mpAuxCommand_t *c = &aux.command[_aux_index(aux.write)];
+	c->cm_func = cm_exec;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		c->value[axis] = value[axis];
+		c->flag[axis] = flag[axis];
+	}
+	c->stop = stop;
+	aux.write++;
+}
+
+void mp_queue_aux_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
+{
+	_queue_aux_command(cm_exec, value, flag, false);
+}
+
+void mp_queue_stop_command(void(*cm_exec)(float[], bool[]), float *value, bool *flag)
+{
+	_queue_aux_command(cm_exec, value, flag, true);
+}
+
+bool mp_aux_commands_pending()
+{
+	return (aux.taken != aux.write);
+}
+
+void mp_run_aux_commands(mpBuf_t *bf)
+{
+	for (; bf->aux_commands > 0; bf->aux_commands--) {
+		mpAuxCommand_t *c = &aux.command[_aux_index(aux.run)];
+		c->cm_func(c->value, c->flag);
+		aux.run++;
+	}
+}
+
+stat_t mp_prep_stop_command(mpBuf_t *bf)
+{
+	mpAuxCommand_t *c = &aux.command[_aux_index(aux.run)];
+	st_prep_pass_through_command(c->cm_func, c->value, c->flag);	// copied - the slot is free
+	aux.run++;
+	if (--bf->aux_commands == 0) {
+		bf->aux_stop = false;		// the block itself runs on the next call
+	}
+	return (STAT_OK);
+}
+
+stat_t mp_aux_command_callback()
+{
+	if (!mp_aux_commands_pending() || mp_has_runnable_buffer()) {
+		return (STAT_NOOP);
+	}
+	_end_aux_commands();
+	return (STAT_OK);
+}
+
 /*************************************************************************
  * mp_dwell() 	 - queue a dwell
  * _exec_dwell() - dwell execution
@@ -269,7 +488,18 @@ stat_t mp_runtime_command(mpBuf_t *bf)
  * Dwells are performed by passing a dwell move to the stepper drivers.
  * When the stepper driver sees a dwell it times the dwell on a separate
  * timer than the stepper pulse timer.
+ *
+ * Dwells up to SHORT_DWELL_USEC (laser pulses, dispensing) are instead run as DDA segments
+ * with no steps - see st_prep_dwell_ticks(). They are timed to the DDA tick rather than to
+ * the dwell timer's 1 ms, and are prepped one segment per exec the same as a line.
+ * bf->gm.move_time counts down the time still to prep.
+ *
+ * A longer dwell is run the same way while a synchronized spindle speed is still ramping,
+ * so the ramp goes on through the dwell (see spindle_exec_ramp()) and the spindle is at
+ * speed when the dwell ends. Once the ramp is done the rest is handed to the dwell timer.
  */
+#define DWELL_SEGMENT_TICKS ((uint32_t)(MAX_SEGMENT_USEC * FREQUENCY_DDA / 1000000))
+
 stat_t mp_dwell(float seconds)
 {
 	mpBuf_t *bf;
@@ -287,7 +517,27 @@ stat_t mp_dwell(float seconds)
 
 static stat_t _exec_dwell(mpBuf_t *bf)
 {
-	st_prep_dwell((uint32_t)(bf->gm.move_time * 1000000.0));// convert seconds to uSec
+	if (bf->move_state == MOVE_NEW) {
+#ifdef __PLANNER_PROFILE
+		mp_prof.job_time += bf->gm.move_time / 60;
+#endif
+		mp_run_aux_commands(bf);
+		bf->move_state = MOVE_RUN;
+	}
+	uint32_t ticks = lround(bf->gm.move_time * FREQUENCY_DDA);
+	if ((bf->gm.move_time * 1000000 > SHORT_DWELL_USEC) && !spindle_is_ramping()) {
+		st_prep_dwell((uint32_t)(bf->gm.move_time * 1000000.0));// convert seconds to uSec
+	} else if (ticks > DWELL_SEGMENT_TICKS) {
+		st_prep_dwell_ticks(DWELL_SEGMENT_TICKS, mr.target_steps);
+		spindle_exec_ramp(DWELL_SEGMENT_TICKS / FREQUENCY_DDA / 60);	// in minutes
+		bf->gm.move_time -= DWELL_SEGMENT_TICKS / FREQUENCY_DDA;
+		return (STAT_OK);								// more to come
+	} else if (ticks > 0) {
+		st_prep_dwell_ticks(ticks, mr.target_steps);
+		spindle_exec_ramp(ticks / FREQUENCY_DDA / 60);
+	} else {
+		st_prep_null();
+	}
 	if (mp_free_run_buffer()) {
         cm_cycle_end();			     // free buffer & perform cycle_end if planner is empty
     }
@@ -333,11 +583,26 @@ stat_t mp_exec_out_of_band_dwell(void)
  *
  * mp_init_buffers()        Initialize or reset buffers
  *
+ * _flush_buffers()         Empty the queue without re-initializing the pool. Only the
+ *                          buffers from the run buffer up to the first empty one are
+ *                          cleared, so a flush costs what was queued, not the pool size.
+ *                          The ring links never change, and the Gcode contexts are kept
+ *                          - with nothing queued only cx_newest is in use, and it still
+ *                          holds what the runtime last loaded.
+ *
  * mp_get_planner_buffers_available() Return # of available planner buffers
  *
+ * mp_planner_is_full()     Return true if no new input line should be taken. This is
+ *                          buffer headroom, and also planned time if $la is non-zero.
+ *
  * mp_get_write_buffer()    Get pointer to next available write buffer
  *                          Return pointer or NULL if no buffer available.
  *
+ * mp_set_buffer_gcode_state() Load Gcode model state into a write buffer
+ * mp_get_buffer_gcode_state() Reconstruct full Gcode model state from a buffer
+ * mp_load_runtime_gcode_state() Same, into mr.gm, skipping a context it already holds
+ * mp_buffer_gcode_state_matches() True if the state differs from the buffer only by target
+ *
  * mp_commit_write_buffer()	Commit the write buffer to the queue.
  *                          Advance write pointer & changes buffer state.
  *
@@ -381,6 +646,7 @@ void mp_init_buffers(void)
 	uint8_t i;
 
 	memset(&mb, 0, sizeof(mb));     // clear all values, pointers and status
+	mb.cx_serial[0] = ++cx_serial_last; // the cleared context is a new one to the runtime
 	mb.magic_start = MAGICNUM;
 	mb.magic_end = MAGICNUM;
 
@@ -396,11 +662,38 @@ void mp_init_buffers(void)
 	mb.buffers_available = PLANNER_BUFFER_POOL_SIZE;
 }
 
+static void _flush_buffers()
+{
+	mpBuf_t *r = mb.r;
+	for (mpBuf_t *bf = r; bf->buffer_state != MP_BUFFER_EMPTY; bf = bf->nx) {
+		_clear_buffer(bf);
+	}
+	memset(&mb.buffers_available, 0, (char *)mb.bf - (char *)&mb.buffers_available); // header only
+	mb.w = r;
+	mb.q = r;
+	mb.r = r;
+	mb.buffers_available = PLANNER_BUFFER_POOL_SIZE;
+}
+
 uint8_t mp_get_planner_buffers_available(void)
 {
+    if (_get_contexts_available() < PLANNER_CONTEXT_HEADROOM) {
+        return (0);                 // out of contexts looks the same as out of buffers
+    }
 	return (mb.buffers_available);
 }
 
+bool mp_planner_is_full(void)
+{
+    if (mp_get_planner_buffers_available() <= PLANNER_BUFFER_HEADROOM) {
+        return (true);
+    }
+    if (cm.planner_lookahead > 0) {     // time-based admission: stop reading once the lookahead target is met
+        return (mp_get_planned_time() >= (cm.planner_lookahead / MILLISECONDS_PER_MINUTE));
+    }
+    return (false);
+}
+
 mpBuf_t * mp_get_write_buffer()     // get & clear a buffer
 {
     if (mb.w->buffer_state == MP_BUFFER_EMPTY) {
@@ -408,6 +701,7 @@ mpBuf_t * mp_get_write_buffer()     // get & clear a buffer
         mb.w = mb.w->nx;
         _clear_buffer(w);
         w->buffer_state = MP_BUFFER_PLANNING;
+        w->context = mb.cx_newest;  // non-alines inherit the context so indexes stay in queue order
         mb.buffers_available--;
         return (w);
     }
@@ -415,6 +709,60 @@ mpBuf_t * mp_get_write_buffer()     // get & clear a buffer
 	return (NULL);
 }
 
+/*
+ * _update_block_interval() - average the time between planned blocks as they're committed
+ * _set_planner_timer()     - set when the planner plans the blocks committed so far
+ *
+ *	A stopped planner holds off planning to collect some lookahead before the cycle starts.
+ *	The hold-off is taken from the incoming block rate rather than always PLANNER_TIMEOUT_MS.
+ *	A line on its own - after a gap, with nothing more waiting in the RX buffer - is an MDI
+ *	line and is planned at once. Otherwise each block moves the plan out to about
+ *	PLANNER_STARTUP_BLOCKS more blocks at the averaged rate, so the plan comes soon after a
+ *	stream pauses. It comes at once if the queue fills, and never later than PLANNER_TIMEOUT_MS
+ *	after the first block. A running planner keeps the plain timeout - it's replanned when
+ *	the queue runs short anyway (see mp_plan_buffer()).
+ *
+ *	The times are on the microsecond clock (SysTickTimer.getMicros()). On the millisecond
+ *	tick a stream of short blocks arrives several to a tick and averages to an interval of
+ *	0 or 1 ms, which is too coarse to set the hold-off from. Times are compared as
+ *	differences, so the clock's wrap every 71 minutes doesn't matter.
+ */
+static void _update_block_interval(const uint32_t now)
+{
+    float interval = (uint32_t)(now - mb.commit_time); // right across the clock's wrap
+    mb.commit_time = now;
+    if (interval >= PLANNER_TIMEOUT_USEC) {
+        mb.block_interval = PLANNER_TIMEOUT_USEC; // a gap - the block starts a new burst
+    } else {
+        mb.block_interval = (mb.block_interval + interval) / 2;
+    }
+}
+
+static void _set_planner_timer(const uint32_t now)
+{
+    bool starting = mp_runtime_is_idle() && (mb.r->buffer_state != MP_BUFFER_RUNNING);
+    if (!starting) {
+        if (mb.planner_timer == 0) {
+            mb.planner_timer = now + PLANNER_TIMEOUT_USEC;
+        }
+        return;
+    }
+    if (mb.planner_timer == 0) {
+        mb.startup_deadline = now + PLANNER_TIMEOUT_USEC;
+    }
+    uint16_t lines, bytes;
+    bool waiting = (xio_get_rx_credit(lines, bytes) != 0);
+    if ((!waiting && (mb.block_interval >= PLANNER_TIMEOUT_USEC)) || mp_planner_is_full()) {
+        mb.planner_timer = now;
+        mb.force_replan = true;                 // plan on this pass
+        return;
+    }
+    mb.planner_timer = now + (uint32_t)(mb.block_interval * PLANNER_STARTUP_BLOCKS) + 1000;  // at least 1 ms
+    if ((int32_t)(mb.planner_timer - mb.startup_deadline) > 0) {
+        mb.planner_timer = mb.startup_deadline; // compared as a difference, so the clock may wrap
+    }
+}
+
 /*** WARNING ***
 * The function calling mp_commit_write_buffer() must NOT use the write buffer once it has
 * been committed. Interrupts may use the buffer immediately, invalidating its contents.
@@ -423,8 +771,23 @@ void mp_commit_write_buffer(const moveType move_type)
 {
     mb.q->move_type = move_type;
     mb.q->move_state = MOVE_NEW;
+    mb.q->aux_commands = aux.write - aux.taken;   // the block carries the aux commands waiting for it
+    for (; aux.taken != aux.write; aux.taken++) {
+        if (aux.command[_aux_index(aux.taken)].stop) {
+            mb.q->aux_stop = true;
+        }
+    }
+    if (mb.q->aux_stop) {
+        if (mp_move_type_is_planned(move_type)) {
+            mb.q->entry_vmax = 0;               // as _apply_override() keeps it
+            mb.q->exit_vmax = min(mb.q->exit_vmax, mb.q->delta_vmax);
+        } else {
+            mb.q->pass_through = false;         // a pass-through command carrying one stops too
+        }
+    }
 //    mb.q->replannable = true;                   // ++++ TEST
-    if (MOVE_TYPE_ALINE != move_type) {
+    mp_restart_plan_pass();                     // the block list has a new end
+    if (!mp_move_type_is_planned(move_type)) {
         mb.q->buffer_state = MP_BUFFER_QUEUED;
         mb.q = mb.q->nx;
         if (!mb.needs_replanned) {
@@ -439,9 +802,9 @@ void mp_commit_write_buffer(const moveType move_type)
         if(cm.hold_state == FEEDHOLD_OFF)
             cm_set_motion_state(MOTION_PLANNING);
         mb.q = mb.q->nx;                        // advance the queued buffer pointer
-        if (mb.planner_timer == 0) {
-            mb.planner_timer = SysTickTimer.getValue() + PLANNER_TIMEOUT_MS;
-        }
+        uint32_t now = SysTickTimer.getMicros();
+        _update_block_interval(now);
+        _set_planner_timer(now);
     }
     qr_request_queue_report(+1);                // request a QR and add to the "added buffers" count
 }
@@ -455,8 +818,16 @@ mpBuf_t * mp_get_run_buffer()
 {
     // CASE: fresh buffer; becomes running if queued or pending
     if (mb.r->buffer_state == MP_BUFFER_QUEUED) {
+        if (mb.r->plan_seq & 1) {               // interrupted the planner writing it - see _begin_block_plan()
+            mb.exec_deferred = true;            // the planner requests the exec again when it's done
+            return (NULL);
+        }
         mb.r->buffer_state = MP_BUFFER_RUNNING;
+        mp_dequeue_time(mb.r);                  // its time is now accounted for in mb.time_in_run
         mb.needs_time_accounting = true;
+        if (mp_move_type_is_planned(mb.r->move_type) && fp_ZERO(mb.r->exit_velocity) && fp_NOT_ZERO(mb.r->exit_vmax)) {
+            mb.zero_exits++;                    // the planner ran out of blocks to look ahead into
+        }
     }
 
     // This is the one point where an accurate accounting of the total time in the
@@ -466,8 +837,13 @@ mpBuf_t * mp_get_run_buffer()
 
     // CASE: asking for the same run buffer for the Nth time
     if (mb.r->buffer_state == MP_BUFFER_RUNNING) {
+        mb.starved = false;
         return (mb.r);                          // return same buffer
     }
+    if (!mb.starved && _in_machining_cycle()) {
+        mb.starved = true;
+        mb.dry_outs++;
+    }
     return (NULL);								// CASE: no queued buffers. fail it.
 }
 
@@ -487,7 +863,151 @@ bool mp_free_run_buffer()    // EMPTY current run buffer & advance to the next
 //	}
 	mb.buffers_available++;
 	qr_request_queue_report(-1);				// request a QR and add to the "removed buffers" count
-	return ((mb.w == mb.r) ? true : false); 	// return true if the queue emptied
+	if (mb.w == mb.r) {
+		mb.time_queued_out = mb.time_queued_in;	// nothing queued - clear any accounting residue
+		return (true);							// return true if the queue emptied
+	}
+	return (false);
+}
+
+/*
+ * Shared Gcode contexts
+ *
+ *	Only the Gcode state that can change on every block (target, line number, feed...)
+ *	is kept in the planner buffer. The rest (offsets, modes, tool...) is kept in a small
+ *	ring of contexts that consecutive buffers share until that state changes. Since
+ *	buffers are written and freed in queue order the context indexes held by the
+ *	queued buffers are also in order, so the oldest context still in use is always the
+ *	one held by the run buffer. Contexts are only ever written from the main loop.
+ *
+ *	_get_contexts_available() is safe against the run buffer being freed underneath it
+ *	as it re-reads mb.r after sampling. A stale answer is always a conservative one.
+ *
+ *	Every context written gets a new serial in mb.cx_serial[]. The runtime keeps the
+ *	serial of the context unpacked into mr.gm, so a block that shares its context with
+ *	the block before only copies the per-block state - see mp_load_runtime_gcode_state().
+ */
+
+static uint8_t _get_contexts_available()
+{
+    mpBuf_t *r;
+    uint8_t oldest;
+    bool empty;
+
+    do {
+        r = mb.r;
+        oldest = r->context;
+        empty = (r->buffer_state == MP_BUFFER_EMPTY);
+    } while (r != mb.r);
+
+    if (empty) {
+        return (PLANNER_CONTEXT_POOL_SIZE - 1);     // nothing queued, only cx_newest is kept
+    }
+    return ((oldest + PLANNER_CONTEXT_POOL_SIZE - mb.cx_newest - 1) % PLANNER_CONTEXT_POOL_SIZE);
+}
+
+static void _load_gcode_context(mpGcodeContext_t *cx, const GCodeState_t *gm)
+{
+    memset(cx, 0, sizeof(mpGcodeContext_t));        // so padding compares equal
+    copy_vector(cx->work_offset, gm->work_offset);
+    cx->parameter = gm->parameter;
+    cx->feed_rate_mode = gm->feed_rate_mode;
+    cx->select_plane = gm->select_plane;
+    cx->units_mode = gm->units_mode;
+    cx->path_control = gm->path_control;
+    cx->distance_mode = gm->distance_mode;
+    cx->arc_distance_mode = gm->arc_distance_mode;
+    cx->absolute_override = gm->absolute_override;
+    cx->coord_system = gm->coord_system;
+    cx->tool = gm->tool;
+    cx->tool_select = gm->tool_select;
+}
+
+void mp_set_buffer_gcode_state(mpBuf_t *bf, const GCodeState_t *gm)
+{
+    bf->gm.linenum = gm->linenum;
+    copy_vector(bf->gm.target, gm->target);
+    bf->gm.move_time = gm->move_time;
+    bf->gm.feed_rate = gm->feed_rate;
+#ifdef __VELOCITY_HINTS
+    bf->gm.exit_hint = gm->exit_hint;
+#endif
+    bf->gm.motion_mode = gm->motion_mode;
+
+    mpGcodeContext_t cx;
+    _load_gcode_context(&cx, gm);
+
+    if (memcmp(&cx, &mb.cx[mb.cx_newest], sizeof(cx)) != 0) {
+        if (_get_contexts_available() == 0) {       // never supposed to fail - see mp_get_planner_buffers_available()
+            cm_panic(STAT_BUFFER_FULL_FATAL, "no gcode context in mp_set_buffer_gcode_state");
+            return;
+        }
+        mb.cx_newest = _bump_cx(mb.cx_newest);
+        memcpy(&mb.cx[mb.cx_newest], &cx, sizeof(cx));
+        mb.cx_serial[mb.cx_newest] = ++cx_serial_last;
+    }
+    bf->context = mb.cx_newest;
+}
+
+bool mp_buffer_gcode_state_matches(const mpBuf_t *bf, const GCodeState_t *gm)
+{
+    if ((bf->gm.motion_mode != gm->motion_mode) || fp_NE(bf->gm.feed_rate, gm->feed_rate)) {
+        return (false);
+    }
+    mpGcodeContext_t cx;
+    _load_gcode_context(&cx, gm);
+    return (memcmp(&cx, &mb.cx[bf->context], sizeof(cx)) == 0);
+}
+
+static void _get_block_gcode_state(const mpBuf_t *bf, GCodeState_t *gm)
+{
+    gm->linenum = bf->gm.linenum;
+    copy_vector(gm->target, bf->gm.target);
+    gm->move_time = bf->gm.move_time;
+    gm->minimum_time = bf->gm.move_time;            // not kept in the buffer
+    gm->feed_rate = bf->gm.feed_rate;
+#ifdef __VELOCITY_HINTS
+    gm->exit_hint = bf->gm.exit_hint;
+#endif
+    gm->motion_mode = bf->gm.motion_mode;
+}
+
+void mp_get_buffer_gcode_state(const mpBuf_t *bf, GCodeState_t *gm)
+{
+    const mpGcodeContext_t *cx = &mb.cx[bf->context];
+
+    _get_block_gcode_state(bf, gm);
+    copy_vector(gm->work_offset, cx->work_offset);
+    gm->parameter = cx->parameter;
+    gm->feed_rate_mode = (cmFeedRateMode)cx->feed_rate_mode;
+    gm->select_plane = (cmCanonicalPlane)cx->select_plane;
+    gm->units_mode = (cmUnitsMode)cx->units_mode;
+    gm->path_control = (cmPathControl)cx->path_control;
+    gm->distance_mode = (cmDistanceMode)cx->distance_mode;
+    gm->arc_distance_mode = (cmDistanceMode)cx->arc_distance_mode;
+    gm->absolute_override = (cmAbsoluteOverride)cx->absolute_override;
+    gm->coord_system = (cmCoordSystem)cx->coord_system;
+    gm->tool = cx->tool;
+    gm->tool_select = cx->tool_select;
+}
+
+/*
+ * mp_load_runtime_gcode_state() - load the state of the block starting to run into mr.gm
+ *
+ *	Same as mp_get_buffer_gcode_state(bf, &mr.gm), but the shared context is only unpacked
+ *	when it isn't already there. Anything else that writes the context fields of mr.gm
+ *	(see mp_set_runtime_work_offset()) must zero mr.context_serial.
+ */
+
+void mp_load_runtime_gcode_state(const mpBuf_t *bf)
+{
+    uint32_t serial = mb.cx_serial[bf->context];
+    if (serial == mr.context_serial) {
+        _get_block_gcode_state(bf, &mr.gm);
+        return;
+    }
+    mp_get_buffer_gcode_state(bf, &mr.gm);
+    mr.context_serial = serial;
 }
 
 /* These functions are defined here, but use the macros in planner.h instead.
@@ -536,6 +1056,7 @@ void mp_copy_buffer(mpBuf_t *bf, const mpBuf_t *bp)
  * Planner functions and helpers
  *
  *	mp_plan_buffer()
+ *	mp_get_planned_time()   - planned motion time in the queue, in minutes
  *	mp_is_it_phat_city_time()
  *	_planner_time_accounting()
  *  _audit_buffers()
@@ -547,22 +1068,30 @@ stat_t mp_plan_buffer()
     // 0) There are items in the buffer that need replanning.
     // 1) Planner timer has "timed out"
     // 2) Less than MIN_PLANNED_TIME in the planner
+    // A pass that ran out of budget last time is finished regardless - see mp_plan_block_list()
 
+    if (mb.override_replan) {
+        mb.override_replan = false;
+        mp_replan_overrides();                  // sets needs_replanned and force_replan
+    }
     if (!mb.needs_replanned) {
         return (STAT_OK);
     }
-    bool do_continue = false;
+    bool do_continue = (mb.plan_pass != PLAN_PASS_IDLE);
 
-    if (mb.force_replan) {
+    if (mb.force_replan || mp_dry_plan_is_active()) {  // a dry plan doesn't wait for the queue to fill
         do_continue = true;
         mb.force_replan = false;
     }
 
-    if (!do_continue && (mb.planner_timer < SysTickTimer.getValue()) ) {
+    if (!do_continue && ((mb.planner_timer == 0) || ((int32_t)(SysTickTimer.getMicros() - mb.planner_timer) > 0))) {
         do_continue = true;
+        if (mb.planner_timer != 0) {
+            mb.timeout_plans++;                 // the queue didn't fill in time
+        }
     }
 
-    float total_buffer_time = mb.time_in_run + mb.time_in_planner;
+    float total_buffer_time = mb.time_in_run + _get_time_in_planner();
     if (!do_continue && (total_buffer_time > 0) && (MIN_PLANNED_TIME >= total_buffer_time) ) {
         do_continue = true;
     }
@@ -572,60 +1101,474 @@ stat_t mp_plan_buffer()
     }
 
     // Now, finally, plan the buffer.
-    mp_plan_block_list(mb.q->pv);
+#ifdef __PLANNER_PROFILE
+    uint32_t start = hw_get_cpu_cycles();
+    stat_t status = mp_plan_block_list(mb.q->pv);
+    mp_profile_time(&mp_prof.plan, hw_get_cpu_cycles() - start);
+#else
+    stat_t status = mp_plan_block_list(mb.q->pv);
+#endif
 
     if (cm.hold_state != FEEDHOLD_HOLD) {
         st_request_exec_move();					// requests an exec if the runtime is not busy
         // NB: BEWARE! the exec may result in the planner buffer being
         // processed immediately and then freed - invalidating the contents
     }
+    if (status == STAT_EAGAIN) {
+        return (STAT_EAGAIN);                   // the rest of the pass runs on the next main loop pass
+    }
 
     mb.planner_timer = 0; // clear the planner timer
     mb.needs_replanned = false;
     return (STAT_OK);
 }
 
+/*
+ * Dry plan - estimate the job time without motion
+ *
+ * mp_start_dry_plan() - blocks from here on are timed and dropped instead of run
+ * mp_end_dry_plan()   - take what's left in the queue and return the time, in minutes
+ *
+ *	The Gcode is parsed and planned as usual, but the exec takes each block from the queue
+ *	in one go - see _exec_dry_plan(). Lines and arcs count the real_move_time of their
+ *	finalized trapezoids and dwells their length, so the total is the time the firmware
+ *	would really take, acceleration and all. Commands run for their effect on the machine
+ *	model (offsets, tools, program end), but spindle and coolant outputs are left alone.
+ *	Nothing is prepped for the steppers and the motors aren't touched.
+ *
+ *	Blocks are only taken once the planner is full, so they're planned with the lookahead
+ *	they'd have if the job was streamed by a sender that keeps the queue full. The caller
+ *	is expected to put the model back at the runtime position afterwards - nothing moved.
+ */
+
+void mp_start_dry_plan()
+{
+	mb.dry_plan_time = 0;
+	mb.dry_plan = DRY_PLAN_ON;
+}
+
+float mp_end_dry_plan()
+{
+	mb.dry_plan = DRY_PLAN_ENDING;
+	mb.force_replan = true;
+	while (mp_plan_buffer() == STAT_EAGAIN);	// plan the blocks still waiting for it...
+	st_request_exec_move();					// ...and take them - the exec chain runs the queue out at once
+	mb.dry_plan = DRY_PLAN_OFF;
+	return (mb.dry_plan_time);
+}
+
+#ifdef __PLANNER_PROFILE
+/*
+ * Planner profile
+ *
+ * mp_clear_profile()	 - zero the profile
+ * mp_profile_time()	 - account one call of a profiled function
+ * mp_profile_move_end() - account a line or arc the exec has finished with
+ *
+ *	Times are in CPU cycles (hw_get_cpu_cycles()), so the host build reports the cost of
+ *	its own processor and not the simulated clock. The job time is the real_move_time the
+ *	planner arrived at for each move that ran, plus the dwells - what the job should take.
+ *
+ *	A dip is a move that ended below PLANNER_PROFILE_DIP_RATIO of the velocity the junction
+ *	allowed while another move was queued behind it: the planner ran short of blocks to
+ *	look ahead into and had to brake for a stop that never came. Exact stops don't count.
+ */
+#define PLANNER_PROFILE_DIP_RATIO 0.5
+
+void mp_clear_profile()
+{
+	memset(&mp_prof, 0, sizeof(mp_prof));
+}
+
+void mp_profile_time(mpProfileTimer_t *t, const uint32_t cycles)
+{
+	t->count++;
+	t->total += cycles;
+	t->max = max(t->max, cycles);
+}
+
+void mp_profile_move_end(const mpBuf_t *bf)
+{
+	mp_prof.moves++;
+	mp_prof.job_time += bf->real_move_time;
+
+	const mpBuf_t *nx = bf->nx;
+	if ((nx->buffer_state == MP_BUFFER_QUEUED) && mp_move_type_is_planned(nx->move_type) &&
+		(bf->exit_velocity < PLANNER_PROFILE_DIP_RATIO * min(bf->exit_vmax, nx->entry_vmax))) {
+		mp_prof.dips++;
+	}
+}
+#endif // __PLANNER_PROFILE
+
+#ifdef __MOTION_TRACE
+/*
+ * Motion trace
+ *
+ * mp_trace_start()	  - clear the ring and start recording
+ * mp_trace_stop()	  - stop recording, and optionally dump what's held
+ * mp_trace_segment() - record a segment just handed to st_prep_line()
+ * mp_trace_block()	  - record a block's planning decision, or the trapezoid it runs with
+ *
+ *	The trace is a ring of the last MOTION_TRACE_SIZE records in RAM, so when something
+ *	goes wrong the moments before it can be looked at. Segments come from the exec and
+ *	blocks from the planner and mp_exec_aline(), interleaved in the order they happened.
+ *	Taking a record is a copy of a few words, and nothing at all if not recording.
+ *
+ *	The exec interrupt can cut into a block being recorded from the planner, so the slot
+ *	is claimed with interrupts off. Records are filled in afterwards - order in the ring
+ *	is the order slots were claimed, and the timestamps say when.
+ *
+ *	Alarms, shutdowns and panics stop the trace and dump it, so it holds what led up to
+ *	them. Dumping is done from the main loop - see rpt_trace_dump_callback().
+ */
+
+void mp_trace_start()
+{
+	mp_trace.recording = false;
+	mp_trace.next = 0;
+	mp_trace.count = 0;
+	mp_trace.recording = true;
+}
+
+void mp_trace_stop(const bool dump)
+{
+	if (dump && mp_trace.recording) {
+		mp_trace.dump = true;
+	}
+	mp_trace.recording = false;
+}
+
+static mpTraceRecord_t *_trace_claim(const mpTraceType type, const uint32_t linenum)
+{
+#ifdef __ARM
+	__disable_irq();
+#endif
+	mpTraceRecord_t *r = &mp_trace.record[mp_trace.next];
+	if (++mp_trace.next == MOTION_TRACE_SIZE) {
+		mp_trace.next = 0;
+	}
+	if (mp_trace.count < MOTION_TRACE_SIZE) {
+		mp_trace.count++;
+	}
+#ifdef __ARM
+	__enable_irq();
+#endif
+	r->time = hw_get_cycles();
+	r->linenum = linenum;
+	r->type = type;
+	return (r);
+}
+
+void mp_trace_segment(const float travel_steps[])
+{
+	if (!mp_trace.recording) {
+		return;
+	}
+	mpTraceRecord_t *r = _trace_claim(MP_TRACE_SEGMENT, mr.gm.linenum);
+	r->section = mr.section;
+	r->flags = 0;
+	r->segment.velocity = mr.segment_velocity;
+	for (uint8_t i=0; i<MOTORS; i++) {
+		if (i < MOTORS_ACTIVE) {
+			r->segment.steps[i] = lroundf(travel_steps[i] * MP_TRACE_STEP_SCALE);
+			r->segment.following_error[i] = lroundf(mr.following_error[i] * MP_TRACE_STEP_SCALE);
+		} else {
+			r->segment.steps[i] = 0;						// travel_steps isn't set past MOTORS_ACTIVE
+			r->segment.following_error[i] = 0;
+		}
+	}
+}
+
+void mp_trace_block(const mpBuf_t *bf, const mpTraceType type)
+{
+	if (!mp_trace.recording) {
+		return;
+	}
+	mpTraceRecord_t *r = _trace_claim(type, bf->gm.linenum);
+	r->section = bf->move_type;
+	r->flags = (bf->replannable ? MP_TRACE_REPLANNABLE : 0) | (bf->locked ? MP_TRACE_LOCKED : 0) |
+			   (bf->pass_through ? MP_TRACE_PASS_THROUGH : 0);
+	r->block.entry_velocity = bf->entry_velocity;
+	r->block.cruise_velocity = bf->cruise_velocity;
+	r->block.exit_velocity = bf->exit_velocity;
+	r->block.braking_velocity = bf->braking_velocity;
+	r->block.move_time = bf->trapezoid_pending ? 0 : bf->real_move_time;
+}
+#endif // __MOTION_TRACE
+
+#ifdef __LINE_TIMES
+/*
+ * Per-line time accounting
+ *
+ * mp_line_time_start()	  - clear the records and start accounting
+ * mp_line_time_stop()	  - stop accounting. Records already closed still go to the host
+ * mp_line_time_block()	  - a block is starting in the exec - close the last line if it's a new one
+ * mp_line_time_segment() - add a segment's time to the line being run
+ * mp_line_time_idle()	  - the exec has run out of blocks - close the line being run
+ *
+ *	The exec adds up the time of the segments it runs for each Gcode line, and closes the
+ *	line's record when a block of another line starts or the queue runs dry. A record holds
+ *	what the line took, what the planner said it would take as its blocks started, and what
+ *	it would take at its feed rate with no acceleration. A line that ran LINE_TIME_LIMITED
+ *	longer than that nominal time is flagged velocity limited - jerk, corners or short moves
+ *	kept it from its feed, and that's where the CAM can help. One that ran over its planned
+ *	time was held, overridden or slowed for a stall. Lines merged into one block by
+ *	coalescing are counted on the last of them; arcs and splines are one block per line.
+ *	Dwells and commands take no segment time and are not counted.
+ *
+ *	All but start and stop run in the exec, which is the only writer of the open line and
+ *	the ring head. The main loop sends records and moves the tail - see lt_line_time_callback().
+ */
+
+void mp_line_time_start()
+{
+	mp_line_times.enabled = false;
+	mp_line_times.blocks = 0;
+	mp_line_times.block = NULL;
+	mp_line_times.dropped = 0;
+	mp_line_times.tail = mp_line_times.head;		// drop anything not yet sent
+	mp_line_times.enabled = true;
+}
+
+void mp_line_time_stop()
+{
+	mp_line_times.enabled = false;
+}
+
+static void _line_time_close()
+{
+	if (mp_line_times.blocks == 0) {
+		return;
+	}
+	uint16_t next = (mp_line_times.head + 1) % LINE_TIME_RECORDS;
+	if (next == mp_line_times.tail) {
+		mp_line_times.dropped++;					// the host is not keeping up
+	} else {
+		mpLineTime_t *r = &mp_line_times.record[mp_line_times.head];
+		r->linenum = mp_line_times.linenum;
+		r->executed = _usec(mp_line_times.executed);
+		r->planned = _usec(mp_line_times.planned);
+		r->nominal = _usec(mp_line_times.nominal);
+		r->blocks = mp_line_times.blocks;
+		r->flags = ((mp_line_times.executed > mp_line_times.nominal * LINE_TIME_LIMITED) ? MP_LINE_VELOCITY_LIMITED : 0) |
+				   ((mp_line_times.executed > mp_line_times.planned * LINE_TIME_OVERRAN) ? MP_LINE_OVERRAN : 0);
+		r->spare = 0;
+		mp_line_times.head = next;
+	}
+	mp_line_times.blocks = 0;
+}
+
+void mp_line_time_block(const mpBuf_t *bf)
+{
+	if (!mp_line_times.enabled || (bf == mp_line_times.block)) {
+		return;										// off, or the same block restarting after a hold
+	}
+	if (bf->gm.linenum != mp_line_times.linenum) {
+		_line_time_close();
+	}
+	if (mp_line_times.blocks == 0) {
+		mp_line_times.linenum = bf->gm.linenum;
+		mp_line_times.executed = 0;
+		mp_line_times.planned = 0;
+		mp_line_times.nominal = 0;
+	}
+	mp_line_times.block = bf;
+	mp_line_times.blocks++;
+	mp_line_times.planned += bf->real_move_time;
+	mp_line_times.nominal += bf->gm.move_time;
+}
+
+void mp_line_time_segment(const float segment_time)
+{
+	if (mp_line_times.blocks != 0) {
+		mp_line_times.executed += segment_time;
+	}
+}
+
+void mp_line_time_idle()
+{
+	_line_time_close();
+	mp_line_times.block = NULL;
+}
+#endif // __LINE_TIMES
+
+float mp_get_planned_time()
+{
+    return (_get_time_in_planner());
+}
+
 bool mp_is_it_phat_city_time() {
 
 	if(cm.hold_state == FEEDHOLD_HOLD) {
     	return true;
 	}
-    float time_in_planner = mb.time_in_run + mb.time_in_planner;
+    float time_in_planner = mb.time_in_run + _get_time_in_planner();
     return ((time_in_planner <= 0) || (PHAT_CITY_TIME < time_in_planner));
 }
 
-static void _planner_time_accounting()
+/*
+ * Queued time accounting
+ *
+ *	mp_queue_buffer()         - PLANNING --> QUEUED, add the block's time to the queue (main loop)
+ *	mp_update_queued_time()   - a queued block was replanned, adjust its time (main loop)
+ *	mp_finalize_queued_time() - a queued block was locked with its final time (exec)
+ *	mp_dequeue_time()         - QUEUED --> RUNNING, remove the block's time (exec)
+ *	mp_unqueue_time()         - QUEUED --> PLANNING for replanning, remove the block's time (main loop)
+ *	_get_time_queued()        - time of all queued (not running) blocks, in minutes
+ *	_get_time_in_planner()    - time in the runtime plus all queued blocks, in minutes
+ *
+ *	The move time of the queued blocks is kept as 2 running sums in microseconds so the total
+ *	is available in constant time rather than by walking the queue. time_queued_in is only
+ *	written from the main loop and time_queued_out only from the exec, so neither needs a
+ *	critical region, and unsigned wraparound keeps their difference exact. A block taken back
+ *	for replanning is therefore removed from time_queued_in rather than added to
+ *	time_queued_out; the caller holds it with _begin_block_plan() or has the exec stopped.
+ *	Each block records the amount it contributed in bf->queued_time. Any residue left by a
+ *	block that changed state mid-update is cleared when the queue empties - see
+ *	mp_free_run_buffer().
+ */
+
+static inline uint32_t _usec(const float minutes)
+{
+    return ((uint32_t)(minutes * MICROSECONDS_PER_MINUTE + 0.5));
+}
+
+void mp_queue_buffer(mpBuf_t *bf)
+{
+    if (bf->buffer_state == MP_BUFFER_PLANNING) {
+        bf->queued_time = _usec(bf->real_move_time);
+        mb.time_queued_in += bf->queued_time;       // must be counted before the exec can see it queued
+        bf->buffer_state = MP_BUFFER_QUEUED;
+    }
+}
+
+void mp_update_queued_time(mpBuf_t *bf)
+{
+    if (bf->buffer_state == MP_BUFFER_QUEUED) {
+        uint32_t queued_time = _usec(bf->real_move_time);
+        mb.time_queued_in += queued_time - bf->queued_time;
+        bf->queued_time = queued_time;
+    }
+}
+
+void mp_finalize_queued_time(mpBuf_t *bf)
+{
+    if (bf->buffer_state == MP_BUFFER_QUEUED) {
+        uint32_t queued_time = _usec(bf->real_move_time);
+        mb.time_queued_out += bf->queued_time - queued_time;
+        bf->queued_time = queued_time;
+    }
+}
+
+void mp_dequeue_time(mpBuf_t *bf)
+{
+    mb.time_queued_out += bf->queued_time;
+    bf->queued_time = 0;
+}
+
+void mp_unqueue_time(mpBuf_t *bf)
+{
+    mb.time_queued_in -= bf->queued_time;
+    bf->queued_time = 0;
+}
+
+static float _get_time_queued()
+{
+    int32_t queued_time = (int32_t)(mb.time_queued_in - mb.time_queued_out);
+    return ((queued_time > 0) ? (queued_time / MICROSECONDS_PER_MINUTE) : 0);
+}
+
+static float _get_time_in_planner()
+{
+    return (mb.time_in_run + _get_time_queued());
+}
+
+/*
+ * Queue telemetry - how well the queue is kept fed, for the queue report (see report.cpp)
+ *
+ * mp_init_queue_stats()	 - clear the telemetry - called at the start of each cycle
+ * _in_machining_cycle()	 - true if the runtime should have something to run
+ * _sample_time_in_planner() - account mb.time_in_planner once the exec has updated it
+ *
+ *	  dry_outs		- the runtime asked for a block and there wasn't one. Counted once until
+ *					  it's given one, so a long wait counts the same as a short one
+ *	  timeout_plans	- plans forced by PLANNER_TIMEOUT_MS because the queue never filled
+ *	  zero_exits	- lines and arcs that started with an exit velocity of zero when their
+ *					  exit could have been taken at speed - the end of the lookahead was a
+ *					  stop. Exact stops aren't counted; the last move of a job is
+ *	  tip_xxx		- time_in_planner, sampled every time the exec takes a segment
+ *
+ *	Only the machining cycle counts - not holds, homing, probing, jogging or dry plans.
+ */
+
+void mp_init_queue_stats()
+{
+    mb.starved = false;
+    mb.dry_outs = 0;
+    mb.timeout_plans = 0;
+    mb.zero_exits = 0;
+    mb.tip_samples = 0;
+    mb.tip_min = 0;
+    mb.tip_max = 0;
+    mb.tip_total = 0;
+}
+
+static bool _in_machining_cycle()
 {
-//    if (((mb.time_in_run + mb.time_locked) > MIN_PLANNED_TIME) && !mb.needs_time_accounting)
-//        return;
+    return ((cm.cycle_state == CYCLE_MACHINING) && (cm.hold_state == FEEDHOLD_OFF) && !mp_dry_plan_is_active());
+}
+
+static void _sample_time_in_planner()
+{
+    if (!_in_machining_cycle()) {
+        return;
+    }
+    float time_in_planner = mb.time_in_planner;
+    if (mb.tip_samples == 0) {
+        mb.tip_min = time_in_planner;
+        mb.tip_max = time_in_planner;
+    } else {
+        mb.tip_min = min((float)mb.tip_min, time_in_planner);
+        mb.tip_max = max((float)mb.tip_max, time_in_planner);
+    }
+    mb.tip_total += time_in_planner;
+    mb.tip_samples++;
+}
 
+/*
+ * _planner_time_accounting() - lock blocks up to MIN_PLANNED_TIME and update mb.time_in_planner
+ *
+ *	The total comes from the running sums, so only the blocks up to MIN_PLANNED_TIME are walked.
+ */
+static void _planner_time_accounting()
+{
     mpBuf_t *bf = mp_get_first_buffer();  // potential to return a NULL buffer
     mpBuf_t *bp = bf;
 
     if (bf == NULL) {
         mb.time_in_planner = 0;
+        _sample_time_in_planner();
         return;
     }
 
     float time_in_planner = mb.time_in_run; // start with how much time is left in the runtime
 
-    // Now step through the moves and add up the planner time, locking up until MIN_PLANNED_TIME
-    while ((bp = mp_get_next_buffer(bp)) != bf && bp != mb.q) {
-        if (bp->buffer_state == MP_BUFFER_QUEUED) {
-            if (!bp->locked) {
-                if (time_in_planner < MIN_PLANNED_TIME) {
-                    bp->locked = true;
-                }
-            } // !locked
-
-            // move on, it's already locked
-            time_in_planner += bp->real_move_time;
-
-        } else {
+    // step through the moves locking up until MIN_PLANNED_TIME
+    while ((time_in_planner < MIN_PLANNED_TIME) && ((bp = mp_get_next_buffer(bp)) != bf) && (bp != mb.q)) {
+        if (bp->buffer_state != MP_BUFFER_QUEUED) {
             break;
         }
+        if (!bp->locked) {
+            if (bp->plan_seq & 1) {
+                break;                      // the planner is writing this block
+            }
+            mp_finalize_trapezoid(bp);      // generate the trapezoid now that it's final
+            bp->locked = true;
+        }
+        time_in_planner += bp->real_move_time;
     };
-    mb.time_in_planner = time_in_planner;
+    mb.time_in_planner = _get_time_in_planner();
+    _sample_time_in_planner();
 }
 
 #if 0
@@ -30,6 +30,8 @@
 #define PLANNER_H_ONCE
 
 #include "canonical_machine.h"	// used for GCodeState_t
+#include "gpio.h"				// used for io_event_t
+#include "util.h"				// used for fxpos_t
 
 /*
  * Enums and other type definitions
@@ -47,6 +49,8 @@ typedef enum {                      // bf->buffer_state values
 typedef enum {				        // bf->move_type values
     MOVE_TYPE_NULL = 0,		        // null move - does a no-op
     MOVE_TYPE_ALINE,		        // acceleration planned line
+    MOVE_TYPE_ARC,                  // acceleration planned arc or helix
+    MOVE_TYPE_SPLINE,               // acceleration planned cubic spline (G5)
     MOVE_TYPE_DWELL,                // delay with no movement
     MOVE_TYPE_COMMAND,              // general command
     MOVE_TYPE_TOOL,                 // T command
@@ -61,6 +65,24 @@ typedef enum {
     MOVE_RUN                        // general run state (for non-acceleration moves)
 } moveState;
 
+typedef enum {                      // mr.sync_state values - see _start_spindle_sync()
+    SYNC_OFF = 0,                   // not locked to the spindle (MUST BE ZERO)
+    SYNC_WAIT,                      // first move of a thread is waiting at its start for the index
+    SYNC_RUN                        // locked to the spindle
+} mpSyncState;
+
+typedef enum {                      // mb.dry_plan values - see mp_start_dry_plan()
+    DRY_PLAN_OFF = 0,               // normal operation (MUST BE ZERO)
+    DRY_PLAN_ON,                    // blocks are timed and dropped by the exec instead of run
+    DRY_PLAN_ENDING                 // taking the rest of the queue, lookahead or not
+} mpDryPlan;
+
+typedef enum {                      // mb.plan_pass values - see mp_plan_block_list()
+    PLAN_PASS_IDLE = 0,             // no pass in progress (MUST BE ZERO)
+    PLAN_PASS_BACKWARD,             // out of budget in the backward pass
+    PLAN_PASS_FORWARD               // out of budget in the forward pass
+} mpPlanPass;
+
 typedef enum {
     SECTION_HEAD = 0,               // acceleration
     SECTION_BODY,                   // cruise
@@ -68,6 +90,8 @@ typedef enum {
 } moveSection;
 #define SECTIONS 3
 
+#define mp_move_type_is_planned(t) (((t) == MOVE_TYPE_ALINE) || ((t) == MOVE_TYPE_ARC) || ((t) == MOVE_TYPE_SPLINE)) // has a trapezoid
+
 typedef enum {
     SECTION_OFF = 0,                // section inactive
     SECTION_NEW,                    // uninitialized section
@@ -80,31 +104,117 @@ typedef enum {
 /* PLANNER_BUFFER_POOL_SIZE
  *	Should be at least the number of buffers requires to support optimal
  *	planning in the case of very short lines or arc segments.
- *	Suggest 12 min. Limit is 255
+ *	Suggest 12 min. Limit is 255. May be overridden per platform in the Makefile
+ *
+ * PLANNER_CONTEXT_POOL_SIZE
+ *	Number of shared Gcode contexts (see mpGcodeContext_t). A new context is only
+ *	consumed when the slow-changing Gcode state changes between blocks, so this can
+ *	be much smaller than the buffer pool. Planner buffers are reported as unavailable
+ *	if fewer than PLANNER_CONTEXT_HEADROOM contexts are free. Limit is 255
  */
+#ifndef PLANNER_BUFFER_POOL_SIZE
 #define PLANNER_BUFFER_POOL_SIZE 28
+#endif
 #define PLANNER_BUFFER_HEADROOM 4                   // buffers to reserve in planner before processing new input line
 
+#ifndef PLANNER_CONTEXT_POOL_SIZE
+#define PLANNER_CONTEXT_POOL_SIZE 8
+#endif
+#define PLANNER_CONTEXT_HEADROOM 2                  // contexts needed to process a new input line (G28/G30 use 2)
+
+#define MP_AUX_COMMANDS_MAX 32                      // aux and stop commands waiting for or carried by blocks - power of 2
+
 #define JERK_MULTIPLIER			((float)1000000)	// DO NOT CHANGE - must always be 1 million
 #define JERK_MATCH_TOLERANCE	((float)1000)		// precision to which jerk must match to be considered effectively the same
 
 #define MIN_SEGMENT_USEC 		((float)750)		// minimum segment time (also minimum move time)
-#define NOM_SEGMENT_USEC 		((float)1500)		// nominal segment time
+#define NOM_SEGMENT_USEC 		((float)1500)		// nominal segment time (heads and tails)
+#ifdef __LONG_SEGMENTS
+#define MAX_SEGMENT_USEC 		((float)6000)		// maximum segment time - also sizes DDA_SUBSTEPS
+#else
+#define MAX_SEGMENT_USEC 		NOM_SEGMENT_USEC	// $bst may only shorten bodies, at full substep resolution
+#endif
+#ifndef BODY_SEGMENT_USEC
+#define BODY_SEGMENT_USEC 		NOM_SEGMENT_USEC	// default segment time for constant velocity bodies ($bst)
+#endif
+#define PRESSURE_ADVANCE_MAX	((float)1.0)		// seconds - upper limit for $apa ($bpa, $cpa)
+#ifndef SHORT_DWELL_USEC
+#define SHORT_DWELL_USEC		((float)100000)		// dwells up to this long are timed in DDA ticks, not on the dwell timer
+#endif
 
 #define MIN_PLANNED_USEC		((float)20000)		// minimum time in the planner below which we must replan immediately
 #define PHAT_CITY_USEC			((float)80000)		// if you have at least this much time in the planner,
 
 // Note that PLANNER_TIMEOUT is in milliseconds (seconds/1000), not microseconds (usec) like the above!
 #define PLANNER_TIMEOUT_MS		(50)				// Max amount of time to wait between replans
+#define PLANNER_TIMEOUT_USEC	((uint32_t)PLANNER_TIMEOUT_MS * 1000)	// the same on the microsecond clock the timers run on
+#define PLANNER_STARTUP_BLOCKS	(8)					// blocks to wait for at the incoming rate before starting a cycle - see _set_planner_timer()
 // PLANNER_TIMEOUT should be < (MIN_PLANNED_USEC/1000) - (max time to replan)
 // ++++++++ NOT SURE THIS IS STILL OPERATIVE ++++++++ ash)
+#ifndef PLANNER_BLOCKS_PER_CALL
+#define PLANNER_BLOCKS_PER_CALL	32					// blocks visited per mp_plan_block_list() call, both passes. Limit is 255
+#endif
 
 //#define CORNER_TIME_QUANTUM 0.0000025               // (1.0/400000.0)  // one clock tick
 #define JUNCTION_AGGRESSION     0.25               // Actually this # divided by 1 million
+#ifndef COALESCE_ANGLE
+#define COALESCE_ANGLE          0.0                // degrees. Merge collinear feed moves below this angle. 0 disables
+#endif
+#ifndef FEED_SMOOTHING_WINDOW
+#define FEED_SMOOTHING_WINDOW   0                  // blocks. Level the feed over runs of short blocks ($sw). 0 disables
+#endif
+#ifndef VELOCITY_HINTS
+#define VELOCITY_HINTS          0                  // plan the newest block to its (VEX) exit hint ($vh). 0 disables
+#endif
+/* Motion profile for heads and tails - select per machine (e.g. make MOTION_PROFILE=7)
+ *
+ *	PROFILE_JERK_CONTINUOUS is the quintic velocity curve (5th order forward differences).
+ *	Jerk is zero at the section ends but snap is not.
+ *	PROFILE_SNAP_CONTINUOUS is a septic curve with zero acceleration, jerk and snap at the
+ *	section ends, so it excites less resonance. Its peak jerk is 1.30x that of the quintic for
+ *	the same section time, so the planning jerk is scaled down by PROFILE_JERK_FACTOR to keep
+ *	the peak jerk at the configured jerk_max.
+ */
+#define PROFILE_JERK_CONTINUOUS 5
+#define PROFILE_SNAP_CONTINUOUS 7
+#ifndef MOTION_PROFILE
+#define MOTION_PROFILE PROFILE_JERK_CONTINUOUS
+#endif
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS)
+#define PROFILE_JERK_FACTOR     ((float)0.76846)    // peak jerk ratio: 5.7735 (quintic) / 7.5132 (septic)
+#else
+#define PROFILE_JERK_FACTOR     ((float)1.0)
+#endif
+
+/* Fixed point exec - select per platform (make FIXED_POINT=1, the default on chips with no FPU)
+ *
+ *	FIXED_POINT_EXEC runs the head and tail forward differences as exact integers, and the prep
+ *	substep and accumulator correction math in integers - see _init_fx_diffs() and the
+ *	fixed-point kernels in util.h. The float code is the reference, and is what the host builds.
+ *	The integer differences grow as (2n)^D for n segments of a degree D profile, so longer
+ *	sections fall back to the float differences.
+ */
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS)
+#define FX_DIFF_MAX_SEGMENTS	128					// (2n)^7 must fit an int64 with room for the sums
+#else
+#define FX_DIFF_MAX_SEGMENTS	2048				// (2n)^5 - 3 seconds of head or tail
+#endif
+
+#define OVERRIDE_RAMP_RATE		((float)1.0)		// max change per second of the override factor applied by the exec
+#define OVERRIDE_RAMP_JERK		((float)4.0)		// max change per second of that rate - the ramp is jerk limited
+
+#define SPINDLE_SYNC_CORRECTION_TIME ((float)(0.050/60))// minutes to take out a synchronized move's position error
+#define SPINDLE_SYNC_OVERRIDE_MAX	((float)1.25)		// fastest a synchronized move may run over its planned feed to catch up
+#define SPINDLE_SYNC_WAIT_USEC	NOM_SEGMENT_USEC		// segment time while waiting for the spindle index
+
+#ifndef PLANNER_LOOKAHEAD_MS
+#define PLANNER_LOOKAHEAD_MS    0.0                // ms of planned motion to admit input up to. 0 admits by buffer count only
+#endif
 
 //*** derived definitions - do not change ***
 #define MIN_SEGMENT_TIME 		(MIN_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
 #define NOM_SEGMENT_TIME 		(NOM_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
+#define MAX_SEGMENT_TIME 		(MAX_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
 #define MIN_PLANNED_TIME        (MIN_PLANNED_USEC / MICROSECONDS_PER_MINUTE)
 #define PHAT_CITY_TIME          (PHAT_CITY_USEC / MICROSECONDS_PER_MINUTE)
 #define MIN_SEGMENT_TIME_PLUS_MARGIN ((MIN_SEGMENT_USEC+1) / MICROSECONDS_PER_MINUTE)
@@ -130,6 +240,52 @@ typedef enum {
 
 // All the enums that equal zero must be zero. Don't change this
 
+typedef struct mpGcodeState {       // Gcode model state that can change on every block
+    uint32_t linenum;               // Gcode block line number
+    float target[AXES];             // XYZABC where the move should go
+    float move_time;                // optimal time for move given axis constraints
+    float feed_rate;                // F - normalized to millimeters/minute or in inverse time mode
+#ifdef __VELOCITY_HINTS
+    float exit_hint;                // exit velocity the rest of the program allows (mm/min), 0=none
+#endif
+    uint8_t motion_mode;            // Group1: G0, G1, G2, G3, G38.2, G80, G81...
+} mpGcodeState_t;
+
+typedef struct mpGcodeContext {     // Gcode model state that rarely changes - shared by planner buffers
+    float work_offset[AXES];        // offset from the work coordinate system (for reporting only)
+    float parameter;                // P - parameter used for dwell time in seconds, G10 coord select...
+    uint8_t feed_rate_mode;         // See cmFeedRateMode for settings
+    uint8_t select_plane;           // G17,G18,G19
+    uint8_t units_mode;             // G20,G21
+    uint8_t path_control;           // G61... EXACT_PATH, EXACT_STOP, CONTINUOUS
+    uint8_t distance_mode;          // G90, G91
+    uint8_t arc_distance_mode;      // G90.1, G91.1
+    uint8_t absolute_override;      // G53
+    uint8_t coord_system;           // G54-G59
+    uint8_t tool;                   // M6 tool change
+    uint8_t tool_select;            // T value
+} mpGcodeContext_t;
+
+typedef struct mpArc {              // arc geometry of a MOVE_TYPE_ARC block - see mp_arc()
+    float radius;                   // arc radius in mm
+    float theta;                    // starting angle (as measured in plan_arc.cpp)
+    float angular_travel;           // signed travel along the arc in radians
+    uint8_t plane_axis_0;           // arc plane axis 0 - e.g. X for G17
+    uint8_t plane_axis_1;           // arc plane axis 1 - e.g. Y for G17
+    float exit_unit[AXES];          // tangent at the end of the arc, for the next junction
+} mpArc_t;
+
+#define SPLINE_TABLE_SIZE 8         // arc length samples along a spline - see mp_set_spline_table()
+#define SPLINE_TABLE_CHORDS 4       // chords summed for each sample
+
+typedef struct mpSpline {           // cubic Bezier geometry of a MOVE_TYPE_SPLINE block - see mp_spline()
+    float point[4][2];              // start, 2 control points and end, in the plane axes
+    float table[SPLINE_TABLE_SIZE]; // plane length of the curve from the start to t = (i+1)/SIZE
+    uint8_t plane_axis_0;           // plane axis 0 - X (G5 is G17 only)
+    uint8_t plane_axis_1;           // plane axis 1 - Y
+    float exit_unit[AXES];          // tangent at the end of the spline, for the next junction
+} mpSpline_t;
+
 typedef struct mpBuffer {           // See Planning Velocity Notes for variable usage
 	struct mpBuffer *pv;            // static pointer to previous buffer
 	struct mpBuffer *nx;            // static pointer to next buffer
@@ -144,12 +300,23 @@ typedef struct mpBuffer {           // See Planning Velocity Notes for variable
 	uint8_t move_code;              // byte that can be used by used exec functions
 	bool replannable;               // TRUE if move can be re-planned
     bool locked;                    // TRUE if the move is locked from replanning
-
-	float unit[AXES];				// unit vector for axis scaling & planning
-    bool unit_flags[AXES];          // set true for axes participating in the move
-    bool flag_vector[AXES];
+    volatile uint8_t plan_seq;      // odd while the planner is writing the block's plan
+    uint8_t context;                // index of the shared Gcode context in mb.cx[]
+    bool trapezoid_pending;         // TRUE if head/body/tail must be generated before the move runs
+    bool pass_through;              // TRUE if a command is planned through at speed instead of stopping
+    uint8_t aux_commands;           // aux commands run when the block starts - see mp_queue_aux_command()
+    bool aux_stop;                  // TRUE if they include a stop command - the block starts at rest
+
+	float unit[AXES];				// unit vector for axis scaling & planning (tangent at start of arcs)
+	union {
+		mpArc_t arc;				// arc geometry - MOVE_TYPE_ARC only
+		mpSpline_t spline;			// spline geometry - MOVE_TYPE_SPLINE only
+	};
+    bool flag_vector[AXES];         // command flags, or set true for axes participating in an aline
 
 	float length;					// total length of line or helix in mm
+	uint8_t kinematic_subdivisions;	// joint-space sub-chords for nonlinear kinematics (1 = IK every segment)
+	float coalesce_error;			// accumulated chord error of feed moves merged into this block
 	float head_length;
 	float body_length;
 	float tail_length;
@@ -160,18 +327,31 @@ typedef struct mpBuffer {           // See Planning Velocity Notes for variable
 
 	float entry_vmax;				// max junction velocity at entry of this move
 	float cruise_vmax;				// max cruise velocity requested for move
+	float feed_vmax;				// cruise velocity requested before overrides
+	float limit_vmax;				// axis velocity limit for the move (overrides may not exceed it)
 	float exit_vmax;				// max exit velocity possible (redundant)
 	float delta_vmax;				// max velocity difference for this move
 	float braking_velocity;			// current value for braking velocity
 
+	bool spindle_sync;				// true if the move carries a synchronized S change
+	float spindle_speed;			// S to ramp to from the tail of the move before - see spindle.cpp
+	uint8_t raster;					// raster line carried by the move - see pwm.h
+#ifdef __MOTION_OUTPUTS
+	uint8_t output_events;			// M62/M63 events that fire in the move - see gpio_take_output_events()
+	io_event_t output_event[DO_EVENTS_MAX];
+#endif
+
 	uint8_t jerk_axis;				// rate limiting axis used to compute jerk for the move
 	float jerk;						// maximum linear jerk term for this move
+	float jerk_nominal;				// jerk for the move before overrides
+	float override_factor;			// override factor the block was planned with - see _apply_override()
 	float recip_jerk;				// 1/Jm used for planning (computed and cached)
 	float cbrt_jerk;				// cube root of Jm used for planning (computed and cached)
 
-    float real_move_time;          // amount of time it'll take for the move, in us
+    float real_move_time;          // amount of time it'll take for the move, in minutes
+    uint32_t queued_time;           // real_move_time in us as counted in the queued time sums
 
-	GCodeState_t gm;				// Gcode model state - passed from model, used by planner and runtime
+	mpGcodeState_t gm;				// per-block Gcode model state - passed from model, used by planner and runtime
 
 } mpBuf_t;
 
@@ -183,15 +363,46 @@ typedef struct mpBufferPool {		// ring buffer for sub-moves
 	mpBuf_t *r;						// get/end_run_buffer pointer
     bool needs_replanned;           // mark to indicate that at least one ALINE was put in the buffer
     bool needs_time_accounting;     // mark to indicate that the buffer has changed and the times (below) may be wrong
-    bool planning;                  // the planner marks this to indicate it's (re)planning the block list
+    volatile bool exec_deferred;    // the exec backed off a block the planner was writing
     bool force_replan;              // true to indicate that we must plan, ignoring the normal timing tests
+    volatile bool override_replan;  // an override changed - re-apply it to the queued blocks
+    bool reconstrain;               // axis jerk or velocity limits changed - recompute them for the queued blocks
+
+    uint8_t plan_pass;              // mpPlanPass - a planning pass that ran out of budget
+    mpBuf_t *plan_bf;               // ...the end of its block list
+    mpBuf_t *plan_bp;               // ...the block it resumes at
+    float plan_velocity;            // ...the velocity it carries across the break
 
     volatile float time_in_run;		// time left in the buffer executed by the runtime
     volatile float time_in_planner;	// total time of the buffer
-
-    uint32_t planner_timer;         // timout to compare against SysTickTimer.getValue() to know when to force planning
+    uint32_t time_queued_in;        // us of queued move time added - written by the main loop only
+    volatile uint32_t time_queued_out; // us of queued move time removed - written by the exec only
+
+    uint32_t planner_timer;         // SysTickTimer.getMicros() time to force planning at, 0 = now
+    uint32_t startup_deadline;      // latest the planner may hold off starting a cycle (us clock)
+    uint32_t commit_time;           // SysTickTimer.getMicros() time the last planned block was committed
+    float block_interval;           // us between planned blocks, averaged - the incoming block rate
+
+    volatile uint8_t dry_plan;      // mpDryPlan
+    volatile float dry_plan_time;   // planned time of the blocks a dry plan has taken, in minutes
+
+    // starvation and lookahead telemetry for the current cycle - see mp_init_queue_stats()
+    bool starved;                   // the runtime ran dry and hasn't been given a block since
+    volatile uint16_t dry_outs;     // times the runtime ran dry
+    uint16_t timeout_plans;         // plans forced by PLANNER_TIMEOUT_MS
+    volatile uint16_t zero_exits;   // blocks run with a stop at the end that nothing asked for
+    volatile uint32_t tip_samples;  // time_in_planner samples taken
+    volatile float tip_min;         // least, most and total of the samples, in minutes
+    volatile float tip_max;
+    volatile float tip_total;
+
+    uint32_t aline_count;           // diagnostic: total alines added to the planner
+    uint32_t trapezoid_count;       // diagnostic: total trapezoids generated by replanning
 
 	mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage
+    uint8_t cx_newest;              // index of the most recently written Gcode context
+    mpGcodeContext_t cx[PLANNER_CONTEXT_POOL_SIZE];// shared Gcode context storage
+    uint32_t cx_serial[PLANNER_CONTEXT_POOL_SIZE];// write serial of each context - see mp_load_runtime_gcode_state()
 	magic_t magic_end;
 } mpBufferPool_t;
 
@@ -215,14 +426,54 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 
 	float unit[AXES];                   // unit vector for axis scaling & planning
 	float target[AXES];                 // final target for bf (used to correct rounding errors)
-	float position[AXES];               // current move position
-	float waypoint[SECTIONS][AXES];     // head/body/tail endpoints for correction
+	float position[AXES];               // current move position (float copy of position_fx)
+	fxpos_t target_fx[AXES];            // final target in fixed point - see fxpos_t in util.h
+	fxpos_t position_fx[AXES];          // current move position in fixed point
+	fxpos_t segment_target_fx[AXES];    // target of the segment being prepped (mr.gm.target is its float copy)
+	fxpos_t waypoint[SECTIONS][AXES];   // head/body/tail endpoints for correction (fixed point)
 
 	float target_steps[MOTORS];         // current MR target (absolute target as steps)
 	float position_steps[MOTORS];       // current MR position (target from previous segment)
-	float commanded_steps[MOTORS];      // will align with next encoder sample (target from 2nd previous segment)
+	float commanded_steps[MOTORS];      // target of the segment the encoder sample aligns with (latched at load)
 	float encoder_steps[MOTORS];        // encoder position in steps - ideally the same as commanded_steps
 	float following_error[MOTORS];      // difference between encoder_steps and commanded steps
+	float segment_steps[MOTORS];        // constant travel steps per segment in the body (Cartesian only)
+	float segment_travel[AXES];         // constant travel per segment in the body
+	fxpos_t segment_travel_fx[AXES];    // the same in fixed point
+#ifdef __PRESSURE_ADVANCE
+	float advance_steps[MOTORS];        // pressure advance in the last segment target (extruder motors only)
+#endif
+#ifdef __TORCH_HEIGHT
+	float thc_offset;                   // torch height Z correction in the last segment target (mm)
+	float thc_time;                     // minutes cut since the torch came on - see _thc_segment()
+#endif
+
+	uint8_t kn_subdivisions;            // joint-space interpolation for nonlinear kinematics (1 = off)
+	uint8_t kn_index;                   // sub-chord currently being interpolated
+	float kn_length;                    // length of each sub-chord
+	fxpos_t kn_start[AXES];             // start position of the move (fixed point)
+	float kn_start_steps[MOTORS];       // IK solution at the start of the current sub-chord
+	float kn_end_steps[MOTORS];         // IK solution at the end of the current sub-chord
+
+	bool arc_move;                      // true if the move is a MOVE_TYPE_ARC or MOVE_TYPE_SPLINE block
+	bool spline_move;                   // true if the move is a MOVE_TYPE_SPLINE block
+	union {
+		mpArc_t arc;                    // copy of the block's arc geometry
+		mpSpline_t spline;              // copy of the block's spline geometry
+	};
+	float arc_length;                   // length of the arc block
+	float arc_distance;                 // distance travelled along the arc
+	fxpos_t arc_start[AXES];            // position at the start of the arc block (fixed point)
+	float arc_center_0;                 // arc center in plane axis 0, relative to arc_start
+	float arc_center_1;                 // arc center in plane axis 1, relative to arc_start
+	float arc_error_0;                  // end of the circle vs. the target in plane axis 0
+	float arc_error_1;                  // end of the circle vs. the target in plane axis 1
+	float arc_segment_length;           // longest segment within chordal tolerance, 0 for no limit
+	float arc_vector_0;                 // radius vector at the last arc segment in plane axis 0
+	float arc_vector_1;                 // radius vector at the last arc segment in plane axis 1
+	float arc_segment_cos;              // cos of the angle turned by each body segment
+	float arc_segment_sin;              // sin of the angle turned by each body segment
+	uint8_t arc_anchor_count;           // body segments left until the vector is recomputed
 
 	float head_length;                  // copies of bf variables of same name
 	float body_length;
@@ -236,6 +487,23 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 	uint32_t segment_count;             // count of running segments
 	float segment_velocity;             // computed velocity for aline segment
 	float segment_time;                 // actual time increment per aline segment
+	float override;                     // override factor applied to the time base (ramped to the target)
+	float override_rate;                // rate the override is ramping at, per second
+	float override_max;                 // highest override the running block's velocity and jerk limits allow
+	uint8_t raster;                     // raster line (or RASTER_STOP) to hand over with the next segment
+#ifdef __MOTION_OUTPUTS
+	uint8_t output_events;              // output events carried by the move - see _prep_outputs()
+	uint8_t output_next;                // next event to hand to the loader
+	float output_to_go;                 // distance left to run at the end of the last segment
+	io_event_t output_event[DO_EVENTS_MAX];
+#endif
+#ifdef __THREADING
+	uint8_t sync_state;                 // spindle synchronized motion (G33) - see mpSyncState
+	uint32_t sync_index;                // index pulse the thread is measured from
+	float sync_revolutions;             // revolutions taken by the thread before this move
+	float sync_distance;                // distance run in this move
+	float sync_wait_time;               // uSec waited for the index
+#endif
 	float jerk;                         // max linear jerk
 
 	float forward_diff_1;               // forward difference level 1
@@ -243,16 +511,151 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 	float forward_diff_3;               // forward difference level 3
 	float forward_diff_4;               // forward difference level 4
 	float forward_diff_5;               // forward difference level 5
+#if (MOTION_PROFILE == PROFILE_SNAP_CONTINUOUS)
+	float forward_diff_6;               // forward difference level 6
+	float forward_diff_7;               // forward difference level 7
+#endif
+#ifdef FIXED_POINT_EXEC
+	bool fx_diffs;                      // true if the section runs the fixed point differences
+	float fx_diff_scale;                // velocity per count of fx_diff[1]
+	int64_t fx_diff[MOTION_PROFILE+1];  // fixed point forward differences - fx_diff[1] is the first
+#endif
 
 	GCodeState_t gm;                    // gcode model state currently executing
+	uint32_t context_serial;            // serial of the shared Gcode context unpacked in gm, 0=none
 
 	magic_t magic_end;
 } mpMoveRuntimeSingleton_t;
 
+#ifdef __PLANNER_PROFILE
+typedef struct mpProfileTimer {     // CPU time of a profiled function - see mp_profile_time()
+    uint32_t count;                 // calls
+    uint32_t max;                   // longest call in CPU cycles
+    uint64_t total;                 // total CPU cycles
+} mpProfileTimer_t;
+
+typedef struct mpProfile {          // planner profile - see planner.cpp and run_bench()
+    mpProfileTimer_t dispatch;      // command lines read and dispatched, less planning
+    mpProfileTimer_t aline;         // mp_aline()
+    mpProfileTimer_t plan;          // mp_plan_block_list()
+    mpProfileTimer_t exec;          // mp_exec_move() calls that prepped a segment - written by the exec only
+    volatile uint32_t moves;        // lines and arcs run to completion - written by the exec only
+    volatile uint32_t dips;         // moves that ended well below the junction velocity the next one allowed
+    volatile float job_time;        // planned time of the moves and dwells run, in minutes
+} mpProfile_t;
+#endif
+
+#ifdef __MOTION_TRACE
+/* MOTION_TRACE_SIZE
+ *	Records held in the motion trace ring - see planner.cpp. A record is 40 bytes with
+ *	6 motors. At one segment every 1.5 ms 256 records is the last third of a second or so.
+ */
+#ifndef MOTION_TRACE_SIZE
+#define MOTION_TRACE_SIZE 256
+#endif
+
+typedef enum {                      // mpTraceRecord_t type values
+    MP_TRACE_SEGMENT = 0,           // a segment prepped by the exec
+    MP_TRACE_PLAN,                  // a block (re)planned by mp_plan_block_list()
+    MP_TRACE_RUN                    // a block taken by the exec, with its final trapezoid
+} mpTraceType;
+
+#define MP_TRACE_REPLANNABLE    0x01    // mpTraceRecord_t flags - the block's planning flags
+#define MP_TRACE_LOCKED         0x02
+#define MP_TRACE_PASS_THROUGH   0x04
+#define MP_TRACE_STEP_SCALE     64      // steps are recorded in 1/64ths - +/-512 steps per segment
+
+typedef struct mpTraceRecord {      // one motion trace record - dumped as-is, little endian
+    uint32_t time;                  // hw_get_cycles() when recorded
+    uint32_t linenum;               // Gcode line number of the block
+    uint8_t type;                   // mpTraceType
+    uint8_t section;                // segments: moveSection, blocks: moveType
+    uint8_t flags;                  // blocks: MP_TRACE_xxx flags
+    uint8_t spare;
+    union {
+        struct {
+            float velocity;                 // mr.segment_velocity
+            int16_t steps[MOTORS];          // travel handed to the DDA, in MP_TRACE_STEP_SCALE steps
+            int16_t following_error[MOTORS];// encoder following error, in MP_TRACE_STEP_SCALE steps
+        } segment;
+        struct {
+            float entry_velocity;
+            float cruise_velocity;
+            float exit_velocity;
+            float braking_velocity;
+            float move_time;                // real_move_time, in minutes (0 until the trapezoid is built)
+        } block;
+    };
+} mpTraceRecord_t;
+
+typedef struct mpTrace {            // motion trace ring - see mp_trace_start()
+    volatile bool recording;        // records are taken while set
+    volatile bool dump;             // a dump has been asked for - see rpt_trace_dump_callback()
+    uint16_t next;                  // ring index the next record goes to
+    uint16_t count;                 // records held, up to MOTION_TRACE_SIZE
+    mpTraceRecord_t record[MOTION_TRACE_SIZE];
+} mpTrace_t;
+#endif
+
+#ifdef __LINE_TIMES
+/* LINE_TIME_RECORDS
+ *	Finished lines held until the host takes them - see mp_line_time_block(). A record is
+ *	20 bytes. They go out LINE_TIME_BATCH at a time, so the ring only has to cover the
+ *	lines run while the host is slow to read.
+ */
+#ifndef LINE_TIME_RECORDS
+#define LINE_TIME_RECORDS       64
+#endif
+#define LINE_TIME_BATCH         12      // records in a full frame - 4 + 12*20 payload bytes
+#ifndef LINE_TIME_FLUSH_MS
+#define LINE_TIME_FLUSH_MS      1000    // a part batch goes out when the oldest record is this old
+#endif
+#ifndef LINE_TIME_LIMITED
+#define LINE_TIME_LIMITED       1.10    // executed over nominal time that flags a line velocity limited
+#endif
+#define LINE_TIME_OVERRAN       1.01    // executed over planned time that flags a line overran - above rounding
+
+#define MP_LINE_VELOCITY_LIMITED 0x01   // mpLineTime_t flags - ran LINE_TIME_LIMITED longer than at its feed
+#define MP_LINE_OVERRAN         0x02    // ran LINE_TIME_OVERRAN longer than planned - a feedhold, override or stall
+
+typedef struct mpLineTime {         // one line's time - sent as-is, little endian
+    uint32_t linenum;               // Gcode line number (N word or line count)
+    uint32_t executed;              // segment time run, after overrides, in us
+    uint32_t planned;               // real_move_time of its blocks as they started, in us
+    uint32_t nominal;               // time at the programmed feed within the axis limits (gm.move_time), in us
+    uint16_t blocks;                // planner blocks run for the line
+    uint8_t flags;                  // MP_LINE_xxx flags
+    uint8_t spare;
+} mpLineTime_t;
+
+typedef struct mpLineTimes {        // per-line time accounting - see mp_line_time_start()
+    volatile bool enabled;
+    uint32_t linenum;               // the line the exec is running - written by the exec only
+    uint16_t blocks;
+    float executed;                 // its times so far, in minutes
+    float planned;
+    float nominal;
+    const mpBuf_t *block;           // the last block counted, so a block restarted after a hold isn't counted twice
+    volatile uint16_t head;         // next record to write - written by the exec only
+    volatile uint16_t tail;         // next record to send - written by the main loop only
+    volatile uint32_t dropped;      // records lost to a full ring
+    mpLineTime_t record[LINE_TIME_RECORDS];
+} mpLineTimes_t;
+#endif
+
 // Reference global scope structures
 extern mpBufferPool_t mb;               // move buffer queue
 extern mpMoveMasterSingleton_t mm;      // context for line planning
 extern mpMoveRuntimeSingleton_t mr;     // context for line runtime
+#ifdef __PLANNER_PROFILE
+extern mpProfile_t mp_prof;             // planner profile
+#endif
+#ifdef __MOTION_TRACE
+extern mpTrace_t mp_trace;              // motion trace ring
+#endif
+#ifdef __LINE_TIMES
+extern mpLineTimes_t mp_line_times;     // per-line time accounting
+#endif
 
 /*
  * Global Scope Functions
@@ -273,6 +676,13 @@ void mp_set_steps_to_runtime_position(void);
 
 //void mp_queue_command(void(*cm_exec_t)(float[], float[]), float *value, float *flag);
 void mp_queue_command(void(*cm_exec_t)(float[], bool[]), float *value, bool *flag);
+void mp_queue_pass_through_command(void(*cm_exec_t)(float[], bool[]), float *value, bool *flag);
+void mp_queue_aux_command(void(*cm_exec_t)(float[], bool[]), float *value, bool *flag);
+void mp_queue_stop_command(void(*cm_exec_t)(float[], bool[]), float *value, bool *flag);
+bool mp_aux_commands_pending(void);
+void mp_run_aux_commands(mpBuf_t *bf);
+stat_t mp_prep_stop_command(mpBuf_t *bf);
+stat_t mp_aux_command_callback(void);
 stat_t mp_runtime_command(mpBuf_t *bf);
 
 stat_t mp_dwell(const float seconds);
@@ -282,7 +692,17 @@ stat_t mp_exec_out_of_band_dwell(void);
 
 void mp_init_buffers(void);                             // planner buffer handlers...
 uint8_t mp_get_planner_buffers_available(void);
+bool mp_planner_is_full(void);
+void mp_queue_buffer(mpBuf_t *bf);
+void mp_update_queued_time(mpBuf_t *bf);
+void mp_finalize_queued_time(mpBuf_t *bf);
+void mp_dequeue_time(mpBuf_t *bf);
+void mp_unqueue_time(mpBuf_t *bf);
 mpBuf_t * mp_get_write_buffer(void);
+void mp_set_buffer_gcode_state(mpBuf_t *bf, const GCodeState_t *gm);
+void mp_get_buffer_gcode_state(const mpBuf_t *bf, GCodeState_t *gm);
+void mp_load_runtime_gcode_state(const mpBuf_t *bf);
+bool mp_buffer_gcode_state_matches(const mpBuf_t *bf, const GCodeState_t *gm);
 void mp_commit_write_buffer(const moveType move_type);
 bool mp_has_runnable_buffer();
 mpBuf_t * mp_get_run_buffer(void);
@@ -299,21 +719,61 @@ mpBuf_t * mp_get_first_buffer(void);
 #define mp_get_next_buffer(b) ((mpBuf_t *)(b->nx))
 
 stat_t mp_plan_buffer();                                // planner functions and helpers...
+float mp_get_planned_time();
 bool mp_is_it_phat_city_time();
+void mp_init_queue_stats(void);
+
+void mp_start_dry_plan(void);                           // dry plan (job time estimate)...
+float mp_end_dry_plan(void);
+#define mp_dry_plan_is_active() (mb.dry_plan != DRY_PLAN_OFF)
+
+#ifdef __PLANNER_PROFILE
+void mp_clear_profile(void);                            // planner profile...
+void mp_profile_time(mpProfileTimer_t *t, const uint32_t cycles);
+void mp_profile_move_end(const mpBuf_t *bf);
+#endif
+
+#ifdef __MOTION_TRACE
+void mp_trace_start(void);                              // motion trace...
+void mp_trace_stop(const bool dump);
+void mp_trace_segment(const float travel_steps[]);
+void mp_trace_block(const mpBuf_t *bf, const mpTraceType type);
+#endif
+
+#ifdef __LINE_TIMES
+void mp_line_time_start(void);                          // per-line time accounting...
+void mp_line_time_stop(void);
+void mp_line_time_block(const mpBuf_t *bf);
+void mp_line_time_segment(const float segment_time);
+void mp_line_time_idle(void);
+#endif
 
 // plan_line.c functions
 
 void mp_zero_segment_velocity(void);                    // getters and setters...
 float mp_get_runtime_velocity(void);
 float mp_get_runtime_absolute_position(uint8_t axis);
+float mp_get_runtime_machine_position(uint8_t axis);
 void mp_set_runtime_work_offset(float offset[]);
 float mp_get_runtime_work_position(uint8_t axis);
 uint8_t mp_get_runtime_busy(void);
 bool mp_runtime_is_idle(void);
 
 stat_t mp_aline(GCodeState_t *gm_in);                   // line planning...
-void mp_plan_block_list(mpBuf_t *bf);
+stat_t mp_arc(GCodeState_t *gm_in, const mpArc_t *arc_in, const float length);
+float mp_get_arc_velocity_max(const float radius, const uint8_t axis_0, const uint8_t axis_1);
+float mp_get_arc_segment_angle(const float radius);
+stat_t mp_spline(GCodeState_t *gm_in, const mpSpline_t *spline_in, const float length);
+float mp_set_spline_table(mpSpline_t *spline, float *min_radius);
+void mp_get_spline_point(const mpSpline_t *spline, const float fraction, float point[]);
+void mp_split_spline(mpSpline_t *spline, const float fraction);
+stat_t mp_plan_block_list(mpBuf_t *bf);
+void mp_restart_plan_pass(void);
+void mp_finalize_trapezoid(mpBuf_t *bf);
 void mp_reset_replannable_list(void);
+void mp_request_override_replan(void);
+void mp_request_reconstrain(void);
+void mp_replan_overrides(void);
 
 // plan_zoid.c functions
 void mp_calculate_trapezoid(mpBuf_t *bf);
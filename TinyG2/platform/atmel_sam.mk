@@ -70,6 +70,17 @@ SERIES:=sam4s
 
 endif
 
+# The SAM4S is a Cortex-M4 (without an FPU - floats stay soft, as on the M3). Building for it
+# lets GCC use the DSP extension; the fixed-point kernels of util.h compile for either core.
+ifeq ($(SERIES),sam4s)
+CPU = cortex-m4
+else
+CPU = cortex-m3
+endif
+
+# Neither core has an FPU, so the exec and prep default to fixed point (see FIXED_POINT in the Makefile)
+FIXED_POINT ?= 1
+
 # GCC toolchain provider
 GCC_TOOLCHAIN = gcc
 
@@ -102,18 +113,18 @@ DEVICE_LIBS          = gcc c
 # ---------------------------------------------------------------------------------------
 # C Flags (NOT CPP flags)
 
-DEVICE_CFLAGS := -D__$(CHIP)__ --param max-inline-insns-single=500 -mcpu=cortex-m3 -mthumb -mlong-calls -ffunction-sections -fdata-sections -nostdlib -std=gnu99 -u _printf_float
+DEVICE_CFLAGS := -D__$(CHIP)__ --param max-inline-insns-single=500 -mcpu=$(CPU) -mthumb -mlong-calls -ffunction-sections -fdata-sections -nostdlib -std=gnu99 -u _printf_float
 
 
 # ---------------------------------------------------------------------------------------
 # CPP Flags
 
-DEVICE_CPPFLAGS := -D__$(CHIP)__ --param max-inline-insns-single=500 -mcpu=cortex-m3 -mthumb -mlong-calls -ffunction-sections -fdata-sections -fno-rtti -std=c++11 -fno-exceptions -u _printf_float
+DEVICE_CPPFLAGS := -D__$(CHIP)__ --param max-inline-insns-single=500 -mcpu=$(CPU) -mthumb -mlong-calls -ffunction-sections -fdata-sections -fno-rtti -std=c++11 -fno-exceptions -u _printf_float
 
 # ---------------------------------------------------------------------------------------
 # Linker Flags
 
-DEVICE_LDFLAGS := -nostartfiles -mcpu=cortex-m3 --specs=nano.specs  -u _printf_float  -mthumb 
+DEVICE_LDFLAGS := -nostartfiles -mcpu=$(CPU) --specs=nano.specs  -u _printf_float  -mthumb 
 
-DEVICE_ASFLAGS  := -D__$(CHIP)__ -mcpu=cortex-m3 -mthumb
+DEVICE_ASFLAGS  := -D__$(CHIP)__ -mcpu=$(CPU) -mthumb
 
@@ -137,6 +137,26 @@ namespace Motate {
     pin_number kSocket6_Microstep_2PinNumber    =  -1;
     pin_number kSocket6_VrefPinNumber           =  -1;//67; //PWMTimer<0>
 
+    pin_number kSocket7_SPISlaveSelectPinNumber =  -1;
+    pin_number kSocket7_InterruptPinNumber      =  -1;
+    pin_number kSocket7_StepPinNumber           =  -1;
+    pin_number kSocket7_DirPinNumber            =  -1;
+    pin_number kSocket7_EnablePinNumber         =  -1;
+    pin_number kSocket7_Microstep_0PinNumber    =  -1;
+    pin_number kSocket7_Microstep_1PinNumber    =  -1;
+    pin_number kSocket7_Microstep_2PinNumber    =  -1;
+    pin_number kSocket7_VrefPinNumber           =  -1;
+
+    pin_number kSocket8_SPISlaveSelectPinNumber =  -1;
+    pin_number kSocket8_InterruptPinNumber      =  -1;
+    pin_number kSocket8_StepPinNumber           =  -1;
+    pin_number kSocket8_DirPinNumber            =  -1;
+    pin_number kSocket8_EnablePinNumber         =  -1;
+    pin_number kSocket8_Microstep_0PinNumber    =  -1;
+    pin_number kSocket8_Microstep_1PinNumber    =  -1;
+    pin_number kSocket8_Microstep_2PinNumber    =  -1;
+    pin_number kSocket8_VrefPinNumber           =  -1;
+
 
     pin_number kInput1_PinNumber              =  14;
     pin_number kInput2_PinNumber              =  15;
@@ -157,6 +177,10 @@ namespace Motate {
     pin_number kSpindle_PwmPinNumber            =  11;
     pin_number kSpindle_Pwm2PinNumber           =   9;
     pin_number kCoolant_EnablePinNumber         =  57;
+    pin_number kOutput1_PinNumber               =  34;  // M62-M65 outputs (Due D34, DAC0, DAC1, CANRX)
+    pin_number kOutput2_PinNumber               =  66;
+    pin_number kOutput3_PinNumber               =  67;
+    pin_number kOutput4_PinNumber               =  68;
 
     pin_number kSD_CardDetectPinNumber          =  -1;
     pin_number kInterlock_InPinNumber           =  -1;
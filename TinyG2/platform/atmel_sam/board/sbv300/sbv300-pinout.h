@@ -125,12 +125,36 @@ namespace Motate {
     pin_number kSocket6_Microstep_2PinNumber    =  -1;
     pin_number kSocket6_VrefPinNumber           =  -1;
 
+    pin_number kSocket7_SPISlaveSelectPinNumber =  -1;
+    pin_number kSocket7_InterruptPinNumber      =  -1;
+    pin_number kSocket7_StepPinNumber           =  -1;
+    pin_number kSocket7_DirPinNumber            =  -1;
+    pin_number kSocket7_EnablePinNumber         =  -1;
+    pin_number kSocket7_Microstep_0PinNumber    =  -1;
+    pin_number kSocket7_Microstep_1PinNumber    =  -1;
+    pin_number kSocket7_Microstep_2PinNumber    =  -1;
+    pin_number kSocket7_VrefPinNumber           =  -1;
+
+    pin_number kSocket8_SPISlaveSelectPinNumber =  -1;
+    pin_number kSocket8_InterruptPinNumber      =  -1;
+    pin_number kSocket8_StepPinNumber           =  -1;
+    pin_number kSocket8_DirPinNumber            =  -1;
+    pin_number kSocket8_EnablePinNumber         =  -1;
+    pin_number kSocket8_Microstep_0PinNumber    =  -1;
+    pin_number kSocket8_Microstep_1PinNumber    =  -1;
+    pin_number kSocket8_Microstep_2PinNumber    =  -1;
+    pin_number kSocket8_VrefPinNumber           =  -1;
+
     // SPINDLE ON 1 = B 15
     // PERMISSIVE 4 = D 7
     pin_number kSpindle_EnablePinNumber         =  14;  // TODO enable spindle
     pin_number kSpindle_DirPinNumber            =  15;
 
     pin_number kCoolant_EnablePinNumber         =  -1;
+    pin_number kOutput1_PinNumber               =  -1;
+    pin_number kOutput2_PinNumber               =  -1;
+    pin_number kOutput3_PinNumber               =  -1;
+    pin_number kOutput4_PinNumber               =  -1;
 
     pin_number kSpindle_PwmPinNumber            =  -1;
     pin_number kSpindle_Pwm2PinNumber           =  -1;
@@ -137,6 +137,28 @@ namespace Motate {
 	pin_number kSocket6_Microstep_2PinNumber    = 67;
 	pin_number kSocket6_VrefPinNumber           = 68;
 
+	// Sockets 7 and 8 are for v9-class boards with more than 6 motors (build with MOTORS=8).
+	// They are null until the board pinout maps them.
+	pin_number kSocket7_SPISlaveSelectPinNumber = 70;
+	pin_number kSocket7_InterruptPinNumber      = 71;
+	pin_number kSocket7_StepPinNumber           = 72;
+	pin_number kSocket7_DirPinNumber            = 73;
+	pin_number kSocket7_EnablePinNumber         = 74;
+	pin_number kSocket7_Microstep_0PinNumber    = 75;
+	pin_number kSocket7_Microstep_1PinNumber    = 76;
+	pin_number kSocket7_Microstep_2PinNumber    = 77;
+	pin_number kSocket7_VrefPinNumber           = 78;
+
+	pin_number kSocket8_SPISlaveSelectPinNumber = 80;
+	pin_number kSocket8_InterruptPinNumber      = 81;
+	pin_number kSocket8_StepPinNumber           = 82;
+	pin_number kSocket8_DirPinNumber            = 83;
+	pin_number kSocket8_EnablePinNumber         = 84;
+	pin_number kSocket8_Microstep_0PinNumber    = 85;
+	pin_number kSocket8_Microstep_1PinNumber    = 86;
+	pin_number kSocket8_Microstep_2PinNumber    = 87;
+	pin_number kSocket8_VrefPinNumber           = 88;
+
 
 	pin_number kInput1_PinNumber              = 100;
 	pin_number kInput2_PinNumber              = 101;
@@ -158,6 +180,10 @@ namespace Motate {
 	pin_number kSpindle_Pwm2PinNumber           = 115;
 	pin_number kCoolant_EnablePinNumber         = 116;  // Convenient pin to hijack for debugging
 //	pin_number kCoolant_EnablePinNumber         = -1;
+	pin_number kOutput1_PinNumber               =  -1;
+	pin_number kOutput2_PinNumber               =  -1;
+	pin_number kOutput3_PinNumber               =  -1;
+	pin_number kOutput4_PinNumber               =  -1;
 
 	pin_number kLED_USBRXPinNumber              = 117;
 	pin_number kLED_USBTXPinNumber              = 118;
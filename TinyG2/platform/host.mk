@@ -0,0 +1,27 @@
+# ----------------------------------------------------------------------------
+#         Native host (simulator) build - see platform/host/host.h
+# ----------------------------------------------------------------------------
+#
+# Builds the firmware with the host's own gcc: Motate runs on simulated timers,
+# pins and USB (motate/utility/Host*.h) and platform/host stands in for the chip.
+
+include platform/make_utilities.mk
+
+NATIVE_BUILD = 1
+CROSS_COMPILE =
+
+HOST_SOURCE_DIRS += platform/host
+
+DEVICE_RULES = $(call CREATE_DEVICE_LIBRARY,HOST,host)
+
+DEVICE_INCLUDE_DIRS += ./platform/host
+DEVICE_INCLUDE_DIRS += ./platform/atmel_sam
+
+DEVICE_LIBS          = m
+
+DEVICE_CFLAGS := -D__HOST__ -std=gnu99
+
+# The simulator is where planner and protocol changes get measured, so it always has the benchmarks
+DEVICE_CPPFLAGS := -D__HOST__ -D__PLANNER_PROFILE -D__JSON_BENCH -D__MOTION_TRACE -D__LINE_TIMES -D__PLANNER_STATS -D__VELOCITY_HINTS -fno-rtti -std=c++11 -fno-exceptions
+
+DEVICE_LDFLAGS :=
@@ -0,0 +1,212 @@
+/*
+ * host.cpp - native host (simulator) platform
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ *	The chip services the firmware calls directly, done natively. See host.h for usage.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "host_cmsis.h"
+#include "host.h"
+#include "MotateTimers.h"
+#include "MotateUSB.h"
+#include "Reset.h"
+#include "UniqueId.h"
+
+uint32_t SystemCoreClock = 84000000;	// the Due's master clock - the DDA and dwell periods derive from it
+
+uint32_t host_flash1[IFLASH1_SIZE/4];
+Efc host_efc1 = { 0, 0, EEFC_FSR_FRDY, 0 };
+
+static FILE *trace_file = NULL;
+static FILE *block_file = NULL;
+static FILE *move_file = NULL;
+
+void SystemInit(void)
+{
+	memset(host_flash1, 0xFF, sizeof(host_flash1));	// erased flash
+}
+
+/*
+ * host_init() - open the Gcode input and the trace, block and move files named on the command line
+ */
+
+void host_init(int argc, char *argv[])
+{
+	if (argc > 1) {
+		int fd = open(argv[1], O_RDONLY);
+		if (fd < 0) {
+			perror(argv[1]);
+			exit(1);
+		}
+		Motate::hostUSBSetInput(fd);
+	}
+	if (argc > 2) {
+		if ((trace_file = fopen(argv[2], "w")) == NULL) {
+			perror(argv[2]);
+			exit(1);
+		}
+	}
+	if (argc > 3) {
+		if ((block_file = fopen(argv[3], "w")) == NULL) {
+			perror(argv[3]);
+			exit(1);
+		}
+	}
+	if (argc > 4) {
+		if ((move_file = fopen(argv[4], "w")) == NULL) {
+			perror(argv[4]);
+			exit(1);
+		}
+	}
+}
+
+/*
+ * host_trace_segment() - write one prepped segment to the trace - see host.h for the format
+ */
+
+void host_trace_segment(const float travel_steps[], const uint8_t motors, const float segment_time)
+{
+	if (trace_file == NULL)
+		return;
+
+	fprintf(trace_file, "%.0f %.3f", (double)(Motate::hostGetTime() / (SystemCoreClock / 1000000)),
+			(double)(segment_time * 60000000));
+	for (uint8_t motor=0; motor<motors; motor++) {
+		fprintf(trace_file, " %.4f", (double)travel_steps[motor]);
+	}
+	fputc('\n', trace_file);
+}
+
+/*
+ * host_trace_block() - write one block taken by a dry plan to the block file - see host.h
+ */
+
+void host_trace_block(const uint32_t linenum, const char kind, const float length,
+					  const float entry_vmax, const float exit_vmax, const float delta_vmax)
+{
+	if (block_file == NULL)
+		return;
+
+	fprintf(block_file, "%lu %c %.4f %.3f %.3f %.3f\n", (unsigned long)linenum, kind, (double)length,
+			(double)entry_vmax, (double)exit_vmax, (double)delta_vmax);
+}
+
+/*
+ * host_record_move() - write one move sent to the planner to the move file - see host.h
+ */
+
+void host_record_move(const uint32_t linenum, const uint8_t motion_mode, const float feed_rate,
+					  const float target[], const uint8_t axes)
+{
+	if (move_file == NULL)
+		return;
+
+	fprintf(move_file, "%lu %d %.9g", (unsigned long)linenum, motion_mode, (double)feed_rate);
+	for (uint8_t axis=0; axis<axes; axis++) {
+		fprintf(move_file, " %.9g", (double)target[axis]);
+	}
+	fputc('\n', move_file);
+}
+
+/*
+ * host_get_cpu_cycles() - CPU time this thread has used, counted in 84 MHz cycles
+ *
+ *	Only differences are meaningful. It wraps like the DWT counter does, every 51 seconds.
+ */
+
+uint32_t host_get_cpu_cycles(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	uint64_t ns = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	return ((uint32_t)(ns * (SystemCoreClock / 1000000) / 1000));
+}
+
+/*
+ * Reset - a hard reset or a trip to the flash loader ends the simulation
+ */
+
+void banzai(int samba)
+{
+	if (trace_file != NULL)
+		fclose(trace_file);
+	if (block_file != NULL)
+		fclose(block_file);
+	if (move_file != NULL)
+		fclose(move_file);
+	fflush(stdout);
+	exit(0);
+}
+
+static int volatile ticks = -1;
+
+void initiateReset(int _ticks) {
+	ticks = _ticks;
+}
+
+void cancelReset() {
+	ticks = -1;
+}
+
+void tickReset() {
+	if (ticks == -1)
+		return;
+	ticks--;
+	if (ticks == 0)
+		banzai(1);
+}
+
+/*
+ * Unique ID - fixed, so runs are repeatable
+ */
+
+static struct uuid stored_uuid = { 0x484f5354, 0x53494d21, 0, 0 };	// "HOSTSIM!"
+static uint16_t uuid_string16[UNIQUE_ID_STRING_LEN] = {0};
+
+void cacheUniqueId() {}
+
+struct uuid* readUniqueId()
+{
+	return &stored_uuid;
+}
+
+const uint16_t* readUniqueIdString()
+{
+	if(uuid_string16[0] == 0) {
+		for(int i = 0; i < UNIQUE_ID_STRING_LEN; ++i) {
+			unsigned long nibble = (((i >= 8) ? stored_uuid.d1 : stored_uuid.d0) >> ((i % 8) * 4)) & 0xF;
+			if(nibble < 0xA) uuid_string16[i] = nibble + '0';
+			else uuid_string16[i] = (nibble - 0xA) + 'a';
+		}
+	}
+	return uuid_string16;
+}
@@ -0,0 +1,81 @@
+/*
+ * host.h - native host (simulator) platform
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ *	PLATFORM=host builds the firmware as a native program that runs the planner, the exec
+ *	and the stepper interrupts against simulated time (see motate/utility/HostTimers.h).
+ *
+ *	  bin/host/TinyG2 [gcode_file [trace_file [block_file [move_file]]]]
+ *
+ *	Gcode is read from the file (or stdin) through the first USB serial port and responses
+ *	go to stdout. Every segment prepped by st_prep_line() is written to the trace file, one
+ *	line per segment:
+ *
+ *	  <prep time, us> <segment time, us> <motor 1 steps> ... <motor N steps>
+ *
+ *	The prep time is simulated time when the segment was prepared, which is about one
+ *	segment ahead of when it is stepped out. Steps are the travel handed to the DDA, after
+ *	backlash take-up and following error correction.
+ *
+ *	Every block a dry plan ({"dry":1}) takes is written to the block file, one line per block:
+ *
+ *	  <line number> <kind> <length, mm> <entry_vmax> <exit_vmax> <delta_vmax>
+ *
+ *	Kind is m for a line, arc or spline, p for a command planned through at the velocity of
+ *	the moves around it, and s for anything else - a stop. Velocities are mm/min. This is
+ *	what Tools/velocity_hints.py plans a whole program from.
+ *
+ *	Every move the canonical machine sends to the planner - G0, G1 and each line of an arc -
+ *	is written to the move file as it is queued:
+ *
+ *	  <line number> <motion mode> <feed rate> <target 1> ... <target N>
+ *
+ *	Targets are machine coordinates in mm, and the feed rate is mm/min (or inverse time),
+ *	to the full precision of a float. This is what Tools/gcode_precompile.py builds its
+ *	precompiled move records from.
+ *
+ *	The program exits once the input is used up and the machine has come to rest, printing
+ *	the planner benchmark report for the job on the way out - see test.cpp. {"bench":n} runs
+ *	one of the built-in programs instead.
+ */
+#ifndef HOST_H_ONCE
+#define HOST_H_ONCE
+
+#include <stdint.h>
+
+#define HOST_PASS_US		100			// simulated time per pass of the main loop
+#define HOST_IDLE_EXIT_MS	1000		// machine must rest this long after end of input to exit
+
+void host_init(int argc, char *argv[]);
+void host_trace_segment(const float travel_steps[], const uint8_t motors, const float segment_time);
+void host_trace_block(const uint32_t linenum, const char kind, const float length,
+					  const float entry_vmax, const float exit_vmax, const float delta_vmax);
+void host_record_move(const uint32_t linenum, const uint8_t motion_mode, const float feed_rate,
+					  const float target[], const uint8_t axes);
+uint32_t host_get_cpu_cycles(void);		// thread CPU time in (target) CPU cycles - see hw_get_cpu_cycles()
+
+#endif // HOST_H_ONCE
@@ -0,0 +1,65 @@
+/*
+ * host_cmsis.h - the parts of the CMSIS and SAM device headers the firmware uses directly
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2016 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ *	Stands in for sam.h in the host build. Only what is used outside the Motate layer is here:
+ *	interrupt masking (see HostTimers.cpp), and flash bank 1 and its controller for the
+ *	persistence log, which runs unchanged against a RAM image of the bank (see host.cpp).
+ */
+#ifndef HOST_CMSIS_H_ONCE
+#define HOST_CMSIS_H_ONCE
+
+#include <stdint.h>
+
+extern uint32_t SystemCoreClock;			// the simulated master clock - F_CPU
+void SystemInit(void);
+
+// interrupt masking - __enable_irq() runs anything that was requested while masked
+void __disable_irq(void);
+void __enable_irq(void);
+static inline void __NOP(void) {}
+
+// flash bank 1 and its controller (EEFC1)
+#define IFLASH1_SIZE		(0x40000u)
+#define IFLASH1_PAGE_SIZE	(256u)
+extern uint32_t host_flash1[IFLASH1_SIZE/4];
+#define IFLASH1_ADDR		((uintptr_t)host_flash1)
+
+typedef struct {
+	volatile uint32_t EEFC_FMR;
+	volatile uint32_t EEFC_FCR;				// commands are ignored - writes go straight into the image
+	volatile uint32_t EEFC_FSR;				// always ready
+	volatile uint32_t EEFC_FRR;
+} Efc;
+extern Efc host_efc1;
+#define EFC1				(&host_efc1)
+
+#define EEFC_FSR_FRDY		(0x1u << 0)
+#define EEFC_FCR_FCMD(value) ((0xffu & (value)) << 0)
+#define EEFC_FCR_FARG(value) ((0xffffu & (value)) << 8)
+#define EEFC_FCR_FKEY(value) ((0xffu & (value)) << 24)
+
+#endif // HOST_CMSIS_H_ONCE
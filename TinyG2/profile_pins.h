@@ -0,0 +1,94 @@
+/*
+ * profile_pins.h - debug pin probe points for timing with a logic analyzer or scope
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PROFILE_PINS_H_ONCE
+#define PROFILE_PINS_H_ONCE
+
+/**** Profile pins ****
+ *
+ *	With __PROFILE_PINS defined each probe point drives a pin high while its code runs:
+ *
+ *	  DDA		DDA timer interrupt (step pulses)			stepper.cpp
+ *	  LOAD		_load_move(), from the load interrupt or the DDA	stepper.cpp
+ *	  EXEC		exec software interrupt (includes PREP)		stepper.cpp
+ *	  PREP		st_prep_line()								stepper.cpp
+ *	  PLAN		mp_plan_block_list()						plan_line.cpp
+ *	  USB_RX	reading a chunk from an xio device			xio.cpp
+ *	  JSON		json_parser() - parse, execute and respond	json_parser.cpp
+ *
+ *	Each point takes its pin from PROFILE_PIN_<point>, a Motate pin number. The board's
+ *	kDebug1..4_PinNumber are the pins to use. Points left at -1 get Motate's null pin,
+ *	so their writes compile to nothing. Set the points from the build, e.g.
+ *
+ *	  make USER_DEFINES="__PROFILE_PINS PROFILE_PIN_PREP=kDebug4_PinNumber PROFILE_PIN_JSON=-1"
+ *
+ *	PROFILE_PIN_SCOPE(point) covers the rest of a block; PROFILE_PIN_ON() and PROFILE_PIN_OFF()
+ *	mark any other span with a point's pin. A point costs a port write on entry and one on
+ *	exit. Nested points (EXEC and PREP, DDA and LOAD) show how much of the outer one the inner
+ *	takes. Without __PROFILE_PINS none of this is compiled. The pin numbers are the board's, so on boards where a kDebug pin is -1
+ *	(the v9, and the host build that uses its pinout) the point stays silent.
+ */
+#ifdef __PROFILE_PINS
+
+#include "hardware.h"
+
+#ifndef PROFILE_PIN_DDA
+#define PROFILE_PIN_DDA		kDebug1_PinNumber
+#endif
+#ifndef PROFILE_PIN_LOAD
+#define PROFILE_PIN_LOAD	-1
+#endif
+#ifndef PROFILE_PIN_EXEC
+#define PROFILE_PIN_EXEC	kDebug2_PinNumber
+#endif
+#ifndef PROFILE_PIN_PREP
+#define PROFILE_PIN_PREP	-1
+#endif
+#ifndef PROFILE_PIN_PLAN
+#define PROFILE_PIN_PLAN	kDebug3_PinNumber
+#endif
+#ifndef PROFILE_PIN_USB_RX
+#define PROFILE_PIN_USB_RX	-1
+#endif
+#ifndef PROFILE_PIN_JSON
+#define PROFILE_PIN_JSON	kDebug4_PinNumber
+#endif
+
+// Sets its pin for as long as it is in scope, so every return from a function clears it
+template<int8_t pinNum>
+struct ProfilePinScope {
+	ProfilePinScope() { pin = 1; };
+	~ProfilePinScope() { pin = 0; };
+	static OutputPin<pinNum> pin;
+};
+template<int8_t pinNum> OutputPin<pinNum> ProfilePinScope<pinNum>::pin;
+
+#define PROFILE_PIN_SCOPE(point)	ProfilePinScope<PROFILE_PIN_##point> profile_pin_##point
+#define PROFILE_PIN_ON(point)		(ProfilePinScope<PROFILE_PIN_##point>::pin = 1)
+#define PROFILE_PIN_OFF(point)		(ProfilePinScope<PROFILE_PIN_##point>::pin = 0)
+
+#else
+
+#define PROFILE_PIN_SCOPE(point)
+#define PROFILE_PIN_ON(point)
+#define PROFILE_PIN_OFF(point)
+
+#endif // __PROFILE_PINS
+
+#endif // End of include guard: PROFILE_PINS_H_ONCE
@@ -31,6 +31,10 @@
 #include "spindle.h"
 #include "text_parser.h"
 #include "pwm.h"
+#include "stepper.h"
+#include "kinematics.h"
+#include "xio.h"
+#include "util.h"
 
 #ifdef __AVR
 #include <avr/interrupt.h>
@@ -137,6 +141,9 @@ ISR(PWM2_ISR_vect)
  *
  *	Assumes 32MHz clock.
  *	Doesn't turn time on until duty cycle is set
+ *
+ *	On ARM the change takes effect at the end of the running period and the duty cycle is
+ *	rescaled with it, so the output doesn't glitch - see updateFrequency() in SamTimers.h
  */
 
 stat_t pwm_set_freq(uint8_t chan, float freq)
@@ -188,6 +195,9 @@ stat_t pwm_set_freq(uint8_t chan, float freq)
  *	Setting duty cycle between 0 and 100 enables PWM channel
  *
  *	The frequency must have been set previously
+ *
+ *	On ARM this is one write of the duty register. PWM channels (PWMTimer) load it at
+ *	the end of the period, so it is safe to call from the loader or exec interrupts.
  */
 
 stat_t pwm_set_duty(uint8_t chan, float duty)
@@ -214,6 +224,151 @@ stat_t pwm_set_duty(uint8_t chan, float duty)
 }
 
 
+/***********************************************************************************
+ * RASTER SCANNING - see pwm.h
+ ***********************************************************************************/
+
+rasterSingleton_t raster;
+
+/*
+ * raster_reset() - drop all raster lines, including one the loader is running (queue flush)
+ */
+
+void raster_reset()
+{
+	st_raster_stop();
+	raster.loading = RASTER_NONE;
+	for (uint8_t i=0; i<RASTER_LINES; i++) {
+		raster.line[i].in_use = false;
+	}
+}
+
+/*
+ * raster_take_line() - hand the line loaded by $rsd to the move being planned
+ *
+ *	Returns the line (1..RASTER_LINES) or RASTER_NONE. The line stays claimed until the
+ *	loader has run it out, or the exec finds it can't be run. Only a straight feed takes the
+ *	line - a traverse leaves it for the next feed, so the G0 to the start of a raster line
+ *	doesn't use it up.
+ */
+
+uint8_t raster_take_line(uint8_t motion_mode)
+{
+	uint8_t line = raster.loading;
+	if (motion_mode != MOTION_MODE_STRAIGHT_FEED) {
+		return (RASTER_NONE);
+	}
+	if (line != RASTER_NONE) {
+		raster.line[line-1].spacing = raster.spacing;
+		raster.loading = RASTER_NONE;
+	}
+	return (line);
+}
+
+/*
+ * raster_start_line() - exec: set up the clock and power scaling for a line about to run
+ *
+ *	The clock is the motor that steps furthest along the move. Power values are scaled
+ *	from the S in effect when the move starts. Returns false (and frees the line) if it
+ *	can't be run - empty, the spindle is off, or less than one step per value.
+ */
+
+bool raster_start_line(uint8_t line, const float unit[], float speed)
+{
+	rasterLine_t *r = &raster.line[line-1];
+	float steps_per_mm = 0;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		float steps = fabs(unit[kn.motor_joint[motor]]) * kn.motor_steps_per_unit[motor];
+		if (steps > steps_per_mm) {
+			steps_per_mm = steps;
+			r->motor = motor;
+		}
+	}
+	float steps_per_pixel = steps_per_mm * r->spacing;
+	if ((r->count == 0) || (steps_per_pixel < 1) || (spindle.enable != SPINDLE_ON)) {
+		r->in_use = false;
+		return (false);
+	}
+	r->steps_per_pixel = (int32_t)(min(steps_per_pixel, 32767.0f) * 65536);
+
+	pwmConfigChannel_t *c = &pwm.c[PWM_1];
+	bool cw = (spindle.direction == SPINDLE_CW);
+	r->speed_scale = speed / 255;
+	r->speed_lo = cw ? c->cw_speed_lo : c->ccw_speed_lo;
+	r->speed_hi = cw ? c->cw_speed_hi : c->ccw_speed_hi;
+	r->phase_lo = cw ? c->cw_phase_lo : c->ccw_phase_lo;
+	float phase_hi = cw ? c->cw_phase_hi : c->ccw_phase_hi;
+	r->phase_per_speed = (r->speed_hi > r->speed_lo) ? (phase_hi - r->phase_lo) / (r->speed_hi - r->speed_lo) : 0;
+	return (true);
+}
+
+/*
+ * raster_get_duty() - PWM duty for a power value (runs in the DDA interrupt)
+ */
+
+float raster_get_duty(const rasterLine_t *r, uint8_t power)
+{
+	if (power == 0) {
+		return (pwm.c[PWM_1].phase_off);
+	}
+	float speed = min(max(r->speed_scale * power, r->speed_lo), r->speed_hi);
+	return (r->phase_lo + (speed - r->speed_lo) * r->phase_per_speed);
+}
+
+/*
+ * raster_set_data() - $rsd: append hex power values to the raster line being loaded
+ *
+ *	{"rsd":"00407FFF..."} Each chunk adds to the line until the next G1 takes it, so a line
+ *	can be longer than an input line. A non-string value drops the line being loaded.
+ *	Returns the count of values loaded so far, or STAT_BUFFER_FULL if all lines are busy,
+ *	in which case the host sends the chunk again once a line has run out.
+ */
+
+static int8_t _hex_value(char c)
+{
+	if ((c >= '0') && (c <= '9')) { return (c - '0');}
+	if ((c >= 'A') && (c <= 'F')) { return (c - 'A' + 10);}
+	if ((c >= 'a') && (c <= 'f')) { return (c - 'a' + 10);}
+	return (-1);
+}
+
+stat_t raster_set_data(nvObj_t *nv)
+{
+	if (nv->valuetype != TYPE_STRING) {
+		if (raster.loading != RASTER_NONE) {
+			raster.line[raster.loading-1].in_use = false;
+			raster.loading = RASTER_NONE;
+		}
+		nv->valuetype = TYPE_NULL;
+		return (STAT_OK);
+	}
+	if (raster.loading == RASTER_NONE) {
+		uint8_t i = 0;
+		while ((i < RASTER_LINES) && raster.line[i].in_use) { i++;}
+		if (i == RASTER_LINES) {
+			return (STAT_BUFFER_FULL);
+		}
+		raster.line[i].count = 0;
+		raster.line[i].in_use = true;
+		raster.loading = i+1;
+	}
+	rasterLine_t *r = &raster.line[raster.loading-1];
+	for (char *src = *nv->stringp; *src != NUL; src += 2) {
+		int8_t hi = _hex_value(src[0]);
+		int8_t lo = _hex_value(src[1]);
+		if ((hi < 0) || (lo < 0)) {
+			return (STAT_BAD_NUMBER_FORMAT);
+		}
+		if (r->count >= RASTER_PIXELS_MAX) {
+			return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+		}
+		r->power[r->count++] = (uint8_t)((hi << 4) | lo);
+	}
+	nv->valuetype = TYPE_INT;
+	nv->value = r->count;
+	return (STAT_OK);
+}
+
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
  * Functions to get and set variables from the cfgArray table
@@ -246,6 +401,10 @@ static const char fmt_p1wsh[] PROGMEM = "[p1wsh] pwm ccw speed hi%15.0f RPM\n";
 static const char fmt_p1wpl[] PROGMEM = "[p1wpl] pwm ccw phase lo%15.3f [0..1]\n";
 static const char fmt_p1wph[] PROGMEM = "[p1wph] pwm ccw phase hi%15.3f [0..1]\n";
 static const char fmt_p1pof[] PROGMEM = "[p1pof] pwm phase off%18.3f [0..1]\n";
+static const char fmt_p1vmo[] PROGMEM = "[p1vmo] pwm velocity mode%14d [0=off,1=scale with velocity]\n";
+static const char fmt_p1vex[] PROGMEM = "[p1vex] pwm velocity exponent%10.3f\n";
+static const char fmt_p1vmn[] PROGMEM = "[p1vmn] pwm velocity minimum%11.3f [0..1]\n";
+static const char fmt_rsp[] PROGMEM = "[rsp] raster spacing%18.3f mm\n";
 
 void pwm_print_p1frq(nvObj_t *nv) { text_print(nv, fmt_p1frq);}     // all TYPE_FLOAT
 void pwm_print_p1csl(nvObj_t *nv) { text_print(nv, fmt_p1csl);}
@@ -257,5 +416,9 @@ void pwm_print_p1wsh(nvObj_t *nv) { text_print(nv, fmt_p1wsh);}
 void pwm_print_p1wpl(nvObj_t *nv) { text_print(nv, fmt_p1wpl);}
 void pwm_print_p1wph(nvObj_t *nv) { text_print(nv, fmt_p1wph);}
 void pwm_print_p1pof(nvObj_t *nv) { text_print(nv, fmt_p1pof);}
+void pwm_print_p1vmo(nvObj_t *nv) { text_print(nv, fmt_p1vmo);}     // TYPE_INT
+void pwm_print_p1vex(nvObj_t *nv) { text_print(nv, fmt_p1vex);}
+void pwm_print_p1vmn(nvObj_t *nv) { text_print(nv, fmt_p1vmn);}
+void pwm_print_rsp(nvObj_t *nv) { text_print(nv, fmt_rsp);}
 
 #endif //__TEXT_MODE
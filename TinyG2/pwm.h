@@ -39,6 +39,9 @@ typedef struct pwmConfigChannel {
 	float ccw_phase_lo;				// pwm phase at minimum CCW spindle speed, clamped [0..1]
 	float ccw_phase_hi;				// pwm phase at maximum CCW spindle speed, clamped
 	float phase_off;				// pwm phase when spindle is disabled
+	uint8_t velocity_mode;			// 1 = scale the duty with tool velocity each segment (laser)
+	float velocity_exponent;		// power follows (segment velocity / cruise velocity)^exponent
+	float velocity_min;				// fraction of the commanded power at zero velocity [0..1]
 } pwmConfigChannel_t;
 
 typedef struct pwmChannel {
@@ -55,6 +58,45 @@ typedef struct pwmSingleton {
 
 extern pwmSingleton_t pwm;
 
+/*
+ * Raster scanning (laser)
+ *
+ *	A raster line is a row of laser power values a fixed distance apart, loaded with one or
+ *	more $rsd commands (hex pairs, 00-FF as a fraction of S) and attached to the next G1.
+ *	The move is planned as a single block. The loader times the power values from the step
+ *	count of the motor travelling furthest, so power stays in sync with position whatever
+ *	the velocity. Lines are held here, not in the planner buffers - see pwm.cpp.
+ */
+#ifndef RASTER_PIXELS_MAX
+#define RASTER_PIXELS_MAX 256			// power values in one raster line
+#endif
+#define RASTER_LINES 4					// lines loaded, queued or running at once
+#define RASTER_NONE 0					// bf->raster and prep buffer values. 1..RASTER_LINES is a line
+#define RASTER_STARTED 0xFE				// bf: line handed to the loader (a move restarted after a hold)
+#define RASTER_STOP 0xFF				// prep: end any raster line still running
+
+typedef struct rasterLine {
+	volatile bool in_use;				// claimed - from loading until the loader is done with it
+	uint16_t count;						// power values in the line
+	float spacing;						// distance between values, taken from rsp with the line
+	int32_t steps_per_pixel;			// set by exec: clock motor steps per value (16.16 fixed point)
+	uint8_t motor;						// set by exec: motor whose steps are the clock
+	float speed_scale;					// set by exec: S / 255
+	float speed_lo;						// set by exec: PWM speed and phase range for the direction
+	float speed_hi;
+	float phase_lo;
+	float phase_per_speed;
+	uint8_t power[RASTER_PIXELS_MAX];	// power values - 0 is off, 255 is S
+} rasterLine_t;
+
+typedef struct rasterSingleton {
+	float spacing;						// rsp distance between power values in mm
+	uint8_t loading;					// line being loaded by rsd (1..RASTER_LINES), or RASTER_NONE
+	rasterLine_t line[RASTER_LINES];
+} rasterSingleton_t;
+
+extern rasterSingleton_t raster;
+
 /*** function prototypes ***/
 
 void pwm_init(void);
@@ -63,6 +105,12 @@ stat_t pwm_set_duty(uint8_t channel, float duty);
 
 stat_t pwm_set_pwm(nvObj_t *nv);
 
+void raster_reset(void);
+uint8_t raster_take_line(uint8_t motion_mode);
+bool raster_start_line(uint8_t line, const float unit[], float speed);
+float raster_get_duty(const rasterLine_t *r, uint8_t power);
+stat_t raster_set_data(nvObj_t *nv);
+
 #ifdef __TEXT_MODE
 
 	void pwm_print_p1frq(nvObj_t *nv);
@@ -75,6 +123,10 @@ stat_t pwm_set_pwm(nvObj_t *nv);
 	void pwm_print_p1wpl(nvObj_t *nv);
 	void pwm_print_p1wph(nvObj_t *nv);
 	void pwm_print_p1pof(nvObj_t *nv);
+	void pwm_print_p1vmo(nvObj_t *nv);
+	void pwm_print_p1vex(nvObj_t *nv);
+	void pwm_print_p1vmn(nvObj_t *nv);
+	void pwm_print_rsp(nvObj_t *nv);
 
 #else
 
@@ -88,6 +140,10 @@ stat_t pwm_set_pwm(nvObj_t *nv);
 	#define pwm_print_p1wpl tx_print_stub
 	#define pwm_print_p1wph tx_print_stub
 	#define pwm_print_p1pof tx_print_stub
+	#define pwm_print_p1vmo tx_print_stub
+	#define pwm_print_p1vex tx_print_stub
+	#define pwm_print_p1vmn tx_print_stub
+	#define pwm_print_rsp tx_print_stub
 
 #endif // __TEXT_MODE
 
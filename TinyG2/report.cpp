@@ -35,6 +35,7 @@
 #include "settings.h"
 #include "util.h"
 #include "xio.h"
+#include "hardware.h"
 
 using namespace Motate;
 //OutputPin<kDebug1_PinNumber> sr_debug_pin1;
@@ -84,6 +85,103 @@ stat_t rpt_exception(stat_t status, const char *msg)
 	return (status);			// makes it possible to inline, e.g: return(rpt_exception(status));
 }
 
+/*
+ * rpt_post_exception()		- queue an exception report from an interrupt
+ * rpt_post_alarm()			- queue an alarm from an interrupt
+ * rpt_post_panic()			- queue a panic from an interrupt
+ * rpt_exception_callback()	- main loop task that reports what was queued
+ *
+ *	The exec and prep (mp_exec_move(), st_prep_line() and the trapezoid generator they
+ *	call) and pin change interrupts can't print, and cm_panic() flushes queues and prints
+ *	too much to run there. They post a record instead - status, message, a value and the
+ *	runtime line number - and wake DEADLINE_EXCEPTION. The controller drains the queue on
+ *	its next pass into rpt_exception(), cm_alarm() or cm_panic(), with the value and line number
+ *	appended to the message. A post is a few stores whatever the message, so the
+ *	interrupt keeps its time. A panic doesn't wait for the pass to stop the machine: the
+ *	post halts motion on the spot with cm_halt_motion(), as an INPUT_ACTION_HALT does, and
+ *	only the report and the queue flush are left to cm_panic().
+ *
+ *	The callback is the only reader and advances 'rd' after it has copied the record out.
+ *	A post holds off interrupts only while it claims and fills a slot, as posts can come
+ *	from more than one interrupt level. A post to a full queue is counted and reported as
+ *	lost rather than waiting. The message must be a string constant of no more than 48
+ *	characters. The posts return the status, so they can be inlined in a return.
+ */
+
+static rptException_t ex_queue[EXCEPTION_QUEUE_SIZE];
+static volatile uint8_t ex_wr;				// written only by the posts
+static volatile uint8_t ex_rd;				// written only by the callback
+static volatile uint8_t ex_lost;			// posts dropped on a full queue
+static uint8_t ex_lost_reported;
+
+static stat_t _post_exception(stat_t status, const char *msg, int32_t value, uint8_t action)
+{
+	__disable_irq();
+	if ((uint8_t)(ex_wr - ex_rd) >= EXCEPTION_QUEUE_SIZE) {
+		ex_lost++;
+	} else {
+		rptException_t *ex = &ex_queue[ex_wr & (EXCEPTION_QUEUE_SIZE-1)];
+		ex->msg = msg;
+		ex->value = value;
+		ex->linenum = mr.gm.linenum;
+		ex->status = status;
+		ex->action = action;
+		ex_wr++;
+	}
+	__enable_irq();
+	controller_wake(DEADLINE_EXCEPTION);
+	return (status);
+}
+
+stat_t rpt_post_exception(stat_t status, const char *msg)
+{
+	return (_post_exception(status, msg, 0, EXCEPTION_REPORT));
+}
+
+stat_t rpt_post_alarm(stat_t status, const char *msg)
+{
+	return (_post_exception(status, msg, 0, EXCEPTION_ALARM));
+}
+
+stat_t rpt_post_panic(stat_t status, const char *msg, int32_t value)
+{
+	_post_exception(status, msg, value, EXCEPTION_PANIC);	// first - it takes the line number from mr
+	cm_halt_motion();										// stop now - the report and the flush can wait
+	return (status);
+}
+
+stat_t rpt_exception_callback()
+{
+	char msg[80];
+
+	while (ex_rd != ex_wr) {
+		rptException_t ex = ex_queue[ex_rd & (EXCEPTION_QUEUE_SIZE-1)];
+		ex_rd++;										// the slot is free once it's copied
+
+		char *end = msg + sprintf_P(msg, PSTR("%s"), ex.msg);
+		if (ex.value != 0) {
+			end += sprintf_P(end, PSTR(" %ld"), (long)ex.value);
+		}
+		if (ex.linenum != 0) {
+			sprintf_P(end, PSTR(", line %lu"), (unsigned long)ex.linenum);
+		}
+		if (ex.action == EXCEPTION_PANIC) {
+			cm_panic(ex.status, msg);
+		} else if (ex.action == EXCEPTION_ALARM) {
+			cm_alarm(ex.status, msg);
+		} else {
+			rpt_exception(ex.status, msg);
+		}
+	}
+	uint8_t lost = ex_lost;
+	if (lost != ex_lost_reported) {
+		sprintf_P(msg, PSTR("%d exceptions lost"), (uint8_t)(lost - ex_lost_reported));
+		ex_lost_reported = lost;
+		rpt_exception(STAT_BUFFER_FULL, msg);
+	}
+	return (STAT_OK);
+}
+
 /*
  * rpt_er()	- send a bogus exception report for testing purposes (it's not real)
  */
@@ -92,6 +190,161 @@ stat_t rpt_er(nvObj_t *nv)
 	return(rpt_exception(STAT_GENERIC_EXCEPTION_REPORT, "bogus")); // bogus exception report for testing
 }
 
+/**** Report Rate Governor *********************************************************
+ *
+ * rpt_throttle_report() - test if an automatic report has to wait for the rate limit
+ * rpt_report_sent()	 - take a report that went out from the rate limit budget
+ * rpt_set_rr()			 - set the rate limit (reports per second, 0 = unlimited)
+ *
+ *	Status, queue, rx and watch reports share one token bucket filled at "rr" reports per
+ *	second and holding up to REPORT_BURST of them. A report that finds the bucket empty
+ *	stays pending, so everything requested in the meantime goes out as one report with
+ *	the values current when a token comes in. Command responses, acks and exception
+ *	reports never wait for the bucket, and reports already keep XIO_TX_HEADROOM free
+ *	for them - so the command channel stays responsive under heavy streaming.
+ *
+ *	rpt_throttle_report() arms 'deadline' (if not DEADLINE_NONE) for when the next token
+ *	comes in. A report task checks it first and calls rpt_report_sent() when it sends.
+ */
+
+rptSingleton_t rpt;
+
+static void _update_report_credit()
+{
+	uint32_t now = SysTickTimer_getValue();
+	uint32_t elapsed = now - rpt.report_systick;
+	rpt.report_systick = now;
+
+	if (elapsed > (REPORT_BURST * 1000)) {				// filling the bucket never takes longer than this
+		elapsed = REPORT_BURST * 1000;
+	}
+	rpt.report_credit += elapsed * rpt.report_rate_limit;
+	if (rpt.report_credit > (REPORT_BURST * 1000)) {
+		rpt.report_credit = REPORT_BURST * 1000;
+	}
+}
+
+bool rpt_throttle_report(uint8_t deadline)
+{
+	if (rpt.report_rate_limit == 0) {
+		return (false);
+	}
+	_update_report_credit();
+	if (rpt.report_credit >= 1000) {
+		return (false);
+	}
+	if (deadline != DEADLINE_NONE) {
+		uint32_t wait = (1000 - rpt.report_credit + rpt.report_rate_limit - 1) / rpt.report_rate_limit;
+		controller_set_deadline(deadline, rpt.report_systick + wait);
+	}
+	return (true);
+}
+
+void rpt_report_sent()
+{
+	if (rpt.report_credit >= 1000) {
+		rpt.report_credit -= 1000;
+	}
+}
+
+stat_t rpt_set_rr(nvObj_t *nv)
+{
+	if (nv->value > REPORT_RATE_MAX) {
+		nv->value = REPORT_RATE_MAX;
+	}
+	set_int(nv);
+	rpt.report_credit = REPORT_BURST * 1000;			// start with a full bucket
+	rpt.report_systick = SysTickTimer_getValue();
+	return (STAT_OK);
+}
+
+/**** Report Fan-out ***************************************************************
+ *
+ * _subscribers()	- true if a channel has subscribed to the status and watch reports
+ * _print_report()	- send the status or watch report in the nv list
+ * rpt_get_sub()	- get the reports the asking channel is subscribed to
+ * rpt_set_sub()	- subscribe the asking channel to reports
+ *
+ *	Built with __REPORT_FANOUT, monitoring tools on other channels (a DRO pendant, a shop
+ *	floor system on an ethernet socket) can take the reports the host gets. {"sub":1} from
+ *	a channel subscribes it to the status and watch reports, {"sub":2} to the status stream
+ *	frames (with $ssi set), {"sub":3} to both and {"sub":0} to none. The reply goes back to
+ *	the channel that asked. Subscriptions end when the channel disconnects.
+ *
+ *	A report is serialized once per format - the JSON text or the stream frame - and the
+ *	same bytes are queued to the host and to each subscriber (see xio_write_report()), so
+ *	more monitors cost a copy each, not a report each. Subscribers always get JSON; in text
+ *	mode the host still gets the text form.
+ *
+ *	A subscriber starts with a report of every value, and gets one again as soon as it has
+ *	room after missing a report - until then it doesn't get the changes-only ones. Missed
+ *	watch reports report every value of the list next time round, to everyone - the lists
+ *	are short. Subscribers don't wait on the host: when the host is behind or over the report
+ *	rate they get every value at the report or watch interval, leaving the host's report
+ *	pending, and with status or JSON reports turned off ($sv=0, $jv=0) they get the changes
+ *	on their own.
+ */
+
+static bool _subscribers()
+{
+#ifdef __REPORT_FANOUT
+	return (xio_get_subscribers(DEV_SUB_REPORTS, 0) > 0);
+#else
+	return (false);
+#endif
+}
+
+static uint8_t _print_report(bool to_host, devflags_t resync, uint8_t kind)
+{
+	uint8_t dropped = 0;
+#ifdef __REPORT_FANOUT
+	uint16_t len = json_serialize(nv_body, cs.out_buf, sizeof(cs.out_buf));
+	if (len < sizeof(cs.out_buf)) {						// not too long
+		dropped = xio_write_report((const uint8_t *)cs.out_buf, len, DEV_SUB_REPORTS,
+								   (to_host && (cs.comm_mode == JSON_MODE)) ? DEV_IS_CTRL : DEV_FLAGS_CLEAR,
+								   resync, kind);
+	}
+	if ((!to_host) || (cs.comm_mode == JSON_MODE)) {
+		return (dropped);
+	}
+#endif
+	nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+	return (dropped);
+}
+
+#ifdef __REPORT_FANOUT
+static void _reset_watch_values(wlChannel_t *ch);
+
+stat_t rpt_get_sub(nvObj_t *nv)
+{
+	json_flush_acks();									// the host's, before the reply is routed
+	xio_reply_to_reader();
+	devflags_t sub = xio_get_subscription();
+	nv->value = ((sub & DEV_SUB_REPORTS) ? 1 : 0) + ((sub & DEV_SUB_STREAM) ? 2 : 0);
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t rpt_set_sub(nvObj_t *nv)
+{
+	json_flush_acks();
+	xio_reply_to_reader();
+	uint8_t value = (uint8_t)nv->value;
+	if ((nv->value < 0) || (value > 3)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	ritorno(xio_set_subscription(((value & 1) ? DEV_SUB_REPORTS : 0) | ((value & 2) ? DEV_SUB_STREAM : 0)));
+	if (value & 1) {
+		for (uint8_t c=0; c<WATCH_CHANNELS; c++) {
+			_reset_watch_values(&wl[c]);
+		}
+		controller_wake(DEADLINE_STATUS_REPORT);		// the full report goes from there
+		controller_wake(DEADLINE_WATCH_REPORT);
+	}
+	return (STAT_OK);
+}
+#endif // __REPORT_FANOUT
+
 /**** Application Messages *********************************************************
  * rpt_print_initializing_message()	   - initializing configs from hard-coded profile
  * rpt_print_loading_configs_message() - loading configs from EEPROM
@@ -174,6 +427,9 @@ void rpt_print_system_ready_message(void)
  */
 static stat_t _populate_unfiltered_status_report(void);
 static uint8_t _populate_filtered_status_report(void);
+static void _compile_status_report(void);
+static void _get_status_report_element(nvObj_t *nv, uint8_t i);
+static void _get_compiled_element(nvObj_t *nv, index_t index, fptrCmd get, uint8_t strip);
 
 uint8_t _is_stat(nvObj_t *nv)
 {
@@ -213,6 +469,7 @@ void sr_init_status_report()
 	}
     // record the index of the "stat" variable so we can use it during reporting
     sr.index_of_stat_variable = nv_get_index((const char *)"", (const char *)"stat");
+    _compile_status_report();
 }
 
 /*
@@ -248,9 +505,151 @@ stat_t sr_set_status_report(nvObj_t *nv)
         return (STAT_INPUT_VALUE_UNSUPPORTED);
     }
 	memcpy(sr.status_report_list, status_report_list, sizeof(status_report_list));
+	_compile_status_report();
 	return(_populate_unfiltered_status_report());			// return current values
 }
 
+/*
+ * _compile_status_report()		 - compile the SR list into the status report template
+ * _get_status_report_element() - get SR element i into nv with its flattened token
+ *
+ *	Each SR element used to be loaded through nv_get_nvObj(), which copies the token and
+ *	group from the cfgArray, strips the group, calls the getter from the table, and was
+ *	followed by re-flattening group+token into the token for display. The template keeps
+ *	the getter and the length of the group to strip for each element, so a report only
+ *	sets up what the getter needs, calls it directly and clears the strip - the full token
+ *	is the flattened token. Getters see the same nv as before (some use the stripped token).
+ *
+ *	Each entry records the index it was compiled for. An SR list changed any other way
+ *	(e.g. se00-se39 restored from persistence) is recompiled on first use.
+ */
+
+static void _compile_status_report_element(nvObj_t *nv, uint8_t i)
+{
+	nv_set_index(nv, sr.status_report_list[i], true);
+	sr.status_report_strip[i] = nv->strip;
+	sr.status_report_get[i] = (fptrCmd)GET_TABLE_WORD(get);
+	sr.status_report_compiled[i] = nv->index;
+}
+
+static void _compile_status_report()
+{
+	nvObj_t nv;
+	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
+		if (sr.status_report_list[i] == 0) {
+			sr.status_report_compiled[i] = NO_MATCH;
+		} else {
+			_compile_status_report_element(&nv, i);
+		}
+#ifdef __BINARY_DATA
+		sr.status_stream_value[i] = -1234567;			// stream everything in the next frame
+#endif
+	}
+}
+
+#ifdef __BINARY_DATA
+/*
+ * sr_status_stream_callback() - main loop callback to stream status on the data channel
+ *
+ *	With $ssi set, the elements of the status report are also streamed as binary frames on
+ *	the data-only channel (see xio.h for the framing), at most every ssi ms and only when a
+ *	value has changed. This leaves the control channel's bandwidth and response latency to
+ *	the commands. A stream frame is:
+ *
+ *	  type	- 'S'
+ *	  seq	- stream sequence number, incremented for each frame so gaps can be detected
+ *	  payload - for each changed element its position in the SR list (0 = the first element
+ *			set by {"sr":...}) and its value as a little-endian float
+ *
+ *	The first frame after the stream is enabled or the SR list is changed carries every
+ *	element. Values are streamed when they change at all, not by the filtered SR's epsilon.
+ *	If the data channel's write queue has no room for a full frame the frame is skipped - the
+ *	changed values go out merged into the next one. Channels subscribed with {"sub":2} get
+ *	the same frames - see rpt_set_sub(). With them the data channel is treated as one: a
+ *	channel that misses a frame, or has just subscribed, gets a frame of every element with
+ *	the seq of the latest one instead of the changes, once it has room.
+ */
+
+#define STATUS_STREAM_FRAME_TYPE 'S'
+#define STATUS_STREAM_ELEMENT_LEN (1 + sizeof(float))
+
+static uint16_t _finish_stream_frame(uint8_t *frame, uint8_t len)
+{
+	frame[XIO_FRAME_STX] = STX;
+	frame[XIO_FRAME_LEN] = len;
+	frame[XIO_FRAME_SEQ] = sr.status_stream_seq;
+	frame[XIO_FRAME_TYPE] = STATUS_STREAM_FRAME_TYPE;
+	uint16_t crc = compute_crc16(&frame[XIO_FRAME_LEN], XIO_FRAME_HEADER_LEN-1 + len);
+	frame[XIO_FRAME_PAYLOAD + len] = crc & 0xFF;
+	frame[XIO_FRAME_PAYLOAD + len + 1] = crc >> 8;
+	return (XIO_FRAME_HEADER_LEN + len + XIO_FRAME_CRC_LEN);
+}
+
+stat_t sr_status_stream_callback()
+{
+	if ((sr.status_stream_interval == 0) || ((int32_t)(SysTickTimer_getValue() - sr.status_stream_systick) < 0)) {
+		return (STAT_NOOP);
+	}
+	sr.status_stream_systick = SysTickTimer_getValue() + sr.status_stream_interval;
+
+	uint8_t frame[XIO_FRAME_HEADER_LEN + NV_STATUS_REPORT_LEN * STATUS_STREAM_ELEMENT_LEN + XIO_FRAME_CRC_LEN];
+#ifndef __REPORT_FANOUT
+	if (xio_tx_space_data() < sizeof(frame)) {
+		return (STAT_NOOP);								// don't wait on the host - try next interval
+	}
+#endif
+	uint8_t *wr = &frame[XIO_FRAME_PAYLOAD];
+	nvObj_t nv;
+	nv.pv = NULL;
+	uint16_t wp = nvStr.wp;								// getters copy strings the frame doesn't carry
+
+	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
+		if (sr.status_report_list[i] == 0) { break;}
+		_get_status_report_element(&nv, i);
+		nvStr.wp = wp;
+		if (memcmp(&nv.value, &sr.status_stream_value[i], sizeof(float)) != 0) {	// any change, bit for bit
+			sr.status_stream_value[i] = nv.value;
+			*wr++ = i;
+			memcpy(wr, &nv.value, sizeof(float));		// frame floats are not aligned
+			wr += sizeof(float);
+		}
+	}
+	uint8_t len = wr - &frame[XIO_FRAME_PAYLOAD];
+	if (len > 0) {										// something has changed
+		sr.status_stream_seq++;
+#ifdef __REPORT_FANOUT
+		xio_write_report(frame, _finish_stream_frame(frame, len), DEV_SUB_STREAM, DEV_IS_DATA,
+						 DEV_RESYNC_STREAM, XIO_REPORT_CHANGES);
+#else
+		xio_write_data(frame, _finish_stream_frame(frame, len));
+#endif
+	}
+#ifdef __REPORT_FANOUT
+	if (xio_get_subscribers(DEV_RESYNC_STREAM, sizeof(frame)) > 0) {
+		wr = &frame[XIO_FRAME_PAYLOAD];					// the values streamed are all current now
+		for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
+			if (sr.status_report_list[i] == 0) { break;}
+			*wr++ = i;
+			memcpy(wr, &sr.status_stream_value[i], sizeof(float));
+			wr += sizeof(float);
+		}
+		len = wr - &frame[XIO_FRAME_PAYLOAD];
+		xio_write_report(frame, _finish_stream_frame(frame, len), DEV_SUB_STREAM, DEV_IS_DATA,
+						 DEV_RESYNC_STREAM, XIO_REPORT_RESYNC);
+	}
+#endif
+	return (STAT_OK);
+}
+#endif // __BINARY_DATA
+
+static void _get_status_report_element(nvObj_t *nv, uint8_t i)
+{
+	if (sr.status_report_compiled[i] != sr.status_report_list[i]) {
+		_compile_status_report_element(nv, i);
+	}
+	_get_compiled_element(nv, sr.status_report_list[i], sr.status_report_get[i], sr.status_report_strip[i]);
+}
+
 /*
  * sr_request_status_report() - request a status report
  *
@@ -264,11 +663,15 @@ stat_t sr_set_status_report(nvObj_t *nv)
  *
  *	Requests can specify immediate or timed reports, and can also force a filtered or full report.
  *	See cmStatusReportRequest enum in report.h for details.
+ *
+ *	Each request arms DEADLINE_STATUS_REPORT for the report's systick, so the callback only
+ *	runs when a report is due.
  */
 
 stat_t sr_request_status_report(uint8_t request_type)
 {
 	if (sr.status_report_request != SR_OFF) {       // ignore multiple requests. First one wins.
+		controller_set_deadline(DEADLINE_STATUS_REPORT, sr.status_report_systick);
         return (STAT_OK);
    }
 
@@ -281,30 +684,68 @@ stat_t sr_request_status_report(uint8_t request_type)
 
 	} else if (request_type == SR_REQUEST_TIMED) {
 		sr.status_report_request = sr.status_report_verbosity;
+		if ((sr.status_report_request == SR_OFF) && _subscribers()) {
+			sr.status_report_request = SR_FILTERED;		// reports are off for the host, not for the subscribers
+		}
 		sr.status_report_systick += sr.status_report_interval;
 
 	} else {
 		sr.status_report_request = SR_VERBOSE;
 		sr.status_report_systick += sr.status_report_interval;
 	}
+	controller_set_deadline(DEADLINE_STATUS_REPORT, sr.status_report_systick);
 	return (STAT_OK);
 }
 
 /*
  * sr_status_report_callback() - main loop callback to send a report if one is ready
+ * _status_report()			 - send the host's report (and the subscribers' with it) when it's due
+ * _fanout_status_report()	 - send the subscribers every value when the host can't take its report
+ * _resync_status_report()	 - send every value to the subscribers that missed a report
+ *
+ *	See Report Fan-out for the subscribers. Without __REPORT_FANOUT only the first part runs.
  */
+static stat_t _status_report(void);
+static stat_t _fanout_status_report(void);
+#ifdef __REPORT_FANOUT
+static stat_t _resync_status_report(void);
+#endif
+
 stat_t sr_status_report_callback() 		// called by controller dispatcher
+{
+	stat_t status = _status_report();
+#ifdef __REPORT_FANOUT
+	if (_resync_status_report() == STAT_OK) {
+		status = STAT_OK;
+	}
+#endif
+	return (status);
+}
+
+static stat_t _status_report()
 {
 //    if (!mp_is_it_phat_city_time()) {   // don't process this if you are time constrained in the planner
 //        return (STAT_NOOP);
 //    }
-    if ((sr.status_report_verbosity == SR_OFF) ||
-	    (sr.status_report_request == SR_OFF) ||
-        (js.json_verbosity == JV_SILENT) ||
-	    (SysTickTimer_getValue() < sr.status_report_systick) ) {
-        return (STAT_NOOP);
+	bool quiet = ((sr.status_report_verbosity == SR_OFF) || (js.json_verbosity == JV_SILENT));
+    if ((sr.status_report_request == SR_OFF) || (quiet && !_subscribers())) {
+        return (STAT_NOOP);						// the next request re-arms the deadline
     }
+	if (SysTickTimer_getValue() < sr.status_report_systick) {
+		controller_set_deadline(DEADLINE_STATUS_REPORT, sr.status_report_systick);
+		return (STAT_NOOP);
+	}
+	if (!quiet) {
+		if (xio_tx_space() < XIO_TX_HEADROOM) {		// host isn't keeping up - leave the request pending so it
+			controller_wake(DEADLINE_STATUS_REPORT);	// goes out with the latest values once the queue drains
+			return (_fanout_status_report());
+		}
+		if (rpt_throttle_report(DEADLINE_STATUS_REPORT)) {	// over the report rate - as above, once there's a token
+			return (_fanout_status_report());
+		}
+	}
 
+	uint8_t kind = XIO_REPORT_FULL;
 	if (sr.status_report_request == SR_VERBOSE) {
 		_populate_unfiltered_status_report();
 	} else {
@@ -312,12 +753,46 @@ stat_t sr_status_report_callback() 		// called by controller dispatcher
 			sr.status_report_request = SR_OFF;				// disable reports until requested again
 			return (STAT_OK);
 		}
+		kind = XIO_REPORT_CHANGES;
 	}
 	sr.status_report_request = SR_OFF;
-	nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+	_print_report(!quiet, DEV_RESYNC_REPORTS, kind);	// quiet, the changes are the subscribers' alone
+	if (!quiet) {
+		rpt_report_sent();
+	}
     return (STAT_OK);
 }
 
+static stat_t _fanout_status_report()
+{
+#ifdef __REPORT_FANOUT
+	if (!_subscribers()) {
+		return (STAT_NOOP);
+	}
+	_populate_unfiltered_status_report();			// the host's changes stay pending for it
+	_print_report(false, DEV_RESYNC_REPORTS, XIO_REPORT_FULL);
+	sr.status_report_systick = SysTickTimer_getValue() + sr.status_report_interval;
+	return (STAT_OK);
+#else
+	return (STAT_NOOP);
+#endif
+}
+
+#ifdef __REPORT_FANOUT
+static stat_t _resync_status_report()
+{
+	if (xio_get_subscribers(DEV_RESYNC_REPORTS, XIO_TX_HEADROOM) == 0) {
+		if (xio_get_subscribers(DEV_RESYNC_REPORTS, 0) > 0) {
+			controller_wake(DEADLINE_STATUS_REPORT);	// look again once it has room
+		}
+		return (STAT_NOOP);
+	}
+	_populate_unfiltered_status_report();
+	_print_report(false, DEV_RESYNC_REPORTS, XIO_REPORT_RESYNC);
+	return (STAT_OK);
+}
+#endif
+
 /*
  * sr_run_text_status_report() - generate a text mode status report in multiline format
  */
@@ -335,22 +810,16 @@ stat_t sr_run_text_status_report()
  */
 static stat_t _populate_unfiltered_status_report()
 {
-	const char sr_str[] = "sr";
-	char tmp[TOKEN_LEN+1];
 	nvObj_t *nv = nv_reset_nv_list();		// sets *nv to the start of the body
 
 	nv->valuetype = TYPE_PARENT; 			// setup the parent object (no length checking required)
-	strcpy(nv->token, sr_str);
-	nv->index = nv_get_index((const char *)"", sr_str);// set the index - may be needed by calling function
+	nv->name = "sr";
+	nv->index = nv_get_index((const char *)"", nv->name);// set the index - may be needed by calling function
 	nv = nv->nx;							// no need to check for NULL as list has just been reset
 
 	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
-		if ((nv->index = sr.status_report_list[i]) == 0) { break;}
-		nv_get_nvObj(nv);
-
-		strcpy(tmp, nv->group);			// flatten out groups - WARNING - you cannot use strncpy here...
-		strcat(tmp, nv->token);
-		strcpy(nv->token, tmp);			//...or here.
+		if (sr.status_report_list[i] == 0) { break;}
+		_get_status_report_element(nv, i);			// loads the flattened token
 
 		if ((nv = nv->nx) == NULL) {
 			return (cm_panic(STAT_BUFFER_FULL_FATAL, "sr link NULL"));	// should never be NULL unless SR length exceeds available buffer array
@@ -374,30 +843,25 @@ static stat_t _populate_unfiltered_status_report()
  */
 static uint8_t _populate_filtered_status_report()
 {
-	const char sr_str[] = "sr";
 	bool has_data = false;
-	char tmp[TOKEN_LEN+1];
 	nvObj_t *nv = nv_reset_nv_list();		    // sets nv to the start of the body
 
-	nv->valuetype = TYPE_PARENT; 			    // setup the parent object (no need to length check the copy)
-	strcpy(nv->token, sr_str);
-//	nv->index = nv_get_index((const char *)"", sr_str);// OMITTED - set the index - may be needed by calling function
+	nv->valuetype = TYPE_PARENT; 			    // setup the parent object
+	nv->name = "sr";
+//	nv->index = nv_get_index((const char *)"", nv->name);// OMITTED - set the index - may be needed by calling function
 	nv = nv->nx;							    // no need to check for NULL as list has just been reset
 
 	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
-		if ((nv->index = sr.status_report_list[i]) == 0) {  // end of list
+		if (sr.status_report_list[i] == 0) {  // end of list
             break;
         }
-		nv_get_nvObj(nv);
+		_get_status_report_element(nv, i);			// loads the flattened token
 
 		// report values that have changed by more than 0.0001, but always stops and ends
 		if ((fabs(nv->value - sr.status_report_value[i]) > EPSILON3) ||
             ((nv->index == sr.stat_index) && fp_EQ(nv->value, COMBINED_PROGRAM_STOP)) ||
             ((nv->index == sr.stat_index) && fp_EQ(nv->value, COMBINED_PROGRAM_END))) {
 
-		    strcpy(tmp, nv->group);		    // flatten out groups - WARNING - you cannot use strncpy here...
-		    strcat(tmp, nv->token);
-		    strcpy(nv->token, tmp);		    //...or here.
 		    sr.status_report_value[i] = nv->value;
 		    if ((nv = nv->nx) == NULL) return (false);	// should never be NULL unless SR length exceeds available buffer array
 		    has_data = true;
@@ -415,6 +879,7 @@ static uint8_t _populate_filtered_status_report()
  * sr_get()		- run status report
  * sr_set()		- set status report elements
  * sr_set_si()	- set status report interval
+ * sr_set_ssi()	- set status stream interval
  */
 
 stat_t sr_get(nvObj_t *nv)
@@ -436,6 +901,418 @@ stat_t sr_set_si(nvObj_t *nv)
 	return(STAT_OK);
 }
 
+#ifdef __BINARY_DATA
+stat_t sr_set_ssi(nvObj_t *nv)
+{
+	if ((nv->value < STATUS_STREAM_MIN_MS) && (fp_NOT_ZERO(nv->value))) {
+        nv->value = STATUS_STREAM_MIN_MS;
+    }
+	set_int(nv);
+	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
+		sr.status_stream_value[i] = -1234567;			// stream everything in the next frame
+	}
+	return(STAT_OK);
+}
+#endif
+
+/*****************************************************************************
+ * Watch Reports
+ *
+ *	A watch list is a status report of its own for a monitoring tool - each with its own
+ *	elements, minimum interval and deadband, so a tool can have position often and finely
+ *	and machine state only when it changes without paying for a fast SR of everything:
+ *
+ *	  {"w1":{"posx":true,"posy":true,"posz":true}}  {"w1i":20}  {"w1d":0.01}
+ *	  {"w2":{"stat":true}}  {"w2i":10}  {"w2d":0}
+ *
+ *	Every wNi ms a channel looks at its values and reports those that have moved by more
+ *	than wNd since they were last reported, in the units they are reported in (wNd of 0
+ *	reports any change). They go out as an object:
+ *	{"w1":{"posx":12.340}}. Nothing is sent if nothing has moved. The lists are compiled
+ *	like the SR template (index, getter and strip for each element) when they are set.
+ *
+ *	Subscriptions are not persisted - a tool subscribes when it connects. {"w1":false}
+ *	unsubscribes and {"w1":null} returns all of the channel's values. The intervals and
+ *	deadbands are persisted like "si".
+ *
+ * wl_watch_report_callback() - main loop callback to send watch reports that are due
+ * wl_get()		- get all values of a watch list
+ * wl_set()		- set (subscribe) or clear (unsubscribe) a watch list
+ * wl_set_wi()	- set watch list minimum interval
+ */
+
+wlChannel_t wl[WATCH_CHANNELS];
+
+static void _get_compiled_element(nvObj_t *nv, index_t index, fptrCmd get, uint8_t strip)
+{
+	nv_reset_nv(nv);
+	nv->index = index;
+	nv->name = NULL;
+	nv->strip = strip;								// set up group and stripped token for the getter
+	get(nv);										// populate the value
+	nv->strip = 0;									// the full token is the flattened token
+}
+
+static wlChannel_t *_get_watch_channel(nvObj_t *nv)	// channel from the table token: w1 - wN
+{
+	char tok[TOKEN_LEN+1];
+
+	GET_TOKEN_STRING(nv->index, tok);
+	return (&wl[tok[1]-'1']);
+}
+
+static void _reset_watch_values(wlChannel_t *ch)	// the next look reports every value
+{
+	for (uint8_t i=0; i<ch->watch_len; i++) {
+		ch->watch_value[i] = -1234567;				// an unlikely number, as for the SR
+	}
+}
+
+static bool _populate_watch_report(wlChannel_t *ch, bool filtered, bool mark)
+{
+	float deadband = (ch->watch_deadband > EPSILON3) ? ch->watch_deadband : EPSILON3;
+	bool has_data = false;
+	nvObj_t *nv = nv_reset_nv_list();				// sets nv to the start of the body
+
+	nv->valuetype = TYPE_PARENT; 					// setup the parent object
+	nv_set_index(nv, ch->watch_name, false);
+	nv = nv->nx;									// no need to check for NULL as list has just been reset
+
+	for (uint8_t i=0; i<ch->watch_len; i++) {
+		_get_compiled_element(nv, ch->watch_index[i], ch->watch_get[i], ch->watch_strip[i]);
+		if ((!filtered) || (fabs(nv->value - ch->watch_value[i]) > deadband)) {
+			if (mark) {
+				ch->watch_value[i] = nv->value;		// the values reported - leave them if the host didn't get these
+			}
+			has_data = true;
+			if ((nv = nv->nx) == NULL) break;		// WATCH_LIST_LEN is less than the body
+		} else {
+			nv->valuetype = TYPE_EMPTY;				// filter this value out of the report
+		}
+	}
+	return (has_data);
+}
+
+stat_t wl_watch_report_callback()
+{
+	uint32_t now = SysTickTimer_getValue();
+	stat_t status = STAT_NOOP;
+
+	for (uint8_t c=0; c<WATCH_CHANNELS; c++) {
+		wlChannel_t *ch = &wl[c];
+		if (ch->watch_len == 0) {
+			continue;
+		}
+		if ((int32_t)(now - ch->watch_systick) >= 0) {
+			if (status != STAT_NOOP) {
+				controller_wake(DEADLINE_WATCH_REPORT);	// one report per pass
+				continue;
+			}
+			bool quiet = (js.json_verbosity == JV_SILENT);
+			bool held = false;							// the host can't take a report now
+			if ((!quiet) && (rpt_throttle_report(DEADLINE_WATCH_REPORT))) {
+				held = true;							// over the report rate - back when there's a token
+			} else if ((!quiet) && (xio_tx_space() < XIO_TX_HEADROOM)) {
+				controller_wake(DEADLINE_WATCH_REPORT);	// none while the host is behind
+				held = true;
+			}
+			if (held && (!_subscribers())) {
+				continue;
+			}
+			ch->watch_systick = now + ch->watch_interval;
+			if (held) {									// the subscribers don't wait - they get every value
+				_populate_watch_report(ch, false, false);
+				_print_report(false, DEV_FLAGS_CLEAR, XIO_REPORT_FULL);
+				status = STAT_OK;
+			} else if (((!quiet) || (_subscribers())) && (_populate_watch_report(ch, true, true))) {
+				if (_print_report(!quiet, DEV_FLAGS_CLEAR, XIO_REPORT_CHANGES) > 0) {
+					_reset_watch_values(ch);			// a subscriber missed it - everyone gets every value next time
+				}
+				if (!quiet) {
+					rpt_report_sent();
+				}
+				status = STAT_OK;
+			}
+		}
+		controller_set_deadline(DEADLINE_WATCH_REPORT, ch->watch_systick);
+	}
+	return (status);
+}
+
+stat_t wl_get(nvObj_t *nv)
+{
+	wlChannel_t *ch = _get_watch_channel(nv);
+	if (ch->watch_len == 0) {
+		nv->valuetype = TYPE_BOOL;					// {"wN":false} - not subscribed
+		nv->value = false;
+		return (STAT_OK);
+	}
+	_populate_watch_report(ch, false, true);
+	return (STAT_OK);
+}
+
+stat_t wl_set(nvObj_t *nv)
+{
+	wlChannel_t *ch = _get_watch_channel(nv);
+	wlChannel_t list;
+	list.watch_name = nv->index;
+	list.watch_len = 0;
+
+	if (nv->valuetype != TYPE_PARENT) {				// {"wN":false} unsubscribes
+		if ((nv->valuetype != TYPE_BOOL) || (fp_TRUE(nv->value))) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);
+		}
+		ch->watch_len = 0;
+		return (STAT_OK);
+	}
+	while (((nv = nv->nx) != NULL) && (nv->valuetype != TYPE_EMPTY)) {
+		if ((nv->valuetype != TYPE_BOOL) || (!fp_TRUE(nv->value))) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);
+		}
+		if ((!nv_index_is_single(nv->index)) ||	// groups and reports fill the nv list themselves
+			(GET_TABLE_WORD(get) == sr_get) || (GET_TABLE_WORD(get) == wl_get)) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);
+		}
+		if (list.watch_len == WATCH_LIST_LEN) {
+			return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+		}
+		uint8_t i = list.watch_len++;
+		list.watch_index[i] = nv->index;
+		list.watch_get[i] = (fptrCmd)GET_TABLE_WORD(get);
+		nv_set_index(nv, nv->index, true);
+		list.watch_strip[i] = nv->strip;
+	}
+	if (list.watch_len == 0) {
+		return (STAT_INPUT_VALUE_UNSUPPORTED);
+	}
+	ch->watch_name = list.watch_name;
+	ch->watch_len = list.watch_len;
+	memcpy(ch->watch_index, list.watch_index, sizeof(list.watch_index));
+	memcpy(ch->watch_get, list.watch_get, sizeof(list.watch_get));
+	memcpy(ch->watch_strip, list.watch_strip, sizeof(list.watch_strip));
+	_populate_watch_report(ch, false, true);		// return current values - reports go from here
+
+	ch->watch_systick = SysTickTimer_getValue() + ch->watch_interval;
+	controller_set_deadline(DEADLINE_WATCH_REPORT, ch->watch_systick);
+	return (STAT_OK);
+}
+
+stat_t wl_set_wi(nvObj_t *nv)
+{
+	if (nv->value < WATCH_MIN_MS) {
+        nv->value = WATCH_MIN_MS;
+    }
+	set_int(nv);
+	return(STAT_OK);
+}
+
+#if defined(__MOTION_TRACE) || defined(__LINE_TIMES) || defined(__PROBE_SCAN)
+/*
+ * rpt_send_data_frame() - send a frame of xio.h, on the data-only channel if there is one
+ *
+ *	The frame buffer must have room for the header, len payload bytes and the CRC.
+ */
+void rpt_send_data_frame(uint8_t *frame, const uint8_t type, const uint8_t seq, const uint8_t len)
+{
+	frame[XIO_FRAME_STX] = STX;
+	frame[XIO_FRAME_LEN] = len;
+	frame[XIO_FRAME_SEQ] = seq;
+	frame[XIO_FRAME_TYPE] = type;
+	uint16_t crc = compute_crc16(&frame[XIO_FRAME_LEN], XIO_FRAME_HEADER_LEN-1 + len);
+	frame[XIO_FRAME_PAYLOAD + len] = crc & 0xFF;
+	frame[XIO_FRAME_PAYLOAD + len + 1] = crc >> 8;
+	uint16_t size = XIO_FRAME_HEADER_LEN + len + XIO_FRAME_CRC_LEN;
+	if (xio_write_data(frame, size) == 0) {
+		xio_write(frame, size);						// no data-only channel
+	}
+}
+#endif
+
+#ifdef __MOTION_TRACE
+/*
+ * Motion trace dump
+ *
+ * tr_trace_dump_callback() - main loop callback to send the motion trace as binary frames
+ * tr_get() - GET the number of records held
+ * tr_set() - SET 1 to clear and start recording, 0 to stop, 2 to stop and dump
+ *
+ *	The trace (see mp_trace_start()) goes out in the frames of xio.h, on the data-only
+ *	channel if there is one and on the control channel if not. The first frame is a header:
+ *
+ *	  type	- 'H'
+ *	  payload - records to follow (uint16), record size (uint8), motors (uint8) and the
+ *			timestamp clock in Hz (uint32), little endian
+ *
+ *	then as many 'T' frames as it takes, each with whole mpTraceRecord_t records, oldest
+ *	first. Frames are numbered from 0 in seq so gaps can be detected. A frame is only sent
+ *	when the write queue has room for it - the dump never waits on the host.
+ */
+
+#define TRACE_HEADER_FRAME_TYPE 'H'
+#define TRACE_RECORD_FRAME_TYPE 'T'
+#define TRACE_RECORDS_PER_FRAME (min(XIO_FRAME_PAYLOAD_MAX, 255) / sizeof(mpTraceRecord_t))
+
+static struct trDump {
+	bool running;					// a dump is under way
+	uint8_t seq;					// sequence number of the next frame
+	uint16_t index;					// ring index of the next record to send
+	uint16_t left;					// records still to send
+} tr_dump;
+
+static void _send_trace_frame(uint8_t *frame, const uint8_t type, const uint8_t len)
+{
+	rpt_send_data_frame(frame, type, tr_dump.seq++, len);
+}
+
+stat_t tr_trace_dump_callback()
+{
+	uint8_t frame[XIO_FRAME_HEADER_LEN + TRACE_RECORDS_PER_FRAME * sizeof(mpTraceRecord_t) + XIO_FRAME_CRC_LEN];
+
+	if (!tr_dump.running && !mp_trace.dump) {
+		return (STAT_NOOP);
+	}
+	if (min(xio_tx_space(), xio_tx_space_data()) < sizeof(frame)) {
+		return (STAT_NOOP);							// try again next pass
+	}
+	if (!tr_dump.running) {
+		mp_trace.dump = false;
+		tr_dump.running = true;
+		tr_dump.seq = 0;
+		tr_dump.left = mp_trace.count;
+		tr_dump.index = (mp_trace.next + MOTION_TRACE_SIZE - mp_trace.count) % MOTION_TRACE_SIZE;
+
+		uint8_t *wr = &frame[XIO_FRAME_PAYLOAD];
+		uint32_t clock = F_CPU;
+		*wr++ = tr_dump.left & 0xFF;
+		*wr++ = tr_dump.left >> 8;
+		*wr++ = sizeof(mpTraceRecord_t);
+		*wr++ = MOTORS;
+		memcpy(wr, &clock, sizeof(clock));
+		_send_trace_frame(frame, TRACE_HEADER_FRAME_TYPE, 4 + sizeof(clock));
+		return (STAT_OK);
+	}
+	if (tr_dump.left == 0) {
+		tr_dump.running = false;
+		return (STAT_OK);
+	}
+	uint8_t records = min(tr_dump.left, (uint16_t)TRACE_RECORDS_PER_FRAME);
+	uint8_t *wr = &frame[XIO_FRAME_PAYLOAD];
+	for (uint8_t i=0; i<records; i++) {
+		memcpy(wr, &mp_trace.record[tr_dump.index], sizeof(mpTraceRecord_t));
+		wr += sizeof(mpTraceRecord_t);
+		if (++tr_dump.index == MOTION_TRACE_SIZE) {
+			tr_dump.index = 0;
+		}
+	}
+	tr_dump.left -= records;
+	_send_trace_frame(frame, TRACE_RECORD_FRAME_TYPE, records * sizeof(mpTraceRecord_t));
+	return (STAT_OK);
+}
+
+stat_t tr_get(nvObj_t *nv)
+{
+	nv->value = mp_trace.count;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t tr_set(nvObj_t *nv)
+{
+	if (tr_dump.running) {
+		return (STAT_COMMAND_NOT_ACCEPTED);			// let the dump finish
+	}
+	uint8_t mode = nv->value;
+	if (mode == 1) {
+		mp_trace_start();
+	} else if (mode == 2) {
+		mp_trace.recording = true;					// dump what's held even if stopped
+		mp_trace_stop(true);
+	} else {
+		mp_trace_stop(false);
+	}
+	return (tr_get(nv));
+}
+#endif // __MOTION_TRACE
+
+#ifdef __LINE_TIMES
+/*
+ * Line time reports
+ *
+ * lt_line_time_callback() - main loop callback to send finished line times as binary frames
+ * lt_get() - GET 1 if line times are being taken
+ * lt_set() - SET 1 to clear and start, 0 to stop
+ *
+ *	The records kept by the exec (see mp_line_time_block()) go out in 'L' frames of xio.h,
+ *	on the data-only channel if there is one and on the control channel if not. A frame
+ *	goes when LINE_TIME_BATCH records are waiting, or when any have waited LINE_TIME_FLUSH_MS.
+ *	The payload is the count of records dropped since the start (uint32) followed by up to
+ *	LINE_TIME_BATCH mpLineTime_t records, oldest first, all little endian. Frames are numbered
+ *	from 0 in seq so gaps can be detected, and are only sent when the write queue has room.
+ */
+
+#define LINE_TIME_FRAME_TYPE 'L'
+
+static struct ltReport {
+	uint8_t seq;					// sequence number of the next frame
+	uint32_t waiting_since;			// systick when records were first seen waiting
+} lt_report;
+
+stat_t lt_line_time_callback()
+{
+	uint8_t frame[XIO_FRAME_HEADER_LEN + sizeof(uint32_t) + LINE_TIME_BATCH * sizeof(mpLineTime_t) + XIO_FRAME_CRC_LEN];
+
+	uint16_t tail = mp_line_times.tail;
+	uint16_t waiting = (mp_line_times.head + LINE_TIME_RECORDS - tail) % LINE_TIME_RECORDS;
+	if (waiting == 0) {
+		lt_report.waiting_since = 0;
+		return (STAT_NOOP);
+	}
+	uint32_t now = SysTickTimer_getValue();
+	if (lt_report.waiting_since == 0) {
+		lt_report.waiting_since = now;
+	}
+	if ((waiting < LINE_TIME_BATCH) && ((now - lt_report.waiting_since) < LINE_TIME_FLUSH_MS)) {
+		return (STAT_NOOP);
+	}
+	if (min(xio_tx_space(), xio_tx_space_data()) < sizeof(frame)) {
+		return (STAT_NOOP);							// try again next pass
+	}
+	uint8_t records = min(waiting, (uint16_t)LINE_TIME_BATCH);
+	uint8_t *wr = &frame[XIO_FRAME_PAYLOAD];
+	uint32_t dropped = mp_line_times.dropped;
+	memcpy(wr, &dropped, sizeof(dropped));
+	wr += sizeof(dropped);
+	for (uint8_t i=0; i<records; i++) {
+		memcpy(wr, &mp_line_times.record[tail], sizeof(mpLineTime_t));
+		wr += sizeof(mpLineTime_t);
+		tail = (tail + 1) % LINE_TIME_RECORDS;
+	}
+	mp_line_times.tail = tail;						// the exec can reuse them now
+	lt_report.waiting_since = 0;
+	rpt_send_data_frame(frame, LINE_TIME_FRAME_TYPE, lt_report.seq++, wr - &frame[XIO_FRAME_PAYLOAD]);
+	return (STAT_OK);
+}
+
+stat_t lt_get(nvObj_t *nv)
+{
+	nv->value = mp_line_times.enabled;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t lt_set(nvObj_t *nv)
+{
+	if (nv->value > 0) {
+		lt_report.seq = 0;
+		lt_report.waiting_since = 0;
+		mp_line_time_start();
+	} else {
+		mp_line_time_stop();
+	}
+	return (lt_get(nv));
+}
+#endif // __LINE_TIMES
+
 /*********************
  * TEXT MODE SUPPORT *
  *********************/
@@ -443,10 +1320,20 @@ stat_t sr_set_si(nvObj_t *nv)
 
 static const char fmt_si[] PROGMEM = "[si]  status interval%14d ms\n";
 static const char fmt_sv[] PROGMEM = "[sv]  status report verbosity%6d [0=off,1=filtered,2=verbose]\n";
+static const char fmt_ssi[] PROGMEM = "[ssi] status stream interval%7d ms [0=off]\n";
+static const char fmt_rr[] PROGMEM = "[rr]  report rate limit%12d reports/sec [0=unlimited]\n";
+static const char fmt_rxm[] PROGMEM = "[rxm] rx credit reports%12d [0=off,1=on]\n";
+static const char fmt_wi[] PROGMEM = "[%s] watch interval%16d ms\n";
+static const char fmt_wd[] PROGMEM = "[%s] watch deadband%16.3f\n";
 
 void sr_print_sr(nvObj_t *nv) { _populate_unfiltered_status_report();}
 void sr_print_si(nvObj_t *nv) { text_print(nv, fmt_si);}
 void sr_print_sv(nvObj_t *nv) { text_print(nv, fmt_sv);}
+void sr_print_ssi(nvObj_t *nv) { text_print(nv, fmt_ssi);}
+void rpt_print_rr(nvObj_t *nv) { text_print(nv, fmt_rr);}
+void rx_print_rxm(nvObj_t *nv) { text_print(nv, fmt_rxm);}
+void wl_print_wi(nvObj_t *nv) { text_printf(fmt_wi, nv_token(nv), (int)nv->value);}
+void wl_print_wd(nvObj_t *nv) { text_printf(fmt_wd, nv_token(nv), (double)nv->value);}
 
 #endif // __TEXT_MODE
 
@@ -458,8 +1345,17 @@ void sr_print_sv(nvObj_t *nv) { text_print(nv, fmt_sv);}
  *	  - qr	queue depth - # of buffers availabel in planner queue
  *	  - qi	buffers added to planner queue since las report
  *	  - qo	buffers removed from planner queue since last report
+ *	  - qt	planned motion time in the planner queue, in milliseconds
+ *
+ *	A QR_SINGLE report returns qr only. A QR_TRIPLE returns qr, qi and qo, plus qt.
+ *	Hosts that stream by time (see $la) should use triple reports and watch qt.
  *
- *	A QR_SINGLE report returns qr only. A QR_TRIPLE returns all 3 values
+ *	A QR_TELEMETRY report adds how well the queue has been kept fed since the cycle
+ *	started (see mp_init_queue_stats()), for tuning a sender's streaming:
+ *	  - qd	times the runtime ran dry
+ *	  - qp	plans forced by the planner timeout - the queue didn't fill in time
+ *	  - qz	moves run with a stop at the end that only the end of the lookahead asked for
+ *	  - qtn, qta, qtx  least, average and most time in the planner, in milliseconds
  *
  *	There are 2 ways to get queue reports:
  *
@@ -488,10 +1384,28 @@ void qr_init_queue_report()
  *	since the last init (usually re-initted when a report is generated).
  */
 
+static uint16_t _get_ms(const float minutes)
+{
+	float ms = minutes * MILLISECONDS_PER_MINUTE;
+	return ((ms < 65535) ? (uint16_t)ms : 65535);
+}
+
+static uint16_t _get_planned_time_ms()
+{
+	return (_get_ms(mp_get_planned_time()));
+}
+
+static uint16_t _get_average_time_in_planner_ms()
+{
+	uint32_t samples = mb.tip_samples;
+	return ((samples == 0) ? 0 : _get_ms(mb.tip_total / samples));
+}
+
 void qr_request_queue_report(int8_t buffers)
 {
 	// get buffer depth and added/removed count
 	qr.buffers_available = mp_get_planner_buffers_available();
+	qr.planned_time = _get_planned_time_ms();
 	if (buffers > 0) {
 		qr.buffers_added += buffers;
 	} else {
@@ -523,31 +1437,46 @@ stat_t qr_queue_report_callback() 		// called by controller dispatcher
 	if ((qr.queue_report_verbosity == QR_OFF) ||
         (js.json_verbosity == JV_SILENT) ||
 	    (qr.queue_report_requested == false) ||
-        (!mp_is_it_phat_city_time())) {
+        (!mp_is_it_phat_city_time()) ||
+        (xio_tx_space() < XIO_TX_HEADROOM) ||	// deferred reports are merged - they're sent with current values
+        (rpt_throttle_report(DEADLINE_NONE))) {
         return (STAT_NOOP);
     }
 
     qr.queue_report_requested = false;
+    rpt_report_sent();
 
 	if (cs.comm_mode == TEXT_MODE) {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
 			fprintf(stderr, "qr:%d\n", qr.buffers_available);
-		} else  {
-			fprintf(stderr, "qr:%d, qi:%d, qo:%d\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed);
+		} else if (qr.queue_report_verbosity == QR_TRIPLE) {
+			fprintf(stderr, "qr:%d, qi:%d, qo:%d, qt:%d\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed,qr.planned_time);
+		} else {
+			fprintf(stderr, "qr:%d, qi:%d, qo:%d, qt:%d, qd:%d, qp:%d, qz:%d, qtn:%d, qta:%d, qtx:%d\n",
+				qr.buffers_available,qr.buffers_added,qr.buffers_removed,qr.planned_time, mb.dry_outs, mb.timeout_plans,
+				mb.zero_exits, _get_ms(mb.tip_min), _get_average_time_in_planner_ms(), _get_ms(mb.tip_max));
 		}
 
 	} else if (js.json_syntax == JSON_SYNTAX_RELAXED) {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
 			fprintf(stderr, "{qr:%d}\n", qr.buffers_available);
+		} else if (qr.queue_report_verbosity == QR_TRIPLE) {
+			fprintf(stderr, "{qr:%d,qi:%d,qo:%d,qt:%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed,qr.planned_time);
 		} else {
-			fprintf(stderr, "{qr:%d,qi:%d,qo:%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+			fprintf(stderr, "{qr:%d,qi:%d,qo:%d,qt:%d,qd:%d,qp:%d,qz:%d,qtn:%d,qta:%d,qtx:%d}\n",
+				qr.buffers_available, qr.buffers_added,qr.buffers_removed,qr.planned_time, mb.dry_outs, mb.timeout_plans,
+				mb.zero_exits, _get_ms(mb.tip_min), _get_average_time_in_planner_ms(), _get_ms(mb.tip_max));
 		}
 
 	} else {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
 			fprintf(stderr, "{\"qr\":%d}\n", qr.buffers_available);
+		} else if (qr.queue_report_verbosity == QR_TRIPLE) {
+			fprintf(stderr, "{\"qr\":%d,\"qi\":%d,\"qo\":%d,\"qt\":%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed,qr.planned_time);
 		} else {
-			fprintf(stderr, "{\"qr\":%d,\"qi\":%d,\"qo\":%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+			fprintf(stderr, "{\"qr\":%d,\"qi\":%d,\"qo\":%d,\"qt\":%d,\"qd\":%d,\"qp\":%d,\"qz\":%d,\"qtn\":%d,\"qta\":%d,\"qtx\":%d}\n",
+				qr.buffers_available, qr.buffers_added,qr.buffers_removed,qr.planned_time, mb.dry_outs, mb.timeout_plans,
+				mb.zero_exits, _get_ms(mb.tip_min), _get_average_time_in_planner_ms(), _get_ms(mb.tip_max));
 		}
 	}
 	qr_init_queue_report();
@@ -555,34 +1484,99 @@ stat_t qr_queue_report_callback() 		// called by controller dispatcher
 }
 
 /*
- * rx_request_rx_report() - request an update on usb serial buffer space available
+ * rx_request_rx_report() - request a credit report whether or not the credit has moved
+ * rx_report_callback() - send the host its line and byte credit
+ *
+ *	The combined credit protocol for streaming senders. The sender counts the lines and bytes it
+ *	has sent (modulo 2^16, not counting single character commands or blank lines) and may keep
+ *	sending as long as both counts stay behind the last credit reported:
+ *
+ *	  {"rxl":n,"rxb":n}
+ *
+ *	So it never has to wait on an ok, and it can't overrun the line ring or the device buffer.
+ *	See xio_get_rx_credit() for how the credit is worked out.
+ *
+ *	Credit is reported in batches of RX_CREDIT_BATCH lines. It's reported as soon as it's granted
+ *	when the planner is running low (less than RX_CREDIT_LOW_WATER_MS planned) or there are no
+ *	lines left to take - the sender is what's holding things up then. Credit that goes backwards
+ *	means the counts started again from 0 (a queue flush or a reconnect). It's reported straight
+ *	away, and the sender starts its counts again too.
+ *
+ *	Credit reports are flow control, like the acks, so the report rate governor doesn't hold them.
  */
 
 void rx_request_rx_report(void) {
     rx.rx_report_requested = true;
-#ifdef __AVR
-	rx.space_available = xio_get_usb_rx_free();
-#else
-	rx.space_available = 254;	// preserves byte counting behaviors for G2 users
-#endif
 }
 
-/*
- * rx_report_callback() - send rx report if one has been requested
- */
 stat_t rx_report_callback(void) {
-    if (!rx.rx_report_requested) {
+    if (rx.rx_report_mode == RX_REPORT_OFF) {
         return (STAT_NOOP);
     }
-    if (!mp_is_it_phat_city_time()) {   // Don;t process this if you are time constrained in the planner
+    uint16_t lines, bytes;
+    uint8_t waiting = xio_get_rx_credit(lines, bytes);
+    int16_t new_lines = (int16_t)(lines - rx.lines_reported);
+    int16_t new_bytes = (int16_t)(bytes - rx.bytes_reported);
+
+    if (!rx.rx_report_requested) {
+        if ((new_lines == 0) && (new_bytes == 0)) {
+            return (STAT_NOOP);
+        }
+        if ((new_lines >= 0) && (new_bytes >= 0) &&     // not restarted
+            (new_lines < RX_CREDIT_BATCH) && (waiting > 0) &&
+            (_get_planned_time_ms() >= RX_CREDIT_LOW_WATER_MS)) {
+            return (STAT_NOOP);
+        }
+    }
+    if (xio_tx_space() < XIO_TX_HEADROOM) {             // deferred credit is merged - it's sent as it is then
         return (STAT_NOOP);
     }
     rx.rx_report_requested = false;
+    rx.lines_reported = lines;
+    rx.bytes_reported = bytes;
 
-    fprintf(stderr, "{\"rx\":%d}\n", rx.space_available);
+	if (cs.comm_mode == TEXT_MODE) {
+		fprintf(stderr, "rxl:%u, rxb:%u\n", lines, bytes);
+	} else if (js.json_syntax == JSON_SYNTAX_RELAXED) {
+		fprintf(stderr, "{rxl:%u,rxb:%u}\n", lines, bytes);
+	} else {
+		fprintf(stderr, "{\"rxl\":%u,\"rxb\":%u}\n", lines, bytes);
+	}
     return (STAT_OK);
 }
 
+/*
+ * rx_set_rxm() - set credit report mode - the credit is reported as soon as it's turned on
+ * rxl_get() - get line credit
+ * rxb_get() - get byte credit
+ */
+stat_t rx_set_rxm(nvObj_t *nv)
+{
+	ritorno(set_01(nv));
+	rx_request_rx_report();
+	return (STAT_OK);
+}
+
+stat_t rxl_get(nvObj_t *nv)
+{
+	uint16_t bytes;
+	uint16_t lines;
+	xio_get_rx_credit(lines, bytes);
+	nv->value = (float)lines;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t rxb_get(nvObj_t *nv)
+{
+	uint16_t bytes;
+	uint16_t lines;
+	xio_get_rx_credit(lines, bytes);
+	nv->value = (float)bytes;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
 /* Alternate Formulation for a Single report - using nvObj list
 
 	// get a clean nv object
@@ -592,7 +1586,7 @@ stat_t rx_report_callback(void) {
 	nv->nx = NULL;							// terminate the list
 
 	// make a qr object and print it
-	sprintf_P(nv->token, PSTR("qr"));
+	nv->name = "qr";
 	nv->value = qr.buffers_available;
 	nv->valuetype = TYPE_INT;
 	nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
@@ -605,6 +1599,8 @@ stat_t rx_report_callback(void) {
  * qr_get() - run a queue report (as data)
  * qi_get() - run a queue report - buffers in
  * qo_get() - run a queue report - buffers out
+ * qt_get() - run a queue report - planned time in ms
+ * qd_get(), qp_get(), qz_get(), qtn_get(), qta_get(), qtx_get() - queue telemetry for the cycle
  */
 stat_t qr_get(nvObj_t *nv)
 {
@@ -629,6 +1625,27 @@ stat_t qo_get(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+stat_t qt_get(nvObj_t *nv)
+{
+	nv->value = (float)_get_planned_time_ms();	// always up to date, like qr
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+static stat_t _get_queue_stat(nvObj_t *nv, const uint32_t value)
+{
+	nv->value = (float)value;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t qd_get(nvObj_t *nv) { return (_get_queue_stat(nv, mb.dry_outs));}
+stat_t qp_get(nvObj_t *nv) { return (_get_queue_stat(nv, mb.timeout_plans));}
+stat_t qz_get(nvObj_t *nv) { return (_get_queue_stat(nv, mb.zero_exits));}
+stat_t qtn_get(nvObj_t *nv) { return (_get_queue_stat(nv, _get_ms(mb.tip_min)));}
+stat_t qta_get(nvObj_t *nv) { return (_get_queue_stat(nv, _get_average_time_in_planner_ms()));}
+stat_t qtx_get(nvObj_t *nv) { return (_get_queue_stat(nv, _get_ms(mb.tip_max)));}
+
 /*****************************************************************************
  * JOB ID REPORTS
  *
@@ -642,14 +1659,12 @@ stat_t qo_get(nvObj_t *nv)
 
 stat_t job_populate_job_report()
 {
-	const char job_str[] = "job";
-	char tmp[TOKEN_LEN+1];
 	nvObj_t *nv = nv_reset_nv_list();		// sets *nv to the start of the body
 
 	nv->valuetype = TYPE_PARENT; 			// setup the parent object
-	strcpy(nv->token, job_str);
+	nv->name = "job";
 
-	//nv->index = nv_get_index((const char *)"", job_str);// set the index - may be needed by calling function
+	//nv->index = nv_get_index((const char *)"", nv->name);// set the index - may be needed by calling function
 	nv = nv->nx;							// no need to check for NULL as list has just been reset
 
 	index_t job_start = nv_get_index((const char *)"",(const char *)"job1");// set first job persistence index
@@ -657,10 +1672,7 @@ stat_t job_populate_job_report()
 
 		nv->index = job_start + i;
 		nv_get_nvObj(nv);
-
-		strcpy(tmp, nv->group);				// concatenate groups and tokens - do NOT use strncpy()
-		strcat(tmp, nv->token);
-		strcpy(nv->token, tmp);
+		nv->strip = 0;						// report the full token (group and token)
 
 		if ((nv = nv->nx) == NULL) return (STAT_OK); // should never be NULL unless SR length exceeds available buffer array
 	}
@@ -710,11 +1722,13 @@ void job_print_job(nvObj_t *nv) { job_populate_job_report();}
 static const char fmt_qr[] PROGMEM = "qr:%d\n";
 static const char fmt_qi[] PROGMEM = "qi:%d\n";
 static const char fmt_qo[] PROGMEM = "qo:%d\n";
-static const char fmt_qv[] PROGMEM = "[qv]  queue report verbosity%7d [0=off,1=single,2=triple]\n";
+static const char fmt_qt[] PROGMEM = "qt:%d\n";
+static const char fmt_qv[] PROGMEM = "[qv]  queue report verbosity%7d [0=off,1=single,2=triple,3=telemetry]\n";
 
 void qr_print_qr(nvObj_t *nv) { text_print(nv, fmt_qr);}    // TYPE_INT
 void qr_print_qi(nvObj_t *nv) { text_print(nv, fmt_qi);}    // TYPE_INT
 void qr_print_qo(nvObj_t *nv) { text_print(nv, fmt_qo);}    // TYPE_INT
+void qr_print_qt(nvObj_t *nv) { text_print(nv, fmt_qt);}    // TYPE_INT
 void qr_print_qv(nvObj_t *nv) { text_print(nv, fmt_qv);}    // TYPE_INT
 
 #endif // __TEXT_MODE
@@ -36,6 +36,23 @@
 
 #define MIN_ARC_QR_INTERVAL 200		// minimum interval between QRs during arc generation (in system ticks)
 
+#ifndef REPORT_RATE_LIMIT
+#define REPORT_RATE_LIMIT 50		// automatic reports per second, all kinds together - 0 is unlimited
+#endif
+#ifndef REPORT_BURST
+#define REPORT_BURST 4				// automatic reports that can go out back to back after a quiet spell
+#endif
+#ifndef RX_REPORT_MODE
+#define RX_REPORT_MODE RX_REPORT_OFF	// credit reports for streaming senders - see rx_report_callback()
+#endif
+#ifndef RX_CREDIT_BATCH
+#define RX_CREDIT_BATCH 2			// lines of credit gathered into one report
+#endif
+#ifndef RX_CREDIT_LOW_WATER_MS
+#define RX_CREDIT_LOW_WATER_MS 250	// planned time in ms below which credit is reported as soon as it's granted
+#endif
+#define REPORT_RATE_MAX 1000		// reports per second - more than this is unlimited in practice
+
 typedef enum {					    // status report enable, verbosity and request type
 	SR_OFF = 0,						// no reports
 	SR_FILTERED,					// reports only values that have changed from the last report
@@ -52,9 +69,15 @@ typedef enum {
 typedef enum {					    // planner queue enable and verbosity
 	QR_OFF = 0,						// no response is provided
 	QR_SINGLE,						// queue depth reported
-	QR_TRIPLE						// queue depth reported for buffers, buffers added, buffered removed
+	QR_TRIPLE,						// queue depth reported for buffers, buffers added, buffered removed
+	QR_TELEMETRY					// triple plus starvation and lookahead telemetry for the cycle
 } qrVerbosity;
 
+typedef enum {					    // credit reports for host flow control
+	RX_REPORT_OFF = 0,				// no reports - the host waits on responses
+	RX_REPORT_CREDIT				// line and byte credit is reported as it's granted
+} rxReportMode;
+
 typedef struct srSingleton {
 
 	/*** config values (PUBLIC) ***/
@@ -69,6 +92,19 @@ typedef struct srSingleton {
 	index_t status_report_list[NV_STATUS_REPORT_LEN];	// status report elements to report
 	float status_report_value[NV_STATUS_REPORT_LEN];	// previous values for filtered reporting
 
+	// compiled status report template - see _get_status_report_element()
+	index_t status_report_compiled[NV_STATUS_REPORT_LEN];	// index each element was compiled for
+	fptrCmd status_report_get[NV_STATUS_REPORT_LEN];	// element's get function
+	uint8_t status_report_strip[NV_STATUS_REPORT_LEN];	// length of the group stripped for the getter
+
+#ifdef __BINARY_DATA
+	// status stream on the data channel - see sr_status_stream_callback()
+	uint32_t status_stream_interval;					// in milliseconds - 0 disables the stream
+	uint32_t status_stream_systick;						// SysTick value for the next stream frame
+	uint8_t status_stream_seq;							// sequence number of the last stream frame
+	float status_stream_value[NV_STATUS_REPORT_LEN];	// values last streamed
+#endif
+
 } srSingleton_t;
 
 typedef struct qrSingleton {		// data for queue reports
@@ -82,28 +118,116 @@ typedef struct qrSingleton {		// data for queue reports
 	uint8_t prev_available;			// buffers available at last count
 	uint16_t buffers_added;			// buffers added since last count
 	uint16_t buffers_removed;		// buffers removed since last report
+	uint16_t planned_time;			// planned motion time in the queue in ms
 	uint8_t motion_mode;			// used to detect arc movement
 	uint32_t init_tick;				// time when values were last initialized or cleared
 
 } qrSingleton_t;
 
-typedef struct rxSingleton {
-	uint8_t rx_report_requested;
-	uint16_t space_available;		// space available in usb rx buffer at time of request
+typedef struct rxSingleton {		// host flow control credit - see rx_report_callback()
+
+	/*** config values (PUBLIC) ***/
+	rxReportMode rx_report_mode;	// credit reports enabled
+
+	/*** runtime values (PRIVATE) ***/
+	uint8_t rx_report_requested;	// set to true to report the credit whether or not it has moved
+	uint16_t lines_reported;		// line credit in the last report
+	uint16_t bytes_reported;		// byte credit in the last report
 } rxSingleton_t;
 
+typedef struct rptSingleton {		// output rate governor for automatic reports - see rpt_throttle_report()
+
+	/*** config values (PUBLIC) ***/
+	uint32_t report_rate_limit;		// reports per second, 0 = unlimited
+
+	/*** runtime values (PRIVATE) ***/
+	uint32_t report_credit;			// token bucket - 1000 per report
+	uint32_t report_systick;		// SysTick value the credit was last brought up to date
+} rptSingleton_t;
+
+#ifndef EXCEPTION_QUEUE_SIZE
+#define EXCEPTION_QUEUE_SIZE 8			// exceptions raised in interrupts waiting to be reported - a power of 2
+#endif
+
+typedef enum {
+	EXCEPTION_REPORT = 0,			// send an exception report
+	EXCEPTION_ALARM,				// enter alarm with cm_alarm(), which sends the report
+	EXCEPTION_PANIC					// enter panic with cm_panic(), which sends the report
+} rptExceptionAction;
+
+typedef struct rptException {		// an exception raised in an interrupt - see rpt_post_exception()
+	const char *msg;				// a string constant - nothing is formatted in the interrupt
+	int32_t value;					// a number that goes with the message, e.g. an input - 0 is none
+	uint32_t linenum;				// runtime line number when it was raised
+	stat_t status;
+	uint8_t action;					// rptExceptionAction
+} rptException_t;
+
+#ifndef WATCH_CHANNELS
+#define WATCH_CHANNELS 2								// watch lists w1 - wN, up to 4 - see wl_watch_report_callback()
+#endif
+#define WATCH_LIST_LEN 12								// max number of elements in a watch list
+
+typedef struct wlChannel {			// one watch list (watch report subscription)
+
+	/*** config values (PUBLIC) ***/
+	uint32_t watch_interval;							// minimum milliseconds between reports
+	float watch_deadband;								// report values that have moved by more than this
+
+	/*** runtime values (PRIVATE) ***/
+	uint32_t watch_systick;								// SysTick value for the next look at the values
+	index_t watch_name;									// table index of the wN token - names the report
+	uint8_t watch_len;									// elements in the list - 0 is unsubscribed
+
+	// compiled watch list - see _get_compiled_element()
+	index_t watch_index[WATCH_LIST_LEN];				// element's table index
+	fptrCmd watch_get[WATCH_LIST_LEN];					// element's get function
+	uint8_t watch_strip[WATCH_LIST_LEN];				// length of the group stripped for the getter
+	float watch_value[WATCH_LIST_LEN];					// values last reported
+} wlChannel_t;
+
+#ifndef STATUS_STREAM_INTERVAL_MS
+#define STATUS_STREAM_INTERVAL_MS	0					// milliseconds - 0 disables the status stream
+#endif
+#define STATUS_STREAM_MIN_MS		10					// milliseconds - enforces a viable minimum
+
+#ifndef WATCH_INTERVAL_MS
+#define WATCH_INTERVAL_MS			100					// milliseconds - default minimum watch report interval
+#endif
+#ifndef WATCH_DEADBAND
+#define WATCH_DEADBAND				0					// default watch deadband - 0 reports any change
+#endif
+#define WATCH_MIN_MS				10					// milliseconds - enforces a viable minimum
+
+#if (WATCH_CHANNELS < 1) || (WATCH_CHANNELS > 4)
+#error WATCH_CHANNELS must be 1 - 4 (there are only w1 - w4 entries in cfgArray)
+#endif
+
 /**** Externs - See report.c for allocation ****/
 
 extern srSingleton_t sr;
 extern qrSingleton_t qr;
 extern rxSingleton_t rx;
+extern rptSingleton_t rpt;
+extern wlChannel_t wl[WATCH_CHANNELS];
 
 /**** Function Prototypes ****/
 
 void rpt_print_message(char *msg);
 stat_t rpt_exception(stat_t status, const char *msg);
+stat_t rpt_post_exception(stat_t status, const char *msg);
+stat_t rpt_post_alarm(stat_t status, const char *msg);
+stat_t rpt_post_panic(stat_t status, const char *msg, int32_t value);
+stat_t rpt_exception_callback(void);
 
 stat_t rpt_er(nvObj_t *nv);
+bool rpt_throttle_report(uint8_t deadline);
+void rpt_report_sent(void);
+stat_t rpt_set_rr(nvObj_t *nv);
+#ifdef __REPORT_FANOUT
+stat_t rpt_get_sub(nvObj_t *nv);
+stat_t rpt_set_sub(nvObj_t *nv);
+#endif
 void rpt_print_loading_configs_message(void);
 void rpt_print_initializing_message(void);
 void rpt_print_system_ready_message(void);
@@ -117,6 +241,10 @@ stat_t sr_run_text_status_report(void);
 stat_t sr_get(nvObj_t *nv);
 stat_t sr_set(nvObj_t *nv);
 stat_t sr_set_si(nvObj_t *nv);
+#ifdef __BINARY_DATA
+stat_t sr_status_stream_callback(void);
+stat_t sr_set_ssi(nvObj_t *nv);
+#endif
 
 void qr_init_queue_report(void);
 void qr_request_queue_report(int8_t buffers);
@@ -124,30 +252,73 @@ stat_t qr_queue_report_callback(void);
 
 void rx_request_rx_report(void);
 stat_t rx_report_callback(void);
+stat_t rx_set_rxm(nvObj_t *nv);
+stat_t rxl_get(nvObj_t *nv);
+stat_t rxb_get(nvObj_t *nv);
+
+stat_t wl_watch_report_callback(void);
+stat_t wl_get(nvObj_t *nv);
+stat_t wl_set(nvObj_t *nv);
+stat_t wl_set_wi(nvObj_t *nv);
+
+#if defined(__MOTION_TRACE) || defined(__LINE_TIMES) || defined(__PROBE_SCAN)
+void rpt_send_data_frame(uint8_t *frame, const uint8_t type, const uint8_t seq, const uint8_t len);
+#endif
+
+#ifdef __MOTION_TRACE
+stat_t tr_trace_dump_callback(void);
+stat_t tr_get(nvObj_t *nv);
+stat_t tr_set(nvObj_t *nv);
+#endif
+
+#ifdef __LINE_TIMES
+stat_t lt_line_time_callback(void);
+stat_t lt_get(nvObj_t *nv);
+stat_t lt_set(nvObj_t *nv);
+#endif
 
 stat_t qr_get(nvObj_t *nv);
 stat_t qi_get(nvObj_t *nv);
 stat_t qo_get(nvObj_t *nv);
+stat_t qt_get(nvObj_t *nv);
+stat_t qd_get(nvObj_t *nv);
+stat_t qp_get(nvObj_t *nv);
+stat_t qz_get(nvObj_t *nv);
+stat_t qtn_get(nvObj_t *nv);
+stat_t qta_get(nvObj_t *nv);
+stat_t qtx_get(nvObj_t *nv);
 
 #ifdef __TEXT_MODE
 
 	void sr_print_sr(nvObj_t *nv);
 	void sr_print_si(nvObj_t *nv);
 	void sr_print_sv(nvObj_t *nv);
+	void sr_print_ssi(nvObj_t *nv);
+	void rpt_print_rr(nvObj_t *nv);
+	void rx_print_rxm(nvObj_t *nv);
+	void wl_print_wi(nvObj_t *nv);
+	void wl_print_wd(nvObj_t *nv);
 	void qr_print_qv(nvObj_t *nv);
 	void qr_print_qr(nvObj_t *nv);
 	void qr_print_qi(nvObj_t *nv);
 	void qr_print_qo(nvObj_t *nv);
+	void qr_print_qt(nvObj_t *nv);
 
 #else
 
 	#define sr_print_sr tx_print_stub
 	#define sr_print_si tx_print_stub
 	#define sr_print_sv tx_print_stub
+	#define sr_print_ssi tx_print_stub
+	#define rpt_print_rr tx_print_stub
+	#define rx_print_rxm tx_print_stub
+	#define wl_print_wi tx_print_stub
+	#define wl_print_wd tx_print_stub
 	#define qr_print_qv tx_print_stub
 	#define qr_print_qr tx_print_stub
 	#define qr_print_qi tx_print_stub
 	#define qr_print_qo tx_print_stub
+	#define qr_print_qt tx_print_stub
 
 #endif // __TEXT_MODE
 
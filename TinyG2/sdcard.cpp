@@ -0,0 +1,378 @@
+/*
+ * sdcard.cpp - SD card and FAT file reader for the xio file channel
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ * Copyright (c) 2015 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * The card is (re)initialized and the filesystem mounted every time a file is opened, so a
+ * card can be swapped between jobs. Everything is blocking: opening takes up to a second while
+ * the card powers up, and a sector read takes a few hundred microseconds at SD_SPI_BAUD.
+ * The caller passes in a sector sized buffer for each call, so this module holds no sector
+ * of its own - directory and FAT sectors are read into the same buffer as the file data.
+ *
+ * Supported: SD (v1 and v2) and SDHC/SDXC cards; FAT16 and FAT32, unpartitioned or in the first
+ * MBR partition; 8.3 names in the root directory. Not supported: FAT12, long file names (a file
+ * is found by its 8.3 alias), subdirectories and writing.
+ */
+#include "tinyg2.h"
+#include "config.h"
+#include "hardware.h"
+#include "xio.h"					// MotateSPI.h and the ASCII definitions
+#include "sdcard.h"
+
+#ifdef __FILE_CHANNEL
+
+using namespace Motate;
+
+static SPI<SD_SPI_CS_PIN> sd_spi(SD_SPI_INIT_BAUD);
+
+// SPI mode commands and responses
+#define CMD0			0					// GO_IDLE_STATE
+#define CMD8			8					// SEND_IF_COND
+#define CMD16			16					// SET_BLOCKLEN
+#define CMD17			17					// READ_SINGLE_BLOCK
+#define CMD55			55					// APP_CMD - next command is an ACMD
+#define CMD58			58					// READ_OCR
+#define ACMD41			41					// SD_SEND_OP_COND
+
+#define R1_READY		0x00
+#define R1_IDLE			0x01
+#define DATA_TOKEN		0xFE				// starts a data block
+#define OCR_CCS			0x40				// card capacity status - first OCR byte
+
+#define SD_CMD0_TRIES	10
+#define SD_INIT_TRIES	4000				// ACMD41 polls - a little over the 1 second the spec allows
+#define SD_READ_TRIES	100000				// bytes waited for a data token - about the 100 ms the spec allows
+
+// FAT
+#define FAT_ENTRY_SIZE	32					// directory entry
+#define FAT_ATTR_VOLUME	0x08				// (long name entries have it too)
+#define FAT_ATTR_DIR	0x10
+#define FAT_DELETED		0xE5
+#define FAT16_EOC		0xFFF8				// end of a cluster chain, and up
+#define FAT32_EOC		0x0FFFFFF8
+#define FAT32_MASK		0x0FFFFFFF
+
+static struct sdCard {
+	bool block_addressing;					// SDHC/SDXC - commands take sectors, not bytes
+	bool fat32;
+	uint8_t sectors_per_cluster;
+	uint32_t fat_start;						// first sector of the first FAT
+	uint32_t root_start;					// FAT16 - first sector of the root directory
+	uint16_t root_sectors;					// FAT16 - length of the root directory
+	uint32_t root_cluster;					// FAT32 - first cluster of the root directory
+	uint32_t data_start;					// first sector of cluster 2
+
+	uint32_t cluster;						// file - cluster being read
+	uint8_t cluster_sector;					// file - next sector in that cluster
+	uint32_t remaining;						// file - bytes not read yet, 0 once closed
+} sd;
+
+static inline uint16_t _le16(const uint8_t *p) { return ((uint16_t)p[0] | ((uint16_t)p[1] << 8)); }
+static inline uint32_t _le32(const uint8_t *p) { return ((uint32_t)_le16(p) | ((uint32_t)_le16(p+2) << 16)); }
+
+/*
+ * SD card primitives
+ *
+ *	The chip select is asserted by the first transfer and held until _deselect(), which also
+ *	gives the card the clocks it needs after a command.
+ */
+
+static inline uint8_t _xfer(uint8_t out) { return ((uint8_t)sd_spi.transfer(out)); }
+static inline void _deselect() { sd_spi.transfer(0xFF, true); }
+
+static uint8_t _command(uint8_t cmd, uint32_t arg)
+{
+	_xfer(0xFF);
+	_xfer(0x40 | cmd);
+	_xfer(arg >> 24);
+	_xfer(arg >> 16);
+	_xfer(arg >> 8);
+	_xfer(arg);
+	_xfer((cmd == CMD0) ? 0x95 : ((cmd == CMD8) ? 0x87 : 0x01));	// only these two are CRC checked
+
+	uint8_t r1 = 0xFF;
+	for (uint8_t i=0; (i < 8) && (r1 & 0x80); i++) {
+		r1 = _xfer(0xFF);
+	}
+	return (r1);
+}
+
+static stat_t _init_card()
+{
+	sd_spi.setOptions(SD_SPI_INIT_BAUD, kSPI8Bit | kSPIMode0);
+	sd_spi.setChannel();
+	for (uint8_t i=0; i<10; i++) {			// at least 74 clocks to wake the card up
+		_xfer(0xFF);
+	}
+	_deselect();
+
+	uint8_t r1 = 0xFF;
+	for (uint8_t i=0; (i < SD_CMD0_TRIES) && (r1 != R1_IDLE); i++) {
+		r1 = _command(CMD0, 0);
+		_deselect();
+	}
+	if (r1 != R1_IDLE) {
+		return (STAT_NO_SUCH_DEVICE);		// no card, or it's not answering
+	}
+
+	bool v2 = false;						// v1 cards don't know CMD8
+	if (_command(CMD8, 0x1AA) == R1_IDLE) {
+		uint8_t r7[4];
+		for (uint8_t i=0; i<4; i++) { r7[i] = _xfer(0xFF); }
+		if (r7[3] != 0xAA) {
+			_deselect();
+			return (STAT_NO_SUCH_DEVICE);	// doesn't take our voltage
+		}
+		v2 = true;
+	}
+	_deselect();
+
+	uint16_t tries = 0;
+	do {
+#ifdef __WATCHDOG
+		hw_watchdog_feed();					// a card can take a second to come out of idle
+#endif
+		_command(CMD55, 0);
+		r1 = _command(ACMD41, v2 ? 0x40000000 : 0);		// HCS - we take high capacity cards
+		_deselect();
+	} while ((r1 == R1_IDLE) && (++tries < SD_INIT_TRIES));
+	if (r1 != R1_READY) {
+		return (STAT_NO_SUCH_DEVICE);
+	}
+
+	sd.block_addressing = false;
+	if (v2) {
+		if (_command(CMD58, 0) != R1_READY) {
+			_deselect();
+			return (STAT_NO_SUCH_DEVICE);
+		}
+		sd.block_addressing = (_xfer(0xFF) & OCR_CCS);
+		for (uint8_t i=0; i<3; i++) { _xfer(0xFF); }
+		_deselect();
+	}
+	if (!sd.block_addressing) {				// standard capacity cards can read other block sizes
+		r1 = _command(CMD16, SD_SECTOR_SIZE);
+		_deselect();
+		if (r1 != R1_READY) {
+			return (STAT_NO_SUCH_DEVICE);
+		}
+	}
+	sd_spi.setOptions(SD_SPI_BAUD, kSPI8Bit | kSPIMode0);
+	return (STAT_OK);
+}
+
+static stat_t _read_sector(uint32_t sector, uint8_t *buf)
+{
+#ifdef __WATCHDOG
+	hw_watchdog_feed();						// sd_open() can read a whole directory in one call
+#endif
+	if (_command(CMD17, sd.block_addressing ? sector : (sector * SD_SECTOR_SIZE)) != R1_READY) {
+		_deselect();
+		return (STAT_NO_SUCH_DEVICE);
+	}
+	uint8_t token;
+	uint32_t tries = 0;
+	while (((token = _xfer(0xFF)) == 0xFF) && (++tries < SD_READ_TRIES));
+	if (token != DATA_TOKEN) {
+		_deselect();
+		return (STAT_NO_SUCH_DEVICE);
+	}
+	for (uint16_t i=0; i<SD_SECTOR_SIZE; i++) {
+		buf[i] = _xfer(0xFF);
+	}
+	_xfer(0xFF);							// CRC - not checked
+	_xfer(0xFF);
+	_deselect();
+	return (STAT_OK);
+}
+
+/*
+ * FAT
+ */
+
+static uint32_t _cluster_sector(uint32_t cluster)
+{
+	return (sd.data_start + (cluster - 2) * sd.sectors_per_cluster);
+}
+
+// _next_cluster() - follow the chain. Sets cluster to 0 at the end of it.
+static stat_t _next_cluster(uint32_t &cluster, uint8_t *buf)
+{
+	uint32_t offset = cluster * (sd.fat32 ? 4 : 2);
+	ritorno(_read_sector(sd.fat_start + (offset / SD_SECTOR_SIZE), buf));
+	offset %= SD_SECTOR_SIZE;
+	if (sd.fat32) {
+		cluster = _le32(&buf[offset]) & FAT32_MASK;
+		if (cluster >= FAT32_EOC) { cluster = 0; }
+	} else {
+		cluster = _le16(&buf[offset]);
+		if (cluster >= FAT16_EOC) { cluster = 0; }
+	}
+	if (cluster == 1) {
+		cluster = 0;						// not a cluster - treat it as the end
+	}
+	return (STAT_OK);
+}
+
+static stat_t _mount(uint8_t *buf)
+{
+	uint32_t part = 0;
+	ritorno(_read_sector(0, buf));
+	if ((buf[0] != 0xEB) && (buf[0] != 0xE9)) {			// no jump - it's an MBR, not a boot sector
+		part = _le32(&buf[446 + 8]);					// first partition
+		ritorno(_read_sector(part, buf));
+	}
+	if ((buf[510] != 0x55) || (buf[511] != 0xAA) || (_le16(&buf[11]) != SD_SECTOR_SIZE) || (buf[13] == 0)) {
+		return (STAT_NO_SUCH_DEVICE);					// no filesystem we can read
+	}
+	uint32_t total_sectors = (_le16(&buf[19]) != 0) ? _le16(&buf[19]) : _le32(&buf[32]);
+	uint32_t fat_sectors = (_le16(&buf[22]) != 0) ? _le16(&buf[22]) : _le32(&buf[36]);
+
+	sd.sectors_per_cluster = buf[13];
+	sd.fat_start = part + _le16(&buf[14]);
+	sd.root_start = sd.fat_start + buf[16] * fat_sectors;
+	sd.root_sectors = ((uint32_t)_le16(&buf[17]) * FAT_ENTRY_SIZE + SD_SECTOR_SIZE-1) / SD_SECTOR_SIZE;
+	sd.data_start = sd.root_start + sd.root_sectors;
+
+	uint32_t clusters = (total_sectors - (sd.data_start - part)) / sd.sectors_per_cluster;
+	if (clusters < 4085) {
+		return (STAT_NO_SUCH_DEVICE);					// FAT12
+	}
+	sd.fat32 = (clusters >= 65525);
+	sd.root_cluster = sd.fat32 ? _le32(&buf[44]) : 0;
+	return (STAT_OK);
+}
+
+// _make_name() - name.ext as a directory entry has it: upper case, blank padded, no dot
+static bool _make_name(const char *name, char *entry_name)
+{
+	memset(entry_name, ' ', 11);
+	uint8_t i = 0;
+	uint8_t end = 8;
+	for (; *name != NUL; name++) {
+		char c = *name;
+		if (c == '.') {
+			if (end == 11) { return (false); }			// a second dot
+			i = 8;
+			end = 11;
+			continue;
+		}
+		if ((i == end) || (c <= ' ') || (c == '/') || (c == '\\')) {
+			return (false);
+		}
+		entry_name[i++] = ((c >= 'a') && (c <= 'z')) ? (c - 'a' + 'A') : c;
+	}
+	return (entry_name[0] != ' ');
+}
+
+static stat_t _find(const char *entry_name, uint8_t *buf)
+{
+	uint32_t cluster = sd.root_cluster;
+	uint32_t sector = sd.fat32 ? _cluster_sector(cluster) : sd.root_start;
+	uint16_t sectors = sd.fat32 ? sd.sectors_per_cluster : sd.root_sectors;
+
+	for (;;) {
+		for (uint16_t i=0; i<sectors; i++) {
+			ritorno(_read_sector(sector + i, buf));
+			for (uint16_t e=0; e<SD_SECTOR_SIZE; e+=FAT_ENTRY_SIZE) {
+				const uint8_t *entry = &buf[e];
+				if (entry[0] == NUL) {
+					return (STAT_FILE_NOT_OPEN);			// end of the directory
+				}
+				if ((entry[0] == FAT_DELETED) || (entry[11] & (FAT_ATTR_VOLUME | FAT_ATTR_DIR))) {
+					continue;
+				}
+				if (memcmp(entry, entry_name, 11) == 0) {
+					sd.cluster = ((uint32_t)_le16(&entry[20]) << 16) | _le16(&entry[26]);
+					sd.cluster_sector = 0;
+					sd.remaining = _le32(&entry[28]);
+					return (STAT_OK);
+				}
+			}
+		}
+		if (!sd.fat32) {
+			break;
+		}
+		ritorno(_next_cluster(cluster, buf));
+		if (cluster == 0) {
+			break;
+		}
+		sector = _cluster_sector(cluster);
+	}
+	return (STAT_FILE_NOT_OPEN);
+}
+
+/*
+ * sd_open()  - initialize the card, mount it and open a file in the root directory
+ * sd_read()  - read the next sector of the file into buf
+ * sd_close() - forget the file
+ *
+ *	buf is a SD_SECTOR_SIZE buffer for sd_open() to work in. sd_open() returns STAT_NO_SUCH_DEVICE
+ *	if there's no card or filesystem it can read, and STAT_FILE_NOT_OPEN if there's no such file.
+ *	sd_read() returns the bytes of the file it read - SD_SECTOR_SIZE, less for the last sector -
+ *	0 at the end of the file, or -1 if the card failed or the file's cluster chain is broken.
+ */
+stat_t sd_open(const char *name, uint8_t *buf)
+{
+	char entry_name[11];
+	sd_close();
+	if (!_make_name(name, entry_name)) {
+		return (STAT_FILE_NOT_OPEN);
+	}
+	ritorno(_init_card());
+	ritorno(_mount(buf));
+	return (_find(entry_name, buf));
+}
+
+int16_t sd_read(uint8_t *buf)
+{
+	if (sd.remaining == 0) {
+		return (0);
+	}
+	if (sd.cluster_sector == sd.sectors_per_cluster) {
+		if (_next_cluster(sd.cluster, buf) != STAT_OK) {
+			sd_close();
+			return (-1);
+		}
+		sd.cluster_sector = 0;
+	}
+	if ((sd.cluster < 2) || (_read_sector(_cluster_sector(sd.cluster) + sd.cluster_sector, buf) != STAT_OK)) {
+		sd_close();
+		return (-1);
+	}
+	sd.cluster_sector++;
+	uint16_t count = (sd.remaining < SD_SECTOR_SIZE) ? sd.remaining : SD_SECTOR_SIZE;
+	sd.remaining -= count;
+	return (count);
+}
+
+void sd_close()
+{
+	sd.remaining = 0;
+	sd.cluster = 0;
+}
+
+#endif // __FILE_CHANNEL
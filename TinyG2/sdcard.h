@@ -0,0 +1,55 @@
+/*
+ * sdcard.h - SD card and FAT file reader for the xio file channel
+ * This file is part of the TinyG2 project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ * Copyright (c) 2015 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Read-only access to one file at a time in the root directory of a FAT16 or FAT32 SD card,
+ * talked to in SPI mode through the Motate SPI template. Built with __FILE_CHANNEL - see
+ * xioFile in xio.cpp, which runs the file as a data channel.
+ */
+#ifndef SDCARD_H_ONCE
+#define SDCARD_H_ONCE
+
+#define SD_SECTOR_SIZE		512				// bytes read from the card at a time
+#define SD_NAME_MAX			12				// longest file name - 8.3 with the dot
+
+#ifndef SD_SPI_CS_PIN
+#define SD_SPI_CS_PIN		kSocket4_SPISlaveSelectPinNumber	// chip select - must be an SPI0 NPCS pin
+#endif
+#ifndef SD_SPI_INIT_BAUD
+#define SD_SPI_INIT_BAUD	400000			// SPI clock until the card is initialized - 100 to 400 KHz
+#endif
+#ifndef SD_SPI_BAUD
+#define SD_SPI_BAUD			21000000		// SPI clock for reading - up to 25 MHz
+#endif
+
+/**** function prototypes ****/
+
+stat_t sd_open(const char *name, uint8_t *buf);
+int16_t sd_read(uint8_t *buf);
+void sd_close(void);
+
+#endif // SDCARD_H_ONCE
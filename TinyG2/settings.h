@@ -49,4 +49,480 @@
 #include "settings/settings_default.h"				// Default settings for release
 #endif
 
+/**** Defaults for settings that not every machine profile defines ****/
+
+#ifndef AXES_ACTIVE
+#define AXES_ACTIVE					AXES					// axes the machine has - see tinyg2.h
+#endif
+#ifndef MOTORS_ACTIVE
+#define MOTORS_ACTIVE				MOTORS					// motors the machine has - see tinyg2.h
+#endif
+
+#ifndef X_SHAPER_TYPE
+#define X_SHAPER_TYPE				0						// xist input shaper 0=none, 1=ZV, 2=ZVD, 3=EI
+#endif
+#ifndef X_SHAPER_FREQUENCY
+#define X_SHAPER_FREQUENCY			40						// xisf Hz
+#endif
+#ifndef X_SHAPER_DAMPING
+#define X_SHAPER_DAMPING			0.1						// xisd damping ratio
+#endif
+#ifndef Y_SHAPER_TYPE
+#define Y_SHAPER_TYPE				0						// yist input shaper 0=none, 1=ZV, 2=ZVD, 3=EI
+#endif
+#ifndef Y_SHAPER_FREQUENCY
+#define Y_SHAPER_FREQUENCY			40						// yisf Hz
+#endif
+#ifndef Y_SHAPER_DAMPING
+#define Y_SHAPER_DAMPING			0.1						// yisd damping ratio
+#endif
+#ifndef Z_SHAPER_TYPE
+#define Z_SHAPER_TYPE				0						// zist input shaper 0=none, 1=ZV, 2=ZVD, 3=EI
+#endif
+#ifndef Z_SHAPER_FREQUENCY
+#define Z_SHAPER_FREQUENCY			40						// zisf Hz
+#endif
+#ifndef Z_SHAPER_DAMPING
+#define Z_SHAPER_DAMPING			0.1						// zisd damping ratio
+#endif
+#ifndef A_SHAPER_TYPE
+#define A_SHAPER_TYPE				0						// aist input shaper 0=none, 1=ZV, 2=ZVD, 3=EI
+#endif
+#ifndef A_SHAPER_FREQUENCY
+#define A_SHAPER_FREQUENCY			40						// aisf Hz
+#endif
+#ifndef A_SHAPER_DAMPING
+#define A_SHAPER_DAMPING			0.1						// aisd damping ratio
+#endif
+#ifndef B_SHAPER_TYPE
+#define B_SHAPER_TYPE				0						// bist input shaper 0=none, 1=ZV, 2=ZVD, 3=EI
+#endif
+#ifndef B_SHAPER_FREQUENCY
+#define B_SHAPER_FREQUENCY			40						// bisf Hz
+#endif
+#ifndef B_SHAPER_DAMPING
+#define B_SHAPER_DAMPING			0.1						// bisd damping ratio
+#endif
+#ifndef C_SHAPER_TYPE
+#define C_SHAPER_TYPE				0						// cist input shaper 0=none, 1=ZV, 2=ZVD, 3=EI
+#endif
+#ifndef C_SHAPER_FREQUENCY
+#define C_SHAPER_FREQUENCY			40						// cisf Hz
+#endif
+#ifndef C_SHAPER_DAMPING
+#define C_SHAPER_DAMPING			0.1						// cisd damping ratio
+#endif
+#ifndef A_PRESSURE_ADVANCE
+#define A_PRESSURE_ADVANCE		0						// apa seconds of extruder lead, 0=off
+#endif
+#ifndef B_PRESSURE_ADVANCE
+#define B_PRESSURE_ADVANCE		0						// bpa seconds of extruder lead, 0=off
+#endif
+#ifndef C_PRESSURE_ADVANCE
+#define C_PRESSURE_ADVANCE		0						// cpa seconds of extruder lead, 0=off
+#endif
+#ifndef M1_BACKLASH
+#define M1_BACKLASH					0						// 1bl steps
+#endif
+#ifndef M2_BACKLASH
+#define M2_BACKLASH					0						// 2bl steps
+#endif
+#ifndef M3_BACKLASH
+#define M3_BACKLASH					0						// 3bl steps
+#endif
+#ifndef M4_BACKLASH
+#define M4_BACKLASH					0						// 4bl steps
+#endif
+#ifndef M5_BACKLASH
+#define M5_BACKLASH					0						// 5bl steps
+#endif
+#ifndef M6_BACKLASH
+#define M6_BACKLASH					0						// 6bl steps
+#endif
+#ifndef MOTOR_IDLE_POWER_FACTOR
+#define MOTOR_IDLE_POWER_FACTOR		0.50					// ipl fraction of the power level held at idle in power mode 4
+#endif
+#ifndef STEP_PULSE_WIDTH
+#define STEP_PULSE_WIDTH			0						// spw step pulse width in microseconds, 0=longest the DDA clock allows
+#endif
+#ifndef DIRECTION_SETUP_TIME
+#define DIRECTION_SETUP_TIME		0						// dst minimum time from a direction change to the next step, in microseconds
+#endif
+#ifndef MICROSTEP_MORPH_RATE
+#define MICROSTEP_MORPH_RATE		50000					// msr physical steps per second that halve the microsteps of a motor with $1mm set
+#endif
+#ifndef AUX_MOTOR
+#define AUX_MOTOR					0						// auxm motor run by the aux motion channel, 1-N, 0=off
+#endif
+#ifndef AUX_VELOCITY
+#define AUX_VELOCITY				3600					// auxv aux move velocity, units per minute
+#endif
+#ifndef AUX_ACCELERATION
+#define AUX_ACCELERATION			500						// auxa aux move acceleration, units per second squared
+#endif
+#ifndef PROBE_INPUT
+#define PROBE_INPUT					5						// prbi digital input the probe is wired to, 1-N (5 is Z min)
+#endif
+#ifndef NETWORK_MODE
+#define NETWORK_MODE				NETWORK_STANDALONE		// net segment sync 0=standalone, 1=master, 2=slave
+#endif
+#ifndef STALL_WARNING_STEPS
+#define STALL_WARNING_STEPS			0						// few following error that slows the feed, in steps, 0=off
+#endif
+#ifndef STALL_FEED_STEP
+#define STALL_FEED_STEP				0.10					// fes feed override taken off (and given back) per check
+#endif
+#ifndef LOAD_FEED_INPUT
+#define LOAD_FEED_INPUT				0						// lfi analog input read as spindle load, 0=adaptive feed off
+#endif
+#ifndef LOAD_FEED_TARGET
+#define LOAD_FEED_TARGET			1.0						// lft spindle load to hold, in the input's units
+#endif
+#ifndef LOAD_FEED_GAIN
+#define LOAD_FEED_GAIN				1.0						// lfg feed factor change per second per unit of relative load error
+#endif
+#ifndef LOAD_FEED_MIN
+#define LOAD_FEED_MIN				0.25					// lfm lowest adaptive feed factor
+#endif
+#ifndef LOAD_FEED_MAX
+#define LOAD_FEED_MAX				1.50					// lfx highest adaptive feed factor
+#endif
+#ifndef TANGENT_AXIS
+#define TANGENT_AXIS				0						// tna rotary axis following the XY direction, 0=off, 1=A, 2=B, 3=C
+#endif
+#ifndef TANGENT_CORNER
+#define TANGENT_CORNER				15.0					// tnc turns over this many degrees are made in place
+#endif
+#ifndef TANGENT_LIFT
+#define TANGENT_LIFT				5.0						// tnl Z lift for a turn made in place, mm (0 = no lift)
+#endif
+#ifndef THC_INPUT
+#define THC_INPUT					0						// thi analog input read as arc voltage, 0=torch height control off
+#endif
+#ifndef THC_VOLTAGE
+#define THC_VOLTAGE					120.0					// thv arc voltage to hold, volts at the input's scale
+#endif
+#ifndef THC_GAIN
+#define THC_GAIN					20.0					// thg Z correction in mm/min per volt of error
+#endif
+#ifndef THC_RATE
+#define THC_RATE					300.0					// thr fastest Z correction, mm/min
+#endif
+#ifndef THC_LIMIT
+#define THC_LIMIT					5.0						// thl largest Z correction up or down, mm
+#endif
+#ifndef THC_ANTIDIVE
+#define THC_ANTIDIVE				0.90					// tha hold the correction below this fraction of cruise velocity
+#endif
+#ifndef THC_DELAY
+#define THC_DELAY					0.5						// thd seconds of cutting before the correction starts
+#endif
+#ifndef RETRACE_VELOCITY
+#define RETRACE_VELOCITY			500.0					// rtv velocity backing up along the path and returning, mm/min
+#endif
+// analog inputs - Due A8-A11 are ADC channels 10-13 (the gShield takes A0-A7 for GRBL pins and inputs)
+#ifndef AI1_ENABLE
+#define AI1_ENABLE					0						// ai1en 0=off, 1=sampled
+#endif
+#ifndef AI1_CHANNEL
+#define AI1_CHANNEL					10						// ai1ch ADC channel
+#endif
+#ifndef AI1_SCALE
+#define AI1_SCALE					3.3						// ai1sc value at full scale - volts unless set for the sensor
+#endif
+#ifndef AI1_OFFSET
+#define AI1_OFFSET					0.0						// ai1of subtracted from the scaled value
+#endif
+#ifndef AI2_ENABLE
+#define AI2_ENABLE					0
+#endif
+#ifndef AI2_CHANNEL
+#define AI2_CHANNEL					11
+#endif
+#ifndef AI2_SCALE
+#define AI2_SCALE					3.3
+#endif
+#ifndef AI2_OFFSET
+#define AI2_OFFSET					0.0
+#endif
+#ifndef AI3_ENABLE
+#define AI3_ENABLE					0
+#endif
+#ifndef AI3_CHANNEL
+#define AI3_CHANNEL					12
+#endif
+#ifndef AI3_SCALE
+#define AI3_SCALE					3.3
+#endif
+#ifndef AI3_OFFSET
+#define AI3_OFFSET					0.0
+#endif
+#ifndef AI4_ENABLE
+#define AI4_ENABLE					0
+#endif
+#ifndef AI4_CHANNEL
+#define AI4_CHANNEL					13
+#endif
+#ifndef AI4_SCALE
+#define AI4_SCALE					3.3
+#endif
+#ifndef AI4_OFFSET
+#define AI4_OFFSET					0.0
+#endif
+// digital input filters - the debounce time is shared by the inputs on a PIO port
+#ifndef INPUT_DEBOUNCE_TIME
+#define INPUT_DEBOUNCE_TIME			5.0						// idb ms - pulses shorter than half of this are ignored
+#endif
+#ifndef DI1_FILTER
+#define DI1_FILTER					INPUT_FILTER_NONE		// di1fl 0=none (software lockout), 1=glitch, 2=debounce
+#endif
+#ifndef DI2_FILTER
+#define DI2_FILTER					INPUT_FILTER_NONE
+#endif
+#ifndef DI3_FILTER
+#define DI3_FILTER					INPUT_FILTER_NONE
+#endif
+#ifndef DI4_FILTER
+#define DI4_FILTER					INPUT_FILTER_NONE
+#endif
+#ifndef DI5_FILTER
+#define DI5_FILTER					INPUT_FILTER_NONE
+#endif
+#ifndef DI6_FILTER
+#define DI6_FILTER					INPUT_FILTER_NONE
+#endif
+#ifndef DI7_FILTER
+#define DI7_FILTER					INPUT_FILTER_NONE
+#endif
+#ifndef DI8_FILTER
+#define DI8_FILTER					INPUT_FILTER_NONE
+#endif
+#ifndef DI9_FILTER
+#define DI9_FILTER					INPUT_FILTER_NONE
+#endif
+// digital outputs (M62-M65) - the gShield pinout puts them on Due D34, DAC0, DAC1 and CANRX
+#ifndef DO1_MODE
+#define DO1_MODE					INPUT_ACTIVE_HIGH		// do1mo -1=disabled, 0=active low, 1=active high
+#endif
+#ifndef DO2_MODE
+#define DO2_MODE					INPUT_ACTIVE_HIGH
+#endif
+#ifndef DO3_MODE
+#define DO3_MODE					INPUT_ACTIVE_HIGH
+#endif
+#ifndef DO4_MODE
+#define DO4_MODE					INPUT_ACTIVE_HIGH
+#endif
+#ifndef M1_CORRECTION_KP
+#define M1_CORRECTION_KP			0.25					// 1cp following error corrected per segment
+#endif
+#ifndef M2_CORRECTION_KP
+#define M2_CORRECTION_KP			0.25					// 2cp following error corrected per segment
+#endif
+#ifndef M3_CORRECTION_KP
+#define M3_CORRECTION_KP			0.25					// 3cp following error corrected per segment
+#endif
+#ifndef M4_CORRECTION_KP
+#define M4_CORRECTION_KP			0.25					// 4cp following error corrected per segment
+#endif
+#ifndef M5_CORRECTION_KP
+#define M5_CORRECTION_KP			0.25					// 5cp following error corrected per segment
+#endif
+#ifndef M6_CORRECTION_KP
+#define M6_CORRECTION_KP			0.25					// 6cp following error corrected per segment
+#endif
+#ifndef M1_CORRECTION_KI
+#define M1_CORRECTION_KI			0.0						// 1ci integral gain, 0=proportional correction only
+#endif
+#ifndef M2_CORRECTION_KI
+#define M2_CORRECTION_KI			0.0						// 2ci integral gain, 0=proportional correction only
+#endif
+#ifndef M3_CORRECTION_KI
+#define M3_CORRECTION_KI			0.0						// 3ci integral gain, 0=proportional correction only
+#endif
+#ifndef M4_CORRECTION_KI
+#define M4_CORRECTION_KI			0.0						// 4ci integral gain, 0=proportional correction only
+#endif
+#ifndef M5_CORRECTION_KI
+#define M5_CORRECTION_KI			0.0						// 5ci integral gain, 0=proportional correction only
+#endif
+#ifndef M6_CORRECTION_KI
+#define M6_CORRECTION_KI			0.0						// 6ci integral gain, 0=proportional correction only
+#endif
+#ifndef M1_FOLLOWING_ERROR_MAX
+#define M1_FOLLOWING_ERROR_MAX		0						// 1fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef M2_FOLLOWING_ERROR_MAX
+#define M2_FOLLOWING_ERROR_MAX		0						// 2fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef M3_FOLLOWING_ERROR_MAX
+#define M3_FOLLOWING_ERROR_MAX		0						// 3fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef M4_FOLLOWING_ERROR_MAX
+#define M4_FOLLOWING_ERROR_MAX		0						// 4fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef M5_FOLLOWING_ERROR_MAX
+#define M5_FOLLOWING_ERROR_MAX		0						// 5fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef M6_FOLLOWING_ERROR_MAX
+#define M6_FOLLOWING_ERROR_MAX		0						// 6fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef SPINDLE_SYNC_MODE
+#define SPINDLE_SYNC_MODE			0						// spsy 1=S changes while on ride with the next move
+#endif
+#ifndef SPINDLE_RAMP_RATE
+#define SPINDLE_RAMP_RATE			5000					// spra RPM per second for synchronized S changes
+#endif
+#ifndef P1_VELOCITY_MODE
+#define P1_VELOCITY_MODE			0						// p1vmo 1=scale PWM duty with tool velocity (laser)
+#endif
+#ifndef P1_VELOCITY_EXPONENT
+#define P1_VELOCITY_EXPONENT		1.0						// p1vex duty follows (velocity/cruise)^exponent
+#endif
+#ifndef P1_VELOCITY_MIN
+#define P1_VELOCITY_MIN				0.0						// p1vmn fraction of the S power at zero velocity
+#endif
+#ifndef RASTER_SPACING
+#define RASTER_SPACING				0.1						// rsp mm between raster power values
+#endif
+#ifndef HOMING_CONCURRENT
+#define HOMING_CONCURRENT			0						// hmc 1=home independent axes after Z at the same time
+#endif
+#ifndef M1_HOMING_INPUT
+#define M1_HOMING_INPUT				0						// 1hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M1_MORPH_MICROSTEPS
+#define M1_MORPH_MICROSTEPS		0						// 1mm coarsest microsteps at high step rates, 0=off
+#endif
+#ifndef M2_HOMING_INPUT
+#define M2_HOMING_INPUT				0						// 2hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M2_MORPH_MICROSTEPS
+#define M2_MORPH_MICROSTEPS		0						// 2mm coarsest microsteps at high step rates, 0=off
+#endif
+#ifndef M3_HOMING_INPUT
+#define M3_HOMING_INPUT				0						// 3hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M3_MORPH_MICROSTEPS
+#define M3_MORPH_MICROSTEPS		0						// 3mm coarsest microsteps at high step rates, 0=off
+#endif
+#ifndef M4_HOMING_INPUT
+#define M4_HOMING_INPUT				0						// 4hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M4_MORPH_MICROSTEPS
+#define M4_MORPH_MICROSTEPS		0						// 4mm coarsest microsteps at high step rates, 0=off
+#endif
+#ifndef M5_HOMING_INPUT
+#define M5_HOMING_INPUT				0						// 5hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M5_MORPH_MICROSTEPS
+#define M5_MORPH_MICROSTEPS		0						// 5mm coarsest microsteps at high step rates, 0=off
+#endif
+#ifndef M6_HOMING_INPUT
+#define M6_HOMING_INPUT				0						// 6hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M6_MORPH_MICROSTEPS
+#define M6_MORPH_MICROSTEPS		0						// 6mm coarsest microsteps at high step rates, 0=off
+#endif
+
+// ethernet channel (__ETHERNET_CHANNEL) - addresses have the first octet in the high byte
+#ifndef ETHERNET_ADDRESS
+#define ETHERNET_ADDRESS			0xC0A80132				// 192.168.1.50 while $ethad is 0
+#endif
+#ifndef ETHERNET_GATEWAY
+#define ETHERNET_GATEWAY			0xC0A80101				// 192.168.1.1 while $ethgw is 0
+#endif
+#ifndef ETHERNET_NETMASK
+#define ETHERNET_NETMASK			0xFFFFFF00				// 255.255.255.0 while $ethmk is 0
+#endif
+#ifndef ETHERNET_PORT
+#define ETHERNET_PORT				23						// ethpt TCP port the channels listen on
+#endif
+
+/**** Motors 7 and 8 - boards with more than 6 sockets (MOTORS in tinyg2.h) ****/
+// Machine profiles don't set them, so they come up disabled until configured
+
+#if (MOTORS >= 7)
+#ifndef M7_MOTOR_MAP
+#define M7_MOTOR_MAP				AXIS_A					// 7ma axis driven - extra motors usually slave to another
+#endif
+#ifndef M7_STEP_ANGLE
+#define M7_STEP_ANGLE				1.8						// 7sa degrees per whole step
+#endif
+#ifndef M7_TRAVEL_PER_REV
+#define M7_TRAVEL_PER_REV			360						// 7tr travel per motor rev
+#endif
+#ifndef M7_MICROSTEPS
+#define M7_MICROSTEPS				8						// 7mi
+#endif
+#ifndef M7_POLARITY
+#define M7_POLARITY					0						// 7po 0=normal, 1=reversed
+#endif
+#ifndef M7_POWER_MODE
+#define M7_POWER_MODE				MOTOR_DISABLED			// 7pm off until the machine profile or $ sets it up
+#endif
+#ifndef M7_POWER_LEVEL
+#define M7_POWER_LEVEL				M6_POWER_LEVEL			// 7pl
+#endif
+#ifndef M7_BACKLASH
+#define M7_BACKLASH					0						// 7bl steps
+#endif
+#ifndef M7_CORRECTION_KP
+#define M7_CORRECTION_KP			0.25					// 7cp following error corrected per segment
+#endif
+#ifndef M7_CORRECTION_KI
+#define M7_CORRECTION_KI			0.0						// 7ci integral gain, 0=proportional correction only
+#endif
+#ifndef M7_FOLLOWING_ERROR_MAX
+#define M7_FOLLOWING_ERROR_MAX		0						// 7fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef M7_HOMING_INPUT
+#define M7_HOMING_INPUT				0						// 7hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M7_MORPH_MICROSTEPS
+#define M7_MORPH_MICROSTEPS		0						// 7mm coarsest microsteps at high step rates, 0=off
+#endif
+#endif
+#if (MOTORS >= 8)
+#ifndef M8_MOTOR_MAP
+#define M8_MOTOR_MAP				AXIS_A					// 8ma axis driven - extra motors usually slave to another
+#endif
+#ifndef M8_STEP_ANGLE
+#define M8_STEP_ANGLE				1.8						// 8sa degrees per whole step
+#endif
+#ifndef M8_TRAVEL_PER_REV
+#define M8_TRAVEL_PER_REV			360						// 8tr travel per motor rev
+#endif
+#ifndef M8_MICROSTEPS
+#define M8_MICROSTEPS				8						// 8mi
+#endif
+#ifndef M8_POLARITY
+#define M8_POLARITY					0						// 8po 0=normal, 1=reversed
+#endif
+#ifndef M8_POWER_MODE
+#define M8_POWER_MODE				MOTOR_DISABLED			// 8pm off until the machine profile or $ sets it up
+#endif
+#ifndef M8_POWER_LEVEL
+#define M8_POWER_LEVEL				M6_POWER_LEVEL			// 8pl
+#endif
+#ifndef M8_BACKLASH
+#define M8_BACKLASH					0						// 8bl steps
+#endif
+#ifndef M8_CORRECTION_KP
+#define M8_CORRECTION_KP			0.25					// 8cp following error corrected per segment
+#endif
+#ifndef M8_CORRECTION_KI
+#define M8_CORRECTION_KI			0.0						// 8ci integral gain, 0=proportional correction only
+#endif
+#ifndef M8_FOLLOWING_ERROR_MAX
+#define M8_FOLLOWING_ERROR_MAX		0						// 8fe steps of following error that raise an alarm, 0=off
+#endif
+#ifndef M8_HOMING_INPUT
+#define M8_HOMING_INPUT				0						// 8hi input that latches the motor when squaring, 0=none
+#endif
+#ifndef M8_MORPH_MICROSTEPS
+#define M8_MORPH_MICROSTEPS		0						// 8mm coarsest microsteps at high step rates, 0=off
+#endif
+#endif
+
 #endif // End of include guard: SETTINGS_H_ONCE
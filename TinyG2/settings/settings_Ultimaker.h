@@ -213,6 +213,7 @@
 #define A_LATCH_VELOCITY            2000
 #define A_LATCH_BACKOFF             5
 #define A_ZERO_BACKOFF              2
+#define A_PRESSURE_ADVANCE          0           // extruder lead in seconds - tune with a test print (0.02 - 0.1 typical)
 
 #define B_AXIS_MODE                 AXIS_RADIUS
 #define B_RADIUS                    0.609
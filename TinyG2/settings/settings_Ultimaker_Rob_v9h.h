@@ -231,6 +231,7 @@
 #define A_LATCH_VELOCITY 		2000
 #define A_LATCH_BACKOFF 		5
 #define A_ZERO_BACKOFF 			2
+#define A_PRESSURE_ADVANCE		0				// extruder lead in seconds - tune with a test print (0.02 - 0.1 typical)
 #define A_JERK_HIGH_SPEED			A_JERK_MAX
 
 #define B_AXIS_MODE				AXIS_DISABLED
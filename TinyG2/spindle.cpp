@@ -34,6 +34,7 @@
 #include "planner.h"
 #include "hardware.h"
 #include "pwm.h"
+#include "gpio.h"
 #include "util.h"
 
 /**** Allocate structures ****/
@@ -64,6 +65,7 @@ void spindle_reset()
     float value[AXES] = { 0,0,0,0,0,0 };        // set spindle speed to zero
     bool flags[] = { 1,0,0,0,0,0 };
    _exec_spindle_speed(value, flags);
+    spindle.sync_pending = false;
     cm_spindle_off_immediate();                 // turn spindle off
 }
 
@@ -76,20 +78,221 @@ stat_t cm_set_spindle_speed(float speed)
 {
 //	if (speed > cfg.max_spindle speed) { return (STAT_MAX_SPINDLE_SPEED_EXCEEDED);}
 
+    spindle.programmed_speed = speed;
+    if (spindle.sync_mode && (spindle.enable == SPINDLE_ON)) {
+        spindle.sync_speed = speed;             // rides with the next move - see spindle_take_sync_speed()
+        spindle.sync_pending = true;
+        return (STAT_OK);
+    }
     float value[AXES] = { speed, 0,0,0,0,0 };
     bool flags[] = { 1,0,0,0,0,0 };
-    mp_queue_command(_exec_spindle_speed, value, flags);
+    mp_queue_pass_through_command(_exec_spindle_speed, value, flags);
     return (STAT_OK);
 }
 
 static void _exec_spindle_speed(float *value, bool *flag)
 {
+    if (mp_dry_plan_is_active()) {
+        return;                                             // dry plans don't run outputs
+    }
     spindle.speed = value[0];
+    spindle.target_speed = spindle.speed;
     spindle.direction = (cmSpindleDir)value[1];
     // update spindle speed if we're running
 	pwm_set_duty(PWM_1, _get_spindle_pwm(spindle.enable, spindle.direction));
 }
 
+/*
+ * Synchronized spindle speed ($spsy=1)
+ *
+ * spindle_take_sync_speed() - hand a pending S to the move being planned
+ * spindle_sync_flush()      - queue a pending S as a command if no move took it
+ * spindle_set_sync_target() - exec: set the speed to ramp to
+ * spindle_exec_ramp()       - exec: ramp the PWM one segment towards the target
+ * spindle_is_ramping()      - exec: true until the ramp reaches its target
+ *
+ *	With the spindle on, an S change normally goes into the planner as a command, which
+ *	stops motion to run it. In synchronized mode the S is carried by the next move instead
+ *	and the exec ramps the PWM to it at $spra RPM/sec. The ramp starts during the tail of
+ *	the move before, so a speed change in a continuous toolpath costs no stop or dwell.
+ *	A dwell carries on the ramp in segments until it's done - see _exec_dwell().
+ */
+
+bool spindle_take_sync_speed(float *speed)
+{
+    if (!spindle.sync_pending) {
+        return (false);
+    }
+    spindle.sync_pending = false;
+    *speed = spindle.sync_speed;
+    return (true);
+}
+
+void spindle_sync_flush()
+{
+    if (spindle.sync_pending) {
+        spindle.sync_pending = false;
+        float value[AXES] = { spindle.sync_speed, (float)spindle.direction, 0,0,0,0 };
+        bool flags[] = { 1,0,0,0,0,0 };
+        mp_queue_pass_through_command(_exec_spindle_speed, value, flags);
+    }
+}
+
+void spindle_set_sync_target(float speed)
+{
+    spindle.target_speed = speed;
+}
+
+void spindle_exec_ramp(float segment_time)
+{
+    if (fp_EQ(spindle.speed, spindle.target_speed)) {
+        return;
+    }
+    float step = spindle.ramp_rate * segment_time * 60;     // segment_time is in minutes
+    float speed;
+    if (spindle.speed < spindle.target_speed) {
+        speed = min(spindle.speed + step, spindle.target_speed);
+    } else {
+        speed = max(spindle.speed - step, spindle.target_speed);
+    }
+    spindle.speed = speed;
+    float duty = _get_spindle_pwm(spindle.enable, spindle.direction);
+    if (!pwm.c[PWM_1].velocity_mode) {                      // velocity mode sets the duty per segment
+        pwm_set_duty(PWM_1, duty);
+    }
+    if (fp_NE(spindle.speed, speed)) {                      // clamped to the PWM speed range
+        spindle.target_speed = spindle.speed;
+    }
+}
+
+bool spindle_is_ramping()
+{
+    return (fp_NE(spindle.speed, spindle.target_speed));
+}
+
+/*
+ * spindle_get_velocity_pwm() - exec: PWM duty scaled by tool velocity ($p1vmo=1)
+ *
+ *	For lasers the power has to follow the tool velocity or corners and other slow spots
+ *	burn. The S power is scaled by min + (1-min) * ratio^exponent, where ratio is the
+ *	segment velocity over the cruise velocity of the move, min is $p1vmn and the exponent
+ *	is $p1vex. The duty goes to the loader with the segment so it changes in step with it.
+ *	Returns a negative duty if velocity mode is off or the spindle isn't on.
+ */
+
+float spindle_get_velocity_pwm(float velocity_ratio)
+{
+    pwmConfigChannel_t *c = &pwm.c[PWM_1];
+    if (!c->velocity_mode || (spindle.enable != SPINDLE_ON)) {
+        return (-1);
+    }
+    velocity_ratio = min(max(velocity_ratio, 0.0f), 1.0f);
+    float power = c->velocity_min + (1 - c->velocity_min) * pow(velocity_ratio, c->velocity_exponent);
+    float speed_lo, speed_hi, phase_lo, phase_hi;
+    if (spindle.direction == SPINDLE_CW) {
+        speed_lo = c->cw_speed_lo;  speed_hi = c->cw_speed_hi;
+        phase_lo = c->cw_phase_lo;  phase_hi = c->cw_phase_hi;
+    } else {
+        speed_lo = c->ccw_speed_lo; speed_hi = c->ccw_speed_hi;
+        phase_lo = c->ccw_phase_lo; phase_hi = c->ccw_phase_hi;
+    }
+    if (speed_hi <= speed_lo) {
+        return (phase_lo);
+    }
+    float speed = min(max(spindle.speed * power, speed_lo), speed_hi);
+    return (((speed - speed_lo) / (speed_hi - speed_lo)) * (phase_hi - phase_lo) + phase_lo);
+}
+
+#ifdef __THREADING
+/*
+ * Spindle index ($diNfn=4) - spindle position for synchronized motion (G33, G33.1)
+ *
+ * spindle_index_pulse()         - ISR: count the revolution and time it
+ * spindle_index_is_configured() - true if an enabled input is set to spindle index
+ * spindle_get_index_count()     - index pulses seen so far
+ * spindle_get_index_rpm()       - measured spindle speed, 0 if the index has stopped
+ * spindle_get_revolutions()     - revolutions since a given index pulse, interpolated
+ * spindle_get_spr()             - get the measured speed for the cfgArray ({spr:n})
+ *
+ *	The index is a once per revolution pulse on a digital input. Each pulse is timestamped
+ *	with the CPU cycle counter in the pin ISR, so the spindle angle between pulses is the
+ *	time since the last one over the last period. If the spindle slows the time since the
+ *	last pulse overtakes the period, and is used as the period so the speed falls off
+ *	smoothly and the angle stops just short of the next revolution.
+ *
+ *	The ISR can fire in the middle of a read, so readers take the count, time and period
+ *	again until the count holds still.
+ */
+
+void spindle_index_pulse(uint32_t cycles)
+{
+    uint32_t period = cycles - spindle.index_cycles;
+    if ((spindle.index_period != 0) && (period < spindle.index_period * SPINDLE_INDEX_REJECT)) {
+        return;
+    }
+    spindle.index_period = (spindle.index_count == 0) ? 0 : period;
+    spindle.index_cycles = cycles;
+    spindle.index_count++;
+}
+
+bool spindle_index_is_configured()
+{
+    for (uint8_t i=0; i<DI_CHANNELS; i++) {
+        if ((io.in[i].function == INPUT_FUNCTION_SPINDLE_INDEX) && (io.in[i].mode != INPUT_MODE_DISABLED)) {
+            return (true);
+        }
+    }
+    return (false);
+}
+
+uint32_t spindle_get_index_count()
+{
+    return (spindle.index_count);
+}
+
+static uint32_t _get_index(uint32_t *elapsed, uint32_t *period)
+{
+    uint32_t count;
+    do {
+        count = spindle.index_count;
+        *elapsed = hw_get_cycles() - spindle.index_cycles;
+        *period = spindle.index_period;
+    } while (count != spindle.index_count);
+    if (*elapsed > *period) {
+        *period = *elapsed;                     // slowing down - at least this slow
+    }
+    return (count);
+}
+
+float spindle_get_index_rpm()
+{
+    uint32_t elapsed, period;
+    _get_index(&elapsed, &period);
+    if ((spindle.index_period == 0) || (elapsed > (SPINDLE_INDEX_TIMEOUT_MS * 1000 * HW_CYCLES_PER_US))) {
+        return (0);
+    }
+    return ((60.0 * 1000000 * HW_CYCLES_PER_US) / period);
+}
+
+float spindle_get_revolutions(uint32_t index)
+{
+    uint32_t elapsed, period;
+    uint32_t count = _get_index(&elapsed, &period);
+    float revolutions = (int32_t)(count - index);
+    if (period != 0) {
+        revolutions += (float)elapsed / period;
+    }
+    return (revolutions);
+}
+
+stat_t spindle_get_spr(nvObj_t *nv)
+{
+    nv->value = spindle_get_index_rpm();
+    nv->valuetype = TYPE_FLOAT;
+    return (STAT_OK);
+}
+#endif // __THREADING
+
 /*
  * cm_spindle_off_immediate() - turn on/off spindle w/o planning
  * cm_spindle_optional_pause() - pause spindle immediately if option is true
@@ -130,6 +333,7 @@ void cm_spindle_resume(float dwell_seconds)
 
 stat_t cm_spindle_control(uint8_t control)  // requires SPINDLE_CONTROL_xxx style args
 {
+    spindle_sync_flush();                   // an S still waiting for a move goes first
     if (control == SPINDLE_CONTROL_OFF) {
         spindle.enable = SPINDLE_OFF;
     } else {
@@ -142,7 +346,7 @@ stat_t cm_spindle_control(uint8_t control)  // requires SPINDLE_CONTROL_xxx styl
     }
 	float value[] = { (float)spindle.enable, (float)spindle.direction, 0,0,0,0 };
     bool flags[] =  { 1,0,0,0,0,0 };
-	mp_queue_command(_exec_spindle_control, value, flags);
+	mp_queue_stop_command(_exec_spindle_control, value, flags);
 	return(STAT_OK);
 }
 
@@ -161,6 +365,9 @@ stat_t cm_spindle_control(uint8_t control)  // requires SPINDLE_CONTROL_xxx styl
 
 static void _exec_spindle_control(float *value, bool *flag)
 {
+    if (mp_dry_plan_is_active()) {
+        return;                                             // dry plans don't run outputs
+    }
     // set the direction first
     spindle.direction = (cmSpindleDir)value[1];             // record spindle direction in the struct
     if (spindle.direction ^ spindle.dir_polarity) {
@@ -171,6 +378,7 @@ static void _exec_spindle_control(float *value, bool *flag)
 
     // set on/off. Mask out PAUSE and consider it OFF
     spindle.enable = (cmSpindleEnable)value[0];             // record spindle enable in the struct
+    spindle.run_enable = spindle.enable;
     if ((spindle.enable & 0x01) ^ spindle.enable_polarity) {
         _set_spindle_enable_bit_lo();
     } else {
@@ -277,6 +485,9 @@ const char fmt_spdw[] PROGMEM = "[spdw] spindle dwell time%12.1f seconds\n";
 const char fmt_spe[] PROGMEM = "Spindle Enable:%7d [0=OFF,1=ON,2=PAUSE]\n";
 const char fmt_spd[] PROGMEM = "Spindle Direction:%4d [0=CW,1=CCW]\n";
 const char fmt_sps[] PROGMEM = "Spindle Speed: %7.0f rpm\n";
+const char fmt_spsy[] PROGMEM = "[spsy] spindle sync mode%11d [0=queued,1=synchronized with motion]\n";
+const char fmt_spra[] PROGMEM = "[spra] spindle ramp rate%13.0f rpm/sec\n";
+const char fmt_spr[] PROGMEM = "Spindle Index Speed: %7.0f rpm\n";
 
 void cm_print_spep(nvObj_t *nv) { text_print(nv, fmt_spep);}    // TYPE_INT
 void cm_print_spdp(nvObj_t *nv) { text_print(nv, fmt_spdp);}    // TYPE_INT
@@ -285,5 +496,8 @@ void cm_print_spdw(nvObj_t *nv) { text_print(nv, fmt_spdw);}    // TYPE_FLOAT
 void cm_print_spe(nvObj_t *nv)  { text_print(nv, fmt_spe);}     // TYPE_INT
 void cm_print_spd(nvObj_t *nv)  { text_print(nv, fmt_spd);}     // TYPE_INT
 void cm_print_sps(nvObj_t *nv)  { text_print(nv, fmt_sps);}     // TYPE_FLOAT
+void cm_print_spsy(nvObj_t *nv) { text_print(nv, fmt_spsy);}    // TYPE_INT
+void cm_print_spra(nvObj_t *nv) { text_print(nv, fmt_spra);}    // TYPE_FLOAT
+void cm_print_spr(nvObj_t *nv)  { text_print(nv, fmt_spr);}     // TYPE_FLOAT
 
 #endif // __TEXT_MODE
\ No newline at end of file
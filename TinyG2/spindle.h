@@ -28,6 +28,10 @@
 #ifndef SPINDLE_H_ONCE
 #define SPINDLE_H_ONCE
 
+// spindle index timing for synchronized motion - see spindle_index_pulse()
+#define SPINDLE_INDEX_TIMEOUT_MS    2000    // no index for this long is a stopped spindle (under 30 RPM)
+#define SPINDLE_INDEX_REJECT        0.25    // pulses closer than this fraction of a revolution are noise
+
 typedef enum {				        // how spindle controls are presented by the Gcode parser
     SPINDLE_CONTROL_OFF = 0,        // M5
     SPINDLE_CONTROL_CW,             // M3
@@ -66,6 +70,7 @@ typedef struct cmSpindleSingleton {
 
     float speed;                        // S in RPM
     cmSpindleEnable enable;             // OFF, ON, PAUSE
+    cmSpindleEnable run_enable;         // enable as last run by the exec - enable is set at parse time
     cmSpindleDir direction;             // CW, CCW
 
     bool pause_on_hold;                 // pause on feedhold
@@ -73,6 +78,19 @@ typedef struct cmSpindleSingleton {
     cmSpindlePolarity dir_polarity;     // 0=clockwise low, 1=clockwise high
     float dwell_seconds;                // dwell on spindle resume
 
+    uint8_t sync_mode;                  // 1 = S changes while the spindle is on are planned with motion
+    float ramp_rate;                    // RPM per second for synchronized speed changes
+    float target_speed;                 // speed the exec is ramping to
+    float sync_speed;                   // S waiting for the next move
+    bool sync_pending;                  // true if sync_speed is waiting for the next move
+    float programmed_speed;             // last S given - speed is what the runtime has got to
+
+#ifdef __THREADING
+    volatile uint32_t index_count;      // spindle index pulses seen
+    volatile uint32_t index_cycles;     // hw_get_cycles() at the last index pulse
+    volatile uint32_t index_period;     // cycles between the last two index pulses, 0 if not known
+#endif
+
 //    float override_factor;            // 1.0000 x S spindle speed. Go up or down from there
 //    uint8_t override_enable;          // TRUE = override enabled
 
@@ -94,6 +112,21 @@ stat_t cm_spindle_control(uint8_t control);             // M3, M4, M5 integrated
 void cm_spindle_off_immediate(void);
 void cm_spindle_optional_pause(bool option);            // stop spindle based on system options selected
 void cm_spindle_resume(float dwell_seconds);            // restart spindle after pause based on previous state
+bool spindle_take_sync_speed(float *speed);             // S for the move being planned (synchronized mode)
+void spindle_sync_flush(void);                          // queue an S that no move picked up
+void spindle_set_sync_target(float speed);              // exec: start ramping to a move's S
+void spindle_exec_ramp(float segment_time);             // exec: advance the ramp by one segment
+bool spindle_is_ramping(void);                          // exec: true until the ramp reaches its target
+float spindle_get_velocity_pwm(float velocity_ratio);   // exec: duty for velocity mode, < 0 if not in use
+
+#ifdef __THREADING
+void spindle_index_pulse(uint32_t cycles);              // ISR: the spindle index input fired
+bool spindle_index_is_configured(void);                 // an input is set to spindle index
+uint32_t spindle_get_index_count(void);
+float spindle_get_index_rpm(void);                      // measured speed, 0 if the index has stopped
+float spindle_get_revolutions(uint32_t index);          // revolutions since index pulse 'index'
+stat_t spindle_get_spr(nvObj_t *nv);
+#endif
 
 //stat_t cm_spindle_override_enable(uint8_t flag);    // M51
 //stat_t cm_spindle_override_factor(uint8_t flag);    // M51.1
@@ -111,6 +144,9 @@ stat_t cm_set_dir(nvObj_t *nv);
     void cm_print_spe(nvObj_t *nv);
     void cm_print_spd(nvObj_t *nv);
     void cm_print_sps(nvObj_t *nv);
+    void cm_print_spsy(nvObj_t *nv);
+    void cm_print_spra(nvObj_t *nv);
+    void cm_print_spr(nvObj_t *nv);
 
 #else
 
@@ -121,6 +157,9 @@ stat_t cm_set_dir(nvObj_t *nv);
     #define cm_print_spe tx_print_stub
     #define cm_print_spd tx_print_stub
     #define cm_print_sps tx_print_stub
+    #define cm_print_spsy tx_print_stub
+    #define cm_print_spra tx_print_stub
+    #define cm_print_spr tx_print_stub
 
 #endif // __TEXT_MODE
 
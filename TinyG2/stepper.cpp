@@ -32,21 +32,45 @@
 #include "tinyg2.h"
 #include "config.h"
 #include "stepper.h"
+#include "controller.h"
 #include "encoder.h"
+#include "kinematics.h"
 #include "planner.h"
 #include "hardware.h"
+#include "pwm.h"
 #include "text_parser.h"
+#include "report.h"
 #include "util.h"
+#include "profile_pins.h"
+#ifdef __HOST__
+#include "host.h"
+#endif
 
 /**** Allocate structures ****/
 
 stConfig_t st_cfg;
 stPrepSingleton_t st_pre;
 static stRunSingleton_t st_run;
+#ifdef __AUX_MOTION
+stAux_t st_aux;
+#endif
 
 /**** Static functions ****/
 
-static void _load_move(void);
+static void _load_move(void) RAMFUNC;
+static void _exec_segments(void) RAMFUNC;
+#ifdef __ARM
+static void _sync_start(void);
+static void _set_dda_timing(void);
+#endif
+static void _raster_load(uint8_t line);
+static void _raster_end(void);
+#ifdef __MOTION_OUTPUTS
+static void _output_events(void);
+#endif
+#ifdef __MICROSTEP_MORPH
+static void _set_motor_morph(const uint8_t motor);
+#endif
 #ifdef __ARM
 static void _set_motor_power_level(const uint8_t motor, const float power_level);
 #endif
@@ -54,16 +78,166 @@ static void _set_motor_power_level(const uint8_t motor, const float power_level)
 // handy macro
 #define _f_to_period(f) (uint16_t)((float)F_CPU / (float)f)
 
+/**** ISR profile ****
+ *
+ *	With __ISR_PROFILE defined the DDA, dwell, exec and load interrupts and _load_move() are timed
+ *	with the cycle counter (see hw_get_cycles()). Each keeps a count, min/max/total run time and a
+ *	count of runs over its budget (ISR_BUDGET_xxx_US in stepper.h). Each also keeps its worst
+ *	latency: request to entry for the software interrupts (exec and load), and for the DDA and
+ *	dwell timers how far the timer has counted past its overflow by the time the handler
+ *	reads it. This is the preemption latency - how long a higher or equal level
+ *	(see the interrupt table in hardware.h) held the interrupt off. Read with $isr, cleared
+ *	by $clc. It's off by default as it costs a few percent of the DDA interrupt.
+ */
+#ifdef __ISR_PROFILE
+isrProfile_t isr_prof[ISR_PROFILE_COUNT];
+static uint32_t isr_request[ISR_PROFILE_COUNT];		// cycle count of the last request (exec and load)
+static uint32_t dda_cycles_per_tick;				// CPU cycles per timer count - set in stepper_init()
+static uint32_t dwell_cycles_per_tick;
+
+static const uint32_t isr_budget[ISR_PROFILE_COUNT] = {
+	ISR_BUDGET_DDA_US * HW_CYCLES_PER_US,
+	ISR_BUDGET_DWELL_US * HW_CYCLES_PER_US,
+	ISR_BUDGET_EXEC_US * HW_CYCLES_PER_US,
+	ISR_BUDGET_LOAD_US * HW_CYCLES_PER_US
+};
+
+static void _isr_profile(const uint8_t isr, const uint32_t start)
+{
+	uint32_t cycles = hw_get_cycles() - start;
+	isrProfile_t *p = &isr_prof[isr];
+	if ((p->count++ == 0) || (cycles < p->min)) { p->min = cycles;}
+	if (cycles > p->max) { p->max = cycles;}
+	p->total += cycles;
+	if (cycles > isr_budget[isr]) { p->overruns++;}
+}
+
+static inline void _isr_latency(const uint8_t isr, const uint32_t entry)
+{
+	uint32_t cycles = entry - isr_request[isr];
+	if (cycles > isr_prof[isr].latency) { isr_prof[isr].latency = cycles;}
+}
+
+static inline void _isr_timer_latency(const uint8_t isr, const uint32_t cycles)
+{
+	if (cycles > isr_prof[isr].latency) { isr_prof[isr].latency = cycles;}
+}
+
+#define ISR_PROFILE_START()		uint32_t isr_start = hw_get_cycles()
+#define ISR_PROFILE_END(isr)	_isr_profile(isr, isr_start)
+#define ISR_PROFILE_REQUEST(isr) isr_request[isr] = hw_get_cycles()
+#define ISR_PROFILE_LATENCY(isr) _isr_latency(isr, isr_start)
+#define ISR_PROFILE_TIMER_LATENCY(isr, cycles) _isr_timer_latency(isr, cycles)
+#else
+#define ISR_PROFILE_START()
+#define ISR_PROFILE_END(isr)
+#define ISR_PROFILE_REQUEST(isr)
+#define ISR_PROFILE_LATENCY(isr)
+#define ISR_PROFILE_TIMER_LATENCY(isr, cycles)
+#endif // __ISR_PROFILE
+
+/**** Prep buffer ring helpers ****/
+// buffer_in and buffer_out are free running counts. Their difference is the number of buffers in the ring
+
+static inline bool _prep_buffer_is_empty() { return (st_pre.buffer_in == st_pre.buffer_out); }
+static inline bool _prep_buffer_is_full() { return ((uint8_t)(st_pre.buffer_in - st_pre.buffer_out) >= PREP_BUFFER_SIZE); }
+static inline stPrepBuffer_t *_get_prep_buffer() { return (&st_pre.buf[st_pre.buffer_in & (PREP_BUFFER_SIZE-1)]); }
+static inline stPrepBuffer_t *_get_load_buffer() { return (&st_pre.buf[st_pre.buffer_out & (PREP_BUFFER_SIZE-1)]); }
+
+// Exec can't run ahead of a command, as the command's planner buffer is only freed when the
+// loader runs it. The loader nulls the move type once a buffer has been run. Pass-through
+// commands carry their own copy of the callback (bf is NULL) so exec can keep going.
+static inline bool _prep_buffer_is_available()
+{
+	if (_prep_buffer_is_full()) { return (false);}
+	stPrepBuffer_t *p = &st_pre.buf[(uint8_t)(st_pre.buffer_in - 1) & (PREP_BUFFER_SIZE-1)];
+	return ((p->move_type != MOVE_TYPE_COMMAND) || (p->bf == NULL));
+}
+
+// The barriers keep the compiler from moving buffer contents across the hand-off
+static inline void _commit_prep_buffer()
+{
+	__asm__ __volatile__ ("" ::: "memory");
+	st_pre.buffer_in++;
+}
+
+static inline void _free_load_buffer()
+{
+	__asm__ __volatile__ ("" ::: "memory");
+	st_pre.buffer_out++;
+}
+
+/**** Raster clock ****
+ *
+ *	A raster line's power values are clocked by the steps of one motor (see pwm.h). The DDA
+ *	checks the clock motor after each step pulse, so the check is a single compare when no
+ *	raster is running. The countdown is fixed point to keep floats out of the per-step path.
+ */
+
+#define RASTER_ONE_STEP 65536
+#define RASTER_STEP(m) if (st_run.raster_motor == m) { _raster_step(); }
+
+static void _raster_load(uint8_t line)
+{
+	if (st_run.raster_line != NULL) {
+		_raster_end();									// a line still running is over
+	}
+	if (line == RASTER_STOP) {
+		return;
+	}
+	rasterLine_t *r = &raster.line[line-1];
+	st_run.raster_line = r;
+	st_run.raster_pixel = 0;
+	st_run.raster_countdown = r->steps_per_pixel;
+	st_run.raster_motor = r->motor;
+	pwm_set_duty(PWM_1, raster_get_duty(r, r->power[0]));
+}
+
+static void _raster_end()
+{
+	pwm_set_duty(PWM_1, pwm.c[PWM_1].phase_off);
+	st_run.raster_motor = MOTORS;
+	st_run.raster_line->in_use = false;					// hand it back for loading
+	st_run.raster_line = NULL;
+}
+
+static inline void _raster_step()
+{
+	if ((st_run.raster_countdown -= RASTER_ONE_STEP) > 0) {
+		return;
+	}
+	rasterLine_t *r = st_run.raster_line;
+	st_run.raster_countdown += r->steps_per_pixel;
+	if (++st_run.raster_pixel >= r->count) {
+		_raster_end();
+		return;
+	}
+	pwm_set_duty(PWM_1, raster_get_duty(r, r->power[st_run.raster_pixel]));
+}
+
+#ifdef __MOTION_OUTPUTS
+/**** Output events ****
+ *
+ *	Outputs switched along the path (M62, M63) come with the segment they fall in, as the
+ *	tick down-count to switch them at - see st_prep_output(). The DDA compares the down-count
+ *	after each tick, so it's a single compare when the segment has none left.
+ */
+
+static void _output_events()
+{
+	while ((st_run.output_next < st_run.output_events) &&
+		   (st_run.output[st_run.output_next].downcount >= st_run.dda_ticks_downcount)) {
+		gpio_set_output(st_run.output[st_run.output_next].output, st_run.output[st_run.output_next].state);
+		st_run.output_next++;
+	}
+	st_run.output_downcount = (st_run.output_next < st_run.output_events) ? st_run.output[st_run.output_next].downcount : 0;
+}
+#endif
+
 /**** Setup motate ****/
 
 #ifdef __ARM
 using namespace Motate;
-//OutputPin<kDebug1_PinNumber> dda_debug_pin1;			// usage: dda_debug_pin1 = 1, dda_debug_pin1 = 0
-//OutputPin<-1> dda_debug_pin1;			// usage: dda_debug_pin1 = 1, dda_debug_pin1 = 0
-//OutputPin<kDebug2_PinNumber> dda_debug_pin2;
-//OutputPin<-1> dda_debug_pin2;
-//OutputPin<kDebug3_PinNumber> dda_debug_pin3;
-//OutputPin<-1> dda_debug_pin3;
 
 OutputPin<kGRBL_CommonEnablePinNumber> common_enable;
 
@@ -74,6 +248,9 @@ Timer<dda_timer_num> dda_timer(kTimerUpToMatch, FREQUENCY_DDA);			// stepper pul
 Timer<dwell_timer_num> dwell_timer(kTimerUpToMatch, FREQUENCY_DWELL);	// dwell timer
 Timer<load_timer_num> load_timer;		// triggers load of next stepper segment
 Timer<exec_timer_num> exec_timer;		// triggers calculation of next+1 stepper segment
+#ifdef __AUX_MOTION
+Timer<aux_timer_num> aux_timer(kTimerUpToMatch, AUX_FREQUENCY);		// aux motion channel
+#endif
 
 // Motor structures
 template<const uint8_t motor,
@@ -126,6 +303,13 @@ struct Stepper {
             if (st_cfg.mot[motor].power_mode != MOTOR_DISABLED) {
                 //_enable.clear();
                 _enable.set();
+                if (st_run.mot[motor].power_state != MOTOR_RUNNING) {
+                    controller_wake(DEADLINE_MOTOR_POWER);  // a running motor goes straight back to RUNNING
+                }
+                if (st_run.mot[motor].power_level_dynamic < st_cfg.mot[motor].power_level_scaled) {
+                    st_run.mot[motor].power_level_dynamic = st_cfg.mot[motor].power_level_scaled;
+                    setVref(st_run.mot[motor].power_level_dynamic);     // idling at reduced power
+                }
                 st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;
 
                 // if we have a common enable, this is the time to use it...
@@ -161,59 +345,295 @@ struct Stepper {
 
 };
 
-Stepper<MOTOR_1,
-        kSocket1_StepPinNumber,
-		kSocket1_DirPinNumber,
-		kSocket1_EnablePinNumber,
-		kSocket1_Microstep_0PinNumber,
-		kSocket1_Microstep_1PinNumber,
-		kSocket1_Microstep_2PinNumber,
-		kSocket1_VrefPinNumber> motor_1;
-
-Stepper<MOTOR_2,
-        kSocket2_StepPinNumber,
-		kSocket2_DirPinNumber,
-		kSocket2_EnablePinNumber,
-		kSocket2_Microstep_0PinNumber,
-		kSocket2_Microstep_1PinNumber,
-		kSocket2_Microstep_2PinNumber,
-		kSocket2_VrefPinNumber> motor_2;
-
-Stepper<MOTOR_3,
-        kSocket3_StepPinNumber,
-		kSocket3_DirPinNumber,
-		kSocket3_EnablePinNumber,
-		kSocket3_Microstep_0PinNumber,
-		kSocket3_Microstep_1PinNumber,
-		kSocket3_Microstep_2PinNumber,
-		kSocket3_VrefPinNumber> motor_3;
-
-Stepper<MOTOR_4,
-        kSocket4_StepPinNumber,
-		kSocket4_DirPinNumber,
-		kSocket4_EnablePinNumber,
-		kSocket4_Microstep_0PinNumber,
-		kSocket4_Microstep_1PinNumber,
-		kSocket4_Microstep_2PinNumber,
-		kSocket4_VrefPinNumber> motor_4;
-
-Stepper<MOTOR_5,
-        kSocket5_StepPinNumber,
-		kSocket5_DirPinNumber,
-		kSocket5_EnablePinNumber,
-		kSocket5_Microstep_0PinNumber,
-		kSocket5_Microstep_1PinNumber,
-		kSocket5_Microstep_2PinNumber,
-		kSocket5_VrefPinNumber> motor_5;
-
-Stepper<MOTOR_6,
-        kSocket6_StepPinNumber,
-		kSocket6_DirPinNumber,
-		kSocket6_EnablePinNumber,
-		kSocket6_Microstep_0PinNumber,
-		kSocket6_Microstep_1PinNumber,
-		kSocket6_Microstep_2PinNumber,
-		kSocket6_VrefPinNumber> motor_6;
+/*
+ * Motor list
+ *
+ *	The steppers are built from the board's socket pins (kSocketN_xxx in motate_pin_assignments.h),
+ *	one per motor up to MOTORS, and chained into a compile-time list. Each link does its own motor
+ *	and hands on to the next, so the compiler unrolls the DDA ISR and the loader for however many
+ *	motors the board has - the cost is linear in the motors, with no loop or table lookup on the
+ *	step path. Sockets past MOTORS, and pins a board doesn't have, are -1. A motor with a null
+ *	step pin drops out of the step code, as before. Motors above MOTORS_ACTIVE stay in the list
+ *	(they keep their enables and Vrefs) but are left out of stepping and loading.
+ */
+template<const uint8_t motor> struct SocketPins;
+
+#define _socket_pin(n, name) ((n <= MOTORS) ? kSocket ## n ## _ ## name ## PinNumber : -1)
+#define _SOCKET_PINS(n) \
+	template<> struct SocketPins<n-1> { \
+		static const int8_t step = _socket_pin(n, Step); \
+		static const int8_t dir = _socket_pin(n, Dir); \
+		static const int8_t enable = _socket_pin(n, Enable); \
+		static const int8_t ms0 = _socket_pin(n, Microstep_0); \
+		static const int8_t ms1 = _socket_pin(n, Microstep_1); \
+		static const int8_t ms2 = _socket_pin(n, Microstep_2); \
+		static const int8_t vref = _socket_pin(n, Vref); \
+	};
+
+_SOCKET_PINS(1)
+_SOCKET_PINS(2)
+_SOCKET_PINS(3)
+_SOCKET_PINS(4)
+_SOCKET_PINS(5)
+_SOCKET_PINS(6)
+_SOCKET_PINS(7)
+_SOCKET_PINS(8)
+
+#define _motor_inline inline __attribute__ ((always_inline))
+
+template<const uint8_t motor, const bool in_list = (motor < MOTORS)>
+struct MotorList {
+	typedef SocketPins<motor> pins;
+
+	Stepper<motor, pins::step, pins::dir, pins::enable, pins::ms0, pins::ms1, pins::ms2, pins::vref> stepper;
+	MotorList<motor+1> next;
+
+	static const bool active = (motor < MOTORS_ACTIVE);
+	static const uint32_t step_mask = Pin<pins::step>::mask | MotorList<motor+1>::step_mask;
+
+	// true if this and the following step pins are all on port letter (or null)
+	static constexpr bool onStepPort(const uint8_t letter) {
+		return (((Pin<pins::step>::portLetter == 0) || (Pin<pins::step>::portLetter == letter)) &&
+				MotorList<motor+1>::onStepPort(letter));
+	}
+
+	/* per-motor functions by motor number - the compare chain is what the hand-written ifs were */
+
+	void enable(const uint8_t m) { if (m == motor) { stepper.enable(); } else { next.enable(m); } }
+	void disable(const uint8_t m) { if (m == motor) { stepper.disable(); } else { next.disable(m); } }
+	void setVref(const uint8_t m, const float v) { if (m == motor) { stepper.setVref(v); } else { next.setVref(m, v); } }
+	void setMicrosteps(const uint8_t m, const uint8_t ms) {
+		if (m == motor) { stepper.setMicrosteps(ms); } else { next.setMicrosteps(m, ms); }
+	}
+	bool hasMicrostepPins(const uint8_t m) {
+		if (m == motor) { return (!stepper.ms0.isNull()); } else { return (next.hasMicrostepPins(m)); }
+	}
+#ifdef __AUX_MOTION
+	void stepOn(const uint8_t m) { if (m == motor) { stepper.step.set(); } else { next.stepOn(m); } }
+	void stepOff(const uint8_t m) { if (m == motor) { stepper.step.clear(); } else { next.stepOff(m); } }
+	uint32_t stepMask(const uint8_t m) { if (m == motor) { return (stepper.step.mask); } else { return (next.stepMask(m)); } }
+#endif
+
+	/* DDA ISR and loader sections - see the DDA ISR and _load_move() */
+
+	template<const bool share_port>
+	_motor_inline void step(uint32_t &step_bits)
+	{
+		if (active && !stepper.step.isNull() && (st_run.mot[motor].substep_accumulator += st_run.mot[motor].substep_increment) > 0) {
+			if (share_port) { step_bits |= stepper.step.mask; } else { stepper.step.set(); } // turn step bit on
+			st_run.mot[motor].substep_accumulator -= st_run.dda_ticks_X_substeps;
+			INCREMENT_ENCODER(motor);
+			RASTER_STEP(motor);
+		}
+		next.template step<share_port>(step_bits);
+	}
+
+	_motor_inline void clearSteps()
+	{
+#ifdef __AUX_MOTION
+		if (active && (st_aux.motor != motor+1)) { stepper.step.clear(); }	// the aux channel times its own pulse
+#else
+		if (active) { stepper.step.clear(); }
+#endif
+		next.clearSteps();
+	}
+
+	_motor_inline void load(const stPrepBuffer_t *p, bool &direction_change)
+	{
+		if (active) {
+#ifdef __MICROSTEP_MORPH
+			st_run.mot[motor].microstep_phase += en.en[motor].steps_run; // native microsteps run by the last segment
+#endif
+			// the following if() statement sets the runtime substep increment value or zeroes it
+			if ((st_run.mot[motor].substep_increment = p->mot[motor].substep_increment) != 0) {
+
+				// NB: If motor has 0 steps the following is all skipped. This ensures that state comparisons
+				//	   always operate on the last segment actually run by this motor, regardless of how many
+				//	   segments it may have been inactive in between.
+
+				// Apply accumulator correction if the time base has changed since previous segment
+				if (p->mot[motor].accumulator_correction_flag == true) {
+#ifdef FIXED_POINT_EXEC
+					st_run.mot[motor].substep_accumulator = fx_scale(st_run.mot[motor].substep_accumulator, p->mot[motor].accumulator_correction);
+#else
+					st_run.mot[motor].substep_accumulator *= p->mot[motor].accumulator_correction;
+#endif
+				}
+
+				// Detect direction change and if so:
+				//	- Note the direction bit for hardware (written for all motors after the motor loads).
+				//	- Compensate for direction change by flipping substep accumulator value about its midpoint.
+
+				if (p->mot[motor].direction != st_run.mot[motor].direction) {
+					st_run.mot[motor].direction = p->mot[motor].direction;
+					st_run.mot[motor].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[motor].substep_accumulator);
+					direction_change = true;
+				}
+
+#ifdef __MICROSTEP_MORPH
+				morph(p, direction_change);
+#endif
+
+				// Enable the stepper and start motor power management
+				stepper.enable();								// enable the motor (clear the ~Enable line)
+				st_run.mot[motor].power_state = MOTOR_RUNNING;
+#ifdef __MICROSTEP_MORPH
+				SET_ENCODER_STEP_SIGN(motor, p->mot[motor].step_sign * (1 << st_run.mot[motor].microstep_shift));
+#else
+				SET_ENCODER_STEP_SIGN(motor, p->mot[motor].step_sign);
+#endif
+
+			} else {  // Motor has 0 steps; might need to energize motor for power mode processing
+				if (st_cfg.mot[motor].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
+					stepper.enable();							// energize motor
+					st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;
+				}
+			}
+			// accumulate counted steps to the step position and zero out counted steps for the segment currently being loaded
+			ACCUMULATE_ENCODER(motor);
+			ALIGN_ENCODER(motor, p->mot[motor].target_steps);
+		}
+		next.load(p, direction_change);
+	}
+
+#ifdef __MICROSTEP_MORPH
+	// Microstep morphing - see stepper.h. Goes coarser only where the motor is on the coarser grid,
+	// otherwise as far towards it as the position allows. Going finer is always possible.
+	// The accumulator keeps its progress to the next step, in the new step size.
+	_motor_inline void morph(const stPrepBuffer_t *p, bool &hold)
+	{
+		uint8_t shift = 0;
+		if ((p->raster == RASTER_NONE) && (st_run.raster_line == NULL)) {	// raster pixels are native steps
+			shift = p->mot[motor].microstep_shift;
+		}
+		while ((shift > st_run.mot[motor].microstep_shift) &&
+			   (st_run.mot[motor].microstep_phase & ((1 << shift) - 1))) {
+			shift--;
+		}
+		if (shift != st_run.mot[motor].microstep_shift) {
+			int64_t progress = (int64_t)st_run.mot[motor].substep_accumulator + st_run.dda_ticks_X_substeps;
+			if (shift > st_run.mot[motor].microstep_shift) {
+				progress >>= (shift - st_run.mot[motor].microstep_shift);
+			} else {
+				progress = min(progress << (st_run.mot[motor].microstep_shift - shift), (int64_t)st_run.dda_ticks_X_substeps);
+			}
+			st_run.mot[motor].substep_accumulator = (int32_t)(progress - st_run.dda_ticks_X_substeps);
+			st_run.mot[motor].microstep_shift = shift;
+			stepper.setMicrosteps(st_cfg.mot[motor].microsteps >> shift);
+			hold = true;										// the driver settles like a direction change
+		}
+		if (shift != 0) {
+			st_run.mot[motor].substep_increment = (st_run.mot[motor].substep_increment + (1 << (shift-1))) >> shift;
+		}
+	}
+
+	// back to native microsteps when the runtime is reset - the position is lost anyway
+	void unmorph()
+	{
+		if (active && (st_run.mot[motor].microstep_shift != 0)) {
+			st_run.mot[motor].microstep_shift = 0;
+			stepper.setMicrosteps(st_cfg.mot[motor].microsteps);
+		}
+		next.unmorph();
+	}
+#endif
+};
+
+template<const uint8_t motor>
+struct MotorList<motor, false> {						// end of the list
+	static const uint32_t step_mask = 0;
+	static constexpr bool onStepPort(const uint8_t letter) { return (true); }
+
+	void enable(const uint8_t m) {}
+	void disable(const uint8_t m) {}
+	void setVref(const uint8_t m, const float v) {}
+	void setMicrosteps(const uint8_t m, const uint8_t ms) {}
+	bool hasMicrostepPins(const uint8_t m) { return (false); }
+#ifdef __AUX_MOTION
+	void stepOn(const uint8_t m) {}
+	void stepOff(const uint8_t m) {}
+	uint32_t stepMask(const uint8_t m) { return (0); }
+#endif
+
+	template<const bool share_port>
+	_motor_inline void step(uint32_t &step_bits) {}
+	_motor_inline void clearSteps() {}
+	_motor_inline void load(const stPrepBuffer_t *p, bool &direction_change) {}
+#ifdef __MICROSTEP_MORPH
+	void unmorph() {}
+#endif
+};
+
+MotorList<MOTOR_1> motors;
+
+static uint32_t dda_top_nominal;		// DDA timer top for FREQUENCY_DDA
+static uint32_t dda_top;				// DDA timer top and match values at the undivided DDA clock
+static uint32_t dda_match;				// ...the step pulse runs from match to top - see st_set_spw()
+
+IRQPin<kKinen_SyncPinNumber> sync_pin;	// segment sync between boards - see st_set_net()
+
+// The direction lines are written together so they all settle before the next step edge
+PinGroup<SocketPins<MOTOR_1>::dir,
+         SocketPins<MOTOR_2>::dir,
+         SocketPins<MOTOR_3>::dir,
+         SocketPins<MOTOR_4>::dir,
+         SocketPins<MOTOR_5>::dir,
+         SocketPins<MOTOR_6>::dir,
+         SocketPins<MOTOR_7>::dir,
+         SocketPins<MOTOR_8>::dir> direction_pins;
+
+/*
+ * _write_directions() - write all direction lines from the runtime direction settings
+ *
+ *	Bit N of the group is motor N+1's line: set for CCW, clear for CW (see Stepper::setDirection())
+ */
+static void _write_directions()
+{
+	uint32_t bits = 0;
+	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+		if (st_run.mot[motor].direction != DIRECTION_CW) {
+			bits |= (1 << motor);
+		}
+	}
+	direction_pins.write(bits);
+}
+
+/*
+ * _hold_for_direction_setup() - delay the first step after a direction change
+ *
+ *	The loader starts the DDA timer from zero, so the first step of a segment comes at
+ *	match A - the time left over from the step pulse. If that is shorter than the direction
+ *	setup time {dst:} the segment starts with dda_hold ticks that put out no steps. They
+ *	are added to the tick count, so the segment runs a little long rather than losing steps.
+ *	Call after the segment's ticks and divisor are set.
+ */
+static void _hold_for_direction_setup()
+{
+	uint32_t divisor = (st_run.dda_divisor > 1) ? st_run.dda_divisor : 1;
+	uint32_t first_step = (dda_top * (divisor - 1)) + dda_match;
+	if (st_cfg.direction_setup_ticks > first_step) {
+		uint32_t period = dda_top * divisor;
+		st_run.dda_hold = (st_cfg.direction_setup_ticks - first_step + period - 1) / period;
+		st_run.dda_ticks_downcount += st_run.dda_hold;
+	}
+}
+
+/*
+ * Step port - single port write for step pulses
+ *
+ *	If all the step pins in use are on one PIO port the DDA ISR collects the steps for the
+ *	tick into a mask and sets them with one SODR write, and clears them with one CODR write.
+ *	Otherwise it falls back to setting and clearing each pin. It's all settled at compile
+ *	time from the Motate pin templates - unused (null) pins have a port letter of 0.
+ */
+static const uint8_t kStepPortLetter = Pin<SocketPins<MOTOR_1>::step>::portLetter;
+static const bool kStepPinsShareAPort = (kStepPortLetter != 0) && MotorList<MOTOR_1>::onStepPort(kStepPortLetter);
+static const uint32_t kStepPortMask = MotorList<MOTOR_1>::step_mask;
+static Port32<kStepPortLetter> step_port;
+#ifdef __AUX_MOTION
+static uint32_t step_clear_mask = kStepPortMask;	// less the aux motor's step pin - see st_set_auxm()
+#endif
+
 
 #endif // __ARM
 
@@ -285,18 +705,29 @@ void stepper_init()
 	// Longer duty cycles stretch ON pulses but 75% is about the upper limit and about
 	// optimal for 200 KHz DDA clock before the time in the OFF cycle is too short.
 	// If you need more pulse width you need to drop the DDA clock rate
-	dda_timer.setInterrupts(kInterruptOnOverflow | kInterruptOnMatchA | kInterruptPriorityHighest);
+	dda_timer.setInterrupts(kInterruptOnOverflow | kInterruptOnMatchA | hw_timer_priority(IRQ_PRIORITY_DDA));
 	dda_timer.setDutyCycleA(1.0 - 0.75);		// This is a 75% duty cycle on the ON step part
+	dda_top_nominal = dda_timer.getTopValue();	// base values for the adaptive DDA rate and pulse width
+	dda_top = dda_top_nominal;
+	dda_match = dda_top * (1.0 - 0.75);
+#ifdef __ISR_PROFILE
+	dda_cycles_per_tick = (uint32_t)(F_CPU / FREQUENCY_DDA) / dda_top_nominal;
+	dwell_cycles_per_tick = (F_CPU / FREQUENCY_DWELL) / dwell_timer.getTopValue();
+#endif
 
 	// setup DWELL timer
-	dwell_timer.setInterrupts(kInterruptOnOverflow | kInterruptPriorityHighest);
+	dwell_timer.setInterrupts(kInterruptOnOverflow | hw_timer_priority(IRQ_PRIORITY_DWELL));
 
 	// setup software interrupt load timer
-	load_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityLow);
+	load_timer.setInterrupts(kInterruptOnSoftwareTrigger | hw_timer_priority(IRQ_PRIORITY_LOAD));
 
 	// setup software interrupt exec timer & initial condition
-	exec_timer.setInterrupts(kInterruptOnSoftwareTrigger | kInterruptPriorityLowest);
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;
+	exec_timer.setInterrupts(kInterruptOnSoftwareTrigger | hw_timer_priority(IRQ_PRIORITY_EXEC));
+
+#ifdef __AUX_MOTION
+	// setup aux motion timer - started by the first queued move
+	aux_timer.setInterrupts(kInterruptOnOverflow | hw_timer_priority(IRQ_PRIORITY_AUX));
+#endif
 
 	// setup motor power levels and apply power level to stepper drivers
 	for (uint8_t motor=0; motor<MOTORS; motor++) {
@@ -319,14 +750,42 @@ void stepper_reset()
     dda_timer.stop();                                   // stop all movement
     dwell_timer.stop();
     st_run.dda_ticks_downcount = 0;                     // signal the runtime is not busy
-    st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;    // set to EXEC or it won't restart
+    st_run.dda_hold = 0;
+    st_run.sync_waiting = false;                        // a slave waiting on the master lets go
+    st_run.sync_edges = 0;
+    st_run.dda_divisor = 0;                             // set the DDA rate on the next load
+    st_pre.buffer_in = 0;                               // empty the prep buffers or it won't restart
+    st_pre.buffer_out = 0;
+    for (uint8_t i=0; i<PREP_BUFFER_SIZE; i++) {
+        st_pre.buf[i].move_type = MOVE_TYPE_NULL;
+    }
+    if (st_run.raster_line != NULL) {
+        st_run.raster_line->in_use = false;             // drop a raster line that was running
+        st_run.raster_line = NULL;
+    }
+    st_run.raster_motor = MOTORS;
+#ifdef __MOTION_OUTPUTS
+    st_run.output_events = 0;                           // events in a dropped segment don't fire
+    st_run.output_downcount = 0;
+#endif
 
 	for (uint8_t motor=0; motor<MOTORS; motor++) {
 		st_pre.mot[motor].prev_direction = STEP_INITIAL_DIRECTION;
-        st_pre.mot[motor].direction = STEP_INITIAL_DIRECTION;
+#ifdef __AUX_MOTION
+        if (!st_aux_is_motor(motor))                    // the aux channel keeps its direction
+#endif
+        st_run.mot[motor].direction = STEP_INITIAL_DIRECTION;
 		st_run.mot[motor].substep_accumulator = 0;      // will become max negative during per-motor setup;
 		st_pre.mot[motor].corrected_steps = 0;          // diagnostic only - no action effect
+		st_pre.mot[motor].correction_integral = 0;
+#ifdef __MICROSTEP_MORPH
+		st_pre.mot[motor].microstep_shift = 0;
+#endif
 	}
+#ifdef __MICROSTEP_MORPH
+	motors.unmorph();
+#endif
+	_write_directions();                                // make the lines agree with the runtime
  	mp_set_steps_to_runtime_position();                 // reset encoder to agree with the above
 }
 
@@ -372,15 +831,53 @@ bool st_runtime_isbusy()
 stat_t st_clc(nvObj_t *nv)	// clear diagnostic counters, reset stepper prep
 {
 	stepper_reset();
+#ifdef __ISR_PROFILE
+	memset(isr_prof, 0, sizeof(isr_prof));
+#endif
 	return(STAT_OK);
 }
 
+/*
+ * st_get_run_size() - size of the (static) runtime singleton, for the memory report
+ */
+
+size_t st_get_run_size()
+{
+	return (sizeof(st_run));
+}
+
+#ifdef __ISR_PROFILE
+/*
+ * st_get_isr() - print the ISR profile
+ *
+ *	{"isr":{"dda":[count,min,avg,max,overruns,latency],"dwl":[...],"exec":[...],"load":[...]}}
+ *	Times are in CPU cycles (HW_CYCLES_PER_US per microsecond). Latency is the worst seen -
+ *	request to entry, or overflow to entry for the DDA and dwell timers (see ISR profile).
+ */
+stat_t st_get_isr(nvObj_t *nv)
+{
+	static const char *const isr_name[ISR_PROFILE_COUNT] = { "dda", "dwl", "exec", "load" };
+	printf_P(PSTR("{\"isr\":{"));
+	for (uint8_t i=0; i<ISR_PROFILE_COUNT; i++) {
+		isrProfile_t p = isr_prof[i];			// copy - the ISRs keep running
+		printf_P(PSTR("%s\"%s\":[%lu,%lu,%lu,%lu,%lu,%lu]"), (i == 0) ? "" : ",", isr_name[i],
+			(unsigned long)p.count, (unsigned long)p.min,
+			(unsigned long)((p.count == 0) ? 0 : (p.total / p.count)),
+			(unsigned long)p.max, (unsigned long)p.overruns, (unsigned long)p.latency);
+	}
+	printf_P(PSTR("}}\n"));
+	nv->valuetype = TYPE_NULL;
+	return (STAT_OK);
+}
+#endif // __ISR_PROFILE
+
 /*
  * Motor power management functions
  *
  * _deenergize_motor()		 - remove power from a motor
  * _energize_motor()		 - apply power to a motor and start motor timeout
  * _set_motor_power_level()	 - set the actual Vref to a specified power level
+ * _reduce_motor_power()	 - drop an idle motor to the idle power level
  *
  * st_energize_motors()		 - apply power to all motors
  * st_deenergize_motors()	 - remove power from all motors
@@ -400,12 +897,7 @@ static void _deenergize_motor(const uint8_t motor)
 #endif
 #ifdef __ARM
 	// Motors that are not defined are not compiled. Saves some ugly #ifdef code
-    if (motor == MOTOR_1) motor_1.disable();	// set disables the motor
-	if (motor == MOTOR_2) motor_2.disable();
-    if (motor == MOTOR_3) motor_3.disable();
-    if (motor == MOTOR_4) motor_4.disable();
-    if (motor == MOTOR_5) motor_5.disable();
-    if (motor == MOTOR_6) motor_6.disable();
+    motors.disable(motor);						// set disables the motor
 
     st_run.mot[motor].power_state = MOTOR_OFF;
 
@@ -440,18 +932,14 @@ static void _energize_motor(const uint8_t motor, float timeout_seconds)
 #endif
 #ifdef __ARM
 	// Motors that are not defined are not compiled. Saves some ugly #ifdef code
-	if (motor == MOTOR_1) motor_1.enable();
-	if (motor == MOTOR_2) motor_2.enable();
-	if (motor == MOTOR_3) motor_3.enable();
-	if (motor == MOTOR_4) motor_4.enable();
-	if (motor == MOTOR_5) motor_5.enable();
-	if (motor == MOTOR_6) motor_6.enable();
+	motors.enable(motor);
 
     common_enable.set(); // enables are inverted
 #endif
 
 	st_run.mot[motor].power_systick = SysTickTimer_getValue() + (timeout_seconds * 1000);
 	st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_COUNTDOWN;
+	controller_wake(DEADLINE_MOTOR_POWER);
 }
 
 /*
@@ -465,15 +953,28 @@ static void _set_motor_power_level(const uint8_t motor, const float power_level)
 {
 #ifdef __ARM
 	// power_level must be scaled properly for the driver's Vref voltage requirements
-	if (motor == MOTOR_1) motor_1.setVref(power_level);
-	if (motor == MOTOR_2) motor_2.setVref(power_level);
-	if (motor == MOTOR_3) motor_3.setVref(power_level);
-	if (motor == MOTOR_4) motor_4.setVref(power_level);
-	if (motor == MOTOR_5) motor_5.setVref(power_level);
-	if (motor == MOTOR_6) motor_6.setVref(power_level);
+	motors.setVref(motor, power_level);
 #endif
 }
 
+/*
+ *	_reduce_motor_power() - drop an idle motor to the idle power level
+ *
+ *	Full power comes back in st_prep_line(), a few segments ahead of the motor's next move,
+ *	and again in enable() when that move loads. The state is checked with interrupts off so a
+ *	load that has just set the motor running can't be given the idle level.
+ */
+static void _reduce_motor_power(const uint8_t motor)
+{
+	__disable_irq();
+	if (st_run.mot[motor].power_state == MOTOR_POWER_TIMEOUT_COUNTDOWN) {
+		st_run.mot[motor].power_state = MOTOR_IDLE;
+		st_run.mot[motor].power_level_dynamic = st_cfg.mot[motor].power_level_scaled * st_cfg.idle_power_factor;
+		_set_motor_power_level(motor, st_run.mot[motor].power_level_dynamic);
+	}
+	__enable_irq();
+}
+
 void st_energize_motors(float timeout_seconds)
 {
 	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
@@ -498,28 +999,39 @@ void st_deenergize_motors()
  * st_motor_power_callback() - callback to manage motor power sequencing
  *
  *	Handles motor power-down timing, low-power idle, and adaptive motor power
+ *
+ *	Runs on DEADLINE_MOTOR_POWER, so only when there is something to do. That means the
+ *	loader (or $me) woke it by moving a motor out of RUNNING, or the first motor timeout
+ *	it armed last time has come due.
  */
 stat_t st_motor_power_callback() 	// called by controller
 {
     if (!mp_is_it_phat_city_time()) {   // don't process this if you are time constrained in the planner
+        controller_wake(DEADLINE_MOTOR_POWER);  // ...but come back on the next pass
         return (STAT_NOOP);
     }
 
     bool have_actually_stopped = false;
-    if ((!st_runtime_isbusy()) && (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER)) {	// if there are no moves to load...
+    if ((!st_runtime_isbusy()) && (_prep_buffer_is_empty())) {	// if there are no moves to load...
         have_actually_stopped = true;
     }
 
 	// manage power for each motor individually
 	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
 
+#ifdef __AUX_MOTION
+        if (st_aux.running && st_aux_is_motor(motor)) {
+            continue;                                   // the aux channel times out its motor when it stops
+        }
+#endif
         if (have_actually_stopped && st_run.mot[motor].power_state == MOTOR_RUNNING)
             st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;	// ...start motor power timeouts
 
 		// start timeouts initiated during a load so the loader does not need to burn these cycles
 		if (st_run.mot[motor].power_state == MOTOR_POWER_TIMEOUT_START && st_cfg.mot[motor].power_mode != MOTOR_ALWAYS_POWERED) {
 			st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_COUNTDOWN;
-			if (st_cfg.mot[motor].power_mode == MOTOR_POWERED_IN_CYCLE) {
+			if ((st_cfg.mot[motor].power_mode == MOTOR_POWERED_IN_CYCLE) ||
+				(st_cfg.mot[motor].power_mode == MOTOR_POWER_REDUCED_WHEN_IDLE)) {
 				st_run.mot[motor].power_systick = SysTickTimer_getValue() + (uint32_t)(st_cfg.motor_power_timeout * 1000);
 			} else if (st_cfg.mot[motor].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
 				st_run.mot[motor].power_systick = SysTickTimer_getValue() + (uint32_t)(MOTOR_TIMEOUT_SECONDS * 1000);
@@ -529,10 +1041,17 @@ stat_t st_motor_power_callback() 	// called by controller
 		// count down and time out the motor
 		if (st_run.mot[motor].power_state == MOTOR_POWER_TIMEOUT_COUNTDOWN) {
 			if (SysTickTimer_getValue() > st_run.mot[motor].power_systick ) {
-				st_run.mot[motor].power_state = MOTOR_IDLE;
-				_deenergize_motor(motor);
+				if (st_cfg.mot[motor].power_mode == MOTOR_POWER_REDUCED_WHEN_IDLE) {
+					_reduce_motor_power(motor);
+				} else {
+					st_run.mot[motor].power_state = MOTOR_IDLE;
+					_deenergize_motor(motor);
+				}
 			}
 		}
+		if (st_run.mot[motor].power_state == MOTOR_POWER_TIMEOUT_COUNTDOWN) {	// still counting - the earliest one wins
+			controller_set_deadline(DEADLINE_MOTOR_POWER, st_run.mot[motor].power_systick + 1);
+		}
 	}
 	return (STAT_OK);
 }
@@ -595,69 +1114,106 @@ ISR(TIMER_DDA_ISR_vect)
  *	This way the length of the stepper pulse can be controlled by setting the match value.
  *  Note that this makes the pulse timing the inverted duty cycle.
  *
- *	Note that the motor_N.step.isNull() tests are compile-time tests, not run-time tests.
- *	If motor_N is not defined that if{} clause (i.e. that motor) drops out of the complied code.
+ *	The per-motor step sections come from the motor list (see Motor list), one for each motor.
+ *	Note that the step.isNull() tests are compile-time tests, not run-time tests. If a motor's
+ *	step pin is not defined its section drops out of the complied code. Motors above MOTORS_ACTIVE
+ *	(see tinyg2.h) are left out the same way. So is kStepPinsShareAPort, which selects single
+ *	port writes (see Step port).
  */
 namespace Motate {			// Must define timer interrupts inside the Motate namespace
+template<> void Timer<dda_timer_num>::interrupt() RAMFUNC;	// see RAMFUNC in hardware.h
+
 MOTATE_TIMER_INTERRUPT(dda_timer_num)
 {
+	PROFILE_PIN_SCOPE(DDA);								// see profile_pins.h
+	ISR_PROFILE_START();
 	uint32_t interrupt_cause = dda_timer.getInterruptCause();	// also clears interrupt condition
 
-//  dda_debug_pin2=1;       // example of use of debug pin for profiling with a logic analyser or scope
-
 	if (interrupt_cause == kInterruptOnMatchA) {
-
-		if (!motor_1.step.isNull() && (st_run.mot[MOTOR_1].substep_accumulator += st_run.mot[MOTOR_1].substep_increment) > 0) {
-			motor_1.step.set();		// turn step bit on
-			st_run.mot[MOTOR_1].substep_accumulator -= st_run.dda_ticks_X_substeps;
-			INCREMENT_ENCODER(MOTOR_1);
-		}
-		if (!motor_2.step.isNull() && (st_run.mot[MOTOR_2].substep_accumulator += st_run.mot[MOTOR_2].substep_increment) > 0) {
-			motor_2.step.set();
-			st_run.mot[MOTOR_2].substep_accumulator -= st_run.dda_ticks_X_substeps;
-			INCREMENT_ENCODER(MOTOR_2);
-		}
-		if (!motor_3.step.isNull() && (st_run.mot[MOTOR_3].substep_accumulator += st_run.mot[MOTOR_3].substep_increment) > 0) {
-			motor_3.step.set();
-			st_run.mot[MOTOR_3].substep_accumulator -= st_run.dda_ticks_X_substeps;
-			INCREMENT_ENCODER(MOTOR_3);
-		}
-		if (!motor_4.step.isNull() && (st_run.mot[MOTOR_4].substep_accumulator += st_run.mot[MOTOR_4].substep_increment) > 0) {
-			motor_4.step.set();
-			st_run.mot[MOTOR_4].substep_accumulator -= st_run.dda_ticks_X_substeps;
-			INCREMENT_ENCODER(MOTOR_4);
-		}
-		if (!motor_5.step.isNull() && (st_run.mot[MOTOR_5].substep_accumulator += st_run.mot[MOTOR_5].substep_increment) > 0) {
-			motor_5.step.set();
-			st_run.mot[MOTOR_5].substep_accumulator -= st_run.dda_ticks_X_substeps;
-			INCREMENT_ENCODER(MOTOR_5);
-		}
-		if (!motor_6.step.isNull() && (st_run.mot[MOTOR_6].substep_accumulator += st_run.mot[MOTOR_6].substep_increment) > 0) {
-			motor_6.step.set();
-			st_run.mot[MOTOR_6].substep_accumulator -= st_run.dda_ticks_X_substeps;
-			INCREMENT_ENCODER(MOTOR_6);
+		if (st_run.dda_hold != 0) {						// direction setup - no steps this tick
+			st_run.dda_hold--;
+			ISR_PROFILE_END(ISR_PROFILE_DDA);
+			return;
 		}
+		uint32_t step_mask = 0;
+
+		motors.step<kStepPinsShareAPort>(step_mask);	// the motor list unrolls to one section per motor
+		if (kStepPinsShareAPort) { step_port.set(step_mask); }
 
 	} else if (interrupt_cause == kInterruptOnOverflow) {
-		motor_1.step.clear();							// turn step bits off
-		motor_2.step.clear();
-		motor_3.step.clear();
-		motor_4.step.clear();
-		motor_5.step.clear();
-		motor_6.step.clear();
+		ISR_PROFILE_TIMER_LATENCY(ISR_PROFILE_DDA, dda_timer.getValue() * dda_cycles_per_tick);
+		if (kStepPinsShareAPort) {
+#ifdef __AUX_MOTION
+			step_port.clear(step_clear_mask);			// turn step bits off
+#else
+			step_port.clear(kStepPortMask);				// turn step bits off
+#endif
+		} else {
+			motors.clearSteps();						// turn step bits off
+		}
 
-		if (--st_run.dda_ticks_downcount != 0) return;
+		if (--st_run.dda_ticks_downcount != 0) {
+#ifdef __MOTION_OUTPUTS
+			if (st_run.dda_ticks_downcount <= st_run.output_downcount) {
+				_output_events();
+			}
+#endif
+			ISR_PROFILE_END(ISR_PROFILE_DDA);
+			return;
+		}
 
 		// process end of segment
 		dda_timer.stop();								// turn it off or it will keep stepping out the last segment
 		_load_move();									// load the next move at the current interrupt level
 	}
-//    dda_debug_pin2=0;
+	ISR_PROFILE_END(ISR_PROFILE_DDA);
 } // MOTATE_TIMER_INTERRUPT
 } // namespace Motate
 
 #endif // __ARM
 
+/***** Segment sync ********************************************************************
+ *
+ *	Two boards run in step by starting their segments together. Both get moves of the same
+ *	durations (e.g. the same Gcode with different axes mapped to their motors), so they cut
+ *	the same segments. The master toggles the ~Sync pin as it starts each aline segment.
+ *	The slave loads its segment as usual but only starts the DDA timer on a sync edge.
+ *
+ *	The slave's DDA period is SYNC_SLAVE_TRIM_TICKS short, so it finishes each segment a
+ *	little early (0.24% at 200 KHz) and waits for the edge - that is the lock. A slave that
+ *	starts late after an edge it has counted makes up the trim every segment until it is
+ *	waiting again, so crystal differences and start-up latency don't accumulate.
+ *
+ *	Only aline segments are synchronized. Dwells and commands run on each board's own time,
+ *	and feedholds, alarms and flushes must be sent to both boards.
+ */
+#ifdef __ARM
+static void _sync_start()
+{
+	__disable_irq();
+	if (st_run.sync_edges != 0) {							// the edge has come already
+		st_run.sync_edges--;
+		dda_timer.start();
+	} else {
+		st_run.sync_waiting = true;
+	}
+	__enable_irq();
+}
+
+MOTATE_PIN_INTERRUPT(kKinen_SyncPinNumber)
+{
+	if (cs.network_mode != NETWORK_SLAVE) {
+		return;
+	}
+	if (st_run.sync_waiting) {
+		st_run.sync_waiting = false;
+		dda_timer.start();
+	} else if (st_run.sync_edges < SYNC_EDGES_MAX) {
+		st_run.sync_edges++;
+	}
+}
+#endif // __ARM
+
 /***** Dwell Interrupt Service Routine **************************************************
  * ISR - DDA timer interrupt routine - service ticks from DDA timer
  */
@@ -674,11 +1230,14 @@ ISR(TIMER_DWELL_ISR_vect) {								// DWELL timer interrupt
 namespace Motate {			// Must define timer interrupts inside the Motate namespace
 MOTATE_TIMER_INTERRUPT(dwell_timer_num)
 {
+	ISR_PROFILE_START();
 	dwell_timer.getInterruptCause(); // read SR to clear interrupt condition
+	ISR_PROFILE_TIMER_LATENCY(ISR_PROFILE_DWELL, dwell_timer.getValue() * dwell_cycles_per_tick);
 	if (--st_run.dda_ticks_downcount == 0) {
 		dwell_timer.stop();
 		_load_move();
 	}
+	ISR_PROFILE_END(ISR_PROFILE_DWELL);
 }
 } // namespace Motate
 #endif
@@ -689,10 +1248,30 @@ MOTATE_TIMER_INTERRUPT(dwell_timer_num)
  * exec_timer interrupt		- interrupt handler for calling exec function
  */
 
+/*
+ * _exec_segments() - exec and prep segments until the ring is full, exec has nothing to run,
+ *					  or the batch is done. A full batch asks for another exec interrupt to
+ *					  pick up where it left off.
+ */
+static void _exec_segments()
+{
+	for (uint8_t i=0; i < EXEC_BATCH_SEGMENTS; i++) {
+		if (!_prep_buffer_is_available()) {
+			return;
+		}
+		if (mp_exec_move() == STAT_NOOP) {
+			return;
+		}
+		_commit_prep_buffer();
+		st_request_load_move();							// starts the loader on the first one
+	}
+	st_request_exec_move();								// run ahead until the ring is full
+}
+
 #ifdef __AVR
 void st_request_exec_move()
 {
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {// bother interrupting
+	if (_prep_buffer_is_available()) {					// bother interrupting
 		TIMER_EXEC.PER = EXEC_TIMER_PERIOD;
 		TIMER_EXEC.CTRLA = EXEC_TIMER_ENABLE;           // trigger a LO interrupt
 	}
@@ -700,65 +1279,279 @@ void st_request_exec_move()
 
 ISR(TIMER_EXEC_ISR_vect) {								// exec move SW interrupt
 	TIMER_EXEC.CTRLA = EXEC_TIMER_DISABLE;				// disable SW interrupt timer
-
-	// exec_move
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {
-		if (mp_exec_move() != STAT_NOOP) {
-			st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
-			st_request_load_move();
-		}
-	}
+	_exec_segments();
 }
 #endif // __AVR
 
 #ifdef __ARM
 void st_request_exec_move()
 {
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {// bother interrupting
+	if (_prep_buffer_is_available()) {					// bother interrupting
+		ISR_PROFILE_REQUEST(ISR_PROFILE_EXEC);
 		exec_timer.setInterruptPending();
 	}
 }
 
 namespace Motate {	// Define timer inside Motate namespace
+	template<> void Timer<exec_timer_num>::interrupt() RAMFUNC;
+
 	MOTATE_TIMER_INTERRUPT(exec_timer_num)				// exec move SW interrupt
 	{
+		PROFILE_PIN_SCOPE(EXEC);
+		ISR_PROFILE_START();
+		ISR_PROFILE_LATENCY(ISR_PROFILE_EXEC);
 		exec_timer.getInterruptCause();					// clears the interrupt condition
-		if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {
-			if (mp_exec_move() != STAT_NOOP) {
-				st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
-				st_request_load_move();
-			}
-		}
+		_exec_segments();
+		ISR_PROFILE_END(ISR_PROFILE_EXEC);
 	}
 } // namespace Motate
 
 #endif // __ARM
 
 /****************************************************************************************
- * Loader sequencing code
- * st_request_load_move() - fires a software interrupt (timer) to request to load a move
- * load_move interrupt	  - interrupt handler for running the loader
+ * Aux motion channel - see stepper.h
  *
- *	_load_move() can only be called be called from an ISR at the same or higher level as
- *	the DDA or dwell ISR. A software interrupt has been provided to allow a non-ISR to
- *	request a load (see st_request_load_move())
+ * _aux_start_move()	- take the next queued move, or stop the channel if there is none
+ * _aux_segment()		- set up the steps of the next segment of the move
+ * aux interrupt		- step pulses and segment timing
+ *
+ *	All of it runs in the aux interrupt, at the loader's level, so direction writes can't
+ *	interleave with the loader's. The queue is written by the main loop (st_set_aux()).
  */
+#ifdef __AUX_MOTION
 
-#ifdef __AVR
-void st_request_load_move()
+#define AUX_SEGMENT_TIME ((float)AUX_SEGMENT_TICKS / AUX_FREQUENCY)
+
+bool st_aux_is_motor(const uint8_t motor) { return (st_aux.motor == motor+1); }
+
+static bool _aux_start_move()
 {
-	if (st_runtime_isbusy()) {
-		return;													// don't request a load if the runtime is busy
-	}
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_LOADER) {	// bother interrupting
-		TIMER_LOAD.PER = LOAD_TIMER_PERIOD;
-		TIMER_LOAD.CTRLA = LOAD_TIMER_ENABLE;					// trigger a HI interrupt
+	uint8_t motor = st_aux.motor-1;
+
+	while (st_aux.queue_out != st_aux.queue_in) {
+		stAuxMove_t *m = &st_aux.queue[st_aux.queue_out & (AUX_QUEUE_SIZE-1)];
+		float steps_per_unit = st_cfg.mot[motor].steps_per_unit;
+
+		st_aux.start = st_aux.position;
+		st_aux.length = (m->target * steps_per_unit) - st_aux.start;
+		st_aux.velocity = min(m->velocity * steps_per_unit / 60, (float)AUX_FREQUENCY / 2);
+		st_aux.accel = st_aux.acceleration * steps_per_unit;
+		st_aux.queue_out++;
+
+		float length = fabs(st_aux.length);
+		if (length < 0.5) {									// already there
+			continue;
+		}
+		st_aux.accel_time = st_aux.velocity / st_aux.accel;
+		if ((st_aux.velocity * st_aux.accel_time) > length) {	// no cruise - a triangle
+			st_aux.velocity = sqrt(length * st_aux.accel);
+			st_aux.accel_time = st_aux.velocity / st_aux.accel;
+		}
+		st_aux.total_time = st_aux.accel_time + (length / st_aux.velocity);
+		st_aux.segment = 0;
+
+		uint8_t direction = ((st_aux.length > 0) ? DIRECTION_CW : DIRECTION_CCW) ^ st_cfg.mot[motor].polarity;
+		if (direction != st_run.mot[motor].direction) {
+			st_run.mot[motor].direction = direction;
+			_write_directions();							// the first step is at least a tick away
+		}
+		motors.enable(motor);
+		st_run.mot[motor].power_state = MOTOR_RUNNING;
+		return (true);
 	}
+	aux_timer.stop();
+	st_aux.running = false;
+	st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;
+	controller_wake(DEADLINE_MOTOR_POWER);
+	return (false);
 }
 
-ISR(TIMER_LOAD_ISR_vect) {										// load steppers SW interrupt
-	TIMER_LOAD.CTRLA = LOAD_TIMER_DISABLE;						// disable SW interrupt timer
-	_load_move();
+static void _aux_segment()
+{
+	float t = ++st_aux.segment * AUX_SEGMENT_TIME;
+	float s;										// distance into the move, in steps
+
+	if (t < st_aux.accel_time) {
+		s = 0.5 * st_aux.accel * square(t);
+	} else if (t < (st_aux.total_time - st_aux.accel_time)) {
+		s = (0.5 * st_aux.velocity * st_aux.accel_time) + (st_aux.velocity * (t - st_aux.accel_time));
+	} else if (t < st_aux.total_time) {
+		s = fabs(st_aux.length) - (0.5 * st_aux.accel * square(st_aux.total_time - t));
+	} else {
+		s = fabs(st_aux.length);
+	}
+	st_aux.segment_target = lround(st_aux.start + copysign(s, st_aux.length));
+
+	// steps behind are made up here, at up to a step every other tick
+	uint32_t steps = labs(st_aux.segment_target - st_aux.position);
+	st_aux.steps = min(steps, (uint32_t)AUX_SEGMENT_TICKS/2);
+	st_aux.tick = AUX_SEGMENT_TICKS;
+}
+
+namespace Motate {
+	template<> void Timer<aux_timer_num>::interrupt() RAMFUNC;
+
+	MOTATE_TIMER_INTERRUPT(aux_timer_num)
+	{
+		aux_timer.getInterruptCause();					// clears the interrupt condition
+
+		if (st_aux.step_high) {
+			motors.stepOff(st_aux.motor-1);
+			st_aux.step_high = false;
+		}
+		if (st_aux.tick == 0) {
+			if ((st_aux.segment_target == st_aux.position) &&
+				((st_aux.segment * AUX_SEGMENT_TIME) >= st_aux.total_time)) {
+				if (!_aux_start_move()) {
+					return;
+				}
+			}
+			_aux_segment();
+		}
+		st_aux.tick--;
+		if ((st_aux.accumulator += st_aux.steps) >= AUX_SEGMENT_TICKS) {
+			st_aux.accumulator -= AUX_SEGMENT_TICKS;
+			motors.stepOn(st_aux.motor-1);
+			st_aux.step_high = true;
+			st_aux.position += (st_aux.length > 0) ? 1 : -1;
+		}
+	}
+} // namespace Motate
+
+/*
+ * st_aux_stop() - stop the aux channel dead and drop its queue (alarm, shutdown, panic)
+ */
+void st_aux_stop()
+{
+	aux_timer.stop();
+	if (st_aux.step_high) {
+		motors.stepOff(st_aux.motor-1);
+		st_aux.step_high = false;
+	}
+	st_aux.queue_out = st_aux.queue_in;
+	st_aux.segment_target = st_aux.position;
+	st_aux.total_time = 0;
+	st_aux.tick = 0;
+	if (st_aux.running) {
+		st_aux.running = false;
+		st_run.mot[st_aux.motor-1].power_state = MOTOR_POWER_TIMEOUT_START;
+		controller_wake(DEADLINE_MOTOR_POWER);
+	}
+}
+
+/*
+ * st_set_aux()  - queue an absolute move of the aux motor at $auxv
+ * st_get_aux()  - where the aux motor is, in its units
+ * st_get_auxq() - aux moves queued, including the one running
+ * st_set_auxm() - assign the aux motor, 1-N, 0 = off. Only when the channel and the machine are at rest
+ * st_set_auxv() - aux velocity, units per minute
+ * st_set_auxa() - aux acceleration, units per second squared
+ */
+stat_t st_set_aux(nvObj_t *nv)
+{
+	if (st_aux.motor == 0) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	if (cm_get_machine_state() == MACHINE_ALARM) {
+		return (STAT_COMMAND_REJECTED_BY_ALARM);
+	}
+	if ((uint8_t)(st_aux.queue_in - st_aux.queue_out) >= AUX_QUEUE_SIZE) {
+		return (STAT_BUFFER_FULL);
+	}
+	stAuxMove_t *m = &st_aux.queue[st_aux.queue_in & (AUX_QUEUE_SIZE-1)];
+	m->target = nv->value;
+	m->velocity = st_aux.velocity_max;
+	st_aux.queue_in++;									// the interrupt may take it from here on
+	if (!st_aux.running) {
+		st_aux.running = true;
+		aux_timer.start();
+	}
+	return (STAT_OK);
+}
+
+stat_t st_get_aux(nvObj_t *nv)
+{
+	nv->value = 0;
+	if (st_aux.motor != 0) {
+		nv->value = st_aux.position / st_cfg.mot[st_aux.motor-1].steps_per_unit;
+	}
+	nv->precision = GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
+stat_t st_get_auxq(nvObj_t *nv)
+{
+	nv->value = (uint8_t)(st_aux.queue_in - st_aux.queue_out);
+	if (st_aux.running && (st_aux.total_time > 0)) {
+		nv->value++;
+	}
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t st_set_auxm(nvObj_t *nv)
+{
+	if (nv->value > MOTORS_ACTIVE) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	if (st_aux.running || (cm.cycle_state != CYCLE_OFF) || mp_has_runnable_buffer()) {
+		return (STAT_COMMAND_NOT_ACCEPTED);				// the motor map can't change under a move
+	}
+	set_ui8(nv);
+	st_aux.position = 0;
+	st_aux.segment_target = 0;
+	step_clear_mask = kStepPortMask;
+	if (st_aux.motor != 0) {
+		step_clear_mask &= ~motors.stepMask(st_aux.motor-1);
+	}
+	kn_update_motor_map();								// the planner lets go of the motor
+	return (STAT_OK);
+}
+
+stat_t st_set_auxv(nvObj_t *nv)
+{
+	if (nv->value <= 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	return (set_flt(nv));
+}
+
+stat_t st_set_auxa(nvObj_t *nv)
+{
+	if (nv->value <= 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	return (set_flt(nv));
+}
+
+#endif // __AUX_MOTION
+
+/****************************************************************************************
+ * Loader sequencing code
+ * st_request_load_move() - fires a software interrupt (timer) to request to load a move
+ * load_move interrupt	  - interrupt handler for running the loader
+ *
+ *	_load_move() can only be called be called from an ISR at the same or higher level as
+ *	the DDA or dwell ISR. A software interrupt has been provided to allow a non-ISR to
+ *	request a load (see st_request_load_move())
+ */
+
+#ifdef __AVR
+void st_request_load_move()
+{
+	if (st_runtime_isbusy()) {
+		return;													// don't request a load if the runtime is busy
+	}
+	if (!_prep_buffer_is_empty()) {								// bother interrupting
+		TIMER_LOAD.PER = LOAD_TIMER_PERIOD;
+		TIMER_LOAD.CTRLA = LOAD_TIMER_ENABLE;					// trigger a HI interrupt
+	}
+}
+
+ISR(TIMER_LOAD_ISR_vect) {										// load steppers SW interrupt
+	TIMER_LOAD.CTRLA = LOAD_TIMER_DISABLE;						// disable SW interrupt timer
+	_load_move();
 }
 #endif // __AVR
 
@@ -768,14 +1561,19 @@ void st_request_load_move()
 	if (st_runtime_isbusy()) {                                  // don't request a load if the runtime is busy
 		return;
 	}
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_LOADER) {	// bother interrupting
+	if (!_prep_buffer_is_empty()) {								// bother interrupting
+		ISR_PROFILE_REQUEST(ISR_PROFILE_LOAD);
 		load_timer.setInterruptPending();
 	}
 }
 
 namespace Motate {	// Define timer inside Motate namespace
+	template<> void Timer<load_timer_num>::interrupt() RAMFUNC;
+
 	MOTATE_TIMER_INTERRUPT(load_timer_num)						// load steppers SW interrupt
 	{
+		ISR_PROFILE_START();
+		ISR_PROFILE_LATENCY(ISR_PROFILE_LOAD);
 		load_timer.getInterruptCause();							// read SR to clear interrupt condition
 		_load_move();
 	}
@@ -799,186 +1597,141 @@ namespace Motate {	// Define timer inside Motate namespace
 #ifdef __ARM
 static void _load_move()
 {
+	PROFILE_PIN_SCOPE(LOAD);
+	ISR_PROFILE_START();
 	// Be aware that dda_ticks_downcount must equal zero for the loader to run.
 	// So the initial load must also have this set to zero as part of initialization
 	if (st_runtime_isbusy()) {
+		ISR_PROFILE_END(ISR_PROFILE_LOAD);
 		return;													// exit if the runtime is busy
 	}
-	if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER) {	// if there are no moves to load...
+	if (_prep_buffer_is_empty()) {								// if there are no moves to load...
 		for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
 			st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;	// ...start motor power timeouts
 		}
+		st_run.sync_edges = 0;									// a slave at rest is not behind the master
+		controller_wake(DEADLINE_MOTOR_POWER);
+		ISR_PROFILE_END(ISR_PROFILE_LOAD);
 		return;
 	}
+	stPrepBuffer_t *p = _get_load_buffer();
 
 	// handle aline loads first (most common case)  NB: there are no more lines, only alines
-	if (st_pre.move_type == MOVE_TYPE_ALINE) {
+	if (p->move_type == MOVE_TYPE_ALINE) {
 
 		//**** setup the new segment ****
 
-		st_run.dda_ticks_downcount = st_pre.dda_ticks;
-		st_run.dda_ticks_X_substeps = st_pre.dda_ticks_X_substeps;
-
-		//**** MOTOR_1 LOAD ****
-
-		// These sections are somewhat optimized for execution speed. The whole load operation
-		// is supposed to take < 10 uSec (Xmega). Be careful if you mess with this.
-
-		// the following if() statement sets the runtime substep increment value or zeroes it
-		if ((st_run.mot[MOTOR_1].substep_increment = st_pre.mot[MOTOR_1].substep_increment) != 0) {
-
-			// NB: If motor has 0 steps the following is all skipped. This ensures that state comparisons
-			//	   always operate on the last segment actually run by this motor, regardless of how many
-			//	   segments it may have been inactive in between.
-
-			// Apply accumulator correction if the time base has changed since previous segment
-			if (st_pre.mot[MOTOR_1].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_1].accumulator_correction_flag = false;
-				st_run.mot[MOTOR_1].substep_accumulator *= st_pre.mot[MOTOR_1].accumulator_correction;
-			}
-
-			// Detect direction change and if so:
-			//	- Set the direction bit in hardware.
-			//	- Compensate for direction change by flipping substep accumulator value about its midpoint.
-
-			if (st_pre.mot[MOTOR_1].direction != st_pre.mot[MOTOR_1].prev_direction) {
-				st_pre.mot[MOTOR_1].prev_direction = st_pre.mot[MOTOR_1].direction;
-				st_run.mot[MOTOR_1].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_1].substep_accumulator);
-                motor_1.setDirection(st_pre.mot[MOTOR_1].direction);
-			}
+		st_run.dda_ticks_downcount = p->dda_ticks;
+		st_run.dda_ticks_X_substeps = p->dda_ticks_X_substeps;
+#ifdef DDA_RESCALE_SUBSTEPS
+		if (p->dda_divisor != st_run.dda_divisor) {		// the timer is stopped here, so it's safe to change
+			st_run.dda_divisor = p->dda_divisor;
+			dda_timer.setTop(dda_top * p->dda_divisor);
+			dda_timer.setExactDutyCycleA(dda_top * (p->dda_divisor - 1) + dda_match); // same pulse width
+		}
+#endif
 
-			// Enable the stepper and start motor power management
-			motor_1.enable();								// enable the motor (clear the ~Enable line)
-			st_run.mot[MOTOR_1].power_state = MOTOR_RUNNING;
-			SET_ENCODER_STEP_SIGN(MOTOR_1, st_pre.mot[MOTOR_1].step_sign);
+		bool direction_change = false;                  // direction lines are written together below
 
-		} else {  // Motor has 0 steps; might need to energize motor for power mode processing
-			if (st_cfg.mot[MOTOR_1].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
-				motor_1.enable();									// energize motor
-				st_run.mot[MOTOR_1].power_state = MOTOR_POWER_TIMEOUT_START;
-			}
-		}
-		// accumulate counted steps to the step position and zero out counted steps for the segment currently being loaded
-		ACCUMULATE_ENCODER(MOTOR_1);
-
-#if (MOTORS >= 2)
-		if ((st_run.mot[MOTOR_2].substep_increment = st_pre.mot[MOTOR_2].substep_increment) != 0) {
-			if (st_pre.mot[MOTOR_2].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_2].accumulator_correction_flag = false;
-				st_run.mot[MOTOR_2].substep_accumulator *= st_pre.mot[MOTOR_2].accumulator_correction;
-			}
-			if (st_pre.mot[MOTOR_2].direction != st_pre.mot[MOTOR_2].prev_direction) {
-				st_pre.mot[MOTOR_2].prev_direction = st_pre.mot[MOTOR_2].direction;
-				st_run.mot[MOTOR_2].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_2].substep_accumulator);
-                motor_2.setDirection(st_pre.mot[MOTOR_2].direction);
+		// The motor sections are somewhat optimized for execution speed. The whole load operation
+		// is supposed to take < 10 uSec (Xmega). Be careful if you mess with this. See MotorList::load()
+		motors.load(p, direction_change);
 
-			}
-			motor_2.enable(); st_run.mot[MOTOR_2].power_state = MOTOR_RUNNING;
-			SET_ENCODER_STEP_SIGN(MOTOR_2, st_pre.mot[MOTOR_2].step_sign);
-		} else if (st_cfg.mot[MOTOR_2].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
-			motor_2.enable(); st_run.mot[MOTOR_2].power_state = MOTOR_POWER_TIMEOUT_START;
+		if (direction_change) {
+			_write_directions();						// one masked write per port
+			_hold_for_direction_setup();
 		}
-		ACCUMULATE_ENCODER(MOTOR_2);
-#endif
-#if (MOTORS >= 3)
-		if ((st_run.mot[MOTOR_3].substep_increment = st_pre.mot[MOTOR_3].substep_increment) != 0) {
-			if (st_pre.mot[MOTOR_3].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_3].accumulator_correction_flag = false;
-				st_run.mot[MOTOR_3].substep_accumulator *= st_pre.mot[MOTOR_3].accumulator_correction;
-			}
-			if (st_pre.mot[MOTOR_3].direction != st_pre.mot[MOTOR_3].prev_direction) {
-				st_pre.mot[MOTOR_3].prev_direction = st_pre.mot[MOTOR_3].direction;
-				st_run.mot[MOTOR_3].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_3].substep_accumulator);
-                motor_3.setDirection(st_pre.mot[MOTOR_3].direction);
 
+		// motors stopped by a homing latch stay still for the rest of the move
+		if (st_run.stopped_motors != 0) {
+			for (uint8_t motor = MOTOR_1; motor < MOTORS_ACTIVE; motor++) {
+				if (st_run.stopped_motors & (1 << motor)) { st_run.mot[motor].substep_increment = 0; }
 			}
-			motor_3.enable(); st_run.mot[MOTOR_3].power_state = MOTOR_RUNNING;
-			SET_ENCODER_STEP_SIGN(MOTOR_3, st_pre.mot[MOTOR_3].step_sign);
-		} else if (st_cfg.mot[MOTOR_3].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
-			motor_3.enable(); st_run.mot[MOTOR_3].power_state = MOTOR_POWER_TIMEOUT_START;
 		}
-		ACCUMULATE_ENCODER(MOTOR_3);
-#endif
-#if (MOTORS >= 4)
-		if ((st_run.mot[MOTOR_4].substep_increment = st_pre.mot[MOTOR_4].substep_increment) != 0) {
-			if (st_pre.mot[MOTOR_4].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_4].accumulator_correction_flag = false;
-				st_run.mot[MOTOR_4].substep_accumulator *= st_pre.mot[MOTOR_4].accumulator_correction;
-			}
-			if (st_pre.mot[MOTOR_4].direction != st_pre.mot[MOTOR_4].prev_direction) {
-				st_pre.mot[MOTOR_4].prev_direction = st_pre.mot[MOTOR_4].direction;
-				st_run.mot[MOTOR_4].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_4].substep_accumulator);
-                motor_4.setDirection(st_pre.mot[MOTOR_4].direction);
 
-			}
-			motor_4.enable(); st_run.mot[MOTOR_4].power_state = MOTOR_RUNNING;
-			SET_ENCODER_STEP_SIGN(MOTOR_4, st_pre.mot[MOTOR_4].step_sign);
-		} else if (st_cfg.mot[MOTOR_4].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
-			motor_4.enable(); st_run.mot[MOTOR_4].power_state = MOTOR_POWER_TIMEOUT_START;
+		// raster lines and velocity-scaled PWM (laser power) change with the segment
+		if (p->raster != RASTER_NONE) {
+			_raster_load(p->raster);
 		}
-		ACCUMULATE_ENCODER(MOTOR_4);
-#endif
-#if (MOTORS >= 5)
-		if ((st_run.mot[MOTOR_5].substep_increment = st_pre.mot[MOTOR_5].substep_increment) != 0) {
-			if (st_pre.mot[MOTOR_5].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_5].accumulator_correction_flag = false;
-				st_run.mot[MOTOR_5].substep_accumulator *= st_pre.mot[MOTOR_5].accumulator_correction;
-			}
-			if (st_pre.mot[MOTOR_5].direction != st_pre.mot[MOTOR_5].prev_direction) {
-				st_pre.mot[MOTOR_5].prev_direction = st_pre.mot[MOTOR_5].direction;
-				st_run.mot[MOTOR_5].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_5].substep_accumulator);
-                motor_5.setDirection(st_pre.mot[MOTOR_5].direction);
-
-			}
-			motor_5.enable(); st_run.mot[MOTOR_5].power_state = MOTOR_RUNNING;
-			SET_ENCODER_STEP_SIGN(MOTOR_5, st_pre.mot[MOTOR_5].step_sign);
-		} else if (st_cfg.mot[MOTOR_5].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
-			motor_5.enable(); st_run.mot[MOTOR_5].power_state = MOTOR_POWER_TIMEOUT_START;
+		if ((p->pwm_duty >= 0) && (st_run.raster_line == NULL)) {
+			pwm_set_duty(PWM_1, p->pwm_duty);
 		}
-		ACCUMULATE_ENCODER(MOTOR_5);
-#endif
-#if (MOTORS >= 6)
-		if ((st_run.mot[MOTOR_6].substep_increment = st_pre.mot[MOTOR_6].substep_increment) != 0) {
-			if (st_pre.mot[MOTOR_6].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_6].accumulator_correction_flag = false;
-				st_run.mot[MOTOR_6].substep_accumulator *= st_pre.mot[MOTOR_6].accumulator_correction;
-			}
-			if (st_pre.mot[MOTOR_6].direction != st_pre.mot[MOTOR_6].prev_direction) {
-				st_pre.mot[MOTOR_6].prev_direction = st_pre.mot[MOTOR_6].direction;
-				st_run.mot[MOTOR_6].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_6].substep_accumulator);
-                motor_6.setDirection(st_pre.mot[MOTOR_6].direction);
-
-			}
-			motor_6.enable(); st_run.mot[MOTOR_6].power_state = MOTOR_RUNNING;
-			SET_ENCODER_STEP_SIGN(MOTOR_6, st_pre.mot[MOTOR_6].step_sign);
-		} else if (st_cfg.mot[MOTOR_6].power_mode == MOTOR_POWERED_ONLY_WHEN_MOVING) {
-			motor_6.enable(); st_run.mot[MOTOR_6].power_state = MOTOR_POWER_TIMEOUT_START;
+#ifdef __MOTION_OUTPUTS
+		st_run.output_events = p->output_events;		// events on the first tick switch now
+		st_run.output_next = 0;
+		for (uint8_t i=0; i<p->output_events; i++) {
+			st_run.output[i] = p->output[i];
 		}
-		ACCUMULATE_ENCODER(MOTOR_6);
+		_output_events();
 #endif
 
 		//**** do this last ****
 
-		dda_timer.start();									// start the DDA timer if not already running
+		if (cs.network_mode == NETWORK_SLAVE) {
+			_sync_start();									// start on the master's sync edge
+		} else {
+			dda_timer.start();								// start the DDA timer if not already running
+			if (cs.network_mode == NETWORK_MASTER) {
+				sync_pin.toggle();							// every edge is a segment start
+			}
+		}
 
 	// handle dwells
-	} else if (st_pre.move_type == MOVE_TYPE_DWELL) {
-		st_run.dda_ticks_downcount = st_pre.dda_ticks;
+	} else if (p->move_type == MOVE_TYPE_DWELL) {
+		st_run.dda_ticks_downcount = p->dda_ticks;
 		dwell_timer.start();
 
 	// handle synchronous commands
-	} else if (st_pre.move_type == MOVE_TYPE_COMMAND) {
-		mp_runtime_command(st_pre.bf);
+	} else if (p->move_type == MOVE_TYPE_COMMAND) {
+		if (p->bf == NULL) {
+			// pass-through - the planner buffer is already gone and the next segment is
+			// (normally) prepped, so load it right away to keep the motion going
+			p->cm_func(p->value_vector, p->flag_vector);
+			p->move_type = MOVE_TYPE_NULL;
+			_free_load_buffer();
+			st_request_exec_move();
+			ISR_PROFILE_END(ISR_PROFILE_LOAD);
+			_load_move();
+			return;
+		}
+		mp_runtime_command(p->bf);
 
 	} // else null - WARNING - We cannot printf from here!! Causes crashes.
 
 	// all other cases drop to here (e.g. Null moves after Mcodes skip to here)
-	st_pre.move_type = MOVE_TYPE_NULL;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;	// we are done with the prep buffer - flip the flag back
+	p->move_type = MOVE_TYPE_NULL;
+	_free_load_buffer();								// we are done with the prep buffer - hand it back to exec
+	if (!st_runtime_isbusy()) {
+		controller_wake(DEADLINE_MOTOR_POWER);			// may be the end of motion - see st_motor_power_callback()
+	}
 	st_request_exec_move();								// exec and prep next move
+	ISR_PROFILE_END(ISR_PROFILE_LOAD);
 }
 #endif // __ARM
 
+/*
+ * _microstep_morph() - microstep shift for a segment running at steps_per_sec (native microsteps)
+ *
+ *	Halves the microsteps each time the physical step rate would pass $msr, and doubles them
+ *	again below MICROSTEP_MORPH_HYSTERESIS of the rate that halved them. See stepper.h.
+ */
+#ifdef __MICROSTEP_MORPH
+static uint8_t _microstep_morph(const uint8_t motor, const float steps_per_sec)
+{
+	uint8_t shift = st_pre.mot[motor].microstep_shift;
+	while ((shift < st_cfg.mot[motor].morph_shift_max) && (steps_per_sec > st_cfg.morph_rate * (1 << shift))) {
+		shift++;
+	}
+	while ((shift > 0) && (steps_per_sec < st_cfg.morph_rate * MICROSTEP_MORPH_HYSTERESIS * (1 << (shift-1)))) {
+		shift--;
+	}
+	if (shift > st_cfg.mot[motor].morph_shift_max) {		// $1mm or $1mi changed
+		shift = st_cfg.mot[motor].morph_shift_max;
+	}
+	return (st_pre.mot[motor].microstep_shift = shift);
+}
+#endif
+
 /***********************************************************************************
  * st_prep_line() - Prepare the next move for the loader
  *
@@ -993,6 +1746,9 @@ static void _load_move()
  *		floats that typically have fractional values (fractional steps). The sign
  *		indicates direction. Motors that are not in the move should be 0 steps on input.
  *
+ *	  - target_steps[] is the commanded position in steps at the end of the segment. It travels
+ *		with the segment so the encoder can align to it when the segment is loaded.
+ *
  *	  - following_error[] is a vector of measured errors to the step count. Used for correction.
  *
  *	  - segment_time - how many minutes the segment should run. If timing is not
@@ -1003,15 +1759,18 @@ static void _load_move()
  *		    dda_ticks_X_substeps = (int32_t)((microseconds/1000000) * f_dda * dda_substeps);
  */
 
-stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time)
+RAMFUNC stat_t st_prep_line(float travel_steps[], float target_steps[], float following_error[], float segment_time)
 {
+	PROFILE_PIN_SCOPE(PREP);
+	stPrepBuffer_t *p = _get_prep_buffer();
+
 	// trap assertion failures and other conditions that would prevent queuing the line
-	if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_EXEC) {     // never supposed to happen
-        return (cm_panic(STAT_INTERNAL_ERROR, "prep sync"));
+	if (_prep_buffer_is_full()) {                               // never supposed to happen
+        return (rpt_post_panic(STAT_INTERNAL_ERROR, "prep sync", 0));
 	} else if (isinf(segment_time)) {                           // never supposed to happen
-        return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_INFINITE, "prep isinf"));
+        return (rpt_post_panic(STAT_PREP_LINE_MOVE_TIME_IS_INFINITE, "prep isinf", 0));
 	} else if (isnan(segment_time)) {                           // never supposed to happen
-        return (cm_panic(STAT_PREP_LINE_MOVE_TIME_IS_NAN, "prep isnan"));
+        return (rpt_post_panic(STAT_PREP_LINE_MOVE_TIME_IS_NAN, "prep isnan", 0));
 	} else if (segment_time < EPSILON) {
         return (STAT_MINIMUM_TIME_MOVE);
 	}
@@ -1019,72 +1778,100 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 	// - dda_ticks is the integer number of DDA clock ticks needed to play out the segment
 	// - ticks_X_substeps is the maximum depth of the DDA accumulator (as a negative number)
 
-	st_pre.dda_period = _f_to_period(FREQUENCY_DDA);                // FYI: this is a constant
-	st_pre.dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA);// NB: converts minutes to seconds
-	st_pre.dda_ticks_X_substeps = st_pre.dda_ticks * DDA_SUBSTEPS;
+	p->dda_period = _f_to_period(FREQUENCY_DDA);                    // FYI: this is a constant
+	p->pwm_duty = -1;                                               // see st_prep_pwm_duty()
+	p->raster = RASTER_NONE;                                        // see st_prep_raster()
+#ifdef __MOTION_OUTPUTS
+	p->output_events = 0;                                           // see st_prep_output()
+#endif
+#ifdef DDA_RESCALE_SUBSTEPS
+	float max_steps = 0;                                            // see Adaptive DDA rate in stepper.h
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		max_steps = max(max_steps, (float)fabs(travel_steps[motor]));
+	}
+	float ticks = segment_time * DDA_TICKS_PER_MINUTE;
+	uint8_t divisor = DDA_MAX_DIVISOR;
+	while ((divisor > 1) && (ticks < (divisor * DDA_OVERSAMPLE * max_steps))) {
+		divisor >>= 1;
+	}
+	p->dda_divisor = divisor;
+	p->dda_ticks = (int32_t)(ticks / divisor);                      // NB: converts minutes to ticks
+	if (p->dda_ticks == 0) {
+        return (STAT_MINIMUM_TIME_MOVE);
+	}
+#ifndef FIXED_POINT_EXEC
+	double substeps = DDA_ACCUMULATOR_DEPTH / p->dda_ticks;         // see DDA substep rescaling in stepper.h
+#endif
+	p->dda_ticks_X_substeps = DDA_ACCUMULATOR_DEPTH;
+#else
+	p->dda_ticks = (int32_t)(segment_time * DDA_TICKS_PER_MINUTE);  // NB: converts minutes to ticks
+	p->dda_ticks_X_substeps = p->dda_ticks * DDA_SUBSTEPS;
+#endif
 
 	// setup motor parameters
 
 	float correction_steps;
-	for (uint8_t motor=0; motor<MOTORS; motor++) {	// remind us that this is motors, not axes
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {	// remind us that this is motors, not axes
 
-		// Skip this motor if there are no new steps. Leave all other values intact.
-		if (fp_ZERO(travel_steps[motor])) { st_pre.mot[motor].substep_increment = 0; continue;}
+		p->mot[motor].target_steps = target_steps[motor];
 
-		// Setup the direction, compensating for polarity.
-		// Set the step_sign which is used by the stepper ISR to accumulate step position
+		// Skip this motor if there are no new steps. Leave all other values intact.
+		if (fp_ZERO(travel_steps[motor])) { p->mot[motor].substep_increment = 0; continue;}
 
-		if (travel_steps[motor] >= 0) {					// positive direction
-			st_pre.mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
-			st_pre.mot[motor].step_sign = 1;
-		} else {
-			st_pre.mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
-			st_pre.mot[motor].step_sign = -1;
+		// Back to full current if the motor is idling at reduced power. Doing it here, a few
+		// segments ahead of the load, gives the Vref filter time to settle before the first step.
+		if (st_run.mot[motor].power_level_dynamic < st_cfg.mot[motor].power_level_scaled) {
+			st_run.mot[motor].power_level_dynamic = st_cfg.mot[motor].power_level_scaled;
+			_set_motor_power_level(motor, st_run.mot[motor].power_level_dynamic);
 		}
 
-		
-		
-		// rudimentary backlash compensation
-		/*if (st_pre.mot[motor].direction != st_pre.mot[motor].prev_direction) {
-				printf("backlashing...\n");
-				printf("travel_steps = %8.5f", travel_steps[motor]);
-				// travel_steps[motor] += st_cfg.mot[motor].backlash * st_pre.mot[motor].step_sign;
-				printf(" --> %8.5f\n", travel_steps[motor]);
-				printf("segment time = %8.5f", segment_time);
-				segment_time += st_cfg.mot[motor].backlash / 900;
-				printf(" --> %8.5f\n", segment_time);
-		}*/
-		
-		
-		
-		
-
-		// Detect segment time changes and setup the accumulator correction factor and flag.
-		// Putting this here computes the correct factor even if the motor was dormant for some
-		// number of previous moves. Correction is computed based on the last segment time actually used.
-
 		// Detect segment time changes and setup the accumulator correction factor and flag.
 		// Putting this here computes the correct factor even if the motor was dormant for some
 		// number of previous moves. Correction is computed based on the last segment time actually used.
 
-		if (fabs(segment_time - st_pre.mot[motor].prev_segment_time) > 0.0000001) { // highly tuned FP != compare
+		p->mot[motor].accumulator_correction_flag = false;
+#ifndef DDA_RESCALE_SUBSTEPS											// rescaled accumulators have constant depth
+		if (fabs(segment_time - st_pre.mot[motor].prev_segment_time) > (float)0.0000001) { // highly tuned FP != compare
 			if (fp_NOT_ZERO(st_pre.mot[motor].prev_segment_time)) {					// special case to skip first move
-				st_pre.mot[motor].accumulator_correction_flag = true;
-				st_pre.mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
+				p->mot[motor].accumulator_correction_flag = true;
+#ifdef FIXED_POINT_EXEC
+				p->mot[motor].accumulator_correction = fx_q24(segment_time / st_pre.mot[motor].prev_segment_time);
+#else
+				p->mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
+#endif
 			}
 			st_pre.mot[motor].prev_segment_time = segment_time;
 		}
+#endif
 
 		// 'Nudge' correction strategy. Inject a single, scaled correction value then hold off
 		
-		// backlash compensation
-		if (st_pre.mot[motor].direction != st_pre.mot[motor].prev_direction) {
-			if (st_pre.mot[motor].step_sign == 1) {
-				st_pre.mot[motor].backlash_deviation = 0;
+		// backlash compensation and per-motor step offsets
+		// On reversal of the commanded travel the take-up is injected into the travel over as many
+		// segments as the rate limit needs. A step offset (gantry squaring) is injected the same way.
+		// backlash_deviation is the take-up and offset applied so far - the correction below holds
+		// the following error at that offset, and is held off until the injected steps have come
+		// back through the encoder (the prep buffers delay them).
+		uint8_t direction = (travel_steps[motor] >= 0) ? DIRECTION_CW : DIRECTION_CCW;
+		if (direction != st_pre.mot[motor].prev_direction) {
+			st_pre.mot[motor].prev_direction = direction;
+			if (direction == DIRECTION_CW) {
+				st_pre.mot[motor].backlash_target = 0;
 			} else {
-				st_pre.mot[motor].backlash_deviation = -st_cfg.mot[motor].backlash;
+				st_pre.mot[motor].backlash_target = -st_cfg.mot[motor].backlash;
 			}
-			//printf("backlash switch %6.3f\n", st_pre.mot[motor].backlash_deviation);
+		}
+		float takeup_steps = st_pre.mot[motor].backlash_target + st_pre.mot[motor].step_offset -
+							 st_pre.mot[motor].backlash_deviation;
+		if (fp_NOT_ZERO(takeup_steps)) {
+			if (takeup_steps > 0) {
+				takeup_steps = min(takeup_steps, BACKLASH_TAKEUP_MAX);
+			} else {
+				takeup_steps = max(takeup_steps, -BACKLASH_TAKEUP_MAX);
+			}
+			st_pre.mot[motor].backlash_deviation += takeup_steps;
+			travel_steps[motor] += takeup_steps;
+			st_pre.mot[motor].correction_holdoff = BACKLASH_CORRECTION_HOLDOFF;
 		}
 
 		//printf("s_time: %7.6f\tf_error: %5.4f \tt_steps: %7.4f", segment_time, following_error[motor], travel_steps[motor]);
@@ -1092,16 +1879,35 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
         // NOTE: This clause can be commented out to test for numerical accuracy and accumulating errors
 
 
+		// PI correction - see Step correction settings in stepper.h
+		float error_steps = following_error[motor] - st_pre.mot[motor].backlash_deviation;
+		bool outside_deadband = (fabs(error_steps) > STEP_CORRECTION_THRESHOLD);
+		if (fabs(error_steps) > st_pre.following_error_peak) {
+			st_pre.following_error_peak = fabs(error_steps);        // for stall detection
+		}
+
+		if ((st_cfg.mot[motor].following_error_max > 0) && (fabs(error_steps) > st_cfg.mot[motor].following_error_max)) {
+			if (cm.following_error_requested == 0) {
+				cm.following_error_requested = motor+1;             // the alarm is raised from the main loop
+			}
+		}
 		if ((--st_pre.mot[motor].correction_holdoff < 0) &&
-			(fabs(following_error[motor] - st_pre.mot[motor].backlash_deviation) > STEP_CORRECTION_THRESHOLD)) {
+			(outside_deadband || fp_NOT_ZERO(st_pre.mot[motor].correction_integral))) {
 
 			st_pre.mot[motor].correction_holdoff = STEP_CORRECTION_HOLDOFF;
-			correction_steps = (following_error[motor] - st_pre.mot[motor].backlash_deviation) * STEP_CORRECTION_FACTOR;
-
-			if (correction_steps > 0) {
-				correction_steps = min3(correction_steps, fabs(travel_steps[motor] * STEP_CORRECTION_JERK_INCREASE), STEP_CORRECTION_MAX);
+			float integral = st_pre.mot[motor].correction_integral;
+			if (outside_deadband) {
+				integral += error_steps * st_cfg.mot[motor].correction_ki;
+				integral = max(min(integral, STEP_CORRECTION_MAX), -STEP_CORRECTION_MAX);
+				correction_steps = error_steps * st_cfg.mot[motor].correction_kp + integral;
+			} else {
+				correction_steps = integral;
+			}
+			float correction_limit = min(fabs(travel_steps[motor] * STEP_CORRECTION_JERK_INCREASE), STEP_CORRECTION_MAX);
+			if (fabs(correction_steps) <= correction_limit) {
+				st_pre.mot[motor].correction_integral = integral;   // only integrate while the output isn't limited
 			} else {
-				correction_steps = max3(correction_steps, -fabs(travel_steps[motor] * STEP_CORRECTION_JERK_INCREASE), -STEP_CORRECTION_MAX);
+				correction_steps = copysignf(correction_limit, correction_steps);
 			}
 			st_pre.mot[motor].corrected_steps += correction_steps;
 			travel_steps[motor] -= correction_steps;
@@ -1109,16 +1915,40 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 		}
 		
 		//printf("\n");
-		
+
+		// Setup the direction from the final travel, compensating for polarity.
+		// Set the step_sign which is used by the stepper ISR to accumulate step position
+
+		if (travel_steps[motor] >= 0) {					// positive direction
+			p->mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
+			p->mot[motor].step_sign = 1;
+		} else {
+			p->mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
+			p->mot[motor].step_sign = -1;
+		}
+#ifdef __MICROSTEP_MORPH
+		p->mot[motor].microstep_shift = _microstep_morph(motor, fabs(travel_steps[motor]) / (segment_time * 60));
+#endif
+
 		// Compute substeb increment. The accumulator must be *exactly* the incoming
 		// fractional steps times the substep multiplier or positional drift will occur.
 		// Rounding is performed to eliminate a negative bias in the uint32 conversion
 		// that results in long-term negative drift. (fabs/round order doesn't matter)
 
-		st_pre.mot[motor].substep_increment = round(fabs(travel_steps[motor] * DDA_SUBSTEPS));
+#if defined(FIXED_POINT_EXEC) && defined(DDA_RESCALE_SUBSTEPS)
+		p->mot[motor].substep_increment = fx_muldiv_round(travel_steps[motor], DDA_ACCUMULATOR_DEPTH, p->dda_ticks);
+#elif defined(FIXED_POINT_EXEC)
+		p->mot[motor].substep_increment = fx_mul_round(travel_steps[motor], DDA_SUBSTEPS_Q16);
+#elif defined(DDA_RESCALE_SUBSTEPS)
+		p->mot[motor].substep_increment = round(fabs(travel_steps[motor] * substeps));
+#else
+		p->mot[motor].substep_increment = round(fabs(travel_steps[motor] * DDA_SUBSTEPS));
+#endif
 	}
-	st_pre.move_type = MOVE_TYPE_ALINE;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+#ifdef __HOST__
+	host_trace_segment(travel_steps, MOTORS, segment_time);	// simulator trace - see host.h
+#endif
+	p->move_type = MOVE_TYPE_ALINE;						// exec commits the buffer on return
 	return (STAT_OK);
 }
 
@@ -1128,8 +1958,7 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 
 void st_prep_null()
 {
-	st_pre.move_type = MOVE_TYPE_NULL;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;	// signal that prep buffer is empty
+	_get_prep_buffer()->move_type = MOVE_TYPE_NULL;
 }
 
 /*
@@ -1138,21 +1967,118 @@ void st_prep_null()
 
 void st_prep_command(void *bf)
 {
-	st_pre.move_type = MOVE_TYPE_COMMAND;
-	st_pre.bf = (mpBuf_t *)bf;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+	stPrepBuffer_t *p = _get_prep_buffer();
+	p->move_type = MOVE_TYPE_COMMAND;
+	p->bf = (mpBuf_t *)bf;
+}
+
+/*
+ * st_prep_pass_through_command() - Stage a command that runs between segments without a stop
+ *
+ *	The callback and vectors are copied so the planner buffer can be freed by the exec.
+ *	The loader runs the command when it reaches it, i.e. at the exact segment boundary.
+ */
+
+void st_prep_pass_through_command(cm_exec_t cm_func, float *value, bool *flag)
+{
+	stPrepBuffer_t *p = _get_prep_buffer();
+	p->move_type = MOVE_TYPE_COMMAND;
+	p->bf = NULL;
+	p->cm_func = cm_func;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		p->value_vector[axis] = value[axis];
+		p->flag_vector[axis] = flag[axis];
+	}
+}
+
+/*
+ * st_prep_pwm_duty() - Attach a PWM_1 duty to the line segment just prepped
+ *
+ *	Call after st_prep_line() and before the segment is committed.
+ */
+
+void st_prep_pwm_duty(float duty)
+{
+	_get_prep_buffer()->pwm_duty = duty;
 }
 
+/*
+ * st_prep_raster() - Start a raster line (or RASTER_STOP) with the line segment just prepped
+ * st_raster_stop() - End the raster line the loader is running, if any
+ */
+
+void st_prep_raster(uint8_t line)
+{
+	_get_prep_buffer()->raster = line;
+}
+
+void st_raster_stop()
+{
+	if (st_run.raster_line != NULL) {
+		_raster_end();
+	}
+}
+
+#ifdef __MOTION_OUTPUTS
+/*
+ * st_prep_output() - Switch an output a fraction (0-1) of the way through the line segment just prepped
+ *
+ *	The fraction is taken to the DDA tick, and events must come in the order they fall in.
+ */
+
+void st_prep_output(uint8_t output, bool state, float fraction)
+{
+	stPrepBuffer_t *p = _get_prep_buffer();
+	if (p->output_events >= DO_EVENTS_MAX) {                // one move carries no more than this
+		return;
+	}
+	uint32_t tick = (uint32_t)(min(max(fraction, 0.0f), 1.0f) * p->dda_ticks);
+	if (tick >= p->dda_ticks) {
+		tick = p->dda_ticks - 1;                            // the last tick that is counted down
+	}
+	stOutputEvent_t *e = &p->output[p->output_events++];
+	e->output = output;
+	e->state = state;
+	e->downcount = p->dda_ticks - tick;
+}
+#endif
+
 /*
  * st_prep_dwell() 	 - Add a dwell to the move buffer
+ * st_prep_dwell_ticks() - Add a dwell as a DDA segment with no steps
+ *
+ *	A tick dwell loads and runs the same as a line segment, so it is timed to the DDA tick
+ *	instead of the dwell timer's 1 ms and sits in the segment stream with no timer switch.
+ *	ticks must be no more than a MAX_SEGMENT_USEC segment. target_steps[] is the position
+ *	the motors are holding, for the encoders.
  */
 
 void st_prep_dwell(float microseconds)
 {
-	st_pre.move_type = MOVE_TYPE_DWELL;
-	st_pre.dda_period = _f_to_period(FREQUENCY_DWELL);
-	st_pre.dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DWELL);
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+	stPrepBuffer_t *p = _get_prep_buffer();
+	p->move_type = MOVE_TYPE_DWELL;
+	p->dda_period = _f_to_period(FREQUENCY_DWELL);
+	p->dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DWELL);
+}
+
+void st_prep_dwell_ticks(uint32_t ticks, float target_steps[])
+{
+	stPrepBuffer_t *p = _get_prep_buffer();
+	p->dda_period = _f_to_period(FREQUENCY_DDA);
+	p->pwm_duty = -1;
+	p->raster = RASTER_NONE;
+	p->dda_ticks = ticks;
+#ifdef DDA_RESCALE_SUBSTEPS
+	p->dda_divisor = 1;											// exact ticks
+	p->dda_ticks_X_substeps = DDA_ACCUMULATOR_DEPTH;
+#else
+	p->dda_ticks_X_substeps = ticks * DDA_SUBSTEPS;
+#endif
+	for (uint8_t motor=0; motor<MOTORS_ACTIVE; motor++) {
+		p->mot[motor].target_steps = target_steps[motor];
+		p->mot[motor].substep_increment = 0;
+	}
+	p->move_type = MOVE_TYPE_ALINE;
 }
 
 /*
@@ -1162,25 +2088,62 @@ void st_prep_dwell(float microseconds)
  */
 void st_request_out_of_band_dwell(float microseconds)
 {
+	if (_prep_buffer_is_full()) { return;}
 	st_prep_dwell(microseconds);
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+	_commit_prep_buffer();								// signal that prep buffer is ready
 	st_request_load_move();
 }
 
+/*
+ * st_set_step_offset() - offset one motor from its commanded position
+ * st_get_step_offset() - return the offset of one motor
+ *
+ *	The offset is absolute, in steps. It is not a move - the difference from the offset
+ *	already applied is injected into the motor's travel by st_prep_line() at the backlash
+ *	take-up rate whenever that motor moves. Used to square a gantry driven by slaved motors.
+ */
+void st_set_step_offset(uint8_t motor, float steps) { st_pre.mot[motor].step_offset = steps;}
+float st_get_step_offset(uint8_t motor) { return (st_pre.mot[motor].step_offset);}
+
+/*
+ * st_get_following_error_peak() - largest following error of any motor since the last call
+ *
+ *	In steps, with backlash take-up discounted. Reading it starts a new peak.
+ */
+
+float st_get_following_error_peak()
+{
+	float peak = st_pre.following_error_peak;
+	st_pre.following_error_peak = 0;
+	return (peak);
+}
+
+/*
+ * st_stop_motors()    - stop stepping the motors in the mask (bit per motor) immediately
+ * st_release_motors() - let stopped motors step again
+ *
+ *	Called from the switch interrupt so each axis of a concurrent homing move stops on
+ *	its own switch while the rest run on. A stopped motor sends no steps - and counts
+ *	none on its encoder - until it is released, so the commanded position runs ahead of
+ *	it. The caller must resync positions (cm_set_position()) before releasing.
+ */
+void st_stop_motors(uint8_t motor_mask)
+{
+	st_run.stopped_motors |= motor_mask;
+	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+		if (motor_mask & (1 << motor)) { st_run.mot[motor].substep_increment = 0; }
+	}
+}
+
+void st_release_motors() { st_run.stopped_motors = 0;}
+
 /*
  * _set_hw_microsteps() - set microsteps in hardware
  */
 static void _set_hw_microsteps(const uint8_t motor, const uint8_t microsteps)
 {
 #ifdef __ARM
-	switch (motor) {
-		case (MOTOR_1): { motor_1.setMicrosteps(microsteps); break; }
-		case (MOTOR_2): { motor_2.setMicrosteps(microsteps); break; }
-		case (MOTOR_3): { motor_3.setMicrosteps(microsteps); break; }
-		case (MOTOR_4): { motor_4.setMicrosteps(microsteps); break; }
-		case (MOTOR_5): { motor_5.setMicrosteps(microsteps); break; }
-		case (MOTOR_6): { motor_6.setMicrosteps(microsteps); break; }
-	}
+	motors.setMicrosteps(motor, microsteps);
 #endif //__ARM
 #ifdef __AVR
 	if (microsteps == 8) {
@@ -1211,30 +2174,30 @@ static void _set_hw_microsteps(const uint8_t motor, const uint8_t microsteps)
 
 static int8_t _get_motor(const index_t index)
 {
-	char *ptr;
-	char motors[] = {"123456"};
 	char tmp[TOKEN_LEN+1];
 
 	strcpy_P(tmp, cfgArray[index].group);
-	if ((ptr = strchr(motors, tmp[0])) == NULL) {
+	int8_t motor = tmp[0] - '1';
+	if ((motor < 0) || (motor >= MOTORS)) {
 		return (-1);
 	}
-	return (ptr - motors);
+	return (motor);
 }
 
 /*
  * _set_motor_steps_per_unit() - what it says
- * This function will need to be rethought if microstep morphing is implemented
+ * steps_per_unit stays at the configured $Nmi - microstep morphing scales the substep increment instead
  */
 
-static void _set_motor_steps_per_unit(nvObj_t *nv)
+static void _set_motor_steps_per_unit(const uint8_t m)
 {
-	uint8_t m = _get_motor(nv->index);
 	st_cfg.mot[m].units_per_step = (st_cfg.mot[m].travel_rev * st_cfg.mot[m].step_angle) / (360 * st_cfg.mot[m].microsteps);
 	st_cfg.mot[m].steps_per_unit = 1/st_cfg.mot[m].units_per_step;
+	kn_update_motor_map();
 }
 
 /* PER-MOTOR FUNCTIONS
+ * st_set_ma() - set motor map (axis driven by the motor)
  * st_set_sa() - set motor step angle
  * st_set_tr() - set travel per motor revolution
  * st_set_mi() - set motor microsteps
@@ -1242,22 +2205,41 @@ static void _set_motor_steps_per_unit(nvObj_t *nv)
  * st_set_pl() - set motor power level
  */
 
+stat_t st_set_ma(nvObj_t *nv)			// motor map
+{
+	set_ui8(nv);
+	kn_update_motor_map();
+	return(STAT_OK);
+}
+
 stat_t st_set_sa(nvObj_t *nv)			// motor step angle
 {
+	int8_t motor = _get_motor(nv->index);
+	if (motor < 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
 	set_flt(nv);
-	_set_motor_steps_per_unit(nv);
+	_set_motor_steps_per_unit(motor);
 	return(STAT_OK);
 }
 
 stat_t st_set_tr(nvObj_t *nv)			// motor travel per revolution
 {
+	int8_t motor = _get_motor(nv->index);
+	if (motor < 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
 	set_flu(nv);
-	_set_motor_steps_per_unit(nv);
+	_set_motor_steps_per_unit(motor);
 	return(STAT_OK);
 }
 
 stat_t st_set_mi(nvObj_t *nv)			// motor microsteps
 {
+	int8_t motor = _get_motor(nv->index);
+	if (motor < 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
 	uint8_t mi = (uint8_t)nv->value;
 
 #ifdef __ARM
@@ -1268,20 +2250,76 @@ stat_t st_set_mi(nvObj_t *nv)			// motor microsteps
 		nv_add_conditional_message((const char *)"*** WARNING *** Setting non-standard microstep value");
 	}
 	set_ui8(nv);						// set it anyway, even if it's unsupported
-	_set_motor_steps_per_unit(nv);
-	_set_hw_microsteps(_get_motor(nv->index), (uint8_t)nv->value);
+	_set_motor_steps_per_unit(motor);
+	_set_hw_microsteps(motor, (uint8_t)nv->value);
+#ifdef __MICROSTEP_MORPH
+	_set_motor_morph(motor);
+#endif
+	return (STAT_OK);
+}
+
+#ifdef __MICROSTEP_MORPH
+/*
+ * _set_motor_morph() - coarsest microstep shift allowed by $1mi and $1mm
+ */
+static void _set_motor_morph(const uint8_t motor)
+{
+	uint8_t shift = 0;
+	if (st_cfg.mot[motor].morph_microsteps != 0) {
+		while ((st_cfg.mot[motor].microsteps >> (shift+1)) >= st_cfg.mot[motor].morph_microsteps) {
+			shift++;
+		}
+	}
+	st_cfg.mot[motor].morph_shift_max = shift;
+	kn_update_motor_map();					// the step rate limit goes by the coarsest microsteps
+}
+
+stat_t st_set_mm(nvObj_t *nv)			// coarsest microsteps to morph to, 0 = off
+{
+	uint8_t ms = (uint8_t)nv->value;
+	int8_t motor = _get_motor(nv->index);
+	if (motor < 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+
+	if (ms != 0) {
+		if (((ms & (ms-1)) != 0) || (ms > st_cfg.mot[motor].microsteps)) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);
+		}
+#ifdef __ARM
+		if (!motors.hasMicrostepPins(motor)) {
+			return (STAT_INPUT_VALUE_UNSUPPORTED);	// microsteps are set by jumpers
+		}
+#endif
+	}
+	set_ui8(nv);
+	_set_motor_morph(motor);
 	return (STAT_OK);
 }
 
+stat_t st_set_msr(nvObj_t *nv)			// physical step rate that halves the microsteps
+{
+	if (nv->value < 1) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	set_flt(nv);
+	return (STAT_OK);
+}
+#endif
+
 stat_t st_set_pm(nvObj_t *nv)			// motor power mode
 {
+	int8_t motor = _get_motor(nv->index);
+	if (motor < 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
 	if (nv->value >= MOTOR_POWER_MODE_MAX_VALUE) return (STAT_INPUT_VALUE_UNSUPPORTED);
 	set_ui8(nv);
 
 	if (fp_ZERO(nv->value)) {			// people asked this setting take effect immediately, hence:
-		_energize_motor(_get_motor(nv->index), st_cfg.motor_power_timeout);
+		_energize_motor(motor, st_cfg.motor_power_timeout);
 	} else {
-		_deenergize_motor(_get_motor(nv->index));
+		_deenergize_motor(motor);
 	}
 	return (STAT_OK);
 }
@@ -1296,12 +2334,12 @@ stat_t st_set_pm(nvObj_t *nv)			// motor power mode
 stat_t st_set_pl(nvObj_t *nv)	// motor power level
 {
 #ifdef __ARM
-	if ((nv->value < (float)0.0) || (nv->value > (float)1.0)) {
+	int8_t motor = _get_motor(nv->index);
+	if ((motor < 0) || (nv->value < (float)0.0) || (nv->value > (float)1.0)) {
         return (STAT_INPUT_VALUE_RANGE_ERROR);
 	}
 	set_flt(nv);	// set power_setting value in the motor config struct (st)
 
-	uint8_t motor = _get_motor(nv->index);
 	st_cfg.mot[motor].power_level_scaled = (nv->value * POWER_LEVEL_SCALE_FACTOR);
 	st_run.mot[motor].power_level_dynamic = (st_cfg.mot[motor].power_level_scaled);
 	_set_motor_power_level(motor, st_cfg.mot[motor].power_level_scaled);
@@ -1326,6 +2364,104 @@ stat_t st_set_mt(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+stat_t st_set_ipl(nvObj_t *nv)	// idle power level - applied at the next idle timeout
+{
+	if ((nv->value < (float)0.0) || (nv->value > (float)1.0)) {
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	return (set_flt(nv));
+}
+
+/*
+ * st_set_spw() - set step pulse width in microseconds
+ * st_set_dst() - set direction setup time in microseconds
+ *
+ *	The DDA ISR turns the step bits on at match A and off at the end of the period, so the
+ *	pulse width sets match A. It is limited to 75% of the undivided DDA period (the old fixed
+ *	width, used for 0) to leave the ISR its OFF time. The width in effect is stored and reported.
+ *	With DDA_RESCALE_SUBSTEPS the loader keeps the width across divisors.
+ *
+ *	A pulse plus the direction setup can be longer than one DDA period. The loader holds the
+ *	first step after a direction change for whole periods to make up the difference - see
+ *	_hold_for_direction_setup(). Neither setting busy-waits.
+ */
+stat_t st_set_spw(nvObj_t *nv)
+{
+	if (nv->value < 0) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	set_flt(nv);
+#ifdef __ARM
+	_set_dda_timing();
+	st_cfg.step_pulse_width = (dda_top - dda_match) * 1000000 / (dda_top_nominal * FREQUENCY_DDA);
+	nv->value = st_cfg.step_pulse_width;		// report the width in effect
+#endif
+	return (STAT_OK);
+}
+
+/*
+ * st_set_net() - set segment sync mode - see Segment sync
+ *
+ *	The master drives the sync pin. The slave takes it as its highest priority interrupt
+ *	and trims its DDA period. Changing modes drops any sync state, so don't do it in motion.
+ */
+stat_t st_set_net(nvObj_t *nv)
+{
+	if ((uint8_t)nv->value > NETWORK_SLAVE) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	set_ui8(nv);
+#ifdef __ARM
+	sync_pin.setInterrupts(kPinInterruptsOff);
+	st_run.sync_waiting = false;
+	st_run.sync_edges = 0;
+	if (cs.network_mode == NETWORK_MASTER) {
+		sync_pin.setMode(kOutput);
+	} else {
+		sync_pin.setMode(kInput);
+		if (cs.network_mode == NETWORK_SLAVE) {
+			sync_pin.setInterrupts(kPinInterruptOnChange | hw_pin_priority(IRQ_PRIORITY_SYNC));
+		}
+	}
+	_set_dda_timing();
+#endif
+	return (STAT_OK);
+}
+
+/*
+ * _set_dda_timing() - set the DDA period and match A from the pulse width and sync mode
+ */
+#ifdef __ARM
+static void _set_dda_timing()
+{
+	dda_top = dda_top_nominal - ((cs.network_mode == NETWORK_SLAVE) ? SYNC_SLAVE_TRIM_TICKS : 0);
+	uint32_t max_ticks = dda_top * 0.75;
+	uint32_t pulse_ticks = st_cfg.step_pulse_width * (dda_top_nominal * FREQUENCY_DDA / 1000000);
+	if ((pulse_ticks == 0) || (pulse_ticks > max_ticks)) {
+		pulse_ticks = max_ticks;
+	}
+	dda_match = dda_top - pulse_ticks;
+#ifdef DDA_RESCALE_SUBSTEPS
+	st_run.dda_divisor = 0;							// the loader sets the timer on the next segment
+#else
+	dda_timer.setTop(dda_top);
+	dda_timer.setExactDutyCycleA(dda_match);
+#endif
+}
+#endif
+
+stat_t st_set_dst(nvObj_t *nv)
+{
+	if ((nv->value < 0) || (nv->value > DIRECTION_SETUP_TIME_MAX)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	set_flt(nv);
+#ifdef __ARM
+	st_cfg.direction_setup_ticks = ceil(st_cfg.direction_setup_time * (dda_top_nominal * FREQUENCY_DDA / 1000000));
+#endif
+	return (STAT_OK);
+}
+
 stat_t st_set_md(nvObj_t *nv)	// Make sure this function is not part of initialization --> f00
 {
 	st_deenergize_motors();
@@ -1358,13 +2494,28 @@ static const char *const msg_units[] PROGMEM = { msg_units0, msg_units1, msg_uni
 static const char fmt_me[] PROGMEM = "motors energized\n";
 static const char fmt_md[] PROGMEM = "motors de-energized\n";
 static const char fmt_mt[] PROGMEM = "[mt]  motor idle timeout%14.2f seconds\n";
+static const char fmt_ipl[] PROGMEM = "[ipl] motor idle power level%10.2f [fraction of power level, power mode 4]\n";
+static const char fmt_spw[] PROGMEM = "[spw] step pulse width%15.2f uSec\n";
+static const char fmt_dst[] PROGMEM = "[dst] direction setup time%11.2f uSec\n";
+static const char fmt_msr[] PROGMEM = "[msr] microstep morph rate%12.0f steps/sec\n";
+static const char fmt_aux[] PROGMEM = "aux position:%16.3f\n";
+static const char fmt_auxq[] PROGMEM = "aux moves queued:%8d\n";
+static const char fmt_auxm[] PROGMEM = "[auxm] aux motion motor%13d [1-N, 0=off]\n";
+static const char fmt_auxv[] PROGMEM = "[auxv] aux velocity%17.2f units/min\n";
+static const char fmt_auxa[] PROGMEM = "[auxa] aux acceleration%13.2f units/sec^2\n";
+static const char fmt_net[] PROGMEM = "[net] network mode%17d [0=standalone,1=sync master,2=sync slave]\n";
 static const char fmt_0ma[] PROGMEM = "[%s%s] m%s map to axis%15d [0=X,1=Y,2=Z...]\n";
 static const char fmt_0sa[] PROGMEM = "[%s%s] m%s step angle%20.3f%s\n";
 static const char fmt_0tr[] PROGMEM = "[%s%s] m%s travel per revolution%10.4f%s\n";
 static const char fmt_0po[] PROGMEM = "[%s%s] m%s polarity%18d [0=normal,1=reverse]\n";
-static const char fmt_0pm[] PROGMEM = "[%s%s] m%s power management%10d [0=disabled,1=always on,2=in cycle,3=when moving]\n";
+static const char fmt_0pm[] PROGMEM = "[%s%s] m%s power management%10d [0=disabled,1=always on,2=in cycle,3=when moving,4=reduced when idle]\n";
 static const char fmt_0pl[] PROGMEM = "[%s%s] m%s motor power level%13.3f [0.000=minimum, 1.000=maximum]\n";
 static const char fmt_0bl[] PROGMEM = "[%s%s] m%s backlash%22.3f steps\n";
+static const char fmt_0cp[] PROGMEM = "[%s%s] m%s correction P gain%13.3f\n";
+static const char fmt_0ci[] PROGMEM = "[%s%s] m%s correction I gain%13.3f\n";
+static const char fmt_0fe[] PROGMEM = "[%s%s] m%s following error alarm%9.1f steps [0=disabled]\n";
+static const char fmt_0hi[] PROGMEM = "[%s%s] m%s homing input%14d [input 1-N or 0 to disable]\n";
+static const char fmt_0mm[] PROGMEM = "[%s%s] m%s morph microsteps%11d [coarsest microsteps at speed, 0=off]\n";
 #ifdef __AVR
     static const char fmt_0mi[] PROGMEM = "[%s%s] m%s microsteps%16d [1,2,4,8]\n";
 #else
@@ -1374,20 +2525,30 @@ static const char fmt_0bl[] PROGMEM = "[%s%s] m%s backlash%22.3f steps\n";
 void st_print_me(nvObj_t *nv) { text_print(nv, fmt_me);}    // TYPE_NULL - message only
 void st_print_md(nvObj_t *nv) { text_print(nv, fmt_md);}    // TYPE_NULL - message only
 void st_print_mt(nvObj_t *nv) { text_print(nv, fmt_mt);}    // TYPE_FLOAT
+void st_print_ipl(nvObj_t *nv) { text_print(nv, fmt_ipl);}  // TYPE_FLOAT
+void st_print_spw(nvObj_t *nv) { text_print(nv, fmt_spw);}  // TYPE_FLOAT
+void st_print_dst(nvObj_t *nv) { text_print(nv, fmt_dst);}  // TYPE_FLOAT
+void st_print_net(nvObj_t *nv) { text_print(nv, fmt_net);}  // TYPE_INT
+void st_print_msr(nvObj_t *nv) { text_print(nv, fmt_msr);}  // TYPE_FLOAT
+void st_print_aux(nvObj_t *nv) { text_print(nv, fmt_aux);}  // TYPE_FLOAT
+void st_print_auxq(nvObj_t *nv) { text_print(nv, fmt_auxq);}// TYPE_INT
+void st_print_auxm(nvObj_t *nv) { text_print(nv, fmt_auxm);}// TYPE_INT
+void st_print_auxv(nvObj_t *nv) { text_print(nv, fmt_auxv);}// TYPE_FLOAT
+void st_print_auxa(nvObj_t *nv) { text_print(nv, fmt_auxa);}// TYPE_FLOAT
 
 static void _print_motor_int(nvObj_t *nv, const char *format)
 {
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, (int)nv->value);
+	text_printf(format, nv_group(nv), nv_token(nv), nv_group(nv), (int)nv->value);
 }
 
 static void _print_motor_flt(nvObj_t *nv, const char *format)
 {
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->value);
+	text_printf(format, nv_group(nv), nv_token(nv), nv_group(nv), nv->value);
 }
 
 static void _print_motor_flt_units(nvObj_t *nv, const char *format, uint8_t units)
 {
-    fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->value, GET_TEXT_ITEM(msg_units, units));
+    text_printf(format, nv_group(nv), nv_token(nv), nv_group(nv), nv->value, GET_TEXT_ITEM(msg_units, units));
 }
 
 void st_print_ma(nvObj_t *nv) { _print_motor_int(nv, fmt_0ma);}
@@ -1398,5 +2559,10 @@ void st_print_po(nvObj_t *nv) { _print_motor_int(nv, fmt_0po);}
 void st_print_pm(nvObj_t *nv) { _print_motor_int(nv, fmt_0pm);}
 void st_print_pl(nvObj_t *nv) { _print_motor_flt(nv, fmt_0pl);}
 void st_print_bl(nvObj_t *nv) { _print_motor_flt(nv, fmt_0bl);}
+void st_print_cp(nvObj_t *nv) { _print_motor_flt(nv, fmt_0cp);}
+void st_print_ci(nvObj_t *nv) { _print_motor_flt(nv, fmt_0ci);}
+void st_print_fe(nvObj_t *nv) { _print_motor_flt(nv, fmt_0fe);}
+void st_print_hi(nvObj_t *nv) { _print_motor_int(nv, fmt_0hi);}
+void st_print_mm(nvObj_t *nv) { _print_motor_int(nv, fmt_0mm);}
 
 #endif // __TEXT_MODE
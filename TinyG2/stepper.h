@@ -219,7 +219,8 @@
  *		be needed to run the move - in this example st_prep_line().
  *
  *	 7	st_prep_line() generates the timer and DDA values and stages these into
- *		the prep structure (sp) - ready for loading into the stepper runtime struct
+ *		the next free prep buffer - ready for loading into the stepper runtime struct.
+ *		Exec keeps running ahead until the prep buffer ring is full.
  *
  *	 8	stepper.st_prep_line() returns back to planner.mp_exec_move(), which
  *		frees the planning buffer (bf) back to the planner buffer pool if the
@@ -258,13 +259,34 @@
  *********************************/
 //See hardware.h for platform specific stepper definitions
 
-typedef enum {
-	PREP_BUFFER_OWNED_BY_LOADER = 0,	// staging buffer is ready for load
-	PREP_BUFFER_OWNED_BY_EXEC			// staging buffer is being loaded
-} prepBufferState;
+/* Prep buffer ring
+ *
+ *	Exec/prep can run up to PREP_BUFFER_SIZE segments ahead of the loader. This absorbs
+ *	jitter in when the exec interrupt gets to run (e.g. long main loop or USB bursts)
+ *	without starving the loader. It's a single producer / single consumer ring: the
+ *	buffer_in count is only written by exec (or out-of-band dwells when exec isn't running)
+ *	and buffer_out is only written by the loader. Must be a power of 2.
+ *
+ *	Deeper rings add latency to feedholds, as segments already prepped still run out.
+ *
+ *	Each exec interrupt runs up to EXEC_BATCH_SEGMENTS segments back to back while the ring
+ *	has room, so the interrupt entry, the request and the mp_exec_move() dispatch are paid
+ *	once per batch rather than once per segment. Re-requesting exec from inside the interrupt
+ *	already kept lower priority interrupts out until the ring was full, so batching doesn't
+ *	change what else gets to run - only the overhead. See _exec_segments().
+ */
+#ifndef PREP_BUFFER_SIZE
+#define PREP_BUFFER_SIZE 4
+#endif
+#if ((PREP_BUFFER_SIZE & (PREP_BUFFER_SIZE-1)) != 0)
+#error PREP_BUFFER_SIZE must be a power of 2
+#endif
+#ifndef EXEC_BATCH_SEGMENTS
+#define EXEC_BATCH_SEGMENTS PREP_BUFFER_SIZE	// segments exec'd per exec interrupt, at most
+#endif
 
-// Currently there is no distinction between IDLE and OFF (DEENERGIZED)
-// In the future IDLE will be powered at a low, torque-maintaining current
+// IDLE is the same as OFF (DEENERGIZED) except in MOTOR_POWER_REDUCED_WHEN_IDLE mode. There the
+// motor stays energized at a low, torque-maintaining current ({ipl:} of its power level)
 
 typedef enum {					        // used w/start and stop flags to sequence motor power
 	MOTOR_OFF = 0,						// motor is stopped and deenergized
@@ -279,7 +301,7 @@ typedef enum {
 	MOTOR_ALWAYS_POWERED,				// motor is always powered while machine is ON
 	MOTOR_POWERED_IN_CYCLE,				// motor fully powered during cycles, de-powered out of cycle
 	MOTOR_POWERED_ONLY_WHEN_MOVING,		// motor only powered while moving - idles shortly after it's stopped - even in cycle
-//	MOTOR_POWER_REDUCED_WHEN_IDLE,		// enable Vref current reduction for idle (FUTURE)
+	MOTOR_POWER_REDUCED_WHEN_IDLE,		// motor fully powered while moving, at the idle power level after the timeout
 //	MOTOR_ADAPTIVE_POWER				// adjust motor current with velocity (FUTURE)
 	MOTOR_POWER_MODE_MAX_VALUE			// for input range checking
 } stPowerMode;
@@ -294,6 +316,11 @@ typedef enum {
 #define MOTOR_TIMEOUT_SECONDS_MAX	(float)4294967	// (4294967295/1000) -- for conversion to uint32_t
 #define MOTOR_TIMEOUT_SECONDS 		(float)0.25		// seconds in DISABLE_AXIS_WHEN_IDLE & _ONLY_WHEN_MOVING modes
 
+#define DIRECTION_SETUP_TIME_MAX	(float)1000		// microseconds - longest {dst:} accepted
+
+#define SYNC_SLAVE_TRIM_TICKS		1				// a sync slave's DDA period is this much shorter - see st_set_net()
+#define SYNC_EDGES_MAX				8				// sync edges a slave counts ahead of its segments
+
 // Step generation constants
 #define STEP_INITIAL_DIRECTION		DIRECTION_CW
 
@@ -310,29 +337,114 @@ typedef enum {
  *
  *		MAX_LONG == 2^31, maximum signed long (depth of accumulator. NB: accumulator values are negative)
  *		FREQUENCY_DDA == DDA clock rate in Hz.
- *		NOM_SEGMENT_TIME == upper bound of segment time in minutes
+ *		MAX_SEGMENT_TIME == upper bound of segment time in minutes
  *		0.90 == a safety factor used to reduce the result from theoretical maximum
  *
  *	The number is about 8.5 million for the Xmega running a 50 KHz DDA with 5 millisecond segments
  *	The ARM is roughly the same as the DDA clock rate is 4x higher but the segment time is ~1/5
  *  Decreasing the nominal segment time increases the number precision.
+ *
+ *	MAX_SEGMENT_TIME is the nominal segment time unless the build has __LONG_SEGMENTS, which lets
+ *	$bst run 6 ms body segments and so takes every segment down to 1/4 the substep resolution.
+ */
+#define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (MAX_SEGMENT_TIME * 60)))
+
+/* DDA substep rescaling (DDA_RESCALE_SUBSTEPS)
+ *
+ *	A fixed DDA_SUBSTEPS has to allow for the longest segment at the DDA clock rate, so raising
+ *	FREQUENCY_DDA cuts substep resolution for every segment. With DDA_RESCALE_SUBSTEPS defined the
+ *	substep factor is instead computed per segment so that every segment fills the accumulator
+ *	to the same depth (DDA_ACCUMULATOR_DEPTH). Resolution then no longer depends on the DDA clock
+ *	or segment time, and because the depth never changes between segments the accumulator phase
+ *	carries over as-is - the accumulator correction for segment time changes is not needed.
+ *
+ *	Costs one double divide per segment in prep. Selected by the build with the DDA clock,
+ *	e.g. make DDA_FREQUENCY=400000
  */
-#define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (NOM_SEGMENT_TIME * 60)))
+#define DDA_ACCUMULATOR_DEPTH (MAX_LONG * 0.90)
+
+/* Adaptive DDA rate (with DDA_RESCALE_SUBSTEPS)
+ *
+ *	The DDA interrupt fires every tick whether or not any motor steps. In rescaled mode the
+ *	accumulator depth is the same for any tick count, so the DDA clock can be divided down per
+ *	segment without disturbing the step phase. Prep picks the largest power of 2 divisor (up to
+ *	DDA_MAX_DIVISOR) that still leaves DDA_OVERSAMPLE ticks per step for the fastest motor in
+ *	the segment, which bounds step timing jitter to 1/DDA_OVERSAMPLE of a step interval. The
+ *	loader only touches the timer when the divisor changes, and keeps the pulse width constant.
+ *	Interrupt load then follows the step rate rather than the DDA clock.
+ */
+#ifdef DDA_RESCALE_SUBSTEPS
+#ifndef DDA_MAX_DIVISOR
+#define DDA_MAX_DIVISOR 8
+#endif
+#define DDA_OVERSAMPLE ((float)8)
+#endif
+
+/* Soft-float note
+ *
+ *	The SAM3X has no FPU, and every double operation in the prep path is a software double
+ *	routine running in the EXEC interrupt. Constants used per segment are therefore folded to
+ *	float at compile time. The substep increment is the one exception: it is kept in double, as
+ *	the accumulator must be exactly the fractional steps times DDA_SUBSTEPS (see st_prep_line()).
+ *	With FIXED_POINT_EXEC it is computed exactly in integers instead, from DDA_SUBSTEPS in Q16.
+ */
+#define DDA_TICKS_PER_MINUTE ((float)(FREQUENCY_DDA * 60))
+#define DDA_SUBSTEPS_Q16 ((uint64_t)(DDA_SUBSTEPS * 65536 + 0.5))
+
+/* Step rate limit
+ *
+ *	The DDA puts out at most one step per tick, and a step on every tick leaves the driver no
+ *	margin on the pulse low time. The planner holds every motor to STEP_RATE_MAX physical steps
+ *	per second (after microstep morphing) by capping the velocity of the moves that use it - see
+ *	kn_get_step_time(). The axis $xvm and $xfr settings still apply on top of it.
+ */
+#ifndef STEP_RATE_MAX
+#define STEP_RATE_MAX ((float)(FREQUENCY_DDA / 2))
+#endif
 
 /* Step correction settings
  *
  *	Step correction settings determine how the encoder error is fed back to correct position errors.
+ *	Correction is a PI loop run once per segment, with per-motor gains ($1cp, $1ci...). The P term takes
+ *	a fraction of the error out each segment; it fixes steps lost once. The I term builds up a steady
+ *	correction rate; it fixes steps lost over and over, like a motor slipping under a constant load.
+ *	The commanded travel is already the feedforward, so there is no separate FF term.
+ *
  *	Since the following_error is running 2 segments behind the current segment you have to be careful
- *	not to overcompensate. The threshold determines if a correction should be applied, and the factor
- *	is how much. The holdoff is how many segments to wait before applying another correction. If threshold
- *	is too small and/or amount too large and/or holdoff is too small you may get a runaway correction
- *	and error will grow instead of shrink (or oscillate).
+ *	not to overcompensate. The threshold is a deadband: errors inside it are treated as encoder
+ *	quantization, so they get no P correction and are not integrated. The holdoff is how many segments
+ *	to wait before applying another correction. If threshold is too small and/or gains too large
+ *	and/or holdoff is too small you may get a runaway correction and error will grow instead of
+ *	shrink (or oscillate).
+ *
+ *	The integral is clamped to STEP_CORRECTION_MAX (anti-windup). It also stops integrating while
+ *	the correction is held to the limits below, e.g. while the motor is standing still.
+ *
+ *	A following error over the motor's $1fe limit raises an alarm. The loop can't correct it.
  */
 #define STEP_CORRECTION_THRESHOLD	(float)2.00		// magnitude of forwarding error to apply correction (in steps)
-#define STEP_CORRECTION_FACTOR		(float)0.25		// factor to apply to step correction for a single segment
 #define STEP_CORRECTION_MAX			(float)10.0		// max step correction allowed in a single segment
 #define STEP_CORRECTION_HOLDOFF		 	 	  0		// minimum number of segments to wait between error correction
-#define STEP_CORRECTION_JERK_INCREASE 	   0.25		// max amount of jerk increase during step correction
+#define STEP_CORRECTION_JERK_INCREASE (float)0.25		// max amount of jerk increase during step correction
+#define BACKLASH_TAKEUP_MAX			(float)10.0		// max backlash take-up injected in a single segment (in steps)
+#define BACKLASH_CORRECTION_HOLDOFF	(PREP_BUFFER_SIZE+1)	// segments to hold off correction after a take-up
+
+/* Microstep morphing (__MICROSTEP_MORPH)
+ *
+ *	At high step rates fine microstepping costs DDA ticks and buys nothing - the rotor can't follow
+ *	1/32 steps at 100 kHz anyway. A motor with a $1mm setting drops to coarser microsteps, halving
+ *	them each time its physical step rate passes $msr, down to $1mm at the most. It comes back with
+ *	some hysteresis. The prep picks the morph for each segment and the loader applies it.
+ *
+ *	The planner, the segment targets and the encoder all stay in native ($1mi) microsteps. Only the
+ *	DDA runs coarser: the loader shifts the substep increment down and counts each coarse step as
+ *	that many native ones. It only goes coarser when the motor sits on the coarser grid, so the
+ *	driver's microstep table stays in phase. Rounding is left to the following error correction,
+ *	so set $1fe above one coarse step. Raster lines always run at native microsteps.
+ *
+ *	Needs MS pins on the motor (not on v8 / gShield, which set microsteps with jumpers).
+ */
+#define MICROSTEP_MORPH_HYSTERESIS	(float)0.75		// come back to finer microsteps below this fraction of the rate
 #define STEP_INITIAL_DIRECTION		DIRECTION_CW
 
 /*
@@ -362,6 +474,13 @@ typedef struct cfgMotor {               // per-motor configs
     stPowerMode power_mode;             // See stPowerMode for values
     float power_level;                  // set 0.000 to 1.000 for PMW vref setting
     float backlash;						// in steps
+    float correction_kp;                // following error corrected per segment (proportional gain)
+    float correction_ki;                // error added to the correction rate per segment (integral gain)
+    float following_error_max;          // following error that raises an alarm, in steps (0 = off)
+    uint8_t homing_input;               // input that latches this motor when squaring a gantry, 0 = none
+#ifdef __MICROSTEP_MORPH
+    uint8_t morph_microsteps;           // coarsest microsteps to morph to at speed, 0 = off
+#endif
     float step_angle;                   // degrees per whole step (ex: 1.8)
     float travel_rev;                   // mm or deg of travel per motor revolution
     float steps_per_unit;               // microsteps per mm (or degree) of travel
@@ -369,11 +488,23 @@ typedef struct cfgMotor {               // per-motor configs
 
     // private
     float power_level_scaled;           // scaled to internal range - must be between 0 and 1
+#ifdef __MICROSTEP_MORPH
+    uint8_t morph_shift_max;            // log2(microsteps / morph_microsteps), 0 if morphing is off
+#endif
 } cfgMotor_t;
 
 typedef struct stConfig {               // stepper configs
     float motor_power_timeout;          // seconds before setting motors to idle current (currently this is OFF)
+    float idle_power_factor;            // fraction of the power level held by idle motors in MOTOR_POWER_REDUCED_WHEN_IDLE
+    float step_pulse_width;             // step pulse width in microseconds, 0 = longest the DDA clock allows
+    float direction_setup_time;         // minimum microseconds from a direction change to the next step
+#ifdef __MICROSTEP_MORPH
+    float morph_rate;                   // physical steps per second that halve the microsteps of a morphing motor
+#endif
     cfgMotor_t mot[MOTORS];             // settings for motors 1-N
+
+    // private
+    uint32_t direction_setup_ticks;     // direction_setup_time in undivided DDA timer ticks
 } stConfig_t;
 
 // Motor runtime structure. Used exclusively by step generation ISR (HI)
@@ -381,59 +512,196 @@ typedef struct stConfig {               // stepper configs
 typedef struct stRunMotor {             // one per controlled motor
     uint32_t substep_increment;         // total steps in axis times substeps factor
     int32_t substep_accumulator;        // DDA phase angle accumulator
+    uint8_t direction;                  // direction currently set on the driver
+#ifdef __MICROSTEP_MORPH
+    uint8_t microstep_shift;            // log2 of native microsteps per step currently set on the driver
+    uint8_t microstep_phase;            // native microstep position (mod 256) - says when the coarser grid is reached
+#endif
     stPowerState power_state;           // state machine for managing motor power
     uint32_t power_systick;             // sys_tick for next motor power state transition
     float power_level_dynamic;          // power level for this segment of idle (ARM only)
 } stRunMotor_t;
 
+typedef struct stOutputEvent {          // output switched on a DDA tick - see st_prep_output()
+    uint8_t output;                     // digital output 1-N
+    bool state;                         // true = on
+    uint32_t downcount;                 // dda_ticks_downcount the output is switched at
+} stOutputEvent_t;
+
 typedef struct stRunSingleton {         // Stepper static values and axis parameters
     magic_t magic_start;               // magic number to test memory integrity
     uint32_t dda_ticks_downcount;       // tick down-counter (unscaled)
+    volatile uint16_t dda_hold;         // ticks left without steps for direction setup - see _load_move()
+    volatile bool sync_waiting;         // slave: a segment is loaded and waits for the master's sync edge
+    volatile uint8_t sync_edges;        // slave: sync edges seen ahead of the segments they start
     uint32_t dda_ticks_X_substeps;      // ticks multiplied by scaling factor
+    uint8_t dda_divisor;                // DDA clock divisor currently set on the timer (0 forces a set)
+    volatile uint8_t stopped_motors;    // motors held still while the move runs on (homing latches)
+    uint8_t raster_motor;               // motor clocking a raster line, MOTORS if none is running
+    uint16_t raster_pixel;              // power value being output
+    int32_t raster_countdown;           // steps to the next power value (16.16 fixed point)
+    struct rasterLine *raster_line;     // line being run - see pwm.h
+#ifdef __MOTION_OUTPUTS
+    uint32_t output_downcount;          // tick down-count of the next output event, 0 if none is left
+    uint8_t output_events;              // output events in the segment
+    uint8_t output_next;
+    stOutputEvent_t output[DO_EVENTS_MAX];
+#endif
     stRunMotor_t mot[MOTORS];           // runtime motor structures
     magic_t magic_end;
 } stRunSingleton_t;
 
-// Motor prep structure. Used by exec/prep ISR (MED) and read-only during load
-// Must be careful about volatiles in this one
+// Motor prep structures. Written by exec/prep ISR (LO) and read-only during load
+// Must be careful about volatiles in these
 
-typedef struct stPrepMotor {
+typedef struct stPrepBufferMotor {          // per-segment values handed to the loader
     uint32_t substep_increment;             // total steps in axis times substep factor
-
-    // direction and direction change
     uint8_t direction;                      // travel direction corrected for polarity (CW==0. CCW==1)
-    uint8_t prev_direction;                 // travel direction from previous segment run for this motor
     int8_t step_sign;                       // set to +1 or -1 for encoders
+#ifdef __MICROSTEP_MORPH
+    uint8_t microstep_shift;                // morph requested for the segment - the loader may not get there yet
+#endif
+    uint8_t accumulator_correction_flag;    // signals accumulator needs correction
+#ifdef FIXED_POINT_EXEC
+    int32_t accumulator_correction;         // factor for adjusting accumulator between segments (Q8.24 - see fx_scale())
+#else
+    float accumulator_correction;           // factor for adjusting accumulator between segments
+#endif
+    float target_steps;                     // commanded position at the end of the segment (for encoder)
+} stPrepBufferMotor_t;
+
+typedef struct stPrepBuffer {               // one prepped segment
+    moveType move_type;                     // move type (requires planner.h)
+    struct mpBuffer *bf;                    // static pointer to relevant buffer (NULL for pass-through commands)
+    cm_exec_t cm_func;                      // pass-through command callback and its vectors
+    float value_vector[AXES];
+    bool flag_vector[AXES];
+    uint16_t dda_period;                    // DDA or dwell clock period setting
+    uint32_t dda_ticks;                     // DDA or dwell ticks for the move
+    uint32_t dda_ticks_X_substeps;          // DDA ticks scaled by substep factor
+    uint8_t dda_divisor;                    // DDA clock divisor for the segment (adaptive DDA rate)
+    float pwm_duty;                         // PWM_1 duty to set as the segment loads, < 0 for no change
+    uint8_t raster;                         // raster line to start with the segment, RASTER_STOP or RASTER_NONE
+#ifdef __MOTION_OUTPUTS
+    uint8_t output_events;                  // outputs to switch during the segment - see st_prep_output()
+    stOutputEvent_t output[DO_EVENTS_MAX];
+#endif
+    stPrepBufferMotor_t mot[MOTORS];
+} stPrepBuffer_t;
+
+typedef struct stPrepMotor {                // prep state that persists across segments (exec only)
+    uint8_t prev_direction;                 // commanded travel direction from previous segment prepped for this motor
+#ifdef __MICROSTEP_MORPH
+    uint8_t microstep_shift;                // morph requested for the previous segment (for hysteresis)
+#endif
 
     // following error correction
     int32_t correction_holdoff;             // count down segments between corrections
     float corrected_steps;                  // accumulated correction steps for the cycle (for diagnostic display only)
+    float correction_integral;              // integral term of the correction, in steps per segment
 
     // accumulator phase correction
-    float prev_segment_time;                // segment time from previous segment run for this motor
-    float accumulator_correction;           // factor for adjusting accumulator between segments
-    uint8_t accumulator_correction_flag;    // signals accumulator needs correction
+    float prev_segment_time;                // segment time from previous segment prepped for this motor
     
     //backlash_compensation
-    float backlash_deviation;				// desired amount of following error due to backlash
+    float backlash_target;					// backlash offset for the current direction (0 or -backlash)
+    float backlash_deviation;				// desired amount of following error due to backlash taken up so far
+    float step_offset;                      // motor offset from the commanded position (gantry squaring)
 } stPrepMotor_t;
 
 typedef struct stPrepSingleton {
     magic_t magic_start;                   // magic number to test memory integrity
-    volatile prepBufferState buffer_state;  // prep buffer state - owned by exec or loader
-    struct mpBuffer *bf;                    // static pointer to relevant buffer
-    moveType move_type;                     // move type (requires planner.h)
-
-    uint16_t dda_period;                    // DDA or dwell clock period setting
-    uint32_t dda_ticks;                     // DDA or dwell ticks for the move
-    uint32_t dda_ticks_X_substeps;          // DDA ticks scaled by substep factor
+    volatile uint8_t buffer_in;             // count of buffers prepped - written by exec
+    volatile uint8_t buffer_out;            // count of buffers loaded - written by loader
+    stPrepBuffer_t buf[PREP_BUFFER_SIZE];   // prep buffer ring
     stPrepMotor_t mot[MOTORS];              // prep time motor structs
+    volatile float following_error_peak;    // largest following error since the last stall check (steps)
     magic_t magic_end;
 } stPrepSingleton_t;
 
 extern stConfig_t st_cfg;                   // config struct is exposed. The rest are private
 extern stPrepSingleton_t st_pre;            // only used by config_app diagnostics
 
+/* Auxiliary motion channel (__AUX_MOTION)
+ *
+ *	Runs one motor ($auxm) on its own, alongside and independent of the planner - an indexer,
+ *	a conveyor, a bar feeder. {aux:n} queues an absolute move of that motor to n (in its $Nsa/$Ntr
+ *	units - mm or degrees) at $auxv, accelerating at $auxa; {aux:n} GET returns where it is. Moves
+ *	run one after the other from a short queue of their own and come to rest between them. G-code,
+ *	feedhold and queue flush don't touch it. An alarm stops it dead.
+ *
+ *	The DDA only runs while the planner has segments, so the channel has its own timer (aux_timer_num
+ *	in hardware.h). Every tick it puts out a step from a Bresenham accumulator, and every
+ *	AUX_SEGMENT_TICKS it takes the next steps of the move from the closed-form trapezoid. A step is
+ *	held high for one tick, so it steps at most every other tick - $auxv is held to that.
+ *	The motor is left out of the motor map while it's assigned, so the planner never steps it.
+ */
+#define AUX_FREQUENCY		25000			// Hz - aux timer ticks, and twice the top step rate
+#define AUX_SEGMENT_TICKS	25				// ticks per trapezoid segment (1 ms)
+#define AUX_QUEUE_SIZE		8				// queued aux moves - must be a binary multiple
+
+typedef struct stAuxMove {
+	float target;							// absolute position in the motor's units
+	float velocity;							// units per minute
+} stAuxMove_t;
+
+typedef struct stAuxSingleton {
+	uint8_t motor;							// motor run by the channel, 1-N, 0 = off ($auxm)
+	float velocity_max;						// units per minute ($auxv)
+	float acceleration;						// units per second squared ($auxa)
+
+	stAuxMove_t queue[AUX_QUEUE_SIZE];		// move ring
+	volatile uint8_t queue_in;				// moves queued - written by the main loop
+	volatile uint8_t queue_out;				// moves taken - written by the aux interrupt
+	volatile bool running;					// aux timer is running
+
+	// move runtime - aux interrupt only
+	volatile int32_t position;				// steps from power up
+	int32_t segment_target;					// steps at the end of the segment being run
+	uint32_t segment;						// segment of the move being run
+	uint8_t steps;							// steps in the segment being run
+	uint8_t accumulator;					// Bresenham error for spreading them over the ticks
+	uint8_t tick;							// ticks left in the segment
+	bool step_high;							// step line is up
+	float start;							// position at the start of the move, in steps
+	float length;							// length of the move, in steps (signed)
+	float velocity;							// steps per second, at cruise
+	float accel;							// steps per second squared
+	float accel_time;						// seconds
+	float total_time;						// seconds
+} stAux_t;
+
+// ISR profile - see stepper.cpp
+#ifndef ISR_BUDGET_DDA_US
+#define ISR_BUDGET_DDA_US		2			// DDA interrupts fire every 2.5 uSec
+#endif
+#ifndef ISR_BUDGET_DWELL_US
+#define ISR_BUDGET_DWELL_US		2
+#endif
+#ifndef ISR_BUDGET_EXEC_US
+#define ISR_BUDGET_EXEC_US		(400*EXEC_BATCH_SEGMENTS)	// exec and prep of a batch of segments
+#endif
+#ifndef ISR_BUDGET_LOAD_US
+#define ISR_BUDGET_LOAD_US		10
+#endif
+
+enum isrProfileType {
+	ISR_PROFILE_DDA = 0,
+	ISR_PROFILE_DWELL,
+	ISR_PROFILE_EXEC,
+	ISR_PROFILE_LOAD,						// _load_move(), from whichever interrupt runs it
+	ISR_PROFILE_COUNT
+};
+
+typedef struct isrProfile {					// times are in CPU cycles
+	uint32_t count;
+	uint32_t min;
+	uint32_t max;
+	uint64_t total;
+	uint32_t overruns;						// runs over budget
+	uint32_t latency;						// worst request (or timer overflow) to entry time
+} isrProfile_t;
+
 /**** FUNCTION PROTOTYPES ****/
 
 void stepper_init(void);
@@ -443,6 +711,10 @@ stat_t stepper_test_assertions(void);
 
 bool st_runtime_isbusy(void);
 stat_t st_clc(nvObj_t *nv);
+size_t st_get_run_size(void);
+#ifdef __ISR_PROFILE
+stat_t st_get_isr(nvObj_t *nv);
+#endif
 
 void st_energize_motors(float timeout_seconds);
 void st_deenergize_motors(void);
@@ -453,18 +725,51 @@ void st_request_exec_move(void);
 void st_request_load_move(void);
 void st_prep_null(void);
 void st_prep_command(void *bf);		// use a void pointer since we don't know about mpBuf_t yet)
+void st_prep_pass_through_command(cm_exec_t cm_func, float *value, bool *flag);
 void st_prep_dwell(float microseconds);
+void st_prep_dwell_ticks(uint32_t ticks, float target_steps[]);
+void st_prep_pwm_duty(float duty);
+void st_prep_raster(uint8_t line);
+#ifdef __MOTION_OUTPUTS
+void st_prep_output(uint8_t output, bool state, float fraction);
+#endif
+void st_raster_stop(void);
 void st_request_out_of_band_dwell(float microseconds);
-stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time);
-
+stat_t st_prep_line(float travel_steps[], float target_steps[], float following_error[], float segment_time);
+void st_set_step_offset(uint8_t motor, float steps);
+float st_get_step_offset(uint8_t motor);
+float st_get_following_error_peak(void);
+void st_stop_motors(uint8_t motor_mask);
+void st_release_motors(void);
+
+stat_t st_set_ma(nvObj_t *nv);
 stat_t st_set_sa(nvObj_t *nv);
 stat_t st_set_tr(nvObj_t *nv);
 stat_t st_set_mi(nvObj_t *nv);
 stat_t st_set_pm(nvObj_t *nv);
 stat_t st_set_pl(nvObj_t *nv);
 stat_t st_set_mt(nvObj_t *nv);
+stat_t st_set_ipl(nvObj_t *nv);
+stat_t st_set_spw(nvObj_t *nv);
+stat_t st_set_dst(nvObj_t *nv);
+stat_t st_set_net(nvObj_t *nv);
 stat_t st_set_md(nvObj_t *nv);
 stat_t st_set_me(nvObj_t *nv);
+#ifdef __MICROSTEP_MORPH
+stat_t st_set_mm(nvObj_t *nv);
+stat_t st_set_msr(nvObj_t *nv);
+#endif
+#ifdef __AUX_MOTION
+bool st_aux_is_motor(const uint8_t motor);
+void st_aux_stop(void);
+stat_t st_get_aux(nvObj_t *nv);
+stat_t st_set_aux(nvObj_t *nv);
+stat_t st_get_auxq(nvObj_t *nv);
+stat_t st_set_auxm(nvObj_t *nv);
+stat_t st_set_auxv(nvObj_t *nv);
+stat_t st_set_auxa(nvObj_t *nv);
+extern stAux_t st_aux;
+#endif
 
 #ifdef __TEXT_MODE
 
@@ -476,9 +781,24 @@ stat_t st_set_me(nvObj_t *nv);
 	void st_print_pm(nvObj_t *nv);
 	void st_print_pl(nvObj_t *nv);
 	void st_print_bl(nvObj_t *nv);
+	void st_print_cp(nvObj_t *nv);
+	void st_print_ci(nvObj_t *nv);
+	void st_print_fe(nvObj_t *nv);
+	void st_print_hi(nvObj_t *nv);
 	void st_print_mt(nvObj_t *nv);
+	void st_print_ipl(nvObj_t *nv);
+	void st_print_spw(nvObj_t *nv);
+	void st_print_dst(nvObj_t *nv);
+	void st_print_net(nvObj_t *nv);
 	void st_print_me(nvObj_t *nv);
 	void st_print_md(nvObj_t *nv);
+	void st_print_mm(nvObj_t *nv);
+	void st_print_msr(nvObj_t *nv);
+	void st_print_aux(nvObj_t *nv);
+	void st_print_auxq(nvObj_t *nv);
+	void st_print_auxm(nvObj_t *nv);
+	void st_print_auxv(nvObj_t *nv);
+	void st_print_auxa(nvObj_t *nv);
 
 #else
 
@@ -490,9 +810,24 @@ stat_t st_set_me(nvObj_t *nv);
 	#define st_print_pm tx_print_stub
 	#define st_print_pl tx_print_stub
 	#define st_print_bl tx_print_stub
+	#define st_print_cp tx_print_stub
+	#define st_print_ci tx_print_stub
+	#define st_print_fe tx_print_stub
+	#define st_print_hi tx_print_stub
 	#define st_print_mt tx_print_stub
+	#define st_print_ipl tx_print_stub
+	#define st_print_spw tx_print_stub
+	#define st_print_dst tx_print_stub
+	#define st_print_net tx_print_stub
 	#define st_print_me tx_print_stub
 	#define st_print_md tx_print_stub
+	#define st_print_mm tx_print_stub
+	#define st_print_msr tx_print_stub
+	#define st_print_aux tx_print_stub
+	#define st_print_auxq tx_print_stub
+	#define st_print_auxm tx_print_stub
+	#define st_print_auxv tx_print_stub
+	#define st_print_auxa tx_print_stub
 
 #endif // __TEXT_MODE
 
@@ -20,7 +20,10 @@
 #include "tinyg2.h"			// #1
 #include "config.h"			// #2
 #include "controller.h"
+#include "canonical_machine.h"
 #include "planner.h"
+#include "stepper.h"
+#include "hardware.h"
 #include "test.h"
 #include "util.h"
 #include "xio.h"
@@ -47,44 +50,252 @@
 
 #endif
 
+// benchmark programs, with the small moves and mudflap tests above
+#ifdef __PLANNER_PROFILE
+#include "gcode/gcode_braid2d.h"			// braid - thousands of very short lines (gcode_file)
+#include "gcode/gcode_zoetrope.h"			// pen drawing - short lines at one feed rate
+#endif
+
 /*
- * run_test() - system tests from FLASH invoked by $test=n command
+ * Canned programs
+ *
+ * run_test()			- $test=n runs regression test n
+ * canned_is_running()	- a program is being fed to the command dispatcher
+ * canned_readline()	- next line of the program, NULL once it's used up (ends the run at rest)
+ *
+ *	The program is read a line at a time from FLASH and fed to the command dispatcher in
+ *	place of the input channels, so it goes through the Gcode parser, the canonical machine,
+ *	the planner and the exec exactly as a streamed job would. A line is taken whenever the
+ *	planner has room for it - as fast as the parser can go. The run ends once the program
+ *	is used up and the machine has come to rest. Input from the channels waits until then.
  *
- * 	By convention the character array containing the test must have the same
- *	name as the file name.
+ *	By convention the character array containing the test has the same name as the file.
  */
+#ifdef __CANNED_PROGRAMS
+typedef struct cannedProgram {
+	uint8_t number;							// $test=n or {"bench":n}
+	const char *name;
+	const char *gcode;
+} cannedProgram_t;
+
+#ifdef __CANNED_TESTS
+static const cannedProgram_t test_program[] = {
+	{ 1, "smoke", test_smoke },
+	{ 2, "homing", test_homing },
+	{ 3, "squares", test_squares },
+	{ 4, "arcs", test_arcs },
+	{ 5, "dwell", test_dwell },
+	{ 6, "feedhold", test_feedhold },
+	{ 7, "Mcodes", test_Mcodes },
+	{ 8, "json", test_json },
+	{ 9, "inverse_time", test_inverse_time },
+	{ 10, "rotary", test_rotary },
+	{ 11, "small_moves", test_small_moves },
+	{ 12, "slow_moves", test_slow_moves },
+	{ 13, "coordinate_offsets", test_coordinate_offsets },
+	{ 14, "microsteps", test_microsteps },
+	{ 50, "mudflap", test_mudflap },
+	{ 51, "braid", test_braid }
+};
+#define TEST_PROGRAMS (sizeof(test_program)/sizeof(cannedProgram_t))
+#endif
+
+static struct cannedState {
+	bool running;							// feeding the program or waiting for the machine to rest
+	bool bench;								// the run is a benchmark - report it at the end
+	const char *next;						// next line of the program, NULL once used up
+	char line[USB_LINE_BUFFER_SIZE];		// the line being dispatched
+} canned;
+
+#ifdef __PLANNER_PROFILE
+static void _bench_end(void);
+#endif
+
+static const cannedProgram_t *_find_program(const cannedProgram_t program[], const uint8_t count, const uint8_t number)
+{
+	for (uint8_t i=0; i<count; i++) {
+		if (program[i].number == number) {
+			return (&program[i]);
+		}
+	}
+	return (NULL);
+}
+
+static void _start_program(const cannedProgram_t *program, const bool bench)
+{
+	canned.running = true;
+	canned.bench = bench;
+	canned.next = program->gcode;
+}
+
+bool canned_is_running()
+{
+	return (canned.running);
+}
+
+char *canned_readline()
+{
+	if (canned.next == NULL) {
+		if ((cm_get_machine_state() != MACHINE_CYCLE) &&
+			(mp_get_planner_buffers_available() == PLANNER_BUFFER_POOL_SIZE) && !st_runtime_isbusy()) {
+			canned.running = false;
+#ifdef __PLANNER_PROFILE
+			if (canned.bench) {
+				_bench_end();
+			}
+#endif
+		}
+		return (NULL);
+	}
+	const char *eol = strchr(canned.next, '\n');
+	uint16_t len = (eol == NULL) ? strlen(canned.next) : (eol - canned.next);
+	len = min(len, (uint16_t)(sizeof(canned.line)-1));
+	memcpy(canned.line, canned.next, len);
+	canned.line[len] = NUL;
+	canned.next = ((eol == NULL) || (eol[1] == NUL)) ? NULL : (eol + 1);
+	return (canned.line);
+}
+#endif // __CANNED_PROGRAMS
+
 uint8_t run_test(nvObj_t *nv)
 {
-	switch ((uint8_t)nv->value) {
-		case 0: { return (STAT_OK);}
+	if ((uint8_t)nv->value == 0) {
+		return (STAT_OK);
+	}
 #ifdef __CANNED_TESTS
+	const cannedProgram_t *program = _find_program(test_program, TEST_PROGRAMS, (uint8_t)nv->value);
+	if (program != NULL) {
+		_start_program(program, false);
+		return (STAT_OK);
+	}
+#endif
+	fprintf_P(stderr,PSTR("Test #%d not found\n"),(uint8_t)nv->value);
+	return (STAT_ERROR);
+}
+
+#ifdef __PLANNER_PROFILE
 /*
-		case 1: { xio_open(XIO_DEV_PGM, PGMFILE(&test_smoke),PGM_FLAGS); break;}
-		case 2: { xio_open(XIO_DEV_PGM, PGMFILE(&test_homing),PGM_FLAGS); break;}
-		case 3: { xio_open(XIO_DEV_PGM, PGMFILE(&test_squares),PGM_FLAGS); break;}
-		case 4: { xio_open(XIO_DEV_PGM, PGMFILE(&test_arcs),PGM_FLAGS); break;}
-		case 5: { xio_open(XIO_DEV_PGM, PGMFILE(&test_dwell),PGM_FLAGS); break;}
-		case 6: { xio_open(XIO_DEV_PGM, PGMFILE(&test_feedhold),PGM_FLAGS); break;}
-		case 7: { xio_open(XIO_DEV_PGM, PGMFILE(&test_Mcodes),PGM_FLAGS); break;}
-		case 8: { xio_open(XIO_DEV_PGM, PGMFILE(&test_json),PGM_FLAGS); break;}
-		case 9: { xio_open(XIO_DEV_PGM, PGMFILE(&test_inverse_time),PGM_FLAGS); break;}
-		case 10: { xio_open(XIO_DEV_PGM, PGMFILE(&test_rotary),PGM_FLAGS); break;}
-		case 11: { xio_open(XIO_DEV_PGM, PGMFILE(&test_small_moves),PGM_FLAGS); break;}
-		case 12: { xio_open(XIO_DEV_PGM, PGMFILE(&test_slow_moves),PGM_FLAGS); break;}
-		case 13: { xio_open(XIO_DEV_PGM, PGMFILE(&test_coordinate_offsets),PGM_FLAGS); break;}
-		case 14: { xio_open(XIO_DEV_PGM, PGMFILE(&test_microsteps),PGM_FLAGS); break;}
-		case 50: { xio_open(XIO_DEV_PGM, PGMFILE(&test_mudflap),PGM_FLAGS); break;}
-		case 51: { xio_open(XIO_DEV_PGM, PGMFILE(&test_braid),PGM_FLAGS); break;}
-*/
+ * Planner benchmark
+ *
+ * run_bench()		- {"bench":n} runs corpus program n; 0 just clears the planner profile
+ * get_bench()		- {"bench":null} prints the report for what has run since the clear
+ * bench_report()	- print the report
+ * bench_exit_report() - print it on the way out, unless the program's report covers it
+ *
+ *	The program is run as a canned program (see above), so the motors move - unless
+ *	{"bmot":0} is set, which takes the motor drivers out for the run: their power modes are
+ *	set to disabled while it runs and put back at the end. The step pulses and everything
+ *	behind them still run, so the times are the same as a real job's. Once the machine has
+ *	come to rest the report is printed:
+ *
+ *	  {"bench":{"file":"braid2d","blocks":n,"bps":n,"parse":[count,avg_us,max_us],
+ *				"aline":[...],"plan":[...],"exec":[...],"moves":n,"dips":n,"time":s,"run":s}}
+ *
+ *	bps is lines dispatched per second of CPU spent dispatching and planning them. parse is
+ *	reading and dispatching a line less the planning it set off, aline is mp_aline(), plan
+ *	mp_plan_block_list() and exec the mp_exec_move() calls that prepped a segment. time is
+ *	the job time the planner predicted for the moves run, run the time they took (simulated
+ *	time on the host build) and dips the velocity dips - see mp_profile_move_end(). Lines
+ *	streamed in while no program is running are profiled too, so any job can be measured by
+ *	clearing first; the host build prints the report as it exits for just that.
+ */
+static const cannedProgram_t bench_program[] = {
+#ifdef __CANNED_TESTS
+	{ 1, "small_moves", test_small_moves },
+	{ 2, "mudflap", test_mudflap },
 #endif
-		default: {
-			fprintf_P(stderr,PSTR("Test #%d not found\n"),(uint8_t)nv->value);
-			return (STAT_ERROR);
+	{ 3, "braid2d", gcode_file },
+	{ 4, "zoetrope", zoetrope }
+};
+#define BENCH_PROGRAMS (sizeof(bench_program)/sizeof(cannedProgram_t))
+
+uint8_t bench_motors = true;				// {"bmot":0} disables the motor drivers for the run
+
+static struct benchState {
+	const cannedProgram_t *program;			// program run since the clear, NULL if none
+	uint32_t start;							// systick of the clear
+	uint32_t end;							// systick the program came to rest, 0 until then
+	bool reported;							// the report has been printed since then
+	bool motors_off;						// the motor drivers were taken out for the run
+	stPowerMode power_mode[MOTORS];			// their power modes, to put back
+} bench;
+
+void bench_report()
+{
+	uint32_t end = (bench.end == 0) ? SysTickTimer_getValue() : bench.end;
+	uint64_t cpu_cycles = mp_prof.dispatch.total + mp_prof.plan.total;
+	const mpProfileTimer_t *timer[] = { &mp_prof.dispatch, &mp_prof.aline, &mp_prof.plan, &mp_prof.exec };
+	const char *timer_name[] = { "parse", "aline", "plan", "exec" };
+
+	printf_P(PSTR("{\"bench\":{\"file\":\"%s\",\"blocks\":%lu,\"bps\":%0.0f"),
+		(bench.program == NULL) ? "" : bench.program->name,
+		(unsigned long)mp_prof.dispatch.count, (cpu_cycles == 0) ? 0.0 : ((double)mp_prof.dispatch.count * F_CPU / cpu_cycles));
+	for (uint8_t i=0; i<4; i++) {
+		const mpProfileTimer_t *t = timer[i];
+		printf_P(PSTR(",\"%s\":[%lu,%0.2f,%0.2f]"), timer_name[i], (unsigned long)t->count,
+			(t->count == 0) ? 0.0 : ((double)t->total / t->count / HW_CYCLES_PER_US),
+			(double)t->max / HW_CYCLES_PER_US);
+	}
+	printf_P(PSTR(",\"moves\":%lu,\"dips\":%lu,\"time\":%0.3f,\"run\":%0.3f}}\n"),
+		(unsigned long)mp_prof.moves, (unsigned long)mp_prof.dips,
+		mp_prof.job_time * 60, (end - bench.start) / 1000.0);
+	bench.reported = (bench.end != 0);
+}
+
+void bench_exit_report()
+{
+	if (!bench.reported) {
+		bench_report();
+	}
+}
+
+static void _bench_end()
+{
+	if (bench.motors_off) {
+		for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+			st_cfg.mot[motor].power_mode = bench.power_mode[motor];
+		}
+		bench.motors_off = false;
+	}
+	bench.end = SysTickTimer_getValue();
+	bench_report();
+}
+
+stat_t get_bench(nvObj_t *nv)
+{
+	bench_report();
+	nv->value = (bench.program == NULL) ? 0 : bench.program->number;
+	nv->valuetype = TYPE_INT;
+	return (STAT_OK);
+}
+
+stat_t run_bench(nvObj_t *nv)
+{
+	uint8_t number = (uint8_t)nv->value;
+	const cannedProgram_t *program = _find_program(bench_program, BENCH_PROGRAMS, number);
+	if ((number != 0) && (program == NULL)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	mp_clear_profile();
+	bench.program = program;
+	bench.start = SysTickTimer_getValue();
+	bench.end = 0;
+	bench.reported = false;
+	if (program != NULL) {
+		if (!bench_motors) {
+			for (uint8_t motor=MOTOR_1; motor<MOTORS; motor++) {
+				bench.power_mode[motor] = st_cfg.mot[motor].power_mode;
+				st_cfg.mot[motor].power_mode = MOTOR_DISABLED;
+			}
+			st_deenergize_motors();
+			bench.motors_off = true;
 		}
+		_start_program(program, true);
 	}
-//	tg_set_primary_source(XIO_DEV_PGM);
+	nv->valuetype = TYPE_NULL;
 	return (STAT_OK);
 }
+#endif // __PLANNER_PROFILE
 
 /*
  * run_canned_startup() - run a string on startup
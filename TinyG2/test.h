@@ -19,7 +19,24 @@
 #ifndef test_h
 #define test_h
 
+#if defined(__CANNED_TESTS) || defined(__PLANNER_PROFILE)
+#define __CANNED_PROGRAMS                   // $test and {"bench":n} programs fed from FLASH
+#endif
+
 uint8_t run_test(nvObj_t *nv);
 void run_canned_startup(void);
 
+#ifdef __CANNED_PROGRAMS
+bool canned_is_running(void);
+char *canned_readline(void);
+#endif
+
+#ifdef __PLANNER_PROFILE
+extern uint8_t bench_motors;
+stat_t run_bench(nvObj_t *nv);
+stat_t get_bench(nvObj_t *nv);
+void bench_report(void);
+void bench_exit_report(void);
+#endif
+
 #endif	// test_h
@@ -35,6 +35,8 @@
 #include "util.h"
 #include "xio.h"					// for ASCII char definitions
 
+#include <stdarg.h>
+
 txtSingleton_t txt;					// declare the singleton for either __TEXT_MODE setting
 
 #ifndef __TEXT_MODE
@@ -114,11 +116,9 @@ static stat_t _text_parser_kernal(char *str, nvObj_t *nv)
 
 	// parse fields into the nv struct
 	nv->valuetype = TYPE_NULL;
-	if ((rd = strpbrk(str, separators)) == NULL) {	// no value part
-		strncpy(nv->token, str, TOKEN_LEN);
-	} else {
+	nv->name = str;									// the name stays in the input line
+	if ((rd = strpbrk(str, separators)) != NULL) {
 		*rd = NUL;									// terminate at end of name
-		strncpy(nv->token, str, TOKEN_LEN);
 		str = ++rd;
 		nv->value = strtof(str, &rd);				// rd used as end pointer
 		if (rd != str) {
@@ -127,18 +127,10 @@ static stat_t _text_parser_kernal(char *str, nvObj_t *nv)
 	}
 
 	// validate and post-process the token
-	if ((nv->index = nv_get_index((const char *)"", nv->token)) == NO_MATCH) { // get index or fail it
+	if ((nv->index = nv_get_index((const char *)"", nv->name)) == NO_MATCH) { // get index or fail it
 		return (STAT_UNRECOGNIZED_NAME);
 	}
-	strcpy_P(nv->group, cfgArray[nv->index].group);	// capture the group string if there is one
-
-	// see if you need to strip the token
-	if (nv->group[0] != NUL) {
-		wr = nv->token;
-		rd = nv->token + strlen(nv->group);
-		while (*rd != NUL) { *(wr)++ = *(rd)++;}
-		*wr = NUL;
-	}
+	nv_set_index(nv, nv->index, true);				// strip the group from the token if there is one
 	return (STAT_OK);
 }
 
@@ -156,16 +148,66 @@ void text_response(const stat_t status, char *buf)
 	if (cm_get_units_mode(MODEL) != INCHES) { strcpy(units, "mm"); }
 
 	if ((status == STAT_OK) || (status == STAT_EAGAIN) || (status == STAT_NOOP)) {
-		fprintf_P(stderr, prompt_ok, units);
+		text_printf(prompt_ok, units);
 	} else {
-		fprintf_P(stderr, prompt_err, units, (int)status, get_status_message(status), buf);
+		text_printf(prompt_err, units, (int)status, get_status_message(status), buf);
 	}
 	nvObj_t *nv = nv_body+1;
 
 	if (nv_get_type(nv) == NV_TYPE_MESSAGE) {
-		fprintf(stderr, (char *)*nv->stringp);
+		text_printf("%s", (char *)*nv->stringp);
+	}
+	text_printf("\n");
+	text_flush();
+}
+
+/******************************************************************************
+ * text_printf() - format into the text output buffer
+ * text_flush()	 - hand what's in the buffer to xio in a single write
+ *
+ *	Text mode output is assembled in txt.out_buf and written out a response at a time, rather
+ *	than going through stdio (locking, formatting and a write) for every line of a $ dump.
+ *	A piece that doesn't fit in what's left of the buffer flushes it first. One that's longer
+ *	than the whole buffer is cut short - the print formats are far shorter than that.
+ *
+ *	Anything written with stdio while the buffer holds something would come out ahead of it,
+ *	so the text printers all print with text_printf(), and the buffer is flushed at the end
+ *	of every response and list - see text_response() and text_print_list().
+ */
+
+void text_printf(const char *format, ...)
+{
+	va_list args;
+	uint16_t room = TEXT_OUT_BUF_LEN - txt.out_len;
+
+	va_start(args, format);
+	int len = vsnprintf(&txt.out_buf[txt.out_len], room, format, args);
+	va_end(args);
+	if (len < 0) {
+		return;
+	}
+	if ((len >= room) && (txt.out_len > 0)) {	// flush and print it again in the empty buffer
+		text_flush();
+		room = TEXT_OUT_BUF_LEN;
+		va_start(args, format);
+		len = vsnprintf(txt.out_buf, room, format, args);
+		va_end(args);
+		if (len < 0) {
+			return;
+		}
+	}
+	if (len >= room) {
+		len = room - 1;							// cut short - the rest was dropped
+	}
+	txt.out_len += len;
+}
+
+void text_flush(void)
+{
+	if (txt.out_len > 0) {
+		xio_write((const uint8_t *)txt.out_buf, txt.out_len);
+		txt.out_len = 0;
 	}
-	fprintf(stderr, "\n");
 }
 
 /***** PRINT FUNCTIONS ********************************************************
@@ -183,6 +225,7 @@ void text_print_list(stat_t status, uint8_t flags)
 		case TEXT_INLINE_VALUES: { text_print_inline_values(nv_body); break; }
 		case TEXT_MULTILINE_FORMATTED: { text_print_multiline_formatted(nv_body);}
 	}
+	text_flush();
 }
 
 void text_print_inline_pairs(nvObj_t *nv)
@@ -190,20 +233,22 @@ void text_print_inline_pairs(nvObj_t *nv)
 	uint32_t *v = (uint32_t*)&nv->value;
 	for (uint8_t i=0; i<NV_BODY_LEN-1; i++) {
 		switch ((int8_t)nv->valuetype) {  // line up ordering to agree with valueType for execution efficiency
-			case TYPE_EMPTY:    { fprintf_P(stderr,PSTR("\n")); return; }
+			case TYPE_EMPTY:    { text_printf(PSTR("\n")); return; }
 			case TYPE_PARENT:   { if ((nv = nv->nx) == NULL) return; continue;} // NULL means parent with no child
 			case TYPE_FLOAT:    { preprocess_float(nv);
 								  fntoa(global_string_buf, nv->value, nv->precision);
-								  fprintf_P(stderr,PSTR("%s:%s"), nv->token, global_string_buf) ; break;
+								  text_printf(PSTR("%s:%s"), nv_token(nv), global_string_buf) ; break;
 								}
-			case TYPE_INT:      { fprintf_P(stderr,PSTR("%s:%1.0f"), nv->token, nv->value); break;}
-			case TYPE_STRING:   { fprintf_P(stderr,PSTR("%s:%s"), nv->token, *nv->stringp); break;}
-			case TYPE_BOOL:     { fprintf_P(stderr,PSTR("%s:%1.0f"), nv->token, nv->value); break;} // print as 0 or 1, do t & f later
-			case TYPE_DATA:     { fprintf_P(stderr,PSTR("%s:%lu"), nv->token, *v); break;}
+			case TYPE_INT:      { fntoa(global_string_buf, nv->value, 0);
+								  text_printf(PSTR("%s:%s"), nv_token(nv), global_string_buf); break;
+								}
+			case TYPE_STRING:   { text_printf(PSTR("%s:%s"), nv_token(nv), *nv->stringp); break;}
+			case TYPE_BOOL:     { text_printf(PSTR("%s:%1.0f"), nv_token(nv), nv->value); break;} // print as 0 or 1, do t & f later
+			case TYPE_DATA:     { text_printf(PSTR("%s:%lu"), nv_token(nv), (unsigned long)*v); break;}
 //			case TYPE_ARRAY:    { <not implemented> ; break;}
 		}
 		if ((nv = nv->nx) == NULL) return;
-		if (nv->valuetype != TYPE_EMPTY) { fprintf_P(stderr,PSTR(","));}
+		if (nv->valuetype != TYPE_EMPTY) { text_printf(PSTR(","));}
 	}
 }
 
@@ -215,15 +260,17 @@ void text_print_inline_values(nvObj_t *nv)
 			case TYPE_PARENT:   { if ((nv = nv->nx) == NULL) return; continue;} // NULL means parent with no child
 			case TYPE_FLOAT:    { preprocess_float(nv);
 								  fntoa(global_string_buf, nv->value, nv->precision);
-								  fprintf_P(stderr,PSTR("%s"), global_string_buf) ; break;
+								  text_printf(PSTR("%s"), global_string_buf) ; break;
+								}
+			case TYPE_INT:      { fntoa(global_string_buf, nv->value, 0);
+								  text_printf(PSTR("%s"), global_string_buf); break;
 								}
-			case TYPE_INT:     { fprintf_P(stderr,PSTR("%1.0f"), nv->value); break;}
-			case TYPE_DATA:     { fprintf_P(stderr,PSTR("%lu"), *v); break;}
-			case TYPE_STRING:   { fprintf_P(stderr,PSTR("%s"), *nv->stringp); break;}
-			case TYPE_EMPTY:    { fprintf_P(stderr,PSTR("\n")); return; }
+			case TYPE_DATA:     { text_printf(PSTR("%lu"), (unsigned long)*v); break;}
+			case TYPE_STRING:   { text_printf(PSTR("%s"), *nv->stringp); break;}
+			case TYPE_EMPTY:    { text_printf(PSTR("\n")); return; }
 		}
 		if ((nv = nv->nx) == NULL) return;
-		if (nv->valuetype != TYPE_EMPTY) { fprintf_P(stderr,PSTR(","));}
+		if (nv->valuetype != TYPE_EMPTY) { text_printf(PSTR(","));}
 	}
 }
 
@@ -266,14 +313,14 @@ void tx_print(nvObj_t *nv) {
  *	NOTE: format's are passed in as flash strings (PROGMEM)
  */
 
-void text_print_nul(nvObj_t *nv, const char *format) { fprintf_P(stderr, format);}	// just print the format string
-void text_print_str(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, *nv->stringp);}
-void text_print_int(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, (uint32_t)nv->value);}
-void text_print_flt(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, nv->value);}
+void text_print_nul(nvObj_t *nv, const char *format) { text_printf(format);}	// just print the format string
+void text_print_str(nvObj_t *nv, const char *format) { text_printf(format, *nv->stringp);}
+void text_print_int(nvObj_t *nv, const char *format) { text_printf(format, (uint32_t)nv->value);}
+void text_print_flt(nvObj_t *nv, const char *format) { text_printf(format, nv->value);}
 
 void text_print_flt_units(nvObj_t *nv, const char *format, const char *units)
 {
-	fprintf_P(stderr, format, nv->value, units);
+	text_printf(format, nv->value, units);
 }
 
 void text_print(nvObj_t *nv, const char *format) {
@@ -40,10 +40,18 @@ enum textFormats {					// text output print modes
 	TEXT_MULTILINE_FORMATTED		// print formatted values on separate lines with formatted print per line
 };
 
+#ifndef TEXT_OUT_BUF_LEN
+#define TEXT_OUT_BUF_LEN 256		// text output assembled for a single write - see text_printf()
+#endif
+
 typedef struct txtSingleton {		// text mode data
 
 	char format[NV_FORMAT_LEN+1];
 	uint8_t text_verbosity;			// see enum in this file for settings
+#ifdef __TEXT_MODE
+	uint16_t out_len;				// bytes waiting in out_buf
+	char out_buf[TEXT_OUT_BUF_LEN];	// output of the response being printed
+#endif
 
 } txtSingleton_t;
 extern txtSingleton_t txt;
@@ -58,6 +66,8 @@ extern txtSingleton_t txt;
 	void text_print_inline_pairs(nvObj_t *nv);
 	void text_print_inline_values(nvObj_t *nv);
 	void text_print_multiline_formatted(nvObj_t *nv);
+	void text_printf(const char *format, ...) __attribute__ ((format (printf, 1, 2)));
+	void text_flush(void);
 
 	void tx_print(nvObj_t *nv);         // does all formats
 	void tx_print_nul(nvObj_t *nv);
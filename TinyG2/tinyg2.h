@@ -48,17 +48,57 @@
 #define TINYG_HARDWARE_VERSION_MAX (TINYG_HARDWARE_VERSION)
 
 /****** COMPILE-TIME SETTINGS ******/
+// __PRODUCTION (make PROFILE=production) leaves out text mode, the help screens, the canned
+// tests and the development settings below - JSON only. See the Makefile for what it's spent on.
 
+#ifndef __PRODUCTION
 #define __TEXT_MODE                 // enable text mode support (~14Kb) (also disables help screens)
 #define __HELP_SCREENS              // enable help screens      (~3.5Kb)
 #define __CANNED_TESTS              // enable $tests            (~12Kb)
+#endif
 #define __USER_DATA                 // enable user defined data groups
+#define __PLANNER_ARCS              // run arcs as single planner blocks, not as segmented lines
+#define __BINARY_DATA               // accept framed binary records on a data-only channel
+//#define __USART_CHANNEL           // add a hardware serial channel on USART0 (Due D18/D19 - used for motors on v9)
+//#define __USB_VENDOR              // add a vendor class bulk channel as the third USB interface (libusb/WinUSB) - see MotateUSBVendor.h
+//#define __SPI_CHANNEL             // add an SPI slave channel on SPI0 for a host coprocessor (the SPI header)
+//#define __FILE_CHANNEL            // run jobs from an SD card on SPI0 ({"run":"file.nc"}) - not with __SPI_CHANNEL
+//#define __ETHERNET_CHANNEL        // add TCP channels through a W5500 on SPI0 ($ethad, $ethpt) - not with __SPI_CHANNEL - see ethernet.cpp
+//#define __REPORT_FANOUT           // send status and watch reports to every channel that subscribes, serialized once ({sub:1}) - see xio_write_report()
+//#define __WATCHDOG                // reset on a main loop lockup and come back warm - see hw_watchdog_callback() ({"warm":n})
+//#define __INPUT_SHAPING           // shape the segment stream against machine resonance - see plan_shaper.cpp ($xist)
+//#define __PRESSURE_ADVANCE        // lead the extruder by its velocity to cut ooze and corner blobs - see _advance_segment() ($apa)
+//#define __HEIGHT_MAP              // probe a Z height map and compensate for it in the kinematics ({mshp:1}) - see kinematics.cpp
+//#define __PROBE_SCAN              // record probe contacts along ordinary moves and stream them on the data channel ({scan:1}) - see cycle_probing.cpp
+//#define __THREADING               // G33 threading and G33.1 rigid tapping locked to a spindle index input - see spindle.cpp ($diNfn=4)
+//#define __ANALOG_INPUTS           // ADC analog inputs sampled by the PDC ({ai1:n}) and adaptive feed from spindle load ($lfi)
+//#define __MOTION_OUTPUTS          // digital outputs switched along the path (M62/M63 P Q) and in queue order (M64/M65) ($do1mo)
+//#define __INPUT_FILTERS           // PIO glitch and debounce filters on the digital inputs in place of the software lockout ($di1fl)
+//#define __TORCH_HEIGHT            // plasma torch height control from arc voltage, run by the exec - see _thc_segment() ($thi) - needs __ANALOG_INPUTS
+//#define __PATH_RETRACE            // back up along the path run last from a feedhold and return on cycle start ({rtr:n}) - see plan_retrace.cpp
+//#define __ROTARY_TCP              // tool center point control for rotary tables - feeds follow the tool tip on the work, see kinematics.cpp ($kntcp)
+//#define __TANGENTIAL_KNIFE        // turn a rotary axis to follow the XY direction of feeds, lifting at sharp corners - see _tangent_knife() ($tna)
+//#define __AUX_MOTION              // independent motion channel for one motor (indexer, conveyor), queued with {aux:} - see stepper.h ($auxm)
+//#define __MICROSTEP_MORPH         // drop to coarser microsteps at high step rates on drivers with MS pins (v9) - see stepper.h ($1mm, $msr)
+//#define __LONG_SEGMENTS           // let $bst run bodies in segments of up to 6 ms - costs 4x DDA substep resolution on every segment, see stepper.h
+//#define __VELOCITY_HINTS          // take block exit velocities planned over a whole file by Tools/velocity_hints.py ($vh) - see plan_line.cpp
 
 /****** DEVELOPMENT SETTINGS ******/
 
+#ifndef __PRODUCTION
 #define __DIAGNOSTICS               // enables various debug functions
 #define __DIAGNOSTIC_PARAMETERS     // enables system diagnostic parameters (_xx) in config_app
 #define __CANNED_STARTUP            // run any canned startup moves
+#define __TASK_PROFILE              // profile main loop tasks - see controller_get_prof() ({"prof":n})
+#endif
+//#define __ISR_PROFILE             // profile the stepper interrupts - see stepper.cpp ({"isr":n})
+//#define __PROFILE_PINS            // drive debug pins from the interrupts, planner and parser - see profile_pins.h
+//#define __PLANNER_PROFILE         // profile the planner and run the benchmark corpus - see test.cpp ({"bench":n})
+//#define __JSON_BENCH              // time and fuzz the JSON parser and serializer - see json_parser.cpp ({"jbench":n})
+//#define __MOTION_TRACE            // record segments and planner decisions in a RAM ring - see planner.cpp ({"trace":n})
+//#define __LINE_TIMES              // report the executed time of each Gcode line on the data channel - see planner.cpp ({"ltim":1})
+//#define __PLANNER_STATS           // histogram achieved vs requested feed by block, and why - see plan_stats.cpp ({"pstat":n})
+//#define __STRICT_ASSERTIONS       // test every integrity assertion on every main loop pass - see _test_system_assertions()
 
 /******************************************************************************
  ***** TINYG APPLICATION DEFINITIONS ******************************************
@@ -74,10 +114,29 @@ typedef uint16_t magic_t;		        // magic number size
 
 #define AXES        6           // number of axes supported in this version
 #define HOMING_AXES 4           // number of axes that can be homed (assumes Zxyabc sequence)
-#define MOTORS      6           // number of motors on the board
+#ifndef MOTORS
+#define MOTORS      6           // number of motors on the board - up to 8, set by the build (see Makefile)
+#endif
 #define COORDS      6           // number of supported coordinate systems (1-6)
 #define PWMS        2           // number of supported PWM channels
 
+// AXES_ACTIVE and MOTORS_ACTIVE are the axes and motors the machine actually has. They bound
+// the loops in the planner, kinematics and stepper, so a machine profile (see settings.h) that
+// sets them lower, e.g. 3 and 4 for an XYZ router with a dual motor gantry, doesn't pay for 6.
+// Axes and motors above them keep their config entries but never move.
+
+#include "settings.h"
+
+#if (AXES_ACTIVE > AXES) || (MOTORS_ACTIVE > MOTORS)
+#error AXES_ACTIVE and MOTORS_ACTIVE can not exceed AXES and MOTORS
+#endif
+#if (MOTORS > 8)
+#error MOTORS can not exceed 8 - the motor enums, config groups and socket pins stop at motor 8
+#endif
+#if (AXES_ACTIVE < 3) || (MOTORS_ACTIVE < 1)
+#error AXES_ACTIVE must include X, Y and Z, and MOTORS_ACTIVE at least one motor
+#endif
+
 // Note: If you change COORDS you must adjust the entries in cfgArray table in config.c
 
 typedef enum {
@@ -104,7 +163,9 @@ typedef enum {
     MOTOR_3,
     MOTOR_4,
     MOTOR_5,
-    MOTOR_6
+    MOTOR_6,
+    MOTOR_7,
+    MOTOR_8
 } cmMotors;
 
 typedef enum {
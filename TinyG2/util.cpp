@@ -59,121 +59,14 @@ void _debug_trap() {
 
 
 /**** Vector utilities ****
- * copy_vector()			- copy vector of arbitrary length
- * vector_equal()			- test if vectors are equal
- * get_axis_vector_length()	- return the length of an axis vector
- * set_vector()				- load values into vector form
- * set_vector_by_axis()		- load a single value into a zero vector
+ * copy_vector()			- macro in util.h
+ * vector_equal()			- inline in util.h
+ * get_axis_vector_length()	- inline in util.h
+ * set_vector()				- inline in util.h
+ * set_vector_by_axis()		- inline in util.h
+ * min3/min4/max3/max4()	- inline in util.h
  */
 
-float vector[AXES];	// statically allocated global for vector utilities
-
-/*
-void copy_vector(float dst[], const float src[])
-{
-	memcpy(dst, src, sizeof(dst));
-}
-*/
-
-uint8_t vector_equal(const float a[], const float b[])
-{
-	if ((fp_EQ(a[AXIS_X], b[AXIS_X])) &&
-		(fp_EQ(a[AXIS_Y], b[AXIS_Y])) &&
-		(fp_EQ(a[AXIS_Z], b[AXIS_Z])) &&
-		(fp_EQ(a[AXIS_A], b[AXIS_A])) &&
-		(fp_EQ(a[AXIS_B], b[AXIS_B])) &&
-		(fp_EQ(a[AXIS_C], b[AXIS_C]))) {
-		return (true);
-	}
-	return (false);
-}
-
-float get_axis_vector_length(const float a[], const float b[])
-{
-	return (sqrt(square(a[AXIS_X] - b[AXIS_X]) +
-				 square(a[AXIS_Y] - b[AXIS_Y]) +
-				 square(a[AXIS_Z] - b[AXIS_Z]) +
-				 square(a[AXIS_A] - b[AXIS_A]) +
-				 square(a[AXIS_B] - b[AXIS_B]) +
-				 square(a[AXIS_C] - b[AXIS_C])));
-}
-
-float *set_vector(float x, float y, float z, float a, float b, float c)
-{
-	vector[AXIS_X] = x;
-	vector[AXIS_Y] = y;
-	vector[AXIS_Z] = z;
-	vector[AXIS_A] = a;
-	vector[AXIS_B] = b;
-	vector[AXIS_C] = c;
-	return (vector);
-}
-
-float *set_vector_by_axis(float value, uint8_t axis)
-{
-	clear_vector(vector);
-	switch (axis) {
-		case (AXIS_X): vector[AXIS_X] = value; break;
-		case (AXIS_Y): vector[AXIS_Y] = value; break;
-		case (AXIS_Z): vector[AXIS_Z] = value; break;
-		case (AXIS_A): vector[AXIS_A] = value; break;
-		case (AXIS_B): vector[AXIS_B] = value; break;
-		case (AXIS_C): vector[AXIS_C] = value;
-	}
-	return (vector);
-}
-
-/**** Math and other general purpose functions ****/
-
-/* Slightly faster (*) multi-value min and max functions
- * 	min3() - return minimum of 3 numbers
- * 	min4() - return minimum of 4 numbers
- * 	max3() - return maximum of 3 numbers
- * 	max4() - return maximum of 4 numbers
- *
- * Implementation tip: Order the min and max values from most to least likely in the calling args
- *
- * (*) Macro min4 is about 20uSec, inline function version is closer to 10 uSec (Xmega 32 MHz)
- * 	#define min3(a,b,c) (min(min(a,b),c))
- *	#define min4(a,b,c,d) (min(min(a,b),min(c,d)))
- *	#define max3(a,b,c) (max(max(a,b),c))
- *	#define max4(a,b,c,d) (max(max(a,b),max(c,d)))
- */
-
-float min3(float x1, float x2, float x3)
-{
-	float min = x1;
-	if (x2 < min) { min = x2;}
-	if (x3 < min) { return (x3);}
-	return (min);
-}
-
-float min4(float x1, float x2, float x3, float x4)
-{
-	float min = x1;
-	if (x2 < min) { min = x2;}
-	if (x3 < min) { min = x3;}
-	if (x4 < min) { return (x4);}
-	return (min);
-}
-
-float max3(float x1, float x2, float x3)
-{
-	float max = x1;
-	if (x2 > max) { max = x2;}
-	if (x3 > max) { return (x3);}
-	return (max);
-}
-
-float max4(float x1, float x2, float x3, float x4)
-{
-	float max = x1;
-	if (x2 > max) { max = x2;}
-	if (x3 > max) { max = x3;}
-	if (x4 > max) { return (x4);}
-	return (max);
-}
-
 /**** String utilities ****
  * strcpy_U() 	   - strcpy workalike to get around initial NUL for blank string - possibly wrong
  * isnumber() 	   - isdigit that also accepts plus, minus, and decimal point
@@ -234,10 +127,63 @@ const char *pstr2str(const char *pgm_string)
 }
 
 /*
- * fntoa() - return ASCII string given a float and a decimal precision value
+ * Number formatting - replacements for sprintf() on the report and response paths
+ *
+ * fntoa()		- return ASCII string given a float and a decimal precision value
+ * inttoa()		- return ASCII string for a signed integer
+ * hextoa()		- return lower case hex ASCII string for an unsigned integer (no 0x)
+ * strcpy_end() - strcpy() that returns a pointer to the terminating NUL of dst
  *
- *	Like sprintf, fntoa returns length of string, less the terminating NUL character
+ *	Like sprintf, these return the length of the string, less the terminating NUL character.
+ *	fntoa() scales and rounds to an integer and writes the digits itself, which is many times
+ *	faster than newlib's printf float conversion and needs far less stack. The output is the
+ *	same as printf's. Values too big to scale into 32 bits fall back to sprintf().
  */
+
+static const uint32_t fntoa_scale[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+
+static char _u32toa(char *str, uint32_t n, uint8_t width)	// zero pads to width
+{
+	char buf[10];
+	uint8_t len = 0;
+	do {
+		buf[len++] = '0' + (n % 10);
+		n /= 10;
+	} while (n != 0);
+	while (len < width) { buf[len++] = '0';}
+	for (uint8_t i=0; i<len; i++) { str[i] = buf[len-1-i];}
+	str[len] = 0;							// NUL
+	return (len);
+}
+
+char inttoa(char *str, int32_t n)
+{
+	if (n < 0) {
+		*str = '-';
+		return (_u32toa(str+1, -(uint32_t)n, 1) + 1);
+	}
+	return (_u32toa(str, n, 1));
+}
+
+char hextoa(char *str, uint32_t n)
+{
+	char buf[8];
+	uint8_t len = 0;
+	do {
+		buf[len++] = "0123456789abcdef"[n & 0x0F];
+		n >>= 4;
+	} while (n != 0);
+	for (uint8_t i=0; i<len; i++) { str[i] = buf[len-1-i];}
+	str[len] = 0;							// NUL
+	return (len);
+}
+
+char *strcpy_end(char *dst, const char *src)
+{
+	while ((*dst = *src++) != 0) { dst++;}		// NUL
+	return (dst);
+}
+
 char fntoa(char *str, float n, uint8_t precision)
 {
     // handle special cases
@@ -248,8 +194,24 @@ char fntoa(char *str, float n, uint8_t precision)
 	} else if (isinf(n)) {
 		strcpy(str, "inf");
 		return (3);
-
-	} else if (precision == 0 ) { return(sprintf(str, "%0.0f", (double) n));
+	}
+	if (precision > 7) { precision = 6;}		// as the "%f" this used to fall back to
+
+	double scaled = fabs((double)n) * fntoa_scale[precision];	// exact - 24 bits x at most 24 bits
+	if (scaled < 4294967295.0) {
+		uint32_t q = (uint32_t)scaled;
+		double frac = scaled - q;
+		if ((frac > 0.5) || (!(frac < 0.5) && (q & 1))) { q++;}	// round half to even, as printf does
+		char *wr = str;
+		if (signbit(n)) { *wr++ = '-';}
+		wr += _u32toa(wr, q / fntoa_scale[precision], 1);
+		if (precision != 0) {
+			*wr++ = '.';
+			wr += _u32toa(wr, q % fntoa_scale[precision], precision);
+		}
+		return (wr - str);
+	}
+	if (precision == 0 ) { return(sprintf(str, "%0.0f", (double) n));
 	} else if (precision == 1 ) { return(sprintf(str, "%0.1f", (double) n));
 	} else if (precision == 2 ) { return(sprintf(str, "%0.2f", (double) n));
 	} else if (precision == 3 ) { return(sprintf(str, "%0.3f", (double) n));
@@ -281,8 +243,30 @@ uint16_t compute_checksum(char const *string, const uint16_t length)
     return (h % HASHMASK);
 }
 
+/*
+ * compute_crc16() - CRC-16/CCITT of a byte buffer (polynomial 0x1021, initial value 0xFFFF)
+ *
+ *	Runs a nibble at a time from a 16 entry table - a fraction of the time of the bitwise
+ *	form for 32 bytes of table rather than the 512 of a byte-wide one.
+ */
+
+static const uint16_t crc16_nibble[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF };
+
+uint16_t compute_crc16(const uint8_t *data, const uint16_t length)
+{
+	uint16_t crc = 0xFFFF;
+	for (uint16_t i=0; i<length; i++) {
+		crc = (crc << 4) ^ crc16_nibble[(crc >> 12) ^ (data[i] >> 4)];
+		crc = (crc << 4) ^ crc16_nibble[(crc >> 12) ^ (data[i] & 0x0F)];
+	}
+	return (crc);
+}
+
 /*
  * SysTickTimer_getValue() - this is a hack to get around some compatibility problems
+ * SysTickTimer_getMicros() - microsecond timestamp - see Timer<SysTickTimerNum>::getMicros()
  */
 
 #ifdef __AVR
@@ -297,4 +281,9 @@ uint32_t SysTickTimer_getValue()
 {
 	return (SysTickTimer.getValue());
 }
+
+uint32_t SysTickTimer_getMicros()		// wraps after 71.6 minutes - compare differences only
+{
+	return (SysTickTimer.getMicros());
+}
 #endif // __ARM
@@ -56,22 +56,13 @@ void _debug_trap();
 
 //*** vector utilities ***
 
-extern float vector[AXES]; // vector of axes for passing to subroutines
-
 #define clear_vector(a) (memset(a,0,sizeof(a)))
 #define	copy_vector(d,s) (memcpy(d,s,sizeof(d)))
 
-float get_axis_vector_length(const float a[], const float b[]);
-uint8_t vector_equal(const float a[], const float b[]);
-float *set_vector(float x, float y, float z, float a, float b, float c);
-float *set_vector_by_axis(float value, uint8_t axis);
+// vector_equal(), get_axis_vector_length(), set_vector() and min/max are inlined below
 
 //*** math utilities ***
 
-float min3(float x1, float x2, float x3);
-float min4(float x1, float x2, float x3, float x4);
-float max3(float x1, float x2, float x3);
-float max4(float x1, float x2, float x3, float x4);
 //float std_dev(float a[], uint8_t n, float *mean);
 
 //*** string utilities ***
@@ -85,12 +76,17 @@ char *escape_string(char *dst, char *src);
 const char *pstr2str(const char *pgm_string);
 //int fntoa(char_t *str, float n, uint8_t precision);
 char fntoa(char *str, float n, uint8_t precision);
+char inttoa(char *str, int32_t n);
+char hextoa(char *str, uint32_t n);
+char *strcpy_end(char *dst, const char *src);
 uint16_t compute_checksum(char const *string, const uint16_t length);
+uint16_t compute_crc16(const uint8_t *data, const uint16_t length);
 
 //*** other utilities ***
 
 #ifdef __ARM
 uint32_t SysTickTimer_getValue(void);
+uint32_t SysTickTimer_getMicros(void);
 #endif
 
 //**** Math Support *****
@@ -136,12 +132,250 @@ inline T avg(const T a,const T b) {return (a+b)/2; }
 #define fp_TRUE(a) (a > EPSILON)			// float is interpreted as TRUE (not equal to zero)
 #endif
 
+/**** Vector and min/max helpers ****
+ *
+ *	These are called on every line in the planner and canonical machine, so they live here as
+ *	inlines rather than as calls into util.cpp. The axis loops are unrolled at compile time to
+ *	AXES_ACTIVE by the _axis_vector template, leaving straight-line code for just the axes
+ *	the machine has. set_vector() fills a caller's array - there is no shared static vector.
+ *
+ *	Implementation tip: order the min and max values from most to least likely in the args
+ */
+
+template <uint8_t N>
+struct _axis_vector {
+	static inline bool equal(const float a[], const float b[]) {
+		return (_axis_vector<N-1>::equal(a, b) && fp_EQ(a[N-1], b[N-1]));
+	}
+	static inline float length_square(const float a[], const float b[]) {
+		return (_axis_vector<N-1>::length_square(a, b) + square(a[N-1] - b[N-1]));
+	}
+};
+
+template <>
+struct _axis_vector<0> {
+	static inline bool equal(const float *, const float *) { return (true); }
+	static inline float length_square(const float *, const float *) { return (0); }
+};
+
+inline uint8_t vector_equal(const float a[], const float b[])
+{
+	return (_axis_vector<AXES_ACTIVE>::equal(a, b));
+}
+
+inline float get_axis_vector_length(const float a[], const float b[])
+{
+	return (sqrt(_axis_vector<AXES_ACTIVE>::length_square(a, b)));
+}
+
+inline float *set_vector(float v[], float x, float y, float z, float a, float b, float c)
+{
+	v[AXIS_X] = x;
+	v[AXIS_Y] = y;
+	v[AXIS_Z] = z;
+	v[AXIS_A] = a;
+	v[AXIS_B] = b;
+	v[AXIS_C] = c;
+	return (v);
+}
+
+inline float *set_vector_by_axis(float v[], float value, uint8_t axis)
+{
+	for (uint8_t i=0; i<AXES; i++) {
+		v[i] = (i == axis) ? value : 0;
+	}
+	return (v);
+}
+
+inline float min3(float x1, float x2, float x3)
+{
+	float min = x1;
+	if (x2 < min) { min = x2;}
+	if (x3 < min) { return (x3);}
+	return (min);
+}
+
+inline float min4(float x1, float x2, float x3, float x4)
+{
+	float min = x1;
+	if (x2 < min) { min = x2;}
+	if (x3 < min) { min = x3;}
+	if (x4 < min) { return (x4);}
+	return (min);
+}
+
+inline float max3(float x1, float x2, float x3)
+{
+	float max = x1;
+	if (x2 > max) { max = x2;}
+	if (x3 > max) { return (x3);}
+	return (max);
+}
+
+inline float max4(float x1, float x2, float x3, float x4)
+{
+	float max = x1;
+	if (x2 > max) { max = x2;}
+	if (x3 > max) { max = x3;}
+	if (x4 > max) { return (x4);}
+	return (max);
+}
+
+/**** Fast math ****
+ *
+ *	The planner takes several square and cube roots per block, and on the M3 each is a soft-float
+ *	library call - about 700 cycles for sqrtf, more for cbrtf. These take a seed from the float's
+ *	bits and refine it with a fixed number of Newton steps, using only multiplies and adds:
+ *
+ *	  fast_sqrt()   2 steps     relative error < 5e-6     (x * x^-1/2)
+ *	  fast_cbrt()   3 steps     relative error < 4e-7     (x * (x^-1/3)^2)
+ *	  fast_hypot()  fast_sqrt() of the sum of squares
+ *
+ *	Bounds are the worst case over 1e-6 to 1e12. Non-positive arguments return 0. Use them where
+ *	the result is a velocity - TRAPEZOID_VELOCITY_TOLERANCE is 2 mm/min or more - and keep the
+ *	library calls for lengths and positions, which are held to TRAPEZOID_LENGTH_FIT_TOLERANCE.
+ */
+
+union _float_bits {
+	float f;
+	uint32_t i;
+};
+
+inline float fast_rsqrt(const float x)
+{
+	_float_bits y;
+	y.f = x;
+	y.i = 0x5f375a86 - (y.i >> 1);
+	const float half_x = 0.5f * x;
+	y.f *= 1.5f - half_x * y.f * y.f;
+	y.f *= 1.5f - half_x * y.f * y.f;
+	return (y.f);
+}
+
+inline float fast_sqrt(const float x)
+{
+	return ((x > 0) ? x * fast_rsqrt(x) : 0);
+}
+
+inline float fast_cbrt(const float x)
+{
+	if (x <= 0) { return (0);}
+	_float_bits y;
+	y.f = x;
+	y.i = 0x54a2fa8c - y.i / 3;
+	const float third_x = x * (1.0f/3);
+	y.f *= (4.0f/3) - third_x * y.f * y.f * y.f;
+	y.f *= (4.0f/3) - third_x * y.f * y.f * y.f;
+	y.f *= (4.0f/3) - third_x * y.f * y.f * y.f;
+	return (x * y.f * y.f);
+}
+
+inline float fast_hypot(const float a, const float b)
+{
+	return (fast_sqrt(a*a + b*b));
+}
+
+/**** Fixed-point positions ****
+ *
+ *	The runtime keeps absolute positions as int64 counts of 1/FXPOS_PER_MM mm - nanometres, or
+ *	micro-degrees on a rotary axis. A float has 24 bits, so at 1000 mm a step along the path
+ *	rounds to 0.06 um every segment. An int64 adds segment travel to any position exactly. Only
+ *	the travel itself, which is short, is computed in float.
+ *
+ *	  fxpos()        exact conversion of any float position (via double - once per move)
+ *	  fxpos_delta()  float conversion of a relative travel - per segment
+ *	  fxpos_mm()     back to float, for kinematics and reporting
+ */
+typedef int64_t fxpos_t;
+#define FXPOS_PER_MM 1000000
+
+inline fxpos_t fxpos(const float position)
+{
+	return ((fxpos_t)llround((double)position * FXPOS_PER_MM));
+}
+
+inline fxpos_t fxpos_delta(const float travel)
+{
+	return ((fxpos_t)llroundf(travel * (float)FXPOS_PER_MM));
+}
+
+inline float fxpos_mm(const fxpos_t position)
+{
+	return ((float)position * (1.0f/FXPOS_PER_MM));
+}
+
+/**** Fixed-point kernels (FIXED_POINT_EXEC) ****
+ *
+ *	Prep and the DDA loader run in interrupts, where every float or double operation is a
+ *	soft-float library call on a chip with no FPU. These do the same jobs in integers:
+ *
+ *	  fx_q24()           Q8.24 from a float, saturated - in prep
+ *	  fx_scale()         int32 times a Q8.24 factor, rounded and saturated - one SMLAL in the loader
+ *	  fx_mul_round()     |x| * k rounded to an integer, k in Q16
+ *	  fx_muldiv_round()  |x| * k / d rounded to an integer
+ *
+ *	The last two take the float's 24 bit mantissa into an int64 and apply its exponent as a shift,
+ *	so they are exact for any float x, as the double expressions they replace were. Zero,
+ *	denormals and results that would not fit a uint32 are not expected: they return 0 or saturate.
+ */
+#define FX_Q24_ONE ((int32_t)1 << 24)
+
+inline int32_t fx_q24(const float x)
+{
+	if (x >= 128) { return (INT32_MAX);}
+	if (x <= -128) { return (-INT32_MAX);}
+	return ((int32_t)lroundf(x * FX_Q24_ONE));
+}
+
+inline int32_t fx_scale(const int32_t value, const int32_t factor)
+{
+	int64_t product = FX_Q24_ONE >> 1;				// round - the product is accumulated onto it (SMLAL)
+	product += (int64_t)value * factor;
+	product >>= 24;
+	if (product > INT32_MAX) { return (INT32_MAX);}
+	if (product < INT32_MIN) { return (INT32_MIN);}
+	return ((int32_t)product);
+}
+
+inline uint32_t fx_mul_round(const float x, const uint64_t k_q16)	// k_q16 < 2^40
+{
+	_float_bits b;
+	b.f = x;
+	uint32_t exponent = (b.i >> 23) & 0xff;
+	if (exponent == 0) { return (0);}
+	uint64_t product = (uint64_t)((b.i & 0x007fffff) | 0x00800000) * k_q16;
+	int32_t shift = 150 + 16 - exponent;			// |x| * k = product * 2^-shift
+	if (shift <= 0) { return (UINT32_MAX);}
+	if (shift >= 64) { return (0);}
+	product = ((product >> (shift-1)) + 1) >> 1;	// round half up without overflowing
+	return ((product > UINT32_MAX) ? UINT32_MAX : (uint32_t)product);
+}
+
+inline uint32_t fx_muldiv_round(const float x, const uint32_t k, const uint32_t d)
+{
+	_float_bits b;
+	b.f = x;
+	uint32_t exponent = (b.i >> 23) & 0xff;
+	if ((exponent == 0) || (d == 0)) { return (0);}
+	uint64_t product = (uint64_t)((b.i & 0x007fffff) | 0x00800000) * k;
+	int32_t shift = 150 - exponent;					// |x| * k = product * 2^-shift
+	if (shift <= 0) { return (UINT32_MAX);}
+	if (shift > 32) {								// keep d << shift in range
+		product = (product + ((uint64_t)1 << (shift-33))) >> (shift-32);
+		shift = 32;
+	}
+	uint64_t divisor = (uint64_t)d << shift;
+	product = (product + (divisor >> 1)) / divisor;
+	return ((product > UINT32_MAX) ? UINT32_MAX : (uint32_t)product);
+}
+
 // Constants
 #define MAX_LONG (2147483647)
 #define MAX_ULONG (4294967295)
 #define MM_PER_INCH (25.4)
 #define INCHES_PER_MM (1/25.4)
 #define MICROSECONDS_PER_MINUTE ((float)60000000)
+#define MILLISECONDS_PER_MINUTE ((float)60000)
 #define uSec(a) ((float)(a * MICROSECONDS_PER_MINUTE))
 
 #define RADIAN (57.2957795)
@@ -27,7 +27,7 @@
  */
 /*
  * XIO acts as an entry point into lower level IO routines - mostly serial IO. It supports
- * the USB, SPI and file IO sub-systems, as well as providing low level character functions
+ * the USB, SPI, ethernet and file IO sub-systems, as well as providing low level character functions
  * used by stdio (printf()).
  *
  * NOTE: This file is specific to TinyG2/C++/ARM. The TinyG/C/Xmega file is completely different
@@ -40,10 +40,14 @@
 #include "report.h"
 #include "controller.h"
 #include "util.h"
+#include "profile_pins.h"
 
 #ifdef __TEXT_MODE
 #include "text_parser.h"
 #endif
+#ifdef __FILE_CHANNEL
+#include "sdcard.h"
+#endif
 
 using namespace Motate;
 //OutputPin<kDebug1_PinNumber> xio_debug_pin1;
@@ -69,7 +73,8 @@ using namespace Motate;
  *   *) a readline implementation that is device agnostic
  *
  * xioDeviceWrapper<Device> -- is a concrete template-specialized child of xioDeviceWrapperBase:
- *   *) Wraps any "device" that supports readchar(), flushRead(), and write(const uint8_t *buffer, int16_t len)
+ *   *) Wraps any "device" that supports readAvailable(uint8_t *buffer, uint16_t len), flushRead(), and
+ *      write(const uint8_t *buffer, int16_t len)
  *   *) Calls the device's setConnectionCallback() on construction, and contains the connection state machine
  *   *) Calls into the xio singleton for multi-device checks. (This mildly complicates the order that we define
  *      these structures, since they depend on each other.)
@@ -99,6 +104,22 @@ bool checkForNotActive(devflags_t flags_to_check) { return !(flags_to_check & DE
 bool checkForCtrlAndData(devflags_t flags_to_check) { return (flags_to_check & (DEV_IS_CTRL|DEV_IS_DATA)) == (DEV_IS_CTRL|DEV_IS_DATA); }
 bool checkForCtrlAndPrimary(devflags_t flags_to_check) { return (flags_to_check & (DEV_IS_CTRL|DEV_IS_PRIMARY)) == (DEV_IS_CTRL|DEV_IS_PRIMARY); }
 
+static inline bool isOverrideChar(uint8_t c) {    // realtime feed and traverse overrides
+    return ((c >= (uint8_t)CHAR_OVR_FIRST) && (c <= (uint8_t)CHAR_OVR_LAST));
+}
+
+// Characters readline() has to look at - everything else is copied to the line buffer in runs
+static inline bool isSpecialChar(uint8_t c) {
+    if (c < ' ') {
+        return ((c == LF) || (c == CR) || (c == EOT) || (c == CAN) || (c == STX));
+    }
+    return ((c == '!') || (c == '%') || (c == '~') || isOverrideChar(c));
+}
+
+static inline bool isRealtimeChar(uint8_t c) {    // single character commands - see _takeRealtime()
+    return ((c == '!') || (c == '~') || (c == '%') || (c == EOT) || (c == CAN) || isOverrideChar(c));
+}
+
 
 struct xioDeviceWrapperBase {				// C++ base class for device primitives
     // connection and device management
@@ -109,10 +130,28 @@ struct xioDeviceWrapperBase {				// C++ base class for device primitives
     // line reader functions
     uint16_t read_index;					// index into line being read
     uint16_t read_buf_size;					// static variable set at init time
-    char read_buf[USB_LINE_BUFFER_SIZE];	// buffer for reading lines
+    char read_buf[XIO_RX_LINES][USB_LINE_BUFFER_SIZE];	// ring of line buffers - see readline()
+    uint16_t read_size[XIO_RX_LINES];		// length of each complete line
+    bool read_frame[XIO_RX_LINES];			// complete line is a binary data frame (see xio.h)
+    uint32_t read_line_num[XIO_RX_LINES];	// line number of each complete line - see readline()
+    uint8_t read_head;						// oldest complete line
+    uint8_t read_fill;						// line being read
+    uint8_t read_count;						// complete lines waiting to be returned
+    uint16_t rx_lines_taken;				// lines handed to the controller, modulo 2^16 - see rxCredit()
+    uint16_t rx_bytes_taken;				// bytes of those lines, terminators included
+    uint32_t rx_line_num;					// lines read from the device, blank lines included
+    uint32_t taken_line_num;				// line number of the last line returned
+    uint32_t line_mark;						// taken_line_num when the lines were last marked - see xio_mark_lines()
+    uint8_t rx_buf[XIO_RX_CHUNK_SIZE];		// bytes read from the device but not yet taken into a line
+    uint16_t rx_index;						// next byte to take from rx_buf
+    uint16_t rx_count;						// bytes in rx_buf
+    uint8_t tx_buf[XIO_TX_BUFFER_SIZE];		// ring of bytes queued for the device - see queue()
+    uint16_t tx_head;						// next byte to send
+    uint16_t tx_count;						// bytes queued
 
     // Internal use only:
-    bool _ready_to_send;
+    bool _in_frame;							// reading a binary data frame (see xio.h)
+    bool _after_cr;							// the last line ended with a CR, so a blank LF line is its CRLF
 
     // Checks against calss flags variable:
 //	bool canRead() { return caps & DEV_CAN_READ; }
@@ -126,6 +165,7 @@ struct xioDeviceWrapperBase {				// C++ base class for device primitives
     bool isNotConnected() { return !(flags & DEV_IS_CONNECTED); }
     bool isReady() { return flags & DEV_IS_READY; }
     bool isActive() { return flags & DEV_IS_ACTIVE; }
+    bool isStorage() { return caps & DEV_IS_STORAGE; }
 
     // Combination checks
     bool isCtrlAndActive() { return ((flags & (DEV_IS_CTRL|DEV_IS_ACTIVE)) == (DEV_IS_CTRL|DEV_IS_ACTIVE)); }
@@ -153,97 +193,343 @@ struct xioDeviceWrapperBase {				// C++ base class for device primitives
                                           next_flags(DEV_FLAGS_CLEAR),
                                           read_index(0),
                                           read_buf_size(USB_LINE_BUFFER_SIZE),
-                                          _ready_to_send(false) {
+                                          read_head(0),
+                                          read_fill(0),
+                                          read_count(0),
+                                          rx_lines_taken(0),
+                                          rx_bytes_taken(0),
+                                          rx_line_num(0),
+                                          taken_line_num(0),
+                                          line_mark(0),
+                                          rx_index(0),
+                                          rx_count(0),
+                                          tx_head(0),
+                                          tx_count(0),
+                                          _in_frame(false),
+                                          _after_cr(false) {
     };
 
     // Pure virtuals. MUST be subclassed for every device -- even if they don't apply.
-    virtual int16_t readchar() = 0;
-    virtual void flushRead() = 0;       // This should call _flushLine() before flushing the device.
-    virtual int16_t write(const uint8_t *buffer, int16_t len) = 0;
+    virtual int16_t readchunk(uint8_t *buffer, int16_t len) = 0;   // non-blocking - returns <= 0 if nothing read
+    virtual void flushRead() = 0;       // This should call _flushLines() and _flushChunk() before flushing the device.
+    virtual int16_t writechunk(const uint8_t *buffer, int16_t len) = 0;   // non-blocking - returns bytes taken, < 0 on error
+
+
+    // Write queueing functions
+    //
+    // Writes are copied into the tx_buf ring and sent from there as the device takes them, so the
+    // controller doesn't wait on USB unless the ring is full. drainWrite() is called after every queue()
+    // and from the controller main loop (xio_callback()), which keeps the ring moving between writes.
+    // Callers that can be dropped or deferred (status reports, for example) check txSpace() first and
+    // don't write if there isn't room. Everything else waits for room, so responses are never lost.
+    uint16_t txSpace() { return (XIO_TX_BUFFER_SIZE - tx_count); }
+
+    int16_t queue(const uint8_t *buffer, int16_t len) {
+        int16_t queued = 0;
+        while (queued < len) {
+            if (tx_count == XIO_TX_BUFFER_SIZE) {
+                drainWrite();
+                if (!isConnected()) {       // the host went away - nothing to wait for
+                    break;
+                }
+                continue;
+            }
+            uint16_t tail = tx_head + tx_count;
+            if (tail >= XIO_TX_BUFFER_SIZE) {
+                tail -= XIO_TX_BUFFER_SIZE;
+            }
+            uint16_t run = min(min((uint16_t)(len - queued), txSpace()), (uint16_t)(XIO_TX_BUFFER_SIZE - tail));
+            memcpy(&tx_buf[tail], &buffer[queued], run);
+            tx_count += run;
+            queued += run;
+        }
+        drainWrite();
+        return queued;
+    };
+
+    void drainWrite() {
+        while (tx_count > 0) {
+            int16_t sent = writechunk(&tx_buf[tx_head], min(tx_count, (uint16_t)(XIO_TX_BUFFER_SIZE - tx_head)));
+            if (sent <= 0) {
+                if ((sent < 0) || !isConnected()) {
+                    _flushWrite();
+                }
+                return;
+            }
+            tx_head += sent;
+            if (tx_head >= XIO_TX_BUFFER_SIZE) {
+                tx_head -= XIO_TX_BUFFER_SIZE;
+            }
+            tx_count -= sent;
+        }
+    };
+
+    void _flushWrite() {
+        tx_head = 0;
+        tx_count = 0;
+    };
 
 
     // Readline and line flushing functions
-    char *readline(devflags_t limit_flags, uint16_t &size) {
+    // A binary frame is returned the same way as a line, but with frame set true
+    //
+    // The device is read a chunk (up to a USB packet) at a time into rx_buf. Runs of ordinary characters
+    // are copied from there to the line buffer in one go - only the special characters and line
+    // terminators are looked at one by one. Bytes past the end of a line stay in rx_buf for the next line.
+    //
+    // Lines are read ahead into a ring of XIO_RX_LINES line buffers and returned oldest first. So while
+    // the controller isn't taking lines (e.g. the planner is full) the device is still read until the
+    // ring is full - the host keeps streaming while the planner catches up.
+    // A returned line stays valid until the next call.
+    //
+    // Each line is numbered as it's read. Blank lines are never returned but they are counted, so the
+    // numbers are the lines of the file the host is sending - see xio_get_line_number().
+    //
+    // On control channels the single character commands never reach the line buffers. They are taken
+    // out of each chunk as it's read and handed to the controller there and then (see _takeRealtime()),
+    // and xio_callback() reads a chunk whenever rx_buf is empty, so a ! is acted on even while the
+    // controller isn't reading lines. Data-only channels still trap them as lines are read, as the bytes
+    // of a binary frame can't be told apart from them until the frame is parsed.
+    char *readline(devflags_t limit_flags, uint16_t &size, bool &frame) {
+        frame = false;
         if (!(limit_flags & flags)) {
         	size = 0;
         	return NULL;
         }
 
-        // If _ready_to_send is true, we captured a line previously but couldn't return it yet (one of various reasons),
-        // and we don't actually need to read from the channel. We just need to try to return it again.
-        if (!_ready_to_send) {
-            while (read_index < read_buf_size) {
-                int c;
-
-                if ((c = readchar()) == _FDEV_ERR) {
-                    break;
+        while (read_count < XIO_RX_LINES) {     // read ahead into any free line buffers
+            int8_t status = _readLine(read_buf[read_fill]);
+            if (status == XIO_LINE_SPECIAL) {
+                size = 1;
+                return single_char_buffer;
+            }
+            if (status == XIO_LINE_NONE) {
+                break;
+            }
+            read_size[read_fill] = read_index;			// how long is the string?
+            read_frame[read_fill] = _in_frame;
+            if (!_in_frame) {
+                char terminator = read_buf[read_fill][read_index];
+                if (!((terminator == LF) && _after_cr && (read_index == 0))) {
+                    rx_line_num++;						// the LF of a CRLF isn't another line
                 }
-                read_buf[read_index] = (char)c;
-
-                // special handling for flush character
-                // if not in a feedhold substitute % with ; so it's treated as a comment and ignored.
-                // if in a feedhold request a queue flush by passing the % back as a single character.
-                if (c == '%') {
-                    if (!cm_has_hold()) {
-                        read_buf[read_index++] = ';';
-                        continue;
-                    } else {
-                        single_char_buffer[0] = '%';    // send queue flush request
-                        size = 1;
-                        return single_char_buffer;
-                    }
+                _after_cr = (terminator == CR);
+                read_buf[read_fill][read_index] = NUL;	// frames fill the buffer and are not terminated
+            } else {
+                rx_line_num++;							// a frame counts as the one line it carries
+                _after_cr = false;
+            }
+            read_line_num[read_fill] = rx_line_num;
+            read_index = 0;							// reset for next line
+            _in_frame = false;
+            read_fill = (read_fill + 1) % XIO_RX_LINES;
+            read_count++;
+        }
+
+        // Now check the oldest complete line and (maybe) return it.
+        if (read_count == 0) {
+            size = 0;
+            return NULL;
+        }
+        char *line = read_buf[read_head];
+        if (!(limit_flags & DEV_IS_DATA)) {
+            // This is a control-only read.
+            // We need to ensure that we only get JSON-lines.
+            // CHEAT: We don't properly ignore spaces here!!
+            if ((line[0] != '{') && (line[0] != CR) && (line[0] != LF)) {
+                // we'll just leave it in the ring, and next time it can be read.
+                size = 0;
+                return NULL;
+            }
+        }
+
+        // Here is where we would do more checks to make sure we're allowing the correct data through the correct channel.
+        // For now, we only do that one test.
+
+        frame = read_frame[read_head];
+        size = read_size[read_head];
+        taken_line_num = read_line_num[read_head];
+        read_head = (read_head + 1) % XIO_RX_LINES;
+        read_count--;
+        if (frame) {
+            rx_bytes_taken += size;
+        } else {
+            rx_bytes_taken += size + 1;				// the terminator was read too
+            if (size > 0) {							// the LF of a CRLF isn't a line to the host
+                rx_lines_taken++;
+            }
+        }
+        return (line);
+    };
+
+    // rxCredit() - what the host may have sent this device so far, counting from the last flush
+    //
+    // The host may have XIO_RX_LINES lines and XIO_RX_CREDIT_BYTES bytes more than the controller has
+    // taken - that much is sure to fit in the line ring and the device buffers however fast it's sent.
+    // Lines are taken only while the planner has room for them, so the credit moves at the speed the
+    // planner drains. The counts are modulo 2^16 and start again from 0 when the lines are flushed.
+    // Single character commands and blank lines (the LF of a CRLF) aren't counted as lines.
+    // Returns the complete lines that are waiting to be taken.
+    uint8_t rxCredit(uint16_t &lines, uint16_t &bytes) {
+        lines = rx_lines_taken + XIO_RX_LINES;
+        bytes = rx_bytes_taken + XIO_RX_CREDIT_BYTES;
+        return (read_count);
+    };
+
+    // _readLine() - continue reading the partial line in buf from the device
+    // Returns XIO_LINE_DONE for a complete line (or frame), XIO_LINE_NONE if the device has nothing more
+    // for now, or XIO_LINE_SPECIAL if a single character command was read into single_char_buffer
+    enum { XIO_LINE_NONE = 0, XIO_LINE_DONE, XIO_LINE_SPECIAL };
+
+    int8_t _readLine(char *buf) {
+        while (read_index < read_buf_size) {
+            if (rx_index == rx_count) {             // get the next chunk from the device
+                if (_readChunk() == 0) {
+                    return (XIO_LINE_NONE);
                 }
+            }
 
-                // trap other special characters
-                if ((c == '!') ||                       // request feedhold
-                    (c == '~') ||                       // request end feedhold
-                    (c == EOT) ||                       // request job kill (end of transmission)
-                    (c == CAN)) {                       // reset (aka cancel, terminate)
-                    single_char_buffer[0] = c;
-                    size = 1;
-                    return single_char_buffer;
-
-                } else if ((c == LF) || (c == CR)) {
-//                } else if ((c == LF) || (c == CR) || (c == TAB)) {  // use this to add TAB as a line terminator
-                    _ready_to_send = true;
-                    break;
+#ifdef __BINARY_DATA
+            // binary frames start a line on a data-only channel and are read by length
+            if ((read_index == 0) && (rx_buf[rx_index] == STX) && !isCtrl()) {
+                _in_frame = true;
+            }
+            if (_in_frame) {
+                buf[read_index++] = (char)rx_buf[rx_index++];
+                if (read_index <= XIO_FRAME_LEN) {
+                    continue;
                 }
-                read_index++;
+                if ((uint8_t)buf[XIO_FRAME_LEN] > XIO_FRAME_PAYLOAD_MAX) {
+                    _flushLine();                   // can't be a frame - drop it
+                    continue;
+                }
+                if (read_index == (XIO_FRAME_HEADER_LEN + (uint8_t)buf[XIO_FRAME_LEN] + XIO_FRAME_CRC_LEN)) {
+                    return (XIO_LINE_DONE);
+                }
+                continue;
             }
-        }
+#endif
+            // copy the run of ordinary characters up to the next special one
+            uint16_t run = rx_count - rx_index;
+            if (run > (uint16_t)(read_buf_size - read_index)) {
+                run = read_buf_size - read_index;
+            }
+            const uint8_t *rd = &rx_buf[rx_index];
+            const uint8_t *rd_end = rd + run;
+            while ((rd < rd_end) && !isSpecialChar(*rd)) {
+                rd++;
+            }
+            run = rd - &rx_buf[rx_index];
+            memcpy(&buf[read_index], &rx_buf[rx_index], run);
+            read_index += run;
+            rx_index += run;
+            if (rd == rd_end) {
+                continue;                           // out of chunk or line buffer
+            }
+
+            int c = rx_buf[rx_index++];
+            buf[read_index] = (char)c;
 
-        // Now we have a complete line to send, check it and (maybe) return it.
-        if (_ready_to_send) {
-            if (!(limit_flags & DEV_IS_DATA)) {
-                // This is a control-only read.
-                // We need to ensure that we only get JSON-lines.
-                // CHEAT: We don't properly ignore spaces here!!
-                if ((read_buf[0] != '{') && (read_buf[0] != CR) && (read_buf[0] != LF)) {
-                    // we'll just leave _ready_to_send set, and next time it can be read.
-                    size = 0;
-                    return NULL;
+            // special handling for flush character
+            // if not in a feedhold substitute % with ; so it's treated as a comment and ignored.
+            // if in a feedhold request a queue flush by passing the % back as a single character.
+            if (c == '%') {
+                if (!cm_has_hold()) {
+                    buf[read_index++] = ';';
+                    continue;
+                } else {
+                    single_char_buffer[0] = '%';    // send queue flush request
+                    return (XIO_LINE_SPECIAL);
                 }
             }
 
-            // Here is where we would do more checks to make sure we're allowing the correct data through the correct channel.
-            // For now, we only do that one test.
+            // trap other special characters
+            if ((c == '!') ||                       // request feedhold
+                (c == '~') ||                       // request end feedhold
+                (c == EOT) ||                       // request job kill (end of transmission)
+                (c == CAN) ||                       // reset (aka cancel, terminate)
+                isOverrideChar(c)) {                // feed or traverse override
+                single_char_buffer[0] = c;
+                return (XIO_LINE_SPECIAL);
+
+            } else if ((c == LF) || (c == CR)) {
+//            } else if ((c == LF) || (c == CR) || (c == TAB)) {  // use this to add TAB as a line terminator
+                return (XIO_LINE_DONE);
+            }
+            read_index++;
+        }
+        return (XIO_LINE_NONE);
+    };
 
-            read_buf[read_index] = NUL;
-            size = read_index;						// how long is the string?
-            read_index = 0;							// reset for next readline
+    // _readChunk() - read the next chunk from the device into rx_buf, which must be empty
+    // Returns the number of bytes left in rx_buf once any single character commands are taken out.
+    uint16_t _readChunk() {
+        PROFILE_PIN_SCOPE(USB_RX);
+        int16_t count = readchunk(rx_buf, XIO_RX_CHUNK_SIZE);
+        rx_index = 0;
+        rx_count = (count > 0) ? count : 0;
+        if (isCtrl()) {
+            _takeRealtime();
+        }
+        return (rx_count);
+    };
 
-            _ready_to_send = false;
+    // pollRealtime() - read ahead a chunk if rx_buf is empty, so single character commands are seen
+    void pollRealtime() {
+        if (isCtrlAndActive() && (rx_index == rx_count)) {
+            _readChunk();
+        }
+    };
 
-            return (read_buf);
+    // _takeRealtime() - the fast lane. Dispatch the single character commands in rx_buf and close
+    // up the gaps they leave. % is only a command in a hold (or with a hold just requested) - otherwise
+    // it's left for _readLine() to turn into a comment.
+    void _takeRealtime() {
+        uint16_t wr = rx_index;
+        for (uint16_t rd = rx_index; rd < rx_count; rd++) {
+            uint8_t c = rx_buf[rd];
+            if (isRealtimeChar(c) && ((c != '%') || cm_has_hold())) {
+                controller_dispatch_realtime(c);
+                if (rx_count == 0) {                // a queue flush flushed rx_buf too
+                    return;
+                }
+                continue;
+            }
+            rx_buf[wr++] = c;
         }
-        size = 0;
-        return NULL;
+        rx_count = wr;
     };
 
-    void _flushLine() {
-        _ready_to_send = false;
+    void _flushLine() {                         // drop the line being read
+        _in_frame = false;
         read_index = 0;
     };
+
+    void _flushLines() {                        // drop the line being read and all complete lines
+        _flushLine();
+        read_head = 0;
+        read_fill = 0;
+        read_count = 0;
+        rx_lines_taken = 0;
+        rx_bytes_taken = 0;
+    };
+
+    void _flushChunk() {
+        rx_index = 0;
+        rx_count = 0;
+    };
+
+    void _restartLines() {                      // number the lines from 1 again
+        rx_line_num = 0;
+        taken_line_num = 0;
+        line_mark = 0;
+        _after_cr = false;
+    };
+
+    // isDrained() - every byte read from the device has been handed to the controller
+    bool isDrained() {
+        return ((read_count == 0) && (read_index == 0) && (rx_index == rx_count));
+    };
 };
 
 // Here we create the xio_t class, which has convenience methods to handle cross-device actions as a whole.
@@ -252,17 +538,20 @@ struct xio_t {
 
     xioDeviceWrapperBase* DeviceWrappers[DEV_MAX];
     const uint8_t _dev_count;
+    int8_t read_dev;                        // device the last line was read from, -1 before the first
+    int8_t reply_dev;                       // device write() sends to instead of the control devices, -1 for none - see xio_reply_to_reader()
 
     template<typename... ds>
-    xio_t(ds... args) : magic_start(MAGICNUM), DeviceWrappers {args...}, _dev_count(sizeof...(args)), magic_end(MAGICNUM) {
+    xio_t(ds... args) : magic_start(MAGICNUM), DeviceWrappers {args...}, _dev_count(sizeof...(args)), read_dev(-1), reply_dev(-1), magic_end(MAGICNUM) {
 
     };
 
     // ##### Connection management functions
+    // Storage devices aren't connections - they are left out (see xioFile)
 
     bool others_connected(xioDeviceWrapperBase* except) {
         for (int8_t i = 0; i < _dev_count; ++i) {
-            if((DeviceWrappers[i] != except) && DeviceWrappers[i]->isConnected()) {
+            if((DeviceWrappers[i] != except) && DeviceWrappers[i]->isConnected() && !DeviceWrappers[i]->isStorage()) {
                 return true;
             }
         }
@@ -287,10 +576,22 @@ struct xio_t {
 
     void deactivate_all_channels() {
         for(int8_t i = 0; i < _dev_count; ++i) {
-            DeviceWrappers[i]->clearActive();
+            if (!DeviceWrappers[i]->isStorage()) {
+                DeviceWrappers[i]->clearActive();
+            }
         }
     };
 
+    // running_file() - the storage device running a file, or NULL if there isn't one
+    xioDeviceWrapperBase* running_file() {
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            if (DeviceWrappers[i]->isStorage() && DeviceWrappers[i]->isDataAndActive()) {
+                return DeviceWrappers[i];
+            }
+        }
+        return NULL;
+    };
+
     // ##### Cross-Device read/write/etc. functions
 
     /*
@@ -302,19 +603,157 @@ struct xio_t {
         // 1) If a device fails to write the data, or all the data, then it's ignored
         // 2) Only the amount written by the *last* device to match (CTRL|ACTIVE) is returned.
         //
-        // In the current environment, these are not forssen to cause trouble, since these are blocking writes
-        // and we expect to only really be writing to one device.
+        // In the current environment, these are not forssen to cause trouble, since writes only return
+        // short if the device goes away, and we expect to only really be writing to one device.
 
         size_t written = -1;
 
+        if (reply_dev >= 0) {
+            return DeviceWrappers[reply_dev]->queue(buffer, size);
+        }
         for (int8_t i = 0; i < _dev_count; ++i) {
             if (DeviceWrappers[i]->isCtrlAndActive()) {
-                written = DeviceWrappers[i]->write(buffer, size);
+                written = DeviceWrappers[i]->queue(buffer, size);
             }
         }
         return written;
     }
 
+    /*
+     * write_data() - write a block to the data-only device, if there is one
+     *
+     *	Used for binary frame acknowledgements, which stay on the channel the frames came in on.
+     */
+    size_t write_data(const uint8_t *buffer, size_t size)
+    {
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            if (DeviceWrappers[i]->isDataAndActive() && !DeviceWrappers[i]->isCtrl()) {
+                return DeviceWrappers[i]->queue(buffer, size);
+            }
+        }
+        return 0;
+    }
+
+    /*
+     * tx_space() - room left in the write queue of the control device(s) - the least of them
+     * tx_space_data() - room left in the write queue of the data-only device, if there is one
+     *
+     *	With no device to write to there's nothing to wait for, so all the room in the world is returned.
+     */
+    uint16_t tx_space()
+    {
+        uint16_t space = XIO_TX_BUFFER_SIZE;
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            if (DeviceWrappers[i]->isCtrlAndActive()) {
+                space = min(space, DeviceWrappers[i]->txSpace());
+            }
+        }
+        return space;
+    }
+
+    uint16_t tx_space_data()
+    {
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            if (DeviceWrappers[i]->isDataAndActive() && !DeviceWrappers[i]->isCtrl()) {
+                return DeviceWrappers[i]->txSpace();
+            }
+        }
+        return XIO_TX_BUFFER_SIZE;
+    }
+
+#ifdef __REPORT_FANOUT
+    /*
+     * write_report() - queue a serialized report to the host and the subscribed channels - see xio_write_report()
+     */
+    uint8_t write_report(const uint8_t *buffer, size_t size, devflags_t sub, devflags_t host, devflags_t resync, uint8_t kind)
+    {
+        uint8_t dropped = 0;
+        bool to_data = (host == DEV_IS_DATA);   // only the first data-only device, as write_data()
+
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            xioDeviceWrapperBase* dev = DeviceWrappers[i];
+            if ((host == DEV_IS_CTRL) && dev->isCtrlAndActive()) {
+                dev->queue(buffer, size);       // the caller made room, as for write()
+                continue;
+            }
+            bool to_host = false;
+            if (to_data && dev->isDataAndActive() && !dev->isCtrl()) {
+                to_host = true;
+                to_data = false;
+            }
+            if (!to_host && !((dev->flags & sub) && dev->isConnected())) {
+                continue;
+            }
+            bool waiting = (dev->flags & resync);
+            if ((kind == XIO_REPORT_CHANGES) ? waiting : ((kind == XIO_REPORT_RESYNC) && !waiting)) {
+                continue;
+            }
+            if (dev->txSpace() < size) {
+                dev->flags |= resync;           // it gets every value once it has room
+                dropped++;
+                continue;
+            }
+            dev->queue(buffer, size);
+            if (kind != XIO_REPORT_CHANGES) {
+                dev->flags &= ~resync;
+            }
+        }
+        return dropped;
+    }
+
+    /*
+     * subscribers() - connected devices with any of the flags in sub and at least 'space' free to write
+     */
+    uint8_t subscribers(devflags_t sub, uint16_t space)
+    {
+        uint8_t count = 0;
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            if ((DeviceWrappers[i]->flags & sub) && DeviceWrappers[i]->isConnected() &&
+                (DeviceWrappers[i]->txSpace() >= space)) {
+                count++;
+            }
+        }
+        return count;
+    }
+#endif
+
+    /*
+     * rx_credit() - line and byte credit of the data device - see xioDeviceWrapperBase::rxCredit()
+     *
+     *	Only one data device is active at a time, and that's the one a sender streams to.
+     *	With none the credit is the bare window and no lines are waiting.
+     */
+    uint8_t rx_credit(uint16_t &lines, uint16_t &bytes)
+    {
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            if (DeviceWrappers[i]->isDataAndActive()) {
+                return DeviceWrappers[i]->rxCredit(lines, bytes);
+            }
+        }
+        lines = XIO_RX_LINES;
+        bytes = XIO_RX_CREDIT_BYTES;
+        return 0;
+    }
+
+    /*
+     * drainWrite() - send what the devices will take from their write queues, without blocking
+     */
+    void drainWrite()
+    {
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            DeviceWrappers[i]->drainWrite();
+        }
+    }
+
+    /*
+     * pollRealtime() - look for single character commands on the control devices, without blocking
+     */
+    void pollRealtime()
+    {
+        for (int8_t i = 0; i < _dev_count; ++i) {
+            DeviceWrappers[i]->pollRealtime();
+        }
+    }
 
     /*
      * flushRead() - flush all readable devices' read buffers
@@ -334,7 +773,8 @@ struct xio_t {
      *
      *	This function iterates over all active control and data devices, including reading from
      *	multiple control devices. It will also manage multiple data devices, but only one data
-     *	device may be active at a time.
+     *	device may be active at a time. While a file is being run it's the only data device read
+     *	(data lines from the host wait until it ends) and DEV_RX_FILE is set in the returned flags.
      *
      *	ARGS:
      *
@@ -345,13 +785,15 @@ struct xio_t {
      *   size -  Returns the size of the completed buffer, including the NUL termination character.
      *			 Lines may be returned truncated to the length of the serial input buffer if the text
      *			 from the physical device is longer than the read buffer for the device. The size value
-     *			 provided as a calling argument is ignored (size doesn't matter).
+     *			 provided as a calling argument is ignored (size doesn't matter). For a binary frame
+     *			 it's the frame length - frames are not NUL terminated - and DEV_RX_FRAME is set in flags.
      *
      *	 char * Returns a pointer to the buffer containing the line, or NULL (*0) if no text
      */
     char *readline(devflags_t &flags, uint16_t &size)
     {
         char *ret_buffer;
+        bool frame = false;
         devflags_t limit_flags = flags; // Store it so it can't get mangled
 
         // Always check control-capable devices FIRST
@@ -363,10 +805,11 @@ struct xio_t {
             if (!DeviceWrappers[dev]->isCtrl())
                 continue;
 
-            ret_buffer = DeviceWrappers[dev]->readline(DEV_IS_CTRL, size);
+            ret_buffer = DeviceWrappers[dev]->readline(DEV_IS_CTRL, size, frame);
 
             if (size > 0) {
                 flags = DeviceWrappers[dev]->flags;
+                read_dev = dev;
 
                 return ret_buffer;
             }
@@ -374,14 +817,25 @@ struct xio_t {
 
         // We only do this second pass if this is not a CTRL-only read
         if (!checkForCtrlOnly(limit_flags)) {
+            xioDeviceWrapperBase* file = running_file();
             for (uint8_t dev=0; dev < _dev_count; dev++) {
                 if (!DeviceWrappers[dev]->isActive())
                     continue;
 
-                ret_buffer = DeviceWrappers[dev]->readline(limit_flags, size);
+                if ((file != NULL) && (DeviceWrappers[dev] != file))
+                    continue;
+
+                ret_buffer = DeviceWrappers[dev]->readline(limit_flags, size, frame);
 
                 if (size > 0) {
                     flags = DeviceWrappers[dev]->flags;
+                    read_dev = dev;
+                    if (frame) {
+                        flags |= DEV_RX_FRAME;
+                    }
+                    if (DeviceWrappers[dev] == file) {
+                        flags |= DEV_RX_FILE;
+                    }
 
                     return ret_buffer;
                 }
@@ -478,21 +932,526 @@ struct xioDeviceWrapper : xioDeviceWrapperBase {	// describes a device for readi
         });
     };
 
-    virtual int16_t readchar() final {
-        return _dev->readByte();					// readByte calls the USB endpoint's read function
+    virtual int16_t readchunk(uint8_t *buffer, int16_t len) final {
+        return _dev->readAvailable(buffer, len);	// reads what the USB endpoint has, without blocking
     };
 
     virtual void flushRead() final {
-        // FLush out any partially or wholly read lines being stored:
-        _flushLine();
+        // FLush out any partially or wholly read lines being stored, and bytes read ahead of them:
+        _flushLines();
+        _flushChunk();
         return _dev->flushRead();
     }
 
-    virtual int16_t write(const uint8_t *buffer, int16_t len) final {
-        return _dev->write(buffer, len);
+    virtual int16_t writechunk(const uint8_t *buffer, int16_t len) final {
+        int16_t written = _dev->writeSome(buffer, len);  // takes what the USB endpoint has room for, without blocking
+        if (written > 0) {
+            _dev->flush();
+        }
+        return written;
     }
 };
 
+#ifdef __USART_CHANNEL
+/*
+ * xioUSART - hardware serial device on USART0 (RXD0 on PA10, TXD0 on PA11 - Due pins D19 and D18)
+ *
+ *	Presents the same calls as the USB serial classes, so it takes a place in xio like them.
+ *	Both directions run on the USART's PDC:
+ *
+ *	  - Receive DMAs into rx_buf, treated as a ring of two halves. The PDC moves on to the next
+ *		half by itself and the ENDRX/RXBUFF interrupt queues the half after that, so the CPU
+ *		is only involved once per half. readAvailable() copies from the ring without blocking.
+ *		The host has to stay less than a ring ahead of the controller (there's no flow control).
+ *
+ *	  - Transmit copies into one of two small buffers and hands it to the PDC (current or next
+ *		transfer), so writeSome() never waits on the line.
+ *
+ *	A UART has no DTR, so the channel connects when the first byte is received (see poll()).
+ *	It doesn't disconnect.
+ */
+struct xioUSART {
+    std::function<void(bool)> connection_state_changed_callback;
+    bool _connected;
+    uint16_t _rx_tail;						// next byte to read from rx_buf
+    uint8_t _tx_next;						// tx_buf to fill next
+    uint8_t rx_buf[XIO_USART_RX_BUFFER_SIZE];
+    uint8_t tx_buf[2][XIO_RX_CHUNK_SIZE];
+
+    void begin(uint32_t baud) {
+        PMC->PMC_PCER0 = (1u << ID_USART0);
+        PIOA->PIO_ABSR &= ~(PIO_PA10A_RXD0 | PIO_PA11A_TXD0);	// peripheral A
+        PIOA->PIO_PDR = (PIO_PA10A_RXD0 | PIO_PA11A_TXD0);
+
+        USART0->US_PTCR = US_PTCR_RXTDIS | US_PTCR_TXTDIS;
+        USART0->US_CR = US_CR_RSTRX | US_CR_RSTTX | US_CR_RSTSTA | US_CR_RXDIS | US_CR_TXDIS;
+        USART0->US_MR = US_MR_CHRL_8_BIT | US_MR_PAR_NO | US_MR_NBSTOP_1_BIT | US_MR_OVER;
+        uint32_t div = (SystemCoreClock + baud/2) / baud;		// in 1/8ths with 8x oversampling
+        USART0->US_BRGR = US_BRGR_CD(div >> 3) | US_BRGR_FP(div & 0x07);
+
+        _rx_tail = 0;
+        _tx_next = 0;
+        USART0->US_RPR = (uint32_t)&rx_buf[0];
+        USART0->US_RCR = XIO_USART_RX_BUFFER_SIZE/2;
+        USART0->US_RNPR = (uint32_t)&rx_buf[XIO_USART_RX_BUFFER_SIZE/2];
+        USART0->US_RNCR = XIO_USART_RX_BUFFER_SIZE/2;
+        USART0->US_TCR = 0;
+        USART0->US_TNCR = 0;
+
+        USART0->US_IDR = 0xFFFFFFFF;
+        USART0->US_IER = US_IER_ENDRX | US_IER_RXBUFF;
+        NVIC_SetPriority(USART0_IRQn, IRQ_PRIORITY_SERIAL);
+        NVIC_EnableIRQ(USART0_IRQn);
+        USART0->US_PTCR = US_PTCR_RXTEN | US_PTCR_TXTEN;
+        USART0->US_CR = US_CR_RXEN | US_CR_TXEN;
+    };
+
+    // called from the USART0 interrupt when the PDC has finished a half (or both)
+    void rearm() {
+        if (USART0->US_RCR == 0) {			// overrun - both halves filled before being re-armed
+            USART0->US_RPR = (uint32_t)&rx_buf[0];
+            USART0->US_RCR = XIO_USART_RX_BUFFER_SIZE/2;
+            _rx_tail = 0;					// what was in the ring is lost
+        }
+        uint8_t *rd = (uint8_t *)USART0->US_RPR;
+        USART0->US_RNPR = (uint32_t)((rd < &rx_buf[XIO_USART_RX_BUFFER_SIZE/2]) ? &rx_buf[XIO_USART_RX_BUFFER_SIZE/2] : &rx_buf[0]);
+        USART0->US_RNCR = XIO_USART_RX_BUFFER_SIZE/2;	// writing this also clears ENDRX and RXBUFF
+    };
+
+    uint16_t _rxHead() {
+        uint16_t head = (uint8_t *)USART0->US_RPR - rx_buf;
+        return ((head >= XIO_USART_RX_BUFFER_SIZE) ? 0 : head);
+    };
+
+    // poll() - connect on the first byte received. Called from xio_callback()
+    void poll() {
+        if (!_connected && (_rxHead() != _rx_tail)) {
+            _connected = true;
+            if (connection_state_changed_callback) {
+                connection_state_changed_callback(true);
+            }
+        }
+    };
+
+    void setConnectionCallback(std::function<void(bool)> &&callback) {
+        connection_state_changed_callback = std::move(callback);
+    };
+
+    int16_t readAvailable(uint8_t *buffer, const uint16_t length) {
+        uint16_t head = _rxHead();
+        uint16_t count = 0;
+        while ((count < length) && (_rx_tail != head)) {
+            uint16_t run = ((head > _rx_tail) ? head : XIO_USART_RX_BUFFER_SIZE) - _rx_tail;
+            run = min(run, (uint16_t)(length - count));
+            memcpy(&buffer[count], &rx_buf[_rx_tail], run);
+            count += run;
+            _rx_tail += run;
+            if (_rx_tail == XIO_USART_RX_BUFFER_SIZE) {
+                _rx_tail = 0;
+            }
+        }
+        return (count);
+    };
+
+    int32_t writeSome(const uint8_t *data, const uint16_t length) {
+        uint16_t count = min(length, (uint16_t)XIO_RX_CHUNK_SIZE);
+        uint8_t *buf = tx_buf[_tx_next];
+        if (USART0->US_TCR == 0) {
+            memcpy(buf, data, count);
+            USART0->US_TPR = (uint32_t)buf;
+            USART0->US_TCR = count;
+        } else if (USART0->US_TNCR == 0) {
+            memcpy(buf, data, count);
+            USART0->US_TNPR = (uint32_t)buf;
+            USART0->US_TNCR = count;
+        } else {
+            return (0);						// both transfers busy - try again later
+        }
+        _tx_next ^= 1;
+        return (count);
+    };
+
+    void flush() {};						// the PDC sends as soon as it's handed a buffer
+
+    void flushRead() {
+        _rx_tail = _rxHead();
+    };
+};
+
+xioUSART SerialUSART0;
+
+extern "C" void USART0_Handler(void)
+{
+    SerialUSART0.rearm();
+}
+#endif // __USART_CHANNEL
+
+#ifdef __SPI_CHANNEL
+/*
+ * xioSPISlave - SPI slave device on SPI0 (MISO PA25, MOSI PA26, SCK PA27, NPCS0 PA28), for a host
+ *				 coprocessor (a Raspberry Pi or an FPGA) as the SPI master
+ *
+ *	Framing: the host clocks a fixed block of XIO_SPI_BLOCK_SIZE bytes per chip select. In each
+ *	direction the first byte of a block is the number of data bytes that follow (0 to BLOCK-1),
+ *	and the rest is padding. So every block carries data both ways - the host polls with empty
+ *	blocks to collect responses. The data is the same byte stream the USB channels carry (lines
+ *	and, on a data channel, binary frames).
+ *
+ *	Both directions are DMA'd by the DMAC (the SAM3X SPI has no PDC). The NSS rising edge interrupt
+ *	ends a block: the received data is moved to rx_buf, the next tx block is built from tx_buf,
+ *	and both channels are re-armed. The CPU is involved once per block, not once per byte.
+ *	A block cut short (chip select released early) is dropped.
+ *
+ *	The channel connects on the first complete block. It doesn't disconnect.
+ */
+#define SPI_DMAC_TX_CH		0
+#define SPI_DMAC_RX_CH		1
+#define SPI_DMAC_TX_PER		1						// DMAC hardware interfaces for SPI0
+#define SPI_DMAC_RX_PER		2
+
+struct xioSPISlave {
+    std::function<void(bool)> connection_state_changed_callback;
+    volatile bool _connected;
+    volatile bool _got_block;
+    volatile uint16_t _rx_head;				// written by the interrupt
+    uint16_t _rx_tail;
+    uint16_t _tx_head;
+    volatile uint16_t _tx_tail;				// written by the interrupt
+    uint8_t rx_buf[XIO_SPI_BUFFER_SIZE];
+    uint8_t tx_buf[XIO_SPI_BUFFER_SIZE];
+    uint8_t rx_block[XIO_SPI_BLOCK_SIZE];
+    uint8_t tx_block[XIO_SPI_BLOCK_SIZE];
+
+    void begin() {
+        PMC->PMC_PCER0 = (1u << ID_SPI0);
+        PMC->PMC_PCER1 = (1u << (ID_DMAC - 32));
+        PIOA->PIO_ABSR &= ~(PIO_PA25A_SPI0_MISO | PIO_PA26A_SPI0_MOSI | PIO_PA27A_SPI0_SPCK | PIO_PA28A_SPI0_NPCS0);
+        PIOA->PIO_PDR = (PIO_PA25A_SPI0_MISO | PIO_PA26A_SPI0_MOSI | PIO_PA27A_SPI0_SPCK | PIO_PA28A_SPI0_NPCS0);
+
+        SPI0->SPI_CR = SPI_CR_SPIDIS;
+        SPI0->SPI_CR = SPI_CR_SWRST;
+        SPI0->SPI_CR = SPI_CR_SWRST;
+        SPI0->SPI_MR = SPI_MR_MODFDIS;			// slave mode
+        SPI0->SPI_CSR[0] = Motate::kSPIMode0 | SPI_CSR_BITS_8_BIT;
+
+        _rx_head = _rx_tail = 0;
+        _tx_head = _tx_tail = 0;
+        DMAC->DMAC_EN = DMAC_EN_ENABLE;
+        _armBlock();
+
+        SPI0->SPI_IDR = 0xFFFFFFFF;
+        SPI0->SPI_IER = SPI_IER_NSSR;
+        NVIC_EnableIRQ(SPI0_IRQn);
+        SPI0->SPI_CR = SPI_CR_SPIEN;
+    };
+
+    // Build the next tx block from tx_buf and start both DMA channels on it. The tx data stays
+    // in tx_buf until the block has gone - see endBlock().
+    void _armBlock() {
+        uint16_t count = 0;
+        uint16_t tail = _tx_tail;
+        while ((count < (XIO_SPI_BLOCK_SIZE-1)) && (tail != _tx_head)) {
+            tx_block[++count] = tx_buf[tail];
+            tail = (tail + 1) % XIO_SPI_BUFFER_SIZE;
+        }
+        tx_block[0] = count;
+
+        DmacCh_num *tx = &DMAC->DMAC_CH_NUM[SPI_DMAC_TX_CH];
+        tx->DMAC_SADDR = (uint32_t)tx_block;
+        tx->DMAC_DADDR = (uint32_t)&SPI0->SPI_TDR;
+        tx->DMAC_DSCR = 0;
+        tx->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(XIO_SPI_BLOCK_SIZE) | DMAC_CTRLA_SRC_WIDTH_BYTE | DMAC_CTRLA_DST_WIDTH_BYTE;
+        tx->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE | DMAC_CTRLB_DST_DSCR_FETCH_DISABLE |
+                         DMAC_CTRLB_FC_MEM2PER_DMA_FC | DMAC_CTRLB_SRC_INCR_INCREMENTING | DMAC_CTRLB_DST_INCR_FIXED;
+        tx->DMAC_CFG = DMAC_CFG_DST_PER(SPI_DMAC_TX_PER) | DMAC_CFG_DST_H2SEL | DMAC_CFG_SOD | DMAC_CFG_FIFOCFG_ALAP_CFG;
+
+        DmacCh_num *rx = &DMAC->DMAC_CH_NUM[SPI_DMAC_RX_CH];
+        rx->DMAC_SADDR = (uint32_t)&SPI0->SPI_RDR;
+        rx->DMAC_DADDR = (uint32_t)rx_block;
+        rx->DMAC_DSCR = 0;
+        rx->DMAC_CTRLA = DMAC_CTRLA_BTSIZE(XIO_SPI_BLOCK_SIZE) | DMAC_CTRLA_SRC_WIDTH_BYTE | DMAC_CTRLA_DST_WIDTH_BYTE;
+        rx->DMAC_CTRLB = DMAC_CTRLB_SRC_DSCR_FETCH_DISABLE | DMAC_CTRLB_DST_DSCR_FETCH_DISABLE |
+                         DMAC_CTRLB_FC_PER2MEM_DMA_FC | DMAC_CTRLB_SRC_INCR_FIXED | DMAC_CTRLB_DST_INCR_INCREMENTING;
+        rx->DMAC_CFG = DMAC_CFG_SRC_PER(SPI_DMAC_RX_PER) | DMAC_CFG_SRC_H2SEL | DMAC_CFG_SOD | DMAC_CFG_FIFOCFG_ALAP_CFG;
+
+        DMAC->DMAC_CHER = (DMAC_CHER_ENA0 << SPI_DMAC_TX_CH) | (DMAC_CHER_ENA0 << SPI_DMAC_RX_CH);
+    };
+
+    // called from the SPI0 interrupt when the host releases chip select
+    void endBlock() {
+        (void)SPI0->SPI_SR;						// clears NSSR
+        bool complete = !(DMAC->DMAC_CHSR & (DMAC_CHSR_ENA0 << SPI_DMAC_RX_CH));
+        DMAC->DMAC_CHDR = (DMAC_CHDR_DIS0 << SPI_DMAC_TX_CH) | (DMAC_CHDR_DIS0 << SPI_DMAC_RX_CH);
+        if (complete) {
+            _tx_tail = (_tx_tail + tx_block[0]) % XIO_SPI_BUFFER_SIZE;	// that much has been sent
+            uint8_t count = min(rx_block[0], (uint8_t)(XIO_SPI_BLOCK_SIZE-1));
+            for (uint8_t i = 1; i <= count; i++) {
+                uint16_t next = (_rx_head + 1) % XIO_SPI_BUFFER_SIZE;
+                if (next == _rx_tail) {
+                    break;							// host is too far ahead - the rest is lost
+                }
+                rx_buf[_rx_head] = rx_block[i];
+                _rx_head = next;
+            }
+            _got_block = true;
+        }
+        _armBlock();
+    };
+
+    // poll() - connect on the first complete block. Called from xio_callback()
+    void poll() {
+        if (!_connected && _got_block) {
+            _connected = true;
+            if (connection_state_changed_callback) {
+                connection_state_changed_callback(true);
+            }
+        }
+    };
+
+    void setConnectionCallback(std::function<void(bool)> &&callback) {
+        connection_state_changed_callback = std::move(callback);
+    };
+
+    int16_t readAvailable(uint8_t *buffer, const uint16_t length) {
+        uint16_t count = 0;
+        while ((count < length) && (_rx_tail != _rx_head)) {
+            buffer[count++] = rx_buf[_rx_tail];
+            _rx_tail = (_rx_tail + 1) % XIO_SPI_BUFFER_SIZE;
+        }
+        return (count);
+    };
+
+    int32_t writeSome(const uint8_t *data, const uint16_t length) {
+        uint16_t count = 0;
+        while (count < length) {
+            uint16_t next = (_tx_head + 1) % XIO_SPI_BUFFER_SIZE;
+            if (next == _tx_tail) {
+                break;								// full - the host hasn't collected it yet
+            }
+            tx_buf[_tx_head] = data[count++];
+            _tx_head = next;
+        }
+        return (count);
+    };
+
+    void flush() {};							// data goes in the next block the host clocks
+
+    void flushRead() {
+        _rx_tail = _rx_head;
+    };
+};
+
+xioSPISlave SerialSPI0;
+
+extern "C" void SPI0_Handler(void)
+{
+    SerialSPI0.endBlock();
+}
+#endif // __SPI_CHANNEL
+
+#ifdef __ETHERNET_CHANNEL
+/*
+ * xioEthernet - a TCP socket on the W5500 (see ethernet.cpp), one channel per socket
+ *
+ *	Each socket listens on $ethpt and connects when a client does, so the first client to
+ *	connect is the control channel and the next one the data channel, the same as the two USB
+ *	serial ports. When a client closes or goes away (the keepalive finds it) the socket is
+ *	disconnected and listens again. Data the client sent before it closed is read first.
+ *
+ *	The socket's receive buffer is read a chunk at a time straight into the line reader, so
+ *	there's no ring in between. TCP flow control holds the client back while it's full.
+ *	Between chunks the socket is asked for more no more than once a millisecond, and its state
+ *	every ETH_POLL_MS - each of those is an SPI frame.
+ */
+struct xioEthernet {
+    std::function<void(bool)> connection_state_changed_callback;
+    uint8_t _socket;
+    bool _connected;
+    uint16_t _rx_waiting;					// bytes the socket said it had that haven't been read
+    uint32_t _rx_asked;						// when it was last asked (ms)
+
+    void begin(uint8_t socket) {
+        _socket = socket;
+        _connected = false;
+        _rx_waiting = 0;
+    };
+
+    // poll() - follow the socket state. Called from xio_callback() every ETH_POLL_MS
+    void poll() {
+        uint8_t state = eth_socket_state(_socket);
+        if ((state == ETH_SOCK_ESTABLISHED) ||
+            ((state == ETH_SOCK_CLOSE_WAIT) && ((_rx_waiting > 0) || (eth_rx_available(_socket) > 0)))) {
+            if (!_connected) {
+                _connected = true;
+                if (connection_state_changed_callback) {
+                    connection_state_changed_callback(true);
+                }
+            }
+            return;
+        }
+        if (_connected) {
+            _connected = false;
+            _rx_waiting = 0;
+            if (connection_state_changed_callback) {
+                connection_state_changed_callback(false);
+            }
+        }
+        if (state == ETH_SOCK_CLOSE_WAIT) {
+            eth_socket_disconnect(_socket);
+        } else if (state == ETH_SOCK_CLOSED) {
+            eth_socket_listen(_socket);
+        }
+    };
+
+    void setConnectionCallback(std::function<void(bool)> &&callback) {
+        connection_state_changed_callback = std::move(callback);
+    };
+
+    int16_t readAvailable(uint8_t *buffer, const uint16_t length) {
+        if (!_connected) {
+            return (0);
+        }
+        if (_rx_waiting == 0) {
+            uint32_t now = SysTickTimer_getValue();
+            if (now == _rx_asked) {
+                return (0);
+            }
+            _rx_asked = now;
+            _rx_waiting = eth_rx_available(_socket);
+        }
+        uint16_t count = eth_read(_socket, buffer, min(length, _rx_waiting));
+        _rx_waiting -= count;
+        return (count);
+    };
+
+    int32_t writeSome(const uint8_t *data, const uint16_t length) {
+        return (eth_write(_socket, data, length));
+    };
+
+    void flush() {};						// a SEND goes with every write
+
+    void flushRead() {
+        if (_connected) {
+            eth_flush_read(_socket);
+        }
+        _rx_waiting = 0;
+    };
+};
+
+xioEthernet EthernetSocket[ETH_SOCKETS];
+#endif // __ETHERNET_CHANNEL
+
+#ifdef __FILE_CHANNEL
+/*
+ * xioFile - a job file on the SD card (see sdcard.cpp), run as the data channel
+ *
+ *	{"run":"job.nc"} opens the file and makes it the data channel until it has all been read.
+ *	Lines are read as fast as the planner takes them, with no host in the loop - the host can
+ *	go away (or be reset) and the job carries on. The control channels are left as they are, so
+ *	JSON commands and the single character commands (! ~ % ^d ^x) still work from the host.
+ *	Data lines the host sends wait until the file has run. {"run":0} or a queue flush ends it.
+ *
+ *	The card is read a sector at a time into a ring of XIO_FILE_SECTORS sector buffers.
+ *	xio_callback() keeps the ring topped up, a sector per pass so a refill never holds up the
+ *	main loop for more than one card read. readAvailable() only goes to the card itself if the
+ *	ring has run dry. A LF is added after the last byte, so a last line without one still runs.
+ *
+ *	The file doesn't take part in the connection state machine. xio_set_run() sets it up as an
+ *	active data device and xio_callback() closes it once every line has been taken.
+ */
+struct xioFile {
+    uint8_t sector[XIO_FILE_SECTORS][SD_SECTOR_SIZE];
+    uint16_t sector_len[XIO_FILE_SECTORS];
+    uint8_t _head;							// oldest sector read
+    uint8_t _count;							// sectors read and not used up yet
+    uint16_t _index;						// next byte in the oldest sector
+    bool _open;								// there's more of the file on the card
+    bool _ended;							// the LF after the last byte has been read
+    stat_t status;							// STAT_OK, or the error that ended the file
+    char name[SD_NAME_MAX+1];
+
+    stat_t open(const char *filename) {
+        _head = 0;
+        _count = 0;
+        _index = 0;
+        _ended = false;
+        status = STAT_OK;
+        strncpy(name, filename, SD_NAME_MAX);
+        name[SD_NAME_MAX] = NUL;
+        stat_t opened = sd_open(filename, sector[0]);
+        _open = (opened == STAT_OK);
+        return (opened);
+    };
+
+    // fill() - read the next sector into the ring, if there's room and more to read
+    void fill() {
+        if (!_open || (_count == XIO_FILE_SECTORS)) {
+            return;
+        }
+        uint8_t slot = (_head + _count) % XIO_FILE_SECTORS;
+        int16_t len = sd_read(sector[slot]);
+        if (len <= 0) {
+            if (len < 0) {
+                status = STAT_NO_SUCH_DEVICE;	// the card stopped answering, or the file is broken
+            }
+            sd_close();
+            _open = false;
+            return;
+        }
+        sector_len[slot] = len;
+        _count++;
+    };
+
+    // isDone() - the whole file has been read from the ring
+    bool isDone() {
+        return (!_open && (_count == 0) && _ended);
+    };
+
+    void setConnectionCallback(std::function<void(bool)> &&callback) {};	// see above
+
+    int16_t readAvailable(uint8_t *buffer, const uint16_t length) {
+        if (_count == 0) {
+            fill();
+        }
+        if (_count == 0) {
+            if (_open || _ended) {
+                return (0);
+            }
+            buffer[0] = LF;
+            _ended = true;
+            return (1);
+        }
+        uint16_t run = min(length, (uint16_t)(sector_len[_head] - _index));
+        memcpy(buffer, &sector[_head][_index], run);
+        _index += run;
+        if (_index == sector_len[_head]) {
+            _index = 0;
+            _head = (_head + 1) % XIO_FILE_SECTORS;
+            _count--;
+        }
+        return (run);
+    };
+
+    int32_t writeSome(const uint8_t *data, const uint16_t length) {
+        return (length);						// nothing to write to - dropped
+    };
+
+    void flush() {};
+
+    void flushRead() {						// ends the file
+        if (_open) {
+            sd_close();
+            _open = false;
+        }
+        _count = 0;
+        _index = 0;
+        _ended = true;
+    };
+};
+
+xioFile SDFile;
+#endif // __FILE_CHANNEL
+
 // ALLOCATIONS
 // Declare a device wrapper class for SerialUSB and SerialUSB1
 xioDeviceWrapper<decltype(&SerialUSB)> serialUSB0Wrapper {
@@ -503,12 +1462,76 @@ xioDeviceWrapper<decltype(&SerialUSB1)> serialUSB1Wrapper {
     &SerialUSB1,
     (DEV_CAN_READ | DEV_CAN_WRITE | DEV_CAN_BE_CTRL | DEV_CAN_BE_DATA)
 };
+#ifdef __USB_VENDOR
+xioDeviceWrapper<decltype(&BulkUSB)> bulkUSBWrapper {
+    &BulkUSB,
+    (DEV_CAN_READ | DEV_CAN_WRITE | DEV_CAN_BE_CTRL | DEV_CAN_BE_DATA)
+};
+#endif
+#ifdef __USART_CHANNEL
+xioDeviceWrapper<decltype(&SerialUSART0)> serialUSART0Wrapper {
+    &SerialUSART0,
+    (DEV_CAN_READ | DEV_CAN_WRITE | DEV_CAN_BE_CTRL | DEV_CAN_BE_DATA)
+};
+#endif
+#ifdef __SPI_CHANNEL
+xioDeviceWrapper<decltype(&SerialSPI0)> serialSPI0Wrapper {
+    &SerialSPI0,
+    (DEV_CAN_READ | DEV_CAN_WRITE | DEV_CAN_BE_CTRL | DEV_CAN_BE_DATA)
+};
+#endif
+#ifdef __ETHERNET_CHANNEL
+#define ETH_CAPS (DEV_CAN_READ | DEV_CAN_WRITE | DEV_CAN_BE_CTRL | DEV_CAN_BE_DATA)
+xioDeviceWrapper<xioEthernet *> ethernetWrapper[ETH_SOCKETS] = {
+    { &EthernetSocket[0], ETH_CAPS }
+#if (ETH_SOCKETS > 1)
+    , { &EthernetSocket[1], ETH_CAPS }
+#endif
+#if (ETH_SOCKETS > 2)
+    , { &EthernetSocket[2], ETH_CAPS }, { &EthernetSocket[3], ETH_CAPS }
+#endif
+#if (ETH_SOCKETS > 4)
+    , { &EthernetSocket[4], ETH_CAPS }, { &EthernetSocket[5], ETH_CAPS }
+    , { &EthernetSocket[6], ETH_CAPS }, { &EthernetSocket[7], ETH_CAPS }
+#endif
+};
+#endif
+#ifdef __FILE_CHANNEL
+xioDeviceWrapper<decltype(&SDFile)> fileWrapper {
+    &SDFile,
+    (DEV_CAN_READ | DEV_CAN_BE_DATA | DEV_IS_STORAGE)
+};
+#endif
 
 // Define the xio singleton (and initialize it to hold our two deviceWrappers)
 //xio_t xio = { &serialUSB0Wrapper, &serialUSB1Wrapper };
 xio_t xio = {
     &serialUSB0Wrapper,
     &serialUSB1Wrapper
+#ifdef __USB_VENDOR
+    , &bulkUSBWrapper
+#endif
+#ifdef __USART_CHANNEL
+    , &serialUSART0Wrapper
+#endif
+#ifdef __SPI_CHANNEL
+    , &serialSPI0Wrapper
+#endif
+#ifdef __ETHERNET_CHANNEL
+    , &ethernetWrapper[0]
+#if (ETH_SOCKETS > 1)
+    , &ethernetWrapper[1]
+#endif
+#if (ETH_SOCKETS > 2)
+    , &ethernetWrapper[2], &ethernetWrapper[3]
+#endif
+#if (ETH_SOCKETS > 4)
+    , &ethernetWrapper[4], &ethernetWrapper[5], &ethernetWrapper[6], &ethernetWrapper[7]
+#endif
+#endif
+#ifdef __FILE_CHANNEL
+    , &fileWrapper
+#endif
 };
 
 /**** CODE ****/
@@ -528,7 +1551,18 @@ xio_t xio = {
 
 void xio_init()
 {
-    // Nothing left to do here, move along...
+#ifdef __USART_CHANNEL
+    SerialUSART0.begin(XIO_USART_BAUD);
+#endif
+#ifdef __SPI_CHANNEL
+    SerialSPI0.begin();
+#endif
+#ifdef __ETHERNET_CHANNEL
+    for (uint8_t s = 0; s < ETH_SOCKETS; s++) {
+        EthernetSocket[s].begin(s);
+    }
+    eth_init();								// nothing more happens if there's no W5500
+#endif
 }
 
 stat_t xio_test_assertions()
@@ -548,6 +1582,208 @@ size_t xio_write(const uint8_t *buffer, size_t size)
     return xio.write(buffer, size);
 }
 
+size_t xio_write_data(const uint8_t *buffer, size_t size)
+{
+    return xio.write_data(buffer, size);
+}
+
+uint16_t xio_tx_space()
+{
+    return xio.tx_space();
+}
+
+uint16_t xio_tx_space_data()
+{
+    return xio.tx_space_data();
+}
+
+#ifdef __REPORT_FANOUT
+/*
+ * xio_write_report() - queue one serialized report to every channel that gets it
+ * xio_get_subscribers() - channels with any of the flags in sub (DEV_SUB_xxx or DEV_RESYNC_xxx) and 'space' free
+ * xio_get_subscription() - reports the channel the last line came from is subscribed to (DEV_SUB_xxx)
+ * xio_set_subscription() - subscribe that channel to reports - see rpt_set_sub()
+ *
+ *	The report is serialized once by the caller and the same bytes are copied into the write
+ *	queue of each channel that gets it: the host's (host is DEV_IS_CTRL for the control
+ *	channels as xio_write(), DEV_IS_DATA for the data-only channel as xio_write_data(), or
+ *	DEV_FLAGS_CLEAR for none), then every other connected channel subscribed to 'sub'. The
+ *	caller has checked the control channels have room. Any other channel that doesn't misses
+ *	the report - a monitor that falls behind never holds up the host or the other monitors.
+ *
+ *	A channel that misses a report is marked with 'resync' (DEV_RESYNC_xxx, or DEV_FLAGS_CLEAR
+ *	if the caller deals with it). Until a report of every value reaches it - XIO_REPORT_FULL
+ *	or XIO_REPORT_RESYNC - it is skipped for the XIO_REPORT_CHANGES ones, which it can't make
+ *	sense of without the one it missed. A new subscription starts out marked the same way.
+ *	Subscriptions are device state, so they end when the channel disconnects.
+ *	Returns the number of channels that had no room for the report.
+ */
+
+uint8_t xio_write_report(const uint8_t *buffer, size_t size, devflags_t sub, devflags_t host,
+                         devflags_t resync, uint8_t kind)
+{
+    return xio.write_report(buffer, size, sub, host, resync, kind);
+}
+
+uint8_t xio_get_subscribers(devflags_t sub, uint16_t space)
+{
+    return xio.subscribers(sub, space);
+}
+
+devflags_t xio_get_subscription()
+{
+    if (xio.read_dev < 0) {
+        return (DEV_FLAGS_CLEAR);
+    }
+    return (xio.DeviceWrappers[xio.read_dev]->flags & DEV_SUB_MASK);
+}
+
+stat_t xio_set_subscription(devflags_t sub)
+{
+    if ((xio.read_dev < 0) || (xio.DeviceWrappers[xio.read_dev]->isStorage())) {
+        return (STAT_COMMAND_NOT_ACCEPTED);     // a file can't take reports
+    }
+    xioDeviceWrapperBase* dev = xio.DeviceWrappers[xio.read_dev];
+    sub &= DEV_SUB_MASK;
+    dev->flags = (dev->flags & ~(DEV_SUB_MASK | DEV_RESYNC_MASK)) | sub |
+                 ((sub & DEV_SUB_REPORTS) ? DEV_RESYNC_REPORTS : 0) | ((sub & DEV_SUB_STREAM) ? DEV_RESYNC_STREAM : 0);
+    return (STAT_OK);
+}
+
+/*
+ * xio_reply_to_reader() - send what is written from here on to the channel the last line came from
+ * xio_reply_to_ctrl()	 - send it to the control channels again, as usual
+ *
+ *	A command that only concerns the channel it came in on ({"sub":n} from a monitor on a
+ *	data-only channel) is answered there rather than on the host's control channel. The
+ *	controller goes back to the control channels once the line has been dispatched. Reports
+ *	go out through xio_write_report() and are not affected. Files can't be answered.
+ */
+
+void xio_reply_to_reader()
+{
+    if ((xio.read_dev >= 0) && (!xio.DeviceWrappers[xio.read_dev]->isStorage())) {
+        xio.reply_dev = xio.read_dev;
+    }
+}
+
+void xio_reply_to_ctrl()
+{
+    xio.reply_dev = -1;
+}
+#endif // __REPORT_FANOUT
+
+/*
+ * xio_mark_lines()       - number the lines that follow from 1 on every device
+ * xio_get_line_number()  - number of the last line read, counted from the mark
+ *
+ *	Lines are counted on each device as they are read, blank lines included, and a CRLF ends one
+ *	line. A binary frame counts as a line. The mark is the last line the controller took from
+ *	each device, so lines read ahead into the ring are still numbered from it. A file run from
+ *	the card is numbered from its own first line.
+ */
+void xio_mark_lines()
+{
+    for (uint8_t dev=0; dev < xio._dev_count; dev++) {
+        xio.DeviceWrappers[dev]->line_mark = xio.DeviceWrappers[dev]->taken_line_num;
+    }
+}
+
+int32_t xio_get_line_number()
+{
+    if (xio.read_dev < 0) {
+        return (0);
+    }
+    xioDeviceWrapperBase* dev = xio.DeviceWrappers[xio.read_dev];
+    return ((int32_t)(dev->taken_line_num - dev->line_mark));
+}
+
+/*
+ * xio_get_rx_credit() - line and byte credit granted to the host, and complete lines waiting
+ *
+ *	Defers to xio.rx_credit().
+ */
+uint8_t xio_get_rx_credit(uint16_t &lines, uint16_t &bytes)
+{
+    return xio.rx_credit(lines, bytes);
+}
+
+/*
+ * xio_get_ram_size() - RAM taken by the xio singleton and its device buffers, in bytes
+ */
+
+size_t xio_get_ram_size()
+{
+    return (sizeof(xio) + sizeof(serialUSB0Wrapper) + sizeof(serialUSB1Wrapper)
+#ifdef __USART_CHANNEL
+        + sizeof(serialUSART0Wrapper)
+#endif
+#ifdef __SPI_CHANNEL
+        + sizeof(serialSPI0Wrapper)
+#endif
+#ifdef __ETHERNET_CHANNEL
+        + sizeof(ethernetWrapper) + sizeof(EthernetSocket)
+#endif
+#ifdef __FILE_CHANNEL
+        + sizeof(fileWrapper) + sizeof(SDFile)
+#endif
+        );
+}
+
+#ifdef __FILE_CHANNEL
+/*
+ * _end_file() - report a file that has been run and give the data channel back
+ *
+ *	{"run":{"file":"job.nc","lines":n,"stat":0}} - lines taken by the controller, and the status
+ *	the file ended with. It's sent once the last line has been taken, so the last moves may still
+ *	be running.
+ */
+static void _end_file()
+{
+    printf_P(PSTR("{\"run\":{\"file\":\"%s\",\"lines\":%u,\"stat\":%d}}\n"),
+        SDFile.name, fileWrapper.rx_lines_taken, SDFile.status);
+    fileWrapper.clearFlags();
+    fileWrapper.flushRead();
+}
+#endif
+
+/*
+ * xio_callback() - main loop callback to keep the write queues draining and catch realtime commands
+ *
+ *	Motate has no IN-complete hook to hang this on, so the queues are drained from the main loop
+ *	(and after every write). Single character commands (! ~ % ^d ^x) on the control channels are
+ *	dispatched from here as they arrive, rather than when the controller next reads a line.
+ *	A file being run is read ahead here too, and closed once it has all been taken.
+ *	Returns STAT_NOOP - this never holds up the rest of the dispatcher.
+ */
+stat_t xio_callback()
+{
+#ifdef __USART_CHANNEL
+    SerialUSART0.poll();
+#endif
+#ifdef __SPI_CHANNEL
+    SerialSPI0.poll();
+#endif
+#ifdef __ETHERNET_CHANNEL
+    if (eth_poll()) {
+        for (uint8_t s = 0; s < ETH_SOCKETS; s++) {
+            EthernetSocket[s].poll();
+        }
+    }
+#endif
+#ifdef __FILE_CHANNEL
+    if (fileWrapper.isActive()) {
+        SDFile.fill();
+        if (SDFile.isDone() && fileWrapper.isDrained()) {
+            _end_file();
+        }
+    }
+#endif
+    xio.pollRealtime();
+    xio.drainWrite();
+    return (STAT_NOOP);
+}
+
 /*
  * readline() - read a complete line from a device
  *
@@ -591,6 +1827,42 @@ void xio_flush_read()
 //	return (STAT_OK);
 //}
 
+#ifdef __FILE_CHANNEL
+/*
+ * xio_set_run() - {"run":"job.nc"} runs a file from the SD card - see xioFile
+ * xio_get_run() - {"run":null} returns the name of the file being run, or "" if there isn't one
+ *
+ *	Any non-string value ({"run":0}) ends the file being run. Lines already taken still run.
+ *	Opening the card takes up to a second - it's initialized and mounted for each file.
+ */
+stat_t xio_set_run(nvObj_t *nv)
+{
+    if (nv->valuetype != TYPE_STRING) {
+        if (fileWrapper.isActive()) {
+            SDFile.flushRead();             // closed by xio_callback()
+        }
+        nv->valuetype = TYPE_NULL;
+        return (STAT_OK);
+    }
+    if (fileWrapper.isActive()) {
+        return (STAT_COMMAND_NOT_ACCEPTED); // one at a time
+    }
+    fileWrapper.flushRead();
+    fileWrapper._restartLines();            // the file's first line is line 1
+    ritorno(SDFile.open(*nv->stringp));
+    fileWrapper.setAsConnectedAndReady();
+    fileWrapper.setAsActiveData();
+    return (STAT_OK);
+}
+
+stat_t xio_get_run(nvObj_t *nv)
+{
+    ritorno(nv_copy_string(nv, fileWrapper.isActive() ? SDFile.name : ""));
+    nv->valuetype = TYPE_STRING;
+    return (STAT_OK);
+}
+#endif // __FILE_CHANNEL
+
 /***********************************************************************************
  * TEXT MODE SUPPORT
  * Functions to print variables from the cfgArray table
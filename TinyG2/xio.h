@@ -67,8 +67,15 @@
 //#include "tinyg2.h"				// not required if used in tinyg project
 #include "config.h"					// required for nvObj typedef
 #include "MotateUSB.h"
+#ifdef __USB_VENDOR
+#define MOTATE_USB_CDC_READ_BANKS kEndpointBufferBlocks1	// leaves DPRAM for the vendor endpoints at high speed
+#include "MotateUSBVendor.h"
+#endif
 #include "MotateUSBCDC.h"
 #include "MotateSPI.h"
+#ifdef __ETHERNET_CHANNEL
+#include "ethernet.h"
+#endif
 
 
 /**** Defines, Macros, and  Assorted Parameters ****/
@@ -80,6 +87,43 @@
 #define _FDEV_EOF -2
 
 #define USB_LINE_BUFFER_SIZE	255			// text buffer size
+#ifndef XIO_RX_LINES
+#define XIO_RX_LINES			4			// lines each device can read ahead of the controller
+#endif
+#ifndef XIO_TX_BUFFER_SIZE
+#define XIO_TX_BUFFER_SIZE		1024		// bytes each device can queue for writing - see xio_callback()
+#endif
+#ifndef XIO_TX_HEADROOM
+#define XIO_TX_HEADROOM			(OUTPUT_BUFFER_LEN)	// queue space to keep free before taking new commands or sending reports
+#endif
+#ifndef XIO_USART_BAUD
+#define XIO_USART_BAUD			115200		// USART channel baud rate - up to 2000000 (see __USART_CHANNEL)
+#endif
+#ifndef XIO_USART_RX_BUFFER_SIZE
+#define XIO_USART_RX_BUFFER_SIZE 512		// USART channel receive DMA ring - must be even
+#endif
+#ifndef XIO_SPI_BLOCK_SIZE
+#define XIO_SPI_BLOCK_SIZE		64			// SPI channel transfer block - a count byte and up to 63 data bytes
+#endif
+#ifndef XIO_SPI_BUFFER_SIZE
+#define XIO_SPI_BUFFER_SIZE		512			// SPI channel receive and transmit rings
+#endif
+#ifndef XIO_RX_CREDIT_BYTES
+#define XIO_RX_CREDIT_BYTES		512			// bytes a host may send ahead of the controller - see xio_get_rx_credit()
+#endif
+#ifndef XIO_RX_CHUNK_SIZE
+#define XIO_RX_CHUNK_SIZE		64			// bytes read from a device at a time - a full speed USB packet
+#endif
+#ifndef XIO_FILE_SECTORS
+#define XIO_FILE_SECTORS		2			// file channel read-ahead - card sectors read ahead of the parser
+#endif
+
+#if defined(__FILE_CHANNEL) && defined(__SPI_CHANNEL)
+#error __FILE_CHANNEL and __SPI_CHANNEL both need SPI0 - the SD card as master, the host as slave
+#endif
+#if defined(__ETHERNET_CHANNEL) && defined(__SPI_CHANNEL)
+#error __ETHERNET_CHANNEL and __SPI_CHANNEL both need SPI0 - the W5500 as master, the host as slave
+#endif
 
 //*** Device flags ***
 typedef uint16_t devflags_t;				// might need to bump to 32 be 16 or 32
@@ -89,6 +133,7 @@ typedef uint16_t devflags_t;				// might need to bump to 32 be 16 or 32
 #define DEV_CAN_BE_DATA		(0x0002)		// device can be a data channel
 #define DEV_CAN_READ		(0x0010)
 #define DEV_CAN_WRITE		(0x0020)
+#define DEV_IS_STORAGE		(0x0040)		// device is local storage, not a connection - see xioFile
 
 // Device state flags
 // channel state
@@ -96,6 +141,14 @@ typedef uint16_t devflags_t;				// might need to bump to 32 be 16 or 32
 #define DEV_IS_DATA			(0x0002)		// device is set as a data channel
 #define DEV_IS_PRIMARY		(0x0004)		// device is the primary control channel
 
+// report subscriptions - see xio_write_report()
+#define DEV_SUB_REPORTS		(0x0008)		// channel gets the status and watch reports
+#define DEV_SUB_STREAM		(0x0010)		// channel gets the binary status stream
+#define DEV_SUB_MASK		(DEV_SUB_REPORTS | DEV_SUB_STREAM)
+#define DEV_RESYNC_REPORTS	(0x0800)		// channel missed a status report - the next one it gets carries every value
+#define DEV_RESYNC_STREAM	(0x1000)		// channel missed a stream frame - likewise
+#define DEV_RESYNC_MASK		(DEV_RESYNC_REPORTS | DEV_RESYNC_STREAM)
+
 // device connection state
 #define DEV_IS_CONNECTED	(0x0020)		// device is connected (e.g. USB)
 #define DEV_IS_READY		(0x0040)		// device is ready for use
@@ -104,25 +157,82 @@ typedef uint16_t devflags_t;				// might need to bump to 32 be 16 or 32
 // device exception flags
 #define DEV_THROW_EOF		(0x0100)		// end of file encountered
 
+// read result flags (returned by xio_readline(), never set in the device)
+#define DEV_RX_FRAME		(0x0200)		// the buffer holds a binary data frame, not a line
+#define DEV_RX_FILE			(0x0400)		// the line was read from a file being run, not sent by the host
+
 // device specials
 #define DEV_IS_BOTH			(DEV_IS_CTRL | DEV_IS_DATA)
 #define DEV_FLAGS_CLEAR		(0x0000)		// Apply as flags = DEV_FLAGS_CLEAR;
 
+enum xioReportKind {						// what a report passed to xio_write_report() carries
+	XIO_REPORT_CHANGES = 0,					// values changed since the last report - skips channels waiting to resync
+	XIO_REPORT_FULL,						// every value - resyncs the channels it goes to
+	XIO_REPORT_RESYNC						// every value, only to the channels waiting to resync
+};
+
 enum xioDeviceEnum {						// reconfigure this enum as you add more physical devices
 	DEV_NONE=-1,							// no device is bound
 	DEV_USB0=0,								// must be 0
 	DEV_USB1,								// must be 1
-//	DEV_SPI0,                               // We can't have it here until we actually define it
+#ifdef __USB_VENDOR
+	DEV_USBBULK,							// vendor class bulk interface - see MotateUSBVendor.h
+#endif
+#ifdef __USART_CHANNEL
+	DEV_USART0,								// hardware serial - see xioUSART in xio.cpp
+#endif
+#ifdef __SPI_CHANNEL
+	DEV_SPI0,								// SPI slave - see xioSPISlave in xio.cpp
+#endif
+#ifdef __ETHERNET_CHANNEL
+	DEV_ETH0,								// W5500 TCP sockets, ETH_SOCKETS of them - see xioEthernet in xio.cpp
+	DEV_ETH_LAST = DEV_ETH0 + ETH_SOCKETS - 1,
+#endif
+#ifdef __FILE_CHANNEL
+	DEV_FILE0,								// SD card file - see xioFile in xio.cpp
+#endif
 	DEV_MAX
 };
 
+/* Binary data frames
+ *
+ *	With __BINARY_DATA a data-only channel also takes framed binary records. A frame is
+ *	recognized by an STX as the first character of a line, so text lines still work:
+ *
+ *	  STX len seq type payload[len] crc_lo crc_hi
+ *
+ *	  len	- payload length in bytes, 0 - XIO_FRAME_PAYLOAD_MAX
+ *	  seq	- host sequence number, returned in acknowledgements
+ *	  type	- record type - see controller.cpp
+ *	  crc	- compute_crc16() of len, seq, type and the payload
+ *
+ *	Frames are not terminated and never contain special characters - the bytes are taken
+ *	as-is until the length is satisfied.
+ */
+#define XIO_FRAME_HEADER_LEN	4			// STX, len, seq, type
+#define XIO_FRAME_CRC_LEN		2
+#define XIO_FRAME_PAYLOAD_MAX	(USB_LINE_BUFFER_SIZE - XIO_FRAME_HEADER_LEN - XIO_FRAME_CRC_LEN)
+
+enum xioFrameField {						// byte offsets into a frame
+	XIO_FRAME_STX = 0,
+	XIO_FRAME_LEN,
+	XIO_FRAME_SEQ,
+	XIO_FRAME_TYPE,
+	XIO_FRAME_PAYLOAD
+};
+
 enum xioSPIMode {
 	SPI_DISABLE=0,							// tri-state SPI lines
 	SPI_ENABLE								// enable SPI lines for output
 };
 
 //extern Motate::USBDevice< Motate::USBCDC > usb;
+#ifdef __USB_VENDOR
+extern Motate::USBDevice< Motate::USBCDC, Motate::USBCDC, Motate::USBVendor > usb;
+extern decltype(usb._mixin_2_type::Bulk) &BulkUSB;
+#else
 extern Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
+#endif
 extern decltype(usb._mixin_0_type::Serial) &SerialUSB;
 extern decltype(usb._mixin_1_type::Serial) &SerialUSB1;
 
@@ -136,8 +246,29 @@ stat_t xio_test_assertions(void);
 char *xio_readline(devflags_t &flags, uint16_t &size);
 void xio_flush_read();
 size_t xio_write(const uint8_t *buffer, size_t size);
+size_t xio_write_data(const uint8_t *buffer, size_t size);
+size_t xio_get_ram_size(void);
+uint8_t xio_get_rx_credit(uint16_t &lines, uint16_t &bytes);
+void xio_mark_lines(void);
+int32_t xio_get_line_number(void);
+uint16_t xio_tx_space();
+uint16_t xio_tx_space_data();
+#ifdef __REPORT_FANOUT
+uint8_t xio_write_report(const uint8_t *buffer, size_t size, devflags_t sub, devflags_t host,
+						 devflags_t resync, uint8_t kind);
+uint8_t xio_get_subscribers(devflags_t sub, uint16_t space);
+devflags_t xio_get_subscription();
+stat_t xio_set_subscription(devflags_t sub);
+void xio_reply_to_reader();
+void xio_reply_to_ctrl();
+#endif
+stat_t xio_callback();
 
 stat_t xio_set_spi(nvObj_t *nv);
+#ifdef __FILE_CHANNEL
+stat_t xio_get_run(nvObj_t *nv);
+stat_t xio_set_run(nvObj_t *nv);
+#endif
 
 /* Some useful ASCII definitions */
 
@@ -170,6 +301,16 @@ stat_t xio_set_spi(nvObj_t *nv);
 #define CHAR_FEEDHOLD (char)'!'
 #define CHAR_CYCLE_START (char)'~'
 #define CHAR_QUEUE_FLUSH (char)'%'
+#define CHAR_FEED_OVR_RESET (char)0x90		// feed override to 100%
+#define CHAR_FEED_OVR_PLUS (char)0x91		// feed override +10%
+#define CHAR_FEED_OVR_MINUS (char)0x92		// feed override -10%
+#define CHAR_FEED_OVR_FINE_PLUS (char)0x93	// feed override +1%
+#define CHAR_FEED_OVR_FINE_MINUS (char)0x94	// feed override -1%
+#define CHAR_TRAV_OVR_RESET (char)0x95		// traverse override to 100%
+#define CHAR_TRAV_OVR_HALF (char)0x96		// traverse override to 50%
+#define CHAR_TRAV_OVR_QUARTER (char)0x97	// traverse override to 25%
+#define CHAR_OVR_FIRST CHAR_FEED_OVR_RESET
+#define CHAR_OVR_LAST CHAR_TRAV_OVR_QUARTER
 //#define CHAR_BOOTLOADER ESC
 
 #ifdef __TEXT_MODE
@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""
+gcode_precompile.py - precompile a Gcode program into binary move records
+
+Parsing Gcode is the slowest part of feeding the firmware. This runs the program through
+the firmware's own parser and canonical machine, built for the host (make PLATFORM=host),
+as a dry plan. The simulator writes every move it sends to the planner - G0, G1 and the
+lines an arc is cut into - as a machine coordinate target in mm with its feed rate (see
+platform/host/host.h). Those become 'P' records for the binary data channel (see
+_dispatch_frame() in controller.cpp), which the firmware hands straight to the planner
+through cm_machine_feed(): no parsing, no unit or offset conversion and no arc math.
+
+    Tools/gcode_precompile.py job.nc -o job.bin
+    Tools/gcode_precompile.py job.nc -o job.bin --settings machine.json --start 0,0,25
+
+The output is a stream of frames as the data channel takes them - STX len seq type
+payload crc (see xio.h) - for a sender to write out within the acknowledgement window.
+
+Only lines that are nothing but motion are precompiled - G0-G3 with axis, arc and feed
+words and an N word. Every other line goes as a 'G' record of its Gcode text, so modal
+state (units, offsets, planes, spindle...) still changes on the controller the same way.
+So does a motion line with no recorded moves - an arc the planner takes whole
+(__PLANNER_ARCS) isn't cut into lines. Comments are dropped, but a line with a (MSG or
+a (VEX hint is sent as Gcode.
+
+The targets are only right for the settings and the position the program was compiled
+from. Pass the machine's settings with --settings (a file of JSON or $ lines) and, for a
+program that moves relative to where it starts, the starting machine position with
+--start. The controller's position after homing or probing can't be known here, so every
+line from the first G28.2, G28.4 or G38.x on is sent as Gcode.
+"""
+
+import argparse
+import os
+import re
+import struct
+import subprocess
+import sys
+import tempfile
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+FIRMWARE_DIR = os.path.join(TOOLS_DIR, '..', 'TinyG2')
+HOST_BIN = os.path.join(FIRMWARE_DIR, 'bin', 'host', 'host')
+
+AXES = 6
+STX = 0x02
+FRAME_PAYLOAD_MAX = 249                         # XIO_FRAME_PAYLOAD_MAX in xio.h
+
+COMMENT = re.compile(r'\(.*?\)|;.*$')
+LINE_NUMBER = re.compile(r'^[Nn]\s*(\d+)\s*')
+WORD = re.compile(r'([A-Z])\s*([-+]?[0-9.]+)')
+MOTION_WORDS = set('XYZABCIJKRFN')
+MOTION_MODES = {0, 1, 2, 3}
+BLIND = re.compile(r'G\s*0*(28\.[24]|38\.\d)(?![0-9])')    # homing and probing
+
+
+def _crc16(data):
+    """ compute_crc16() in util.cpp - CRC-16/CCITT, initial value 0xFFFF """
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def frame(seq, kind, payload):
+    """ one data channel frame - see xio.h """
+    body = bytes([len(payload), seq & 0xFF, ord(kind)]) + payload
+    crc = _crc16(body)
+    return bytes([STX]) + body + bytes([crc & 0xFF, crc >> 8])
+
+
+def machine_record(linenum, motion_mode, feed_rate, target):
+    """ 'P' record payload - see _run_machine_frame() in controller.cpp """
+    return struct.pack('<BIf%df' % AXES, motion_mode, linenum, feed_rate, *target)
+
+
+def _is_gcode(line):
+    """ true for a line of Gcode words, not a comment, a block delete, JSON or a $ command """
+    s = line.strip()
+    return bool(s) and s[0] not in '(;%/{$!~'
+
+
+def is_motion_only(line):
+    """ true if the line is nothing but a G0-G3 move - the lines that are precompiled """
+    comments = ''.join(COMMENT.findall(line)).upper()
+    if 'MSG' in comments or 'VEX' in comments:
+        return False
+    words = COMMENT.sub('', line).upper()
+    found = WORD.findall(words)
+    if not found or len(''.join(l + v for l, v in found)) != len(re.sub(r'\s', '', words)):
+        return False                            # something that isn't a word
+    for letter, value in found:
+        if letter == 'G':
+            if float(value) not in MOTION_MODES or '.' in value:
+                return False
+        elif letter not in MOTION_WORDS:
+            return False
+    return True
+
+
+def own_line_number(line):
+    m = LINE_NUMBER.match(line.strip())
+    return int(m.group(1)) if m else 0
+
+
+def number_lines(lines):
+    """ the program with each Gcode line's N word set to its line number in the file """
+    numbered = []
+    for i, line in enumerate(lines, 1):
+        if _is_gcode(line):
+            line = 'N%d %s' % (i, LINE_NUMBER.sub('', line.strip()))
+        numbered.append(line)
+    return numbered
+
+
+def record_moves(settings, start, program, timeout):
+    """ run a dry plan over the program, return {file line number: [(mode, feed, target)...]} """
+    with tempfile.TemporaryDirectory() as tmp:
+        nc = os.path.join(tmp, 'program.nc')
+        move_file = os.path.join(tmp, 'moves.txt')
+        with open(nc, 'w') as f:
+            f.write(''.join(s.rstrip('\n') + '\n' for s in settings))
+            if start:
+                f.write('G28.3 %s\n' % ' '.join('%s%s' % a for a in zip('XYZABC', start)))
+            f.write('{"dry":1}\n')
+            f.write(''.join(s.rstrip('\n') + '\n' for s in program))
+            f.write('{"dry":0}\n')
+        subprocess.run([HOST_BIN, nc, os.devnull, os.devnull, move_file], stdout=subprocess.DEVNULL,
+                       stderr=subprocess.DEVNULL, timeout=timeout, check=False)
+        moves = {}
+        with open(move_file) as f:
+            for line in f:
+                v = line.split()
+                moves.setdefault(int(v[0]), []).append((int(v[1]), float(v[2]), [float(x) for x in v[3:]]))
+    return moves
+
+
+def precompile(lines, moves):
+    """ the frames for the program, and (lines precompiled, lines sent as Gcode) """
+    frames = []
+    counts = [0, 0]
+    blind = False
+    for i, line in enumerate(lines, 1):
+        text = line.strip()
+        if not text:
+            continue
+        if text[0] in '{$':
+            raise ValueError('line %d: %s is not Gcode - send it on the control channel' % (i, text))
+        if text[0] in '(;' and 'MSG' not in text.upper():
+            continue                            # a comment line does nothing
+        blind = blind or bool(BLIND.search(COMMENT.sub('', text).upper()))
+        if not blind and i in moves and is_motion_only(text):
+            linenum = own_line_number(text)
+            for motion_mode, feed_rate, target in moves[i]:
+                frames.append(('P', machine_record(linenum, motion_mode, feed_rate, target)))
+            counts[0] += 1
+        else:
+            payload = text.encode('latin-1')
+            if len(payload) > FRAME_PAYLOAD_MAX:
+                raise ValueError('line %d is longer than a frame takes (%d characters)' % (i, FRAME_PAYLOAD_MAX))
+            frames.append(('G', payload))
+            counts[1] += 1
+    return [frame(seq, kind, payload) for seq, (kind, payload) in enumerate(frames)], counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Precompile a Gcode file into binary move records')
+    parser.add_argument('program', help='Gcode file to precompile')
+    parser.add_argument('-o', '--output', required=True, help='file of frames to write')
+    parser.add_argument('--settings', help='settings to send first - JSON or $ lines, one per line')
+    parser.add_argument('--start', help='machine position the program starts from, e.g. 0,0,25')
+    parser.add_argument('--timeout', type=float, default=600.0, help='real seconds allowed for the dry plan (600)')
+    args = parser.parse_args()
+
+    if not os.path.exists(HOST_BIN):
+        print('%s not found - build it with "make PLATFORM=host" in TinyG2' % HOST_BIN)
+        return 2
+    with open(args.program, encoding='latin-1') as f:
+        lines = f.readlines()
+    settings = []
+    if args.settings:
+        with open(args.settings, encoding='latin-1') as f:
+            settings = [s for s in f.readlines() if s.strip()]
+    start = [float(v) for v in args.start.split(',')] if args.start else []
+
+    moves = record_moves(settings, start, number_lines(lines), args.timeout)
+    try:
+        frames, (compiled, text) = precompile(lines, moves)
+    except ValueError as e:
+        print('%s: %s' % (args.program, e))
+        return 1
+    with open(args.output, 'wb') as f:
+        f.write(b''.join(frames))
+    print('%s: %d lines precompiled, %d sent as Gcode - %d frames, %d bytes' % (args.program, compiled,
+          text, len(frames), sum(len(fr) for fr in frames)))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
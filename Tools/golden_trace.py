@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+"""
+golden_trace.py - motion regression over the Gcode corpus on the host build
+
+Runs each program in TinyG2/gcode/*.h and TinyG2/tests/*.h through the simulator
+(make PLATFORM=host, or make regress) and compares the motion with the golden trace checked in under
+TinyG2/tests/golden. The simulator writes every segment prepped by st_prep_line() -
+prep time, segment time and travel steps per motor (see platform/host/host.h). Those
+are summed into motor positions and kept in the golden file as:
+
+    # <program> segments <n> time_us <total segment time>
+    end <motor 1 position> ... <motor N position>
+    <segment time, us> <motor 1 position> ... <motor N position>    one per sample
+
+Samples are taken every --sample ms of segment time, so a change that only moves segment
+boundaries compares clean. A program fails if any motor is more than --steps away from the
+golden position at a sample or at the end, or if its total time moved by more than --time
+percent. The report gives the worst position deviation and the time delta for each one.
+
+    Tools/golden_trace.py                    compare everything
+    Tools/golden_trace.py braid mudflap      compare programs whose name contains these
+    Tools/golden_trace.py --update           (re)write the golden traces from this build
+    Tools/golden_trace.py --list             list the programs
+
+Programs that need a person or the hardware (homing, feedhold, json...) are in SKIP. A
+program that fails to come to rest within --timeout seconds of real time is an error.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+FIRMWARE_DIR = os.path.join(TOOLS_DIR, '..', 'TinyG2')
+HOST_BIN = os.path.join(FIRMWARE_DIR, 'bin', 'host', 'host')
+GOLDEN_DIR = os.path.join(FIRMWARE_DIR, 'tests', 'golden')
+CORPUS = ['gcode', 'tests']
+
+SKIP = {
+    'test_002_homing',          # needs switches
+    'test_006_feedhold',        # needs ! and ~ typed in
+    'test_008_json',            # exercises the parser, not motion
+    'test_009_inverse_time',    # hours of simulated motion at f0.01
+    'gcode_debug_tests',        # M6 waits for a cycle start
+    'test_099',                 # scratch file
+}
+
+ARRAY = re.compile(r'const\s+char\s+(?:PROGMEM\s+)?(\w+)\s*\[\s*\]\s*(?:PROGMEM\s*)?=\s*((?:"(?:[^"\\]|\\.)*"\s*)+);', re.S)
+LITERAL = re.compile(r'"((?:[^"\\]|\\.)*)"', re.S)
+ESCAPES = {'n': '\n', 't': '\t', 'r': '\r', '"': '"', '\\': '\\', '\n': ''}
+
+
+def _unescape(s):
+    return re.sub(r'\\(.)', lambda m: ESCAPES.get(m.group(1), m.group(1)), s, flags=re.S)
+
+
+def load_corpus():
+    """ {name: gcode} for every program in the corpus. A file with one program names it. """
+    programs = {}
+    for d in CORPUS:
+        path = os.path.join(FIRMWARE_DIR, d)
+        for f in sorted(os.listdir(path)):
+            if not f.endswith('.h'):
+                continue
+            with open(os.path.join(path, f), encoding='latin-1') as h:
+                text = re.sub(r'/\*.*?\*/', '', h.read(), flags=re.S)
+            arrays = ARRAY.findall(text)
+            stem = f[:-2]
+            for name, literals in arrays:
+                program = stem if len(arrays) == 1 else stem + '.' + name
+                if stem in SKIP or program in SKIP:
+                    continue
+                programs[program] = ''.join(_unescape(s) for s in LITERAL.findall(literals))
+    return programs
+
+
+def run_program(gcode, timeout):
+    """ run the simulator over gcode, return the trace as [(segment_us, [steps...]), ...] """
+    with tempfile.TemporaryDirectory() as tmp:
+        nc = os.path.join(tmp, 'program.nc')
+        trace = os.path.join(tmp, 'trace.txt')
+        with open(nc, 'w') as f:
+            f.write(gcode if gcode.endswith('\n') else gcode + '\n')
+        subprocess.run([HOST_BIN, nc, trace], stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                       timeout=timeout, check=False)
+        segments = []
+        with open(trace) as f:
+            for line in f:
+                v = line.split()
+                segments.append((float(v[1]), [float(x) for x in v[2:]]))
+    return segments
+
+
+def summarize(segments, sample_us):
+    """ collapse a trace to its totals and motor positions sampled on segment time """
+    motors = len(segments[0][1]) if segments else 0
+    position = [0.0] * motors
+    time = 0.0
+    samples = []
+    next_sample = sample_us
+    for segment_us, steps in segments:
+        time += segment_us
+        position = [p + s for p, s in zip(position, steps)]
+        if time >= next_sample:
+            samples.append((time, list(position)))
+            next_sample = (int(time // sample_us) + 1) * sample_us
+    return {'segments': len(segments), 'time': time, 'end': position, 'samples': samples}
+
+
+def write_golden(path, name, summary):
+    with open(path, 'w') as f:
+        f.write('# %s segments %d time_us %.0f\n' % (name, summary['segments'], summary['time']))
+        f.write('end %s\n' % ' '.join('%.2f' % p for p in summary['end']))
+        for t, position in summary['samples']:
+            f.write('%.0f %s\n' % (t, ' '.join('%.2f' % p for p in position)))
+
+
+def read_golden(path):
+    summary = {'samples': []}
+    with open(path) as f:
+        for line in f:
+            v = line.split()
+            if v[0] == '#':
+                summary['segments'] = int(v[3])
+                summary['time'] = float(v[5])
+            elif v[0] == 'end':
+                summary['end'] = [float(x) for x in v[1:]]
+            else:
+                summary['samples'].append((float(v[0]), [float(x) for x in v[1:]]))
+    return summary
+
+
+def _position_at(samples, t):
+    """ motor positions at segment time t, interpolated between samples """
+    lo = (0.0, [0.0] * len(samples[0][1]))
+    for hi in samples:
+        if hi[0] >= t:
+            f = (t - lo[0]) / (hi[0] - lo[0]) if hi[0] > lo[0] else 1.0
+            return [a + (b - a) * f for a, b in zip(lo[1], hi[1])]
+        lo = hi
+    return lo[1]
+
+
+def compare(golden, summary):
+    """ worst motor deviation in steps over the samples and the end, and the time delta in % """
+    deviation = max([abs(a - b) for a, b in zip(golden['end'], summary['end'])] or [0])
+    if golden['samples'] and summary['samples']:
+        for t, position in summary['samples']:
+            if t <= golden['samples'][-1][0]:
+                expect = _position_at(golden['samples'], t)
+                deviation = max([deviation] + [abs(a - b) for a, b in zip(expect, position)])
+    time_delta = 0.0
+    if golden['time'] > 0:
+        time_delta = 100.0 * (summary['time'] - golden['time']) / golden['time']
+    return deviation, time_delta
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare simulator motion with the golden traces')
+    parser.add_argument('programs', nargs='*', help='run programs whose name contains any of these')
+    parser.add_argument('--update', action='store_true', help='write the golden traces from this build')
+    parser.add_argument('--list', action='store_true', help='list the programs and exit')
+    parser.add_argument('--steps', type=float, default=2.0, help='allowed position deviation, steps (2)')
+    parser.add_argument('--time', type=float, default=0.5, help='allowed total time change, percent (0.5)')
+    parser.add_argument('--sample', type=float, default=100.0, help='position sample interval, ms (100)')
+    parser.add_argument('--timeout', type=float, default=300.0, help='real seconds allowed per program (300)')
+    args = parser.parse_args()
+
+    programs = load_corpus()
+    names = [n for n in sorted(programs) if not args.programs or any(p in n for p in args.programs)]
+    if args.list:
+        print('\n'.join(names))
+        return 0
+    if not os.path.exists(HOST_BIN):
+        print('%s not found - build it with "make PLATFORM=host" in TinyG2' % HOST_BIN)
+        return 2
+    os.makedirs(GOLDEN_DIR, exist_ok=True)
+
+    failed = 0
+    print('%-40s %8s %12s %10s %8s' % ('program', 'segments', 'time_s', 'dev_steps', 'time_%'))
+    for name in names:
+        path = os.path.join(GOLDEN_DIR, name + '.golden')
+        try:
+            summary = summarize(run_program(programs[name], args.timeout), args.sample * 1000)
+        except subprocess.TimeoutExpired:
+            print('%-40s did not come to rest' % name)
+            failed += 1
+            continue
+        if args.update:
+            write_golden(path, name, summary)
+            print('%-40s %8d %12.3f %10s %8s' % (name, summary['segments'], summary['time'] / 1e6, 'written', ''))
+            continue
+        if not os.path.exists(path):
+            print('%-40s %8d %12.3f %10s %8s' % (name, summary['segments'], summary['time'] / 1e6, 'no golden', ''))
+            failed += 1
+            continue
+        deviation, time_delta = compare(read_golden(path), summary)
+        bad = (deviation > args.steps) or (abs(time_delta) > args.time)
+        failed += bad
+        print('%-40s %8d %12.3f %10.3f %+8.3f%s' % (name, summary['segments'], summary['time'] / 1e6,
+              deviation, time_delta, '  FAIL' if bad else ''))
+
+    if not args.update:
+        print('%d of %d programs failed' % (failed, len(names)))
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
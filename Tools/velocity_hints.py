@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+"""
+velocity_hints.py - plan a stored job over the whole program and write the exit hints into it
+
+The firmware's lookahead only reaches as far as its planner queue, so the newest block is
+always planned to stop at its end. On dense programs of tiny segments the queue is short in
+time and that planned stop holds the feed down. This runs the program through a dry plan
+in the simulator (make PLATFORM=host), which writes the limits of every block it plans -
+length, junction and exit vmax, and the velocity the block can brake by (see
+platform/host/host.h). A backward pass over the whole program then gives each block the
+fastest exit the rest of the program can still stop from, and that is written back into the
+program as a comment on the line that ends the block:
+
+    G1 X10.5 Y3.2 (VEX1843.0)
+
+With $vh=1 (built with __VELOCITY_HINTS) the firmware plans the newest block to its hint
+instead of to a stop - see _get_exit_hint() in plan_line.cpp. Other controllers ignore the
+comment. The hints are only good for the settings they were planned with, so pass the
+machine's settings with --settings (a file of JSON or $ lines, as sent to the controller).
+
+    Tools/velocity_hints.py job.nc -o jobvh.nc
+    Tools/velocity_hints.py job.nc -o jobvh.nc --settings machine.json --margin 0.9
+
+Lines that already have a comment get the hint in front of it, so the comment is no longer
+read - except (MSG lines, which are left without a hint. The report gives the dry plan job
+time without and with the hints.
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+TOOLS_DIR = os.path.dirname(os.path.abspath(__file__))
+FIRMWARE_DIR = os.path.join(TOOLS_DIR, '..', 'TinyG2')
+HOST_BIN = os.path.join(FIRMWARE_DIR, 'bin', 'host', 'host')
+
+LINE_NUMBER = re.compile(r'^[Nn]\s*\d+\s*')
+DRY_TIME = re.compile(r'"dry":([0-9.]+)')
+
+
+def _is_gcode(line):
+    """ true for a line of Gcode words, not a comment, a block delete, JSON or a $ command """
+    s = line.strip()
+    return bool(s) and s[0] not in '(;%/{$!~'
+
+
+def number_lines(lines):
+    """ the program with each Gcode line's N word set to its line number in the file """
+    numbered = []
+    for i, line in enumerate(lines, 1):
+        if _is_gcode(line):
+            line = 'N%d %s' % (i, LINE_NUMBER.sub('', line.strip()))
+        numbered.append(line)
+    return numbered
+
+
+def dry_plan(settings, program, timeout, blocks=False):
+    """ run a dry plan over the program, return (job seconds, [blocks]) """
+    with tempfile.TemporaryDirectory() as tmp:
+        nc = os.path.join(tmp, 'program.nc')
+        block_file = os.path.join(tmp, 'blocks.txt')
+        with open(nc, 'w') as f:
+            f.write(''.join(s.rstrip('\n') + '\n' for s in settings))
+            f.write('{"dry":1}\n')
+            f.write(''.join(s.rstrip('\n') + '\n' for s in program))
+            f.write('{"dry":0}\n')
+        out = subprocess.run([HOST_BIN, nc, os.devnull, block_file], stdout=subprocess.PIPE,
+                             stderr=subprocess.STDOUT, timeout=timeout, check=False).stdout
+        times = DRY_TIME.findall(out.decode('latin-1'))
+        job_time = float(times[-1]) if times else 0.0
+        found = []
+        if blocks:
+            with open(block_file) as f:
+                for line in f:
+                    v = line.split()
+                    found.append((int(v[0]), v[1], float(v[2]), float(v[3]), float(v[4]), float(v[5])))
+    return job_time, found
+
+
+def plan_hints(blocks):
+    """ {line number: exit hint} from a backward pass over every block of the program
+
+    This is the firmware's backward pass (mp_plan_block_list()) run from the real end of
+    the program: a block can brake by delta_vmax, a stop plans to zero and a command
+    planned through passes the velocity on. Each line takes the hint of its last block.
+    """
+    hints = {}
+    nx_velocity = 0.0                           # the program ends at rest
+    for linenum, kind, _length, entry_vmax, _exit_vmax, delta_vmax in reversed(blocks):
+        if kind == 's':
+            nx_velocity = 0.0
+        elif kind == 'm':
+            hints.setdefault(linenum, nx_velocity)
+            nx_velocity = min(entry_vmax, nx_velocity + delta_vmax)
+    return hints
+
+
+def write_hints(lines, hints, margin):
+    """ the program with a (VEX) comment on each line that has a hint """
+    hinted = []
+    for i, line in enumerate(lines, 1):
+        hint = int(hints.get(i, 0.0) * margin * 10) / 10.0
+        text = line.rstrip('\r\n')
+        if hint > 0 and _is_gcode(text):
+            comment = min([p for p in (text.find('('), text.find(';')) if p >= 0] or [len(text)])
+            if not text[comment:].lstrip('(; ').upper().startswith('MSG'):
+                text = '%s(VEX%.1f)%s' % (text[:comment].rstrip() + ' ', hint, text[comment:])
+        hinted.append(text + '\n')
+    return hinted
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Write whole-program exit velocity hints into a Gcode file')
+    parser.add_argument('program', help='Gcode file to plan')
+    parser.add_argument('-o', '--output', required=True, help='hinted Gcode file to write')
+    parser.add_argument('--settings', help='settings to send first - JSON or $ lines, one per line')
+    parser.add_argument('--margin', type=float, default=0.95, help='hints are scaled by this (0.95)')
+    parser.add_argument('--timeout', type=float, default=600.0, help='real seconds allowed per dry plan (600)')
+    args = parser.parse_args()
+
+    if not os.path.exists(HOST_BIN):
+        print('%s not found - build it with "make PLATFORM=host" in TinyG2' % HOST_BIN)
+        return 2
+    with open(args.program, encoding='latin-1') as f:
+        lines = f.readlines()
+    settings = []
+    if args.settings:
+        with open(args.settings, encoding='latin-1') as f:
+            settings = [s for s in f.readlines() if s.strip()]
+
+    job_time, blocks = dry_plan(settings, number_lines(lines), args.timeout, blocks=True)
+    if not blocks:
+        print('%s: the dry plan took no blocks' % args.program)
+        return 1
+    hints = plan_hints(blocks)
+    hinted = write_hints(lines, hints, args.margin)
+    with open(args.output, 'w', encoding='latin-1') as f:
+        f.writelines(hinted)
+
+    hinted_time, _ = dry_plan(settings + ['{"vh":1}\n'], number_lines(hinted), args.timeout)
+    print('%s: %d blocks, %d lines hinted' % (args.program, len(blocks),
+          sum(1 for v in hints.values() if v * args.margin >= 0.1)))
+    print('dry plan job time %.3f s, %.3f s with hints (%+.1f%%)' % (job_time, hinted_time,
+          100.0 * (hinted_time - job_time) / job_time if job_time > 0 else 0.0))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())